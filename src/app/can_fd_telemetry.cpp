@@ -0,0 +1,174 @@
+#include "app/can_fd_telemetry.h"
+
+#include <cstdint>
+
+#include "hal/can.h"
+#include "engine/calibration.h"
+#include "engine/engine_config.h"
+#include "engine/ecu_sched.h"
+#include "engine/knock.h"
+#include "engine/map_window.h"
+#include "engine/misfire_detect.h"
+
+namespace {
+
+// Layout 0x410 tem 4 blocos por cilindro (64 B): 5–8 cil reportam os 4
+// primeiros; [5] indica o total ao logger.
+constexpr uint8_t kFrameCyl = (ems::engine::cfg::kCylinderCount < 4u)
+    ? ems::engine::cfg::kCylinderCount : 4u;
+
+static bool     g_prev_valid    = false;
+static uint16_t g_prev_tooth    = 0u;
+static uint16_t g_seq           = 0u;
+static uint32_t g_drops         = 0u;
+static uint32_t g_late_prev[8]  = {};
+static bool     g_hist_pending  = false;
+
+static_assert(4u + 4u * (1u + ems::app::kCanFdKnockHistEntries) <= ems::app::kCanFdTelemetryLen,
+              "0x411: 4 blocos de histórico cabem em 64 B");
+static_assert(ems::app::kCanFdKnockHistEntries <= ems::engine::kKnockHistoryLen,
+              "0x411 não pede mais entradas do que o anel guarda");
+
+inline void put_u16(uint8_t* p, uint32_t v) noexcept {
+    const uint16_t c = (v > 0xFFFFu) ? 0xFFFFu : static_cast<uint16_t>(v);
+    p[0] = static_cast<uint8_t>(c & 0xFFu);
+    p[1] = static_cast<uint8_t>((c >> 8u) & 0xFFu);
+}
+
+// Um pedido recusado pelo FDCAN (INIT/FDOE sem confirmação) não é repetido a
+// cada slot — cada tentativa tira o nó do bus; só uma nova calibração o refaz.
+static bool g_fd_refused      = false;
+static bool g_fd_refused_want = false;
+
+inline void sync_fd_mode() noexcept {
+    const bool want = (ems::engine::can_fd_telemetry_enable != 0u);
+    if (want == ems::hal::can0_fd_enabled()) {
+        g_fd_refused = false;
+        return;
+    }
+    if (g_fd_refused && want == g_fd_refused_want) { return; }
+    g_fd_refused = !ems::hal::can0_set_fd_mode(want);
+    g_fd_refused_want = want;
+}
+
+void build_frame(const ems::drv::CkpSnapshot& ckp, ems::hal::CanFdFrame& out) noexcept {
+    out = {};
+    out.id       = ems::app::kCanFdTelemetryId;
+    out.len      = ems::app::kCanFdTelemetryLen;
+    out.extended = false;
+    out.brs      = true;
+    uint8_t* d = out.data;
+
+    put_u16(d + 0, g_seq);
+    put_u16(d + 2, ckp.rpm_x10 / 10u);
+    d[4] = static_cast<uint8_t>((ckp.phase_A ? 0x01u : 0u) |
+                                (::ecu_sched_is_sequential() != 0u ? 0x02u : 0u));
+    d[5] = ems::engine::cfg::kCylinderCount;
+
+    for (uint8_t c = 0u; c < kFrameCyl; ++c) {
+        uint32_t power_ns = 0u, pred_ns = 0u;
+        ems::engine::misfire_get_window_sums(c, power_ns, pred_ns);
+        put_u16(d + 6u + c * 4u, power_ns / 1000u);
+        put_u16(d + 8u + c * 4u, pred_ns / 1000u);
+        put_u16(d + 22u + c * 2u, ems::engine::knock_get_peak_raw(c));
+        const uint16_t ret = ems::engine::knock_get_retard_x10(c);
+        d[30u + c] = static_cast<uint8_t>(ret > 255u ? 255u : ret);
+        put_u16(d + 34u + c * 2u, ems::engine::map_window_slot_bar_x1000(c));
+        d[58u + c] = ems::engine::misfire_get_event_count(c);
+    }
+
+    uint32_t late[8] = {};
+    ::ecu_sched_get_late_counts_u32x8(late);
+    for (uint8_t ch = 0u; ch < 8u; ++ch) {
+        // Delta por ciclo; reset de contadores (protocolo) → recomeça do 0.
+        const uint32_t delta = (late[ch] >= g_late_prev[ch]) ? (late[ch] - g_late_prev[ch])
+                                                             : late[ch];
+        g_late_prev[ch] = late[ch];
+        put_u16(d + 42u + ch * 2u, delta);
+    }
+
+    const uint32_t cycles = ems::engine::map_window_cycles();
+    d[62] = static_cast<uint8_t>(cycles & 0xFFu);
+    d[63] = static_cast<uint8_t>((cycles >> 8u) & 0xFFu);
+}
+
+void build_knock_hist_frame(ems::hal::CanFdFrame& out) noexcept {
+    out = {};
+    out.id       = ems::app::kCanFdKnockHistId;
+    out.len      = ems::app::kCanFdTelemetryLen;
+    out.extended = false;
+    out.brs      = true;
+    uint8_t* d = out.data;
+
+    put_u16(d + 0, static_cast<uint16_t>(g_seq - 1u));
+    d[2] = ems::engine::cfg::kCylinderCount;
+    d[3] = ems::app::kCanFdKnockHistEntries;
+    for (uint8_t c = 0u; c < kFrameCyl; ++c) {
+        uint8_t* blk = d + 4u + c * (1u + ems::app::kCanFdKnockHistEntries);
+        blk[0] = ems::engine::knock_history_read(c, blk + 1u,
+                                                 ems::app::kCanFdKnockHistEntries);
+    }
+}
+
+} // namespace
+
+namespace ems::app {
+
+void can_fd_telemetry_init() noexcept {
+    g_prev_valid = false;
+    g_prev_tooth = 0u;
+    sync_fd_mode();
+}
+
+void can_fd_telemetry_process(const ems::drv::CkpSnapshot& ckp) noexcept {
+    sync_fd_mode();
+    if (!ems::hal::can0_fd_enabled() ||
+        ckp.state != ems::drv::SyncState::FULL_SYNC) {
+        g_prev_valid = false;
+        g_hist_pending = false;
+        return;
+    }
+
+    // Fronteira de ciclo: tooth_index recua (gap) ao entrar em phase_A.
+    const bool wrapped = g_prev_valid && (ckp.tooth_index < g_prev_tooth);
+    g_prev_tooth = ckp.tooth_index;
+    g_prev_valid = true;
+    ems::hal::CanFdFrame out;
+    if (!wrapped || !ckp.phase_A) {
+        if (g_hist_pending) {
+            build_knock_hist_frame(out);
+            if (ems::hal::can0_tx_fd(out)) { g_hist_pending = false; }
+        }
+        return;
+    }
+
+    build_frame(ckp, out);
+    if (ems::hal::can0_tx_fd(out)) {
+        ++g_seq;
+        if ((g_seq % kCanFdKnockHistEvery) == 0u) { g_hist_pending = true; }
+    } else {
+        ++g_drops;
+    }
+}
+
+uint16_t can_fd_telemetry_seq() noexcept {
+    return g_seq;
+}
+
+uint32_t can_fd_telemetry_drops() noexcept {
+    return g_drops;
+}
+
+#if defined(EMS_HOST_TEST)
+void can_fd_telemetry_test_reset() noexcept {
+    g_prev_valid = false;
+    g_prev_tooth = 0u;
+    g_seq        = 0u;
+    g_drops      = 0u;
+    g_hist_pending = false;
+    g_fd_refused = false;
+    for (uint8_t ch = 0u; ch < 8u; ++ch) { g_late_prev[ch] = 0u; }
+}
+#endif
+
+} // namespace ems::app
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+#include "drv/ckp.h"
+
+namespace ems::app {
+
+// ── Telemetria CAN FD por ciclo de motor ─────────────────────────────────────
+// Stream opcional (calibração can_fd_telemetry_enable, page0[258]) para um
+// logger externo: um frame FD de 64 B com BRS a cada ciclo de 720°, muito
+// acima da banda disponível na UART para análise em tempo real.
+//
+// Frame 0x410 (little-endian):
+//   [0-1]   seq (u16, +1 por frame)
+//   [2-3]   rpm (u16)
+//   [4]     flags: bit0 = phase_A, bit1 = ignição sequencial
+//   [5]     nº de cilindros (blocos por cilindro abaixo cobrem os 4
+//           primeiros; motores < 4 cil deixam os restantes a 0)
+//   [6-21]  misfire por cilindro: {power_us u16, pred_us u16} × 4
+//           (somas da última janela de potência — ratio = power / pred)
+//   [22-29] knock: pico raw ADC da última janela × 4 (u16)
+//   [30-33] knock: retard ×10 por cilindro (u8, clamp 255)
+//   [34-41] map_window: média do slot × 4 (bar × 1000, u16)
+//   [42-57] late events por canal ECU_CH_0..7 no ciclo (delta, u16)
+//   [58-61] misfire: eventos acumulados por cilindro (u8)
+//   [62-63] map_window_cycles (u16, wrap)
+static constexpr uint16_t kCanFdTelemetryId  = 0x410u;
+static constexpr uint8_t  kCanFdTelemetryLen = 64u;
+
+// Frame 0x411 — histórico de intensidade de knock (engine/knock.h), a cada
+// kCanFdKnockHistEvery frames 0x410, no slot de 2 ms seguinte (o 0x410 ainda
+// está na TX FIFO). 14 entradas por cilindro cobrem com folga as
+// 8 janelas do intervalo em sequencial; o logger deduplica pelo contador.
+//   [0-1]   seq do último 0x410 (u16)
+//   [2]     nº de cilindros
+//   [3]     entradas por bloco (kCanFdKnockHistEntries)
+//   [4-63]  4 blocos de 15 B: {contador de janelas u8 (wrap),
+//           14 entradas u8, mais antiga primeiro}
+static constexpr uint16_t kCanFdKnockHistId      = 0x411u;
+static constexpr uint8_t  kCanFdKnockHistEvery   = 8u;
+static constexpr uint8_t  kCanFdKnockHistEntries = 14u;
+
+// Aplica a calibração ao FDCAN1 (liga/desliga FD). Chamar depois de
+// can_stack_init() — can0_init() arranca sempre em modo clássico.
+void can_fd_telemetry_init() noexcept;
+
+// Slot 2 ms: segue mudanças de calibração e, em FULL_SYNC, transmite um
+// frame por ciclo de 720° (wrap de tooth_index com phase_A). O wrap só é
+// visto se uma amostra de 2 ms cair na volta phase_A, o que exige uma volta
+// ≥ 2 ms: até ~30 000 RPM — nenhum ciclo perdido na gama útil. O 0x411
+// sai num slot sem wrap; buffer ocupado → tenta no slot seguinte.
+void can_fd_telemetry_process(const ems::drv::CkpSnapshot& ckp) noexcept;
+
+// Frames transmitidos com sucesso / descartados (FD anterior pendente ou TX FIFO cheia).
+uint16_t can_fd_telemetry_seq() noexcept;
+uint32_t can_fd_telemetry_drops() noexcept;
+
+#if defined(EMS_HOST_TEST)
+void can_fd_telemetry_test_reset() noexcept;
+#endif
+
+} // namespace ems::app
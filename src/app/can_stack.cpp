@@ -4,6 +4,7 @@
 
 #include "hal/can.h"
 #include "app/can_rx_map.h"
+#include "engine/engine_config.h"
 
 namespace {
 
@@ -26,9 +27,8 @@ static uint32_t g_last_tx_402_ms  = 0u;
 // Acumulador em nanolitros (fracção) + contador inteiro em microlitros.
 // Fórmula (derivação em can_stack.cpp): delta_nl = pw_ms_x10 × flow × n_cyl × rpm / 36000
 // com flow = kInjectorFlowCcMin (cc/min), n_cyl = kCylinderCount, rpm em RPM.
-// Constantes inline para manter can_stack.cpp independente de engine_config.h.
 static constexpr uint32_t kFcoFlowCcMin  = 450u;  // injector flow cc/min
-static constexpr uint32_t kFcoCylCount   = 4u;    // number of cylinders
+static constexpr uint32_t kFcoCylCount   = ems::engine::cfg::kCylinderCount;
 static constexpr uint64_t kFcoDivisor    = 36000u; // 100µs→µs conv × 3_600_000 / 100
 
 static uint32_t g_fco_accum_ul   = 0u;  // accumulated fuel [µl], wraps at ~4295 L
@@ -0,0 +1,88 @@
+/**
+ * @file app/loop_sched.cpp
+ * @brief Escalonador cooperativo do main loop — passo, orçamentos, shedding.
+ */
+#include "app/loop_sched.h"
+
+namespace ems::app {
+
+LoopScheduler::LoopScheduler(const LoopTask* tasks, uint8_t n, LoopClockUs clock_us,
+                             uint32_t frame_us) noexcept
+    : tasks_(tasks),
+      n_(n > kLoopSchedMaxTasks ? kLoopSchedMaxTasks : n),
+      clock_us_(clock_us),
+      frame_us_(frame_us) {
+    // Inserção estável por prioridade (≤ 16 entradas, uma vez no boot).
+    for (uint8_t i = 0u; i < n_; ++i) {
+        uint8_t j = i;
+        while (j > 0u && tasks_[order_[j - 1u]].prio > tasks_[i].prio) {
+            order_[j] = order_[j - 1u];
+            --j;
+        }
+        order_[j] = i;
+    }
+}
+
+void LoopScheduler::start(uint32_t now_ms) noexcept {
+    for (uint8_t i = 0u; i < n_; ++i) {
+        stats_[i].last_run_ms = now_ms;
+        stats_[i].shed_streak = 0u;
+    }
+}
+
+uint8_t LoopScheduler::run(uint32_t now_ms) noexcept {
+    const uint32_t pass_start_us = clock_us_();
+    uint8_t ran = 0u;
+    for (uint8_t k = 0u; k < n_; ++k) {
+        const uint8_t i = order_[k];
+        const LoopTask& t = tasks_[i];
+        LoopTaskStats& s = stats_[i];
+        const uint32_t since = now_ms - s.last_run_ms;
+        if (since < t.period_ms) {
+            continue;
+        }
+        const uint32_t t0 = clock_us_();
+        if (t.prio == LoopPrio::kLow && s.shed_streak < kLoopShedMaxStreak &&
+            (t0 - pass_start_us) + t.budget_us > frame_us_) {
+            ++s.sheds;
+            ++s.shed_streak;
+            continue;  // continua vencida → próximo passo
+        }
+        if (s.runs != 0u && since >= 2u * static_cast<uint32_t>(t.period_ms)) {
+            ++s.late;
+        }
+        s.last_run_ms = now_ms;
+        s.shed_streak = 0u;
+        t.fn(now_ms);
+        const uint32_t dt = clock_us_() - t0;
+        ++s.runs;
+        s.last_us = dt;
+        if (dt > s.max_us) {
+            s.max_us = dt;
+        }
+        if (dt > t.budget_us) {
+            ++s.overruns;
+        }
+        ++ran;
+    }
+    const uint32_t pass_us = clock_us_() - pass_start_us;
+    if (pass_us > pass_max_us_) {
+        pass_max_us_ = pass_us;
+    }
+    if (pass_us > frame_us_) {
+        ++frame_overruns_;
+    }
+    return ran;
+}
+
+void LoopScheduler::clear_stats() noexcept {
+    for (uint8_t i = 0u; i < n_; ++i) {
+        const uint32_t last = stats_[i].last_run_ms;
+        stats_[i] = {};
+        stats_[i].last_run_ms = last;
+    }
+    frame_overruns_ = 0u;
+    pass_max_us_ = 0u;
+}
+
+}  // namespace ems::app
@@ -0,0 +1,95 @@
+#pragma once
+
+/**
+ * @file app/loop_sched.h
+ * @brief Escalonador cooperativo do main loop (tabela de tarefas).
+ *
+ * Cada tarefa declara período (ms), prioridade e orçamento de CPU (µs). Um
+ * passo (run) percorre as tarefas por prioridade e corre as vencidas
+ * (now − última ≥ período, mesma regra do antigo elapsed()/last = now).
+ *
+ * Contabilidade por tarefa:
+ *   overrun  — a execução excedeu o orçamento declarado;
+ *   late     — arrancou com ≥ 2 períodos desde a anterior (slot perdido);
+ *   shed     — adiada pela política abaixo.
+ * Por passo: frame_overruns conta passos que excederam o frame (2 ms).
+ *
+ * Shedding: antes de uma tarefa kLow, se o tempo já gasto no passo mais o
+ * orçamento dela não couber no frame, a tarefa é adiada (fica vencida e
+ * corre no passo seguinte, normalmente logo a seguir, sem o trabalho
+ * crítico à frente). Garantia anti-fome: após kLoopShedMaxStreak adiamentos
+ * seguidos corre mesmo assim.
+ *
+ * O relógio de µs é injectado: micros() no alvo, relógio virtual no host
+ * (as tarefas de teste avançam-no para simular a sua duração).
+ */
+
+#include <cstdint>
+
+namespace ems::app {
+
+constexpr uint8_t  kLoopSchedMaxTasks = 16u;
+constexpr uint32_t kLoopFrameUs       = 2000u;
+constexpr uint8_t  kLoopShedMaxStreak = 8u;
+
+// kCritical primeiro; só kLow é adiável.
+enum class LoopPrio : uint8_t { kCritical = 0u, kHigh = 1u, kNormal = 2u, kLow = 3u };
+
+using LoopTaskFn  = void (*)(uint32_t now_ms);
+using LoopClockUs = uint32_t (*)();
+
+struct LoopTask {
+    const char* name;
+    LoopTaskFn  fn;
+    uint16_t    period_ms;
+    LoopPrio    prio;
+    uint16_t    budget_us;
+};
+
+struct LoopTaskStats {
+    uint32_t last_run_ms;
+    uint32_t runs;
+    uint32_t overruns;
+    uint32_t late;
+    uint32_t sheds;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint8_t  shed_streak;
+};
+
+class LoopScheduler {
+public:
+    // tasks tem de viver enquanto o escalonador (tabela estática); n é
+    // truncado a kLoopSchedMaxTasks. Ordem de execução: prioridade, e
+    // ordem da tabela dentro da mesma prioridade.
+    LoopScheduler(const LoopTask* tasks, uint8_t n, LoopClockUs clock_us,
+                  uint32_t frame_us = kLoopFrameUs) noexcept;
+
+    // Referência temporal: todas as tarefas ficam com última execução = now
+    // (primeira execução um período depois, como os g_tXXms_ = millis()).
+    void start(uint32_t now_ms) noexcept;
+
+    // Um passo do main loop. Devolve o nº de tarefas executadas.
+    uint8_t run(uint32_t now_ms) noexcept;
+
+    uint8_t task_count() const noexcept { return n_; }
+    const LoopTask& task(uint8_t i) const noexcept { return tasks_[i]; }
+    const LoopTaskStats& stats(uint8_t i) const noexcept { return stats_[i]; }
+    uint32_t frame_overruns() const noexcept { return frame_overruns_; }
+    uint32_t pass_max_us() const noexcept { return pass_max_us_; }
+
+    // Zera contadores e máximos (mantém a referência temporal).
+    void clear_stats() noexcept;
+
+private:
+    const LoopTask* tasks_;
+    uint8_t         n_;
+    LoopClockUs     clock_us_;
+    uint32_t        frame_us_;
+    uint8_t         order_[kLoopSchedMaxTasks] = {};
+    LoopTaskStats   stats_[kLoopSchedMaxTasks] = {};
+    uint32_t        frame_overruns_ = 0u;
+    uint32_t        pass_max_us_ = 0u;
+};
+
+}  // namespace ems::app
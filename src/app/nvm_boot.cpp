@@ -130,15 +130,17 @@ void load_boost_map_from_nvm() noexcept {
 }
 
 void load_table_axes_from_nvm() noexcept {
-    alignas(4) uint8_t page[64] = {};
+    // Mesma forma da página 11: rpm u16 × N, depois load u16 × N.
+    constexpr uint16_t kAxisBytes = 2u * ems::engine::kTableAxisSize;
+    alignas(4) uint8_t page[2u * kAxisBytes] = {};
     if (!ems::hal::nvm_load_calibration(9u, page, sizeof(page)) ||
         page_is_erased(page, sizeof(page))) {
         return;  // flash apagada → eixos default de compilação
     }
     uint16_t rpm[ems::engine::kTableAxisSize] = {};
     uint16_t load[ems::engine::kTableAxisSize] = {};
-    std::memcpy(rpm,  page +  0, 32u);
-    std::memcpy(load, page + 32, 32u);
+    std::memcpy(rpm,  page + 0,          kAxisBytes);
+    std::memcpy(load, page + kAxisBytes, kAxisBytes);
     // table_axes_set valida monotonicidade — conteúdo corrompido é rejeitado
     // e os defaults de compilação permanecem.
     (void)ems::engine::table_axes_set(rpm, load);
@@ -15,6 +15,7 @@
 #include "engine/ecu_sched.h"
 #include "engine/etb_control.h"
 #include "engine/fuel_calc.h"
+#include "engine/fuel_pw_kernel.h"
 #include "engine/torque_manager.h"
 #include "engine/map_estimator.h"
 #include "app/status_bits.h"
@@ -24,11 +25,13 @@
 #include "hal/timer.h"
 #include "engine/constants.h"
 #include "engine/table3d.h"
+#include "engine/table_reaxis.h"
 #include "hal/crc32.h"
 #include "hal/flash.h"
 #include "engine/engine_config.h"
 #include "engine/map_window.h"
 #include "engine/cut_reason.h"
+#include "engine/diagnostic_manager.h"
 
 // DIAG rev-limit (definidos em main_stm32.cpp, escopo global) — dump 'D' [41..43].
 extern uint32_t g_dbg_rev_limit_trips;
@@ -47,7 +50,7 @@ static inline uint32_t map_window_diag_word(uint8_t slot) noexcept {
 }
 
 void parse_byte(uint8_t b) noexcept {
-    if (g_state == ParseState::IDLE) {
+    if (g_sess->state == ParseState::IDLE) {
         // Ignore line-state reset probe bytes used by some host stacks.
         if (b == 0xF0u) {
             return;
@@ -55,8 +58,8 @@ void parse_byte(uint8_t b) noexcept {
         // Auto-detect envelope TS: comandos legacy são ASCII ≥ 0x20; um frame
         // envelope começa pelo byte alto do size BE (0x00-0x01 para ≤ 263 B).
         if (b < 0x20u) {
-            g_env_size = static_cast<uint16_t>(static_cast<uint16_t>(b) << 8u);
-            g_state = ParseState::ENV_SIZE_LO;
+            g_sess->env_size = static_cast<uint16_t>(static_cast<uint16_t>(b) << 8u);
+            g_sess->state = ParseState::ENV_SIZE_LO;
             return;
         }
         if (b == static_cast<uint8_t>('Q')) {
@@ -91,37 +94,44 @@ void parse_byte(uint8_t b) noexcept {
             return;
         }
         if (b == static_cast<uint8_t>('r')) {
-            g_state = ParseState::READ_ARGS;
-            g_arg_pos = 0u;
-            g_cmd_page = 0u;
-            g_cmd_off = 0u;
-            g_cmd_len = 0u;
+            g_sess->state = ParseState::READ_ARGS;
+            g_sess->arg_pos = 0u;
+            g_sess->cmd_page = 0u;
+            g_sess->cmd_off = 0u;
+            g_sess->cmd_len = 0u;
             return;
         }
         if (b == static_cast<uint8_t>('w')) {
-            g_state = ParseState::WRITE_ARGS;
-            g_arg_pos = 0u;
-            g_cmd_page = 0u;
-            g_cmd_off = 0u;
-            g_cmd_len = 0u;
-            g_write_pos = 0u;
-            g_write_ram_only = false;
+            g_sess->state = ParseState::WRITE_ARGS;
+            g_sess->arg_pos = 0u;
+            g_sess->cmd_page = 0u;
+            g_sess->cmd_off = 0u;
+            g_sess->cmd_len = 0u;
+            g_sess->write_pos = 0u;
+            g_sess->write_ram_only = false;
             return;
         }
         if (b == static_cast<uint8_t>('x')) {
-            g_state = ParseState::WRITE_ARGS;
-            g_arg_pos = 0u;
-            g_cmd_page = 0u;
-            g_cmd_off = 0u;
-            g_cmd_len = 0u;
-            g_write_pos = 0u;
-            g_write_ram_only = true;
+            g_sess->state = ParseState::WRITE_ARGS;
+            g_sess->arg_pos = 0u;
+            g_sess->cmd_page = 0u;
+            g_sess->cmd_off = 0u;
+            g_sess->cmd_len = 0u;
+            g_sess->write_pos = 0u;
+            g_sess->write_ram_only = true;
             return;
         }
         if (b == static_cast<uint8_t>('b')) {
-            g_state = ParseState::BURN_ARGS;
-            g_arg_pos = 0u;
-            g_cmd_page = 0u;
+            g_sess->state = ParseState::BURN_ARGS;
+            g_sess->arg_pos = 0u;
+            g_sess->cmd_page = 0u;
+            return;
+        }
+        if (b == static_cast<uint8_t>('U')) {
+            // Rollback da página para o burn anterior (cópia A/B em flash).
+            g_sess->state = ParseState::ROLLBACK_ARGS;
+            g_sess->arg_pos = 0u;
+            g_sess->cmd_page = 0u;
             return;
         }
         if (b == static_cast<uint8_t>('d')) {
@@ -131,7 +141,7 @@ void parse_byte(uint8_t b) noexcept {
             return;
         }
         if (b == static_cast<uint8_t>('B')) {
-            g_state = ParseState::BENCH_ARG;
+            g_sess->state = ParseState::BENCH_ARG;
             return;
         }
         if (b == static_cast<uint8_t>('Z')) {
@@ -149,9 +159,31 @@ void parse_byte(uint8_t b) noexcept {
             tx_push(static_cast<uint8_t>((n > 255u) ? 255u : n));
             return;
         }
+        if (b == static_cast<uint8_t>('E')) {
+            // Memória de DTCs: [count u8] + kMaxStoredDtcs × StoredDtc (36 B
+            // LE, layout de diagnostic_manager.h) = 361 B; entradas ≥ count
+            // vão a zeros.
+            using ems::engine::DiagnosticManager;
+            const uint8_t n = DiagnosticManager::get_stored_dtc_count();
+            tx_push(n);
+            const ems::engine::StoredDtc blank{};
+            for (uint8_t i = 0u; i < DiagnosticManager::kMaxStoredDtcs; ++i) {
+                const ems::engine::StoredDtc* e = DiagnosticManager::get_stored_dtc(i);
+                tx_push_bytes(reinterpret_cast<const uint8_t*>(e != nullptr ? e : &blank),
+                              static_cast<uint16_t>(sizeof(ems::engine::StoredDtc)));
+            }
+            return;
+        }
+        if (b == static_cast<uint8_t>('e')) {
+            // Apaga a memória de DTCs (as falhas activas ficam); o NVM segue
+            // no próximo persist_process.
+            ems::engine::DiagnosticManager::clear_stored_dtcs();
+            tx_push(kAckOk);
+            return;
+        }
         if (b == static_cast<uint8_t>('T')) {
-            g_state = ParseState::TEST_ARGS;
-            g_arg_pos = 0u;
+            g_sess->state = ParseState::TEST_ARGS;
+            g_sess->arg_pos = 0u;
             return;
         }
         if (b == static_cast<uint8_t>('K')) {
@@ -176,7 +208,9 @@ void parse_byte(uint8_t b) noexcept {
                 tx_push_bytes(tmp, 4u);
             }
             const ems::drv::CkpSnapshot snap = ems::drv::ckp_snapshot();
-            tx_push(static_cast<uint8_t>(snap.tooth_index > 57u ? 57u
+            const uint8_t last_tooth =
+                static_cast<uint8_t>(ems::drv::ckp_wheel().real_teeth - 1u);
+            tx_push(static_cast<uint8_t>(snap.tooth_index > last_tooth ? last_tooth
                                          : snap.tooth_index));
             tx_push(snap.phase_A ? 1u : 0u);
             tx_push(static_cast<uint8_t>(snap.state));
@@ -213,8 +247,10 @@ void parse_byte(uint8_t b) noexcept {
         if (b == static_cast<uint8_t>('D')) {
             EcuSchedDiagSnapshot sd{};
             ecu_sched_get_diag_snapshot(&sd);
-            // 52×u32 = 208 B (era 51; +1 razões de corte [51])
-            const uint32_t diag[52] = {
+            // 57×u32 = 228 B (era 52; +4 estágios do kernel de PW [52..55],
+            // +1 pior caso em ciclos do kernel [56])
+            const ems::engine::FuelPwBreakdown& pw_bd = ems::engine::g_fuel_pw_breakdown;
+            const uint32_t diag[57] = {
                 sd.late_event_count,
                 sd.cycle_schedule_drop_count,
                 sd.inj1_arm,
@@ -276,6 +312,13 @@ void parse_byte(uint8_t b) noexcept {
                 // [51] razões de corte: hi16 = spark, lo16 = fuel (cut_reason.h)
                 (static_cast<uint32_t>(ems::engine::g_spark_cut_reasons) << 16) |
                     ems::engine::g_fuel_cut_reasons,
+                // [52..55] kernel de PW: base, λ+trim, fluxo (CLT/IAT/2-slope),
+                // comandado (ΔP/S-curve + dead-time) — fuel_pw_kernel.h
+                pw_bd.base_pw_us,
+                pw_bd.trimmed_pw_us,
+                pw_bd.flow_pw_us,
+                pw_bd.inj_pw_us,
+                ems::engine::g_fuel_pw_kernel_cycles_max,  // [56] DWT, pior caso
             };
             tx_push_bytes(reinterpret_cast<const uint8_t*>(diag), sizeof(diag));
             return;
@@ -283,34 +326,34 @@ void parse_byte(uint8_t b) noexcept {
         return;
     }
 
-    if (g_state == ParseState::ENV_SIZE_LO) {
-        g_env_size = static_cast<uint16_t>(g_env_size | b);
-        if (g_env_size == 0u || g_env_size > kEnvMaxPayload) {
+    if (g_sess->state == ParseState::ENV_SIZE_LO) {
+        g_sess->env_size = static_cast<uint16_t>(g_sess->env_size | b);
+        if (g_sess->env_size == 0u || g_sess->env_size > kEnvMaxPayload) {
             reset_parser();
             return;
         }
-        g_env_pos = 0u;
-        g_state = ParseState::ENV_PAYLOAD;
+        g_sess->env_pos = 0u;
+        g_sess->state = ParseState::ENV_PAYLOAD;
         return;
     }
 
-    if (g_state == ParseState::ENV_PAYLOAD) {
-        g_env_buf[g_env_pos] = b;
-        ++g_env_pos;
-        if (g_env_pos >= g_env_size) {
-            g_env_rx_crc = 0u;
-            g_env_crc_pos = 0u;
-            g_state = ParseState::ENV_CRC;
+    if (g_sess->state == ParseState::ENV_PAYLOAD) {
+        g_sess->env_buf[g_sess->env_pos] = b;
+        ++g_sess->env_pos;
+        if (g_sess->env_pos >= g_sess->env_size) {
+            g_sess->env_rx_crc = 0u;
+            g_sess->env_crc_pos = 0u;
+            g_sess->state = ParseState::ENV_CRC;
         }
         return;
     }
 
-    if (g_state == ParseState::ENV_CRC) {
-        g_env_rx_crc = (g_env_rx_crc << 8u) | b;
-        ++g_env_crc_pos;
-        if (g_env_crc_pos >= 4u) {
-            if (ems::hal::crc32_calc(g_env_buf, g_env_size) == g_env_rx_crc) {
-                env_dispatch(g_env_buf, g_env_size);
+    if (g_sess->state == ParseState::ENV_CRC) {
+        g_sess->env_rx_crc = (g_sess->env_rx_crc << 8u) | b;
+        ++g_sess->env_crc_pos;
+        if (g_sess->env_crc_pos >= 4u) {
+            if (ems::hal::crc32_calc(g_sess->env_buf, g_sess->env_size) == g_sess->env_rx_crc) {
+                env_dispatch(g_sess->env_buf, g_sess->env_size);
             } else {
                 env_send_response(kTsRcCrcErr, nullptr, 0u);
             }
@@ -319,16 +362,16 @@ void parse_byte(uint8_t b) noexcept {
         return;
     }
 
-    if (g_state == ParseState::TEST_ARGS) {
-        g_test_args[g_arg_pos] = b;
-        ++g_arg_pos;
-        if (g_arg_pos < 4u) { return; }
+    if (g_sess->state == ParseState::TEST_ARGS) {
+        g_sess->test_args[g_sess->arg_pos] = b;
+        ++g_sess->arg_pos;
+        if (g_sess->arg_pos < 4u) { return; }
         handle_test_cmd();
         reset_parser();
         return;
     }
 
-    if (g_state == ParseState::BENCH_ARG) {
+    if (g_sess->state == ParseState::BENCH_ARG) {
         // Bench-mode CLT/IAT p/ HIL: 0=off (ADC normal), !=0=on (90°C/25°C fixos,
         // sem SENSOR_FAULT pelos canais CLT/IAT). Ver sensors_set_bench_clt_iat.
         ems::drv::sensors_set_bench_clt_iat(b != 0u, 900, 250);
@@ -341,9 +384,9 @@ void parse_byte(uint8_t b) noexcept {
         return;
     }
 
-    if (g_state == ParseState::BURN_ARGS) {
-        g_cmd_page = normalize_page_id(b);
-        if (burn_rpm_safe() && burn_page_to_flash(g_cmd_page)) {
+    if (g_sess->state == ParseState::BURN_ARGS) {
+        g_sess->cmd_page = normalize_page_id(b);
+        if (burn_rpm_safe() && burn_page_to_flash(g_sess->cmd_page)) {
             tx_push(kAckOk);
         } else {
             tx_push(kAckErr);
@@ -352,67 +395,80 @@ void parse_byte(uint8_t b) noexcept {
         return;
     }
 
-    if (g_state == ParseState::READ_ARGS || g_state == ParseState::WRITE_ARGS) {
-        switch (g_arg_pos) {
+    if (g_sess->state == ParseState::ROLLBACK_ARGS) {
+        // ACK = rollback enfileirado; o buffer da página e os globals são
+        // recarregados quando o job de flash conclui.
+        g_sess->cmd_page = normalize_page_id(b);
+        if (burn_rpm_safe() && rollback_page_in_flash(g_sess->cmd_page)) {
+            tx_push(kAckOk);
+        } else {
+            tx_push(kAckErr);
+        }
+        reset_parser();
+        return;
+    }
+
+    if (g_sess->state == ParseState::READ_ARGS || g_sess->state == ParseState::WRITE_ARGS) {
+        switch (g_sess->arg_pos) {
             case 0u:
-                g_cmd_page = normalize_page_id(b);
+                g_sess->cmd_page = normalize_page_id(b);
                 break;
             case 1u:
-                g_cmd_off = b;
+                g_sess->cmd_off = b;
                 break;
             case 2u:
-                g_cmd_off = static_cast<uint16_t>(g_cmd_off | (static_cast<uint16_t>(b) << 8u));
+                g_sess->cmd_off = static_cast<uint16_t>(g_sess->cmd_off | (static_cast<uint16_t>(b) << 8u));
                 break;
             case 3u:
-                g_cmd_len = b;
+                g_sess->cmd_len = b;
                 break;
             case 4u:
-                g_cmd_len = static_cast<uint16_t>(g_cmd_len | (static_cast<uint16_t>(b) << 8u));
+                g_sess->cmd_len = static_cast<uint16_t>(g_sess->cmd_len | (static_cast<uint16_t>(b) << 8u));
                 break;
             default:
                 break;
         }
-        ++g_arg_pos;
+        ++g_sess->arg_pos;
 
-        if (g_arg_pos < 5u) {
+        if (g_sess->arg_pos < 5u) {
             return;
         }
 
-        if (g_state == ParseState::READ_ARGS) {
+        if (g_sess->state == ParseState::READ_ARGS) {
             handle_read_done();
             return;
         }
 
-        if (!command_bounds_ok() || g_cmd_page == 0x03u) {
+        if (!command_bounds_ok() || g_sess->cmd_page == 0x03u) {
             tx_push(kAckErr);
             reset_parser();
             return;
         }
 
-        if (g_cmd_len == 0u) {
+        if (g_sess->cmd_len == 0u) {
             tx_push(kAckOk);
             reset_parser();
             return;
         }
 
-        g_state = ParseState::WRITE_DATA;
-        g_write_pos = 0u;
+        g_sess->state = ParseState::WRITE_DATA;
+        g_sess->write_pos = 0u;
         return;
     }
 
-    if (g_state == ParseState::WRITE_DATA) {
-        uint8_t* ptr = page_ptr(g_cmd_page);
+    if (g_sess->state == ParseState::WRITE_DATA) {
+        uint8_t* ptr = page_ptr(g_sess->cmd_page);
         // FIX-3: guarda defensiva — page_ptr() retorna nullptr para page inválida.
-        // Em teoria g_cmd_page já foi validado em WRITE_ARGS, mas a guarda aqui
+        // Em teoria g_sess->cmd_page já foi validado em WRITE_ARGS, mas a guarda aqui
         // protege contra refatorações futuras que criem caminhos alternativos para
         // WRITE_DATA sem validação prévia.
         if (ptr == nullptr) {
             reset_parser();
             return;
         }
-        ptr[g_cmd_off + g_write_pos] = b;
-        ++g_write_pos;
-        if (g_write_pos >= g_cmd_len) {
+        ptr[g_sess->cmd_off + g_sess->write_pos] = b;
+        ++g_sess->write_pos;
+        if (g_sess->write_pos >= g_sess->cmd_len) {
             handle_write_done();
         }
     }
@@ -433,6 +489,11 @@ void reset_pages() noexcept {
     sync_page_from_table(0x05u);
     sync_page_from_table(0x06u);
     sync_page_from_table(0x07u);
+    ems::engine::table_reaxis_cancel();
+    g_reaxis_burn_deferred = false;
+    g_reaxis_group_unburned = false;
+    g_reaxis_restore_pending = false;
+    g_page0_reload_pending = false;
     sync_page_from_table(0x0Bu);
     g_dirty_page_mask = 0u;
 }
@@ -446,35 +507,46 @@ using namespace ems::app::ui_detail;
 
 void ui_init() noexcept {
     enter_critical();
-    g_rx_head = 0u;
-    g_rx_tail = 0u;
-    g_rx_flag = false;
-    g_tx_head = 0u;
-    g_tx_tail = 0u;
+    for (UiSession& s : g_sessions) {
+        s.rx_head = 0u;
+        s.rx_tail = 0u;
+        s.rx_flag = false;
+        s.tx_head = 0u;
+        s.tx_tail = 0u;
+    }
     exit_critical();
 
     reset_pages();
-    reset_parser();
+    for (UiSession& s : g_sessions) {
+        g_sess = &s;
+        reset_parser();
+    }
+    g_sess = &g_sessions[0];
     ui_update_rt_metrics(0u, 0, 0);
     ui_update_rt_sched_diag(0u, 0u, 0u, 0u, 0u, 0u, 0u);
 }
 
-void ui_rx_byte(uint8_t byte) noexcept {
-    const uint16_t next = static_cast<uint16_t>((g_rx_head + 1u) & kRxMask);
-    if (next != g_rx_tail) {
-        g_rx_buf[g_rx_head] = byte;
-        g_rx_head = next;
-        g_rx_flag = true;
+void ui_rx_byte(UiPort port, uint8_t byte) noexcept {
+    UiSession& s = session_for(port);
+    const uint16_t next = static_cast<uint16_t>((s.rx_head + 1u) & kRxMask);
+    if (next != s.rx_tail) {
+        s.rx_buf[s.rx_head] = byte;
+        s.rx_head = next;
+        s.rx_flag = true;
     }
 }
 
+void ui_rx_byte(uint8_t byte) noexcept {
+    ui_rx_byte(UiPort::kUart, byte);
+}
 
 void ui_uart0_rx_isr_byte(uint8_t byte) noexcept {
-    ui_rx_byte(byte);
+    ui_rx_byte(UiPort::kUart, byte);
 }
 
 void ui_process() noexcept {
-    // Auto-learn: flush VE → flash se pedido e RPM seguro (nunca em alta rotação).
+    // Auto-learn: flush VE → flash se pedido e a flash pode ser escrita
+    // (burn_rpm_safe: RPM baixo até a primeira operação pós-reset concluir).
     if (ems::engine::fuel_ltft_ve_burn_pending() &&
         ems::engine::ltft_apply_burn_ve != 0u &&
         burn_rpm_safe()) {
@@ -483,28 +555,55 @@ void ui_process() noexcept {
             ems::engine::fuel_ltft_ve_burn_clear();
         }
     }
+    reaxis_poll();
 
-    if (!g_rx_flag && g_rx_head == g_rx_tail) {
-        return;
-    }
-
-    uint8_t b = 0u;
-    while (rx_pop(b)) {
-        parse_byte(b);
+    for (UiSession& s : g_sessions) {
+        if (!s.rx_flag && s.rx_head == s.rx_tail) {
+            continue;
+        }
+        g_sess = &s;
+        uint8_t b = 0u;
+        while (rx_pop(b)) {
+            parse_byte(b);
+        }
     }
+    g_sess = &g_sessions[0];
 }
 
-bool ui_tx_pop(uint8_t& byte) noexcept {
-    if (g_tx_head == g_tx_tail) {
+bool ui_tx_pop(UiPort port, uint8_t& byte) noexcept {
+    UiSession& s = session_for(port);
+    if (s.tx_head == s.tx_tail) {
         return false;
     }
-    byte = g_tx_buf[g_tx_tail];
-    g_tx_tail = static_cast<uint16_t>((g_tx_tail + 1u) & kTxMask);
+    byte = s.tx_buf[s.tx_tail];
+    s.tx_tail = static_cast<uint16_t>((s.tx_tail + 1u) & kTxMask);
     return true;
 }
 
+uint16_t ui_tx_pop_bytes(UiPort port, uint8_t* out, uint16_t max) noexcept {
+    UiSession& s = session_for(port);
+    uint16_t n = 0u;
+    uint16_t tail = s.tx_tail;
+    const uint16_t head = s.tx_head;
+    while (n < max && tail != head) {
+        out[n++] = s.tx_buf[tail];
+        tail = static_cast<uint16_t>((tail + 1u) & kTxMask);
+    }
+    s.tx_tail = tail;
+    return n;
+}
+
+uint16_t ui_tx_available(UiPort port) noexcept {
+    const UiSession& s = session_for(port);
+    return static_cast<uint16_t>((s.tx_head - s.tx_tail) & kTxMask);
+}
+
+bool ui_tx_pop(uint8_t& byte) noexcept {
+    return ui_tx_pop(UiPort::kUart, byte);
+}
+
 uint16_t ui_tx_available() noexcept {
-    return static_cast<uint16_t>((g_tx_head - g_tx_tail) & kTxMask);
+    return ui_tx_available(UiPort::kUart);
 }
 
 void ui_update_rt_metrics(uint8_t pw_ms_x10, int8_t advance_deg, int8_t stft_p100,
@@ -547,6 +646,12 @@ void ui_update_rt_map_fuel(uint16_t map_fused_bar_x100, uint32_t net_pw_us) noex
     g_rt_net_pw_us = net_pw_us > 65535u ? 65535u : static_cast<uint16_t>(net_pw_us);
 }
 
+bool ui_take_page0_reload() noexcept {
+    const bool pending = g_page0_reload_pending;
+    g_page0_reload_pending = false;
+    return pending;
+}
+
 #if defined(EMS_HOST_TEST)
 void ui_test_reset() noexcept {
     ui_init();
@@ -36,9 +36,20 @@ struct UiRealtimeData {
 
 static_assert(sizeof(UiRealtimeData) == 86u, "UiRealtimeData must be 86 bytes");
 
+// Transporte de uma sessão de protocolo. Cada porta tem parser, deteção de
+// envelope e rings RX/TX próprios — o USB drena ao ritmo do USB enquanto um
+// logger na UART corre em paralelo.
+enum class UiPort : uint8_t {
+    kUart = 0u,
+    kUsb  = 1u,
+};
+constexpr uint8_t kUiPortCount = 2u;
+
 void ui_init() noexcept;
-void ui_rx_byte(uint8_t byte) noexcept;
+void ui_rx_byte(UiPort port, uint8_t byte) noexcept;
+void ui_rx_byte(uint8_t byte) noexcept;            // compat: sessão UART
 void ui_uart0_rx_isr_byte(uint8_t byte) noexcept;  // compat wrapper
+// Processa o RX pendente de todas as sessões (main loop).
 void ui_process() noexcept;
 void ui_update_rt_metrics(uint8_t pw_ms_x10, int8_t advance_deg, int8_t stft_p100,
                           uint8_t lambda_target_d4 = 0u, int8_t ltft_pct = 0) noexcept;
@@ -60,8 +71,17 @@ void ui_set_rev_limit_active(bool active) noexcept;
 /// cálculo de combustível — chamado a cada iteração, independente de sync.
 void ui_update_rt_map_fuel(uint16_t map_fused_bar_x100, uint32_t net_pw_us) noexcept;
 
-bool ui_tx_pop(uint8_t& byte) noexcept;
-uint16_t ui_tx_available() noexcept;
+bool ui_tx_pop(UiPort port, uint8_t& byte) noexcept;
+// Drena até max bytes do TX da sessão; devolve quantos copiou.
+uint16_t ui_tx_pop_bytes(UiPort port, uint8_t* out, uint16_t max) noexcept;
+uint16_t ui_tx_available(UiPort port) noexcept;
+bool ui_tx_pop(uint8_t& byte) noexcept;   // compat: sessão UART
+uint16_t ui_tx_available() noexcept;      // compat: sessão UART
+
+// Rollback do page0 concluído na flash: a cópia activa voltou à anterior e o
+// main tem de recarregar a sua imagem do page0 e re-aplicar os globals
+// derivados. Lê e limpa (main loop).
+bool ui_take_page0_reload() noexcept;
 
 #if defined(EMS_HOST_TEST)
 void ui_test_reset() noexcept;
@@ -34,7 +34,7 @@ namespace ems::app::ui_detail {
 
 uint16_t tx_free() noexcept {
     return static_cast<uint16_t>((kTxSize - 1u) -
-                                 ((g_tx_head - g_tx_tail) & kTxMask));
+                                 ((g_sess->tx_head - g_sess->tx_tail) & kTxMask));
 }
 
 void env_send_response(uint8_t code, const uint8_t* data, uint16_t len) noexcept {
@@ -80,6 +80,9 @@ int env_try_write(const uint8_t* a, uint16_t data_n) noexcept {
     }
     if (len != 0u) {
         std::memcpy(ptr + off, a + 5u, len);
+        if (page_write_unchanged(page)) {
+            return kTsRcOk;
+        }
         if (!sync_table_from_page(page)) {
             sync_page_from_table(page);
             return kTsRcRangeErr;
@@ -185,6 +188,21 @@ void env_dispatch(const uint8_t* p, uint16_t n) noexcept {
                           nullptr, 0u);
         return;
     }
+    if (cmd == static_cast<uint8_t>('U')) {
+        // 'U' [canId] page → rollback para o burn anterior (ver parse_byte).
+        if (n != 2u && n != 3u) {
+            env_send_response(kTsRcRangeErr, nullptr, 0u);
+            return;
+        }
+        const uint8_t page = normalize_page_id(p[n - 1u]);
+        if (!burn_rpm_safe()) {
+            env_send_response(kTsRcBusyErr, nullptr, 0u);
+            return;
+        }
+        env_send_response(rollback_page_in_flash(page) ? kTsRcOk : kTsRcRangeErr,
+                          nullptr, 0u);
+        return;
+    }
     env_send_response(kTsRcUnknown, nullptr, 0u);
 }
 
@@ -35,6 +35,7 @@ enum class ParseState : uint8_t {
     BURN_ARGS = 4u,
     BENCH_ARG = 5u,
     TEST_ARGS = 9u,
+    ROLLBACK_ARGS = 10u,
     ENV_SIZE_LO = 6u,
     ENV_PAYLOAD = 7u,
     ENV_CRC = 8u,
@@ -67,21 +68,6 @@ extern uint8_t g_page10_ltft[ems::engine::kTableCells +
 extern uint8_t g_page11_axes[4u * ems::engine::kTableAxisSize];
 extern uint8_t g_page12_ltft_accum[ems::engine::kLtftAccumPageSize];
 
-extern uint8_t g_env_buf[kEnvMaxPayload];
-extern uint16_t g_env_size;
-extern uint16_t g_env_pos;
-extern uint32_t g_env_rx_crc;
-extern uint8_t  g_env_crc_pos;
-
-extern volatile uint8_t g_rx_buf[kRxSize];
-extern volatile uint16_t g_rx_head;
-extern volatile uint16_t g_rx_tail;
-extern volatile bool g_rx_flag;
-
-extern volatile uint8_t g_tx_buf[kTxSize];
-extern volatile uint16_t g_tx_head;
-extern volatile uint16_t g_tx_tail;
-
 extern uint8_t  g_rt_pw_ms_x10;
 extern int8_t   g_rt_advance_deg;
 extern int8_t   g_rt_stft_p100;
@@ -100,15 +86,53 @@ extern bool     g_rt_rev_limit_active;
 extern uint32_t g_rt_loop2ms_last_us;
 extern uint32_t g_rt_loop2ms_max_us;
 
-extern ParseState g_state;
-extern uint8_t g_cmd_page;
-extern uint16_t g_cmd_off;
-extern uint16_t g_cmd_len;
-extern uint8_t g_arg_pos;
-extern uint8_t g_test_args[4];
-extern uint16_t g_write_pos;
-extern bool g_write_ram_only;
+// ── Sessões ─────────────────────────────────────────────────────────────────
+// Uma sessão por transporte (UiPort): rings RX/TX, estado do parser e buffer
+// de envelope próprios — UART e USB falam com tuners/loggers distintos ao
+// mesmo tempo, cada um ao ritmo do seu transporte. Páginas, dirty mask e
+// burns são partilhados (o main loop processa um comando inteiro de cada vez).
+struct UiSession {
+    volatile uint8_t  rx_buf[kRxSize];
+    volatile uint16_t rx_head;
+    volatile uint16_t rx_tail;
+    volatile bool     rx_flag;
+
+    volatile uint8_t  tx_buf[kTxSize];
+    volatile uint16_t tx_head;
+    volatile uint16_t tx_tail;
+
+    ParseState state;
+    uint8_t  cmd_page;
+    uint16_t cmd_off;
+    uint16_t cmd_len;
+    uint8_t  arg_pos;
+    uint8_t  test_args[4];  // 'T': subcmd, arg1, arg2_lo, arg2_hi
+    uint16_t write_pos;
+    bool     write_ram_only;
+
+    uint8_t  env_buf[kEnvMaxPayload];
+    uint16_t env_size;
+    uint16_t env_pos;
+    uint32_t env_rx_crc;
+    uint8_t  env_crc_pos;
+};
+
+extern UiSession g_sessions[kUiPortCount];
+// Sessão cujo RX está a ser processado — destino de tx_push e dono do
+// estado do parser durante ui_process(). Fora disso aponta para a UART.
+extern UiSession* g_sess;
+
+UiSession& session_for(UiPort port) noexcept;
+
 extern uint16_t g_dirty_page_mask;
+// Re-eixo: burn da página 11 pedido com o job por publicar; grupo
+// {1, 2, 4, 11} re-amostrado em RAM ainda por gravar junto.
+extern bool g_reaxis_burn_deferred;
+extern bool g_reaxis_group_unburned;
+// Rollback da página 11 à espera do job que re-amostra só os mapas
+// aprendidos; as tabelas do grupo voltam da flash no commit.
+extern bool g_reaxis_restore_pending;
+extern bool g_page0_reload_pending;   // rollback do page0 concluído (ver ui_take_page0_reload)
 
 // ── Helpers / commands ──────────────────────────────────────────────────────
 void enter_critical() noexcept;
@@ -130,8 +154,15 @@ void sync_page_from_table(uint8_t page) noexcept;
 bool sync_table_from_page(uint8_t page) noexcept;
 uint16_t editable_page_bit(uint8_t page) noexcept;
 void mark_page_dirty(uint8_t page) noexcept;
+// Re-envio de uma tabela (VE/avanço) igual à viva numa página limpa: o
+// write não tem nada a aplicar, marcar dirty nem regravar.
+bool page_write_unchanged(uint8_t page) noexcept;
 void clear_page_dirty(uint8_t page) noexcept;
 bool burn_page_to_flash(uint8_t page) noexcept;
+bool reaxis_group_page(uint8_t page) noexcept;
+bool burn_reaxis_group() noexcept;
+void reaxis_poll() noexcept;
+bool rollback_page_in_flash(uint8_t page) noexcept;
 void handle_read_done() noexcept;
 void handle_write_done() noexcept;
 uint16_t tx_free() noexcept;
@@ -14,7 +14,9 @@
 #include "engine/calibration.h"
 #include "engine/ecu_sched.h"
 #include "engine/etb_control.h"
+#include "engine/etb_loop.h"
 #include "engine/fuel_calc.h"
+#include "engine/fuel_pw_kernel.h"
 #include "engine/torque_manager.h"
 #include "engine/map_estimator.h"
 #include "app/status_bits.h"
@@ -24,8 +26,11 @@
 #include "hal/timer.h"
 #include "engine/constants.h"
 #include "engine/table3d.h"
+#include "engine/table_ops.h"
+#include "engine/table_reaxis.h"
 #include "hal/crc32.h"
 #include "hal/flash.h"
+#include "hal/flash_jobs.h"
 #include "engine/engine_config.h"
 
 namespace ems::app::ui_detail {
@@ -42,6 +47,15 @@ void exit_critical() noexcept {
 #endif
 }
 
+// Trim por cilindro no page0: cil 0–3 em 56-59 (fuel) / 60-63 (ign);
+// cil 4–7 (só builds 5–8 cil) em 262-265 / 266-269.
+static constexpr uint16_t page0_fuel_trim_off(uint8_t cyl) noexcept {
+    return (cyl < 4u) ? static_cast<uint16_t>(56u + cyl) : static_cast<uint16_t>(258u + cyl);
+}
+static constexpr uint16_t page0_ign_trim_off(uint8_t cyl) noexcept {
+    return (cyl < 4u) ? static_cast<uint16_t>(60u + cyl) : static_cast<uint16_t>(262u + cyl);
+}
+
 uint16_t page_size(uint8_t page) noexcept {
     if (page == 0x00u) { return 512u; }
     if (page == 0x04u) { return static_cast<uint16_t>(sizeof(g_page4_lambda)); }
@@ -87,11 +101,11 @@ uint8_t normalize_page_id(uint8_t page) noexcept {
 
 bool tx_push(uint8_t byte) noexcept {
     enter_critical();
-    const uint16_t next = static_cast<uint16_t>((g_tx_head + 1u) & kTxMask);
+    const uint16_t next = static_cast<uint16_t>((g_sess->tx_head + 1u) & kTxMask);
     bool ok = false;
-    if (next != g_tx_tail) {
-        g_tx_buf[g_tx_head] = byte;
-        g_tx_head = next;
+    if (next != g_sess->tx_tail) {
+        g_sess->tx_buf[g_sess->tx_head] = byte;
+        g_sess->tx_head = next;
         ok = true;
     }
     exit_critical();
@@ -109,12 +123,12 @@ void tx_push_bytes(const uint8_t* ptr, uint16_t len) noexcept {
 bool rx_pop(uint8_t& byte) noexcept {
     bool ok = false;
     enter_critical();
-    if (g_rx_head != g_rx_tail) {
-        byte = g_rx_buf[g_rx_tail];
-        g_rx_tail = static_cast<uint16_t>((g_rx_tail + 1u) & kRxMask);
+    if (g_sess->rx_head != g_sess->rx_tail) {
+        byte = g_sess->rx_buf[g_sess->rx_tail];
+        g_sess->rx_tail = static_cast<uint16_t>((g_sess->rx_tail + 1u) & kRxMask);
         ok = true;
     } else {
-        g_rx_flag = false;
+        g_sess->rx_flag = false;
     }
     exit_critical();
     return ok;
@@ -191,6 +205,9 @@ void update_realtime_page() noexcept {
     if (tc_red > 0u) {
         status = static_cast<uint16_t>(status | ems::app::STATUS_TC_ACTIVE);
     }
+    if (ems::engine::etb_loop_fault()) {
+        status = static_cast<uint16_t>(status | ems::app::STATUS_ETB_LIMP);
+    }
     if (ems::drv::sensors_is_bench_mode()) {
         status = static_cast<uint16_t>(status | ems::app::STATUS_BENCH_MODE);
     }
@@ -265,17 +282,17 @@ void update_realtime_page() noexcept {
 }
 
 void reset_parser() noexcept {
-    g_state = ParseState::IDLE;
-    g_cmd_page = 0u;
-    g_cmd_off = 0u;
-    g_cmd_len = 0u;
-    g_arg_pos = 0u;
-    g_write_pos = 0u;
-    g_write_ram_only = false;
-    g_env_size = 0u;
-    g_env_pos = 0u;
-    g_env_rx_crc = 0u;
-    g_env_crc_pos = 0u;
+    g_sess->state = ParseState::IDLE;
+    g_sess->cmd_page = 0u;
+    g_sess->cmd_off = 0u;
+    g_sess->cmd_len = 0u;
+    g_sess->arg_pos = 0u;
+    g_sess->write_pos = 0u;
+    g_sess->write_ram_only = false;
+    g_sess->env_size = 0u;
+    g_sess->env_pos = 0u;
+    g_sess->env_rx_crc = 0u;
+    g_sess->env_crc_pos = 0u;
 }
 
 // ── Teste de saídas ('T') ───────────────────────────────────────────────────
@@ -283,10 +300,10 @@ void reset_parser() noexcept {
 // excepto STATUS (0x03) → 4 bytes {active, abort_reason, keepalive_s, busy}.
 
 void handle_test_cmd() noexcept {
-    const uint8_t sub  = g_test_args[0];
-    const uint8_t a1   = g_test_args[1];
-    const uint16_t a2  = static_cast<uint16_t>(g_test_args[2] |
-                         (static_cast<uint16_t>(g_test_args[3]) << 8u));
+    const uint8_t sub  = g_sess->test_args[0];
+    const uint8_t a1   = g_sess->test_args[1];
+    const uint16_t a2  = static_cast<uint16_t>(g_sess->test_args[2] |
+                         (static_cast<uint16_t>(g_sess->test_args[3]) << 8u));
     bool ok = false;
     switch (sub) {
         case 0x00u:  // EXIT
@@ -333,13 +350,15 @@ bool bounds_ok(uint8_t page, uint16_t off, uint16_t len) noexcept {
 }
 
 bool command_bounds_ok() noexcept {
-    return bounds_ok(g_cmd_page, g_cmd_off, g_cmd_len);
+    return bounds_ok(g_sess->cmd_page, g_sess->cmd_off, g_sess->cmd_len);
 }
 
-// Burn de Flash só com motor parado/lento (errata ES0565: erase/program pode
-// congelar fetch por ~120 µs — inaceitável durante janela de CKP/scheduler).
+// Errata ES0565: a primeira operação erase/program após o reset pode congelar
+// o fetch por ~120 µs — inaceitável durante janela de CKP/scheduler. Até essa
+// operação concluir, burn só com motor parado/lento; depois, a qualquer RPM.
 bool burn_rpm_safe() noexcept {
-    return ems::drv::ckp_snapshot().rpm_x10 <= ems::engine::kFlashWriteSafeRpmX10;
+    return ems::hal::flash_jobs_primed() ||
+           ems::drv::ckp_snapshot().rpm_x10 <= ems::engine::kFlashWriteSafeRpmX10;
 }
 
 void sync_page_from_table(uint8_t page) noexcept {
@@ -350,9 +369,11 @@ void sync_page_from_table(uint8_t page) noexcept {
         g_page0[0] = 0u;
         // Bytes 16-55: calibração de sensores APP/ETB/TPS + plausibilidade
         ems::engine::sync_etb_calibration_to_page(g_page0 + 16, 40u);
-        // Bytes 56-63: trim de combustível e ignição por cilindro (int8 × 4 cada)
-        std::memcpy(g_page0 + 56, ems::engine::cyl_fuel_trim_pct, 4u);
-        std::memcpy(g_page0 + 60, ems::engine::cyl_ign_trim_deg,  4u);
+        // Bytes 56-63 (+262-269 p/ cil 5-8): trim de combustível e ignição por cilindro
+        for (uint8_t c = 0u; c < ems::engine::cfg::kCylinderCount; ++c) {
+            g_page0[page0_fuel_trim_off(c)] = static_cast<uint8_t>(ems::engine::cyl_fuel_trim_pct[c]);
+            g_page0[page0_ign_trim_off(c)]  = static_cast<uint8_t>(ems::engine::cyl_ign_trim_deg[c]);
+        }
         // Bytes 64-65: janela de dente CMP
         g_page0[64] = ems::engine::cmp_window_open_tooth;
         g_page0[65] = ems::engine::cmp_window_close_tooth;
@@ -425,7 +446,7 @@ void sync_page_from_table(uint8_t page) noexcept {
         ems::app::can_rx_map_serialize_to_page0(g_page0, sizeof(g_page0));
         // MAP janela angular por cilindro (246-251)
         g_page0[246] = ems::engine::map_window_enable;
-        g_page0[247] = 0u;  // pad
+        g_page0[247] = ems::engine::map_balance_gain_pct;
         std::memcpy(g_page0 + 248, &ems::engine::map_window_open_deg, 2u);
         std::memcpy(g_page0 + 250, &ems::engine::map_window_len_deg,  2u);
         // Duty INJ + gates DFCO + knock morto (252-257)
@@ -434,6 +455,27 @@ void sync_page_from_table(uint8_t page) noexcept {
         std::memcpy(g_page0 + 254, &ems::engine::decel_cut_map_max_bar_x100, 2u);
         g_page0[256] = ems::engine::decel_cut_gear_inhibit_ms10;
         g_page0[257] = ems::engine::knock_dead_min_p2p;
+        // Telemetria CAN FD por ciclo (258)
+        g_page0[258] = ems::engine::can_fd_telemetry_enable;
+        // Knock DSP em banda (259-261)
+        g_page0[259] = ems::engine::knock_intensity_thr_x10;
+        std::memcpy(g_page0 + 260, &ems::engine::knock_band_hz, 2u);
+        // Predição de MAP ao IVC (270-272)
+        g_page0[270] = ems::engine::map_pred_gain_pct;
+        std::memcpy(g_page0 + 271, &ems::engine::map_pred_ivc_btdc_deg, 2u);
+        // Malha de posição ETB na ISR do TIM7 (273-274)
+        std::memcpy(g_page0 + 273, &ems::engine::etb_loop_rate_hz, 2u);
+        // Mapa aprendido de knock (275-276)
+        g_page0[275] = ems::engine::knock_learn_step_x10;
+        g_page0[276] = ems::engine::knock_learn_max_x10;
+        // Misfire por cinemática da cambota (277-310)
+        g_page0[277] = ems::engine::misfire_accel_enable;
+        g_page0[278] = ems::engine::misfire_rough_ratio_pct;
+        std::memcpy(g_page0 + 279, ems::engine::misfire_thr_rad_s2,
+                    sizeof(ems::engine::misfire_thr_rad_s2));
+        g_page0[311] = ems::engine::tooth_geom_enable;
+        std::memcpy(g_page0 + 312, ems::engine::diag_freeze_vars,
+                    sizeof(ems::engine::diag_freeze_vars));
     } else if (page == 0x01u) {
         std::memcpy(g_page1_ve, ems::engine::ve_table, sizeof(g_page1_ve));
     } else if (page == 0x02u) {
@@ -514,7 +556,10 @@ void sync_page_from_table(uint8_t page) noexcept {
     } else if (page == 0x0Bu) {
         uint16_t rpm[ems::engine::kTableAxisSize];
         uint16_t load[ems::engine::kTableAxisSize];
-        ems::engine::table_axes_get(rpm, load);
+        // Re-eixo por publicar: o tuner lê o que escreveu, não a grelha velha.
+        if (!ems::engine::table_reaxis_target_get(rpm, load)) {
+            ems::engine::table_axes_get(rpm, load);
+        }
         constexpr uint16_t kAxisBytes = 2u * ems::engine::kTableAxisSize;
         std::memcpy(g_page11_axes + 0,          rpm,  kAxisBytes);
         std::memcpy(g_page11_axes + kAxisBytes, load, kAxisBytes);
@@ -525,6 +570,36 @@ void sync_page_from_table(uint8_t page) noexcept {
     }
 }
 
+// Diff página ↔ tabela viva da última aplicação (bit i = célula i mudou).
+static uint8_t g_table_diff_bits[(ems::engine::kTableCells + 7u) / 8u] = {};
+
+// Tabela de bytes (VE, avanço) de uma página: só as células que o tuner
+// mudou são escritas — um 'w' em chunks reenvia a página toda.
+static void apply_table_page(uint8_t* table, const uint8_t* page) noexcept {
+    using namespace ems::engine;
+    if (table_ops_diff_u8(page, table, kTableCells, g_table_diff_bits) != 0u) {
+        table_ops_copy_masked_u8(table, page, g_table_diff_bits, kTableCells);
+    }
+}
+
+// Página de tabela de bytes já igual aos globals (só VE e avanço; as
+// restantes contam sempre como mudadas).
+static bool table_page_matches(uint8_t page) noexcept {
+    using namespace ems::engine;
+    if (page == 0x01u) {
+        return table_ops_diff_u8(g_page1_ve, &ve_table[0][0], kTableCells, nullptr) == 0u;
+    }
+    if (page == 0x02u) {
+        return table_ops_diff_u8(g_page2_spark, reinterpret_cast<const uint8_t*>(&spark_table[0][0]),
+                                 kTableCells, nullptr) == 0u;
+    }
+    return false;
+}
+
+bool page_write_unchanged(uint8_t page) noexcept {
+    return (g_dirty_page_mask & editable_page_bit(page)) == 0u && table_page_matches(page);
+}
+
 // Aplica o buffer da página aos globals do engine. Retorna false se a página
 // tiver validação própria e o conteúdo for rejeitado (buffer fica incoerente —
 // caller deve restaurar com sync_page_from_table()).
@@ -541,9 +616,9 @@ bool sync_table_from_page(uint8_t page) noexcept {
         ems::engine::apply_etb_calibration_from_page(g_page0 + 16, 40u);
         ems::engine::push_sensor_calibration_to_drivers();
         // Trim por cilindro e janela CMP (bytes 56-65)
-        std::memcpy(ems::engine::cyl_fuel_trim_pct, g_page0 + 56, 4u);
-        std::memcpy(ems::engine::cyl_ign_trim_deg,  g_page0 + 60, 4u);
-        for (uint8_t i = 0u; i < 4u; ++i) {
+        for (uint8_t i = 0u; i < ems::engine::cfg::kCylinderCount; ++i) {
+            ems::engine::cyl_fuel_trim_pct[i] = static_cast<int8_t>(g_page0[page0_fuel_trim_off(i)]);
+            ems::engine::cyl_ign_trim_deg[i]  = static_cast<int8_t>(g_page0[page0_ign_trim_off(i)]);
             int8_t& ft = ems::engine::cyl_fuel_trim_pct[i];
             if (ft > 50) { ft = 50; } else if (ft < -50) { ft = -50; }
             int8_t& it = ems::engine::cyl_ign_trim_deg[i];
@@ -684,6 +759,8 @@ bool sync_table_from_page(uint8_t page) noexcept {
             // MAP janela angular (246-251). Blob antigo = zeros → fica off e
             // len mantém o default (0 nunca substitui — janela vazia inútil).
             ems::engine::map_window_enable = (g_page0[246] != 0u) ? 1u : 0u;
+            ems::engine::map_balance_gain_pct =
+                (g_page0[247] > 100u) ? 100u : g_page0[247];
             std::memcpy(&ems::engine::map_window_open_deg, g_page0 + 248, 2u);
             if (ems::engine::map_window_open_deg >= 720u) {
                 ems::engine::map_window_open_deg =
@@ -704,12 +781,40 @@ bool sync_table_from_page(uint8_t page) noexcept {
                         g_page0 + 254, 2u);
             ems::engine::decel_cut_gear_inhibit_ms10 = g_page0[256];
             ems::engine::knock_dead_min_p2p = g_page0[257];
+            ems::engine::can_fd_telemetry_enable = (g_page0[258] != 0u) ? 1u : 0u;
+            ems::engine::knock_intensity_thr_x10 = g_page0[259];
+            std::memcpy(&ems::engine::knock_band_hz, g_page0 + 260, 2u);
+            // Predição de MAP ao IVC (270-272); ivc=0 mantém o default
+            ems::engine::map_pred_gain_pct =
+                (g_page0[270] > 100u) ? 100u : g_page0[270];
+            uint16_t ivc = 0u;
+            std::memcpy(&ivc, g_page0 + 271, 2u);
+            if (ivc != 0u) {
+                ems::engine::map_pred_ivc_btdc_deg = (ivc > 719u) ? 719u : ivc;
+            }
+            // Malha ETB (273-274); 0 = PID no main loop. O main loop
+            // re-arranca a malha quando a taxa muda.
+            std::memcpy(&ems::engine::etb_loop_rate_hz, g_page0 + 273, 2u);
+            // Mapa aprendido de knock (275-276); 0 = desligado / tecto 6°
+            ems::engine::knock_learn_step_x10 = g_page0[275];
+            ems::engine::knock_learn_max_x10 =
+                (g_page0[276] > 127u) ? 127u : g_page0[276];
+            // Misfire por cinemática (277-310); 0 = legado / defaults
+            ems::engine::misfire_accel_enable = (g_page0[277] != 0u) ? 1u : 0u;
+            ems::engine::misfire_rough_ratio_pct = g_page0[278];
+            std::memcpy(ems::engine::misfire_thr_rad_s2, g_page0 + 279,
+                        sizeof(ems::engine::misfire_thr_rad_s2));
+            // Geometria por dente do CKP (311); 0 = roda nominal
+            ems::engine::tooth_geom_enable = (g_page0[311] != 0u) ? 1u : 0u;
+            // Freeze frame dos DTCs (312-319); tudo 0 = conjunto default
+            std::memcpy(ems::engine::diag_freeze_vars, g_page0 + 312,
+                        sizeof(ems::engine::diag_freeze_vars));
         }
         etb_apply_idle_calibration();
     } else if (page == 0x01u) {
-        std::memcpy(ems::engine::ve_table, g_page1_ve, sizeof(g_page1_ve));
+        apply_table_page(&ems::engine::ve_table[0][0], g_page1_ve);
     } else if (page == 0x02u) {
-        std::memcpy(ems::engine::spark_table, g_page2_spark, sizeof(g_page2_spark));
+        apply_table_page(reinterpret_cast<uint8_t*>(&ems::engine::spark_table[0][0]), g_page2_spark);
     } else if (page == 0x04u) {
         std::memcpy(ems::engine::lambda_target_table_x1000, g_page4_lambda, sizeof(g_page4_lambda));
     } else if (page == 0x05u) {
@@ -755,6 +860,7 @@ bool sync_table_from_page(uint8_t page) noexcept {
         std::memcpy(&ems::engine::crank_prime_max_pw_us, p + 74, 2u);
         std::memcpy(&ems::engine::inj_small_pulse_break_us, p + 76, 2u);
         ems::engine::inj_small_pulse_rate_q8 = p[78];
+        ems::engine::fuel_pw_kernel_invalidate();  // 2-slope em recíproco
     } else if (page == 0x07u) {
         const uint8_t* p = g_page7_dwell2d;
         std::memcpy(ems::engine::dwell_rpm_axis_rpm,  p + 0,  8u);
@@ -771,7 +877,11 @@ bool sync_table_from_page(uint8_t page) noexcept {
         constexpr uint16_t kAxisBytes = 2u * ems::engine::kTableAxisSize;
         std::memcpy(rpm,  g_page11_axes + 0,          kAxisBytes);
         std::memcpy(load, g_page11_axes + kAxisBytes, kAxisBytes);
-        return ems::engine::table_axes_set(rpm, load);
+        // Job de fundo: tabelas re-amostradas e eixos publicados juntos.
+        // Substitui um restauro de rollback ainda por publicar.
+        if (!ems::engine::table_reaxis_request(rpm, load)) { return false; }
+        g_reaxis_restore_pending = false;
+        return true;
     }
     return true;
 }
@@ -797,73 +907,222 @@ void clear_page_dirty(uint8_t page) noexcept {
     g_dirty_page_mask = static_cast<uint16_t>(g_dirty_page_mask & static_cast<uint16_t>(~editable_page_bit(page)));
 }
 
+// Resultado do job de burn (fila de flash, main loop). A página já saiu de
+// dirty no submit; falha de erase/program/verify repõe o bit para o tuner
+// ver ('d') e voltar a gravar.
+void burn_done(void* ctx, bool ok) noexcept {
+    if (ok) { return; }
+    mark_page_dirty(static_cast<uint8_t>(reinterpret_cast<uintptr_t>(ctx)));
+}
+
+// Enfileira o burn (dados copiados no submit). Edições posteriores voltam a
+// marcar dirty e não são apagadas pelo callback.
+bool queue_burn(uint8_t page, uint8_t slot, const uint8_t* data, uint16_t len) noexcept {
+    void* const ctx = reinterpret_cast<void*>(static_cast<uintptr_t>(page));
+    if (!ems::hal::nvm_queue_calibration(slot, data, len, burn_done, ctx)) {
+        return false;
+    }
+    clear_page_dirty(page);
+    return true;
+}
+
+// Página TS → slot NVM (ver burn_page_to_flash). 0xFF = página sem NVM.
+uint8_t nvm_slot_for_page(uint8_t page) noexcept {
+    switch (page) {
+        case 0x00u: return 0u;
+        case 0x01u: return 1u;
+        case 0x02u: return 2u;
+        case 0x04u: return 3u;
+        case 0x05u: return 4u;
+        case 0x06u: return 5u;
+        case 0x07u: return 6u;
+        case 0x08u: return 7u;
+        case 0x09u: return 8u;
+        case 0x0Bu: return 9u;
+        default:    return 0xFFu;
+    }
+}
+
+// Eixos e as tabelas re-amostradas para eles só fazem sentido juntos em
+// flash: a página 11 grava sempre o grupo, e depois de um commit de re-eixo
+// gravar qualquer página do grupo grava as quatro.
+bool reaxis_group_page(uint8_t page) noexcept {
+    return page == 0x01u || page == 0x02u || page == 0x04u || page == 0x0Bu;
+}
+
+// Grupo gravado como uma unidade (hal/cal_store.h): uma falha em qualquer
+// membro deixa a flash no grupo anterior — as quatro voltam a dirty.
+void reaxis_group_done(void*, bool ok) noexcept {
+    if (ok) { return; }
+    mark_page_dirty(0x01u);
+    mark_page_dirty(0x02u);
+    mark_page_dirty(0x04u);
+    mark_page_dirty(0x0Bu);
+    g_reaxis_group_unburned = true;
+}
+
+bool burn_reaxis_group() noexcept {
+    sync_page_from_table(0x01u);
+    sync_page_from_table(0x02u);
+    sync_page_from_table(0x04u);
+    sync_page_from_table(0x0Bu);  // serializa eixos atuais → buffer
+    const ems::hal::CalGroupMember members[] = {
+        {1u, g_page1_ve,     static_cast<uint16_t>(sizeof(g_page1_ve))},
+        {2u, g_page2_spark,  static_cast<uint16_t>(sizeof(g_page2_spark))},
+        {3u, g_page4_lambda, static_cast<uint16_t>(sizeof(g_page4_lambda))},
+        {ems::hal::kNvmCalSlotAxes, g_page11_axes, static_cast<uint16_t>(sizeof(g_page11_axes))},
+    };
+    if (!ems::hal::nvm_queue_calibration_group(
+            members, static_cast<uint8_t>(sizeof(members) / sizeof(members[0])),
+            reaxis_group_done, nullptr)) {
+        return false;
+    }
+    clear_page_dirty(0x01u);
+    clear_page_dirty(0x02u);
+    clear_page_dirty(0x04u);
+    clear_page_dirty(0x0Bu);
+    g_reaxis_group_unburned = false;
+    return true;
+}
+
+// Tabelas do grupo repostas da flash (cópias ligadas aos eixos activos):
+// eixos já publicados pelo job, nada fica dirty.
+void restore_reaxis_group() noexcept {
+    static constexpr uint8_t kTables[] = {0x01u, 0x02u, 0x04u};
+    for (const uint8_t page : kTables) {
+        if (ems::hal::nvm_load_calibration(nvm_slot_for_page(page), page_ptr(page),
+                                           page_size(page))) {
+            (void)sync_table_from_page(page);
+        }
+        clear_page_dirty(page);
+    }
+    sync_page_from_table(0x0Bu);
+    clear_page_dirty(0x0Bu);
+    g_reaxis_group_unburned = false;
+}
+
+void reaxis_poll() noexcept {
+    if (!ems::engine::table_reaxis_process(ems::engine::kReaxisRowsPerCall)) {
+        return;
+    }
+    if (g_reaxis_restore_pending) {
+        g_reaxis_restore_pending = false;
+        g_reaxis_burn_deferred = false;
+        restore_reaxis_group();
+        return;
+    }
+    mark_page_dirty(0x01u);
+    mark_page_dirty(0x02u);
+    mark_page_dirty(0x04u);
+    mark_page_dirty(0x0Bu);
+    g_reaxis_group_unburned = true;
+    // Burn da página 11 pedido durante o job: grava o grupo agora; se a
+    // flash ainda não pode ser escrita (burn_rpm_safe) fica dirty para o
+    // tuner voltar a gravar.
+    if (g_reaxis_burn_deferred) {
+        g_reaxis_burn_deferred = false;
+        if (burn_rpm_safe()) { (void)burn_reaxis_group(); }
+    }
+}
+
 bool burn_page_to_flash(uint8_t page) noexcept {
+    // Restauro de rollback a meio: a RAM ainda não está nos eixos da flash.
+    if (g_reaxis_restore_pending && reaxis_group_page(page)) {
+        return false;
+    }
+    if (page == 0x0Bu && ems::engine::table_reaxis_pending()) {
+        g_reaxis_burn_deferred = true;
+        return true;
+    }
+    if (page == 0x0Bu || (g_reaxis_group_unburned && reaxis_group_page(page))) {
+        return burn_reaxis_group();
+    }
     if (page == 0x00u) {
         // Serializa g_eng_cfg → g_page0[2-15] e guarda o slot NVM 0 completo.
         ems::engine::cfg::engine_config_serialize(g_page0, 16u);
         g_page0[ems::engine::kCalLayoutVersionOffset] = ems::engine::kCalLayoutVersion;
-        const bool ok = ems::hal::nvm_save_calibration(0u, g_page0,
-                                            static_cast<uint16_t>(sizeof(g_page0)));
-        if (!ok) { return false; }
-        clear_page_dirty(page);
-        return true;
+        return queue_burn(page, 0u, g_page0, static_cast<uint16_t>(sizeof(g_page0)));
     }
     if (page == 0x01u) {
-        const bool ok = ems::hal::nvm_save_calibration(1u, g_page1_ve, static_cast<uint16_t>(sizeof(g_page1_ve)));
-        if (!ok) { return false; }
-        clear_page_dirty(page);
-        return true;
+        return queue_burn(page, 1u, g_page1_ve, static_cast<uint16_t>(sizeof(g_page1_ve)));
     }
     if (page == 0x02u) {
-        const bool ok = ems::hal::nvm_save_calibration(2u, g_page2_spark, static_cast<uint16_t>(sizeof(g_page2_spark)));
-        if (!ok) { return false; }
-        clear_page_dirty(page);
-        return true;
+        return queue_burn(page, 2u, g_page2_spark, static_cast<uint16_t>(sizeof(g_page2_spark)));
     }
     if (page == 0x04u) {
-        const bool ok = ems::hal::nvm_save_calibration(3u, g_page4_lambda, sizeof(g_page4_lambda));
-        if (!ok) { return false; }
-        clear_page_dirty(page);
-        return true;
+        return queue_burn(page, 3u, g_page4_lambda, static_cast<uint16_t>(sizeof(g_page4_lambda)));
     }
     if (page == 0x05u) {
-        const bool ok = ems::hal::nvm_save_calibration(4u, g_page5_corr, static_cast<uint16_t>(sizeof(g_page5_corr)));
-        if (!ok) { return false; }
-        clear_page_dirty(page);
-        return true;
+        return queue_burn(page, 4u, g_page5_corr, static_cast<uint16_t>(sizeof(g_page5_corr)));
     }
     if (page == 0x06u) {
-        const bool ok = ems::hal::nvm_save_calibration(5u, g_page6_xtau, static_cast<uint16_t>(sizeof(g_page6_xtau)));
-        if (!ok) { return false; }
-        clear_page_dirty(page);
-        return true;
+        return queue_burn(page, 5u, g_page6_xtau, static_cast<uint16_t>(sizeof(g_page6_xtau)));
     }
     if (page == 0x07u) {
-        const bool ok = ems::hal::nvm_save_calibration(6u, g_page7_dwell2d, static_cast<uint16_t>(sizeof(g_page7_dwell2d)));
-        if (!ok) { return false; }
-        clear_page_dirty(page);
-        return true;
+        return queue_burn(page, 6u, g_page7_dwell2d, static_cast<uint16_t>(sizeof(g_page7_dwell2d)));
     }
     if (page == 0x08u) {
-        const bool ok = ems::hal::nvm_save_calibration(7u, g_page8_pedalmap, static_cast<uint16_t>(sizeof(g_page8_pedalmap)));
-        if (!ok) { return false; }
-        clear_page_dirty(page);
-        return true;
+        return queue_burn(page, 7u, g_page8_pedalmap, static_cast<uint16_t>(sizeof(g_page8_pedalmap)));
     }
     if (page == 0x09u) {
-        const bool ok = ems::hal::nvm_save_calibration(8u, g_page9_boost, static_cast<uint16_t>(sizeof(g_page9_boost)));
-        if (!ok) { return false; }
-        clear_page_dirty(page);
-        return true;
+        return queue_burn(page, 8u, g_page9_boost, static_cast<uint16_t>(sizeof(g_page9_boost)));
+    }
+    return false;
+}
+
+// Rollback concluído: a cópia anterior passou a ser a activa — recarrega o
+// buffer da página e aplica aos globals. Conteúdo rejeitado (eixos não
+// monotónicos) mantém os globals e volta a servir o estado em RAM.
+void rollback_done(void* ctx, bool ok) noexcept {
+    if (!ok) { return; }
+    const uint8_t page = static_cast<uint8_t>(reinterpret_cast<uintptr_t>(ctx));
+    uint8_t* const ptr = page_ptr(page);
+    if (ptr == nullptr ||
+        !ems::hal::nvm_load_calibration(nvm_slot_for_page(page), ptr, page_size(page))) {
+        return;
     }
     if (page == 0x0Bu) {
-        sync_page_from_table(0x0Bu);  // serializa eixos atuais → buffer
-        const bool ok = ems::hal::nvm_save_calibration(9u, g_page11_axes, static_cast<uint16_t>(sizeof(g_page11_axes)));
-        if (!ok) { return false; }
-        clear_page_dirty(page);
-        return true;
+        // Eixos anteriores + tabelas ligadas a eles (hal/cal_store.h): nada
+        // é re-amostrado a partir da RAM — o job só leva os mapas aprendidos
+        // para a grelha reposta e reaxis_poll repõe as tabelas da flash.
+        uint16_t rpm[ems::engine::kTableAxisSize];
+        uint16_t load[ems::engine::kTableAxisSize];
+        constexpr uint16_t kAxisBytes = 2u * ems::engine::kTableAxisSize;
+        std::memcpy(rpm,  g_page11_axes + 0,          kAxisBytes);
+        std::memcpy(load, g_page11_axes + kAxisBytes, kAxisBytes);
+        if (!ems::engine::table_reaxis_request_learned(rpm, load)) {
+            sync_page_from_table(page);
+            mark_page_dirty(page);
+            return;
+        }
+        g_reaxis_restore_pending = true;
+        return;
     }
-    return false;
+    if (!sync_table_from_page(page)) {
+        sync_page_from_table(page);
+        mark_page_dirty(page);
+        return;
+    }
+    clear_page_dirty(page);
+    // O main guarda a sua própria imagem do page0 (re-burn, globals só lidos
+    // no boot): recarrega-a da cópia agora activa.
+    if (page == 0x00u) { g_page0_reload_pending = true; }
+}
+
+bool rollback_page_in_flash(uint8_t page) noexcept {
+    const uint8_t slot = nvm_slot_for_page(page);
+    if (slot == 0xFFu) { return false; }
+    // Tabelas 3D só voltam sozinhas para uma cópia gravada sobre os mesmos
+    // eixos (o cal_store recusa as outras); com re-eixo em curso ou por
+    // gravar, a RAM já não está nos eixos da flash. A página 11 leva o
+    // grupo inteiro.
+    if (reaxis_group_page(page) &&
+        (ems::engine::table_reaxis_pending() ||
+         (page != 0x0Bu && g_reaxis_group_unburned))) {
+        return false;
+    }
+    void* const ctx = reinterpret_cast<void*>(static_cast<uintptr_t>(page));
+    return ems::hal::nvm_queue_rollback(slot, rollback_done, ctx);
 }
 
 void handle_read_done() noexcept {
@@ -873,36 +1132,42 @@ void handle_read_done() noexcept {
         return;
     }
 
-    if (g_cmd_page == 0x03u) {
+    if (g_sess->cmd_page == 0x03u) {
         update_realtime_page();
     } else {
-        sync_page_from_table(g_cmd_page);
+        sync_page_from_table(g_sess->cmd_page);
     }
 
-    const uint8_t* ptr = page_ptr(g_cmd_page);
+    const uint8_t* ptr = page_ptr(g_sess->cmd_page);
     if (ptr == nullptr) { tx_push(kAckErr); reset_parser(); return; }
-    tx_push_bytes(ptr + g_cmd_off, g_cmd_len);
+    tx_push_bytes(ptr + g_sess->cmd_off, g_sess->cmd_len);
     reset_parser();
 }
 
 void handle_write_done() noexcept {
-    if (!command_bounds_ok() || g_cmd_page == 0x03u) {
+    if (!command_bounds_ok() || g_sess->cmd_page == 0x03u) {
         tx_push(kAckErr);
         reset_parser();
         return;
     }
 
-    if (!sync_table_from_page(g_cmd_page)) {
+    if (page_write_unchanged(g_sess->cmd_page)) {
+        tx_push(kAckOk);
+        reset_parser();
+        return;
+    }
+
+    if (!sync_table_from_page(g_sess->cmd_page)) {
         // Conteúdo rejeitado (ex.: eixos não monotónicos) — restaura o buffer
         // a partir dos globals para não servir dados incoerentes num 'r'.
-        sync_page_from_table(g_cmd_page);
+        sync_page_from_table(g_sess->cmd_page);
         tx_push(kAckErr);
         reset_parser();
         return;
     }
-    mark_page_dirty(g_cmd_page);
-    if (!g_write_ram_only) {
-        if (!burn_rpm_safe() || !burn_page_to_flash(g_cmd_page)) {
+    mark_page_dirty(g_sess->cmd_page);
+    if (!g_sess->write_ram_only) {
+        if (!burn_rpm_safe() || !burn_page_to_flash(g_sess->cmd_page)) {
             tx_push(kAckErr);
             reset_parser();
             return;
@@ -46,18 +46,6 @@ alignas(4) uint8_t g_page10_ltft[ems::engine::kTableCells +
     static_cast<uint16_t>(ems::engine::kLtftAddAxisSize) * ems::engine::kLtftAddAxisSize] = {};
 alignas(4) uint8_t g_page11_axes[4u * ems::engine::kTableAxisSize] = {};
 alignas(4) uint8_t g_page12_ltft_accum[ems::engine::kLtftAccumPageSize] = {};
-alignas(4) uint8_t g_env_buf[kEnvMaxPayload] = {};
-uint16_t g_env_size = 0u;
-uint16_t g_env_pos = 0u;
-uint32_t g_env_rx_crc = 0u;
-uint8_t  g_env_crc_pos = 0u;
-volatile uint8_t g_rx_buf[kRxSize] = {};
-volatile uint16_t g_rx_head = 0u;
-volatile uint16_t g_rx_tail = 0u;
-volatile bool g_rx_flag = false;
-volatile uint8_t g_tx_buf[kTxSize] = {};
-volatile uint16_t g_tx_head = 0u;
-volatile uint16_t g_tx_tail = 0u;
 uint8_t  g_rt_pw_ms_x10   = 0u;
 int8_t   g_rt_advance_deg  = 0;
 int8_t   g_rt_stft_p100   = 0;
@@ -75,14 +63,17 @@ uint8_t  g_rt_sync_state_raw = 0u;
 bool     g_rt_rev_limit_active = false;
 uint32_t g_rt_loop2ms_last_us = 0u;
 uint32_t g_rt_loop2ms_max_us = 0u;
-ParseState g_state = ParseState::IDLE;
-uint8_t g_cmd_page = 0u;
-uint16_t g_cmd_off = 0u;
-uint16_t g_cmd_len = 0u;
-uint8_t g_arg_pos = 0u;
-uint8_t g_test_args[4] = {};  // 'T': subcmd, arg1, arg2_lo, arg2_hi
-uint16_t g_write_pos = 0u;
-bool g_write_ram_only = false;
+alignas(4) UiSession g_sessions[kUiPortCount] = {};
+UiSession* g_sess = &g_sessions[0];
+
+UiSession& session_for(UiPort port) noexcept {
+    const uint8_t i = static_cast<uint8_t>(port);
+    return g_sessions[(i < kUiPortCount) ? i : 0u];
+}
 uint16_t g_dirty_page_mask = 0u;
+bool g_reaxis_burn_deferred = false;
+bool g_reaxis_group_unburned = false;
+bool g_reaxis_restore_pending = false;
+bool g_page0_reload_pending = false;
 
 }  // namespace ems::app::ui_detail
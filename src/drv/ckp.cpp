@@ -31,8 +31,12 @@
  * ═══════════════════════════════════════════════════════════════════════════
  * MÓDULO 2: SYNC — Máquina de Estados
  * ─────────────────────────────────────
- *   Roda fônica 60-2: 60 posições × 6°; 2 dentes ausentes consecutivos.
- *   O gap ocorre 1× por revolução; a ISR identifica-o por razão de período.
+ *   Roda fônica N-M (drv/trigger_wheel.h; default 60-2: 60 posições × 6°,
+ *   2 dentes ausentes consecutivos). Cada gap é identificado por razão de
+ *   período; a posição vem das tabelas constexpr da roda (gap_min_count,
+ *   next_seg_tooth, span_after, ident_next_tooth) — o mesmo caminho de
+ *   código para todas as rodas, sem custo extra por dente.
+ *   Limiares abaixo em números da 60-2.
  *
  *   Estados (enum SyncState — definido em ckp.h):
  *     WAIT_GAP     → inicial / pós-falha: aguarda qualquer gap
@@ -42,13 +46,14 @@
  *
  *   Transições:
  *     WAIT_GAP     + gap              → HALF_SYNC   (tooth_count reset=0)
+ *                    (rodas com vários gaps: só pelo segmento mais longo)
  *     HALF_SYNC    + gap, count≥55    → FULL_SYNC   (tooth_index reset=0)
  *     HALF_SYNC    + gap, count<55    → LOSS_OF_SYNC (pulso espúrio)
  *     HALF_SYNC    + count>61         → LOSS_OF_SYNC (gap ausente)
  *     FULL_SYNC    + gap, count≥55    → FULL_SYNC   (gap confirmado, reinicia)
  *     FULL_SYNC    + gap, count<55    → LOSS_OF_SYNC (wheel slip / ruído)
  *     FULL_SYNC    + count>61         → LOSS_OF_SYNC (gap ausente)
- *     LOSS_OF_SYNC + gap              → HALF_SYNC   (tentativa re-sync)
+ *     LOSS_OF_SYNC + gap, count≥55    → HALF_SYNC   (tentativa re-sync)
  *
  * FILTRO DINÂMICO ±20% (rejeição de ruído):
  *   Dentes normais aceitos apenas se:  0,8×avg ≤ period ≤ 1,2×avg
@@ -61,11 +66,12 @@
 
 #include "drv/ckp.h"
 #include <cstdint>
-#include <cstring>
 #include "hal/timer.h"
 #include "hal/critical_section.h"
+#include "hal/seqlock.h"
 #include "engine/calibration.h"
 #include "drv/sensors.h"
+#include "drv/tooth_geom.h"
 #if defined(TARGET_STM32H562) && !defined(EMS_HOST_TEST)
 #include "hal/regs.h"
 #endif
@@ -98,13 +104,13 @@ namespace ems::drv {
 
 namespace {
 
-// ── Constantes da roda fônica 60-2 ───────────────────────────────────────────
-
-// 60-2: 60 posições, 2 dentes ausentes consecutivos = 58 dentes reais.
-// Espaçamento por posição: 360°/60 = 6,0°.
-// Gap: 3 posições ausentes × 6° = 18° ≈ 3× período normal.
-static constexpr uint16_t kRealTeethPerRev    = 58u;  // dentes físicos — uso exclusivo da máquina de estados (gap detection)
-static constexpr uint16_t kTeethPositionsPerRev = 60u; // posições angulares uniformes — uso em cálculos de RPM e ângulo
+// ── Roda fônica ──────────────────────────────────────────────────────────────
+// Tabelas por dente em drv/trigger_wheel.h. No target ckp_wheel() é a roda
+// do build (constexpr); em host é comutável por ckp_test_set_wheel().
+#if defined(EMS_HOST_TEST)
+static const ems::drv::TriggerWheel* g_test_wheel = &ems::drv::kTriggerWheel;
+#endif
+inline const ems::drv::TriggerWheel& wheel() noexcept { return ems::drv::ckp_wheel(); }
 
 // Fallback sequencial→wasted por ausência de CMP. O came dispara 1×/720° = a cada
 // 2 revoluções, logo em operação normal o contador chega no máximo a ~2 antes de
@@ -119,19 +125,20 @@ static inline uint16_t max_revs_without_cmp() noexcept {
     return ems::drv::sensors_is_bench_mode() ? kMaxRevsWithoutCmpBench : kMaxRevsWithoutCmp;
 }
 
-// Mínimo de dentes contados desde o último gap para aceitar novo gap.
-// 55 << 58: descarta pulsos espúrios no início de cada revolução.
-static constexpr uint16_t kGapThresholdTooth  = 55u;
+// Mínimo de dentes contados desde o último gap para aceitar novo gap:
+// wheel().gap_min_count (55 << 58 na 60-2) — descarta pulsos espúrios no
+// início de cada segmento.
 
-// Máximo de dentes sem gap antes de declarar LOSS_OF_SYNC.
-// SCH-04: margem aumentada de 60 para 63 (58 real + 5 de margem).
+// Máximo de dentes sem gap antes de declarar LOSS_OF_SYNC: maior segmento
+// da roda + kMissingGapMargin.
+// SCH-04: margem aumentada de 60 para 63 na 60-2 (58 real + 5 de margem).
 // A margem anterior de 2 dentes era insuficiente durante desaceleração brusca:
 // se o filtro ±20% rejeitar 2 dentes consecutivos como "muito lentos" (período
 // crescendo > 20%/dente), o contador de dentes válidos ficaria curto de 58,
 // disparando LOSS_OF_SYNC espuriamente ("tropeço" em desaceleração agressiva).
 // Com 5 dentes de margem, suporta até 5 rejeições consecutivas por ruído antes
 // de declarar perda — cobre condições normais de desaceleração em estrada.
-static constexpr uint16_t kMaxTeethBeforeLoss = 63u;
+static constexpr uint16_t kMissingGapMargin = 5u;
 
 // ── Limiares do filtro ───────────────────────────────────────────────────────
 // Detecção de gap por razão:  period × kDen > avg × kNum  ≡  period > 1,5 × avg
@@ -218,7 +225,8 @@ static constexpr uint32_t kGrdSpikeDen     = 4u;  // spike:   1/4 = 0.25
 // INVARIANTE DE ACESSO — NUNCA VIOLAR:
 //   g_state é escrito EXCLUSIVAMENTE pela ISR ckp_tim5_ch1_isr() (prioridade 1).
 //   Qualquer outro contexto (main loop, ISRs de prioridade < 1) DEVE usar
-//   ckp_snapshot() para ler g_state.snap — que aplica seção crítica CPSID/CPSIE.
+//   ckp_snapshot() — cópia de g_snap_pub, publicado no fim de cada ISR TIM5
+//   (seqlock, sem CPSID/CPSIE no leitor).
 //
 //   Acessar g_state.snap diretamente fora da ISR de prioridade 1 é PROIBIDO
 //   porque a leitura pode observar um snapshot parcialmente actualizado
@@ -253,13 +261,18 @@ struct DecoderState {
 static constexpr uint16_t kAnomalyResyncThreshold = 60u;
 
 static DecoderState g_state{};  // zero-init; SyncState::WAIT_GAP == 0
+// Cópia publicada de g_state.snap para leitores fora da ISR. Escritores: ISR
+// TIM5 CH1/CH2 (mesmo IRQ, não se aninham) e ckp_stall_poll dentro de CPSID —
+// nunca dois ao mesmo tempo, como o seqlock exige.
+static ems::hal::SeqLock<ems::drv::CkpSnapshot> g_snap_pub;
+inline void publish_snapshot() noexcept { g_snap_pub.write(g_state.snap); }
 // FIX-5: volatile nas variáveis escritas pela ISR TIM5 (prio 1) e lidas pelo
 // background loop sem seção crítica. Sem volatile, o compilador pode elevar
 // as leituras para fora de loops ou cacheá-las em registradores, observando
 // valores desatualizados. volatile força um fresh load de memória a cada acesso.
 // NOTA: g_state NÃO é volatile porque é usada diretamente dentro de ISRs,
 // onde o acesso volatileness é desnecessário (a ISR não pode ser interrompida
-// por si mesma). A proteção de snapshot usa critical section + memcpy.
+// por si mesma). A proteção de snapshot é o seqlock g_snap_pub.
 static volatile bool g_seed_armed = false;
 static volatile bool g_seed_phase_a = false;
 static volatile bool g_seed_probation = false;
@@ -280,20 +293,21 @@ inline uint32_t ticks_to_ns(uint32_t ticks) noexcept {
 }
 
 // Calcula RPM × 10 a partir do período de um dente (nanossegundos).
-// Cada dente ocupa 6° = 1/60 de revolução (roda 60-2: 60 posições uniformes).
-// rpm × 10 = (60 s/min × 10⁹ ns/s × 10) / (60 × tooth_period_ns)
-//           = 600.000.000.000 / (60 × tooth_period_ns)
+// Cada posição ocupa 1/N de revolução (60-2: 6° = 1/60).
+// rpm × 10 = (60 s/min × 10⁹ ns/s × 10) / (N × tooth_period_ns)
+//           = 600.000.000.000 / (N × tooth_period_ns)
 inline uint32_t rpm_x10_from_period_ns(uint32_t period_ns) noexcept {
     if (period_ns == 0u) { return 0u; }
     return static_cast<uint32_t>(
-        600000000000ULL / (static_cast<uint64_t>(kTeethPositionsPerRev) * period_ns));
+        600000000000ULL / (static_cast<uint64_t>(wheel().positions) * period_ns));
 }
 
 // Caminho quente do ISR: period_ns = period_ticks * 16 ns, entao:
-// rpm x10 = 600000000000 / (60 * 16 * period_ticks) = 625000000 / period_ticks.
+// rpm x10 = 600000000000 / (N * 16 * period_ticks) = rpm_x10_num / period_ticks
+// (625000000 na 60-2).
 inline uint32_t rpm_x10_from_period_ticks(uint32_t period_ticks) noexcept {
     if (period_ticks == 0u) { return 0u; }
-    return 625000000u / period_ticks;
+    return wheel().rpm_x10_num / period_ticks;
 }
 
 // RPM reportado só com referência angular (HALF/FULL_SYNC). Sem sync devolve
@@ -307,21 +321,41 @@ inline uint32_t rpm_if_synced(uint32_t period_ticks) noexcept {
     return rpm_x10_from_period_ticks(period_ticks);
 }
 
-inline uint32_t predict_next_period_ticks(uint32_t current_ticks) noexcept {
-    const uint32_t prev = g_state.prev_period_ticks;
-    if (prev == 0u) { return current_ticks; }
+// Escala Q15 de um período (tabelas de geometria; 32768 = identidade exacta).
+inline uint32_t geom_scale(uint32_t ticks, uint16_t q15) noexcept {
+    return static_cast<uint32_t>((static_cast<uint64_t>(ticks) * q15) >> 15u);
+}
+
+// ti = dente onde começou o intervalo acabado de medir (com referência
+// angular); fora de sync passa kTriggerMaxTeeth → sem correcção de geometria.
+// A tendência é calculada em períodos nominais (corrente e anterior
+// divididos pelo comprimento aprendido de cada intervalo) e o resultado
+// escalado para o comprimento do intervalo seguinte.
+inline uint32_t predict_next_period_ticks(uint32_t current_ticks, uint16_t ti) noexcept {
+    const uint32_t prev_raw = g_state.prev_period_ticks;
+    if (prev_raw == 0u) { return current_ticks; }
     // Pathological periods (noise / stall residue) must not enter signed math.
-    if (current_ticks > 0x7FFFFFFFu || prev > 0x7FFFFFFFu) {
+    if (current_ticks > 0x7FFFFFFFu || prev_raw > 0x7FFFFFFFu) {
         return current_ticks;
     }
 
-    int32_t trend = static_cast<int32_t>(current_ticks) - static_cast<int32_t>(prev);
+    const bool geom = ti < ems::drv::kTriggerMaxTeeth;
+    const ems::drv::ToothGeomPred g = geom
+        ? ems::drv::tooth_geom_pred(static_cast<uint8_t>(ti))
+        : ems::drv::ToothGeomPred{ems::drv::kToothGeomOneQ15, ems::drv::kToothGeomOneQ15,
+                                  ems::drv::kToothGeomOneQ15, 0u};
+    const uint32_t cur = geom_scale(current_ticks, g.inv_cur_q15);
+    const uint32_t prev = geom_scale(prev_raw, g.inv_prev_q15);
+    if (cur > 0x7FFFFFFFu || prev > 0x7FFFFFFFu) { return current_ticks; }
+
+    int32_t trend = static_cast<int32_t>(cur) - static_cast<int32_t>(prev);
     const int32_t limit = static_cast<int32_t>(prev / kPredictionClampDen);
     if (trend > limit) { trend = limit; }
     if (trend < -limit) { trend = -limit; }
 
-    const int32_t predicted = static_cast<int32_t>(current_ticks) + trend;
-    return (predicted > 0) ? static_cast<uint32_t>(predicted) : current_ticks;
+    const int32_t predicted = static_cast<int32_t>(cur) + trend;
+    return (predicted > 0) ? geom_scale(static_cast<uint32_t>(predicted), g.len_next_q15)
+                           : current_ticks;
 }
 
 // Insere novo período na janela deslizante (shift FIFO).
@@ -510,50 +544,78 @@ static inline void advance_phase_half() noexcept {
     g_state.snap.phase_A = (g_state.phase_half == 0u);
 }
 
+// Entrada em HALF_SYNC com a posição identificada pelo gap: next_tooth é o
+// dente real que o gap precede. A fase só avança no gap de referência
+// (dente 0) — os outros gaps de uma roda multi-gap estão dentro da volta.
+inline bool enter_half_sync(uint8_t next_tooth) noexcept {
+    // FIX 2026-06-29: seed desativado p/ diagnóstico. O seed armado pela
+    // NVM pode impedir sync se is_forward_rotation_coherent nunca retornar
+    // true devido a contaminação do tooth_period_ns.
+    // TODO: re-activar seed (via is_forward_rotation_coherent) quando
+    //       a classificação de dentes estiver robusta.
+    g_state.snap.state = ems::drv::SyncState::HALF_SYNC;
+    g_state.tooth_count      = 0u;
+    g_state.snap.tooth_index = next_tooth;
+    // RPM é gated por sync (rpm_if_synced): popula já na transição com
+    // o último período de dente normal, senão ficaria 0 até ao próximo.
+    g_state.snap.rpm_x10 = rpm_x10_from_period_ticks(g_state.prev_period_ticks);
+    if (next_tooth == 0u) {
+        advance_phase_half();
+    } else {
+        g_state.snap.phase_A = (g_state.phase_half == 0u);
+    }
+    return true;
+}
+
+// Gap sem referência angular: o nº de dentes medido identifica o segmento
+// (só o mais longo da roda — ver trigger_wheel.h). 0xFF = não identifica.
+inline uint8_t ident_after_gap(uint16_t tooth_count) noexcept {
+    const uint16_t m = (tooth_count < ems::drv::kTriggerMaxTeeth)
+                     ? tooth_count
+                     : static_cast<uint16_t>(ems::drv::kTriggerMaxTeeth - 1u);
+    return wheel().ident_next_tooth[m];
+}
+
 inline bool process_gap_event() noexcept {
+    const ems::drv::TriggerWheel& w = wheel();
     switch (g_state.snap.state) {
 
         case ems::drv::SyncState::WAIT_GAP:
             // WAIT_GAP: primeiro gap aceite com count ≥ kHistSize (bootstrap minimo).
             // Após bootstrap, o classificador ja tem media valida. O gap 3× e o
             // UNICO evento com esta razao neste estado — baixo risco de falso gap.
-            if (g_state.tooth_count < kHistSize) {
-                g_state.tooth_count = 0u;
-                return false;
+            // Rodas com vários gaps: há gaps iguais na volta, segue como LOSS
+            // (identificação pela contagem do segmento).
+            if (w.gap_count == 1u) {
+                if (g_state.tooth_count < kHistSize) {
+                    g_state.tooth_count = 0u;
+                    return false;
+                }
+                return enter_half_sync(0u);
             }
-            goto sync_transition_common;
-
-        case ems::drv::SyncState::LOSS_OF_SYNC:
-            // LOSS_OF_SYNC: exigir kGapThresholdTooth para evitar re-sync falso
-            // apos perda por ruido (gap espurio seguido de poucos dentes).
-            if (g_state.tooth_count < kGapThresholdTooth) {
+            [[fallthrough]];
+
+        case ems::drv::SyncState::LOSS_OF_SYNC: {
+            // LOSS_OF_SYNC: exigir o segmento quase completo (≥55 na 60-2) para
+            // evitar re-sync falso apos perda por ruido (gap espurio seguido
+            // de poucos dentes).
+            const uint8_t next = ident_after_gap(g_state.tooth_count);
+            if (next == ems::drv::kTriggerNoTooth) {
                 g_state.tooth_count = 0u;
                 return false;
             }
-            goto sync_transition_common;
-
-        sync_transition_common:
-            // FIX 2026-06-29: seed desativado p/ diagnóstico. O seed armado pela
-            // NVM pode impedir sync se is_forward_rotation_coherent nunca retornar
-            // true devido a contaminação do tooth_period_ns.
-            // TODO: re-activar seed (via is_forward_rotation_coherent) quando
-            //       a classificação de dentes estiver robusta.
-            g_state.snap.state = ems::drv::SyncState::HALF_SYNC;
-            g_state.tooth_count      = 0u;
-            g_state.snap.tooth_index = 0u;
-            // RPM é gated por sync (rpm_if_synced): popula já na transição com
-            // o último período de dente normal, senão ficaria 0 até ao próximo.
-            g_state.snap.rpm_x10 = rpm_x10_from_period_ticks(g_state.prev_period_ticks);
-            advance_phase_half();
-            return true;
-
-        case ems::drv::SyncState::HALF_SYNC:
-            if (g_state.tooth_count >= kGapThresholdTooth) {
+            return enter_half_sync(next);
+        }
+
+        case ems::drv::SyncState::HALF_SYNC: {
+            const uint16_t ti = g_state.snap.tooth_index;
+            if (g_state.tooth_count >= w.gap_min_count[ti]) {
                 // 2º gap na posição correta → sincronismo completo.
+                const uint8_t next = w.next_seg_tooth[ti];
                 g_state.snap.state       = ems::drv::SyncState::FULL_SYNC;
                 g_state.tooth_count      = 0u;
-                g_state.snap.tooth_index = 0u;
-                advance_phase_half();
+                g_state.snap.tooth_index = next;
+                if (next == 0u) { advance_phase_half(); }
                 return true;
             }
             // Gap prematuro: pulso espúrio (EMC, dente danificado).
@@ -565,13 +627,17 @@ inline bool process_gap_event() noexcept {
             g_state.tooth_count = 0u;
             close_cmp_seq_gate();
             return false;
+        }
 
-        case ems::drv::SyncState::FULL_SYNC:
-            if (g_state.tooth_count >= kGapThresholdTooth) {
+        case ems::drv::SyncState::FULL_SYNC: {
+            const uint16_t ti = g_state.snap.tooth_index;
+            if (g_state.tooth_count >= w.gap_min_count[ti]) {
+                const uint8_t next = w.next_seg_tooth[ti];
                 g_state.tooth_count      = 0u;
-                g_state.snap.tooth_index = 0u;
-                advance_phase_half();
+                g_state.snap.tooth_index = next;
                 ++ems::drv::g_dbg_gap_accepted;
+                if (next != 0u) { return true; }  // gap intermédio (multi-gap)
+                advance_phase_half();
                 // Fallback CMP-ausente: conta revoluções desde a última borda de came
                 // validada. Ultrapassado o limite, o came presume-se perdido → zera
                 // cmp_confirms para o agendador reverter a wasted-spark (o gate lê
@@ -590,6 +656,7 @@ inline bool process_gap_event() noexcept {
             g_state.tooth_count = 0u;
             close_cmp_seq_gate();
             return false;
+        }
 
         default:
             return false;
@@ -611,7 +678,7 @@ volatile uint32_t g_dbg_hist_ready_max = 0u;
 volatile uint32_t g_dbg_gap_accepted = 0u;
 volatile uint32_t g_dbg_gap_premature = 0u;
 volatile uint32_t g_dbg_gap_last_tc = 0u;
-// Perdas de sync por caminho: gap ausente (tooth_count > kMaxTeethBeforeLoss)
+// Perdas de sync por caminho: gap ausente (tooth_count > max_seg_teeth + margem)
 // vs stall watchdog. avg/delta capturados no instante da perda por gap ausente
 // — média inflada = histórico contaminado; delta anômalo = borda distorcida.
 volatile uint32_t g_dbg_loss_missing_gap = 0u;
@@ -621,7 +688,7 @@ volatile uint32_t g_dbg_loss_delta = 0u;
 // Discriminação dos 3 gatilhos de perda de FULL_SYNC (sem debounce hoje):
 //   histogram = gate de dispersão do hist (mx > 1.5×mn) — re-bootstrap + drop
 //   wrap      = tooth_index chegou a 57 sem gap aceite (gap classificado normal)
-//   (o overrun tooth_count>kMaxTeethBeforeLoss continua em g_dbg_loss_missing_gap)
+//   (o overrun tooth_count>max_seg_teeth+margem continua em g_dbg_loss_missing_gap)
 // hist_mn/hist_mx capturam o par min/max do último trip de histograma:
 //   mx≈1.5×mn → gate no limiar (dispersão real de roda) → candidato a relaxar;
 //   mx≫mn      → contaminação grosseira (dente perdido real) → drop correto.
@@ -634,7 +701,7 @@ volatile uint32_t g_dbg_skip_after_silence = 0u;
 
 // Instant RPM 360°: timestamp TIM5 do mesmo slot de dente na volta anterior +
 // último dt de volta completa (escrito só na ISR; leitura atómica de u32).
-static uint32_t g_tooth_rev_ts[58];  // kRealTeethPerRev (definido abaixo)
+static uint32_t g_tooth_rev_ts[ems::drv::kTriggerMaxTeeth];
 static volatile uint32_t g_instant_rev_dt_ticks = 0u;
 
 // Osciloscópio CKP/CMP: rings de timestamps TIM5 das bordas cruas (pré-filtro).
@@ -686,14 +753,12 @@ volatile uint32_t g_diag_last_ckp_edge_tick = 0u;
 volatile uint32_t g_diag_last_cmp_edge_tick = 0u;
 
 CkpSnapshot ckp_snapshot() noexcept {
-    CkpSnapshot out;
-    ems::hal::CriticalSectionGuard guard;
-    // memcpy garante cópia byte-a-byte determinística; CriticalSectionGuard
-    // desabilita interrupções, impedindo que a ISR TIM5 modifique g_state.snap
-    // durante a cópia. Sem volatile + critical section, o compilador poderia
-    // reordenar ou cachear leituras de campos individuais de g_state.snap.
-    std::memcpy(&out, &g_state.snap, sizeof(out));
-    return out;
+    // Sem CPSID: a ISR publica g_state.snap inteiro no buffer inactivo e vira
+    // a sequência; aqui copia-se o publicado e repete-se só se a ISR tiver
+    // publicado DUAS vezes durante a cópia (impossível a <30k RPM). Antes,
+    // cada chamada do main loop (várias por slot) mascarava o IRQ do TIM5 e
+    // atrasava o atendimento da captura CKP.
+    return g_snap_pub.read();
 }
 
 // ── ISR do CKP: TIM5 CH1 (PA0/CKP, rising edge) ─────────────────────────────
@@ -712,7 +777,20 @@ CkpSnapshot ckp_snapshot() noexcept {
 //   instante da borda de subida, em hardware. A CPU pode atender a IRQ
 //   vários ciclos depois — o timestamp em C0V permanece válido.
 //   Isso é impossível com GPIO/EXTI onde a CPU leria o contador atual (atrasado).
+static FASTRUN void ckp_tooth_isr_body() noexcept;
+static FASTRUN void ckp_cam_isr_body() noexcept;
+
 FASTRUN void ckp_tim5_ch1_isr() noexcept {
+    ckp_tooth_isr_body();
+    publish_snapshot();  // todos os caminhos de saída (incl. early return)
+}
+
+FASTRUN void ckp_tim5_ch2_isr() noexcept {
+    ckp_cam_isr_body();
+    publish_snapshot();
+}
+
+static FASTRUN void ckp_tooth_isr_body() noexcept {
     ++g_diag_isr_count;  // DIAG: incrementa em cada ISR (borda crua, pré-filtro)
 
     // snapshot estado interno para diagnóstico
@@ -915,7 +993,11 @@ FASTRUN void ckp_tim5_ch1_isr() noexcept {
     }
 
     // ── 6. Processamento de dente normal ──────────────────────────────────
-    const uint32_t predicted_ticks = predict_next_period_ticks(delta_ticks);
+    const bool angle_ref = g_state.snap.state == ems::drv::SyncState::HALF_SYNC ||
+                           g_state.snap.state == ems::drv::SyncState::FULL_SYNC;
+    const uint32_t predicted_ticks = predict_next_period_ticks(
+        delta_ticks, angle_ref ? g_state.snap.tooth_index
+                               : static_cast<uint16_t>(ems::drv::kTriggerMaxTeeth));
     hist_push(delta_ticks);
 
     g_state.snap.tooth_period_ns = period_ns;
@@ -929,14 +1011,19 @@ FASTRUN void ckp_tim5_ch1_isr() noexcept {
     // subtrai e guarda; a divisão fica no getter (fora do caminho crítico).
     // Nota: após LOSS→resync a 1ª volta pode ler dt de timestamps antigos —
     // consumidores devem gate por FULL_SYNC estável (o reset de sync limpa).
-    if (g_state.snap.state == ems::drv::SyncState::HALF_SYNC ||
-        g_state.snap.state == ems::drv::SyncState::FULL_SYNC) {
+    // Mesma referência de 360° alimenta o lote de geometria por dente
+    // (drv/tooth_geom.h), só em FULL_SYNC e só com o lote armado.
+    if (angle_ref) {
         const uint16_t ti = g_state.snap.tooth_index;
-        if (ti < kRealTeethPerRev) {
+        if (ti < ems::drv::kTriggerMaxTeeth) {
             const uint32_t prev_rev_ts = g_tooth_rev_ts[ti];
             g_tooth_rev_ts[ti] = capture_now;
             if (prev_rev_ts != 0u) {
                 g_instant_rev_dt_ticks = capture_now - prev_rev_ts;
+                if (g_state.snap.state == ems::drv::SyncState::FULL_SYNC) {
+                    ems::drv::tooth_geom_on_tooth(static_cast<uint8_t>(ti), delta_ticks,
+                                                  capture_now - prev_rev_ts);
+                }
             }
         }
     }
@@ -945,16 +1032,17 @@ FASTRUN void ckp_tim5_ch1_isr() noexcept {
     // a detecção de LOSS_OF_SYNC por excesso de dentes sem gap.
     ++g_state.tooth_count;
     // tooth_index só avança quando há referência angular (HALF_SYNC / FULL_SYNC).
-    // Wrap 57→0 sem gap aceite é falso 2º meio-ciclo (ruído classificado normal);
+    // Dente normal depois do último dente de um segmento (span_after > 1: 57→0
+    // na 60-2) sem gap aceite é falso 2º meio-ciclo (ruído classificado normal);
     // força LOSS em vez de re-agendar dentes 0..N outra vez na mesma volta.
     if (g_state.snap.state != ems::drv::SyncState::WAIT_GAP &&
         g_state.snap.state != ems::drv::SyncState::LOSS_OF_SYNC) {
-        if (g_state.snap.tooth_index < (kRealTeethPerRev - 1u)) {
+        if (wheel().span_after[g_state.snap.tooth_index] == 1u) {
             g_state.snap.tooth_index =
                 static_cast<uint16_t>(g_state.snap.tooth_index + 1u);
         } else {
-            // WRAP: gap real classificado NORMAL → tooth_index chegou a 57.
-            // Distinto do overrun (tooth_count>kMaxTeethBeforeLoss) abaixo.
+            // WRAP: gap real classificado NORMAL → tooth_index passou o fim do
+            // segmento. Distinto do overrun (tooth_count demais) abaixo.
             ++ems::drv::g_dbg_loss_wrap;
             ems::drv::g_dbg_loss_avg   = hist_avg();
             ems::drv::g_dbg_loss_delta = delta_ticks;
@@ -965,11 +1053,11 @@ FASTRUN void ckp_tim5_ch1_isr() noexcept {
     }
 
     // ── 7. Verificação de perda de sincronia por contagem excessiva ───────
-    // Se passaram mais de kMaxTeethBeforeLoss dentes sem um gap:
+    // Se passaram mais de max_seg_teeth + kMissingGapMargin dentes sem um gap:
     //   → o gap foi perdido (interferência, aceleração brusca, falha de sensor)
     // OVERRUN: g_dbg_loss_missing_gap conta APENAS este caminho (o wrap 57→0
     // migrou para g_dbg_loss_wrap acima).
-    if (g_state.tooth_count > kMaxTeethBeforeLoss) {
+    if (g_state.tooth_count > wheel().max_seg_teeth + kMissingGapMargin) {
         if (g_state.snap.state == ems::drv::SyncState::HALF_SYNC ||
             g_state.snap.state == ems::drv::SyncState::FULL_SYNC) {
             // Gap ausente → LOSS_OF_SYNC; re-require 2 CMP edges for sequential.
@@ -1021,7 +1109,7 @@ FASTRUN void ckp_tim5_ch1_isr() noexcept {
 // no cilindro errado. Esta ISR valida coerência temporal usando o período CKP como
 // referência: o período entre bordas CMP deve ser ~2× o período do CKP (CMP = 1 rev,
 // CKP gap = 2 rev). Se delta for muito pequeno ou muito grande, é glitch.
-FASTRUN void ckp_tim5_ch2_isr() noexcept {
+static FASTRUN void ckp_cam_isr_body() noexcept {
     // Read capture register now — clears CHF flag; value is the TIM5 timestamp
     // of this CMP edge. Must be read before any other logic that might be slow.
     const uint32_t cmp_capture_now = TIM5_CAM_CAPTURE;
@@ -1045,17 +1133,17 @@ FASTRUN void ckp_tim5_ch2_isr() noexcept {
     }
     if (prev_period_ticks > 0u) {
         const uint32_t cmp_delta = cmp_capture_now - s_prev_cmp_capture; // circular uint32
-        // Expected: 2 × 60 × tooth_period (one cam cycle = 720°). Use uint64 —
+        // Expected: 2 × N × tooth_period (one cam cycle = 720°). Use uint64 —
         // at very low RPM 120 * prev_period overflows uint32 (~35.7e6 ticks).
-        constexpr uint32_t kMaxPrevForExpected =
-            0xFFFFFFFFu / (2u * kTeethPositionsPerRev);
-        if (prev_period_ticks > kMaxPrevForExpected) {
+        const uint32_t positions = wheel().positions;
+        const uint32_t max_prev_for_expected = 0xFFFFFFFFu / (2u * positions);
+        if (prev_period_ticks > max_prev_for_expected) {
             ++g_state.cmp_glitch_count;
             s_prev_cmp_capture = 0u;  // re-arm as first edge next time
             s_cmp_ref_tooth = 0xFFu;
             return;
         }
-        const uint64_t expected = 2ull * kTeethPositionsPerRev *
+        const uint64_t expected = 2ull * positions *
                                   static_cast<uint64_t>(prev_period_ticks);
         // FIX C10: at cranking/low RPM widen tolerance ±50%; else ±25%.
         constexpr uint32_t kLowRpmThreshTicks = 130000u;  // ~500 RPM @ 62.5 MHz TIM5
@@ -1079,9 +1167,13 @@ FASTRUN void ckp_tim5_ch2_isr() noexcept {
     s_cmp_reject_streak = 0u;  // passou o gate temporal → limpa a contagem de rejeições
     // ── Validação de janela de dente CMP (configurável) ──────────────────
     // Se open != 0 || close != 0 verifica se tooth_index cai dentro da janela.
-    // open=0 close=0 → desabilitado (comportamento padrão).
-    const uint8_t cmp_open  = ems::engine::cmp_window_open_tooth;
-    const uint8_t cmp_close = ems::engine::cmp_window_close_tooth;
+    // Calibração 0/0 → janela default do padrão da roda (0/0 = desabilitado).
+    uint8_t cmp_open  = ems::engine::cmp_window_open_tooth;
+    uint8_t cmp_close = ems::engine::cmp_window_close_tooth;
+    if (cmp_open == 0u && cmp_close == 0u) {
+        cmp_open  = wheel().cam_open_tooth;
+        cmp_close = wheel().cam_close_tooth;
+    }
     if ((cmp_open != 0u || cmp_close != 0u) &&
         g_state.snap.state == SyncState::FULL_SYNC) {
         const uint16_t ti = g_state.snap.tooth_index;
@@ -1104,8 +1196,9 @@ FASTRUN void ckp_tim5_ch2_isr() noexcept {
             uint8_t diff = (ti >= s_cmp_ref_tooth)
                          ? static_cast<uint8_t>(ti - s_cmp_ref_tooth)
                          : static_cast<uint8_t>(s_cmp_ref_tooth - ti);
-            if (diff > (kRealTeethPerRev / 2u)) {
-                diff = static_cast<uint8_t>(kRealTeethPerRev - diff);  // wrap na roda
+            const uint8_t real_teeth = wheel().real_teeth;
+            if (diff > (real_teeth / 2u)) {
+                diff = static_cast<uint8_t>(real_teeth - diff);  // wrap na roda
             }
             if (diff > kCmpToothTol) {
                 // Salto de posição → não é came coerente. Re-ancora (auto-cura para
@@ -1162,6 +1255,7 @@ bool ckp_stall_poll(uint32_t tim5_cnt_now) noexcept {
             elapsed_ticks >= min_stall_timeout_ticks()) {
             enter_critical();
             g_state.snap.rpm_x10 = 0u;
+            publish_snapshot();
             exit_critical();
         }
         return false;
@@ -1193,10 +1287,11 @@ bool ckp_stall_poll(uint32_t tim5_cnt_now) noexcept {
         // Instant RPM: motor parado → dt inválido; limpa também os timestamps
         // por dente para o resync não medir contra bordas da sessão anterior.
         g_instant_rev_dt_ticks = 0u;
-        for (uint16_t i = 0u; i < kRealTeethPerRev; ++i) {
+        for (uint16_t i = 0u; i < kTriggerMaxTeeth; ++i) {
             g_tooth_rev_ts[i] = 0u;
         }
         transitioned = true;
+        publish_snapshot();
     }
     exit_critical();
     return transitioned;
@@ -1245,8 +1340,9 @@ uint32_t ckp_instant_rpm_x10() noexcept {
 #if defined(EMS_HOST_TEST)
 void ckp_test_reset() noexcept {
     g_state = DecoderState{};  // zero-init; SyncState::WAIT_GAP == 0
+    g_test_wheel = &kTriggerWheel;
     g_instant_rev_dt_ticks = 0u;
-    for (uint16_t i = 0u; i < kRealTeethPerRev; ++i) {
+    for (uint16_t i = 0u; i < kTriggerMaxTeeth; ++i) {
         g_tooth_rev_ts[i] = 0u;
     }
     ems_test_tim5_ccr1   = 0u;
@@ -1266,6 +1362,7 @@ void ckp_test_reset() noexcept {
     s_cmp_ref_tooth = 0xFFu;
     s_cmp_reject_streak = 0u;
     s_skip_remaining = 0u;
+    g_snap_pub.test_reset();
 }
 
 uint32_t ckp_test_rpm_x10_from_period_ns(uint32_t period_ns) noexcept {
@@ -1274,6 +1371,14 @@ uint32_t ckp_test_rpm_x10_from_period_ns(uint32_t period_ns) noexcept {
 void ckp_test_set_cmp_confirms(uint8_t n) noexcept {
     g_state.cmp_confirms = n;
     g_state.snap.cmp_confirms = n;
+    publish_snapshot();
+}
+void ckp_test_set_wheel(TriggerWheelId id) noexcept {
+    g_test_wheel = &trigger_wheel_for(id);
+    tooth_geom_init();
+}
+const TriggerWheel& ckp_wheel() noexcept {
+    return *g_test_wheel;
 }
 #endif
 
@@ -1,12 +1,15 @@
 /**
  * @file drv/ckp.h
- * @brief Decodificador de roda fônica 60-2 e máquina de sincronismo — OpenEMS
+ * @brief Decodificador de roda fônica N-M e máquina de sincronismo — OpenEMS
  *
- * RODA FÔNICA 60-2
- * ────────────────
- *   60 posições angulares; 2 dentes consecutivos ausentes = 58 dentes reais.
- *   Espaçamento normal: 360°/60 = 6,0° por posição.
- *   Gap: ≈ 3 × período normal (18°).
+ * RODA FÔNICA (drv/trigger_wheel.h)
+ * ─────────────────────────────────
+ *   Padrão escolhido em compilação (make TRIGGER=60-2 | 36-1 | 36-2-2-2):
+ *   descrição N-M compilada em tabelas constexpr por dente, lidas por um
+ *   decoder único. Default 60-2: 60 posições; 2 dentes consecutivos
+ *   ausentes = 58 dentes reais, 6,0° por posição, gap ≈ 3 × período normal.
+ *   Os limiares abaixo (55, 61) são os da 60-2; nas outras rodas vêm de
+ *   gap_min_count / max_seg_teeth.
  *
  * MÁQUINA DE ESTADOS (SyncState)
  * ───────────────────────────────
@@ -29,6 +32,8 @@
 
 #include <cstdint>
 
+#include "drv/trigger_wheel.h"
+
 namespace ems::drv {
 
 /**
@@ -48,12 +53,12 @@ enum class SyncState : uint8_t {
  * @brief Instantâneo do decodificador CKP (sem estado mutável).
  *
  * Todos os campos são consistentes entre si no momento da chamada a
- * ckp_snapshot() (captura atômica via seção crítica).
+ * ckp_snapshot() (cópia do bloco publicado pela ISR — seqlock).
  */
 struct CkpSnapshot {
     uint32_t tooth_period_ns;    ///< Período do último dente normal (ns); 0 antes de HALF_SYNC
     uint32_t predicted_tooth_period_ns; ///< Próximo período estimado para agendamento intra-dente
-    uint16_t tooth_index;        ///< Índice do dente (0–57) contado desde o último gap; válido em FULL_SYNC
+    uint16_t tooth_index;        ///< Índice do dente real (0..real_teeth−1; 0–57 na 60-2) desde o gap de referência; válido em FULL_SYNC
     uint32_t last_tim5_capture;  ///< Timestamp TIM5 (ticks) do último dente — para angle-to-ticks
     uint32_t rpm_x10;            ///< RPM × 10 (ex: 8000 = 800,0 RPM); 0 antes de dados suficientes
     SyncState state;             ///< Estado corrente da máquina de sincronismo
@@ -65,7 +70,8 @@ struct CkpSnapshot {
  * @brief Retorna instantâneo atômico do estado CKP.
  *
  * Seguro para chamada de qualquer contexto (main loop, ISR de menor
- * prioridade). Usa seção crítica CPSID/CPSIE internamente.
+ * prioridade). Não desliga interrupções: lê o último snapshot publicado
+ * no fim da ISR TIM5 (seqlock de buffer duplo, hal/seqlock.h).
  */
 CkpSnapshot ckp_snapshot() noexcept;
 
@@ -134,7 +140,7 @@ extern volatile uint32_t g_dbg_gap_last_tc;
 // Discriminação dos 3 gatilhos de perda de FULL_SYNC (blip PW=0 intermitente):
 //   g_dbg_gap_premature   → gap prematuro (count<55)   [já existente]
 //   g_dbg_loss_histogram  → gate de dispersão do hist (mx > 1.5×mn)
-//   g_dbg_loss_wrap       → tooth_index 57→0 sem gap aceite (gap → normal)
+//   g_dbg_loss_wrap       → tooth_index passa o fim do segmento (57→0 na 60-2) sem gap aceite
 //   g_dbg_loss_missing_gap→ overrun (tooth_count > kMaxTeethBeforeLoss)
 // hist_mn/hist_mx = par min/max do último trip de histograma (mx≈1.5×mn = gate
 // no limiar → candidato a relaxar; mx≫mn = falha real → drop correto).
@@ -173,11 +179,24 @@ uint32_t ckp_instant_rpm_x10() noexcept;
 // Retorna true se stall foi detectado nesta chamada (transição → LOSS_OF_SYNC).
 bool ckp_stall_poll(uint32_t tim5_cnt_now) noexcept;
 
+// ── Roda fônica activa ───────────────────────────────────────────────────────
+// Tabelas do padrão em uso (dente → ângulo, gaps). No target é a roda do
+// build (constante, sem custo de indirecção); em host os testes podem trocar
+// de roda para reproduzir streams de cada padrão pela mesma ISR.
+#if defined(EMS_HOST_TEST)
+const TriggerWheel& ckp_wheel() noexcept;
+#else
+inline constexpr const TriggerWheel& ckp_wheel() noexcept { return kTriggerWheel; }
+#endif
+
 // ── API de teste (somente em build host) ──────────────────────────────────────
 #if defined(EMS_HOST_TEST)
+// Repõe o decoder e a roda do build.
 void     ckp_test_reset() noexcept;
 uint32_t ckp_test_rpm_x10_from_period_ns(uint32_t period_ns) noexcept;
 void     ckp_test_set_cmp_confirms(uint8_t n) noexcept;
+// Troca a roda activa (chamar após ckp_test_reset, antes do 1.º dente).
+void     ckp_test_set_wheel(TriggerWheelId id) noexcept;
 #endif
 
 }  // namespace ems::drv
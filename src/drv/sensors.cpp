@@ -27,9 +27,11 @@ using ems::drv::SensorRange;
 using ems::drv::kFallbackMapBarX1000;
 using ems::drv::kFallbackCltDegcX10;
 using ems::drv::kFallbackIatDegcX10;
+using ems::drv::CkpSnapshot;
+using ems::drv::SyncState;
+using ems::drv::kTriggerMaxTeeth;
 
 constexpr uint8_t  kFaultLimit         = 3u;
-constexpr uint16_t kRealTeethPerRev    = 58u;
 constexpr uint16_t kFastSamplesPerRev  = 12u;
 
 constexpr uint16_t kFallbackTpsPctX10  = 0u;
@@ -131,21 +133,23 @@ static bool g_etb2_fault = false;
 static bool g_app_plaus_fault = false;
 static bool g_etb_plaus_fault = false;
 
-static uint16_t g_map_filt  = 0u;
+static uint16_t g_map_filt  = 0u;   // escala ×16 (adc_primary_read_x16)
+
+// MAP síncrona ao ângulo (SQ1 do trigger de dente, hal/adc.h): última amostra por
+// dente do ciclo de 720° (índice = dente + real_teeth na fase B), e o dente
+// que armou o trigger da amostra pendente.
+constexpr uint16_t kMapAngleSlots = 2u * kTriggerMaxTeeth;
+static uint16_t    g_map_angle_bar_x1000[kMapAngleSlots] = {};
+static CkpSnapshot g_map_prev_tooth = {};
+static uint16_t    g_map_sync_x16   = 0u;
+static bool        g_map_sync_valid = false;
 // g_o2_filt removed — O2 is CAN-only; PA5/ADC1_IN6 is now knock sensor input.
 
 static uint16_t g_tps_buf[4]  = {};
 static uint8_t  g_tps_pos     = 0u;
 
-static uint16_t g_clt_buf[8]  = {};
-static uint8_t  g_clt_pos     = 0u;
-static uint16_t g_iat_buf[8]  = {};
-static uint8_t  g_iat_pos     = 0u;
-
-static uint16_t g_fuel_buf[4] = {};
-static uint8_t  g_fuel_pos    = 0u;
-static uint16_t g_oil_buf[4]  = {};
-static uint8_t  g_oil_pos     = 0u;
+// CLT/IAT/FUEL/OIL sem buffer de média: o oversampler (16×) + CIC do ADC2
+// (hal/adc.h, kAdcSecondaryDecimLog2) já entregam o canal à taxa do consumidor.
 
 static uint16_t g_maf_period_buf[4] = {};
 static uint8_t  g_maf_period_pos    = 0u;
@@ -181,24 +185,18 @@ inline void reset_state() noexcept {
     g_data_swap_flag = 0u;  // staging é o buffer válido inicial
 
     g_map_filt  = 0u;
+    g_map_prev_tooth = CkpSnapshot{};
+    g_map_sync_x16    = 0u;
+    g_map_sync_valid  = false;
+    for (uint16_t i = 0u; i < kMapAngleSlots; ++i) { g_map_angle_bar_x1000[i] = 0u; }
 
 
     for (uint8_t i = 0u; i < 4u; ++i) {
         g_tps_buf[i]        = 0u;
-        g_fuel_buf[i]       = 0u;
-        g_oil_buf[i]        = 0u;
         g_maf_period_buf[i] = 0u;
     }
-    for (uint8_t i = 0u; i < 8u; ++i) {
-        g_clt_buf[i] = 0u;
-        g_iat_buf[i] = 0u;
-    }
 
     g_tps_pos        = 0u;
-    g_clt_pos        = 0u;
-    g_iat_pos        = 0u;
-    g_fuel_pos       = 0u;
-    g_oil_pos        = 0u;
     g_maf_period_pos = 0u;
     g_fast_sample_accum    = 0u;
     g_last_rpm_x10         = 0u;
@@ -253,7 +251,8 @@ inline void reset_state() noexcept {
 // Usa int32_t para evitar overflow em operandos uint16_t.
 // Nudge ±1 garante convergência monotônica mesmo quando |delta| < den/num.
 // -----------------------------------------------------------------------------
-inline uint16_t iir(uint16_t y, uint16_t x, int32_t num, int32_t den) noexcept {
+inline uint16_t iir(uint16_t y, uint16_t x, int32_t num, int32_t den,
+                    int32_t hi = 4095) noexcept {
     const int32_t delta = static_cast<int32_t>(x) - static_cast<int32_t>(y);
     int32_t step = (delta * num) / den;
     if (step == 0 && delta != 0) {
@@ -261,7 +260,7 @@ inline uint16_t iir(uint16_t y, uint16_t x, int32_t num, int32_t den) noexcept {
     }
     const int32_t out = static_cast<int32_t>(y) + step;
     if (out <= 0)    { return 0u; }
-    if (out >= 4095) { return 4095u; }
+    if (out >= hi)   { return static_cast<uint16_t>(hi); }
     return static_cast<uint16_t>(out);
 }
 
@@ -323,6 +322,13 @@ inline uint16_t map_raw_to_bar_x1000(uint16_t raw) noexcept {
     return static_cast<uint16_t>((static_cast<uint32_t>(raw) * 3000u) / 4095u);
 }
 
+// Leituras a 16 bits (oversampling): fundo de escala 4095 × 16.
+constexpr uint32_t kAdcX16FullScale = 4095u * 16u;
+
+inline uint16_t map_x16_to_bar_x1000(uint16_t x16) noexcept {
+    return static_cast<uint16_t>((static_cast<uint32_t>(x16) * 3000u) / kAdcX16FullScale);
+}
+
 // O2: 0-5V linear → 0..1000 mV
 inline uint16_t raw_to_mv(uint16_t raw) noexcept {
     return static_cast<uint16_t>((static_cast<uint32_t>(raw) * 1000u) / 4095u);
@@ -451,14 +457,20 @@ inline void sample_fast_channels() noexcept {
         return;  // Sai sem atualizar outros sensores
     }
     
-    const uint16_t map_raw   = ems::hal::adc_primary_read(ems::hal::AdcPrimaryChannel::MAP);
+    // Carga: a última amostra síncrona (ângulo fixo no dente) quando existe;
+    // a saída do CIC só antes da 1.ª amostra síncrona.
+    const uint16_t map_x16   = g_map_sync_valid
+        ? g_map_sync_x16
+        : ems::hal::adc_primary_read_x16(ems::hal::AdcPrimaryChannel::MAP);
+    const uint16_t map_raw   = static_cast<uint16_t>(map_x16 >> 4u);
     const uint16_t mafv_raw  = ems::hal::adc_primary_read(ems::hal::AdcPrimaryChannel::MAF_V);
     const uint16_t tps_raw   = ems::hal::adc_primary_read(ems::hal::AdcPrimaryChannel::TPS);
     // ADC1_IN6 (PA5) formerly O2 — O2 is now CAN-only (wideband via FDCAN1).
     // This channel is repurposed for the knock sensor (piezo + external BP filter).
     const uint16_t knock_raw = ems::hal::adc_primary_read(ems::hal::AdcPrimaryChannel::KNOCK);
 
-    g_map_filt = iir(g_map_filt, map_raw, 3, 10);
+    // Filtro na escala ×16: os bits do oversampler não se perdem no IIR.
+    g_map_filt = iir(g_map_filt, map_x16, 3, 10, static_cast<int32_t>(kAdcX16FullScale));
 
     g_tps_buf[g_tps_pos] = tps_raw;
     g_tps_pos = static_cast<uint8_t>((g_tps_pos + 1u) & 0x3u);
@@ -479,7 +491,7 @@ inline void sample_fast_channels() noexcept {
 
     g_data_staging.map_bar_x1000 = g_fault[static_cast<uint8_t>(SensorId::MAP)].active
                          ? kFallbackMapBarX1000
-                         : map_raw_to_bar_x1000(g_map_filt);
+                         : map_x16_to_bar_x1000(g_map_filt);
 
     // TPS gradient limiter (MS42 §2.2.6.2: histerese + C_TPS_GRD_MAX + confirm no 2º ciclo)
     {
@@ -676,28 +688,56 @@ void sensors_init() noexcept {
 // adc_trigger_on_tooth usa o valor diretamente sem nova conversão.
 void sensors_on_tooth(const CkpSnapshot& snap) noexcept {
     g_last_rpm_x10 = snap.rpm_x10;            // cache p/ check de plausibilidade MAP×TPS
-    const uint32_t ticks = snap.tooth_period_ns >> 4u;
-    ems::hal::adc_trigger_on_tooth(ticks);
 
-    // MAP em janela angular por cilindro (engine/map_window) — gate barato
-    // pelo enable antes de tocar no ADC; mesmo critério de recovery dos
-    // canais rápidos (amostra de ADC em recuperação não entra na média).
-    if (ems::engine::map_window_enable != 0u &&
+    // MAP síncrona ao ângulo: o SQ1 disparado pelo TRGO armado no dente
+    // ANTERIOR (½ passo depois dele) — recolhido antes de armar o próximo e
+    // atribuída ao ângulo desse dente. Mesmo critério de recovery dos canais
+    // rápidos (amostra de ADC em recuperação não entra).
+    uint16_t sync_x16 = 0u;
+    if (ems::hal::adc_map_sync_take(sync_x16) &&
         !ems::hal::adc_is_recovering() && !ems::hal::adc_recovery_failed()) {
-        const uint16_t raw =
-            ems::hal::adc_primary_read(ems::hal::AdcPrimaryChannel::MAP);
-        ems::engine::map_window_on_tooth(snap, map_raw_to_bar_x1000(raw));
+        g_map_sync_x16   = sync_x16;
+        g_map_sync_valid = true;
+        const uint16_t bar = map_x16_to_bar_x1000(sync_x16);
+        if (g_map_prev_tooth.state == SyncState::FULL_SYNC &&
+            g_map_prev_tooth.cmp_confirms >= 2u) {
+            const uint16_t idx = static_cast<uint16_t>(
+                g_map_prev_tooth.tooth_index +
+                (g_map_prev_tooth.phase_A ? 0u : ckp_wheel().real_teeth));
+            if (idx < kMapAngleSlots) { g_map_angle_bar_x1000[idx] = bar; }
+        }
+        // engine/map_window: janela angular por cilindro (no-op com enable=0).
+        ems::engine::map_window_on_tooth(g_map_prev_tooth, bar);
     }
+    g_map_prev_tooth = snap;
+
+    const uint32_t ticks = snap.tooth_period_ns >> 4u;
+    ems::hal::adc_trigger_on_tooth(ticks);
 
     g_fast_sample_accum = static_cast<uint16_t>(
         g_fast_sample_accum + kFastSamplesPerRev);
-    if (g_fast_sample_accum >= kRealTeethPerRev) {
+    // kFastSamplesPerRev amostras por volta, qualquer que seja a roda.
+    const uint16_t real_teeth = ckp_wheel().real_teeth;
+    if (g_fast_sample_accum >= real_teeth) {
         g_fast_sample_accum = static_cast<uint16_t>(
-            g_fast_sample_accum - kRealTeethPerRev);
+            g_fast_sample_accum - real_teeth);
         sample_fast_channels();
     }
 }
 
+uint16_t sensors_map_at_deg_bar_x1000(uint16_t deg720) noexcept {
+    if (deg720 >= 720u) { return 0u; }
+    const TriggerWheel& w = ckp_wheel();
+    const bool phase_b = deg720 >= 360u;
+    const uint16_t d = static_cast<uint16_t>(phase_b ? deg720 - 360u : deg720);
+    // Posição da roda que contém d → último dente real ≤ posição.
+    const uint16_t pos = static_cast<uint16_t>(
+        (static_cast<uint32_t>(d) * w.positions) / 360u);
+    const uint16_t idx = static_cast<uint16_t>(
+        w.pos_to_tooth[pos] + (phase_b ? w.real_teeth : 0u));
+    return (idx < kMapAngleSlots) ? g_map_angle_bar_x1000[idx] : 0u;
+}
+
 void sensors_tick_50ms() noexcept {
     if (g_bench_clt_iat) {
         // Bench HIL: sem sensores de pressão físicos — força valores nominais
@@ -711,36 +751,26 @@ void sensors_tick_50ms() noexcept {
         return;
     }
 
-    const uint16_t fuel_raw = ems::hal::adc_secondary_read(ems::hal::AdcSecondaryChannel::FUEL_PRESS);
-    const uint16_t oil_raw  = ems::hal::adc_secondary_read(ems::hal::AdcSecondaryChannel::OIL_PRESS);
+    // Já decimados (CIC 8× sobre oversampling 16×) à cadência deste tick.
+    const uint16_t fuel_x16 = ems::hal::adc_secondary_read_x16(ems::hal::AdcSecondaryChannel::FUEL_PRESS);
+    const uint16_t oil_x16  = ems::hal::adc_secondary_read_x16(ems::hal::AdcSecondaryChannel::OIL_PRESS);
 
-    g_fuel_buf[g_fuel_pos] = fuel_raw;
-    g_fuel_pos = static_cast<uint8_t>((g_fuel_pos + 1u) & 0x3u);
-
-    g_oil_buf[g_oil_pos] = oil_raw;
-    g_oil_pos = static_cast<uint8_t>((g_oil_pos + 1u) & 0x3u);
-
-    apply_fault(SensorId::FUEL_PRESS, fuel_raw);
-    apply_fault(SensorId::OIL_PRESS,  oil_raw);
+    apply_fault(SensorId::FUEL_PRESS, static_cast<uint16_t>(fuel_x16 >> 4u));
+    apply_fault(SensorId::OIL_PRESS,  static_cast<uint16_t>(oil_x16 >> 4u));
 
     g_data_staging.fuel_press_bar_x1000 = static_cast<uint16_t>(
-        (static_cast<uint32_t>(avg_n(g_fuel_buf, 4)) * 2500u) / 4095u);
+        (static_cast<uint32_t>(fuel_x16) * 2500u) / kAdcX16FullScale);
     g_data_staging.oil_press_bar_x1000 = static_cast<uint16_t>(
-        (static_cast<uint32_t>(avg_n(g_oil_buf, 4)) * 2500u) / 4095u);
+        (static_cast<uint32_t>(oil_x16) * 2500u) / kAdcX16FullScale);
     commit_sensor_snapshot();
 }
 
 // [FIX-3] AN1-4: APP/ETB + passthrough bruto
 void sensors_tick_100ms() noexcept {
+    // Já decimados (CIC 32× sobre oversampling 16×) — sem média de software.
     const uint16_t clt_raw = ems::hal::adc_secondary_read(ems::hal::AdcSecondaryChannel::CLT);
     const uint16_t iat_raw = ems::hal::adc_secondary_read(ems::hal::AdcSecondaryChannel::IAT);
 
-    g_clt_buf[g_clt_pos] = clt_raw;
-    g_clt_pos = static_cast<uint8_t>((g_clt_pos + 1u) & 0x7u);
-
-    g_iat_buf[g_iat_pos] = iat_raw;
-    g_iat_pos = static_cast<uint8_t>((g_iat_pos + 1u) & 0x7u);
-
     if (g_bench_clt_iat) {
         // Banco HIL: sensores físicos ausentes — força valores válidos e limpa
         // ALL faults para que não acionem limp mode (rev-cut a 3000 RPM).
@@ -752,15 +782,12 @@ void sensors_tick_100ms() noexcept {
         apply_fault(SensorId::CLT, clt_raw);
         apply_fault(SensorId::IAT, iat_raw);
 
-        const uint16_t clt_avg = avg_n(g_clt_buf, 8);
-        const uint16_t iat_avg = avg_n(g_iat_buf, 8);
-
         g_data_staging.clt_degc_x10 = g_fault[static_cast<uint8_t>(SensorId::CLT)].active
                               ? kFallbackCltDegcX10
-                              : lut128(g_clt_table, clt_avg);
+                              : lut128(g_clt_table, clt_raw);
         g_data_staging.iat_degc_x10 = g_fault[static_cast<uint8_t>(SensorId::IAT)].active
                               ? kFallbackIatDegcX10
-                              : lut128(g_iat_table, iat_avg);
+                              : lut128(g_iat_table, iat_raw);
     }
 
     const uint16_t app1_raw = ems::hal::adc_primary_read(ems::hal::AdcPrimaryChannel::APP1);
@@ -90,6 +90,11 @@ void sensors_set_range(SensorId id, SensorRange range) noexcept;
 // acessos sucessivos a campos diferentes via referência.
 SensorData sensors_get() noexcept;
 
+// MAP síncrona ao ângulo (SQ1 do trigger a ½ passo após cada dente):
+// última amostra do dente que cobre deg720 no ciclo de 720°, bar × 1000.
+// Preenchido só com FULL_SYNC + fase de came confirmada; 0 = sem amostra.
+uint16_t sensors_map_at_deg_bar_x1000(uint16_t deg720) noexcept;
+
 // CRITICAL FIX: Sensor validation functions
 bool validate_sensor_range(SensorId id, uint16_t raw_value) noexcept;
 bool validate_sensor_values(const SensorData& data) noexcept;
@@ -0,0 +1,221 @@
+/**
+ * @file drv/tooth_geom.cpp
+ * @brief Erro de geometria por dente: lote na ISR, EMA e tabelas no main loop.
+ */
+#include "drv/tooth_geom.h"
+
+#include <cstdint>
+
+#include "drv/ckp.h"
+#include "engine/calibration.h"
+
+namespace ems::drv {
+
+ems::hal::SeqLock<ToothGeomTables> tooth_geom_tables;
+
+}  // namespace ems::drv
+
+namespace {
+
+using ems::drv::kToothGeomOneQ15;
+using ems::drv::kTriggerMaxTeeth;
+
+constexpr uint8_t kEmaShift = 3u;   // α = 1/8 por lote
+
+// Aprendido (main loop).
+uint16_t g_len_q15[kTriggerMaxTeeth];
+// Rascunho do bloco derivado: montado aqui e publicado com uma cópia.
+ems::drv::ToothGeomTables g_build;
+bool     g_identity = true;
+
+// Lote: escrito na ISR enquanto armado; lido/zerado no main loop com a ISR
+// parada (g_armed = false ou g_ready = true).
+volatile uint32_t g_acc_period[kTriggerMaxTeeth];
+volatile uint32_t g_acc_rev[kTriggerMaxTeeth];
+volatile uint8_t  g_batch_revs;
+volatile bool     g_armed;
+volatile bool     g_ready;
+
+uint32_t g_batch_rpm_x10;
+bool     g_batch_fuel_cut;
+uint16_t g_batches;
+uint16_t g_rejected;
+
+void clear_batch() noexcept {
+    for (uint8_t t = 0u; t < kTriggerMaxTeeth; ++t) {
+        g_acc_period[t] = 0u;
+        g_acc_rev[t] = 0u;
+    }
+    g_batch_revs = 0u;
+}
+
+uint16_t inv_q15(uint16_t len) noexcept {
+    return static_cast<uint16_t>((1u << 30u) / len);
+}
+
+// Intervalo normal medido antes do intervalo ti (após um gap: o último
+// normal antes dele — prev_period_ticks do decoder não muda no gap).
+uint8_t prev_normal(const ems::drv::TriggerWheel& w, uint8_t ti) noexcept {
+    uint8_t p = static_cast<uint8_t>((ti == 0u) ? (w.real_teeth - 1u) : (ti - 1u));
+    if (w.span_after[p] != 1u) {
+        p = static_cast<uint8_t>((p == 0u) ? (w.real_teeth - 1u) : (p - 1u));
+    }
+    return p;
+}
+
+void rebuild_tables() noexcept {
+    const ems::drv::TriggerWheel& w = ems::drv::ckp_wheel();
+    // Posições reais em Q15, re-escaladas à volta nominal: a média dos
+    // comprimentos sai da EMA com resto de truncagem, e esse resto acumulado
+    // ao longo da roda deslocaria os últimos dentes. Com o mapa na
+    // identidade sum = total e os inícios são os nominais exactos.
+    const uint32_t total = static_cast<uint32_t>(w.positions) * kToothGeomOneQ15;
+    uint32_t sum = 0u;
+    for (uint8_t t = 0u; t < w.real_teeth; ++t) {
+        sum += static_cast<uint32_t>(g_len_q15[t]) * w.span_after[t];
+    }
+    uint32_t cum = 0u;
+    g_build.start_q15[0] = 0u;
+    for (uint8_t t = 0u; t < w.real_teeth; ++t) {
+        cum += static_cast<uint32_t>(g_len_q15[t]) * w.span_after[t];
+        g_build.start_q15[t + 1u] = static_cast<uint32_t>(
+            (static_cast<uint64_t>(cum) * total + sum / 2u) / sum);
+        g_build.unit_q15[t] =
+            (g_build.start_q15[t + 1u] - g_build.start_q15[t]) / w.span_after[t];
+    }
+    for (uint8_t t = 0u; t < w.real_teeth; ++t) {
+        ems::drv::ToothGeomPred e{};
+        e.inv_cur_q15 = inv_q15(g_len_q15[t]);
+        e.inv_prev_q15 = inv_q15(g_len_q15[prev_normal(w, t)]);
+        const uint8_t next = static_cast<uint8_t>((t + 1u < w.real_teeth) ? (t + 1u) : 0u);
+        e.len_next_q15 = (w.span_after[t] == 1u) ? g_len_q15[next] : kToothGeomOneQ15;
+        g_build.pred[t] = e;
+    }
+    ems::drv::tooth_geom_tables.write(g_build);
+}
+
+void integrate_batch(uint32_t rpm_x10) noexcept {
+    const ems::drv::TriggerWheel& w = ems::drv::ckp_wheel();
+    const uint32_t drpm = (rpm_x10 > g_batch_rpm_x10) ? (rpm_x10 - g_batch_rpm_x10)
+                                                      : (g_batch_rpm_x10 - rpm_x10);
+    if (!g_batch_fuel_cut &&
+        drpm * 100u > g_batch_rpm_x10 * ems::drv::kToothGeomSteadyPct) {
+        ++g_rejected;
+        return;
+    }
+    // Razão = período / (360° / N): comprimento em posições nominais.
+    uint32_t ratio[kTriggerMaxTeeth];
+    uint64_t sum = 0u;
+    uint8_t n = 0u;
+    for (uint8_t t = 0u; t < w.real_teeth; ++t) {
+        ratio[t] = 0u;
+        if (w.span_after[t] != 1u || g_acc_rev[t] == 0u) { continue; }
+        ratio[t] = static_cast<uint32_t>(
+            (static_cast<uint64_t>(g_acc_period[t]) * w.positions * kToothGeomOneQ15) /
+            g_acc_rev[t]);
+        sum += ratio[t];
+        ++n;
+    }
+    if (n == 0u) { ++g_rejected; return; }
+    const uint64_t mean = sum / n;
+    constexpr uint32_t kLo = kToothGeomOneQ15 - kToothGeomOneQ15 * ems::drv::kToothGeomMaxErrPct / 100u;
+    constexpr uint32_t kHi = kToothGeomOneQ15 + kToothGeomOneQ15 * ems::drv::kToothGeomMaxErrPct / 100u;
+    for (uint8_t t = 0u; t < w.real_teeth; ++t) {
+        if (ratio[t] == 0u) { continue; }
+        ratio[t] = static_cast<uint32_t>((static_cast<uint64_t>(ratio[t]) * kToothGeomOneQ15) / mean);
+        // Fora da banda = dente mal medido (resync, ruído): lote inteiro fora.
+        if (ratio[t] < kLo || ratio[t] > kHi) { ++g_rejected; return; }
+    }
+    for (uint8_t t = 0u; t < w.real_teeth; ++t) {
+        if (ratio[t] == 0u) { continue; }
+        const int32_t cur = g_len_q15[t];
+        g_len_q15[t] = static_cast<uint16_t>(
+            cur + ((static_cast<int32_t>(ratio[t]) - cur) >> kEmaShift));
+    }
+    rebuild_tables();
+    g_identity = false;
+    if (g_batches < 0xFFFFu) { ++g_batches; }
+}
+
+}  // namespace
+
+namespace ems::drv {
+
+void tooth_geom_init() noexcept {
+    g_armed = false;
+    g_ready = false;
+    for (uint8_t t = 0u; t < kTriggerMaxTeeth; ++t) {
+        g_len_q15[t] = kToothGeomOneQ15;
+        g_build.pred[t] = {kToothGeomOneQ15, kToothGeomOneQ15, kToothGeomOneQ15, 0u};
+        g_build.unit_q15[t] = kToothGeomOneQ15;
+    }
+    rebuild_tables();
+    clear_batch();
+    g_identity = true;
+    g_batches = 0u;
+    g_rejected = 0u;
+}
+
+void tooth_geom_on_tooth(uint8_t ti, uint32_t period_ticks, uint32_t rev_ticks) noexcept {
+    if (!g_armed || g_ready || ti >= kTriggerMaxTeeth || rev_ticks == 0u) { return; }
+    g_acc_period[ti] += period_ticks;
+    g_acc_rev[ti] += rev_ticks;
+    if (ti == 0u && ++g_batch_revs >= kToothGeomBatchRevs) { g_ready = true; }
+}
+
+void tooth_geom_update(uint32_t rpm_x10, bool fuel_cut, bool full_sync) noexcept {
+    if (ems::engine::tooth_geom_enable == 0u) {
+        if (!g_identity) { tooth_geom_init(); }
+        g_armed = false;
+        return;
+    }
+    if (g_ready) {
+        integrate_batch(rpm_x10);
+        g_armed = false;
+        g_ready = false;
+    }
+    const bool want = full_sync && (fuel_cut || rpm_x10 >= kToothGeomMinRpmX10);
+    if (!want) {
+        g_armed = false;
+        return;
+    }
+    if (!g_armed) {
+        clear_batch();
+        g_batch_rpm_x10 = rpm_x10;
+        g_batch_fuel_cut = fuel_cut;
+        g_armed = true;
+    } else {
+        g_batch_fuel_cut = g_batch_fuel_cut && fuel_cut;
+    }
+}
+
+void tooth_geom_map_position(uint32_t pos_x256, uint8_t* tooth, uint8_t* frac) noexcept {
+    const TriggerWheel& w = ckp_wheel();
+    const ToothGeomTables& g = tooth_geom_tables.view();
+    uint8_t t = w.pos_to_tooth[(pos_x256 >> 8u) % w.positions];
+    const uint32_t pos_q15 = pos_x256 << 7u;   // ×256 → Q15
+    // Erro < ½ posição por dente acumulado: o dente real está a ±1 do nominal.
+    if (t > 0u && pos_q15 < g.start_q15[t]) {
+        --t;
+    } else if (t + 1u < w.real_teeth && pos_q15 >= g.start_q15[t + 1u]) {
+        ++t;
+    }
+    const uint32_t off = (pos_q15 > g.start_q15[t]) ? (pos_q15 - g.start_q15[t]) : 0u;
+    const uint32_t f = (off * 256u) / g.unit_q15[t];
+    *tooth = t;
+    *frac = (f > 255u) ? 255u : static_cast<uint8_t>(f);
+}
+
+uint16_t tooth_geom_len_q15(uint8_t tooth) noexcept {
+    return (tooth < kTriggerMaxTeeth) ? g_len_q15[tooth] : kToothGeomOneQ15;
+}
+
+uint16_t tooth_geom_batches() noexcept {
+    return g_batches;
+}
+
+uint16_t tooth_geom_rejected() noexcept {
+    return g_rejected;
+}
+
+}  // namespace ems::drv
@@ -0,0 +1,98 @@
+#pragma once
+
+/**
+ * @file drv/tooth_geom.h
+ * @brief Erro de geometria por dente da roda fônica: aprendizagem + correcção.
+ *
+ * O decoder e o scheduler assumem dentes igualmente espaçados (6° na 60-2):
+ * a predição do período seguinte e o sub_frac_x256 das tabelas angulares
+ * escalam o período corrente. Uma roda real tem erro de maquinação/montagem
+ * por dente — é por isso que ckp_instant_rpm_x10 compara o MESMO dente de
+ * voltas consecutivas. Este módulo aprende esse erro e devolve-o ao decoder.
+ *
+ *   intervalo t — do dente real t ao seguinte (span_after[t] posições);
+ *                 len_q15[t] = comprimento real / nominal (32768 = 1.0).
+ *   aprender    — na ISR do CKP, só com o lote armado: soma por intervalo do
+ *                 período medido e do período de 360° terminado no mesmo
+ *                 dente (referência sem erro de geometria). A cada
+ *                 kToothGeomBatchRevs voltas o main loop converte o lote em
+ *                 razões, normaliza-as à média (a tendência de aceleração
+ *                 desfasa todas as referências por igual) e faz EMA. Armado
+ *                 em corte de desaceleração (sem pulsação de combustão) ou em
+ *                 cruzeiro estável (lote rejeitado se o RPM variar > 2 %).
+ *   aplicar     — predict (ISR): período corrente → nominal → comprimento do
+ *                 intervalo seguinte, numa só leitura de tooth_geom_pred(ti);
+ *                 ângulo → (dente, sub_frac) no builder das tabelas (frio,
+ *                 no gap) pelas posições reais acumuladas, em Q15 e
+ *                 renormalizadas para que a volta feche exactamente em
+ *                 positions (sem deriva de arredondamento ao longo da roda).
+ *
+ * Intervalos que atravessam um gap não são aprendidos (1.0). Com
+ * tooth_geom_enable = 0 as tabelas ficam na identidade e tanto a predição
+ * como o mapeamento angular são exactamente os nominais.
+ *
+ * As tabelas derivadas (preditor + posições do builder) formam um bloco
+ * publicado por seqlock (hal/seqlock.h): o main loop reconstrói o buffer
+ * inactivo entre lotes e troca o índice. Os dois leitores — predict e o
+ * builder angular — correm na ISR do CKP, que o main loop não preempta, e
+ * usam view(): sem cópia nem espera no caminho quente, e nunca uma entrada
+ * ou uma tabela a meio de ser reescrita.
+ */
+
+#include <cstdint>
+
+#include "drv/trigger_wheel.h"
+#include "hal/seqlock.h"
+
+namespace ems::drv {
+
+constexpr uint16_t kToothGeomOneQ15    = 32768u;
+constexpr uint8_t  kToothGeomBatchRevs = 8u;
+constexpr uint8_t  kToothGeomMaxErrPct = 10u;   // |erro| aceite por intervalo
+constexpr uint8_t  kToothGeomSteadyPct = 2u;    // Δrpm máximo num lote de cruzeiro
+constexpr uint32_t kToothGeomMinRpmX10 = 12000u; // cruzeiro: acima do ralenti
+
+// Entrada do preditor indexada pelo intervalo acabado de medir (ti = dente
+// onde começou): normaliza o período corrente e o anterior e escala para o
+// intervalo seguinte.
+struct ToothGeomPred {
+    uint16_t inv_cur_q15;    // 1 / len[ti]
+    uint16_t inv_prev_q15;   // 1 / len do intervalo normal anterior
+    uint16_t len_next_q15;   // len[dente seguinte]
+    uint16_t pad;
+};
+
+// Bloco derivado do comprimento aprendido, reconstruído inteiro por lote.
+struct ToothGeomTables {
+    ToothGeomPred pred[kTriggerMaxTeeth];
+    uint32_t start_q15[kTriggerMaxTeeth + 1u];   // início real do dente, posições Q15
+    uint32_t unit_q15[kTriggerMaxTeeth];         // uma posição do intervalo, Q15
+};
+
+extern ems::hal::SeqLock<ToothGeomTables> tooth_geom_tables;
+
+// Leitura na ISR do CKP (predict_next_period_ticks).
+inline const ToothGeomPred& tooth_geom_pred(uint8_t ti) noexcept {
+    return tooth_geom_tables.view().pred[ti];
+}
+
+// Identidade (boot, troca de roda, reset de testes).
+void tooth_geom_init() noexcept;
+
+// ISR do CKP, dente normal em FULL_SYNC: intervalo ti acabado de medir e o
+// período de 360° terminado na mesma borda (0 = ainda sem volta).
+void tooth_geom_on_tooth(uint8_t ti, uint32_t period_ticks, uint32_t rev_ticks) noexcept;
+
+// Main loop (2 ms): arma/desarma o lote e integra lotes completos.
+void tooth_geom_update(uint32_t rpm_x10, bool fuel_cut, bool full_sync) noexcept;
+
+// Ângulo em posições ×256 desde o dente 0 → dente real + fracção do período
+// desse dente (×256, saturada a 255 dentro de um gap). Builder angular.
+void tooth_geom_map_position(uint32_t pos_x256, uint8_t* tooth, uint8_t* frac) noexcept;
+
+// Comprimento aprendido do intervalo (Q15) e lotes integrados (satura).
+uint16_t tooth_geom_len_q15(uint8_t tooth) noexcept;
+uint16_t tooth_geom_batches() noexcept;
+uint16_t tooth_geom_rejected() noexcept;
+
+}  // namespace ems::drv
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ems::drv {
+
+// ── Roda fônica N-M: descrição → tabelas constexpr ───────────────────────────
+// Uma roda é N posições uniformes (360°/N) com 1..kTriggerMaxGaps gaps de M
+// posições ausentes. As posições contam-se a partir do dente 0 = primeiro
+// dente real após o gap de referência, que é o ÚLTIMO gap da lista (termina
+// na posição N ≡ 0). tooth_index do CkpSnapshot = índice do dente REAL
+// (0 .. real_teeth−1), não da posição.
+//
+// make_trigger_wheel() compila a descrição em tabelas por dente consumidas
+// pelo decoder único de drv/ckp.cpp (sem ramos por tipo de roda na ISR) e
+// pelos builders angulares (ecu_sched_angle, misfire, map_window).
+//
+// Identificação de rodas com vários gaps: sem referência angular, o nº de
+// dentes normais medido antes de um gap só identifica a posição quando o
+// segmento é o mais longo da roda (ident_next_tooth). Segmentos mais curtos
+// (ex.: 7/7 na 36-2-2-2) só são seguidos depois do sync pelo segmento longo.
+
+constexpr uint8_t kTriggerMaxGaps      = 4u;
+constexpr uint8_t kTriggerMaxPositions = 64u;
+constexpr uint8_t kTriggerMaxTeeth     = 64u;  // máscaras de dente do ecu_sched (2 × u32)
+constexpr uint8_t kTriggerNoTooth      = 0xFFu;
+
+enum class TriggerWheelId : uint8_t {
+    Wheel60_2,
+    Wheel36_1,
+    Wheel36_2_2_2,
+};
+
+struct TriggerPattern {
+    uint8_t positions;                   // N
+    uint8_t gap_count;
+    uint8_t gap_pos[kTriggerMaxGaps];    // 1.ª posição ausente de cada gap (crescente)
+    uint8_t gap_len[kTriggerMaxGaps];    // posições ausentes
+    uint8_t cam_open_tooth;              // janela CMP default (0/0 = sem gate);
+    uint8_t cam_close_tooth;             // cmp_window_* da calibração sobrepõe
+};
+
+struct TriggerWheel {
+    uint8_t  positions;
+    uint8_t  real_teeth;
+    uint8_t  gap_count;
+    uint8_t  max_seg_teeth;              // maior segmento (dentes entre gaps)
+    uint8_t  cam_open_tooth;
+    uint8_t  cam_close_tooth;
+    uint32_t rpm_x10_num;                // rpm×10 = rpm_x10_num / período de posição (ticks TIM5)
+    uint8_t  tooth_pos[kTriggerMaxTeeth];        // posição do dente
+    uint16_t tooth_deg_x10[kTriggerMaxTeeth];    // ângulo do dente (0.1°)
+    uint8_t  span_after[kTriggerMaxTeeth];       // posições até ao dente seguinte (>1 = gap)
+    uint8_t  gap_min_count[kTriggerMaxTeeth];    // dentes normais mínimos no segmento p/ aceitar o gap
+    uint8_t  next_seg_tooth[kTriggerMaxTeeth];   // dente que segue o gap do segmento
+    uint8_t  ident_next_tooth[kTriggerMaxTeeth]; // [normais medidos sem sync] → dente após o gap (0xFF = ambíguo)
+    uint8_t  pos_to_tooth[kTriggerMaxPositions]; // último dente real ≤ posição
+};
+
+constexpr TriggerWheel make_trigger_wheel(const TriggerPattern& p) {
+    TriggerWheel w{};
+    w.positions = p.positions;
+    w.gap_count = p.gap_count;
+    w.cam_open_tooth = p.cam_open_tooth;
+    w.cam_close_tooth = p.cam_close_tooth;
+    // TIM5 62.5 MHz: rpm×10 = 60 s × 62.5e6 × 10 / (N × ticks).
+    w.rpm_x10_num = static_cast<uint32_t>(37500000000ull / p.positions);
+
+    // Dentes reais e posição de cada um.
+    uint8_t n = 0u;
+    for (uint8_t pos = 0u; pos < p.positions; ++pos) {
+        bool missing = false;
+        for (uint8_t g = 0u; g < p.gap_count; ++g) {
+            if (pos >= p.gap_pos[g] && pos < p.gap_pos[g] + p.gap_len[g]) { missing = true; }
+        }
+        if (!missing) {
+            w.tooth_pos[n] = pos;
+            w.tooth_deg_x10[n] = static_cast<uint16_t>((pos * 3600u) / p.positions);
+            ++n;
+        }
+        w.pos_to_tooth[pos] = static_cast<uint8_t>((n == 0u) ? 0u : n - 1u);
+    }
+    w.real_teeth = n;
+
+    for (uint8_t t = 0u; t < n; ++t) {
+        const uint8_t next_pos = (t + 1u < n) ? w.tooth_pos[t + 1u] : p.positions;
+        w.span_after[t] = static_cast<uint8_t>(next_pos - w.tooth_pos[t]);
+    }
+
+    // Segmentos: [first .. last] termina num dente com span_after > 1.
+    uint8_t seg_normals[kTriggerMaxGaps] = {};
+    uint8_t seg_next[kTriggerMaxGaps] = {};
+    uint8_t seg_min[kTriggerMaxGaps] = {};
+    uint8_t segs = 0u;
+    uint8_t first = 0u;
+    for (uint8_t t = 0u; t < n && segs < kTriggerMaxGaps; ++t) {
+        if (w.span_after[t] <= 1u) { continue; }
+        const uint8_t teeth = static_cast<uint8_t>(t - first + 1u);
+        const uint8_t normals = static_cast<uint8_t>(teeth - 1u);
+        // Folga de dentes rejeitados como ruído antes do gap: 2 (60-2: ≥55 de
+        // 57), menos em segmentos curtos para não aceitar o gap anterior.
+        const uint8_t tol = (normals / 4u < 2u) ? static_cast<uint8_t>(normals / 4u) : 2u;
+        const uint8_t next = (t + 1u < n) ? static_cast<uint8_t>(t + 1u) : 0u;
+        for (uint8_t k = first; k <= t; ++k) {
+            w.gap_min_count[k] = static_cast<uint8_t>(normals - tol);
+            w.next_seg_tooth[k] = next;
+        }
+        if (teeth > w.max_seg_teeth) { w.max_seg_teeth = teeth; }
+        seg_normals[segs] = normals;
+        seg_next[segs] = next;
+        seg_min[segs] = static_cast<uint8_t>(normals - tol);
+        ++segs;
+        first = static_cast<uint8_t>(t + 1u);
+    }
+
+    // Identificação sem referência: só o segmento mais longo, e só se nenhum
+    // outro chega ao seu mínimo — uma contagem parcial (sync perdido a meio
+    // de um segmento) fica sempre abaixo e nunca identifica o gap errado.
+    // Contagens acima do segmento (dentes extra em LOSS) identificam-no
+    // também, como o "count ≥ 55" original da 60-2.
+    for (uint8_t m = 0u; m < kTriggerMaxTeeth; ++m) { w.ident_next_tooth[m] = kTriggerNoTooth; }
+    uint8_t longest = 0u;
+    for (uint8_t s = 1u; s < segs; ++s) {
+        if (seg_normals[s] > seg_normals[longest]) { longest = s; }
+    }
+    bool unique = (segs != 0u);
+    for (uint8_t s = 0u; s < segs; ++s) {
+        if (s != longest && seg_normals[s] >= seg_min[longest]) { unique = false; }
+    }
+    if (unique) {
+        for (uint8_t m = seg_min[longest]; m < kTriggerMaxTeeth; ++m) {
+            w.ident_next_tooth[m] = seg_next[longest];
+        }
+    }
+    return w;
+}
+
+// ── Rodas suportadas ─────────────────────────────────────────────────────────
+// 60-2:     gap de 2 nas posições 58-59 (6°/posição).
+// 36-1:     gap de 1 na posição 35 (10°/posição).
+// 36-2-2-2: segmentos de 16/7/7 dentes, gaps de 2 (10°/posição); sync pelo
+//           gap após o segmento de 16.
+inline constexpr TriggerPattern kPattern60_2 = {60u, 1u, {58u, 0u, 0u, 0u}, {2u, 0u, 0u, 0u}, 0u, 0u};
+inline constexpr TriggerPattern kPattern36_1 = {36u, 1u, {35u, 0u, 0u, 0u}, {1u, 0u, 0u, 0u}, 0u, 0u};
+inline constexpr TriggerPattern kPattern36_2_2_2 = {
+    36u, 3u, {16u, 25u, 34u, 0u}, {2u, 2u, 2u, 0u}, 0u, 0u};
+
+inline constexpr TriggerWheel kWheel60_2     = make_trigger_wheel(kPattern60_2);
+inline constexpr TriggerWheel kWheel36_1     = make_trigger_wheel(kPattern36_1);
+inline constexpr TriggerWheel kWheel36_2_2_2 = make_trigger_wheel(kPattern36_2_2_2);
+
+constexpr bool trigger_wheel_valid(const TriggerPattern& p, const TriggerWheel& w) {
+    if (p.positions == 0u || p.positions > kTriggerMaxPositions ||
+        p.gap_count == 0u || p.gap_count > kTriggerMaxGaps) {
+        return false;
+    }
+    // Gap de referência termina na posição N (dente 0 = posição 0).
+    const uint8_t last = static_cast<uint8_t>(p.gap_count - 1u);
+    if (p.gap_pos[last] + p.gap_len[last] != p.positions) { return false; }
+    for (uint8_t g = 0u; g < p.gap_count; ++g) {
+        if (p.gap_len[g] == 0u) { return false; }
+        if (g != 0u && p.gap_pos[g] <= p.gap_pos[g - 1u] + p.gap_len[g - 1u]) { return false; }
+    }
+    // Segmento mais longo inequívoco (senão o sync nunca identifica a posição).
+    for (uint8_t m = 0u; m < kTriggerMaxTeeth; ++m) {
+        if (w.ident_next_tooth[m] != kTriggerNoTooth) { return true; }
+    }
+    return false;
+}
+static_assert(trigger_wheel_valid(kPattern60_2, kWheel60_2), "60-2");
+static_assert(trigger_wheel_valid(kPattern36_1, kWheel36_1), "36-1");
+static_assert(trigger_wheel_valid(kPattern36_2_2_2, kWheel36_2_2_2), "36-2-2-2");
+static_assert(kWheel60_2.real_teeth == 58u && kWheel60_2.gap_min_count[0] == 55u &&
+              kWheel60_2.ident_next_tooth[55] == 0u &&
+              kWheel60_2.ident_next_tooth[54] == kTriggerNoTooth &&
+              kWheel60_2.max_seg_teeth == 58u && kWheel60_2.rpm_x10_num == 625000000u,
+              "60-2 tem de reproduzir as constantes do decoder original");
+
+// Roda do build: make TRIGGER=36-1 | 36-2-2-2 (default 60-2).
+#if defined(EMS_TRIGGER_36_1)
+inline constexpr TriggerWheelId kTriggerWheelId = TriggerWheelId::Wheel36_1;
+inline constexpr const TriggerWheel& kTriggerWheel = kWheel36_1;
+#elif defined(EMS_TRIGGER_36_2_2_2)
+inline constexpr TriggerWheelId kTriggerWheelId = TriggerWheelId::Wheel36_2_2_2;
+inline constexpr const TriggerWheel& kTriggerWheel = kWheel36_2_2_2;
+#else
+inline constexpr TriggerWheelId kTriggerWheelId = TriggerWheelId::Wheel60_2;
+inline constexpr const TriggerWheel& kTriggerWheel = kWheel60_2;
+#endif
+
+constexpr const TriggerWheel& trigger_wheel_for(TriggerWheelId id) {
+    return (id == TriggerWheelId::Wheel36_1)     ? kWheel36_1
+         : (id == TriggerWheelId::Wheel36_2_2_2) ? kWheel36_2_2_2
+                                                 : kWheel60_2;
+}
+
+}  // namespace ems::drv
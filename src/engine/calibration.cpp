@@ -180,6 +180,7 @@ uint16_t etb_ki_x10 = 8u;
 uint16_t etb_kd_x10 = 40u;
 uint8_t etb_cal_valid = 0u;
 uint8_t etb_harness_present = 0u;
+uint16_t etb_loop_rate_hz = 1000u;   // ISR do TIM7 a 1 kHz
 uint16_t etb_pedal_map[4][10] = {
     {   0,  80, 150, 220, 300, 400, 520, 650, 800, 1000},  // ECO
     {   0, 100, 200, 300, 400, 500, 600, 700, 800, 1000},  // NORMAL
@@ -194,6 +195,8 @@ int8_t cyl_ign_trim_deg[cfg::kCylinderCount]  = {};  // 0 = sem correção
 uint8_t cmp_window_open_tooth  = 0u;  // 0/0 = desabilitado
 uint8_t cmp_window_close_tooth = 0u;
 uint8_t ckp_skip_pulses_after_gap = 0u;  // 0 = desligado
+uint8_t tooth_geom_enable = 0u;          // 0 = roda nominal
+uint8_t diag_freeze_vars[kDiagFreezeVarSlots] = {};  // 0 = conjunto default
 
 uint8_t  inj_duty_max_pct  = 0u;   // 0 = protecção desligada
 uint8_t  inj_duty_tol_ms10 = 30u;  // 300 ms de tolerância acima do limite
@@ -203,9 +206,24 @@ uint8_t  decel_cut_gear_inhibit_ms10 = 0u;  // 0 = sem inibição pós-troca
 
 uint8_t knock_dead_min_p2p = 0u;   // 0 = detecção de sensor morto desligada
 
+uint16_t knock_band_hz           = 0u;  // 0 = DSP desligado (contagem legada)
+uint8_t  knock_intensity_thr_x10 = 0u;  // 0 = 3.0× o fundo
+uint8_t  knock_learn_step_x10    = 0u;  // 0 = mapa aprendido desligado
+uint8_t  knock_learn_max_x10     = 0u;  // 0 = 6.0°
+
+uint8_t  misfire_accel_enable    = 0u;  // 0 = detector legado (soma × 1.12)
+uint8_t  misfire_rough_ratio_pct = 0u;  // 0 = 60 % do limiar
+uint16_t misfire_thr_rad_s2[kMisfireThrTableSize][kMisfireThrTableSize] = {};  // 0 = default
+
 uint8_t  map_window_enable   = 0u;    // 0 = desligado
 uint16_t map_window_open_deg = 0u;    // slot 0 abre no dente 0 (pós-gap)
 uint16_t map_window_len_deg  = 90u;   // meia fase de admissão
+uint8_t  map_balance_gain_pct = 0u;   // 0 = sem correcção por cilindro
+
+uint8_t  map_pred_gain_pct     = 0u;    // 0 = fuel usa o MAP fundido actual
+uint16_t map_pred_ivc_btdc_deg = 140u;  // IVC 40° ABDC
+
+uint8_t can_fd_telemetry_enable = 0u;  // 0 = FDCAN clássico (sem stream FD)
 
 uint16_t boost_target_bar_x1000[7][8] = {
     {1000u, 1020u, 1050u, 1080u, 1100u, 1120u, 1150u, 1180u},  // 0: neutro
@@ -122,6 +122,9 @@ extern uint16_t etb_ki_x10;
 extern uint16_t etb_kd_x10;
 extern uint8_t  etb_cal_valid;
 extern uint8_t  etb_harness_present;
+// Malha de posição na ISR do TIM7 (engine/etb_loop, página 0 273-274): taxa
+// em Hz, 1000–2000; 0 = PID no slot de 2 ms do main loop.
+extern uint16_t etb_loop_rate_hz;
 // Pedal-to-throttle response maps: 4 modes × 10 points, units pct×10 (0–1000).
 // Axis is fixed: pedal 0%,10%,...,90%,100%. Points[0]=0 and [9]=1000 are enforced.
 extern uint16_t etb_pedal_map[4][10];
@@ -160,13 +163,52 @@ extern uint8_t  decel_cut_gear_inhibit_ms10;
 // 0 = detecção desligada (default).
 extern uint8_t knock_dead_min_p2p;
 
+// Knock DSP em banda (engine/knock_dsp): frequência de ressonância do bloco
+// em Hz (0 = DSP desligado → contagem por threshold, default) e limiar de
+// intensidade face ao ruído de fundo do cilindro (×10; 0 = default 3.0×).
+extern uint16_t knock_band_hz;
+extern uint8_t  knock_intensity_thr_x10;
+
+// Mapa aprendido de retardo (engine/knock_learn, página 0 275-276): crédito
+// por evento de knock com peso total (°×10; 0 = mapa desligado, default) e
+// tecto do retardo aprendido (°×10; 0 = 6.0°, máximo 12.7°).
+extern uint8_t knock_learn_step_x10;
+extern uint8_t knock_learn_max_x10;
+
+// Misfire por cinemática da cambota (engine/misfire_detect, página 0
+// 277-310). enable: 0 = soma de períodos × 1.12 (legado, default), 1 =
+// aceleração angular por cilindro com padrão do volante aprendido.
+// rough_ratio_pct: ruído de fundo (EMA de |α|) acima desta % do limiar =
+// estrada irregular → janelas não avaliadas (0 = 60 %). Limiar de
+// desaceleração em rad/s² por RPM × carga (eixos kMisfireThr*Axis*; célula
+// 0 = default de compilação).
+constexpr uint8_t kMisfireThrTableSize = 4u;
+extern uint8_t  misfire_accel_enable;
+extern uint8_t  misfire_rough_ratio_pct;
+extern uint16_t misfire_thr_rad_s2[kMisfireThrTableSize][kMisfireThrTableSize];
+
 // MAP janela angular por cilindro (engine/map_window, estilo FOME #610).
 // enable: 0=off (default), 1=medir (telemetria/balance; sem efeito no fuel).
 // open_deg: abertura da janela do slot 0 no ciclo 720° (0-719; slots seguintes
 // a +180° cada). len_deg: duração da janela (10-180°).
+// balance_gain_pct: 0 = só medição (default); >0 = o desvio do slot corrige o
+// PW do cilindro (engine/cyl_pulse) com este ganho, limitado a ±10%.
 extern uint8_t  map_window_enable;
 extern uint16_t map_window_open_deg;
 extern uint16_t map_window_len_deg;
+extern uint8_t  map_balance_gain_pct;
+
+// Predição de MAP ao IVC para o fuel (engine/map_estimator, página 0 270-272).
+// gain_pct: fracção do incremento previsto aplicada ao MAP do PW (0 = off,
+// default; 100 = MAP previsto inteiro). ivc_btdc_deg: fecho da admissão em °
+// antes do PMS de combustão (tipicamente 120-160; 40° ABDC = 140).
+extern uint8_t  map_pred_gain_pct;
+extern uint16_t map_pred_ivc_btdc_deg;
+
+// Telemetria CAN FD por ciclo (app/can_fd_telemetry): 0=off (FDCAN clássico,
+// default), 1=liga FD+BRS e transmite 0x410 (64 B) a cada ciclo de 720°,
+// mais o histórico de knock 0x411 a cada 8 ciclos.
+extern uint8_t can_fd_telemetry_enable;
 
 // CKP: nº de dentes descartados após silêncio ≥ timeout de stall (arranque,
 // stall, religação do sensor) antes de re-entrar no bootstrap do histórico —
@@ -174,6 +216,17 @@ extern uint16_t map_window_len_deg;
 // triggerSkipPulses). 0 = desligado (comportamento anterior).
 extern uint8_t ckp_skip_pulses_after_gap;
 
+// CKP: 1 = aprende o erro de geometria por dente em corte/cruzeiro e corrige
+// a predição do período e o mapeamento ângulo→dente (drv/tooth_geom).
+// 0 = dentes igualmente espaçados (comportamento anterior).
+extern uint8_t tooth_geom_enable;
+
+// Freeze frame dos DTCs (engine/diagnostic_manager): FreezeVar por palavra.
+// Tudo 0 = conjunto default (RPM, MAP, TPS, CLT, IAT, VBATT, pressão de
+// combustível, estado de sync); entrada 0 numa lista configurada = palavra livre.
+constexpr uint8_t kDiagFreezeVarSlots = 8u;
+extern uint8_t diag_freeze_vars[kDiagFreezeVarSlots];
+
 extern uint8_t  xtau_autocal_enabled;
 extern uint8_t  xtau_autocal_active;
 extern int8_t   xtau_autocal_tau_delta[kCorrectionTableSize];
@@ -1,6 +1,8 @@
 #pragma once
 #include <cstdint>
 
+#include "engine/engine_config.h"
+
 namespace ems::engine {
 
 // ============================================================================
@@ -20,20 +22,14 @@ inline constexpr uint32_t kMinCompareLeadTicks = 50u;
 inline constexpr uint32_t kTimIgnMaxDelta16 = 0xFFFFu;
 
 // ============================================================================
-// Engine Physical Constants (60-2 tooth wheel)
+// Engine Physical Constants
 // ============================================================================
 
-/** Total teeth on 60-2 wheel including missing teeth */
-inline constexpr uint16_t kTeethPerRev60_2 = 60u;
-
-/** Actual physical teeth (60 - 2 missing) */
-inline constexpr uint16_t kRealTeeth60_2 = 58u;
-
-/** Angle per tooth in millidegrees (720° / 58 teeth ≈ 12.4138° = 12413.8 mdeg) */
-inline constexpr uint32_t kToothAngleMillideg = (720000u / kRealTeeth60_2);
+// Trigger-wheel geometry (teeth, gaps, angle per tooth) lives in
+// drv/trigger_wheel.h — selected at build time (make TRIGGER=...).
 
-/** Number of cylinders in engine */
-inline constexpr uint8_t kCylinderCount = 4u;
+/** Number of cylinders in engine (build-time, engine_config.h / EMS_CYLINDERS) */
+inline constexpr uint8_t kCylinderCount = cfg::kCylinderCount;
 
 /** Crank degrees per engine cycle (4-stroke) */
 inline constexpr uint32_t kCrankDegreesPerCycle = 720u;
@@ -98,7 +94,7 @@ inline constexpr uint32_t kFlashProgramMaxTimeUs = 200u;
 /** First flash operation after power-on CPU freeze time in microseconds */
 inline constexpr uint32_t kFlashFirstOpFreezeTimeUs = 120u;
 
-/** Safe RPM threshold below which flash writes are allowed (300 RPM × 10) */
+/** Safe RPM threshold below which the first flash write after reset is allowed (300 RPM × 10) */
 inline constexpr uint32_t kFlashWriteSafeRpmX10 = 3000u;
 
 /** Minimum interval between calibration saves in milliseconds */
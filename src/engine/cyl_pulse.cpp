@@ -0,0 +1,88 @@
+/**
+ * @file engine/cyl_pulse.cpp
+ * @brief Espalhamento por cilindro do PW/avanço do slot de 2 ms.
+ */
+#include "engine/cyl_pulse.h"
+
+#include "engine/calibration.h"
+#include "engine/engine_config.h"
+#include "engine/ign_calc.h"
+#include "engine/knock.h"
+#include "engine/map_window.h"
+
+namespace ems::engine {
+
+namespace {
+
+constexpr int32_t kBalanceLimitX1000 = 100;  // ±10%
+
+int16_t g_balance_x1000[cfg::kCylinderCount] = {};
+
+uint16_t clamp_sched_advance(int32_t adv) noexcept {
+    // Mesmo intervalo que o main loop comita (clamp_advance_deg, ≥ 0 no scheduler).
+    const int16_t c = clamp_advance_deg(static_cast<int16_t>(
+        adv < -32768 ? -32768 : (adv > 32767 ? 32767 : adv)));
+    return (c < 0) ? 0u : static_cast<uint16_t>(c);
+}
+
+}  // namespace
+
+int16_t cyl_pulse_build(const CylPulseInput& in, EcuSchedCylVector* out) noexcept {
+    // Ganho/MAP uma vez por slot (Q16) — por cilindro só multiplicações.
+    uint32_t bal_gain_q16 = 0u;
+    if (map_balance_gain_pct != 0u && map_window_enable != 0u && in.map_bar_x100 != 0u) {
+        bal_gain_q16 = (static_cast<uint32_t>(map_balance_gain_pct) << 16u) / in.map_bar_x100;
+    }
+
+    // ⌈2³²/MAP_ref⌉: uma divisão por slot, razão por cilindro em UMULL
+    // (arredondada por excesso → fluxo exacto quando a razão é inteira).
+    uint32_t map_ref_inv_q32 = 0u;
+    if (in.map_ivc_bar_x100 != nullptr && in.map_ref_bar_x100 > 1u) {
+        map_ref_inv_q32 = 0xFFFFFFFFu / in.map_ref_bar_x100 + 1u;
+    }
+
+    uint16_t max_retard_x10 = 0u;
+    for (uint8_t cyl = 0u; cyl < cfg::kCylinderCount; ++cyl) {
+        int32_t bal = 0;
+        if (bal_gain_q16 != 0u) {
+            const int32_t dev = map_window_balance_x1000(cfg::cyl_firing_pos(cyl));
+            bal = static_cast<int32_t>(
+                (static_cast<int64_t>(dev) * static_cast<int64_t>(bal_gain_q16)) >> 16);
+            if (bal > kBalanceLimitX1000) { bal = kBalanceLimitX1000; }
+            if (bal < -kBalanceLimitX1000) { bal = -kBalanceLimitX1000; }
+        }
+        g_balance_x1000[cyl] = static_cast<int16_t>(bal);
+
+        const int32_t trim = static_cast<int32_t>(cyl_fuel_trim_pct[cyl]);
+        uint32_t flow = in.flow_pw_us;
+        if (flow != 0u && map_ref_inv_q32 != 0u &&
+            in.map_ivc_bar_x100[cyl] != in.map_ref_bar_x100) {
+            // MAP ≤ 300 → razão < 2⁴⁰; × fluxo ≤ 2¹⁸ cabe em 64 bits.
+            const uint64_t ratio_q32 =
+                static_cast<uint64_t>(in.map_ivc_bar_x100[cyl]) * map_ref_inv_q32;
+            flow = static_cast<uint32_t>((static_cast<uint64_t>(flow) * ratio_q32) >> 32u);
+        }
+        if (flow != 0u) {
+            const int32_t t = static_cast<int32_t>(flow) * (100 + trim) / 100;
+            flow = (t <= 0) ? 0u : static_cast<uint32_t>(t);
+            // flow ≤ ~230 ms × 1100 cabe em 32 bits (÷1000 constante → mul).
+            flow = flow * static_cast<uint32_t>(1000 + bal) / 1000u;
+        }
+        const uint32_t pw_us = (flow != 0u) ? flow + in.dead_time_us : 0u;
+        out->inj_pw_ticks[cyl] = inj_pw_us_to_scheduler_ticks(pw_us);
+
+        const uint16_t retard_x10 = in.knock_enable ? knock_get_retard_x10(cyl) : 0u;
+        if (retard_x10 > max_retard_x10) { max_retard_x10 = retard_x10; }
+        out->advance_deg[cyl] = clamp_sched_advance(
+            static_cast<int32_t>(in.advance_deg) - static_cast<int32_t>(retard_x10 / 10u) +
+            static_cast<int32_t>(cyl_ign_trim_deg[cyl]));
+    }
+    return clamp_advance_deg(static_cast<int16_t>(
+        in.advance_deg - static_cast<int16_t>(max_retard_x10 / 10u)));
+}
+
+int16_t cyl_pulse_balance_x1000(uint8_t cyl) noexcept {
+    return (cyl < cfg::kCylinderCount) ? g_balance_x1000[cyl] : 0;
+}
+
+}  // namespace ems::engine
@@ -0,0 +1,52 @@
+#pragma once
+
+/**
+ * @file engine/cyl_pulse.h
+ * @brief Vector PW/avanço por cilindro para ecu_sched_commit_calibration_cyl.
+ *
+ * O slot de 2 ms continua a calcular UM fluxo (fuel_pw_kernel) e UM avanço;
+ * aqui só se espalham por cilindro as correcções individuais — custo O(N)
+ * em inteiros, sem repetir a cadeia de fuel:
+ *
+ *   fluxo_cil = fluxo × MAP_IVC[cil] / MAP_ref × (1 + cyl_fuel_trim_pct)
+ *                     × (1 + balance MAP)
+ *   PW_cil    = fluxo_cil + dead-time   (dead-time por cilindro, nunca escala;
+ *                                        0 se fluxo_cil = 0)
+ *   avanço    = avanço − retardo knock[cil] + cyl_ign_trim_deg
+ *
+ * Balance MAP: desvio EMA da janela angular do slot do cilindro
+ * (map_window_balance_x1000, slot = posição de disparo) relativo ao MAP
+ * médio, × map_balance_gain_pct; limitado a ±10%. Cilindro com mais ar na
+ * janela recebe mais combustível. Requer map_window_enable.
+ *
+ * MAP ao IVC: o fluxo do slot foi calculado com MAP_ref (predição do próximo
+ * cilindro servido); em transiente cada cilindro fecha a admissão noutro
+ * instante e o speed-density escala linearmente com o MAP previsto para o
+ * SEU IVC (map_estimator_predict_ivc_cyl). nullptr = sem escala.
+ */
+
+#include <cstdint>
+
+#include "engine/ecu_sched.h"
+
+namespace ems::engine {
+
+struct CylPulseInput {
+    uint32_t flow_pw_us;        // fluxo após ΔP/S-curve (sem dead-time)
+    uint16_t dead_time_us;
+    int16_t  advance_deg;       // avanço total SEM retardo de knock
+    uint16_t map_bar_x100;      // normaliza o balance (0 = sem balance)
+    bool     knock_enable;      // false em cranking (spark fixo)
+    const uint16_t* map_ivc_bar_x100 = nullptr;  // [kCylinderCount] MAP ao IVC
+    uint16_t map_ref_bar_x100 = 0u;              // MAP com que flow_pw_us foi feito
+};
+
+// Preenche out (índice = cilindro físico) e devolve o avanço escalar para
+// presync / multi-spark: avanço − MAIOR retardo de knock (conservador em
+// wasted spark, onde a bobina serve dois cilindros).
+int16_t cyl_pulse_build(const CylPulseInput& in, EcuSchedCylVector* out) noexcept;
+
+// Correcção de balance aplicada ao cilindro no último build (‰, com sinal).
+int16_t cyl_pulse_balance_x1000(uint8_t cyl) noexcept;
+
+}  // namespace ems::engine
@@ -3,150 +3,272 @@
 #include <cstdint>
 #include <cstring>
 
+#include "engine/calibration.h"
+#include "hal/crc32.h"
+#include "hal/flash.h"
+
 namespace ems::engine {
 
-// Static storage for diagnostic events
-static constexpr uint8_t kMaxEvents = 16;
-static DiagnosticEvent g_events[kMaxEvents];
-static uint8_t g_event_count = 0;
-static uint32_t g_system_tick_ms = 0;
+namespace {
 
-void DiagnosticManager::init() noexcept {
-    // Clear all events
-    for (uint8_t i = 0; i < kMaxEvents; ++i) {
-        g_events[i].code = DiagnosticCode::NONE;
-        g_events[i].severity = FaultSeverity::INFO;
-        g_events[i].timestamp_ms = 0;
-        g_events[i].occurrence_count = 0;
-        for (uint8_t j = 0; j < 4; ++j) {
-            g_events[i].freeze_frame[j] = 0;
+static_assert(kFreezeFrameWords == kDiagFreezeVarSlots,
+              "calibration diag_freeze_vars must cover one freeze frame");
+static_assert(static_cast<uint8_t>(FaultSeverity::CRITICAL) == 3u,
+              "one severity mask per FaultSeverity level");
+
+constexpr uint8_t kSeverityLevels = 4u;
+constexpr uint8_t kMaxStored = DiagnosticManager::kMaxStoredDtcs;
+
+// Persistent DTC memory image (opaque blob for hal/flash)
+constexpr uint16_t kDtcStoreMagic   = 0x5444u;  // "DT"
+constexpr uint8_t  kDtcStoreVersion = 1u;
+
+struct DtcStoreImage {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  count;
+    uint32_t oper_s;            // ECU on-time carried across power cycles
+    StoredDtc entries[kMaxStored];
+    uint32_t crc32;             // CRC-32 of everything above
+};
+static_assert(sizeof(DtcStoreImage) <= ems::hal::kNvmDtcStoreBytes,
+              "DTC store does not fit the NVM region");
+
+constexpr FreezeVar kDefaultFreezeVars[kFreezeFrameWords] = {
+    FreezeVar::RPM_X10,      FreezeVar::MAP_BAR_X100,
+    FreezeVar::TPS_PCT_X10,  FreezeVar::CLT_DEGC_X10,
+    FreezeVar::IAT_DEGC_X10, FreezeVar::VBATT_MV,
+    FreezeVar::FUEL_PRESS_BAR_X1000, FreezeVar::SYNC_STATE,
+};
+
+// Active set: one bit per kDiagnosticCodes slot, plus one mask per severity
+DiagnosticEvent g_events[kDiagCodeCount];
+RecoveryState   g_recovery_states[kDiagCodeCount];
+uint64_t g_active_mask = 0u;
+uint64_t g_severity_mask[kSeverityLevels] = {};
+
+uint16_t g_live[static_cast<uint8_t>(FreezeVar::COUNT)] = {};
+
+DtcStoreImage g_store{};
+uint8_t  g_store_index[kDiagCodeCount];   // slot → entry, kDiagNoSlot if none
+bool     g_store_dirty = false;
+bool     g_store_saved_once = false;
+uint32_t g_last_persist_ms = 0u;
+
+uint32_t g_system_tick_ms = 0u;
+uint32_t g_oper_ms_frac = 0u;
+
+constexpr uint64_t slot_bit(uint8_t slot) noexcept {
+    return static_cast<uint64_t>(1u) << slot;
+}
+
+uint32_t store_crc(const DtcStoreImage& img) noexcept {
+    return ems::hal::crc32_calc(reinterpret_cast<const uint8_t*>(&img),
+                                static_cast<uint32_t>(sizeof(img) - sizeof(img.crc32)));
+}
+
+void store_reset(uint32_t oper_s) noexcept {
+    std::memset(&g_store, 0, sizeof(g_store));
+    g_store.magic = kDtcStoreMagic;
+    g_store.version = kDtcStoreVersion;
+    g_store.oper_s = oper_s;
+    for (uint8_t i = 0u; i < kDiagCodeCount; ++i) { g_store_index[i] = kDiagNoSlot; }
+}
+
+void store_load() noexcept {
+    DtcStoreImage img{};
+    const bool read = ems::hal::nvm_load_dtc_store(
+        reinterpret_cast<uint8_t*>(&img), static_cast<uint16_t>(sizeof(img)));
+    if (!read || img.magic != kDtcStoreMagic || img.version != kDtcStoreVersion ||
+        img.count > kMaxStored || img.crc32 != store_crc(img)) {
+        store_reset(0u);   // never written / other layout: empty memory
+        return;
+    }
+    store_reset(img.oper_s);
+    for (uint8_t i = 0u; i < img.count; ++i) {
+        const uint8_t slot = diag_code_slot(static_cast<DiagnosticCode>(img.entries[i].code));
+        if (slot == kDiagNoSlot || g_store_index[slot] != kDiagNoSlot) { continue; }
+        g_store_index[slot] = g_store.count;
+        g_store.entries[g_store.count++] = img.entries[i];
+    }
+}
+
+// Entry for a new activation: free entry, else the least recently seen one
+// whose fault is not active (else the least recently seen overall).
+uint8_t store_alloc() noexcept {
+    if (g_store.count < kMaxStored) { return g_store.count++; }
+    uint8_t victim = 0u;
+    bool victim_active = true;
+    for (uint8_t i = 0u; i < kMaxStored; ++i) {
+        const uint8_t slot = diag_code_slot(static_cast<DiagnosticCode>(g_store.entries[i].code));
+        const bool active = (slot != kDiagNoSlot) && ((g_active_mask & slot_bit(slot)) != 0u);
+        if ((victim_active && !active) ||
+            (active == victim_active &&
+             g_store.entries[i].last_seen_s < g_store.entries[victim].last_seen_s)) {
+            victim = i;
+            victim_active = active;
         }
     }
-    g_event_count = 0;
+    const uint8_t old = diag_code_slot(static_cast<DiagnosticCode>(g_store.entries[victim].code));
+    if (old != kDiagNoSlot) { g_store_index[old] = kDiagNoSlot; }
+    return victim;
+}
+
+void store_record_activation(uint8_t slot) noexcept {
+    const DiagnosticEvent& ev = g_events[slot];
+    uint8_t e = g_store_index[slot];
+    if (e == kDiagNoSlot) {
+        e = store_alloc();
+        StoredDtc& fresh = g_store.entries[e];
+        std::memset(&fresh, 0, sizeof(fresh));
+        fresh.code = static_cast<uint16_t>(ev.code);
+        fresh.first_seen_s = g_store.oper_s;
+        g_store_index[slot] = e;
+    }
+    StoredDtc& d = g_store.entries[e];
+    if (d.occurrences < 0xFFFFu) { ++d.occurrences; }
+    d.last_seen_s = g_store.oper_s;
+    std::memcpy(d.freeze_vars, ev.freeze_vars, sizeof(d.freeze_vars));
+    std::memcpy(d.freeze_frame, ev.freeze_frame, sizeof(d.freeze_frame));
+    g_store_dirty = true;
+}
+
+// End of an episode: last_seen moves to the clear time (no NVM traffic
+// while a fault stays active).
+void store_record_clear(uint8_t slot) noexcept {
+    const uint8_t e = g_store_index[slot];
+    if (e == kDiagNoSlot) { return; }
+    if (g_store.entries[e].last_seen_s != g_store.oper_s) {
+        g_store.entries[e].last_seen_s = g_store.oper_s;
+        g_store_dirty = true;
+    }
+}
+
+void capture_freeze_frame(DiagnosticEvent& ev) noexcept {
+    bool configured = false;
+    for (uint8_t i = 0u; i < kFreezeFrameWords; ++i) {
+        configured = configured || (diag_freeze_vars[i] != 0u);
+    }
+    for (uint8_t i = 0u; i < kFreezeFrameWords; ++i) {
+        uint8_t var = configured ? diag_freeze_vars[i]
+                                 : static_cast<uint8_t>(kDefaultFreezeVars[i]);
+        if (var >= static_cast<uint8_t>(FreezeVar::COUNT)) { var = 0u; }
+        ev.freeze_vars[i] = var;
+        ev.freeze_frame[i] = g_live[var];   // g_live[NONE] stays 0
+    }
+}
+
+void set_severity(uint8_t slot, FaultSeverity severity) noexcept {
+    const uint64_t bit = slot_bit(slot);
+    for (uint8_t s = 0u; s < kSeverityLevels; ++s) { g_severity_mask[s] &= ~bit; }
+    g_severity_mask[static_cast<uint8_t>(severity) & 3u] |= bit;
+    g_events[slot].severity = severity;
+}
+
+void deactivate(uint8_t slot) noexcept {
+    const uint64_t bit = slot_bit(slot);
+    g_active_mask &= ~bit;
+    for (uint8_t s = 0u; s < kSeverityLevels; ++s) { g_severity_mask[s] &= ~bit; }
+    g_recovery_states[slot] = RecoveryState::IDLE;
+    store_record_clear(slot);
+}
+
+// Slot of an active code, kDiagNoSlot otherwise
+uint8_t active_slot(DiagnosticCode code) noexcept {
+    const uint8_t slot = diag_code_slot(code);
+    if (slot == kDiagNoSlot || (g_active_mask & slot_bit(slot)) == 0u) {
+        return kDiagNoSlot;
+    }
+    return slot;
+}
+
+}  // namespace
+
+void DiagnosticManager::init() noexcept {
+    for (uint8_t i = 0; i < kDiagCodeCount; ++i) {
+        std::memset(&g_events[i], 0, sizeof(g_events[i]));
+        g_events[i].code = kDiagnosticCodes[i];
+        g_recovery_states[i] = RecoveryState::IDLE;
+    }
+    g_active_mask = 0u;
+    for (uint8_t s = 0u; s < kSeverityLevels; ++s) { g_severity_mask[s] = 0u; }
+    std::memset(g_live, 0, sizeof(g_live));
     g_system_tick_ms = 0;
+    g_oper_ms_frac = 0u;
+    store_load();
+    g_store_dirty = false;
+    g_store_saved_once = false;
+    g_last_persist_ms = 0u;
 }
 
 bool DiagnosticManager::report_fault(DiagnosticCode code,
                                      FaultSeverity severity,
                                      uint16_t param1,
                                      uint16_t param2) noexcept {
-    if (code == DiagnosticCode::NONE) {
-        return false;
+    const uint8_t slot = diag_code_slot(code);
+    if (slot == kDiagNoSlot) {
+        return false;  // NONE or untracked code
     }
-    
-    // Check if fault already exists
-    for (uint8_t i = 0; i < g_event_count; ++i) {
-        if (g_events[i].code == code) {
-            // Update occurrence count and freeze frame
-            if (g_events[i].occurrence_count < 65535) {
-                ++g_events[i].occurrence_count;
-            }
-            g_events[i].freeze_frame[0] = param1;
-            g_events[i].freeze_frame[1] = param2;
-            g_events[i].timestamp_ms = g_system_tick_ms;
-            return false;  // Not new
+    DiagnosticEvent& event = g_events[slot];
+    event.param[0] = param1;
+    event.param[1] = param2;
+    event.timestamp_ms = g_system_tick_ms;
+    if ((g_active_mask & slot_bit(slot)) != 0u) {
+        // Already active: count the repeat, follow severity escalation
+        if (event.occurrence_count < 65535) {
+            ++event.occurrence_count;
         }
-    }
-    
-    // New fault - add to event list if space available
-    if (g_event_count >= kMaxEvents) {
-        // Overwrite oldest non-critical event
-        for (uint8_t i = 0; i < kMaxEvents - 1; ++i) {
-            if (g_events[i].severity != FaultSeverity::CRITICAL) {
-                // Shift events
-                g_events[i] = g_events[i + 1];
-            }
+        if (event.severity != severity) {
+            set_severity(slot, severity);
         }
-        g_event_count = kMaxEvents - 1;
+        return false;  // Not new
     }
-    
-    // Add new event
-    DiagnosticEvent& event = g_events[g_event_count++];
-    event.code = code;
-    event.severity = severity;
-    event.timestamp_ms = g_system_tick_ms;
+
+    // New fault: freeze frame from the live variables, mirror into DTC memory
+    event.first_seen_ms = g_system_tick_ms;
     event.occurrence_count = 1;
-    event.freeze_frame[0] = param1;
-    event.freeze_frame[1] = param2;
-    event.freeze_frame[2] = 0;
-    event.freeze_frame[3] = 0;
-    
+    capture_freeze_frame(event);
+    g_active_mask |= slot_bit(slot);
+    set_severity(slot, severity);
+    g_recovery_states[slot] = RecoveryState::IDLE;
+    store_record_activation(slot);
     return true;  // New fault
 }
 
 bool DiagnosticManager::clear_fault(DiagnosticCode code) noexcept {
-    if (code == DiagnosticCode::NONE) {
+    const uint8_t slot = active_slot(code);
+    if (slot == kDiagNoSlot) {
         return false;
     }
-    
-    // Find and remove the fault
-    for (uint8_t i = 0; i < g_event_count; ++i) {
-        if (g_events[i].code == code) {
-            // Shift remaining events
-            for (uint8_t j = i; j < g_event_count - 1; ++j) {
-                g_events[j] = g_events[j + 1];
-            }
-            --g_event_count;
-            // Clear the last slot
-            g_events[g_event_count].code = DiagnosticCode::NONE;
-            return true;
-        }
-    }
-    return false;
+    deactivate(slot);
+    return true;
 }
 
 bool DiagnosticManager::is_fault_active(DiagnosticCode code) noexcept {
-    if (code == DiagnosticCode::NONE) {
-        return false;
-    }
-    
-    for (uint8_t i = 0; i < g_event_count; ++i) {
-        if (g_events[i].code == code) {
-            return true;
-        }
-    }
-    return false;
+    return active_slot(code) != kDiagNoSlot;
 }
 
 uint8_t DiagnosticManager::get_active_fault_count() noexcept {
-    return g_event_count;
+    return static_cast<uint8_t>(__builtin_popcountll(g_active_mask));
 }
 
 FaultSeverity DiagnosticManager::get_highest_severity() noexcept {
-    if (g_event_count == 0) {
-        return FaultSeverity::INFO;
-    }
-    
-    FaultSeverity highest = FaultSeverity::INFO;
-    for (uint8_t i = 0; i < g_event_count; ++i) {
-        if (static_cast<uint8_t>(g_events[i].severity) > static_cast<uint8_t>(highest)) {
-            highest = g_events[i].severity;
+    for (uint8_t s = kSeverityLevels; s-- > 1u;) {
+        if (g_severity_mask[s] != 0u) {
+            return static_cast<FaultSeverity>(s);
         }
     }
-    return highest;
+    return FaultSeverity::INFO;
 }
 
-// Recovery state machine storage
-static RecoveryState g_recovery_states[16];
-
 RecoveryState DiagnosticManager::update_recovery(DiagnosticCode code,
                                                  bool success) noexcept {
-    // Find associated event
-    uint8_t event_idx = 0;
-    bool found = false;
-    for (uint8_t i = 0; i < g_event_count; ++i) {
-        if (g_events[i].code == code) {
-            event_idx = i;
-            found = true;
-            break;
-        }
-    }
-    
-    if (!found) {
+    const uint8_t slot = active_slot(code);
+    if (slot == kDiagNoSlot) {
         return RecoveryState::IDLE;
     }
     
-    RecoveryState& state = g_recovery_states[event_idx];
+    RecoveryState& state = g_recovery_states[slot];
     
     switch (state) {
         case RecoveryState::IDLE:
@@ -188,33 +310,36 @@ RecoveryState DiagnosticManager::update_recovery(DiagnosticCode code,
 }
 
 RecoveryState DiagnosticManager::get_recovery_state(DiagnosticCode code) noexcept {
-    for (uint8_t i = 0; i < g_event_count; ++i) {
-        if (g_events[i].code == code) {
-            return g_recovery_states[i];
-        }
-    }
-    return RecoveryState::IDLE;
+    const uint8_t slot = active_slot(code);
+    return (slot != kDiagNoSlot) ? g_recovery_states[slot] : RecoveryState::IDLE;
 }
 
 void DiagnosticManager::record_freeze_frame(DiagnosticCode code,
-                                           const uint16_t frame[4]) noexcept {
-    for (uint8_t i = 0; i < g_event_count; ++i) {
-        if (g_events[i].code == code) {
-            for (uint8_t j = 0; j < 4; ++j) {
-                g_events[i].freeze_frame[j] = frame[j];
-            }
-            break;
-        }
+                                           const uint16_t* frame,
+                                           uint8_t count) noexcept {
+    const uint8_t slot = active_slot(code);
+    if (slot == kDiagNoSlot || frame == nullptr) {
+        return;
+    }
+    if (count > kFreezeFrameWords) {
+        count = kFreezeFrameWords;
+    }
+    for (uint8_t j = 0; j < count; ++j) {
+        g_events[slot].freeze_vars[j] = static_cast<uint8_t>(FreezeVar::NONE);
+        g_events[slot].freeze_frame[j] = frame[j];
     }
 }
 
-const DiagnosticEvent* DiagnosticManager::get_event(DiagnosticCode code) noexcept {
-    for (uint8_t i = 0; i < g_event_count; ++i) {
-        if (g_events[i].code == code) {
-            return &g_events[i];
-        }
+void DiagnosticManager::set_live_value(FreezeVar var, uint16_t value) noexcept {
+    const uint8_t v = static_cast<uint8_t>(var);
+    if (v != 0u && v < static_cast<uint8_t>(FreezeVar::COUNT)) {
+        g_live[v] = value;
     }
-    return nullptr;
+}
+
+const DiagnosticEvent* DiagnosticManager::get_event(DiagnosticCode code) noexcept {
+    const uint8_t slot = active_slot(code);
+    return (slot != kDiagNoSlot) ? &g_events[slot] : nullptr;
 }
 
 bool DiagnosticManager::check_sensor_plausibility(uint16_t map_bar_x1000,
@@ -257,25 +382,14 @@ bool DiagnosticManager::check_sensor_plausibility(uint16_t map_bar_x1000,
 
 void DiagnosticManager::clear_all_faults() noexcept {
     // Clear only non-permanent faults
-    uint8_t write_idx = 0;
-    for (uint8_t i = 0; i < g_event_count; ++i) {
-        // Keep permanent faults
-        if (g_recovery_states[i] == RecoveryState::PERMANENT) {
-            if (write_idx != i) {
-                g_events[write_idx] = g_events[i];
-                g_recovery_states[write_idx] = g_recovery_states[i];
-            }
-            ++write_idx;
+    uint64_t pending = g_active_mask;
+    while (pending != 0u) {
+        const uint8_t slot = static_cast<uint8_t>(__builtin_ctzll(pending));
+        pending &= pending - 1u;
+        if (g_recovery_states[slot] != RecoveryState::PERMANENT) {
+            deactivate(slot);
         }
     }
-    
-    // Fix count first, then clear remaining slots
-    const uint8_t old_count = g_event_count;
-    g_event_count = write_idx;
-    for (uint8_t i = write_idx; i < old_count; ++i) {
-        g_events[i].code = DiagnosticCode::NONE;
-        g_recovery_states[i] = RecoveryState::IDLE;
-    }
 }
 
 bool DiagnosticManager::is_system_ready() noexcept {
@@ -283,9 +397,56 @@ bool DiagnosticManager::is_system_ready() noexcept {
     return highest != FaultSeverity::CRITICAL;
 }
 
+uint8_t DiagnosticManager::get_stored_dtc_count() noexcept {
+    return g_store.count;
+}
+
+const StoredDtc* DiagnosticManager::get_stored_dtc(uint8_t index) noexcept {
+    return (index < g_store.count) ? &g_store.entries[index] : nullptr;
+}
+
+const StoredDtc* DiagnosticManager::find_stored_dtc(DiagnosticCode code) noexcept {
+    const uint8_t slot = diag_code_slot(code);
+    if (slot == kDiagNoSlot || g_store_index[slot] == kDiagNoSlot) {
+        return nullptr;
+    }
+    return &g_store.entries[g_store_index[slot]];
+}
+
+void DiagnosticManager::clear_stored_dtcs() noexcept {
+    store_reset(g_store.oper_s);
+    g_store_dirty = true;
+}
+
+bool DiagnosticManager::persist_process(uint32_t now_ms) noexcept {
+    if (!g_store_dirty) {
+        return false;
+    }
+    // Rate limit on top of the adaptive flush: bursts of activations within
+    // one interval cost a single journal delta.
+    if (g_store_saved_once && (now_ms - g_last_persist_ms) < kDtcPersistIntervalMs) {
+        return false;
+    }
+    g_store.crc32 = store_crc(g_store);
+    if (!ems::hal::nvm_save_dtc_store(reinterpret_cast<const uint8_t*>(&g_store),
+                                      static_cast<uint16_t>(sizeof(g_store)))) {
+        return false;
+    }
+    g_store_dirty = false;
+    g_store_saved_once = true;
+    g_last_persist_ms = now_ms;
+    return true;
+}
+
 // Tick function to update system time (call from main loop)
 void diagnostic_tick(uint32_t elapsed_ms) noexcept {
     g_system_tick_ms += elapsed_ms;
+    // Operating seconds only reach NVM with the next store write
+    g_oper_ms_frac += elapsed_ms;
+    while (g_oper_ms_frac >= 1000u) {
+        g_oper_ms_frac -= 1000u;
+        ++g_store.oper_s;
+    }
 }
 
 }  // namespace ems::engine
@@ -48,12 +48,17 @@ enum class DiagnosticCode : uint16_t {
     FUEL_PRESS_HIGH = 0x0123,
     OIL_PRESS_LOW = 0x0124,
     OIL_PRESS_HIGH = 0x0125,
+    ETB_TPS_FAULT = 0x0126,      // ETB loop: TPS1/TPS2 range or disagreement
     
     // Ignition system (P03xx)
     MISFIRE_CYLINDER_1 = 0x0300,
     MISFIRE_CYLINDER_2 = 0x0301,
     MISFIRE_CYLINDER_3 = 0x0302,
     MISFIRE_CYLINDER_4 = 0x0303,
+    MISFIRE_CYLINDER_5 = 0x0304,
+    MISFIRE_CYLINDER_6 = 0x0305,
+    MISFIRE_CYLINDER_7 = 0x0306,
+    MISFIRE_CYLINDER_8 = 0x0307,
     KNOCK_DETECTED = 0x0310,
     KNOCK_SENSOR_FAULT = 0x0311,
     
@@ -111,27 +116,161 @@ enum class RecoveryState : uint8_t {
 };
 
 /**
- * @brief Diagnostic event structure
+ * @brief Every code the manager tracks (NONE excluded)
+ *
+ * Position in this list is the code's slot: active set, severity masks,
+ * events and the store index are all arrays/bitmaps indexed by slot, so
+ * report/query/clear are constant time. Adding a code here is enough — the
+ * hash table below is rebuilt at compile time and static_assert'ed.
+ */
+inline constexpr DiagnosticCode kDiagnosticCodes[] = {
+    DiagnosticCode::MAP_SENSOR_RANGE,      DiagnosticCode::MAP_SENSOR_PLAUSIBILITY,
+    DiagnosticCode::MAF_SENSOR_RANGE,      DiagnosticCode::MAF_SENSOR_PLAUSIBILITY,
+    DiagnosticCode::TPS_SENSOR_RANGE,      DiagnosticCode::TPS_SENSOR_PLAUSIBILITY,
+    DiagnosticCode::CLT_SENSOR_RANGE,      DiagnosticCode::CLT_SENSOR_PLAUSIBILITY,
+    DiagnosticCode::IAT_SENSOR_RANGE,      DiagnosticCode::IAT_SENSOR_PLAUSIBILITY,
+    DiagnosticCode::O2_SENSOR_RANGE,       DiagnosticCode::O2_SENSOR_HEATER,
+    DiagnosticCode::MAP_TPS_CORRELATION,   DiagnosticCode::MAP_BARO_CORRELATION,
+    DiagnosticCode::FUEL_PRESS_LOW,        DiagnosticCode::FUEL_PRESS_HIGH,
+    DiagnosticCode::OIL_PRESS_LOW,         DiagnosticCode::OIL_PRESS_HIGH,
+    DiagnosticCode::ETB_TPS_FAULT,
+    DiagnosticCode::MISFIRE_CYLINDER_1,    DiagnosticCode::MISFIRE_CYLINDER_2,
+    DiagnosticCode::MISFIRE_CYLINDER_3,    DiagnosticCode::MISFIRE_CYLINDER_4,
+    DiagnosticCode::MISFIRE_CYLINDER_5,    DiagnosticCode::MISFIRE_CYLINDER_6,
+    DiagnosticCode::MISFIRE_CYLINDER_7,    DiagnosticCode::MISFIRE_CYLINDER_8,
+    DiagnosticCode::KNOCK_DETECTED,        DiagnosticCode::KNOCK_SENSOR_FAULT,
+    DiagnosticCode::FUEL_TRIM_LEAN,        DiagnosticCode::FUEL_TRIM_RICH,
+    DiagnosticCode::LTFT_LIMIT_REACHED,    DiagnosticCode::STFT_LIMIT_REACHED,
+    DiagnosticCode::CKP_SIGNAL_FAULT,      DiagnosticCode::CMP_SIGNAL_FAULT,
+    DiagnosticCode::TIMING_OVER_ADVANCED,  DiagnosticCode::TIMING_OVER_RETARDED,
+    DiagnosticCode::VBATT_LOW,             DiagnosticCode::VBATT_HIGH,
+    DiagnosticCode::ADC_TIMEOUT,           DiagnosticCode::ADC_RECOVERY_FAILED,
+    DiagnosticCode::FLASH_WRITE_FAULT,
+    DiagnosticCode::OVERTEMP_CRITICAL,     DiagnosticCode::OVERTEMP_WARNING,
+    DiagnosticCode::OVERSPEED,             DiagnosticCode::LOW_OIL_PRESSURE,
+    DiagnosticCode::RECOVERY_ADC_INITIATED, DiagnosticCode::RECOVERY_ADC_SUCCESS,
+    DiagnosticCode::RECOVERY_ADC_FAILED,
+};
+inline constexpr uint8_t kDiagCodeCount =
+    static_cast<uint8_t>(sizeof(kDiagnosticCodes) / sizeof(kDiagnosticCodes[0]));
+static_assert(kDiagCodeCount <= 64u, "active set is a single 64-bit mask");
+
+// code → slot: 128-entry table indexed by a multiplicative hash of the
+// code bytes (collision-free for the list above, checked below).
+inline constexpr uint8_t kDiagHashSize = 128u;
+inline constexpr uint8_t kDiagHashMul  = 44u;
+inline constexpr uint8_t kDiagNoSlot   = 0xFFu;
+
+constexpr uint8_t diag_code_hash(DiagnosticCode code) noexcept {
+    const uint16_t c = static_cast<uint16_t>(code);
+    return static_cast<uint8_t>(((c & 0xFFu) + (c >> 8u) * kDiagHashMul) & (kDiagHashSize - 1u));
+}
+
+struct DiagSlotTable {
+    uint8_t slot[kDiagHashSize];
+    bool collision;
+};
+
+constexpr DiagSlotTable diag_build_slot_table() noexcept {
+    DiagSlotTable t{};
+    for (uint8_t h = 0u; h < kDiagHashSize; ++h) { t.slot[h] = kDiagNoSlot; }
+    t.collision = false;
+    for (uint8_t i = 0u; i < kDiagCodeCount; ++i) {
+        const uint8_t h = diag_code_hash(kDiagnosticCodes[i]);
+        if (t.slot[h] != kDiagNoSlot) { t.collision = true; }
+        t.slot[h] = i;
+    }
+    return t;
+}
+
+inline constexpr DiagSlotTable kDiagSlotTable = diag_build_slot_table();
+static_assert(!kDiagSlotTable.collision,
+              "DiagnosticCode hash collision: pick another kDiagHashMul");
+
+/**
+ * @brief Slot of a code in kDiagnosticCodes, kDiagNoSlot if untracked
+ */
+constexpr uint8_t diag_code_slot(DiagnosticCode code) noexcept {
+    const uint8_t s = kDiagSlotTable.slot[diag_code_hash(code)];
+    return (s != kDiagNoSlot && kDiagnosticCodes[s] == code) ? s : kDiagNoSlot;
+}
+
+/**
+ * @brief Live variables a freeze frame can capture
+ *
+ * The main loop publishes them every 2 ms slot (set_live_value); the
+ * calibration diag_freeze_vars[] picks which ones are frozen on a new fault.
+ * Signed temperatures are stored as their two's-complement u16.
+ */
+enum class FreezeVar : uint8_t {
+    NONE = 0,
+    RPM_X10 = 1,
+    MAP_BAR_X100 = 2,
+    TPS_PCT_X10 = 3,
+    APP_PCT_X10 = 4,
+    CLT_DEGC_X10 = 5,
+    IAT_DEGC_X10 = 6,
+    VBATT_MV = 7,
+    FUEL_PRESS_BAR_X1000 = 8,
+    OIL_PRESS_BAR_X1000 = 9,
+    SYNC_STATE = 10,
+    SENSOR_FAULT_BITS = 11,
+    COUNT = 12,
+};
+
+inline constexpr uint8_t kFreezeFrameWords = 8u;
+
+/**
+ * @brief Diagnostic event structure (one per tracked code)
  */
 struct DiagnosticEvent {
     DiagnosticCode code;
     FaultSeverity severity;
-    uint32_t timestamp_ms;      // Time of occurrence
-    uint16_t occurrence_count;  // Number of times seen
-    uint16_t freeze_frame[4];   // Snapshot of key parameters
+    uint32_t timestamp_ms;      // Last report (ms since boot)
+    uint32_t first_seen_ms;     // Activation time (ms since boot)
+    uint16_t occurrence_count;  // Reports since activation
+    uint16_t param[2];          // param1/param2 of the last report
+    uint8_t  freeze_vars[kFreezeFrameWords];   // FreezeVar per word
+    uint16_t freeze_frame[kFreezeFrameWords];  // Snapshot at activation
 };
 
+/**
+ * @brief Persistent DTC memory entry (survives power cycles)
+ *
+ * Times are ECU on-time seconds (accumulated by diagnostic_tick and
+ * carried in the store), not wall clock. The freeze frame is the one taken
+ * at the most recent activation.
+ */
+struct StoredDtc {
+    uint16_t code;                 // DiagnosticCode
+    uint16_t occurrences;          // Activations (inactive → active), saturates
+    uint32_t first_seen_s;
+    uint32_t last_seen_s;
+    uint8_t  freeze_vars[kFreezeFrameWords];
+    uint16_t freeze_frame[kFreezeFrameWords];
+};
+static_assert(sizeof(StoredDtc) == 36u, "StoredDtc layout is persisted");
+
 /**
  * @brief Unified Diagnostic Manager
  * 
  * Centralizes fault detection, logging, and recovery management.
  * Provides consistent interface for all subsystems to report
  * and query diagnostic information.
+ *
+ * Active faults are a bitmap over kDiagnosticCodes slots plus one mask per
+ * severity: report/clear/is_fault_active/get_highest_severity are O(1) and
+ * safe to call from every scheduler slot. Activations are mirrored into a
+ * persistent DTC store that persist_process() hands to the NVM layer at
+ * most every kDtcPersistIntervalMs.
  */
 class DiagnosticManager {
 public:
     /**
      * @brief Initialize diagnostic system
+     *
+     * Clears the active set and reloads the DTC store from NVM (call after
+     * nvm_load_adaptive_maps).
      */
     static void init() noexcept;
     
@@ -191,17 +330,24 @@ public:
     static RecoveryState get_recovery_state(DiagnosticCode code) noexcept;
     
     /**
-     * @brief Record freeze frame data for a fault
+     * @brief Overwrite the freeze frame of an active fault
      * @param code Diagnostic trouble code
-     * @param frame Array of 4 parameter values
+     * @param frame Parameter values (first count words are replaced)
+     * @param count Number of words, at most kFreezeFrameWords
      */
     static void record_freeze_frame(DiagnosticCode code,
-                                   const uint16_t frame[4]) noexcept;
+                                   const uint16_t* frame,
+                                   uint8_t count) noexcept;
+
+    /**
+     * @brief Publish a live variable for freeze-frame capture
+     */
+    static void set_live_value(FreezeVar var, uint16_t value) noexcept;
     
     /**
      * @brief Get diagnostic event details
      * @param code Diagnostic trouble code
-     * @return Pointer to event structure, nullptr if not found
+     * @return Pointer to event structure, nullptr if not active
      */
     static const DiagnosticEvent* get_event(DiagnosticCode code) noexcept;
     
@@ -226,13 +372,36 @@ public:
      * @return true if no critical faults prevent operation
      */
     static bool is_system_ready() noexcept;
+
+    /**
+     * @brief Persistent DTC memory access
+     * @return Entry i (0..get_stored_dtc_count()-1) / entry for code, or nullptr
+     */
+    static uint8_t get_stored_dtc_count() noexcept;
+    static const StoredDtc* get_stored_dtc(uint8_t index) noexcept;
+    static const StoredDtc* find_stored_dtc(DiagnosticCode code) noexcept;
+
+    /**
+     * @brief Erase the persistent DTC memory (diagnostic tool)
+     */
+    static void clear_stored_dtcs() noexcept;
+
+    /**
+     * @brief Hand a changed DTC store to the NVM layer (rate-limited)
+     * @param now_ms Main loop clock
+     * @return true if the store was written to the NVM shadow
+     */
+    static bool persist_process(uint32_t now_ms) noexcept;
     
-    // Constants must be public for static array sizing
-    static constexpr uint8_t kMaxEvents = 16;
+    static constexpr uint8_t kMaxStoredDtcs = 10;
+    static constexpr uint32_t kDtcPersistIntervalMs = 60000;
 
 private:
     static constexpr uint16_t kFaultDebounceCount = 3;
     static constexpr uint32_t kRecoveryTimeoutMs = 5000;
 };
 
+// Advance the diagnostic clock (event timestamps + operating seconds).
+void diagnostic_tick(uint32_t elapsed_ms) noexcept;
+
 }  // namespace ems::engine
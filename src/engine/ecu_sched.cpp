@@ -39,7 +39,7 @@ static uint32_t ems_test_tim5_cnt  = 0u;
 #define TIM5_CNT    ems_test_tim5_cnt
 #endif
 
-#define ECU_CHANNELS      8U
+#define ECU_CHANNELS      ECU_CHANNEL_COUNT
 #define ECU_IGN_CH_FIRST  4U
 #define ECU_CYCLE_DEG     720U
 #define STM32_MIN_COMPARE_LEAD_TICKS 125U  // 2 µs @ 62.5 MHz
@@ -58,34 +58,81 @@ static_assert(ECU_SCHED_NS_PER_TICK == 16U,
 // Pin-metric index — alias of hal/out_pins.h single source.
 #define k_ch_to_pin_idx ems::hal::kOutChToPinIdx
 
-// Inhibit mask bit for INJ/IGN channels (cyl 0..3). Indexed by ECU_CH_* for 0..3 / 4..7.
-static constexpr uint8_t k_inj_ch_to_bit[8] = {
+static constexpr uint8_t kCyl = ems::engine::cfg::kCylinderCount;
+static_assert(ECU_CYL_COUNT == ems::engine::cfg::kCylinderCount,
+              "ecu_sched.h e engine_config.h devem ver o mesmo EMS_CYLINDERS");
+static_assert(ECU_CHANNELS == ems::hal::kOutChannelCount,
+              "canais do scheduler = canais BSRR de hal/out_pins.h");
+static_assert(ECU_CHANNELS >= 2U * kCyl, "um INJ + um IGN por cilindro");
+
+// Canal e pin idx partilham o padrão [banco×8 + (0..3 INJ | 4..7 IGN)]:
+// bit 2 distingue IGN; pin idx → cilindro = banco×4 + (idx & 3).
+static constexpr uint8_t ch_is_inj(uint8_t ch) {
+    return ((ch & ECU_IGN_CH_FIRST) == 0U) ? 1U : 0U;
+}
+static constexpr uint8_t pin_idx_cyl(uint8_t idx) {
+    return (uint8_t)(((idx >> 3U) << 2U) | (idx & 3U));
+}
+
+// Inhibit mask bit for INJ/IGN channels. Indexed by ECU_CH_*.
+#if EMS_OUT_CHANNELS > 8
+static constexpr uint8_t k_inj_ch_to_bit[ECU_CHANNELS] = {
+    (1U << 2), (1U << 3), (1U << 0), (1U << 1), 0U, 0U, 0U, 0U,
+    (1U << 4), (1U << 5), (1U << 6), (1U << 7), 0U, 0U, 0U, 0U
+};
+static constexpr uint8_t k_ign_ch_to_bit[ECU_CHANNELS] = {
+    0U, 0U, 0U, 0U, (1U << 3), (1U << 2), (1U << 1), (1U << 0),
+    0U, 0U, 0U, 0U, (1U << 4), (1U << 5), (1U << 6), (1U << 7)
+};
+#else
+static constexpr uint8_t k_inj_ch_to_bit[ECU_CHANNELS] = {
     (1U << 2), (1U << 3), (1U << 0), (1U << 1), 0U, 0U, 0U, 0U
 };
-static constexpr uint8_t k_ign_ch_to_bit[8] = {
+static constexpr uint8_t k_ign_ch_to_bit[ECU_CHANNELS] = {
     0U, 0U, 0U, 0U, (1U << 3), (1U << 2), (1U << 1), (1U << 0)
 };
+#endif
+
+// Os três mapas (bit de inibição, pin idx, kInjCh/kIgnCh) têm de concordar.
+static constexpr bool channel_maps_consistent() {
+    for (uint8_t cyl = 0U; cyl < kCyl; ++cyl) {
+        const uint8_t inj = si::kInjCh[cyl];
+        const uint8_t ign = si::kIgnCh[cyl];
+        if (k_inj_ch_to_bit[inj] != (1U << cyl) || k_ign_ch_to_bit[ign] != (1U << cyl)) {
+            return false;
+        }
+        if (pin_idx_cyl(k_ch_to_pin_idx[inj]) != cyl || pin_idx_cyl(k_ch_to_pin_idx[ign]) != cyl) {
+            return false;
+        }
+        if (ch_is_inj(inj) == 0U || ch_is_inj(ign) != 0U) { return false; }
+    }
+    return true;
+}
+static_assert(channel_maps_consistent(), "mapas canal↔cilindro inconsistentes");
 
 // Angle table lives in ecu_sched_angle.cpp (cold builders). Aliases for local use.
 // Hot path reads si::g_angle_table* at tooth time only.
 
 volatile uint32_t g_late_event_count = 0U;
+// Late por canal (índice = ECU_CH_*) — telemetria por ciclo (CAN FD 0x410).
+static volatile uint32_t g_late_event_count_ch[ECU_CHANNELS] = {};
 volatile uint32_t g_calibration_clamp_count = 0U;
 volatile uint32_t g_cycle_schedule_drop_count = 0U;
 
 // ── Dwell watchdog (MS42 §2.2.2.1.3 — TD × 1.4) ──────────────────────────
 // Escrito pela ISR (arm_channel), lido pelo main loop (ecu_sched_dwell_watchdog).
 // volatile necessário: compilador não pode cachear em registo entre os dois contextos.
-static volatile uint32_t g_dwell_arm_tick[4]  = {0U, 0U, 0U, 0U};  // TIM5_CNT no arm de DWELL_START; 0 = inactivo
-static volatile uint32_t g_dwell_wdog_ticks[4] = {0U, 0U, 0U, 0U};  // 1.4 × dwell_ticks no momento do arm
+// Indexados por cilindro (0..N-1).
+static volatile uint32_t g_dwell_arm_tick[kCyl]  = {};  // TIM5_CNT no arm de DWELL_START; 0 = inactivo
+static volatile uint32_t g_dwell_wdog_ticks[kCyl] = {};  // 1.4 × dwell_ticks no momento do arm
 static volatile uint32_t g_dwell_watchdog_count = 0U;
 
 // ── Injector open watchdog (lost INJ_OFF / queue overflow backstop) ────────
-// pin_idx 0..3 = INJ1..4. Arm on pin HIGH; release on pin LOW / trip.
+// Indexed by cylinder (pin_idx_cyl). Arm on pin HIGH; release on pin LOW / trip.
 // Timeout: 1.2 × current PW when armed via arm_channel; hard 36 ms floor for
 // force_output/prime (prime clamps at 30 ms). Hard cap 36 ms always.
-static volatile uint32_t g_inj_open_tick[4]   = {0U, 0U, 0U, 0U};
-static volatile uint32_t g_inj_wdog_ticks[4]  = {0U, 0U, 0U, 0U};
+static volatile uint32_t g_inj_open_tick[kCyl]   = {};
+static volatile uint32_t g_inj_wdog_ticks[kCyl]  = {};
 static volatile uint32_t g_inj_watchdog_count = 0U;
 static constexpr uint32_t kInjOpenWdogHardTicks = ECU_SCHED_US_TO_TICKS(36000U);
 
@@ -112,12 +159,10 @@ namespace ems::engine::sched_internal {
 volatile uint8_t  g_mspark_count            = 0U;
 volatile uint32_t g_mspark_inter_dwell_ticks = 0U;
 volatile uint32_t g_mspark_atdc_limit_deg    = 18U;
-volatile uint32_t g_advance_deg = 10U;
-volatile uint32_t g_dwell_ticks = 187500U;  // 3 ms @ 62.5 MHz
-// Default 0 until first main commit — avoids angular fuel with default PW
-// between first CKP edges and the first 2 ms policy tick (inhibit may still be 0).
-volatile uint32_t g_inj_pw_ticks = 0U;
-volatile uint32_t g_eoi_lead_deg = 355U;
+// advance 10°, dwell 3 ms @ 62.5 MHz, eoi 355°. PW default 0 until first main
+// commit — avoids angular fuel with default PW between first CKP edges and
+// the first 2 ms policy tick (inhibit may still be 0).
+ems::hal::SeqLock<SchedCalibration> g_sched_cal{SchedCalibration{10U, 187500U, 0U, 355U, {}, 0U}};
 volatile uint8_t  g_presync_inj_mode = ECU_PRESYNC_INJ_SEMI_SEQUENTIAL;
 volatile uint8_t  g_presync_bank_toggle = 0U;
 volatile uint8_t  g_knock_sequential = 0U;
@@ -125,8 +170,10 @@ volatile uint32_t g_pw_duty_clamp_count = 0U;
 }  // namespace ems::engine::sched_internal
 
 // Local-only runtime state (hot façade; not needed by angle builders)
-volatile uint8_t g_inj_pw_override = 0U;  // 1=lock si::g_inj_pw_ticks, ignore main loop writes
-// EOI targeting notes: builders use si::g_eoi_lead_deg (shared).
+volatile uint8_t g_inj_pw_override = 0U;  // 1=lock inj_pw_ticks, ignore main loop writes
+// Cópia de trabalho do main loop — único escritor de si::g_sched_cal: setters
+// e commits alteram-na, sanitizam e publicam o bloco inteiro (sem CPSID).
+static si::SchedCalibration g_cal_stage = {10U, 187500U, 0U, 355U, {}, 0U};
 static volatile uint8_t g_presync_enable = 1U;
 static volatile uint8_t g_presync_inj_auto = 1U;
 static volatile uint8_t g_presync_ign_mode = ECU_PRESYNC_IGN_WASTED_SPARK;
@@ -150,16 +197,16 @@ volatile uint32_t g_dbg_ign1_arm = 0U;  // arm_channel calls for IGN1
 // TIM5 ISR fires, executes GPIO BSRR, and loads the next event.
 // No OC mode — pure compare + software GPIO.
 
-// Must hold a full tooth burst under multi-spark presync (wasted: 4 coils ×
-// (1 primary + up to 3 extra) × 2 actions ≈ 32) plus concurrent inj edges.
+// Must hold a full tooth burst under multi-spark presync (wasted: N coils ×
+// (1 primary + up to 3 extra) × 2 actions = 8·N) plus concurrent inj edges.
 // Match angle-table margin so arm_channel does not drop de-asserts under load.
-#define EVT_QUEUE_SIZE 48U
+#define EVT_QUEUE_SIZE ECU_ANGLE_TABLE_SIZE
 static_assert(EVT_QUEUE_SIZE >= ECU_ANGLE_TABLE_SIZE,
               "event queue must cover a full angle-table tooth burst");
 
 struct SchedEvent {
     uint32_t timestamp;   // TIM5 absolute tick
-    uint8_t  channel;     // ECU_CH_INJ1..IGN4
+    uint8_t  channel;     // ECU_CH_INJ1..IGN8
     uint8_t  high;        // 1=ON/DWELL, 0=OFF/SPARK
     uint8_t  valid;
     uint8_t  _pad;
@@ -188,7 +235,7 @@ static inline void gpio_set_pin(uint8_t channel, uint8_t high) {
 
 static inline void pin_transition(uint8_t idx, uint8_t high, uint8_t is_safe_state = 0U);
 static inline uint8_t channel_pin_idx(uint8_t ch) {
-    return (ch < 8U) ? k_ch_to_pin_idx[ch] : 0xFFU;
+    return (ch < ECU_CHANNELS) ? k_ch_to_pin_idx[ch] : 0xFFU;
 }
 
 // Drop one high=1 (ON/DWELL) event to make room for a de-assert (OFF/SPARK).
@@ -268,6 +315,19 @@ static inline void evt_execute_head(uint32_t now, uint8_t capture_ts) {
     if (idx != 0xFFU) {
         pin_transition(idx, e.high);
     }
+    // Janela de knock por cilindro: só em sequencial (wasted-spark não
+    // identifica o cilindro em combustão).
+    if (si::g_knock_sequential != 0U) {
+        for (uint8_t cyl = 0U; cyl < kCyl; ++cyl) {
+            if (si::kIgnCh[cyl] != e.channel) { continue; }
+            if (e.high != 0U) {
+                ems::engine::knock_on_dwell_start(cyl);
+            } else {
+                ems::engine::knock_window_spark(cyl);
+            }
+            break;
+        }
+    }
     ++g_dbg_evt_dispatched;
     --g_evt_count;
     for (uint8_t i = 0; i < g_evt_count; ++i) {
@@ -296,6 +356,8 @@ void ecu_sched_evt_dispatch(void) {
         }
         // Already past — process inline (no ts_ring; count as late for diag only)
         ++g_late_event_count;
+        const uint8_t late_ch = g_evt_queue[0].channel;
+        if (late_ch < ECU_CHANNELS) { ++g_late_event_count_ch[late_ch]; }
         evt_execute_head(TIM5_CNT, 0U);
     }
     TIM5_DIER &= ~TIM_DIER_CC3IE;
@@ -304,43 +366,49 @@ void ecu_sched_evt_dispatch(void) {
 
 
 // Pin transition verification: count every actual pin state change
-volatile uint32_t g_pin_high_count[8];  // [0-3]=INJ CH1-4, [4-7]=IGN CH1-4
-volatile uint32_t g_pin_low_count[8];
-volatile uint32_t g_pin_seq_error[8];   // consecutive same-direction transitions
-static uint8_t    g_pin_last_state[8];  // 0=LOW, 1=HIGH, 0xFF=unknown
+// [0-3]=INJ CH1-4, [4-7]=IGN CH1-4, [8-11]=INJ CH5-8, [12-15]=IGN CH5-8
+volatile uint32_t g_pin_high_count[ECU_CHANNELS];
+volatile uint32_t g_pin_low_count[ECU_CHANNELS];
+volatile uint32_t g_pin_seq_error[ECU_CHANNELS];   // consecutive same-direction transitions
+static uint8_t    g_pin_last_state[ECU_CHANNELS];  // 0=LOW, 1=HIGH, 0xFF=unknown
 
 static inline void pin_transition(uint8_t idx, uint8_t high, uint8_t is_safe_state) {
-    if (idx >= 8U) { return; }
+    if (idx >= ECU_CHANNELS) { return; }
     if (g_pin_last_state[idx] == high && high != 0xFFU) {
         if (is_safe_state == 0U) { ++g_pin_seq_error[idx]; }
         return;  // redundant transition — don't double-count
     }
+    const uint8_t cyl = pin_idx_cyl(idx);
+    const uint8_t is_inj = ch_is_inj(idx);
     if (high) {
         ++g_pin_high_count[idx];
-        if (idx < 4U) {
+        if (cyl >= kCyl) {
+            // Canal sem cilindro (N < 4 no banco 1): só métricas.
+        } else if (is_inj != 0U) {
             // Injector open watchdog — pin HIGH arms the timer.
-            g_inj_open_tick[idx] = TIM5_CNT | 1U;
-            if (g_inj_wdog_ticks[idx] == 0U) {
-                g_inj_wdog_ticks[idx] = kInjOpenWdogHardTicks;  // force/prime path
+            g_inj_open_tick[cyl] = TIM5_CNT | 1U;
+            if (g_inj_wdog_ticks[cyl] == 0U) {
+                g_inj_wdog_ticks[cyl] = kInjOpenWdogHardTicks;  // force/prime path
             }
-        } else if (idx >= ECU_IGN_CH_FIRST && idx < (ECU_IGN_CH_FIRST + 4U)) {
+        } else {
             // Dwell watchdog starts when the coil pin actually goes HIGH — not when
             // DWELL is merely queued (sub-tooth lead can be several ms).
-            const uint8_t ign_idx = (uint8_t)(idx - ECU_IGN_CH_FIRST);
             // OR 1: arm tick 0 is the inactive sentinel (TIM5_CNT can be 0).
-            g_dwell_arm_tick[ign_idx] = TIM5_CNT | 1U;
-            if (g_dwell_wdog_ticks[ign_idx] == 0U) {
-                g_dwell_wdog_ticks[ign_idx] = (si::g_dwell_ticks * 7U) / 5U;
+            g_dwell_arm_tick[cyl] = TIM5_CNT | 1U;
+            if (g_dwell_wdog_ticks[cyl] == 0U) {
+                g_dwell_wdog_ticks[cyl] = (si::g_sched_cal.view().dwell_ticks * 7U) / 5U;
             }
         }
     } else {
         ++g_pin_low_count[idx];
-        if (idx < 4U) {
-            g_inj_open_tick[idx] = 0U;
-            g_inj_wdog_ticks[idx] = 0U;
-        } else if (idx >= ECU_IGN_CH_FIRST && idx < (ECU_IGN_CH_FIRST + 4U)) {
+        if (cyl >= kCyl) {
+            // idem
+        } else if (is_inj != 0U) {
+            g_inj_open_tick[cyl] = 0U;
+            g_inj_wdog_ticks[cyl] = 0U;
+        } else {
             // IGN pin LOW = spark/safe: release dwell watchdog for that coil.
-            g_dwell_arm_tick[idx - ECU_IGN_CH_FIRST] = 0U;
+            g_dwell_arm_tick[cyl] = 0U;
         }
     }
     g_pin_last_state[idx] = high;
@@ -356,7 +424,7 @@ static void purge_events_for_cyl_mask(uint8_t mask, uint8_t is_ign)
     uint8_t w = 0U;
     for (uint8_t r = 0U; r < g_evt_count; ++r) {
         const uint8_t ch = g_evt_queue[r].channel;
-        const uint8_t bit = (ch < 8U)
+        const uint8_t bit = (ch < ECU_CHANNELS)
             ? (is_ign != 0U ? k_ign_ch_to_bit[ch] : k_inj_ch_to_bit[ch])
             : 0U;
         if (bit != 0U && (mask & bit) != 0U) {
@@ -366,7 +434,7 @@ static void purge_events_for_cyl_mask(uint8_t mask, uint8_t is_ign)
         ++w;
     }
     g_evt_count = w;
-    for (uint8_t cyl = 0U; cyl < 4U; ++cyl) {
+    for (uint8_t cyl = 0U; cyl < kCyl; ++cyl) {
         if ((mask & (1U << cyl)) == 0U) { continue; }
         if (is_ign != 0U) {
             force_output(si::kIgnCh[cyl], ECU_ACT_SPARK, 1U);
@@ -394,33 +462,42 @@ static inline uint32_t scheduler_counter(void)
 static void sanitize_runtime_calibration(void)
 {
     uint8_t clamped = 0U;
-    if (si::g_advance_deg > 60U) { si::g_advance_deg = 60U; clamped = 1U; }
+    si::SchedCalibration &c = g_cal_stage;
+    if (c.advance_deg > 60U) { c.advance_deg = 60U; clamped = 1U; }
     // Clamps em ticks TIM5 (62.5 MHz): 100000 ticks ≈ 1.6ms dwell máx
-    if (si::g_dwell_ticks > 625000U) { si::g_dwell_ticks = 625000U; clamped = 1U; }
-    if (si::g_inj_pw_ticks > 1250000U) { si::g_inj_pw_ticks = 1250000U; clamped = 1U; }
+    if (c.dwell_ticks > 625000U) { c.dwell_ticks = 625000U; clamped = 1U; }
+    if (c.inj_pw_ticks > 1250000U) { c.inj_pw_ticks = 1250000U; clamped = 1U; }
     // EOI lead ∈ [0, 719]: 0–129 = fim na compressão (closed-valve, soak longo);
     // 130–359 = válvula aberta / admissão (estilo Speeduino, default 355);
     // 360–719 = fim no escape/pré-IVO (closed-valve OEM, soak curto na válvula
     // quente — candidato a eoi_idle). Presync mapeia via % 360.
-    if (si::g_eoi_lead_deg >= ECU_CYCLE_DEG) { si::g_eoi_lead_deg = ECU_CYCLE_DEG - 1U; clamped = 1U; }
+    if (c.eoi_lead_deg >= ECU_CYCLE_DEG) { c.eoi_lead_deg = ECU_CYCLE_DEG - 1U; clamped = 1U; }
     if (si::g_presync_inj_mode > ECU_PRESYNC_INJ_SEMI_SEQUENTIAL) { si::g_presync_inj_mode = ECU_PRESYNC_INJ_SIMULTANEOUS; clamped = 1U; }
     if (g_presync_ign_mode > ECU_PRESYNC_IGN_WASTED_SPARK) { g_presync_ign_mode = ECU_PRESYNC_IGN_WASTED_SPARK; clamped = 1U; }
     if (clamped != 0U) { ++g_calibration_clamp_count; }
 }
 
+// Main loop only: sanitiza a cópia de trabalho e publica-a inteira. A ISR
+// nunca observa advance de um commit com PW de outro.
+static void publish_runtime_calibration(void)
+{
+    sanitize_runtime_calibration();
+    si::g_sched_cal.write(g_cal_stage);
+}
+
 static void force_output(uint8_t ch, uint8_t action, uint8_t is_safe_state)
 {
     // Safe-state transitions (INJ_OFF / SPARK) always allowed — never block a cut.
     // Non-safe ON paths honor inhibit masks so prime / test pulse cannot bypass
-    // fuel-protect, half lockout, rev-limit, or flood-driven mask=0x0F.
+    // fuel-protect, half lockout, rev-limit, or flood-driven mask=ECU_CYL_MASK_ALL.
     if (is_safe_state == 0U) {
-        const uint8_t is_inj = (ch < ECU_IGN_CH_FIRST) ? 1U : 0U;
+        const uint8_t is_inj = ch_is_inj(ch);
         if (is_inj != 0U && action == ECU_ACT_INJ_ON) {
-            const uint8_t cyl_bit = (ch < 8U) ? k_inj_ch_to_bit[ch] : 0U;
+            const uint8_t cyl_bit = (ch < ECU_CHANNELS) ? k_inj_ch_to_bit[ch] : 0U;
             if (cyl_bit != 0U && (g_inj_inhibit_mask & cyl_bit) != 0U) { return; }
         }
         if (is_inj == 0U && action == ECU_ACT_DWELL_START) {
-            const uint8_t cyl_bit = (ch < 8U) ? k_ign_ch_to_bit[ch] : 0U;
+            const uint8_t cyl_bit = (ch < ECU_CHANNELS) ? k_ign_ch_to_bit[ch] : 0U;
             if (cyl_bit != 0U && (g_ign_inhibit_mask & cyl_bit) != 0U) { return; }
         }
     }
@@ -437,19 +514,21 @@ static void arm_channel(uint8_t ch, uint32_t target_cnv, uint8_t action)
     // Atomic: read TIM5_CNT + queue insert must not interleave with TIM5 dispatch ISR.
     ems::hal::CriticalSectionGuard guard;
 
-    const uint8_t is_inj = (ch < ECU_IGN_CH_FIRST) ? 1U : 0U;
+    const uint8_t is_inj = ch_is_inj(ch);
     const uint8_t pin_idx = channel_pin_idx(ch);
     const uint32_t now = scheduler_counter();  // TIM5_CNT, 32-bit
 
     if (pin_idx == 0xFFU) { ++g_cycle_schedule_drop_count; return; }
+    const uint8_t cyl = pin_idx_cyl(pin_idx);
+    if (cyl >= kCyl) { ++g_cycle_schedule_drop_count; return; }
 
     // Inhibit masks: skip INJ_ON / DWELL_START for masked cylinders.
     if (is_inj != 0U && action == ECU_ACT_INJ_ON) {
-        const uint8_t cyl_bit = (ch < 8U) ? k_inj_ch_to_bit[ch] : 0U;
+        const uint8_t cyl_bit = k_inj_ch_to_bit[ch];
         if (cyl_bit != 0U && (g_inj_inhibit_mask & cyl_bit) != 0U) { return; }
     }
     if (is_inj == 0U && action == ECU_ACT_DWELL_START) {
-        const uint8_t cyl_bit = (ch < 8U) ? k_ign_ch_to_bit[ch] : 0U;
+        const uint8_t cyl_bit = k_ign_ch_to_bit[ch];
         if (cyl_bit != 0U && (g_ign_inhibit_mask & cyl_bit) != 0U) { return; }
     }
 
@@ -460,14 +539,18 @@ static void arm_channel(uint8_t ch, uint32_t target_cnv, uint8_t action)
     // Program watchdog timeouts at queue time; pin_transition starts the clock
     // only when the pin actually goes HIGH.
     if (is_inj != 0U && action == ECU_ACT_INJ_ON) {
-        uint32_t t = (si::g_inj_pw_ticks * 6U) / 5U;  // 1.2 × PW
+        // Sequencial: PW do próprio cilindro (vector / trim) se maior.
+        uint32_t pw = si::g_sched_cal.view().inj_pw_ticks;
+        if (si::g_knock_sequential != 0U && si::g_seq_cyl_pw_ticks[cyl] > pw) {
+            pw = si::g_seq_cyl_pw_ticks[cyl];
+        }
+        uint32_t t = (pw * 6U) / 5U;  // 1.2 × PW
         if (t < ECU_SCHED_US_TO_TICKS(2000U)) { t = ECU_SCHED_US_TO_TICKS(2000U); }
         if (t > kInjOpenWdogHardTicks) { t = kInjOpenWdogHardTicks; }
-        g_inj_wdog_ticks[pin_idx] = t;
+        g_inj_wdog_ticks[cyl] = t;
     }
     if (is_inj == 0U && action == ECU_ACT_DWELL_START) {
-        const uint8_t ign_idx = (uint8_t)(pin_idx - ECU_IGN_CH_FIRST);
-        g_dwell_wdog_ticks[ign_idx] = (si::g_dwell_ticks * 7U) / 5U;
+        g_dwell_wdog_ticks[cyl] = (si::g_sched_cal.view().dwell_ticks * 7U) / 5U;
     }
     (void)now;
 
@@ -494,8 +577,8 @@ static void clear_all_events_and_drive_safe_outputs(void)
     g_evt_count = 0U;
     g_evt_armed = 0U;
     TIM5_DIER &= ~TIM_DIER_CC3IE;
-    for (uint8_t i = 0U; i < ECU_CHANNELS; ++i) { force_output(i, (i < ECU_IGN_CH_FIRST) ? ECU_ACT_INJ_OFF : ECU_ACT_SPARK, 1U); }
-    for (uint8_t i = 0U; i < 4U; ++i) {
+    for (uint8_t i = 0U; i < ECU_CHANNELS; ++i) { force_output(i, (ch_is_inj(i) != 0U) ? ECU_ACT_INJ_OFF : ECU_ACT_SPARK, 1U); }
+    for (uint8_t i = 0U; i < kCyl; ++i) {
         g_dwell_arm_tick[i] = 0U;
         g_inj_open_tick[i] = 0U;
         g_inj_wdog_ticks[i] = 0U;
@@ -518,26 +601,57 @@ void ECU_Hardware_Init(void)
     clear_all_events_and_drive_safe_outputs();
 }
 
+// Main loop only: põe o vector na cópia de trabalho (publicado com os
+// escalares). Clamps iguais a sanitize_runtime_calibration.
+static void stage_cyl_vector(const EcuSchedCylVector *cyl)
+{
+    if (cyl == nullptr || g_inj_pw_override != 0U) {
+        g_cal_stage.cyl_active = 0U;
+        return;
+    }
+    EcuSchedCylVector v = {};
+    uint8_t clamped = 0U;
+    for (uint8_t i = 0U; i < kCyl; ++i) {
+        uint32_t pw = cyl->inj_pw_ticks[i];
+        uint16_t adv = cyl->advance_deg[i];
+        if (pw > 1250000U) { pw = 1250000U; clamped = 1U; }
+        if (adv > 60U) { adv = 60U; clamped = 1U; }
+        v.inj_pw_ticks[i] = pw;
+        v.advance_deg[i] = adv;
+    }
+    g_cal_stage.cyl = v;
+    g_cal_stage.cyl_active = 1U;
+    if (clamped != 0U) { ++g_calibration_clamp_count; }
+}
+
 void ecu_sched_commit_calibration(uint32_t advance_deg, uint32_t dwell_ticks, uint32_t inj_pw_ticks, uint32_t eoi_lead_deg)
 {
-    ems::hal::CriticalSectionGuard guard;
-    if (g_inj_pw_override == 0U) {
-        si::g_advance_deg = advance_deg;
-        si::g_dwell_ticks = dwell_ticks;
-        si::g_inj_pw_ticks = inj_pw_ticks;
-    } else if (g_inj_pw_override == 2U) {
-        si::g_advance_deg = advance_deg;
-        si::g_dwell_ticks = dwell_ticks;
-        si::g_inj_pw_ticks = inj_pw_ticks;
-        g_inj_pw_override = 1U;
-    }
-    si::g_eoi_lead_deg = eoi_lead_deg;
-    sanitize_runtime_calibration();
+    ecu_sched_commit_calibration_cyl(advance_deg, dwell_ticks, inj_pw_ticks, eoi_lead_deg, nullptr);
 }
-void ecu_sched_set_advance_deg(uint32_t adv) { ems::hal::CriticalSectionGuard guard; si::g_advance_deg = adv; sanitize_runtime_calibration(); }
-void ecu_sched_set_dwell_ticks(uint32_t dwell) { ems::hal::CriticalSectionGuard guard; si::g_dwell_ticks = dwell; sanitize_runtime_calibration(); }
-void ecu_sched_set_inj_pw_ticks(uint32_t pw_ticks) { ems::hal::CriticalSectionGuard guard; if (g_inj_pw_override == 0U) { si::g_inj_pw_ticks = pw_ticks; } sanitize_runtime_calibration(); }
-void ecu_sched_set_eoi_lead_deg(uint32_t eoi_lead_deg) { ems::hal::CriticalSectionGuard guard; si::g_eoi_lead_deg = eoi_lead_deg; sanitize_runtime_calibration(); }
+
+void ecu_sched_commit_calibration_cyl(uint32_t advance_deg,
+                                      uint32_t dwell_ticks,
+                                      uint32_t inj_pw_ticks,
+                                      uint32_t eoi_lead_deg,
+                                      const EcuSchedCylVector *cyl)
+{
+    // Sem secção crítica: vector e escalares vão na cópia de trabalho e são
+    // publicados juntos num só write do seqlock — a ISR do gap vê o commit
+    // anterior inteiro ou este inteiro.
+    stage_cyl_vector(cyl);
+    if (g_inj_pw_override == 0U || g_inj_pw_override == 2U) {
+        g_cal_stage.advance_deg = advance_deg;
+        g_cal_stage.dwell_ticks = dwell_ticks;
+        g_cal_stage.inj_pw_ticks = inj_pw_ticks;
+        if (g_inj_pw_override == 2U) { g_inj_pw_override = 1U; }
+    }
+    g_cal_stage.eoi_lead_deg = eoi_lead_deg;
+    publish_runtime_calibration();
+}
+void ecu_sched_set_advance_deg(uint32_t adv) { g_cal_stage.advance_deg = adv; publish_runtime_calibration(); }
+void ecu_sched_set_dwell_ticks(uint32_t dwell) { g_cal_stage.dwell_ticks = dwell; publish_runtime_calibration(); }
+void ecu_sched_set_inj_pw_ticks(uint32_t pw_ticks) { if (g_inj_pw_override == 0U) { g_cal_stage.inj_pw_ticks = pw_ticks; } publish_runtime_calibration(); }
+void ecu_sched_set_eoi_lead_deg(uint32_t eoi_lead_deg) { g_cal_stage.eoi_lead_deg = eoi_lead_deg; publish_runtime_calibration(); }
 void ecu_sched_set_presync_enable(uint8_t enable) { ems::hal::CriticalSectionGuard guard; g_presync_enable = (enable != 0U) ? 1U : 0U; }
 void ecu_sched_set_presync_inj_auto(uint8_t on) { ems::hal::CriticalSectionGuard guard; g_presync_inj_auto = on ? 1U : 0U; }
 
@@ -549,7 +663,7 @@ void ecu_sched_dwell_watchdog(void)
 {
     if (g_inj_pw_override != 0U) { return; }  // test mode — disable watchdog
     const uint32_t now = TIM5_CNT;
-    for (uint8_t i = 0U; i < 4U; ++i) {
+    for (uint8_t i = 0U; i < kCyl; ++i) {
         ems::hal::CriticalSectionGuard guard;
         const uint32_t arm  = g_dwell_arm_tick[i];  // TIM5_CNT at pin HIGH
         const uint32_t tout = g_dwell_wdog_ticks[i];
@@ -570,7 +684,7 @@ void ecu_sched_inj_watchdog(void)
 {
     if (g_inj_pw_override != 0U) { return; }  // test/bench PW lock — disable
     const uint32_t now = TIM5_CNT;
-    for (uint8_t i = 0U; i < 4U; ++i) {
+    for (uint8_t i = 0U; i < kCyl; ++i) {
         ems::hal::CriticalSectionGuard guard;
         const uint32_t open = g_inj_open_tick[i];
         const uint32_t tout = g_inj_wdog_ticks[i];
@@ -594,6 +708,7 @@ void ecu_sched_reset_diagnostic_counters(void)
 {
     ems::hal::CriticalSectionGuard guard;
     g_late_event_count = 0U;
+    for (uint8_t i = 0U; i < ECU_CHANNELS; ++i) { g_late_event_count_ch[i] = 0U; }
     g_cycle_schedule_drop_count = 0U;
     g_calibration_clamp_count = 0U;
         si::g_pw_duty_clamp_count = 0U;
@@ -606,14 +721,14 @@ void ecu_sched_fire_prime_pulse(uint32_t pw_us)
     if (pw_us == 0U) { return; }
     if (pw_us > 30000U) { pw_us = 30000U; }
     const uint32_t off_cnv = scheduler_counter() + ECU_SCHED_US_TO_TICKS(pw_us);
-    for (uint8_t i = 0U; i < 4U; ++i) { force_output(si::kInjCh[i], ECU_ACT_INJ_ON); }
-    for (uint8_t i = 0U; i < 4U; ++i) { arm_channel(si::kInjCh[i], off_cnv, ECU_ACT_INJ_OFF); }
+    for (uint8_t i = 0U; i < kCyl; ++i) { force_output(si::kInjCh[i], ECU_ACT_INJ_ON); }
+    for (uint8_t i = 0U; i < kCyl; ++i) { arm_channel(si::kInjCh[i], off_cnv, ECU_ACT_INJ_OFF); }
     ++g_diag_prime_fired;
 }
 
 void ecu_sched_test_pulse_inj(uint8_t cyl, uint32_t pw_us)
 {
-    if (cyl > 3U || pw_us == 0U) { return; }
+    if (cyl >= kCyl || pw_us == 0U) { return; }
     if (pw_us > 30000U) { pw_us = 30000U; }
     const uint8_t ch = si::kInjCh[cyl];
     const uint32_t off_cnv = scheduler_counter() + ECU_SCHED_US_TO_TICKS(pw_us);
@@ -623,7 +738,7 @@ void ecu_sched_test_pulse_inj(uint8_t cyl, uint32_t pw_us)
 
 void ecu_sched_test_pulse_ign(uint8_t cyl, uint32_t dwell_us)
 {
-    if (cyl > 3U) { return; }
+    if (cyl >= kCyl) { return; }
     if (dwell_us == 0U) { dwell_us = 3000U; }
     if (dwell_us > 10000U) { dwell_us = 10000U; }
     const uint8_t ch = si::kIgnCh[cyl];
@@ -657,7 +772,7 @@ void ecu_sched_set_mspark(uint8_t count, uint32_t inter_dwell_ticks, uint32_t at
 void ecu_sched_set_inj_inhibit_mask(uint8_t mask)
 {
     ems::hal::CriticalSectionGuard guard;
-    const uint8_t new_mask = mask & 0x0FU;
+    const uint8_t new_mask = mask & ECU_CYL_MASK_ALL;
     // Rising bits only: purge+force OFF for newly inhibited cylinders so a
     // mid-pulse fuel cut cannot leave an injector stuck open. Clearing the
     // mask (re-enable) only updates the mask; OFF/ON pairing resumes on next arm.
@@ -672,7 +787,7 @@ uint8_t ecu_sched_get_inj_inhibit_mask(void) { return g_inj_inhibit_mask; }
 void ecu_sched_set_ign_inhibit_mask(uint8_t mask)
 {
     ems::hal::CriticalSectionGuard guard;
-    const uint8_t new_mask = mask & 0x0FU;
+    const uint8_t new_mask = mask & ECU_CYL_MASK_ALL;
     const uint8_t newly = static_cast<uint8_t>(new_mask & ~g_ign_inhibit_mask);
     g_ign_inhibit_mask = new_mask;
     // Spark-cut (limp rev_cut): drop any pending dwell/spark for inhibited
@@ -724,6 +839,12 @@ void ecu_sched_get_pin_counts_u32x24(uint32_t out[24])
     }
 }
 
+void ecu_sched_get_late_counts_u32x8(uint32_t out[8])
+{
+    if (out == nullptr) { return; }
+    for (uint8_t i = 0U; i < 8U; ++i) { out[i] = g_late_event_count_ch[i]; }
+}
+
 void ecu_sched_get_diag_snapshot(EcuSchedDiagSnapshot *out)
 {
     if (out == nullptr) { return; }
@@ -787,9 +908,9 @@ void ecu_sched_on_tooth_hook(const ems::drv::CkpSnapshot& snap) noexcept
             g_evt_armed = 0U;
             TIM5_DIER &= ~TIM_DIER_CC3IE;
             for (uint8_t i = 0U; i < ECU_CHANNELS; ++i) {
-                force_output(i, (i < ECU_IGN_CH_FIRST) ? ECU_ACT_INJ_OFF : ECU_ACT_SPARK, 1U);
+                force_output(i, (ch_is_inj(i) != 0U) ? ECU_ACT_INJ_OFF : ECU_ACT_SPARK, 1U);
             }
-            for (uint8_t i = 0U; i < 4U; ++i) {
+            for (uint8_t i = 0U; i < kCyl; ++i) {
                 g_dwell_arm_tick[i] = 0U;
                 g_inj_open_tick[i] = 0U;
                 g_inj_wdog_ticks[i] = 0U;
@@ -850,16 +971,17 @@ void schedule_on_tooth(const CkpSnapshot& snap) noexcept { ems::engine::ecu_sche
 void ecu_sched_test_reset(void)
 {
     g_late_event_count = 0U; g_cycle_schedule_drop_count = 0U; g_calibration_clamp_count = 0U;
+    for (uint8_t i = 0U; i < ECU_CHANNELS; ++i) { g_late_event_count_ch[i] = 0U; }
     g_presync_enable = 1U; g_presync_inj_auto = 0U; si::g_presync_inj_mode = ECU_PRESYNC_INJ_SEMI_SEQUENTIAL; g_presync_ign_mode = ECU_PRESYNC_IGN_WASTED_SPARK;
     si::g_presync_bank_toggle = 0U; g_hook_prev_valid = 0U; g_hook_prev_tooth = 0U; g_hook_schedule_this_gap = 1U;
-    si::g_advance_deg = 10U; si::g_dwell_ticks = 140625U; si::g_inj_pw_ticks = 140625U; si::g_eoi_lead_deg = 355U;
+    g_cal_stage = {10U, 140625U, 140625U, 355U, {}, 0U}; si::g_sched_cal.test_reset(); si::g_sched_cal.write(g_cal_stage);
     si::g_angle_table_count = 0U; si::g_angle_tooth_mask_lo = 0U; si::g_angle_tooth_mask_hi = 0U;
     si::g_pw_duty_clamp_count = 0U;
     g_inj_inhibit_mask = 0U;
     g_ign_inhibit_mask = 0U;
     si::g_mspark_count = 0U; si::g_mspark_inter_dwell_ticks = 0U; si::g_mspark_atdc_limit_deg = 18U;
     // Reset dwell / inj open watchdog state
-    for (uint8_t i = 0U; i < 4U; ++i) {
+    for (uint8_t i = 0U; i < kCyl; ++i) {
         g_dwell_arm_tick[i] = 0U; g_dwell_wdog_ticks[i] = 0U;
         g_inj_open_tick[i] = 0U; g_inj_wdog_ticks[i] = 0U;
     }
@@ -874,6 +996,7 @@ void ecu_sched_test_reset(void)
     // de arrancar em estado limpo (senão herdam contagem de testes anteriores).
     g_diag_presync_revs = 0U; g_diag_seq_revs = 0U;
     si::g_knock_sequential = 0U; g_cmp_phase_seen = 0U;
+    for (uint8_t i = 0U; i < kCyl; ++i) { si::g_seq_cyl_pw_ticks[i] = 0U; }
 }
 uint8_t ecu_sched_test_angle_table_size(void) { return si::g_angle_table_count; }
 uint8_t ecu_sched_test_get_angle_event(uint8_t index, uint8_t *tooth, uint8_t *sub_frac, uint8_t *ch, uint8_t *action, uint8_t *phase)
@@ -885,10 +1008,10 @@ void ecu_sched_test_set_advance_deg(uint32_t adv) { ecu_sched_set_advance_deg(ad
 void ecu_sched_test_set_dwell_ticks(uint32_t dwell) { ecu_sched_set_dwell_ticks(dwell); }
 void ecu_sched_test_set_inj_pw_ticks(uint32_t pw_ticks) { ecu_sched_set_inj_pw_ticks(pw_ticks); }
 void ecu_sched_test_set_eoi_lead_deg(uint32_t eoi_lead_deg) { ecu_sched_set_eoi_lead_deg(eoi_lead_deg); }
-uint32_t ecu_sched_test_get_advance_deg(void) { return si::g_advance_deg; }
-uint32_t ecu_sched_test_get_dwell_ticks(void) { return si::g_dwell_ticks; }
-uint32_t ecu_sched_test_get_inj_pw_ticks(void) { return si::g_inj_pw_ticks; }
-uint32_t ecu_sched_test_get_eoi_lead_deg(void) { return si::g_eoi_lead_deg; }
+uint32_t ecu_sched_test_get_advance_deg(void) { return si::g_sched_cal.read().advance_deg; }
+uint32_t ecu_sched_test_get_dwell_ticks(void) { return si::g_sched_cal.read().dwell_ticks; }
+uint32_t ecu_sched_test_get_inj_pw_ticks(void) { return si::g_sched_cal.read().inj_pw_ticks; }
+uint32_t ecu_sched_test_get_eoi_lead_deg(void) { return si::g_sched_cal.read().eoi_lead_deg; }
 uint32_t ecu_sched_test_get_calibration_clamp_count(void) { return g_calibration_clamp_count; }
 uint32_t ecu_sched_test_get_cycle_schedule_drop_count(void) { return g_cycle_schedule_drop_count; }
 uint32_t ecu_sched_test_get_late_event_count(void) { return g_late_event_count; }
@@ -930,4 +1053,13 @@ uint8_t  ecu_sched_test_get_evt(uint8_t index,
 }
 uint32_t ecu_sched_test_get_presync_revs(void) { return g_diag_presync_revs; }
 uint32_t ecu_sched_test_get_seq_revs(void) { return g_diag_seq_revs; }
+uint32_t ecu_sched_test_get_cyl_vector_seq(void) { return si::g_sched_cal.sequence(); }
+uint8_t ecu_sched_test_read_cyl_vector(EcuSchedCylVector *out)
+{
+    const si::SchedCalibration cal = si::g_sched_cal.read();
+    if (cal.cyl_active == 0U) { return 0U; }
+    *out = cal.cyl;
+    return 1U;
+}
+void ecu_sched_test_cyl_vector_begin_write(void) { si::g_sched_cal.test_begin_write(); }
 #endif
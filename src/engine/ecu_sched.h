@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "hal/board_pinout.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -28,11 +30,25 @@ extern "C" {
 #define ECU_CH_IGN2   6U
 #define ECU_CH_IGN3   5U
 #define ECU_CH_IGN4   4U
+// Banco 5–8 (EMS_CYLINDERS > 4, VGT6 GPIOD): canal = 8 + (0..3 INJ | 4..7 IGN).
+#define ECU_CH_INJ5   8U
+#define ECU_CH_INJ6   9U
+#define ECU_CH_INJ7   10U
+#define ECU_CH_INJ8   11U
+#define ECU_CH_IGN5   12U
+#define ECU_CH_IGN6   13U
+#define ECU_CH_IGN7   14U
+#define ECU_CH_IGN8   15U
+
+#define ECU_CYL_COUNT     ((uint8_t)EMS_CYLINDERS)
+#define ECU_CHANNEL_COUNT ((uint8_t)EMS_OUT_CHANNELS)
+// Todos os cilindros (bit N = cilindro N) — corte total via inhibit mask.
+#define ECU_CYL_MASK_ALL  ((uint8_t)((1U << EMS_CYLINDERS) - 1U))
 
-// Sequential: 4 cyl × (DWELL+SPARK+INJ_ON+INJ_OFF) = 16
-// + multi-spark: max 3 extra × 2 events × 4 cyl = 24 → 40. Presync wasted can
-// reach ~40 with simultaneous inj + multi-spark. Keep margin.
-#define ECU_ANGLE_TABLE_SIZE  48U
+// Por cilindro: sequential DWELL+SPARK+INJ_ON+INJ_OFF = 4, multi-spark até
+// 3 extra × 2 = 6 → 10·N. Presync wasted: N × (2 + 6) ign + N × 2 inj
+// (simultaneous) = 10·N. +8 de margem (4 cil → 48, 8 cil → 88).
+#define ECU_ANGLE_TABLE_SIZE  (10U * (EMS_CYLINDERS) + 8U)
 
 typedef struct {
     uint8_t tooth_index;
@@ -71,6 +87,27 @@ void ecu_sched_commit_calibration(uint32_t advance_deg,
                                   uint32_t dwell_ticks,
                                   uint32_t inj_pw_ticks,
                                   uint32_t eoi_lead_deg);
+
+// Vector por cilindro (índice = cilindro físico 0..N-1) já com trims,
+// balanceamento MAP e retardo de knock aplicados (engine/cyl_pulse). Usado
+// só pelo builder sequencial; presync / multi-spark / watchdogs continuam
+// nos escalares de commit_calibration.
+typedef struct {
+    uint32_t inj_pw_ticks[EMS_CYLINDERS];  // PW comandado (fluxo + dead-time)
+    uint16_t advance_deg[EMS_CYLINDERS];   // avanço efectivo, ° BTDC
+} EcuSchedCylVector;
+
+// Como commit_calibration + publicação do vector (cyl != NULL). Vector e
+// escalares vão no mesmo bloco seqlock (buffer inactivo de um par duplo,
+// publicado por incremento de sequência) — sem secção crítica; o builder
+// (ISR do gap) lê sempre um commit inteiro, nunca o vector de um com o
+// dwell/EOI de outro. cyl == NULL (ou PW de bancada bloqueado) desactiva o
+// vector e o builder volta aos trims estáticos cyl_*_trim sobre os escalares.
+void ecu_sched_commit_calibration_cyl(uint32_t advance_deg,
+                                      uint32_t dwell_ticks,
+                                      uint32_t inj_pw_ticks,
+                                      uint32_t eoi_lead_deg,
+                                      const EcuSchedCylVector *cyl);
 void ecu_sched_set_advance_deg(uint32_t adv);
 void ecu_sched_set_dwell_ticks(uint32_t dwell);
 void ecu_sched_set_inj_pw_ticks(uint32_t pw_ticks);
@@ -103,7 +140,7 @@ void ecu_sched_set_mspark(uint8_t  count,
                           uint32_t atdc_limit_deg);
 
 // Per-cylinder injection inhibit (MS42 §2.2.5 — corte de cilindros).
-// mask: bit 0 = cyl 0, bit 1 = cyl 1, ..., bit 3 = cyl 3.
+// mask: bit 0 = cyl 0, bit 1 = cyl 1, ..., bit N-1 (bits ≥ N ignorados).
 // Quando o bit está activo, ECU_ACT_INJ_ON é suprimido no canal correspondente.
 // ECU_ACT_INJ_OFF passa normalmente (fechar injetor já fechado é inócuo).
 // Aplica-se tanto ao modo sequencial como presync.
@@ -111,7 +148,7 @@ void ecu_sched_set_inj_inhibit_mask(uint8_t mask);
 uint8_t ecu_sched_get_inj_inhibit_mask(void);
 
 // Per-cylinder ignition inhibit (limp spark-cut; production rev-limit is fuel-only).
-// mask: bit 0 = cyl 0 … bit 3 = cyl 3.
+// mask: bit 0 = cyl 0 … bit N-1 = cyl N-1.
 // Suprime ECU_ACT_DWELL_START, purga eventos IGN pendentes do canal e força pin LOW
 // (não deixar bobina carregada a meio do dwell).
 void ecu_sched_set_ign_inhibit_mask(uint8_t mask);
@@ -140,10 +177,14 @@ void ecu_sched_get_angle_trace(uint32_t *gap_ts,
                                uint8_t *ring_idx,
                                EcuSchedTsSample out_last8[8]);
 
-// Pin transition counters for all 8 channels: high/low/seq_error interleaved
-// as 24×u32 for protocol 'V' (same layout as before).
+// Pin transition counters for the first 8 channels (banco 1–4): high/low/
+// seq_error interleaved as 24×u32 for protocol 'V' (same layout as before).
 void ecu_sched_get_pin_counts_u32x24(uint32_t out[24]);
 
+// Late events per channel (index = ECU_CH_* 0..7; banco 5–8 entra só na soma
+// g_late_event_count) for the per-cycle CAN FD telemetry frame.
+void ecu_sched_get_late_counts_u32x8(uint32_t out[8]);
+
 // Scheduler-owned fields used by protocol 'D' (order matches historical diag[]
 // slots for these counters — callers still interleave CKP/fuel fields).
 typedef struct {
@@ -167,7 +208,7 @@ typedef struct {
 void ecu_sched_get_diag_snapshot(EcuSchedDiagSnapshot *out);
 
 // Teste de saídas em bancada: pulso único num canal individual (motor parado).
-// cyl = 0-3 na ordem INJ1..INJ4 / IGN1..IGN4. pw_us clamp ≤30000; dwell_us
+// cyl = 0..N-1 na ordem INJ1..INJn / IGN1..IGNn. pw_us clamp ≤30000; dwell_us
 // clamp ≤10000 (o dwell-watchdog fica armado como backstop do SPARK).
 void ecu_sched_test_pulse_inj(uint8_t cyl, uint32_t pw_us);
 void ecu_sched_test_pulse_ign(uint8_t cyl, uint32_t dwell_us);
@@ -221,6 +262,12 @@ uint8_t  ecu_sched_test_get_evt(uint8_t index,
 // Contadores de revoluções por modo — validam a transição presync↔sequencial.
 uint32_t ecu_sched_test_get_presync_revs(void);
 uint32_t ecu_sched_test_get_seq_revs(void);
+// Vector por cilindro: sequência publicada (0 = nunca) e leitura como o
+// builder a faz. begin_write simula um commit a meio (sequência ímpar
+// pendente) para exercitar o retry do leitor.
+uint32_t ecu_sched_test_get_cyl_vector_seq(void);
+uint8_t  ecu_sched_test_read_cyl_vector(EcuSchedCylVector *out);
+void     ecu_sched_test_cyl_vector_begin_write(void);
 #endif
 
 #ifdef __cplusplus
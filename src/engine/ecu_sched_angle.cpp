@@ -9,6 +9,7 @@
 
 #include "engine/calibration.h"
 #include "engine/engine_config.h"
+#include "drv/tooth_geom.h"
 
 #include <stdint.h>
 
@@ -18,6 +19,7 @@ AngleEvent_t g_angle_table[ECU_ANGLE_TABLE_SIZE];
 uint8_t g_angle_table_count = 0U;
 uint32_t g_angle_tooth_mask_lo = 0U;
 uint32_t g_angle_tooth_mask_hi = 0U;
+volatile uint32_t g_seq_cyl_pw_ticks[EMS_CYLINDERS] = {};
 
 void clear_angle_table(void)
 {
@@ -31,13 +33,22 @@ static void angle_to_tooth_event(uint32_t angle_deg,
                                  uint8_t *out_sub_frac,
                                  uint8_t *out_phase_A)
 {
+    // Posição ×256 na roda (360°/N por posição) → último dente real antes
+    // do ângulo. Ângulos dentro de um gap ficam no último dente do segmento
+    // com frac saturado (60-2: posições 58-59 → dente 57, frac 255).
+    const ems::drv::TriggerWheel &w = ems::drv::ckp_wheel();
     const uint32_t ang = angle_deg % 360U;
-    uint32_t pos_x256 = (ang * 256U) / 6U;
-    uint8_t tooth = static_cast<uint8_t>(pos_x256 >> 8U);
-    uint8_t frac = static_cast<uint8_t>(pos_x256 & 0xFFU);
-    if (tooth > 57U) {
-        tooth = 57U;
-        frac = 255U;
+    const uint32_t pos_x256 = (ang * 256U * w.positions) / 360U;
+    uint8_t tooth;
+    uint8_t frac;
+    if (ems::engine::tooth_geom_enable != 0U) {
+        // Posições reais aprendidas: dente e fracção do comprimento desse
+        // intervalo (o hook escala pelo período previsto do mesmo intervalo).
+        ems::drv::tooth_geom_map_position(pos_x256, &tooth, &frac);
+    } else {
+        tooth = w.pos_to_tooth[pos_x256 >> 8U];
+        const uint32_t frac_x256 = pos_x256 - (static_cast<uint32_t>(w.tooth_pos[tooth]) << 8U);
+        frac = (frac_x256 > 255U) ? 255U : static_cast<uint8_t>(frac_x256);
     }
     *out_phase_A = (angle_deg < 360U) ? ECU_PHASE_A : ECU_PHASE_B;
     *out_tooth = tooth;
@@ -82,7 +93,9 @@ static uint32_t ticks_to_cycle_degrees(uint32_t ticks,
 {
     const uint64_t tooth_ticks =
         static_cast<uint64_t>(TOOTH_NS_TO_SCHED_INTERNAL(tooth_period_ns));
-    const uint64_t factor = (cycle_deg == kCycleDeg) ? 120ULL : 60ULL;
+    // Posições da roda por ciclo (2N em 720°, N em 360°).
+    const uint64_t positions = ems::drv::ckp_wheel().positions;
+    const uint64_t factor = (cycle_deg == kCycleDeg) ? 2ULL * positions : positions;
     const uint64_t denom = tooth_ticks * factor;
     return (denom > 0ULL)
         ? static_cast<uint32_t>((static_cast<uint64_t>(ticks) * cycle_deg) / denom)
@@ -91,7 +104,8 @@ static uint32_t ticks_to_cycle_degrees(uint32_t ticks,
 
 // Multi-spark timing MS42 — single site for sequential and presync.
 template <typename EmitFn>
-static inline void emit_multispark(uint32_t spark_ang,
+static inline void emit_multispark(uint32_t advance_deg,
+                                   uint32_t spark_ang,
                                    uint32_t cycle_deg,
                                    uint32_t tooth_period_ns,
                                    EmitFn emit)
@@ -103,7 +117,7 @@ static inline void emit_multispark(uint32_t spark_ang,
     const uint32_t inter_deg =
         ticks_to_cycle_degrees(g_mspark_inter_dwell_ticks, tooth_period_ns, cycle_deg);
     const uint32_t step = inter_deg + 1U;
-    const uint32_t window = g_advance_deg + g_mspark_atdc_limit_deg;
+    const uint32_t window = advance_deg + g_mspark_atdc_limit_deg;
     for (uint8_t n = 1U; n <= ms_count; ++n) {
         const uint32_t add_spark_off = static_cast<uint32_t>(n) * step;
         if (add_spark_off >= window) {
@@ -117,36 +131,55 @@ static inline void emit_multispark(uint32_t spark_ang,
 
 void rebuild_sequential_cycle(const ems::drv::CkpSnapshot& snap)
 {
-    static_assert(cfg::kCylinderCount == 4u, "ign/inj channel tables are 4-cyl");
     const uint8_t* const ign_ch = kIgnCh;
     const uint8_t* const inj_ch = kInjCh;
 
     g_knock_sequential = 1U;
     clear_angle_table();
 
+    // Um bloco coerente por build (commit inteiro, nunca campos misturados).
+    const SchedCalibration cal = g_sched_cal.read();
     const uint32_t dwell_deg =
-        ticks_to_cycle_degrees(g_dwell_ticks, snap.tooth_period_ns, kCycleDeg);
-    const uint32_t base_inj_pw_deg =
-        ticks_to_cycle_degrees(g_inj_pw_ticks, snap.tooth_period_ns, kCycleDeg);
+        ticks_to_cycle_degrees(cal.dwell_ticks, snap.tooth_period_ns, kCycleDeg);
+
+    // Vector do main loop (trims/balance/knock já aplicados, mesmo commit dos
+    // escalares) ou, sem ele, trims estáticos sobre os escalares (bancada,
+    // arranque, testes).
+    const bool use_vec = (cal.cyl_active != 0U);
+    const EcuSchedCylVector &vec = cal.cyl;
+    const uint32_t base_inj_pw_deg = use_vec ? 0U :
+        ticks_to_cycle_degrees(cal.inj_pw_ticks, snap.tooth_period_ns, kCycleDeg);
 
     for (uint8_t seq = 0U; seq < cfg::kCylinderCount; ++seq) {
         const uint8_t cyl = cfg::kFiringOrder[seq];
         const uint32_t tdc = cfg::cyl_tdc_deg(cyl);
 
-        const int32_t ign_trim = static_cast<int32_t>(cyl_ign_trim_deg[cyl]);
-        const int32_t trimmed_advance = static_cast<int32_t>(g_advance_deg) + ign_trim;
-        const uint32_t eff_advance = (trimmed_advance < 0)
-            ? 0u
-            : static_cast<uint32_t>(trimmed_advance);
+        uint32_t eff_advance = 0U;
+        uint32_t inj_pw = 0U;
+        if (use_vec) {
+            eff_advance = vec.advance_deg[cyl];
+            inj_pw = ticks_to_cycle_degrees(vec.inj_pw_ticks[cyl],
+                                            snap.tooth_period_ns, kCycleDeg);
+            g_seq_cyl_pw_ticks[cyl] = vec.inj_pw_ticks[cyl];
+        } else {
+            const int32_t ign_trim = static_cast<int32_t>(cyl_ign_trim_deg[cyl]);
+            const int32_t trimmed_advance = static_cast<int32_t>(cal.advance_deg) + ign_trim;
+            eff_advance = (trimmed_advance < 0)
+                ? 0u
+                : static_cast<uint32_t>(trimmed_advance);
+
+            const int32_t fuel_trim = static_cast<int32_t>(cyl_fuel_trim_pct[cyl]);
+            const int32_t pw_trimmed =
+                static_cast<int32_t>(base_inj_pw_deg) * (100 + fuel_trim) / 100;
+            inj_pw = (pw_trimmed < 0) ? 0u : static_cast<uint32_t>(pw_trimmed);
+            g_seq_cyl_pw_ticks[cyl] = (fuel_trim > 0)
+                ? cal.inj_pw_ticks * static_cast<uint32_t>(100 + fuel_trim) / 100U
+                : cal.inj_pw_ticks;
+        }
 
         const uint32_t spark = (tdc + kCycleDeg - eff_advance) % kCycleDeg;
         const uint32_t dwell = (spark + kCycleDeg - dwell_deg) % kCycleDeg;
-        const uint32_t eoi = (tdc + kCycleDeg - g_eoi_lead_deg) % kCycleDeg;
-
-        const int32_t fuel_trim = static_cast<int32_t>(cyl_fuel_trim_pct[cyl]);
-        const int32_t pw_trimmed =
-            static_cast<int32_t>(base_inj_pw_deg) * (100 + fuel_trim) / 100;
-        uint32_t inj_pw = (pw_trimmed < 0) ? 0u : static_cast<uint32_t>(pw_trimmed);
+        const uint32_t eoi = (tdc + kCycleDeg - cal.eoi_lead_deg) % kCycleDeg;
 
         if (inj_pw > kMaxSeqInjPwDeg) {
             inj_pw = kMaxSeqInjPwDeg;
@@ -164,7 +197,7 @@ void rebuild_sequential_cycle(const ems::drv::CkpSnapshot& snap)
                              &tooth, &frac, &phase);
         table_add(tooth, frac, phase, ign_ch[cyl], ECU_ACT_SPARK);
 
-        emit_multispark(spark, kCycleDeg, snap.tooth_period_ns,
+        emit_multispark(cal.advance_deg, spark, kCycleDeg, snap.tooth_period_ns,
             [&](uint32_t add_dwell_ang, uint32_t add_spark_ang) {
                 angle_to_tooth_event(
                     engine_angle_to_trigger_angle(add_dwell_ang, kCycleDeg),
@@ -185,10 +218,36 @@ void rebuild_sequential_cycle(const ems::drv::CkpSnapshot& snap)
     }
 }
 
+// Bancos semi-sequenciais: posições de disparo a 360° (companheiras) ficam no
+// mesmo banco e os bancos alternam por volta. Posição p → banco
+// (p mod N/2) & 1 — 4 cil (1-3-4-2): A = {cil 0, 3}, B = {cil 2, 1}.
+struct PresyncBanks {
+    uint8_t ch[2][cfg::kCylinderCount];
+    uint8_t count[2];
+};
+
+static constexpr PresyncBanks make_presync_banks() noexcept
+{
+    PresyncBanks b{};
+    const uint8_t half = (cfg::kCylinderCount >= 2u)
+        ? static_cast<uint8_t>(cfg::kCylinderCount / 2u) : 1u;
+    for (uint8_t cyl = 0u; cyl < cfg::kCylinderCount; ++cyl) {
+        const uint8_t bank = static_cast<uint8_t>((cfg::cyl_firing_pos(cyl) % half) & 1u);
+        b.ch[bank][b.count[bank]++] = kInjCh[cyl];
+    }
+    return b;
+}
+
+static constexpr PresyncBanks kPresyncBanks = make_presync_banks();
+static_assert(cfg::kCylinderCount != 4u ||
+              (kPresyncBanks.count[0] == 2u && kPresyncBanks.ch[0][0] == ECU_CH_INJ1 &&
+               kPresyncBanks.ch[0][1] == ECU_CH_INJ4 && kPresyncBanks.ch[1][0] == ECU_CH_INJ2 &&
+               kPresyncBanks.ch[1][1] == ECU_CH_INJ3),
+              "4 cil: bancos presync {INJ1,INJ4} / {INJ2,INJ3}");
+
 void rebuild_presync_revolution(const ems::drv::CkpSnapshot& snap)
 {
-    static const uint8_t inj_a[2U] = {ECU_CH_INJ1, ECU_CH_INJ4};
-    static const uint8_t inj_b[2U] = {ECU_CH_INJ2, ECU_CH_INJ3};
+    constexpr uint8_t kN = cfg::kCylinderCount;
     const uint8_t* const inj_all = kInjCh;
     const uint8_t* const ign = kIgnCh;
     uint8_t tooth = 0U, frac = 0U, phase = 0U;
@@ -196,44 +255,45 @@ void rebuild_presync_revolution(const ems::drv::CkpSnapshot& snap)
     g_knock_sequential = 0U;
     clear_angle_table();
 
+    const SchedCalibration cal = g_sched_cal.read();
     const uint32_t dwell_deg =
-        ticks_to_cycle_degrees(g_dwell_ticks, snap.tooth_period_ns, 360U);
+        ticks_to_cycle_degrees(cal.dwell_ticks, snap.tooth_period_ns, 360U);
     uint32_t inj_pw_deg = ticks_to_cycle_degrees(
         (g_presync_inj_mode == ECU_PRESYNC_INJ_SIMULTANEOUS)
-            ? (g_inj_pw_ticks / 2U)
-            : g_inj_pw_ticks,
+            ? (cal.inj_pw_ticks / 2U)
+            : cal.inj_pw_ticks,
         snap.tooth_period_ns, 360U);
     if (inj_pw_deg > kMaxPresyncInjPwDeg) {
         inj_pw_deg = kMaxPresyncInjPwDeg;
         ++g_pw_duty_clamp_count;
     }
-    const uint32_t spark = (360U - (g_advance_deg % 360U)) % 360U;
+    const uint32_t spark = (360U - (cal.advance_deg % 360U)) % 360U;
     const uint32_t dwell = (spark + 360U - dwell_deg) % 360U;
-    const uint32_t eoi = (360U - (g_eoi_lead_deg % 360U)) % 360U;
+    const uint32_t eoi = (360U - (cal.eoi_lead_deg % 360U)) % 360U;
     const uint32_t inj_on = (eoi + 360U - inj_pw_deg) % 360U;
     const uint32_t inj_off = eoi;
 
     angle_to_tooth_event(engine_angle_to_trigger_angle(dwell, 360U),
                          &tooth, &frac, &phase);
-    for (uint8_t i = 0U; i < 4U; ++i) {
+    for (uint8_t i = 0U; i < kN; ++i) {
         table_add(tooth, frac, ECU_PHASE_ANY, ign[i], ECU_ACT_DWELL_START);
     }
     angle_to_tooth_event(engine_angle_to_trigger_angle(spark, 360U),
                          &tooth, &frac, &phase);
-    for (uint8_t i = 0U; i < 4U; ++i) {
+    for (uint8_t i = 0U; i < kN; ++i) {
         table_add(tooth, frac, ECU_PHASE_ANY, ign[i], ECU_ACT_SPARK);
     }
 
-    emit_multispark(spark, 360U, snap.tooth_period_ns,
+    emit_multispark(cal.advance_deg, spark, 360U, snap.tooth_period_ns,
         [&](uint32_t add_dwell_ang, uint32_t add_spark_ang) {
             angle_to_tooth_event(engine_angle_to_trigger_angle(add_dwell_ang, 360U),
                                  &tooth, &frac, &phase);
-            for (uint8_t i = 0U; i < 4U; ++i) {
+            for (uint8_t i = 0U; i < kN; ++i) {
                 table_add(tooth, frac, ECU_PHASE_ANY, ign[i], ECU_ACT_DWELL_START);
             }
             angle_to_tooth_event(engine_angle_to_trigger_angle(add_spark_ang, 360U),
                                  &tooth, &frac, &phase);
-            for (uint8_t i = 0U; i < 4U; ++i) {
+            for (uint8_t i = 0U; i < kN; ++i) {
                 table_add(tooth, frac, ECU_PHASE_ANY, ign[i], ECU_ACT_SPARK);
             }
         });
@@ -241,13 +301,13 @@ void rebuild_presync_revolution(const ems::drv::CkpSnapshot& snap)
     angle_to_tooth_event(engine_angle_to_trigger_angle(inj_on, 360U),
                          &tooth, &frac, &phase);
     if (g_presync_inj_mode == ECU_PRESYNC_INJ_SIMULTANEOUS) {
-        for (uint8_t i = 0U; i < 4U; ++i) {
+        for (uint8_t i = 0U; i < kN; ++i) {
             table_add(tooth, frac, ECU_PHASE_ANY, inj_all[i], ECU_ACT_INJ_ON);
         }
     } else {
-        const uint8_t *bank = (g_presync_bank_toggle == 0U) ? inj_a : inj_b;
-        for (uint8_t i = 0U; i < 2U; ++i) {
-            table_add(tooth, frac, ECU_PHASE_ANY, bank[i], ECU_ACT_INJ_ON);
+        const uint8_t b = (g_presync_bank_toggle == 0U) ? 0U : 1U;
+        for (uint8_t i = 0U; i < kPresyncBanks.count[b]; ++i) {
+            table_add(tooth, frac, ECU_PHASE_ANY, kPresyncBanks.ch[b][i], ECU_ACT_INJ_ON);
         }
         g_presync_bank_toggle ^= 1U;
     }
@@ -255,13 +315,13 @@ void rebuild_presync_revolution(const ems::drv::CkpSnapshot& snap)
     angle_to_tooth_event(engine_angle_to_trigger_angle(inj_off, 360U),
                          &tooth, &frac, &phase);
     if (g_presync_inj_mode == ECU_PRESYNC_INJ_SIMULTANEOUS) {
-        for (uint8_t i = 0U; i < 4U; ++i) {
+        for (uint8_t i = 0U; i < kN; ++i) {
             table_add(tooth, frac, ECU_PHASE_ANY, inj_all[i], ECU_ACT_INJ_OFF);
         }
     } else {
-        const uint8_t *bank = (g_presync_bank_toggle == 1U) ? inj_a : inj_b;
-        for (uint8_t i = 0U; i < 2U; ++i) {
-            table_add(tooth, frac, ECU_PHASE_ANY, bank[i], ECU_ACT_INJ_OFF);
+        const uint8_t b = (g_presync_bank_toggle == 1U) ? 0U : 1U;
+        for (uint8_t i = 0U; i < kPresyncBanks.count[b]; ++i) {
+            table_add(tooth, frac, ECU_PHASE_ANY, kPresyncBanks.ch[b][i], ECU_ACT_INJ_OFF);
         }
     }
 }
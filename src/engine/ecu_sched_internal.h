@@ -14,6 +14,7 @@
 
 #include "engine/ecu_sched.h"
 #include "drv/ckp.h"
+#include "hal/seqlock.h"
 
 #include <stdint.h>
 
@@ -28,11 +29,14 @@ inline constexpr uint32_t kMaxPresyncInjPwDeg = 324U;  // 90% of 360°
 #define TOOTH_NS_TO_SCHED_INTERNAL(ns) \
     (static_cast<uint32_t>((ns) / ECU_SCHED_NS_PER_TICK))
 
-// Channel order cyl 0..3 — values match ECU_CH_* (legacy TIM map).
-inline constexpr uint8_t kInjCh[4] = {
-    ECU_CH_INJ1, ECU_CH_INJ2, ECU_CH_INJ3, ECU_CH_INJ4};
-inline constexpr uint8_t kIgnCh[4] = {
-    ECU_CH_IGN1, ECU_CH_IGN2, ECU_CH_IGN3, ECU_CH_IGN4};
+// Channel order cyl 0..7 — values match ECU_CH_* (legacy TIM map + banco
+// 5–8). Só os primeiros cfg::kCylinderCount são usados.
+inline constexpr uint8_t kInjCh[8] = {
+    ECU_CH_INJ1, ECU_CH_INJ2, ECU_CH_INJ3, ECU_CH_INJ4,
+    ECU_CH_INJ5, ECU_CH_INJ6, ECU_CH_INJ7, ECU_CH_INJ8};
+inline constexpr uint8_t kIgnCh[8] = {
+    ECU_CH_IGN1, ECU_CH_IGN2, ECU_CH_IGN3, ECU_CH_IGN4,
+    ECU_CH_IGN5, ECU_CH_IGN6, ECU_CH_IGN7, ECU_CH_IGN8};
 
 // ── Angle table (defined in ecu_sched_angle.cpp) ────────────────────────────
 extern AngleEvent_t g_angle_table[ECU_ANGLE_TABLE_SIZE];
@@ -41,10 +45,21 @@ extern uint32_t g_angle_tooth_mask_lo;
 extern uint32_t g_angle_tooth_mask_hi;
 
 // ── Calibration / mode read by builders (defined in ecu_sched.cpp) ──────────
-extern volatile uint32_t g_advance_deg;
-extern volatile uint32_t g_dwell_ticks;
-extern volatile uint32_t g_inj_pw_ticks;
-extern volatile uint32_t g_eoi_lead_deg;
+// Calibração do scheduler: escalares + vector por cilindro num ÚNICO bloco
+// seqlock (escritor = main loop, via commit/setters em ecu_sched.cpp). A ISR
+// lê o bloco inteiro de uma vez (view()/read() — o main loop não a preempta),
+// nunca campos de commits diferentes: PW/avanço do vector, dwell e EOI vêm
+// sempre do mesmo commit. cyl_active = 0 → builder usa escalares + trims
+// estáticos.
+struct SchedCalibration {
+    uint32_t advance_deg;
+    uint32_t dwell_ticks;
+    uint32_t inj_pw_ticks;
+    uint32_t eoi_lead_deg;
+    EcuSchedCylVector cyl;
+    uint8_t cyl_active;
+};
+extern ems::hal::SeqLock<SchedCalibration> g_sched_cal;
 extern volatile uint8_t  g_presync_inj_mode;
 extern volatile uint8_t  g_presync_bank_toggle;
 extern volatile uint8_t  g_knock_sequential;
@@ -53,6 +68,10 @@ extern volatile uint32_t g_mspark_inter_dwell_ticks;
 extern volatile uint32_t g_mspark_atdc_limit_deg;
 extern volatile uint32_t g_pw_duty_clamp_count;
 
+// PW (ticks) efectivamente usado por cilindro na última tabela sequencial —
+// watchdog de injector aberto (1.2×PW) por cilindro.
+extern volatile uint32_t g_seq_cyl_pw_ticks[EMS_CYLINDERS];
+
 // ── Cold builders (ecu_sched_angle.cpp) — called only at rev gap ─────────────
 void clear_angle_table(void);
 void rebuild_sequential_cycle(const ems::drv::CkpSnapshot& snap);
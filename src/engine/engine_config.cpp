@@ -1,4 +1,5 @@
 #include "engine/engine_config.h"
+#include "engine/fuel_pw_kernel.h"
 
 #include <cstdint>
 #include <cstring>
@@ -94,6 +95,7 @@ void engine_config_load(const uint8_t* page0_buf, uint16_t len) noexcept {
 
     if (engine_config_valid(tmp)) {
         g_eng_cfg = tmp;
+        fuel_pw_kernel_invalidate();
     }
 }
 
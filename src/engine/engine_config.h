@@ -2,9 +2,14 @@
 
 #include <cstdint>
 
+#include "hal/board_pinout.h"
+
 namespace ems::engine::cfg {
 
-inline constexpr uint8_t kCylinderCount = 4u;
+// Nº de cilindros: build-time (make CYLINDERS=N → -DEMS_CYLINDERS=N, 1–8).
+// Dimensiona scheduler, tabelas angulares, misfire, knock e map_window.
+inline constexpr uint8_t kCylinderCount = static_cast<uint8_t>(EMS_CYLINDERS);
+static_assert(kCylinderCount >= 1u && kCylinderCount <= 8u, "1..8 cilindros");
 inline constexpr uint16_t kDisplacementCc = 2000u;
 inline constexpr uint16_t kInjectorFlowCcMin = 450u;
 
@@ -36,8 +41,69 @@ inline constexpr uint16_t kTriggerTooth0EngineDeg = 0u;  // MEDIR NO MOTOR REAL
 // Convenção de canal: ECU_CH_IGNn/ECU_CH_INJn = cilindro físico n−1, SEMPRE.
 // A ordem de disparo entra apenas via kFiringOrder/cyl_tdc_deg — nunca na
 // escolha do canal. Invariante partilhado por Calculate_Sequential_Cycle,
-// pares presync (companheiros 0↔3, 2↔1), ign_ch_to_cyl_bit e misfire_detect.
+// bancos presync (posições de disparo a 360°), k_*_ch_to_bit e misfire_detect.
+// Defaults por nº de cilindros (cilindro 0-based):
+//   1: 0 · 2: 0-1 · 3: 1-3-2 · 4: 1-3-4-2 · 5: 1-2-4-5-3
+//   6: 1-5-3-6-2-4 (L6) · 7: 1-3-5-7-2-4-6 · 8: 1-8-7-2-6-5-4-3 (V8 GM LS)
+#if EMS_CYLINDERS == 1
+inline constexpr uint8_t kFiringOrder[kCylinderCount] = {0u};
+#elif EMS_CYLINDERS == 2
+inline constexpr uint8_t kFiringOrder[kCylinderCount] = {0u, 1u};
+#elif EMS_CYLINDERS == 3
+inline constexpr uint8_t kFiringOrder[kCylinderCount] = {0u, 2u, 1u};
+#elif EMS_CYLINDERS == 4
 inline constexpr uint8_t kFiringOrder[kCylinderCount] = {0u, 2u, 3u, 1u};
+#elif EMS_CYLINDERS == 5
+inline constexpr uint8_t kFiringOrder[kCylinderCount] = {0u, 1u, 3u, 4u, 2u};
+#elif EMS_CYLINDERS == 6
+inline constexpr uint8_t kFiringOrder[kCylinderCount] = {0u, 4u, 2u, 5u, 1u, 3u};
+#elif EMS_CYLINDERS == 7
+inline constexpr uint8_t kFiringOrder[kCylinderCount] = {0u, 2u, 4u, 6u, 1u, 3u, 5u};
+#else
+inline constexpr uint8_t kFiringOrder[kCylinderCount] = {0u, 7u, 6u, 1u, 5u, 4u, 3u, 2u};
+#endif
+
+// Ângulo (° no ciclo de 720°) do TDC de combustão de cada POSIÇÃO de disparo.
+// Even-fire: pos × 720/N. Odd-fire (EMS_ODD_FIRE=1, make ODD_FIRE=1):
+//   2 cil: 270°/450° (paralelo 270°) → {0, 270}
+//   6 cil: V6 90° odd-fire (90°/150°) → {0, 90, 240, 330, 480, 570}
+struct FiringTdcTable {
+    uint16_t deg[kCylinderCount];
+};
+
+constexpr FiringTdcTable make_even_fire_tdc() noexcept {
+    FiringTdcTable t{};
+    for (uint8_t pos = 0u; pos < kCylinderCount; ++pos) {
+        t.deg[pos] = static_cast<uint16_t>((pos * 720u) / kCylinderCount);
+    }
+    return t;
+}
+
+#if defined(EMS_ODD_FIRE) && (EMS_ODD_FIRE != 0)
+#if EMS_CYLINDERS == 2
+inline constexpr FiringTdcTable kFiringTdc = {{0u, 270u}};
+#elif EMS_CYLINDERS == 6
+inline constexpr FiringTdcTable kFiringTdc = {{0u, 90u, 240u, 330u, 480u, 570u}};
+#else
+#error "EMS_ODD_FIRE só tem preset para 2 ou 6 cilindros"
+#endif
+#else
+inline constexpr FiringTdcTable kFiringTdc = make_even_fire_tdc();
+#endif
+
+constexpr bool firing_config_valid() noexcept {
+    // kFiringOrder é permutação de 0..N-1; TDC estritamente crescente em [0, 720).
+    uint8_t seen = 0u;
+    for (uint8_t pos = 0u; pos < kCylinderCount; ++pos) {
+        if (kFiringOrder[pos] >= kCylinderCount) { return false; }
+        seen = static_cast<uint8_t>(seen | (1u << kFiringOrder[pos]));
+        if (kFiringTdc.deg[pos] >= 720u) { return false; }
+        if (pos > 0u && kFiringTdc.deg[pos] <= kFiringTdc.deg[pos - 1u]) { return false; }
+    }
+    return kFiringTdc.deg[0] == 0u &&
+           seen == static_cast<uint8_t>((1u << kCylinderCount) - 1u);
+}
+static_assert(firing_config_valid(), "kFiringOrder/kFiringTdc inválidos");
 
 // CMP reference half: which 360° half the cam rising edge marks.
 // Convention: CMP rises at kCmpTooth of the 1st revolution of the 720° pair.
@@ -45,16 +111,23 @@ inline constexpr uint8_t kFiringOrder[kCylinderCount] = {0u, 2u, 3u, 1u};
 // Adjust empirically if the physical cam sensor marks the other revolution.
 inline constexpr uint8_t kCmpRefHalf = 0u;
 
-constexpr uint16_t cyl_tdc_deg(uint8_t cyl) noexcept {
-    // TDC baseado na POSIÇÃO do cilindro na ordem de disparo, não no número.
-    // Ex: kFiringOrder={0,2,3,1} → cyl 0 na pos 0 (0°), cyl 2 na pos 1 (180°),
-    //     cyl 3 na pos 2 (360°), cyl 1 na pos 3 (540°).
+constexpr uint8_t cyl_firing_pos(uint8_t cyl) noexcept {
     uint8_t pos = 0u;
     for (; pos < kCylinderCount; ++pos) {
         if (kFiringOrder[pos] == cyl) { break; }
     }
-    return static_cast<uint16_t>(pos * (720u / kCylinderCount));
+    return (pos < kCylinderCount) ? pos : 0u;
+}
+
+constexpr uint16_t cyl_tdc_deg(uint8_t cyl) noexcept {
+    // TDC baseado na POSIÇÃO do cilindro na ordem de disparo, não no número.
+    // Ex: kFiringOrder={0,2,3,1} → cyl 0 na pos 0 (0°), cyl 2 na pos 1 (180°),
+    //     cyl 3 na pos 2 (360°), cyl 1 na pos 3 (540°).
+    return kFiringTdc.deg[cyl_firing_pos(cyl)];
 }
+static_assert(kCylinderCount != 4u || (cyl_tdc_deg(0u) == 0u && cyl_tdc_deg(2u) == 180u &&
+                                       cyl_tdc_deg(3u) == 360u && cyl_tdc_deg(1u) == 540u),
+              "4 cil: TDC 0/180/360/540 pela ordem 1-3-4-2");
 
 // =============================================================================
 // Runtime-configurable engine parameters (stored in Flash page 0)
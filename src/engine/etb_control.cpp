@@ -1,6 +1,7 @@
 /**
  * @file etb_control.cpp
- * @brief ETB: init/drive-mode (prod) + PID inteiro + float loop (host only)
+ * @brief ETB: init/drive-mode (prod) + PID inteiro/Q15 + float loop e modelo
+ *        de referência (host only)
  */
 
 #include "etb_control.h"
@@ -262,13 +263,70 @@ extern "C" int16_t etb_get_idle_spark_trim(void) {
 #endif  // EMS_HOST_TEST
 
 // ── PID inteiro de produção ─────────────────────────────────────────────────
+// Unidades: erro/saída em pct×10 (±1000), ganhos da cal (kp/kd ×10, ki com
+// Δi = ki·e·dt_ms/1000). Sem FPU: a tarefa de 2 ms (e qualquer ISR que a
+// preempte) não paga o stacking lazy de s0–s15.
+//
+// Integrador em Q15 (pct×10 · 2^15): a 2 ms o incremento de um passo é
+// fracção de 1 pct×10 (ki=8, e=5 % → 0.8) e truncado dava 0 — erros
+// estacionários < ~6 % nunca eram integrados. Derivada sobre o erro com
+// IIR em Q15: 1 LSB de ruído de TPS a 2 ms já valia 500 pct×10/s, o que
+// saturava a ponte H com kd=4. A constante de tempo do filtro é fixa
+// (τ = 8 ms, α = dt/(τ+dt) = 0.2 a 2 ms, o filtro da cascata float) para a
+// banda do D não mudar com a taxa da malha (2 ms no main loop, 0.5–1 ms na
+// ISR do TIM7 — engine/etb_loop.h).
 namespace ems::engine {
 
-static int32_t g_integrator_x10 = 0;
-static int16_t g_prev_error_x10 = 0;
+namespace {
+
+constexpr int32_t kEtbOutLimitX10   = 1000;
+constexpr int32_t kEtbIntLimitX10   = 2000;
+constexpr int32_t kEtbIntLimitQ15   = kEtbIntLimitX10 << 15;
+constexpr uint32_t kEtbDerivTauUs   = 8000u;      // filtro da derivada
+constexpr int32_t kEtbDerivFracBits = 4;          // estado do filtro em Q4 (16·|D| < 2^31)
+constexpr uint32_t kEtbKiDtMax      = 65535000u;  // ki·dt_us → coeficiente ≤ 2^31/1000
+constexpr uint32_t kEtbMinPeriodUs  = 100u;       // Δe·1e6/dt·16 cabe em int32
+constexpr int64_t kEtbKdProdMax     = 100 * kEtbOutLimitX10;  // kd·D antes de /10
+
+int32_t g_integrator_q15 = 0;
+int32_t g_deriv_filt     = 0;   // pct×10/s, Q4
+int16_t g_prev_error_x10 = 0;
+
+// Coeficientes dependentes de (ki, dt): a divisão de 64 bits só corre
+// quando a cal ou o período mudam, não a cada amostra da ISR.
+struct EtbDtCoefs {
+    uint16_t ki_x10;
+    uint32_t period_us;
+    int32_t  ki_coef_q15;   // ki·dt_us·2^15/1e6
+    int32_t  alpha_q15;     // dt/(τ+dt)
+};
+EtbDtCoefs g_coefs = {0xFFFFu, 0u, 0, 0};
+
+const EtbDtCoefs& dt_coefs(uint32_t period_us) noexcept {
+    if (g_coefs.ki_x10 != etb_ki_x10 || g_coefs.period_us != period_us) {
+        uint32_t ki_dt = static_cast<uint32_t>(etb_ki_x10) * period_us;
+        if (ki_dt > kEtbKiDtMax) { ki_dt = kEtbKiDtMax; }
+        g_coefs.ki_x10      = etb_ki_x10;
+        g_coefs.period_us   = period_us;
+        g_coefs.ki_coef_q15 = static_cast<int32_t>(
+            (static_cast<uint64_t>(ki_dt) << 12) / 125000u);
+        const uint32_t den = kEtbDerivTauUs + period_us;
+        g_coefs.alpha_q15   = static_cast<int32_t>(
+            ((static_cast<uint64_t>(period_us) << 15) + den / 2u) / den);
+    }
+    return g_coefs;
+}
+
+// pct×10 (Q15) → pct×10 arredondado ao mais próximo.
+int32_t q15_round(int32_t v) noexcept {
+    return (v + (1 << 14)) >> 15;
+}
+
+}  // namespace
 
 void etb_control_reset() noexcept {
-    g_integrator_x10 = 0;
+    g_integrator_q15 = 0;
+    g_deriv_filt = 0;
     g_prev_error_x10 = 0;
 }
 
@@ -276,6 +334,15 @@ EtbControlState etb_control_update(uint16_t target_pct_x10,
                                    uint16_t measured_pct_x10,
                                    bool     enable_request,
                                    uint16_t period_ms) noexcept
+{
+    return etb_control_update_us(target_pct_x10, measured_pct_x10, enable_request,
+                                 static_cast<uint32_t>(period_ms) * 1000u);
+}
+
+EtbControlState etb_control_update_us(uint16_t target_pct_x10,
+                                      uint16_t measured_pct_x10,
+                                      bool     enable_request,
+                                      uint32_t period_us) noexcept
 {
     EtbControlState out{};
 
@@ -291,31 +358,47 @@ EtbControlState etb_control_update(uint16_t target_pct_x10,
         -1000, 1000);
 
     const int32_t kp_x10 = static_cast<int32_t>(etb_kp_x10);
-    const int32_t ki_x10 = static_cast<int32_t>(etb_ki_x10);
     const int32_t kd_x10 = static_cast<int32_t>(etb_kd_x10);
 
     int32_t output_x10 = (kp_x10 * static_cast<int32_t>(error_x10)) / 10;
 
+    if (period_us > 0u && period_us < kEtbMinPeriodUs) { period_us = kEtbMinPeriodUs; }
+    const EtbDtCoefs& c = dt_coefs(period_us);
+
     // Anti-windup: saturação em P+I (não só P).
-    if (period_ms > 0u) {
-        const int32_t ki_inc = (ki_x10 * static_cast<int32_t>(error_x10)
-                                * static_cast<int32_t>(period_ms)) / 1000;
-        const int32_t raw_i = g_integrator_x10 + ki_inc;
-        const int32_t candidate_i = (raw_i > 2000) ? 2000 : (raw_i < -2000 ? -2000 : raw_i);
-        const int32_t candidate_out = output_x10 + candidate_i;
-        const bool saturating = (candidate_out >  1000 && error_x10 > 0) ||
-                                (candidate_out < -1000 && error_x10 < 0);
+    if (period_us > 0u) {
+        // ki·dt_us·2^15/1e6 = ki·dt_us·4096/125000; ki·dt_us ≤ 65.5e6 mantém
+        // c·e em int32 (a 2 ms, exactamente o coeficiente da versão em ms).
+        int32_t inc_q15 = c.ki_coef_q15 * static_cast<int32_t>(error_x10);
+        if (inc_q15 >  2 * kEtbIntLimitQ15) { inc_q15 =  2 * kEtbIntLimitQ15; }
+        if (inc_q15 < -2 * kEtbIntLimitQ15) { inc_q15 = -2 * kEtbIntLimitQ15; }
+        int32_t cand_q15 = g_integrator_q15 + inc_q15;
+        if (cand_q15 >  kEtbIntLimitQ15) { cand_q15 =  kEtbIntLimitQ15; }
+        if (cand_q15 < -kEtbIntLimitQ15) { cand_q15 = -kEtbIntLimitQ15; }
+        // Decisão em Q15, sem arredondar I na fronteira de saturação. P é
+        // limitado a ±2·I_max para caber em int32 com 15 bits de fracção.
+        const int32_t p_q15 = clamp_i16(output_x10, -2 * kEtbIntLimitX10,
+                                        2 * kEtbIntLimitX10) * (1 << 15);
+        const int32_t candidate_out_q15 = p_q15 + cand_q15;
+        const bool saturating = (candidate_out_q15 >  (kEtbOutLimitX10 << 15) && error_x10 > 0) ||
+                                (candidate_out_q15 < -(kEtbOutLimitX10 << 15) && error_x10 < 0);
         if (!saturating) {
-            g_integrator_x10 = static_cast<int16_t>(candidate_i);
+            g_integrator_q15 = cand_q15;
         }
     }
-    g_integrator_x10 = clamp_i16(static_cast<int32_t>(g_integrator_x10), -2000, 2000);
-    output_x10 += g_integrator_x10;
+    output_x10 += q15_round(g_integrator_q15);
 
-    if (period_ms > 0u) {
+    if (period_us > 0u) {
         const int32_t deriv = ((static_cast<int32_t>(error_x10) - g_prev_error_x10)
-                               * 1000) / static_cast<int32_t>(period_ms);
-        output_x10 += (kd_x10 * deriv) / 10;
+                               * 1000000) / static_cast<int32_t>(period_us);
+        g_deriv_filt += mul_q15(deriv * (1 << kEtbDerivFracBits) - g_deriv_filt,
+                                c.alpha_q15);
+        // kd·D em 64 bits (SMULL) e limitado antes de /10: a saída satura a
+        // ±1000 de qualquer forma.
+        int64_t d_term = (static_cast<int64_t>(kd_x10) * g_deriv_filt) >> kEtbDerivFracBits;
+        if (d_term >  kEtbKdProdMax) { d_term =  kEtbKdProdMax; }
+        if (d_term < -kEtbKdProdMax) { d_term = -kEtbKdProdMax; }
+        output_x10 += static_cast<int32_t>(d_term) / 10;
     }
     g_prev_error_x10 = error_x10;
 
@@ -325,7 +408,63 @@ EtbControlState etb_control_update(uint16_t target_pct_x10,
 }
 
 int32_t etb_control_get_integrator() noexcept {
-    return g_integrator_x10;
+    return q15_round(g_integrator_q15);
+}
+
+#if defined(EMS_HOST_TEST)
+// ── Modelo de referência float (só host) ───────────────────────────────────
+// A mesma lei em float/pct, sem quantização: equivalência nos host tests e
+// termo de comparação no host-bench-etb. Estado próprio.
+static float g_ref_integrator = 0.0f;
+static float g_ref_deriv_filt = 0.0f;
+static float g_ref_prev_error = 0.0f;
+
+void etb_control_ref_reset() noexcept {
+    g_ref_integrator = 0.0f;
+    g_ref_deriv_filt = 0.0f;
+    g_ref_prev_error = 0.0f;
+}
+
+EtbControlRef etb_control_ref_update(float target_pct, float measured_pct,
+                                     bool enable_request, float period_ms) noexcept {
+    EtbControlRef out{};
+    if (!enable_request || etb_cal_valid == 0u) {
+        etb_control_ref_reset();
+        return out;
+    }
+    float error = target_pct - measured_pct;
+    if (error >  100.0f) { error =  100.0f; }
+    if (error < -100.0f) { error = -100.0f; }
+    const float kp = static_cast<float>(etb_kp_x10) / 10.0f;
+    const float ki = static_cast<float>(etb_ki_x10);   // Δi = ki·e·dt_s
+    const float kd = static_cast<float>(etb_kd_x10) / 10.0f;
+
+    float output = kp * error;
+    if (period_ms > 0.0f) {
+        float cand = g_ref_integrator + ki * error * (period_ms / 1000.0f);
+        if (cand >  200.0f) { cand =  200.0f; }
+        if (cand < -200.0f) { cand = -200.0f; }
+        const float candidate_out = output + cand;
+        const bool saturating = (candidate_out >  100.0f && error > 0.0f) ||
+                                (candidate_out < -100.0f && error < 0.0f);
+        if (!saturating) {
+            g_ref_integrator = cand;
+        }
+    }
+    output += g_ref_integrator;
+    if (period_ms > 0.0f) {
+        const float deriv = (error - g_ref_prev_error) * 1000.0f / period_ms;
+        const float alpha = period_ms / (static_cast<float>(kEtbDerivTauUs) / 1000.0f + period_ms);
+        g_ref_deriv_filt += (deriv - g_ref_deriv_filt) * alpha;
+        output += kd * g_ref_deriv_filt;
+    }
+    g_ref_prev_error = error;
+    if (output >  100.0f) { output =  100.0f; }
+    if (output < -100.0f) { output = -100.0f; }
+    out.output_pct = output;
+    out.integrator_pct = g_ref_integrator;
+    return out;
 }
+#endif  // EMS_HOST_TEST
 
 }  // namespace ems::engine
@@ -4,10 +4,13 @@
  *
  * Path de PRODUÇÃO (firmware + main):
  *   etb_control_init / set|get_drive_mode / apply_idle_calibration
- *   ems::engine::etb_control_update (PID inteiro pct×10)
+ *   ems::engine::etb_control_update (PID inteiro pct×10, integrador e filtro
+ *   da derivada em Q15 — sem FPU no caminho de 2 ms); _us para a ISR da
+ *   malha de posição (engine/etb_loop.h)
  *
  * Path HOST_TEST only (não linkado no firmware com --gc-sections se não usado):
- *   etb_control_loop e structs float (PID cascata legado).
+ *   etb_control_loop e structs float (PID cascata legado);
+ *   etb_control_ref_update — a lei de produção em float (referência).
  */
 
 #pragma once
@@ -86,6 +89,11 @@ EtbControlState etb_control_update(uint16_t target_pct_x10,
                                    uint16_t measured_pct_x10,
                                    bool     enable_request,
                                    uint16_t period_ms) noexcept;
+/** A mesma lei com período em µs (ISR da malha de posição, etb_loop). */
+EtbControlState etb_control_update_us(uint16_t target_pct_x10,
+                                      uint16_t measured_pct_x10,
+                                      bool     enable_request,
+                                      uint32_t period_us) noexcept;
 /** Integrador PID (pct×10) — host tests / diag. */
 int32_t         etb_control_get_integrator() noexcept;
 /** @deprecated use etb_control_get_integrator */
@@ -94,6 +102,15 @@ inline int32_t  etb_control_test_get_integrator() noexcept {
 }
 
 #if defined(EMS_HOST_TEST)
+// Modelo de referência float de etb_control_update (pct, não pct×10; ms).
+struct EtbControlRef {
+    float output_pct;
+    float integrator_pct;
+};
+void          etb_control_ref_reset() noexcept;
+EtbControlRef etb_control_ref_update(float target_pct, float measured_pct,
+                                     bool enable_request, float period_ms) noexcept;
+
 // Override do weak stub em ign_calc — só relevante com float idle path nos tests.
 int16_t etb_get_idle_spark_trim() noexcept;
 #endif
@@ -0,0 +1,291 @@
+/**
+ * @file engine/etb_loop.cpp
+ * @brief Malha de posição ETB na ISR do TIM7 + modelo host da borboleta.
+ */
+
+#include "engine/etb_loop.h"
+
+#include "engine/calibration.h"
+#include "engine/diagnostic_manager.h"
+#include "engine/etb_control.h"
+#include "hal/adc.h"
+#include "hal/etb_driver.h"
+#include "hal/timer.h"
+
+#if defined(EMS_HOST_TEST)
+#include <cmath>
+#endif
+
+namespace ems::engine {
+
+namespace {
+
+using ems::hal::AdcPrimaryChannel;
+
+// Palavra de comando: [15:0] alvo pct×10, [17:16] EtbLoopCmd. Uma escrita
+// de 32 bits alinhada é atómica no M33 — a ISR nunca vê alvo e comando de
+// gerações diferentes.
+constexpr uint32_t kCmdShift = 16u;
+
+volatile uint32_t g_cmd_word   = static_cast<uint32_t>(EtbLoopCmd::kRelease) << kCmdShift;
+volatile uint16_t g_rate_hz    = 0u;
+volatile bool     g_fault      = false;
+volatile uint32_t g_runs       = 0u;
+volatile uint16_t g_tps_x10    = 0u;
+volatile int16_t  g_out_x10    = 0;
+uint32_t g_period_us   = 0u;
+uint16_t g_strike_max  = 0u;
+uint16_t g_strikes     = 0u;
+bool     g_fault_reported = false;   // main loop: DTC já reportado
+
+uint32_t pack(uint16_t target_pct_x10, EtbLoopCmd cmd) noexcept {
+    return (static_cast<uint32_t>(cmd) << kCmdShift) | target_pct_x10;
+}
+
+// Mesma escala de sensors (pct_from_cal), sobre a leitura ×16: o oversampler
+// dá ~2 bits abaixo do LSB de 12 bits, que a malha aproveita.
+uint16_t pct_x10_from_x16(uint16_t x16, uint16_t raw_min, uint16_t raw_max) noexcept {
+    if (raw_max <= raw_min) { return 0u; }
+    const uint32_t lo = static_cast<uint32_t>(raw_min) << 4u;
+    const uint32_t hi = static_cast<uint32_t>(raw_max) << 4u;
+    if (x16 <= lo) { return 0u; }
+    if (x16 >= hi) { return 1000u; }
+    return static_cast<uint16_t>(((x16 - lo) * 1000u) / (hi - lo));
+}
+
+bool raw_out_of_range(uint16_t x16) noexcept {
+    const uint16_t raw = static_cast<uint16_t>(x16 >> 4u);
+    return raw < kEtbLoopRawMin || raw > kEtbLoopRawMax;
+}
+
+}  // namespace
+
+void etb_loop_init(uint16_t rate_hz) noexcept {
+    ems::hal::tim7_periodic_stop();
+    g_cmd_word = pack(0u, EtbLoopCmd::kRelease);
+    g_fault = false;
+    g_strikes = 0u;
+    g_runs = 0u;
+    g_tps_x10 = 0u;
+    g_out_x10 = 0;
+    etb_control_reset();
+    if (rate_hz == 0u) {
+        g_rate_hz = 0u;
+        g_period_us = 0u;
+        return;
+    }
+    if (rate_hz < kEtbLoopRateMinHz) { rate_hz = kEtbLoopRateMinHz; }
+    if (rate_hz > kEtbLoopRateMaxHz) { rate_hz = kEtbLoopRateMaxHz; }
+    g_rate_hz = rate_hz;
+    g_period_us = 1000000u / rate_hz;
+    g_strike_max = static_cast<uint16_t>(
+        (static_cast<uint32_t>(rate_hz) * kEtbLoopFaultMs) / 1000u);
+    ems::hal::tim7_periodic_init(rate_hz, &etb_loop_isr);
+}
+
+bool etb_loop_running() noexcept {
+    return g_rate_hz != 0u;
+}
+
+void etb_loop_set_target(uint16_t target_pct_x10, bool enable) noexcept {
+    if (target_pct_x10 > 1000u) { target_pct_x10 = 1000u; }
+    g_cmd_word = pack(target_pct_x10, enable ? EtbLoopCmd::kTrack : EtbLoopCmd::kDisabled);
+}
+
+void etb_loop_release() noexcept {
+    g_cmd_word = pack(0u, EtbLoopCmd::kRelease);
+}
+
+bool etb_loop_fault() noexcept {
+    return g_fault;
+}
+
+bool etb_loop_diag_tick() noexcept {
+    const bool fault = g_fault;
+    if (fault && !g_fault_reported) {
+        DiagnosticManager::report_fault(DiagnosticCode::ETB_TPS_FAULT,
+                                        FaultSeverity::ERROR,
+                                        g_tps_x10, g_rate_hz);
+        g_fault_reported = true;
+    } else if (!fault && g_fault_reported) {
+        DiagnosticManager::clear_fault(DiagnosticCode::ETB_TPS_FAULT);
+        g_fault_reported = false;
+    }
+    return fault;
+}
+
+EtbLoopStats etb_loop_stats() noexcept {
+    EtbLoopStats s{};
+    s.runs = g_runs;
+    s.rate_hz = g_rate_hz;
+    s.tps_pct_x10 = g_tps_x10;
+    s.output_pct_x10 = g_out_x10;
+    s.fault = g_fault;
+    return s;
+}
+
+void etb_loop_isr() noexcept {
+    if (g_period_us == 0u) { return; }
+    ++g_runs;
+
+    const uint32_t word = g_cmd_word;
+    const auto cmd = static_cast<EtbLoopCmd>((word >> kCmdShift) & 0x3u);
+    const uint16_t target_x10 = static_cast<uint16_t>(word & 0xFFFFu);
+
+    const uint16_t x1 = ems::hal::adc_primary_read_fast_x16(AdcPrimaryChannel::ETB_TPS1);
+    const uint16_t x2 = ems::hal::adc_primary_read_fast_x16(AdcPrimaryChannel::ETB_TPS2);
+    const uint16_t t1 = pct_x10_from_x16(x1, etb_tps1_raw_min, etb_tps1_raw_max);
+    const uint16_t t2 = pct_x10_from_x16(x2, etb_tps2_raw_min, etb_tps2_raw_max);
+    const uint16_t delta = (t1 > t2) ? static_cast<uint16_t>(t1 - t2)
+                                     : static_cast<uint16_t>(t2 - t1);
+    const uint16_t tps_x10 = static_cast<uint16_t>((static_cast<uint32_t>(t1) + t2) / 2u);
+    g_tps_x10 = tps_x10;
+
+    // Próxima amostra TPS1/TPS2 para a ISR seguinte (só a injectada do ADC1).
+    ems::hal::adc_primary_kick();
+
+    if (!g_fault) {
+        const bool bad = raw_out_of_range(x1) || raw_out_of_range(x2) ||
+                         delta > etb_max_delta_pct_x10;
+        if (!bad) {
+            g_strikes = 0u;
+        } else if (++g_strikes >= g_strike_max) {
+            g_fault = true;
+        }
+    }
+
+    if (cmd == EtbLoopCmd::kRelease) {
+        etb_control_reset();
+        g_out_x10 = 0;
+        return;
+    }
+    if (g_fault || cmd != EtbLoopCmd::kTrack) {
+        etb_control_reset();
+        ::etb_driver_shutdown();
+        g_out_x10 = 0;
+        return;
+    }
+
+    const EtbControlState etb = etb_control_update_us(target_x10, tps_x10, true, g_period_us);
+    if (!etb.active) {
+        ::etb_driver_shutdown();
+        g_out_x10 = 0;
+        return;
+    }
+    // output_pct_x10 ∈ [-1000, 1000] → driver PWM ∈ [-1023, 1023]
+    const int32_t pwm = (static_cast<int32_t>(etb.output_pct_x10) * 1023) / 1000;
+    if (!::etb_driver_set_motor_pwm(static_cast<int16_t>(pwm))) {
+        ::etb_driver_shutdown();
+        g_out_x10 = 0;
+        return;
+    }
+    g_out_x10 = etb.output_pct_x10;
+}
+
+#if defined(EMS_HOST_TEST)
+// ── Modelo host da borboleta ────────────────────────────────────────────────
+// Ordem de grandeza de um corpo DBW de 50–60 mm: curso completo em ~60 ms a
+// duty 100 %, ~40 % de duty para segurar WOT contra a mola, 4–5 % para
+// vencer o atrito.
+namespace {
+
+constexpr EtbPlantParams kPlantDefaults = {
+    60000.0f,   // motor_accel
+    0.001f,     // elec_tau_s
+    300.0f,     // spring_k
+    3000.0f,    // spring_preload
+    7.0f,       // limp_pct
+    40.0f,      // viscous
+    2400.0f,    // coulomb
+    3000.0f,    // stiction
+    13.5f,      // vbatt
+    13.5f,      // vbatt_nom
+    1u,         // noise_lsb
+};
+constexpr float kPlantSubStepS = 20e-6f;
+
+EtbPlantParams g_plant = kPlantDefaults;
+float    g_pos = 0.0f;     // %
+float    g_vel = 0.0f;     // %/s
+float    g_motor = 0.0f;   // aceleração do motor após o atraso eléctrico, %/s²
+uint32_t g_noise_lcg = 0x5EEDu;
+
+int32_t noise_x16() noexcept {
+    if (g_plant.noise_lsb == 0u) { return 0; }
+    g_noise_lcg = g_noise_lcg * 1664525u + 1013904223u;
+    const int32_t span = 2 * 16 * static_cast<int32_t>(g_plant.noise_lsb) + 1;
+    return static_cast<int32_t>((g_noise_lcg >> 8u) % static_cast<uint32_t>(span))
+           - 16 * static_cast<int32_t>(g_plant.noise_lsb);
+}
+
+uint16_t tps_x16(float pos_pct, uint16_t raw_min, uint16_t raw_max) noexcept {
+    const float raw = static_cast<float>(raw_min) +
+                      pos_pct / 100.0f * static_cast<float>(raw_max - raw_min);
+    int32_t x16 = static_cast<int32_t>(lroundf(raw * 16.0f)) + noise_x16();
+    if (x16 < 0) { x16 = 0; }
+    if (x16 > 0xFFF0) { x16 = 0xFFF0; }
+    return static_cast<uint16_t>(x16);
+}
+
+void plant_publish() noexcept {
+    ems::hal::adc_test_set_x16_primary(AdcPrimaryChannel::ETB_TPS1,
+        tps_x16(g_pos, etb_tps1_raw_min, etb_tps1_raw_max));
+    ems::hal::adc_test_set_x16_primary(AdcPrimaryChannel::ETB_TPS2,
+        tps_x16(g_pos, etb_tps2_raw_min, etb_tps2_raw_max));
+}
+
+}  // namespace
+
+EtbPlantParams& etb_plant_params() noexcept {
+    return g_plant;
+}
+
+void etb_plant_reset(float pos_pct) noexcept {
+    g_plant = kPlantDefaults;
+    g_pos = pos_pct;
+    g_vel = 0.0f;
+    g_motor = 0.0f;
+    g_noise_lcg = 0x5EEDu;
+    plant_publish();
+}
+
+void etb_plant_step(float dt_s) noexcept {
+    const float duty = static_cast<float>(::etb_driver_test_motor_pwm()) / 1023.0f;
+    const float motor_cmd = g_plant.motor_accel * duty * (g_plant.vbatt / g_plant.vbatt_nom);
+    for (float t = 0.0f; t < dt_s; t += kPlantSubStepS) {
+        const float h = (dt_s - t < kPlantSubStepS) ? (dt_s - t) : kPlantSubStepS;
+        g_motor += (motor_cmd - g_motor) * (h / (g_plant.elec_tau_s + h));
+        const float off = g_pos - g_plant.limp_pct;
+        float spring = -g_plant.spring_k * off;
+        if (off > 0.0f) { spring -= g_plant.spring_preload; }
+        if (off < 0.0f) { spring += g_plant.spring_preload; }
+        const float drive = g_motor + spring;
+        float acc = 0.0f;
+        if (g_vel == 0.0f) {
+            // Colado até o esforço vencer o atrito estático.
+            if (fabsf(drive) > g_plant.stiction) {
+                acc = drive - copysignf(g_plant.coulomb, drive);
+            }
+        } else {
+            acc = drive - g_plant.viscous * g_vel - copysignf(g_plant.coulomb, g_vel);
+        }
+        const float v_new = g_vel + acc * h;
+        // Coulomb não inverte o movimento: cruza zero → pára neste sub-passo.
+        g_vel = (g_vel != 0.0f && (v_new * g_vel) < 0.0f) ? 0.0f : v_new;
+        g_pos += g_vel * h;
+        if (g_pos < 0.0f)   { g_pos = 0.0f;   g_vel = 0.0f; }
+        if (g_pos > 100.0f) { g_pos = 100.0f; g_vel = 0.0f; }
+    }
+    plant_publish();
+}
+
+float etb_plant_position_pct() noexcept {
+    return g_pos;
+}
+
+float etb_plant_velocity_pct_s() noexcept {
+    return g_vel;
+}
+#endif  // EMS_HOST_TEST
+
+}  // namespace ems::engine
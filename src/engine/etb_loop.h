@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ems::engine {
+
+// ── Malha de posição ETB em ISR dedicada (TIM7) ─────────────────────────────
+// O PID de posição sai do slot de 2 ms do main loop (cujo período treme com
+// fuel/STFT/comms) para a update IRQ do TIM7 a etb_loop_rate_hz (1–2 kHz):
+//
+//   TIM7 → etb_loop_isr(): TPS1/TPS2 (injectada do ADC1, leitura rápida) →
+//          kick da injectada para o período seguinte (pronta 15 µs depois)
+//          → plausibilidade → etb_control_update_us → PWM da ponte H
+//          (TIM3_CH1 RGT6 / TIM15_CH1 VGT6)
+//
+// O main loop (torque manager) só escreve o setpoint: alvo + comando numa
+// palavra de 32 bits (escrita atómica, sem lock). Release entrega a ponte a
+// quem a conduz directamente (auto-cal, teste de saídas): a ISR não a toca e
+// mantém o PID em reset. Um comando chega à ponte no período seguinte.
+//
+// Plausibilidade própria, à taxa da malha (o caminho de sensores corre a
+// 100 ms com média de 4): TPS fora de [kEtbLoopRawMin, kEtbLoopRawMax] ou
+// |TPS1 − TPS2| > etb_max_delta_pct_x10 durante kEtbLoopFaultMs seguidos →
+// ponte desligada (mola → limp) e falha trancada até novo etb_loop_init.
+// O main loop vê-a por etb_loop_diag_tick: DTC, limp e STATUS_ETB_LIMP.
+//
+// etb_loop_rate_hz = 0 deixa a malha parada: o PID corre no main loop a
+// 2 ms como antes (blob antigo de calibração = 0).
+
+constexpr uint16_t kEtbLoopRateMinHz = 1000u;
+constexpr uint16_t kEtbLoopRateMaxHz = 2000u;
+constexpr uint16_t kEtbLoopRawMin    = 50u;    // 12 bits: aberto / curto a GND
+constexpr uint16_t kEtbLoopRawMax    = 4050u;  // curto a 5 V
+constexpr uint16_t kEtbLoopFaultMs   = 10u;
+
+enum class EtbLoopCmd : uint8_t {
+    kRelease  = 0u,   // ponte com outro dono; ISR só faz leitura
+    kDisabled = 1u,   // ponte desligada (mola), PID em reset
+    kTrack    = 2u,   // PID segue o alvo
+};
+
+struct EtbLoopStats {
+    uint32_t runs;
+    uint16_t rate_hz;          // 0 = malha parada
+    uint16_t tps_pct_x10;      // última medida (média TPS1/TPS2)
+    int16_t  output_pct_x10;   // último comando à ponte (0 em Release/Disabled)
+    bool     fault;
+};
+
+// Arranca (rate_hz limitado a [min, max]) ou pára (0) a malha. Limpa a falha
+// trancada e o PID; comando inicial Release. Boot / alteração da cal.
+void etb_loop_init(uint16_t rate_hz) noexcept;
+bool etb_loop_running() noexcept;
+
+// Main loop: setpoint do torque manager (enable=false → Disabled).
+void etb_loop_set_target(uint16_t target_pct_x10, bool enable) noexcept;
+void etb_loop_release() noexcept;
+
+bool etb_loop_fault() noexcept;
+EtbLoopStats etb_loop_stats() noexcept;
+
+// Main loop (2 ms): leva a falha trancada da ISR ao DiagnosticManager —
+// ETB_TPS_FAULT (ERROR) uma vez por trancamento, limpo quando etb_loop_init
+// a destranca. Devolve etb_loop_fault() para o limp do main loop.
+bool etb_loop_diag_tick() noexcept;
+
+// Corpo da ISR (ligado ao TIM7 por etb_loop_init; host tests chamam directo).
+void etb_loop_isr() noexcept;
+
+#if defined(EMS_HOST_TEST)
+// ── Modelo host da borboleta ────────────────────────────────────────────────
+// Posição em % do curso (0 = batente fechado), aceleração em %/s². Motor DC
+// com atraso eléctrico de 1.ª ordem (binário ∝ duty·Vbat), mola dupla com
+// pré-carga para a posição limp, atrito viscoso (inclui back-EMF) e de
+// Coulomb com colagem estática, batentes a 0/100 %. O PWM vem do driver
+// (etb_driver_set_motor_pwm); a posição volta como TPS1/TPS2 (×16, com a cal
+// etb_tps*_raw_min/max e ruído de ±noise_lsb) na leitura rápida do ADC.
+struct EtbPlantParams {
+    float motor_accel;     // %/s² a duty 100 % e vbatt_nom
+    float elec_tau_s;      // L/R
+    float spring_k;        // %/s² por % de afastamento da limp
+    float spring_preload;  // %/s² no sentido da limp
+    float limp_pct;
+    float viscous;         // 1/s
+    float coulomb;         // %/s² (deslizamento)
+    float stiction;        // %/s² (arranque)
+    float vbatt;
+    float vbatt_nom;
+    uint8_t noise_lsb;     // ruído do TPS em LSB de 12 bits (±)
+};
+
+EtbPlantParams& etb_plant_params() noexcept;
+void  etb_plant_reset(float pos_pct) noexcept;   // parâmetros default, em repouso
+void  etb_plant_step(float dt_s) noexcept;        // integra (sub-passos ≤ 20 µs) e actualiza o ADC
+float etb_plant_position_pct() noexcept;
+float etb_plant_velocity_pct_s() noexcept;
+#endif
+
+}  // namespace ems::engine
@@ -1,6 +1,7 @@
 #include "engine/fuel_calc.h"
 #include "engine/calibration.h"
 #include "engine/engine_config.h"
+#include "engine/fuel_pw_kernel.h"
 #include "engine/math_utils.h"
 #include "engine/table3d.h"
 
@@ -295,12 +296,8 @@ uint32_t apply_injector_scurve(uint32_t pw_us) noexcept {
     return static_cast<uint32_t>(pw_corrected > 200000u ? 200000u : pw_corrected);
 }
 
-uint32_t apply_delta_p_compensation(uint32_t pw_us,
-                                    uint16_t fuel_press_bar_x1000,
-                                    uint16_t map_bar_x100) noexcept {
-    if (pw_us == 0u) {
-        return 0u;
-    }
+uint32_t fuel_delta_p_factor_q8(uint16_t fuel_press_bar_x1000,
+                                uint16_t map_bar_x100) noexcept {
     // Sensor sem leitura válida: usa o nominal, sem correção (ratio_q8 = 256).
     const uint16_t actual_press_bar_x1000 =
         (fuel_press_bar_x1000 > 0u) ? fuel_press_bar_x1000 : fuel_press_nominal_bar_x1000;
@@ -318,8 +315,16 @@ uint32_t apply_delta_p_compensation(uint32_t pw_us,
     // Fluxo do bico ∝ sqrt(ΔP) → PW_corrigido = PW_base × sqrt(ΔP_nominal / ΔP_atual)
     const uint32_t ratio_q8 = static_cast<uint32_t>(
         (static_cast<int64_t>(delta_p_nominal) * 256) / delta_p_actual);
-    const uint32_t sqrt_factor_q8 = isqrt_u32(ratio_q8 * 256u);
+    return isqrt_u32(ratio_q8 * 256u);
+}
 
+uint32_t apply_delta_p_compensation(uint32_t pw_us,
+                                    uint16_t fuel_press_bar_x1000,
+                                    uint16_t map_bar_x100) noexcept {
+    if (pw_us == 0u) {
+        return 0u;
+    }
+    const uint32_t sqrt_factor_q8 = fuel_delta_p_factor_q8(fuel_press_bar_x1000, map_bar_x100);
     const uint64_t pw_corrected = (static_cast<uint64_t>(pw_us) * sqrt_factor_q8) / 256u;
     return static_cast<uint32_t>(pw_corrected > 200000u ? 200000u : pw_corrected);
 }
@@ -497,6 +502,7 @@ void fuel_set_baro_bar_x100(uint16_t baro) noexcept {
     // Clamp: aceita apenas valores plausíveis de pressão barométrica
     // 70 = 700 mbar (≈5000m altitude) … 110 = 1100 mbar (abaixo do nível do mar)
     if (baro < 70u || baro > 110u) { return; }
+    if (baro != g_baro_bar_x100) { fuel_pw_kernel_invalidate(); }
     g_baro_bar_x100 = baro;
 }
 
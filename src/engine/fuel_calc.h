@@ -70,6 +70,11 @@ uint16_t corr_warmup(int16_t clt_x10) noexcept;
 
 uint32_t apply_injector_scurve(uint32_t pw_us) noexcept;
 
+// sqrt(ΔP_nominal / ΔP_atual) em Q8 (256 = sem correção); só depende dos
+// sensores, não do PW — o kernel fundido (fuel_pw_kernel.h) pré-calcula-o.
+uint32_t fuel_delta_p_factor_q8(uint16_t fuel_press_bar_x1000,
+                                uint16_t map_bar_x100) noexcept;
+
 uint32_t apply_delta_p_compensation(uint32_t pw_us,
                                     uint16_t fuel_press_bar_x1000,
                                     uint16_t map_bar_x100) noexcept;
@@ -0,0 +1,237 @@
+#include "engine/fuel_pw_kernel.h"
+#include "engine/calibration.h"
+#include "engine/engine_config.h"
+#include "engine/fuel_calc.h"
+#include "engine/math_utils.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+using ems::engine::clamp_i16;
+
+constexpr uint8_t  kCorrPoints   = ems::engine::kCorrectionTableSize;
+constexpr uint32_t kMaxFlowPwUs  = 100000u;  // mesmo cap de fuel_calc (100 ms)
+constexpr uint32_t kMaxInjPwUs   = 200000u;  // cap de ΔP / S-curve
+
+// ── Divisão exacta por recíproco ─────────────────────────────────────────────
+// inv = ⌊(2³²−1)/d⌋ ≥ 2³²/d − 1, logo ⌊n·inv/2³²⌋ fica em {⌊n/d⌋−1, ⌊n/d⌋}
+// para n < 2³²: uma correcção por multiplicação devolve o floor exacto — os
+// estágios continuam bit-a-bit iguais às funções de fuel_calc.
+struct Recip {
+    uint32_t d;
+    uint32_t inv;
+};
+
+inline Recip make_recip(uint32_t d) noexcept {
+    return Recip{d, (d != 0u) ? (0xFFFFFFFFu / d) : 0u};
+}
+
+inline uint32_t div_recip(uint32_t n, const Recip& r) noexcept {
+    uint32_t q = static_cast<uint32_t>((static_cast<uint64_t>(n) * r.inv) >> 32u);
+    if (static_cast<uint64_t>(q + 1u) * r.d <= n) { ++q; }
+    return q;
+}
+
+// ── Constantes derivadas da calibração ───────────────────────────────────────
+// Refeitas só depois de fuel_pw_kernel_invalidate() (escrita de página,
+// baro, stoich flex): o caminho quente testa um bool.
+struct KernelConsts {
+    bool     valid;
+    uint32_t req_fuel_us;
+    Recip    base_den;             // 100 × baro
+    bool     two_slope;
+    Recip    small_rate;           // r_q8
+    uint32_t small_net_break_us;   // t_break · r
+    uint32_t small_add_us;         // t_break · (1 − r)
+    Recip    scurve_span[kCorrPoints - 1u];
+};
+
+KernelConsts g_consts = {};
+
+uint16_t effective_baro() noexcept {
+    const uint16_t baro = ems::engine::fuel_get_baro_bar_x100();
+    return (baro != 0u) ? baro : ems::engine::cfg::g_eng_cfg.map_ref_bar_x100;
+}
+
+// Caminho frio: divisões só aqui.
+__attribute__((noinline)) const KernelConsts& rebuild_consts() noexcept {
+    using namespace ems::engine;
+    KernelConsts& c = g_consts;
+    c.req_fuel_us = default_req_fuel_us();
+    c.base_den = make_recip(100u * static_cast<uint32_t>(effective_baro()));
+    const uint16_t r_q8 = inj_small_pulse_rate_q8;
+    const uint32_t t_break = inj_small_pulse_break_us;
+    c.two_slope = (r_q8 != 0u && r_q8 < 256u && t_break != 0u);
+    c.small_rate = make_recip(r_q8);
+    c.small_net_break_us = (t_break * r_q8) / 256u;
+    c.small_add_us = (t_break * (256u - (r_q8 < 256u ? r_q8 : 256u))) / 256u;
+    for (uint8_t i = 0u; i + 1u < kCorrPoints; ++i) {
+        // Mesmo tipo que interp_u16_8pt_u16x (eixo não monótono = span enorme).
+        c.scurve_span[i] = make_recip(static_cast<uint32_t>(
+            injector_scurve_pw_axis_us[i + 1u] - injector_scurve_pw_axis_us[i]));
+    }
+    c.valid = true;
+    return c;
+}
+
+inline const KernelConsts& consts() noexcept {
+    return g_consts.valid ? g_consts : rebuild_consts();
+}
+
+// interp_u16_8pt_u16x sobre a S-curve com os spans em recíproco. Fora do
+// eixo (o caso comum: PW acima do último breakpoint) nem toca na cache.
+uint16_t scurve_corr_q8(uint16_t x) noexcept {
+    using namespace ems::engine;
+    const uint16_t* ax = injector_scurve_pw_axis_us;
+    const uint16_t* tbl = injector_scurve_corr_q8;
+    if (x <= ax[0]) { return tbl[0]; }
+    if (x >= ax[kCorrPoints - 1u]) { return tbl[kCorrPoints - 1u]; }
+    const KernelConsts& c = consts();
+    uint8_t idx = 0u;
+    while (idx < (kCorrPoints - 2u) && x > ax[idx + 1u]) { ++idx; }
+    const Recip& span = c.scurve_span[idx];
+    if (span.d == 0u) { return tbl[idx]; }
+    const uint32_t dx = static_cast<uint32_t>(x - ax[idx]);
+    const int32_t dy = static_cast<int32_t>(tbl[idx + 1u]) - static_cast<int32_t>(tbl[idx]);
+    // Truncagem para zero como o '/' com sinal do original.
+    const uint32_t mag = div_recip(static_cast<uint32_t>(dy < 0 ? -dy : dy) * dx, span);
+    const int32_t y = static_cast<int32_t>(tbl[idx]) +
+                      ((dy < 0) ? -static_cast<int32_t>(mag) : static_cast<int32_t>(mag));
+    if (y <= 0) { return 0u; }
+    if (y >= 65535) { return 65535u; }
+    return static_cast<uint16_t>(y);
+}
+
+// ΔP depende de MAP a cada slot; a divisão só corre quando a entrada muda.
+struct DeltaPCache {
+    bool     valid;
+    uint16_t fuel_press_bar_x1000;
+    uint16_t map_bar_x100;
+    uint16_t nominal_bar_x1000;
+    uint16_t factor_q8;
+};
+
+DeltaPCache g_delta_p = {};
+
+}  // namespace
+
+namespace ems::engine {
+
+FuelPwBreakdown g_fuel_pw_breakdown = {};
+uint32_t g_fuel_pw_kernel_cycles_max = 0u;
+
+void fuel_pw_kernel_invalidate() noexcept {
+    g_consts.valid = false;
+}
+
+FuelSensorSnapshot fuel_pw_kernel_snapshot(uint16_t corr_clt_x256,
+                                           uint16_t corr_iat_x256,
+                                           uint16_t dead_time_us,
+                                           uint16_t fuel_press_bar_x1000,
+                                           uint16_t map_bar_x100) noexcept {
+    if (!g_delta_p.valid ||
+        g_delta_p.fuel_press_bar_x1000 != fuel_press_bar_x1000 ||
+        g_delta_p.map_bar_x100 != map_bar_x100 ||
+        g_delta_p.nominal_bar_x1000 != fuel_press_nominal_bar_x1000) {
+        g_delta_p.valid = true;
+        g_delta_p.fuel_press_bar_x1000 = fuel_press_bar_x1000;
+        g_delta_p.map_bar_x100 = map_bar_x100;
+        g_delta_p.nominal_bar_x1000 = fuel_press_nominal_bar_x1000;
+        const uint32_t f = fuel_delta_p_factor_q8(fuel_press_bar_x1000, map_bar_x100);
+        g_delta_p.factor_q8 = static_cast<uint16_t>(f > 65535u ? 65535u : f);
+    }
+    return FuelSensorSnapshot{corr_clt_x256, corr_iat_x256, dead_time_us,
+                              g_delta_p.factor_q8};
+}
+
+uint32_t fuel_pw_kernel(const FuelOperatingPoint& op,
+                        const FuelSensorSnapshot& snap,
+                        FuelPwBreakdown* out) noexcept {
+    const KernelConsts& c = consts();
+    FuelPwBreakdown bd = {};
+    bd.dead_time_us = snap.dead_time_us;
+    bd.delta_p_q8 = snap.delta_p_q8;
+
+    // REQ_FUEL × VE × MAP / (100 × baro): ≤ 50000·255·300 < 2³², sem u64.
+    if (op.ve != 0u && op.map_bar_x100 <= 300u && c.base_den.d != 0u) {
+        const uint32_t num = c.req_fuel_us * op.ve * op.map_bar_x100;
+        bd.base_pw_us = div_recip(num, c.base_den);
+        if (bd.base_pw_us > kMaxFlowPwUs) { bd.base_pw_us = kMaxFlowPwUs; }
+    }
+    // λ alvo: a única divisão da passagem. O divisor muda a cada ponto da
+    // tabela → UDIV direto; um recíproco por chamada custaria a mesma UDIV
+    // mais dois UMULL. O /1000 do trim é constante (vira multiplicação).
+    if (bd.base_pw_us != 0u &&
+        op.lambda_target_x1000 >= 650u && op.lambda_target_x1000 <= 1200u) {
+        bd.lambda_pw_us = (bd.base_pw_us * 1000u) / op.lambda_target_x1000;
+        if (bd.lambda_pw_us > kMaxFlowPwUs) { bd.lambda_pw_us = kMaxFlowPwUs; }
+    }
+    if (bd.lambda_pw_us != 0u) {
+        const int32_t mult_x1000 = 1000 + clamp_i16(op.trim_pct_x10, -500, 500);
+        if (mult_x1000 > 0) {
+            bd.trimmed_pw_us = (bd.lambda_pw_us * static_cast<uint32_t>(mult_x1000)) / 1000u;
+            if (bd.trimmed_pw_us > kMaxFlowPwUs) { bd.trimmed_pw_us = kMaxFlowPwUs; }
+        }
+    }
+    if (bd.trimmed_pw_us == 0u) {
+        if (out != nullptr) { *out = bd; }
+        return 0u;
+    }
+
+    // CLT × IAT em Q16 (clamp [0.25×, 2.0×] como calc_final_pw_us).
+    constexpr uint16_t kCorrMinQ8 = 64u;
+    constexpr uint16_t kCorrMaxQ8 = 512u;
+    const uint32_t c_clt = (snap.corr_clt_x256 < kCorrMinQ8) ? kCorrMinQ8
+                         : (snap.corr_clt_x256 > kCorrMaxQ8) ? kCorrMaxQ8 : snap.corr_clt_x256;
+    const uint32_t c_iat = (snap.corr_iat_x256 < kCorrMinQ8) ? kCorrMinQ8
+                         : (snap.corr_iat_x256 > kCorrMaxQ8) ? kCorrMaxQ8 : snap.corr_iat_x256;
+    uint64_t flow = (static_cast<uint64_t>(bd.trimmed_pw_us) * (c_clt * c_iat)) >> 16u;
+    if (c.two_slope) {
+        if (flow < c.small_net_break_us) {
+            flow = div_recip(static_cast<uint32_t>(flow) * 256u, c.small_rate);
+        } else {
+            flow += c.small_add_us;
+        }
+    }
+    bd.flow_pw_us = static_cast<uint32_t>(flow > kMaxFlowPwUs ? kMaxFlowPwUs : flow);
+    const uint64_t total = flow + snap.dead_time_us;
+    bd.final_pw_us = static_cast<uint32_t>(total > kMaxFlowPwUs ? kMaxFlowPwUs : total);
+    if (out != nullptr) { *out = bd; }
+    return bd.final_pw_us;
+}
+
+uint32_t fuel_pw_kernel_injector(uint32_t flow_pw_us,
+                                 const FuelSensorSnapshot& snap,
+                                 FuelPwBreakdown* out) noexcept {
+    uint32_t dp = 0u;
+    uint32_t sc = 0u;
+    if (flow_pw_us != 0u) {
+        const uint64_t d = (static_cast<uint64_t>(flow_pw_us) * snap.delta_p_q8) >> 8u;
+        dp = static_cast<uint32_t>(d > kMaxInjPwUs ? kMaxInjPwUs : d);
+    }
+    if (dp != 0u) {
+        const uint16_t x = static_cast<uint16_t>(dp > 65535u ? 65535u : dp);
+        const uint16_t corr = scurve_corr_q8(x);
+        // corr = 256 (PW acima do último breakpoint) é identidade: sem divisão.
+        // Senão ÷corr é a única UDIV da cauda: ΔP entra antes como Q8 >> 8.
+        if (corr == 0u || corr == 256u) {
+            sc = dp;
+        } else {
+            sc = (dp * 256u) / corr;  // dp ≤ 200000 → < 2³²
+            if (sc > kMaxInjPwUs) { sc = kMaxInjPwUs; }
+        }
+    }
+    const uint32_t inj = (sc > 0u) ? sc + snap.dead_time_us : 0u;
+    if (out != nullptr) {
+        out->delta_p_pw_us = dp;
+        out->scurve_pw_us = sc;
+        out->inj_pw_us = inj;
+        out->dead_time_us = snap.dead_time_us;
+        out->delta_p_q8 = snap.delta_p_q8;
+    }
+    return inj;
+}
+
+}  // namespace ems::engine
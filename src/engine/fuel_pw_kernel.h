@@ -0,0 +1,94 @@
+#pragma once
+
+/**
+ * @file engine/fuel_pw_kernel.h
+ * @brief Kernel fundido de PW para o slot de 2 ms.
+ *
+ * Substitui a cadeia calc_fuel_pw_us_default_fast → calc_final_pw_us e a
+ * cauda apply_delta_p_compensation → apply_injector_scurve por duas passagens
+ * sobre o mesmo breakdown, com a MESMA semântica inteira (floors por estágio)
+ * — os testes de equivalência exigem ±1 µs contra as funções originais.
+ *
+ *   fuel_pw_kernel()          REQ×VE×MAP/baro → λ → trim → CLT×IAT → 2-slope
+ *                             → + dead-time   (fluxo + final estacionário)
+ *   fuel_pw_kernel_injector() ΔP × S-curve → + dead-time  (aplicado ao fluxo
+ *                             DEPOIS de LTFT aditivo / X-τ / AE / quick-crank)
+ *
+ * Cada passagem faz no máximo UMA divisão de hardware (UDIV direto por λ e
+ * por corr_S — divisores que mudam a cada chamada), sem divisões de 64 bits:
+ * divisores de calibração (100×baro, rate 2-slope, spans da S-curve) viram
+ * recíprocos em cache, refeitos na primeira chamada depois de
+ * fuel_pw_kernel_invalidate(); ΔP (só sensores) vem pré-calculado no snapshot.
+ *
+ * Custo em ciclos só se mede no alvo: o main loop cronometra as duas
+ * passagens com DWT->CYCCNT e guarda o pior caso em
+ * g_fuel_pw_kernel_cycles_max (dump 'D' [56]). No host, make host-bench-fuel
+ * compara ns/slot com a cadeia original.
+ */
+
+#include <cstdint>
+
+namespace ems::engine {
+
+// Ponto de operação já resolvido pelo lookup 2D preparado do slot.
+struct FuelOperatingPoint {
+    uint8_t  ve;
+    uint16_t map_bar_x100;
+    uint16_t lambda_target_x1000;
+    int16_t  trim_pct_x10;      // STFT+LTFT multiplicativo, clamp ±50%
+};
+
+// Correções dependentes só de sensores (cache do main loop + ΔP).
+struct FuelSensorSnapshot {
+    uint16_t corr_clt_x256;
+    uint16_t corr_iat_x256;
+    uint16_t dead_time_us;
+    uint16_t delta_p_q8;        // sqrt(ΔP_nom/ΔP_act) Q8; 256 = neutro
+};
+
+// Estágios intermédios para telemetria / bancada.
+struct FuelPwBreakdown {
+    uint32_t base_pw_us;        // REQ_FUEL × VE × MAP / baro
+    uint32_t lambda_pw_us;      // ÷ λ alvo
+    uint32_t trimmed_pw_us;     // × (1 + trim)
+    uint32_t flow_pw_us;        // × CLT × IAT, 2-slope (líquido, sem dead-time)
+    uint32_t final_pw_us;       // flow + dead-time (= calc_fuel_pw_us_default_fast)
+    uint32_t delta_p_pw_us;     // cauda: fluxo transitório × ΔP
+    uint32_t scurve_pw_us;      // cauda: ÷ S-curve
+    uint32_t inj_pw_us;         // cauda: comandado (scurve + dead-time, 0 se sem fluxo)
+    uint16_t dead_time_us;
+    uint16_t delta_p_q8;
+};
+
+// Breakdown do último slot de 2 ms (escrito pelo main loop, lido pelo dump
+// 'D' [52..55]). Só main loop — não é lido em ISR.
+extern FuelPwBreakdown g_fuel_pw_breakdown;
+
+// Pior caso (ciclos de CPU, DWT->CYCCNT) de fuel_pw_kernel +
+// fuel_pw_kernel_injector no slot de 2 ms — dump 'D' [56]. 0 no host.
+extern uint32_t g_fuel_pw_kernel_cycles_max;
+
+// Descarta os recíprocos de calibração. Obrigatório depois de mudar
+// REQ_FUEL (cilindrada, bico, stoich), baro/map_ref, 2-slope ou o eixo da
+// S-curve — fuel_set_baro_bar_x100, engine_config_load, a escrita da página
+// do 2-slope e o stoich flex já chamam.
+void fuel_pw_kernel_invalidate() noexcept;
+
+// Monta o snapshot; ΔP só é recalculado quando pressão/MAP/nominal mudam.
+FuelSensorSnapshot fuel_pw_kernel_snapshot(uint16_t corr_clt_x256,
+                                           uint16_t corr_iat_x256,
+                                           uint16_t dead_time_us,
+                                           uint16_t fuel_press_bar_x1000,
+                                           uint16_t map_bar_x100) noexcept;
+
+// Passagem principal. Devolve final_pw_us; out pode ser nullptr.
+uint32_t fuel_pw_kernel(const FuelOperatingPoint& op,
+                        const FuelSensorSnapshot& snap,
+                        FuelPwBreakdown* out) noexcept;
+
+// Cauda física do bico sobre o fluxo final do slot. Devolve inj_pw_us.
+uint32_t fuel_pw_kernel_injector(uint32_t flow_pw_us,
+                                 const FuelSensorSnapshot& snap,
+                                 FuelPwBreakdown* out) noexcept;
+
+}  // namespace ems::engine
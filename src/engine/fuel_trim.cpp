@@ -5,6 +5,7 @@
 #include "engine/engine_config.h"
 #include "engine/math_utils.h"
 #include "engine/table3d.h"
+#include "engine/table_ops.h"
 #include "hal/flash.h"
 
 #include <cstdint>
@@ -664,6 +665,27 @@ void fuel_ltft_accum_tick_for_test(uint8_t map_idx, uint8_t rpm_idx,
 }
 #endif
 
+// bake = mean STFT × gain / 100 (calibrável; 0 no blob → default 50), %×10.
+static int16_t ltft_accum_bake_x10(uint8_t map_idx, uint8_t rpm_idx) noexcept {
+    const int16_t mean_stft = fuel_ltft_accum_mean_stft_x10(map_idx, rpm_idx);
+    uint8_t gain = ltft_commit_gain_pct;
+    if (gain == 0u) {
+        gain = static_cast<uint8_t>(kLtftAccumCommitGainPct);
+    }
+    return static_cast<int16_t>(
+        (static_cast<int32_t>(mean_stft) * static_cast<int32_t>(gain)) / 100);
+}
+
+// Desenrola LTFT multiplicativo da célula (evita double-count com VE nova).
+static void ltft_accum_unroll_cell(uint8_t map_idx, uint8_t rpm_idx,
+                                   int16_t bake_x10) noexcept {
+    int16_t& ltft = g_ltft_pct_x10[map_idx][rpm_idx];
+    ltft = static_cast<int16_t>(ltft - bake_x10);
+    const int16_t ltft_clamp = ltft_mult_clamp();
+    ltft = clamp_i16(ltft, static_cast<int16_t>(-ltft_clamp), ltft_clamp);
+    fuel_ltft_store_cell(map_idx, rpm_idx, ltft);
+}
+
 // require_ready: try_commit (1 célula) exige gates ready; apply_all aplica
 // qualquer célula com hits>0 (todas as correcções acumuladas na sessão).
 // unroll_global_stft: true em commit de célula única (desenrola o trim global).
@@ -683,51 +705,29 @@ static bool ltft_accum_commit_cell(uint8_t map_idx,
         return false;
     }
 
-    const int16_t mean_stft = fuel_ltft_accum_mean_stft_x10(map_idx, rpm_idx);
-    // bake = mean * gain / 100  (calibrável; 0 no blob → default 50)
-    uint8_t gain = ltft_commit_gain_pct;
-    if (gain == 0u) {
-        gain = static_cast<uint8_t>(kLtftAccumCommitGainPct);
-    }
-    int16_t bake_x10 = static_cast<int16_t>(
-        (static_cast<int32_t>(mean_stft) * static_cast<int32_t>(gain)) / 100);
+    const int16_t bake_x10 = ltft_accum_bake_x10(map_idx, rpm_idx);
     if (bake_x10 == 0) {
         // mean na fronteira do min mas gain arredondou a 0 — não commitar lixo
         fuel_ltft_accum_reset_cell(map_idx, rpm_idx);
         return false;
     }
 
-    // VE[map][rpm] = VE * (1000 + bake_x10) / 1000
-    // bake_x10 em %×10: +40 → +4.0% → factor 1040/1000.
-    // Arredonda ao mais próximo; se o factor truncar a 0 em VE pequena,
-    // garante ΔVE mínimo de ±1 para o bake não se perder em inteiros.
-    uint8_t& ve_cell = ve_table[map_idx][rpm_idx];
-    const int32_t ve_old = static_cast<int32_t>(ve_cell);
-    const int32_t factor = 1000 + static_cast<int32_t>(bake_x10);
-    int32_t ve_new = (ve_old * factor + ((factor >= 0) ? 500 : -500)) / 1000;
-    if (ve_new == ve_old) {
-        ve_new = ve_old + ((bake_x10 > 0) ? 1 : -1);
-    }
-    if (ve_new < static_cast<int32_t>(kLtftAccumVeMin)) {
-        ve_new = static_cast<int32_t>(kLtftAccumVeMin);
-    }
-    if (ve_new > static_cast<int32_t>(kLtftAccumVeMax)) {
-        ve_new = static_cast<int32_t>(kLtftAccumVeMax);
-    }
+    // VE[map][rpm] = round(VE × (1000 + bake_x10) / 1000), ΔVE mínimo ±1,
+    // clamp [kLtftAccumVeMin, kLtftAccumVeMax] — regra única em table_ops
+    // (a mesma do apply em lote).
     // Se o clamp matou a mudança (VE já no limite), não desenrola trims —
     // evita drift de trim sem mudança de base. Limpa stats e tenta de novo depois.
-    if (ve_new == ve_old) {
+    uint8_t* const ve = &ve_table[map_idx][rpm_idx];
+    int8_t delta = 0;
+    uint8_t changed_bit = 0u;
+    if (table_ops_trim_delta_u8_x10(ve, &bake_x10, 1u, kLtftAccumVeMin,
+                                    kLtftAccumVeMax, &delta, &changed_bit) == 0u) {
         fuel_ltft_accum_reset_cell(map_idx, rpm_idx);
         return false;
     }
-    ve_cell = static_cast<uint8_t>(ve_new);
+    table_ops_add_sat_u8(ve, &delta, 1u);
 
-    // Desenrola LTFT multiplicativo da célula (evita double-count com VE nova).
-    int16_t& ltft = g_ltft_pct_x10[map_idx][rpm_idx];
-    ltft = static_cast<int16_t>(ltft - bake_x10);
-    const int16_t ltft_clamp = ltft_mult_clamp();
-    ltft = clamp_i16(ltft, static_cast<int16_t>(-ltft_clamp), ltft_clamp);
-    fuel_ltft_store_cell(map_idx, rpm_idx, ltft);
+    ltft_accum_unroll_cell(map_idx, rpm_idx, bake_x10);
 
     if (unroll_global_stft) {
         // Desenrola STFT global (integrador em ×1000: stft ≈ I/100).
@@ -762,22 +762,60 @@ bool fuel_ltft_accum_try_commit(uint8_t map_idx, uint8_t rpm_idx) noexcept {
                                   /*unroll_global_stft=*/true);
 }
 
+// Buffers do apply em lote (fora da stack do main loop).
+static int16_t g_ltft_bake_x10[kTableCells] = {};
+static int8_t  g_ltft_ve_delta[kTableCells] = {};
+static uint8_t g_ltft_changed_bits[(kTableCells + 7u) / 8u] = {};
+
 uint16_t fuel_ltft_accum_apply_all_ready() noexcept {
     // Bulk APPLY ('Y'): bake em TODAS as células com acumulação (hits>0),
     // não só as ready. O bit ready na page12 continua a ser indicador de
     // qualidade; o apply de sessão não deixa correcções parciais para trás.
     // VE + LTFT por célula; STFT global fica — re-converge no loop.
     // (N commits × unroll STFT derrubava o trim global de forma incorrecta.)
-    uint16_t n = 0u;
+    //
+    // Três passagens, mesmo resultado que N commits de célula: bakes do
+    // acumulador → ΔVE de todas as células (table_ops_trim_delta_u8_x10) e
+    // uma soma saturada em lote sobre a VE inteira → unroll LTFT / NVM só
+    // nas células que mudaram.
+    for (uint8_t m = 0u; m < kTableAxisSize; ++m) {
+        for (uint8_t r = 0u; r < kTableAxisSize; ++r) {
+            const uint16_t idx = static_cast<uint16_t>(m) * kTableAxisSize + r;
+            int16_t bake = 0;
+            if (g_ltft_stats[m][r].hits != 0u) {
+                bake = ltft_accum_bake_x10(m, r);
+                if (bake == 0) {
+                    fuel_ltft_accum_reset_cell(m, r);
+                }
+            }
+            g_ltft_bake_x10[idx] = bake;
+        }
+    }
+
+    const uint16_t n = table_ops_trim_delta_u8_x10(&ve_table[0][0], g_ltft_bake_x10,
+                                                   kTableCells, kLtftAccumVeMin,
+                                                   kLtftAccumVeMax, g_ltft_ve_delta,
+                                                   g_ltft_changed_bits);
+    if (n != 0u) {
+        table_ops_add_sat_u8(&ve_table[0][0], g_ltft_ve_delta, kTableCells);
+    }
+
     for (uint8_t m = 0u; m < kTableAxisSize; ++m) {
         for (uint8_t r = 0u; r < kTableAxisSize; ++r) {
-            if (ltft_accum_commit_cell(m, r,
-                                       /*require_ready=*/false,
-                                       /*unroll_global_stft=*/false)) {
-                ++n;
+            const uint16_t idx = static_cast<uint16_t>(m) * kTableAxisSize + r;
+            if (g_ltft_bake_x10[idx] == 0) {
+                continue;
+            }
+            if (table_ops_bit(g_ltft_changed_bits, idx)) {
+                ltft_accum_unroll_cell(m, r, g_ltft_bake_x10[idx]);
+                ++g_dbg_ltft_accum_commits;
             }
+            fuel_ltft_accum_reset_cell(m, r);
         }
     }
+    if (n != 0u && ltft_apply_burn_ve != 0u) {
+        g_ltft_ve_burn_pending = true;
+    }
     return n;
 }
 
@@ -991,5 +1029,36 @@ int16_t fuel_get_ltft_add_at(uint32_t rpm_x10, uint16_t map_bar_x100) noexcept {
     return fuel_get_ltft_add_us(mi, ri);
 }
 
+const int16_t* fuel_ltft_pct_cells() noexcept {
+    return &g_ltft_pct_x10[0][0];
+}
+
+const int16_t* fuel_ltft_add_cells() noexcept {
+    return &g_ltft_add_us[0][0];
+}
+
+void fuel_ltft_replace_maps(const int16_t* pct_cells, const int16_t* add_cells) noexcept {
+    fuel_ltft_accum_reset();
+    const int16_t mult_lim = ltft_mult_clamp();
+    for (uint8_t y = 0u; y < kTableAxisSize; ++y) {
+        for (uint8_t x = 0u; x < kTableAxisSize; ++x) {
+            const int16_t v = clamp_i16(pct_cells[y * kTableAxisSize + x],
+                                        static_cast<int16_t>(-mult_lim), mult_lim);
+            g_ltft_pct_x10[y][x] = v;
+            fuel_ltft_store_cell(y, x, v);
+        }
+    }
+    const int16_t add_lim = ltft_add_clamp();
+    for (uint8_t y = 0u; y < kLtftAddAxisSize; ++y) {
+        for (uint8_t x = 0u; x < kLtftAddAxisSize; ++x) {
+            const int16_t v = clamp_i16(add_cells[y * kLtftAddAxisSize + x],
+                                        static_cast<int16_t>(-add_lim), add_lim);
+            g_ltft_add_us[y][x] = v;
+            fuel_ltft_add_store_cell(static_cast<uint8_t>(y << 1u),
+                                     static_cast<uint8_t>(x << 1u), v);
+        }
+    }
+}
+
 
 }  // namespace ems::engine
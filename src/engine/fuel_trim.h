@@ -145,4 +145,13 @@ int16_t fuel_get_ltft_pct_x10(uint8_t map_idx, uint8_t rpm_idx) noexcept;
 int16_t fuel_get_ltft_add_us(uint8_t map_idx, uint8_t rpm_idx) noexcept;
 int16_t fuel_get_ltft_add_at(uint32_t rpm_x10, uint16_t map_bar_x100) noexcept;
 
+// Re-eixo (engine/table_reaxis): vista em bloco dos mapas LTFT, row-major
+// [map][rpm] — kTableCells células %×10 e kLtftAddAxisSize² células µs.
+const int16_t* fuel_ltft_pct_cells() noexcept;
+const int16_t* fuel_ltft_add_cells() noexcept;
+// Substitui ambos os mapas (RAM + shadows NVM, mesmo clamp/arredondamento
+// do store de célula) e descarta o acumulador — as estatísticas pertencem
+// às células da grelha anterior.
+void fuel_ltft_replace_maps(const int16_t* pct_cells, const int16_t* add_cells) noexcept;
+
 }  // namespace ems::engine
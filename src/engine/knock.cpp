@@ -12,6 +12,20 @@
  *
  * Sem periférico COMP interno (STM32H562 não o possui) — detecção 100% em
  * software a partir das amostras ADC.
+ *
+ * Caminho DSP (knock_band_hz ≠ 0): na faísca do cilindro da janela o ADC2
+ * passa a amostrar PA5 a ~96 kS/s por DMA (hal::adc_knock_capture_start);
+ * cada bloco de 64 amostras passa pelo Goertzel (engine/knock_dsp) na
+ * frequência de ressonância. A amplitude de pico da janela é normalizada
+ * pelo ruído de fundo do próprio cilindro (EMA das janelas limpas) →
+ * intensidade; knock = intensidade > knock_intensity_thr_x10 / 10. Com
+ * knock_band_hz = 0 mantém-se a contagem por threshold acima.
+ *
+ * Divisão ISR / main loop: a ISR do TIM5 só abre/fecha janelas, pede a
+ * captura (não bloqueante — o ADC2 é reconfigurado no PendSV) e latcha os
+ * acumuladores da janela numa fila; knock_process() (main loop, 2 ms)
+ * recalcula o coeficiente quando knock_band_hz muda e corre a decisão
+ * (Goertzel → intensidade, limiar, retard/recovery, histórico).
  */
 
 #include "engine/knock.h"
@@ -19,7 +33,9 @@
 #include <cstdint>
 
 #include "engine/calibration.h"
-#include "hal/flash.h"
+#include "engine/knock_dsp.h"
+#include "engine/knock_learn.h"
+#include "hal/adc.h"
 
 namespace {
 
@@ -33,6 +49,32 @@ constexpr uint16_t kAdcThresholdDefault    = 2048u; // 12-bit mid-range; ajustar
 constexpr uint16_t kAdcThresholdMin        = 256u;  // evita falsos positivos por ruído de offset
 constexpr uint16_t kAdcThresholdMax        = 4000u; // abaixo de 4095 para margem
 
+// DSP: captura limitada a 6 blocos (~4 ms a 96 kS/s: 24° a 1000 rpm, 144° a
+// 6000 rpm) — cobre a combustão e devolve o ADC2 aos canais lentos no resto
+// do ciclo.
+constexpr uint8_t  kDspMaxBlocks           = 6u;
+constexpr uint16_t kDspDefaultThrX10       = 30u;   // intensidade 3.0× o fundo
+constexpr uint32_t kDspBgMinQ4             = 16u;   // fundo mínimo 1 count (Q4)
+constexpr uint8_t  kDspBgShift             = 4u;    // EMA do fundo α = 1/16
+static_assert(ems::engine::kKnockDspBlock == ems::hal::kAdcKnockBlock,
+              "bloco DSP tem de coincidir com o meio-buffer DMA do ADC");
+
+// Janelas fechadas à espera do main loop: 8 cil a 8000 rpm ≈ 1 janela/ms —
+// 16 entradas cobrem vários slots de 2 ms atrasados.
+constexpr uint8_t kWindowQueueLen = 16u;
+
+// Acumuladores de uma janela fechada, latchados na ISR.
+struct KnockWindow {
+    uint64_t dsp_energy;      // maior energia de bloco
+    uint32_t dsp_sum;
+    uint16_t dsp_samples;
+    uint16_t win_min;
+    uint16_t win_max;
+    uint8_t  cyl;
+    uint8_t  count;           // amostras acima do threshold
+    uint8_t  dsp_blocks;
+};
+
 // ── Estado ────────────────────────────────────────────────────────────────────
 struct KnockState {
     uint8_t  knock_count[ems::engine::kKnockCylinders]; // amostras acima do threshold na janela atual
@@ -49,7 +91,38 @@ struct KnockState {
     uint16_t win_max;         // max do raw na janela corrente
     uint16_t noise_p2p_ema;   // EMA (α=1/8) do p2p por janela
     uint16_t dead_windows;    // janelas consecutivas abaixo do piso
+    uint16_t peak_raw[ems::engine::kKnockCylinders];  // max raw da última janela fechada
+    // DSP em banda (só com knock_band_hz ≠ 0)
+    // Coeficiente calculado no main loop (knock_process); a faísca só arma a
+    // captura com dsp_band_hz == knock_band_hz.
+    volatile uint16_t dsp_band_hz;  // frequência do coeficiente em cache (0 = nenhum)
+    volatile int32_t  dsp_coeff_q14;
+    int32_t  dsp_dc;          // offset do sinal: média da janela anterior
+    bool     dsp_capturing;
+    uint8_t  dsp_blocks;      // blocos processados na janela corrente
+    uint64_t dsp_peak_energy; // maior energia de bloco na janela
+    uint32_t dsp_sum;         // soma das amostras (→ dc)
+    uint16_t dsp_samples;
+    uint32_t bg_amp_q4[ems::engine::kKnockCylinders];     // fundo (Q4), 0 = sem semente
+    uint16_t band_amp[ems::engine::kKnockCylinders];      // amplitude última janela
+    uint16_t intensity_q8[ems::engine::kKnockCylinders];  // amp / fundo (Q8)
+    // Histórico para telemetria (knock_history_read): escrito só no main loop.
+    uint8_t  hist[ems::engine::kKnockCylinders][ems::engine::kKnockHistoryLen];
+    uint8_t  hist_count[ems::engine::kKnockCylinders];    // janelas fechadas (wrap)
+    // Janelas por decisão desde o último knock_take_window_counts.
+    uint16_t learn_knocked;
+    uint16_t learn_clean;
+    // Fila ISR → main loop (produtor: ISR com IRQ mascaradas; consumidor:
+    // knock_process).
+    KnockWindow win_q[kWindowQueueLen];
+    volatile uint8_t win_head;
+    volatile uint8_t win_tail;
+    uint16_t win_dropped;     // fila cheia (main loop parado)
 };
+static_assert((ems::engine::kKnockHistoryLen & (ems::engine::kKnockHistoryLen - 1u)) == 0u,
+              "índice do anel por máscara");
+static_assert((kWindowQueueLen & (kWindowQueueLen - 1u)) == 0u,
+              "índice da fila por máscara");
 
 constexpr uint16_t kDeadWindowLimit = 100u;  // ~100 eventos de combustão
 
@@ -62,6 +135,141 @@ static inline uint16_t clamp_u16(uint16_t v, uint16_t lo, uint16_t hi) noexcept
     return v;
 }
 
+static void dsp_stop() noexcept {
+    if (g.dsp_capturing) {
+        g.dsp_capturing = false;
+        ems::hal::adc_knock_capture_stop();
+    }
+}
+
+// Sink do DMA do ADC2 (ISR do GPDMA): um bloco por meio-buffer.
+static void dsp_feed(const uint16_t* x, uint16_t n) noexcept {
+    if (!g.dsp_capturing || !g.window_active) { return; }
+    uint32_t sum = 0u;
+    for (uint16_t i = 0u; i < n; ++i) {
+        const uint16_t raw = x[i];
+        sum += raw;
+        if (raw < g.win_min) { g.win_min = raw; }
+        if (raw > g.win_max) { g.win_max = raw; }
+    }
+    const uint64_t e = ems::engine::knock_goertzel_energy(x, n, g.dsp_coeff_q14, g.dsp_dc);
+    if (e > g.dsp_peak_energy) { g.dsp_peak_energy = e; }
+    g.dsp_sum += sum;
+    g.dsp_samples = static_cast<uint16_t>(g.dsp_samples + n);
+    if (++g.dsp_blocks >= kDspMaxBlocks) { dsp_stop(); }
+}
+
+static uint16_t dsp_thr_x10() noexcept {
+    return (ems::engine::knock_intensity_thr_x10 != 0u)
+        ? ems::engine::knock_intensity_thr_x10 : kDspDefaultThrX10;
+}
+
+// Entrada do histórico: nível Q5 relativo ao limiar (32 = limiar), saturado
+// nos 7 bits, com a decisão no bit 7.
+static void hist_push(uint8_t c, uint32_t level_q5, bool knocked) noexcept {
+    using ems::engine::kKnockHistLevelMask;
+    const uint8_t lvl = (level_q5 > kKnockHistLevelMask)
+        ? kKnockHistLevelMask : static_cast<uint8_t>(level_q5);
+    const uint8_t i = static_cast<uint8_t>(g.hist_count[c] & (ems::engine::kKnockHistoryLen - 1u));
+    g.hist[c][i] = static_cast<uint8_t>(lvl | (knocked ? ems::engine::kKnockHistKnockBit : 0u));
+    ++g.hist_count[c];
+}
+
+// Decisão DSP da janela que fechou. Devolve true = knock.
+static bool dsp_evaluate(uint8_t c, uint64_t energy, uint32_t sum,
+                         uint16_t samples) noexcept {
+    const uint16_t amp = ems::engine::knock_goertzel_amplitude(
+        energy, ems::engine::kKnockDspBlock);
+    g.band_amp[c] = amp;
+    if (samples != 0u) { g.dsp_dc = static_cast<int32_t>(sum / samples); }
+
+    const uint32_t amp_q4 = static_cast<uint32_t>(amp) << 4;
+    if (g.bg_amp_q4[c] == 0u) {
+        // Primeira janela do cilindro: semente do fundo, sem decisão.
+        g.bg_amp_q4[c] = (amp_q4 > kDspBgMinQ4) ? amp_q4 : kDspBgMinQ4;
+        g.intensity_q8[c] = 256u;
+        return false;
+    }
+    const uint32_t bg = (g.bg_amp_q4[c] > kDspBgMinQ4) ? g.bg_amp_q4[c] : kDspBgMinQ4;
+    const uint32_t inten = (amp_q4 << 8) / bg;
+    g.intensity_q8[c] = static_cast<uint16_t>((inten > 0xFFFFu) ? 0xFFFFu : inten);
+
+    const uint16_t thr_x10 = dsp_thr_x10();
+    if (inten * 10u > static_cast<uint32_t>(thr_x10) * 256u) { return true; }
+    // Só janelas limpas alimentam o fundo (knock não o arrasta para cima).
+    const int32_t d = static_cast<int32_t>(amp_q4) - static_cast<int32_t>(g.bg_amp_q4[c]);
+    g.bg_amp_q4[c] = static_cast<uint32_t>(
+        static_cast<int32_t>(g.bg_amp_q4[c]) + d / (1 << kDspBgShift));
+    if (g.bg_amp_q4[c] < kDspBgMinQ4) { g.bg_amp_q4[c] = kDspBgMinQ4; }
+    return false;
+}
+
+// Decisão de uma janela fechada (main loop, knock_process).
+static void window_evaluate(const KnockWindow& w) noexcept {
+    using ems::engine::knock_retard_x10;
+    const uint8_t c = w.cyl;
+    const uint8_t count = w.count;
+
+    // Sensor morto: avalia o p2p da janela que fechou (só se houve amostras).
+    if (ems::engine::knock_dead_min_p2p != 0u && w.win_min <= w.win_max) {
+        const uint16_t p2p = static_cast<uint16_t>(w.win_max - w.win_min);
+        g.noise_p2p_ema = static_cast<uint16_t>(
+            static_cast<int32_t>(g.noise_p2p_ema) +
+            (static_cast<int32_t>(p2p) -
+             static_cast<int32_t>(g.noise_p2p_ema)) / 8);
+        if (g.noise_p2p_ema < ems::engine::knock_dead_min_p2p) {
+            if (g.dead_windows < 0xFFFFu) { ++g.dead_windows; }
+        } else {
+            g.dead_windows = 0u;
+        }
+    }
+
+    // DSP quando a janela teve blocos capturados; senão, contagem legada.
+    const bool use_dsp = (ems::engine::knock_band_hz != 0u) && (w.dsp_blocks != 0u);
+    const bool knocked = use_dsp
+        ? dsp_evaluate(c, w.dsp_energy, w.dsp_sum, w.dsp_samples)
+        : (count > g.event_threshold);
+    // inten×10 > thr×256 ⇔ inten×5/(thr×4) > 32; count > thr ⇔ count×32/(thr+1) ≥ 32.
+    const uint32_t level_q5 = use_dsp
+        ? static_cast<uint32_t>(g.intensity_q8[c]) * 5u / (dsp_thr_x10() * 4u)
+        : static_cast<uint32_t>(count) * ems::engine::kKnockHistLevelLimit / (g.event_threshold + 1u);
+    hist_push(c, level_q5, knocked);
+    uint16_t& learn_n = knocked ? g.learn_knocked : g.learn_clean;
+    if (learn_n < 0xFFFFu) { ++learn_n; }
+
+    if (knocked) {
+        // Knock detected: add retard, reset clean cycle counter
+        const uint16_t next = static_cast<uint16_t>(knock_retard_x10[c] + kRetardStepX10);
+        knock_retard_x10[c]  = clamp_u16(next, 0u, kRetardMaxX10);
+        g.clean_cycles[c]    = 0u;
+        g.global_clean_cycles = 0u;
+
+        // Slightly lower threshold to stay sensitive during knock conditions
+        if (!use_dsp && g.adc_threshold > kAdcThresholdMin + 64u) {
+            g.adc_threshold = static_cast<uint16_t>(g.adc_threshold - 64u);
+        }
+    } else {
+        // Clean cycle: accumulate toward recovery
+        if (g.clean_cycles[c] < 255u) { ++g.clean_cycles[c]; }
+
+        if ((g.clean_cycles[c] >= kRecoveryDelayCycles) &&
+            (knock_retard_x10[c] >= kRecoveryStepX10)) {
+            knock_retard_x10[c] = static_cast<uint16_t>(
+                knock_retard_x10[c] - kRecoveryStepX10);
+        }
+
+        if (g.global_clean_cycles < 255u) { ++g.global_clean_cycles; }
+        if (g.global_clean_cycles >= 100u) {
+            // Raise threshold slightly after 100 consecutive clean cycles
+            // (noise floor adaptation — avoid false positives after knock episode)
+            if (!use_dsp && g.adc_threshold < kAdcThresholdMax - 32u) {
+                g.adc_threshold = static_cast<uint16_t>(g.adc_threshold + 32u);
+            }
+            g.global_clean_cycles = 0u;
+        }
+    }
+}
+
 }  // namespace
 
 namespace ems::engine {
@@ -71,38 +279,16 @@ volatile uint16_t knock_retard_x10[kKnockCylinders] = {};
 // ── API pública ───────────────────────────────────────────────────────────────
 
 void knock_init() noexcept {
+    ems::hal::adc_knock_capture_stop();
     g = {};
     g.event_threshold = kDefaultEventThreshold;
     g.adc_threshold   = kAdcThresholdDefault;
-
-    // Carrega retard persistido do NVM (rpm_i=0, load_i=cyl, 4 células)
-    for (uint8_t i = 0u; i < kKnockCylinders; ++i) {
-        const int8_t stored = ems::hal::nvm_read_knock(0u, i);
-        knock_retard_x10[i] = (stored > 0)
-            ? clamp_u16(static_cast<uint16_t>(stored), 0u, kRetardMaxX10)
-            : 0u;
-    }
-
-    // Carrega threshold ADC persistido (rpm_i=1, load_i=0).
-    // Armazenado em unidades de 32 (threshold = stored × 32) para caber em int8_t.
-    const int8_t saved_thresh = ems::hal::nvm_read_knock(1u, 0u);
-    if (saved_thresh > 0) {
-        const uint16_t t = static_cast<uint16_t>(
-            static_cast<uint16_t>(saved_thresh) * 32u);
-        g.adc_threshold = clamp_u16(t, kAdcThresholdMin, kAdcThresholdMax);
-    }
+    g.dsp_dc          = 2048;   // meio da escala até à primeira janela
+    for (uint8_t i = 0u; i < kKnockCylinders; ++i) { knock_retard_x10[i] = 0u; }
 }
 
 void knock_save_to_nvm() noexcept {
-    for (uint8_t i = 0u; i < kKnockCylinders; ++i) {
-        const int8_t val = static_cast<int8_t>(
-            knock_retard_x10[i] > 127u ? 127u : knock_retard_x10[i]);
-        ems::hal::nvm_write_knock(0u, i, val);
-    }
-    // Persiste threshold em unidades de 32 (0..127 → 0..4064)
-    const uint8_t thresh_stored = static_cast<uint8_t>(
-        (g.adc_threshold / 32u) > 127u ? 127u : (g.adc_threshold / 32u));
-    ems::hal::nvm_write_knock(1u, 0u, static_cast<int8_t>(thresh_stored));
+    knock_learn_save();
 }
 
 void knock_set_event_threshold(uint8_t threshold) noexcept {
@@ -118,17 +304,36 @@ uint16_t knock_get_adc_threshold() noexcept {
 }
 
 void knock_window_open(uint8_t cyl) noexcept {
-    g.window_cyl    = static_cast<uint8_t>(cyl & 0x3u);
+    g.window_cyl    = static_cast<uint8_t>(cyl % kKnockCylinders);
     g.window_active = true;
     // Reset counter for this cylinder so we start clean each window
     g.knock_count[g.window_cyl] = 0u;
     g.win_min = 0xFFFFu;
     g.win_max = 0u;
+    g.dsp_blocks = 0u;
+    g.dsp_peak_energy = 0u;
+    g.dsp_sum = 0u;
+    g.dsp_samples = 0u;
+}
+
+void knock_window_spark(uint8_t cyl) noexcept {
+    const uint16_t band = ems::engine::knock_band_hz;
+    // Coeficiente ainda não recalculado para a banda actual → sem captura
+    // nesta janela (contagem legada).
+    if (band == 0u || band != g.dsp_band_hz || !g.window_active ||
+        g.dsp_capturing || g.dsp_blocks != 0u ||
+        g.window_cyl != static_cast<uint8_t>(cyl % kKnockCylinders)) {
+        return;
+    }
+    g.dsp_capturing = true;
+    ems::hal::adc_knock_capture_start(&dsp_feed);
+    if (!ems::hal::adc_knock_capture_active()) { g.dsp_capturing = false; }
 }
 
 void knock_window_close(uint8_t cyl) noexcept {
-    if ((g.window_cyl == static_cast<uint8_t>(cyl & 0x3u)) && g.window_active) {
+    if ((g.window_cyl == static_cast<uint8_t>(cyl % kKnockCylinders)) && g.window_active) {
         g.window_active = false;
+        dsp_stop();
     }
 }
 
@@ -147,88 +352,122 @@ void knock_adc_update(uint16_t raw) noexcept {
 }
 
 void knock_cycle_complete(uint8_t cyl) noexcept {
-    const uint8_t c = static_cast<uint8_t>(cyl & 0x3u);
+    const uint8_t c = static_cast<uint8_t>(cyl % kKnockCylinders);
 
-    // Read and zero atomically — knock_adc_update() can run from CKP ISR
-    // concurrently; CPSID prevents a torn read/zero on non-atomic uint8_t.
+    // Latch + zero com IRQ mascaradas: knock_adc_update (ISR de dente) e o
+    // sink do DMA escrevem os acumuladores; a fila pode ter dois produtores
+    // (TIM5 e perda de sync).
 #if defined(__arm__) || defined(__thumb__)
     __asm__ volatile("cpsid i" ::: "memory");
 #endif
-    const uint8_t count = g.knock_count[c];
+    const uint8_t head = g.win_head;
+    const bool full = static_cast<uint8_t>(head - g.win_tail) >= kWindowQueueLen;
+    if (!full) {
+        KnockWindow& w = g.win_q[head & (kWindowQueueLen - 1u)];
+        w.cyl         = c;
+        w.count       = g.knock_count[c];
+        w.dsp_blocks  = g.dsp_blocks;
+        w.dsp_energy  = g.dsp_peak_energy;
+        w.dsp_sum     = g.dsp_sum;
+        w.dsp_samples = g.dsp_samples;
+        w.win_min     = g.win_min;
+        w.win_max     = g.win_max;
+        g.win_head = static_cast<uint8_t>(head + 1u);
+    } else if (g.win_dropped < 0xFFFFu) {
+        ++g.win_dropped;
+    }
+    g.peak_raw[c] = (g.win_min <= g.win_max) ? g.win_max : 0u;
     g.knock_count[c] = 0u;
+    g.dsp_blocks = 0u;
+    g.dsp_peak_energy = 0u;
+    g.dsp_sum = 0u;
+    g.dsp_samples = 0u;
+    g.win_min = 0xFFFFu;
+    g.win_max = 0u;
 #if defined(__arm__) || defined(__thumb__)
     __asm__ volatile("cpsie i" ::: "memory");
 #endif
+}
 
-    // Sensor morto: avalia o p2p da janela que fechou (só se houve amostras;
-    // sentinela reposta para não reavaliar a mesma janela).
-    if (ems::engine::knock_dead_min_p2p != 0u && g.win_min <= g.win_max) {
-        const uint16_t p2p = static_cast<uint16_t>(g.win_max - g.win_min);
-        g.noise_p2p_ema = static_cast<uint16_t>(
-            static_cast<int32_t>(g.noise_p2p_ema) +
-            (static_cast<int32_t>(p2p) -
-             static_cast<int32_t>(g.noise_p2p_ema)) / 8);
-        if (g.noise_p2p_ema < ems::engine::knock_dead_min_p2p) {
-            if (g.dead_windows < 0xFFFFu) { ++g.dead_windows; }
-        } else {
-            g.dead_windows = 0u;
-        }
-        g.win_min = 0xFFFFu;
-        g.win_max = 0u;
+void knock_process() noexcept {
+    // Coeficiente do Goertzel só quando a calibração muda (cosf fora das
+    // ISRs); a banda é publicada depois do coeficiente.
+    const uint16_t band = ems::engine::knock_band_hz;
+    if (band != 0u && band != g.dsp_band_hz) {
+        g.dsp_coeff_q14 = knock_goertzel_coeff_q14(band, ems::hal::kAdcKnockSampleRateHz);
+        g.dsp_band_hz = band;
     }
-
-    if (count > g.event_threshold) {
-        // Knock detected: add retard, reset clean cycle counter
-        const uint16_t next = static_cast<uint16_t>(knock_retard_x10[c] + kRetardStepX10);
-        knock_retard_x10[c]  = clamp_u16(next, 0u, kRetardMaxX10);
-        g.clean_cycles[c]    = 0u;
-        g.global_clean_cycles = 0u;
-
-        // Slightly lower threshold to stay sensitive during knock conditions
-        if (g.adc_threshold > kAdcThresholdMin + 64u) {
-            g.adc_threshold = static_cast<uint16_t>(g.adc_threshold - 64u);
-        }
-    } else {
-        // Clean cycle: accumulate toward recovery
-        if (g.clean_cycles[c] < 255u) { ++g.clean_cycles[c]; }
-
-        if ((g.clean_cycles[c] >= kRecoveryDelayCycles) &&
-            (knock_retard_x10[c] >= kRecoveryStepX10)) {
-            knock_retard_x10[c] = static_cast<uint16_t>(
-                knock_retard_x10[c] - kRecoveryStepX10);
-        }
-
-        if (g.global_clean_cycles < 255u) { ++g.global_clean_cycles; }
-        if (g.global_clean_cycles >= 100u) {
-            // Raise threshold slightly after 100 consecutive clean cycles
-            // (noise floor adaptation — avoid false positives after knock episode)
-            if (g.adc_threshold < kAdcThresholdMax - 32u) {
-                g.adc_threshold = static_cast<uint16_t>(g.adc_threshold + 32u);
-            }
-            g.global_clean_cycles = 0u;
-        }
+    while (g.win_tail != g.win_head) {
+        const uint8_t t = g.win_tail;
+        window_evaluate(g.win_q[t & (kWindowQueueLen - 1u)]);
+        g.win_tail = static_cast<uint8_t>(t + 1u);
     }
 }
 
 void knock_window_cycle_end() noexcept {
     if (g.window_active) {
         g.window_active = false;
+        dsp_stop();
         knock_cycle_complete(g.window_cyl);
     }
 }
 
+void knock_on_dwell_start(uint8_t cyl) noexcept {
+    const uint8_t c = static_cast<uint8_t>(cyl % kKnockCylinders);
+    // Multi-spark: re-dwell do mesmo cilindro não fecha a janela.
+    if (g.window_active && g.window_cyl == c) { return; }
+    knock_window_cycle_end();
+    knock_window_open(c);
+}
+
 bool knock_sensor_dead() noexcept {
     return (ems::engine::knock_dead_min_p2p != 0u) &&
            (g.dead_windows >= kDeadWindowLimit);
 }
 
 uint16_t knock_get_retard_x10(uint8_t cyl) noexcept {
-    return knock_retard_x10[static_cast<uint8_t>(cyl & 0x3u)];
+    return knock_retard_x10[static_cast<uint8_t>(cyl % kKnockCylinders)];
+}
+
+void knock_take_window_counts(uint16_t* knocked, uint16_t* clean) noexcept {
+    // Contadores escritos por knock_process: mesmo contexto (main loop).
+    *knocked = g.learn_knocked;
+    *clean = g.learn_clean;
+    g.learn_knocked = 0u;
+    g.learn_clean = 0u;
+}
+
+uint16_t knock_get_peak_raw(uint8_t cyl) noexcept {
+    return g.peak_raw[static_cast<uint8_t>(cyl % kKnockCylinders)];
+}
+
+uint16_t knock_get_intensity_q8(uint8_t cyl) noexcept {
+    return g.intensity_q8[static_cast<uint8_t>(cyl % kKnockCylinders)];
+}
+
+uint16_t knock_get_band_amplitude(uint8_t cyl) noexcept {
+    return g.band_amp[static_cast<uint8_t>(cyl % kKnockCylinders)];
+}
+
+uint16_t knock_get_background(uint8_t cyl) noexcept {
+    return static_cast<uint16_t>(g.bg_amp_q4[static_cast<uint8_t>(cyl % kKnockCylinders)] >> 4);
+}
+
+uint8_t knock_history_read(uint8_t cyl, uint8_t* out, uint8_t n) noexcept {
+    const uint8_t c = static_cast<uint8_t>(cyl % kKnockCylinders);
+    if (n > kKnockHistoryLen) { n = kKnockHistoryLen; }
+    // Entradas escritas por knock_process (main loop): cópia sem mascarar IRQ.
+    const uint8_t count = g.hist_count[c];
+    for (uint8_t k = 0u; k < n; ++k) {
+        const uint8_t i = static_cast<uint8_t>((count - n + k) & (kKnockHistoryLen - 1u));
+        out[k] = g.hist[c][i];
+    }
+    return count;
 }
 
 #if defined(EMS_HOST_TEST)
 uint8_t knock_test_get_knock_count(uint8_t cyl) noexcept {
-    return g.knock_count[static_cast<uint8_t>(cyl & 0x3u)];
+    return g.knock_count[static_cast<uint8_t>(cyl % kKnockCylinders)];
 }
 bool knock_test_window_active() noexcept { return g.window_active; }
 uint8_t knock_test_window_cyl() noexcept { return g.window_cyl; }
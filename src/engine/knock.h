@@ -2,15 +2,22 @@
 
 #include <cstdint>
 
+#include "engine/engine_config.h"
+
 namespace ems::engine {
 
-constexpr uint8_t kKnockCylinders = 4u;
+constexpr uint8_t kKnockCylinders = cfg::kCylinderCount;
+static_assert(kKnockCylinders <= 8u, "estado por cilindro dimensionado para ≤ 8");
 
 // Retardo por cilindro em graus x10 (ex.: 25 = 2.5 deg).
 // Contrato para leitura por engine/ign_calc.
 extern volatile uint16_t knock_retard_x10[kKnockCylinders];
 
+// O retardo reactivo arranca a 0: o que persiste entre partidas é o mapa
+// aprendido (engine/knock_learn), no knock_map 8×8 do NVM.
 void knock_init() noexcept;
+// Persiste já o mapa aprendido (knock_learn_save) — o flush segue o
+// rate-limit do setor adaptativo.
 void knock_save_to_nvm() noexcept;
 void knock_set_event_threshold(uint8_t threshold) noexcept;
 
@@ -24,24 +31,76 @@ uint16_t knock_get_adc_threshold() noexcept;
 void knock_window_open(uint8_t cyl) noexcept;
 void knock_window_close(uint8_t cyl) noexcept;
 
+// Chamado pelo ecu_sched (ISR do TIM5) no DWELL_START do cilindro: avalia a
+// janela anterior e abre a de cyl. Re-dwell do mesmo cilindro (multi-spark)
+// é ignorado.
+void knock_on_dwell_start(uint8_t cyl) noexcept;
+
+// Faísca do cilindro da janela: com knock_band_hz ≠ 0 (e o coeficiente já
+// recalculado por knock_process) pede a captura rápida do ADC
+// (hal::adc_knock_capture_start, não bloqueante) para o Goertzel em banda.
+// Uma captura por janela; termina sozinha após ~4 ms.
+void knock_window_spark(uint8_t cyl) noexcept;
+
 // Chamado por sample_fast_channels() (ISR de dente CKP) com a leitura ADC
 // do canal do sensor de knock (PA5/ADC1_IN6). Conta amostras acima do
 // threshold enquanto a janela estiver ativa.
 void knock_adc_update(uint16_t raw) noexcept;
 
-// Fecha o ciclo de combustao do cilindro e aplica algoritmo retard/recovery.
+// Fecha o ciclo de combustão do cilindro: latcha contagem / energia da
+// janela na fila para knock_process (ISR-safe, O(1)) e zera os acumuladores.
 void knock_cycle_complete(uint8_t cyl) noexcept;
 
+// Main loop (slot de 2 ms, antes de knock_learn_update): recalcula o
+// coeficiente do Goertzel quando knock_band_hz muda e avalia as janelas
+// latchadas — limiar/intensidade, retard/recovery, histórico e sensor morto.
+void knock_process() noexcept;
+
 // Fecha a janela corrente (se houver) e avalia o cilindro que estava aberto.
 // Chamado no ECU_ACT_DWELL_START do próximo cilindro (ISR-safe).
 void knock_window_cycle_end() noexcept;
 
 uint16_t knock_get_retard_x10(uint8_t cyl) noexcept;
 
+// Janelas avaliadas (com knock / limpas) desde a chamada anterior, todos os
+// cilindros; zera os contadores (saturam em 0xFFFF). Consumidor único:
+// knock_learn_update no main loop.
+void knock_take_window_counts(uint16_t* knocked, uint16_t* clean) noexcept;
+
+// Pico do raw ADC na última janela fechada do cilindro (0 = janela sem
+// amostras). Telemetria por ciclo (CAN FD) — independente do threshold.
+uint16_t knock_get_peak_raw(uint8_t cyl) noexcept;
+
 // Sensor morto (FOME #578): EMA do pico-a-pico por janela abaixo de
 // knock_dead_min_p2p durante ~100 janelas. false se detecção desligada (=0).
 bool knock_sensor_dead() noexcept;
 
+// Caminho DSP (knock_band_hz ≠ 0), valores da última janela do cilindro:
+// intensidade = amplitude em banda / ruído de fundo (Q8, 256 = 1.0×),
+// amplitude de pico do Goertzel (counts) e fundo EMA (counts).
+uint16_t knock_get_intensity_q8(uint8_t cyl) noexcept;
+uint16_t knock_get_band_amplitude(uint8_t cyl) noexcept;
+uint16_t knock_get_background(uint8_t cyl) noexcept;
+
+// ── Histórico de intensidade por cilindro (telemetria) ──────────────────────
+// Anel de kKnockHistoryLen entradas u8 por cilindro, uma por janela avaliada
+// (knock_process). Mesma escala nos dois caminhos de detecção:
+//   bit 7     = janela decidida como knock (retardo aplicado)
+//   bits 6..0 = intensidade relativa ao limiar de decisão, Q5
+//               (kKnockHistLevelLimit = no limiar, 127 = ≥ ~4×)
+// DSP: intensidade / (knock_intensity_thr_x10 / 10); contagem: amostras acima
+// do threshold / (event_threshold + 1). Knock ⇒ nível ≥ kKnockHistLevelLimit.
+constexpr uint8_t kKnockHistoryLen      = 16u;
+constexpr uint8_t kKnockHistKnockBit    = 0x80u;
+constexpr uint8_t kKnockHistLevelMask   = 0x7Fu;
+constexpr uint8_t kKnockHistLevelLimit  = 32u;
+
+// Copia as n (≤ kKnockHistoryLen) entradas mais recentes do cilindro, mais
+// antiga primeiro, e devolve o contador de janelas do cilindro (u8, wrap) —
+// o leitor deduplica entre leituras pela diferença. Entradas ainda não
+// escritas lêem 0. Main loop.
+uint8_t knock_history_read(uint8_t cyl, uint8_t* out, uint8_t n) noexcept;
+
 #if defined(EMS_HOST_TEST)
 uint8_t knock_test_get_knock_count(uint8_t cyl) noexcept;
 uint16_t knock_test_get_noise_p2p_ema() noexcept;
@@ -0,0 +1,63 @@
+/**
+ * @file engine/knock_dsp.cpp
+ * @brief Goertzel em ponto fixo para a energia em banda do knock (ver knock_dsp.h).
+ */
+
+#include "engine/knock_dsp.h"
+
+#include <cmath>
+
+namespace {
+
+uint32_t isqrt64(uint64_t v) noexcept {
+    uint64_t res = 0u;
+    uint64_t bit = 1ull << 62;
+    while (bit > v) { bit >>= 2; }
+    while (bit != 0u) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return static_cast<uint32_t>(res);
+}
+
+}  // namespace
+
+namespace ems::engine {
+
+int32_t knock_goertzel_coeff_q14(uint32_t f0_hz, uint32_t fs_hz) noexcept {
+    if (fs_hz == 0u) { return 0; }
+    constexpr float kTwoPi = 6.28318531f;
+    const float w = kTwoPi * static_cast<float>(f0_hz) / static_cast<float>(fs_hz);
+    const float c = 2.0f * std::cos(w) * 16384.0f;
+    if (c >= 32767.0f)  { return 32767; }
+    if (c <= -32768.0f) { return -32768; }
+    return static_cast<int32_t>(std::lround(c));
+}
+
+uint64_t knock_goertzel_energy(const uint16_t* x, uint16_t n,
+                               int32_t coeff_q14, int32_t dc) noexcept {
+    if (x == nullptr || n == 0u) { return 0u; }
+    int64_t s1 = 0;
+    int64_t s2 = 0;
+    for (uint16_t i = 0u; i < n; ++i) {
+        const int64_t s0 = static_cast<int64_t>(static_cast<int32_t>(x[i]) - dc) +
+                           ((coeff_q14 * s1) >> 14) - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    const int64_t e = s1 * s1 + s2 * s2 - (((coeff_q14 * s1) >> 14) * s2);
+    return (e > 0) ? static_cast<uint64_t>(e) : 0u;
+}
+
+uint16_t knock_goertzel_amplitude(uint64_t energy, uint16_t n) noexcept {
+    if (n == 0u) { return 0u; }
+    const uint32_t a = (2u * isqrt64(energy)) / n;
+    return (a > 0xFFFFu) ? 0xFFFFu : static_cast<uint16_t>(a);
+}
+
+}  // namespace ems::engine
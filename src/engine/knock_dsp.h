@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ems::engine {
+
+// ── Kernel de energia em banda (Goertzel, ponto fixo) ────────────────────────
+// Uma única bin DFT na frequência de ressonância do knock, por bloco de
+// amostras do ADC de knock (hal::adc_knock_capture_start → blocos de
+// kKnockDspBlock a ~96 kS/s). Custo: 1 MAC 32×32→64 por amostra; sem FFT,
+// sem tabela de janela (rectangular — a resolução fs/N ≈ 1.5 kHz já é mais
+// estreita que a banda típica da ressonância).
+//
+//   s[n] = (x[n] − dc) + c·s[n−1] − s[n−2]      c = 2·cos(2π·f0/fs), Q14
+//   E    = s1² + s2² − c·s1·s2                  = |X(f0)|²
+//   A    = 2·√E / N                             amplitude do tom (counts)
+//
+// Contexto: knock_goertzel_energy corre na ISR do GPDMA (um bloco por IRQ);
+// só inteiros. O coeficiente é calculado fora da ISR, quando a calibração
+// da frequência muda.
+
+constexpr uint16_t kKnockDspBlock = 64u;
+
+// 2·cos(2π·f0/fs) em Q14, saturado a [−32768, 32767]. fs == 0 → 0.
+int32_t knock_goertzel_coeff_q14(uint32_t f0_hz, uint32_t fs_hz) noexcept;
+
+// |X(f0)|² do bloco x[0..n) com o offset dc removido.
+uint64_t knock_goertzel_energy(const uint16_t* x, uint16_t n,
+                               int32_t coeff_q14, int32_t dc) noexcept;
+
+// Amplitude de pico (counts ADC) de um tom com energia E num bloco de n.
+uint16_t knock_goertzel_amplitude(uint64_t energy, uint16_t n) noexcept;
+
+}  // namespace ems::engine
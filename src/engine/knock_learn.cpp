@@ -0,0 +1,160 @@
+/**
+ * @file engine/knock_learn.cpp
+ * @brief Mapa aprendido de retardo de knock: crédito bilinear + NVM diferido.
+ */
+#include "engine/knock_learn.h"
+
+#include <cstdint>
+
+#include "engine/calibration.h"
+#include "engine/knock.h"
+#include "hal/flash.h"
+
+namespace {
+
+using ems::engine::kKnockLearnDim;
+using ems::engine::kKnockLearnNodes;
+
+constexpr uint8_t kN = kKnockLearnDim;
+
+// Células em °×10 Q16: o decaimento por janela limpa fica abaixo de 0.01°.
+int32_t g_cells_q16[kN][kN] = {};
+
+struct GridPoint {
+    uint8_t  xi;
+    uint8_t  yi;
+    uint16_t fx;   // 0…256
+    uint16_t fy;
+};
+
+int32_t max_q16() noexcept {
+    uint32_t m = ems::engine::knock_learn_max_x10;
+    if (m == 0u) { m = ems::engine::kKnockLearnMaxDefaultX10; }
+    if (m > ems::engine::kKnockLearnMaxLimitX10) { m = ems::engine::kKnockLearnMaxLimitX10; }
+    return static_cast<int32_t>(m << 16u);
+}
+
+int32_t round_x10(int32_t q16) noexcept {
+    return (q16 + 0x8000) >> 16;
+}
+
+// Eixos da grelha a partir dos vigentes (8 leituras; os eixos só mudam por
+// table_axes_set, no main loop como este módulo).
+GridPoint locate(uint32_t rpm_x10, uint16_t load_bar_x100) noexcept {
+    uint32_t rpm_axis[kN];
+    uint32_t load_axis[kN];
+    for (uint8_t i = 0u; i < kN; ++i) {
+        rpm_axis[i] = ems::engine::kRpmAxisX10[kKnockLearnNodes[i]];
+        load_axis[i] = ems::engine::kLoadAxisBarX100[kKnockLearnNodes[i]];
+    }
+    GridPoint p{};
+    p.xi = ems::engine::table_axis_index(rpm_axis, kN, rpm_x10);
+    p.yi = ems::engine::table_axis_index(load_axis, kN, load_bar_x100);
+    const uint8_t fx = ems::engine::table_axis_frac_q8(rpm_axis, p.xi, rpm_x10);
+    const uint8_t fy = ems::engine::table_axis_frac_q8(load_axis, p.yi, load_bar_x100);
+    // 255 = nó alto exacto (convenção de table3d).
+    p.fx = (fx == 255u) ? 256u : fx;
+    p.fy = (fy == 255u) ? 256u : fy;
+    return p;
+}
+
+void persist_cell(uint8_t yi, uint8_t xi, bool force) noexcept {
+    const int32_t now = round_x10(g_cells_q16[yi][xi]);
+    const int32_t stored = ems::hal::nvm_read_knock(xi, yi);
+    const int32_t diff = (now > stored) ? (now - stored) : (stored - now);
+    if (diff == 0) { return; }
+    if (force || diff >= ems::engine::kKnockLearnPersistDeltaX10 || now == 0) {
+        (void)ems::hal::nvm_write_knock(xi, yi, static_cast<int8_t>(now));
+    }
+}
+
+}  // namespace
+
+namespace ems::engine {
+
+void knock_learn_init() noexcept {
+    const int32_t lim = static_cast<int32_t>(kKnockLearnMaxLimitX10) << 16u;
+    for (uint8_t y = 0u; y < kN; ++y) {
+        for (uint8_t x = 0u; x < kN; ++x) {
+            const int8_t stored = ems::hal::nvm_read_knock(x, y);
+            const int32_t v = (stored > 0) ? (static_cast<int32_t>(stored) << 16u) : 0;
+            g_cells_q16[y][x] = (v > lim) ? lim : v;
+        }
+    }
+}
+
+void knock_learn_reset() noexcept {
+    for (uint8_t y = 0u; y < kN; ++y) {
+        for (uint8_t x = 0u; x < kN; ++x) { g_cells_q16[y][x] = 0; }
+    }
+    ems::hal::nvm_reset_knock_map();
+}
+
+void knock_learn_update(uint32_t rpm_x10, uint16_t load_bar_x100, bool learn) noexcept {
+    uint16_t knocked = 0u;
+    uint16_t clean = 0u;
+    knock_take_window_counts(&knocked, &clean);
+    if (!learn || knock_learn_step_x10 == 0u || (knocked == 0u && clean == 0u)) {
+        return;
+    }
+    const GridPoint p = locate(rpm_x10, load_bar_x100);
+    const int64_t credit = static_cast<int64_t>(knocked) * knock_learn_step_x10;
+    const int64_t decay = static_cast<int64_t>(clean) * kKnockLearnDecayQ16;
+    const int32_t lim = max_q16();
+    const uint32_t wx[2] = {256u - p.fx, p.fx};
+    const uint32_t wy[2] = {256u - p.fy, p.fy};
+    for (uint8_t dy = 0u; dy < 2u; ++dy) {
+        for (uint8_t dx = 0u; dx < 2u; ++dx) {
+            const int64_t w = static_cast<int64_t>(wx[dx] * wy[dy]);   // Q16, Σ = 1
+            if (w == 0) { continue; }
+            const uint8_t y = static_cast<uint8_t>(p.yi + dy);
+            const uint8_t x = static_cast<uint8_t>(p.xi + dx);
+            int64_t v = static_cast<int64_t>(g_cells_q16[y][x]) + credit * w - ((decay * w) >> 16);
+            if (v < 0) { v = 0; }
+            if (v > lim) { v = lim; }
+            g_cells_q16[y][x] = static_cast<int32_t>(v);
+            persist_cell(y, x, false);
+        }
+    }
+}
+
+uint16_t knock_learn_retard_x10_at(uint32_t rpm_x10, uint16_t load_bar_x100) noexcept {
+    if (knock_learn_step_x10 == 0u) { return 0u; }
+    const GridPoint p = locate(rpm_x10, load_bar_x100);
+    const int64_t c00 = g_cells_q16[p.yi][p.xi];
+    const int64_t c10 = g_cells_q16[p.yi][p.xi + 1u];
+    const int64_t c01 = g_cells_q16[p.yi + 1u][p.xi];
+    const int64_t c11 = g_cells_q16[p.yi + 1u][p.xi + 1u];
+    const int64_t r0 = c00 * (256 - p.fx) + c10 * p.fx;
+    const int64_t r1 = c01 * (256 - p.fx) + c11 * p.fx;
+    const int64_t v = (r0 * (256 - p.fy) + r1 * p.fy) >> 16;   // °×10 Q16
+    return static_cast<uint16_t>(round_x10(static_cast<int32_t>(v)));
+}
+
+uint16_t knock_learn_cell_x10(uint8_t load_i, uint8_t rpm_i) noexcept {
+    if (load_i >= kN || rpm_i >= kN) { return 0u; }
+    return static_cast<uint16_t>(round_x10(g_cells_q16[load_i][rpm_i]));
+}
+
+void knock_learn_save() noexcept {
+    for (uint8_t y = 0u; y < kN; ++y) {
+        for (uint8_t x = 0u; x < kN; ++x) { persist_cell(y, x, true); }
+    }
+}
+
+const int32_t* knock_learn_cells() noexcept {
+    return &g_cells_q16[0][0];
+}
+
+void knock_learn_replace_map(const int32_t* cells) noexcept {
+    const int32_t lim = max_q16();
+    for (uint8_t y = 0u; y < kN; ++y) {
+        for (uint8_t x = 0u; x < kN; ++x) {
+            const int32_t v = cells[y * kN + x];
+            g_cells_q16[y][x] = (v < 0) ? 0 : ((v > lim) ? lim : v);
+        }
+    }
+    knock_learn_save();
+}
+
+}  // namespace ems::engine
@@ -0,0 +1,76 @@
+#pragma once
+
+/**
+ * @file engine/knock_learn.h
+ * @brief Mapa aprendido de retardo de knock (RPM × carga, 8×8).
+ *
+ * O retardo reactivo de knock.cpp (+2° por evento, −0.1° por ciclo limpo,
+ * por cilindro) corrige depois do facto e oscila no mesmo ponto de operação
+ * a cada passagem. Este mapa guarda ONDE o motor detona e aplica esse
+ * retardo antes do primeiro evento:
+ *
+ *   crédito   — a cada slot de 2 ms as janelas fechadas desde o slot
+ *               anterior (knock_take_window_counts) são creditadas às 4
+ *               células vizinhas do ponto (rpm, carga), com os pesos
+ *               bilineares: knock → +knock_learn_step_x10 × peso; janela
+ *               limpa → −kKnockLearnDecayQ16 × peso (≈ 1° por 1000 janelas
+ *               com peso total). Limitado a [0, knock_learn_max_x10].
+ *   aplicação — interpolação bilinear no mesmo (rpm, carga) do spark_table;
+ *               entra como knock_retard_deg de calc_total_advance, igual
+ *               para todos os cilindros (o reactivo continua por cilindro).
+ *   NVM       — o knock_map 8×8 do setor adaptativo (0.1°/count). Uma célula
+ *               só vai ao shadow quando se afasta ≥ kKnockLearnPersistDeltaX10
+ *               do valor gravado (ou volta a 0): o crédito fino corre em RAM
+ *               e o journal só vê mudanças que importam.
+ *
+ * Grelha: kKnockLearnNodes escolhe 8 dos 20 nós dos eixos principais, por
+ * isso o mapa segue table_axes_set; o re-eixo em runtime (table_reaxis)
+ * re-amostra-o junto com VE/avanço/LTFT.
+ *
+ * knock_learn_step_x10 = 0 (blob antigo) desliga crédito e aplicação.
+ */
+
+#include <cstdint>
+
+#include "engine/table3d.h"
+
+namespace ems::engine {
+
+constexpr uint8_t  kKnockLearnDim   = 8u;   // = knock_map 8×8 do NVM
+constexpr uint16_t kKnockLearnCells = static_cast<uint16_t>(kKnockLearnDim) * kKnockLearnDim;
+// Nós dos eixos principais usados pela grelha (round(k × 19 / 7)).
+inline constexpr uint8_t kKnockLearnNodes[kKnockLearnDim] = {0u, 3u, 5u, 8u, 11u, 14u, 16u, 19u};
+static_assert(kKnockLearnNodes[kKnockLearnDim - 1u] == kTableAxisSize - 1u,
+              "grelha do knock aprendido cobre os eixos inteiros");
+
+constexpr int32_t  kKnockLearnDecayQ16        = 655;  // 0.01 (°×10) por janela limpa
+constexpr uint8_t  kKnockLearnPersistDeltaX10 = 5u;   // 0.5°
+constexpr uint8_t  kKnockLearnMaxDefaultX10   = 60u;  // 6° (knock_learn_max_x10 = 0)
+constexpr uint8_t  kKnockLearnMaxLimitX10     = 127u; // int8 do NVM
+
+// Carrega o mapa do shadow NVM (boot, depois de nvm_load_adaptive_maps).
+void knock_learn_init() noexcept;
+// Zera RAM e knock_map do NVM.
+void knock_learn_reset() noexcept;
+
+// Slot de 2 ms: drena os contadores de janelas do knock.cpp e, com learn,
+// credita-os ao ponto (rpm, carga) — a carga em que o spark_table foi lido
+// para essas faíscas, a mesma de knock_learn_retard_x10_at. learn=false só descarta (cranking,
+// presync — janelas sem ponto de operação fiável).
+void knock_learn_update(uint32_t rpm_x10, uint16_t load_bar_x100, bool learn) noexcept;
+
+// Retardo aprendido interpolado no ponto (°×10); 0 com o mapa desligado.
+uint16_t knock_learn_retard_x10_at(uint32_t rpm_x10, uint16_t load_bar_x100) noexcept;
+
+// Célula em °×10 (arredondada), row-major [load][rpm].
+uint16_t knock_learn_cell_x10(uint8_t load_i, uint8_t rpm_i) noexcept;
+
+// Grava no shadow todas as células que diferem do valor persistido.
+void knock_learn_save() noexcept;
+
+// Re-eixo (engine/table_reaxis): células Q16 de °×10, row-major [load][rpm];
+// replace aplica o mesmo clamp do crédito e persiste o mapa inteiro.
+const int32_t* knock_learn_cells() noexcept;
+void knock_learn_replace_map(const int32_t* cells) noexcept;
+
+}  // namespace ems::engine
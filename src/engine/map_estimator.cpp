@@ -1,5 +1,6 @@
 #include "engine/map_estimator.h"
 #include "engine/math_utils.h"
+#include "engine/calibration.h"
 #include "engine/engine_config.h"
 #include "engine/fuel_calc.h"
 
@@ -38,6 +39,27 @@ uint8_t g_transient_gain_q8 = 64u; // 0.25 (25% sensor, 75% modelo em transiente
 // ciclos e o modelo nunca contribui. Mesma técnica de DDA/Bresenham.
 int32_t g_map_delta_remainder_q8 = 0;
 
+// dP/dt do modelo em regime (bar_x100/s), EMA 1/16 só com sensor válido,
+// TPS parado e MAP assente: desvio estático do modelo face ao motor real. A
+// predição integra (modelo − bias), pelo que em regime prevê o MAP actual.
+// MAP lento (EMA 1/16, Q4) distingue "TPS parado" de "coletor já cheio" —
+// o enchimento após um tip-in dura ~100 ms com tpsdot já a 0.
+int32_t g_dpdt_bias_x100_per_s = 0;
+int32_t g_map_slow_q4 = 0;
+constexpr int32_t kMapSettledQ4 = 24;  // ±1.5 bar_x100
+
+// TPSdot do mesmo ring SEM o clamp de ±100 %/s do AE/anti-jerk: um snap de
+// pedal real passa de 1000 %/s e a rampa da predição precisa da taxa real.
+int32_t g_tpsdot_raw_x10 = 0;
+
+// Predição ao IVC: passos de Euler por horizonte e horizonte máximo (ralenti
+// com injecção closed-valve ≈ 640° → ~100 ms; acima disso a extrapolação do
+// tpsdot deixa de ter significado).
+constexpr uint32_t kPredSteps        = 8u;
+constexpr uint32_t kPredMaxHorizonUs = 100000u;
+// Idade média do PW comitado no slot de 2 ms quando o scheduler o consome.
+constexpr uint32_t kPredCommitLatencyUs = 1000u;
+
 // Baro for throttle ΔP: fuel_get_baro_bar_x100() each update (default 100).
 
 // Limites de detecção de transiente
@@ -104,6 +126,22 @@ uint16_t calc_engine_pumping_impl(uint32_t rpm_x10, uint16_t map_bar_x100,
     return static_cast<uint16_t>(clamp_u32(flow_mg, 0u, 2000u));
 }
 
+// dP/dt (bar_x100 por segundo) do modelo de continuidade num ponto.
+// kDpDtScaleX100PerSec calibra a magnitude para ~20 bar/s no diferencial de
+// fluxo máximo com o coletor de referência (500cc).
+int32_t model_dpdt_x100_per_s(uint16_t tps_pct_x10, uint16_t map_bar_x100,
+                              uint32_t rpm_x10, int16_t iat_x10,
+                              uint16_t baro_bar_x100) noexcept {
+    constexpr int64_t kDpDtScaleX100PerSec = 5000;
+    const uint16_t flow_in_mg = calc_throttle_flow_impl(
+        tps_pct_x10, map_bar_x100, iat_x10, baro_bar_x100);
+    const uint16_t flow_out_mg = calc_engine_pumping_impl(rpm_x10, map_bar_x100, iat_x10);
+    const int32_t delta_flow_mg = static_cast<int32_t>(flow_in_mg) -
+                                  static_cast<int32_t>(flow_out_mg);
+    return static_cast<int32_t>((static_cast<int64_t>(delta_flow_mg) * kDpDtScaleX100PerSec) /
+                                static_cast<int64_t>(g_model_params.volume_cc_x10));
+}
+
 int16_t calculate_tpsdot() noexcept {
     // Calcula derivada usando diferença entre amostra mais recente e a mais
     // antiga ainda residente no buffer circular. g_tps_history_pos aponta
@@ -114,6 +152,7 @@ int16_t calculate_tpsdot() noexcept {
     const uint8_t newest_pos = static_cast<uint8_t>(
         (g_tps_history_pos + kTpsHistorySize - 1u) % kTpsHistorySize);
 
+    g_tpsdot_raw_x10 = 0;
     if (!g_tps_time_history[oldest_pos] || !g_tps_time_history[newest_pos]) {
         return 0;
     }
@@ -130,6 +169,7 @@ int16_t calculate_tpsdot() noexcept {
     
     // TPSdot em %/s × 10 = (delta_tps_x10 * 1000) / dt_ms
     const int32_t tpsdot_x10 = (delta_tps_x10 * 1000) / static_cast<int32_t>(dt_ms);
+    g_tpsdot_raw_x10 = tpsdot_x10;
     
     return clamp_i16(static_cast<int16_t>(tpsdot_x10), -1000, 1000);
 }
@@ -169,6 +209,9 @@ void map_estimator_init() noexcept {
     g_tps_history_pos = 0u;
     g_tps_time_ms = 0u;
     g_map_delta_remainder_q8 = 0;
+    g_dpdt_bias_x100_per_s = 0;
+    g_map_slow_q4 = 0;
+    g_tpsdot_raw_x10 = 0;
 
     g_steady_gain_q8 = 200u;
     g_transient_gain_q8 = 64u;
@@ -222,18 +265,19 @@ uint16_t map_estimator_update(uint16_t map_sensor_bar_x100,
     // Modelo termodinâmico de continuidade: dP/dt ∝ (fluxo_admissão - fluxo_motor) / VolumeColetor
     // Baro from fuel barometric compensation (key-on MAP / cal).
     const uint16_t baro = fuel_get_baro_bar_x100();
-    const uint16_t flow_in_mg = calc_throttle_flow_impl(
-        tps_pct_x10, g_map_state.map_estimated_bar_x100, iat_x10, baro);
-    const uint16_t flow_out_mg = calc_engine_pumping_impl(
-        rpm_x10, g_map_state.map_estimated_bar_x100, iat_x10);
-    const int32_t delta_flow_mg = static_cast<int32_t>(flow_in_mg) -
-                                  static_cast<int32_t>(flow_out_mg);
-
-    // dP/dt (bar_x100 por segundo). kDpDtScaleX100PerSec calibra a magnitude para
-    // ~20 bar/s no diferencial de fluxo máximo com o coletor de referência (500cc).
-    constexpr int64_t kDpDtScaleX100PerSec = 5000;
-    const int64_t dpdt_x100_per_s = (static_cast<int64_t>(delta_flow_mg) * kDpDtScaleX100PerSec) /
-                                    static_cast<int64_t>(g_model_params.volume_cc_x10);
+    const int64_t dpdt_x100_per_s = model_dpdt_x100_per_s(
+        tps_pct_x10, g_map_state.map_estimated_bar_x100, rpm_x10, iat_x10, baro);
+    if (sensor_ok) {
+        const int32_t map_q4 = static_cast<int32_t>(map_sensor_bar_x100) << 4;
+        if (g_map_slow_q4 == 0) { g_map_slow_q4 = map_q4; }
+        g_map_slow_q4 += (map_q4 - g_map_slow_q4) / 16;
+        const int32_t dev_q4 = map_q4 - g_map_slow_q4;
+        const bool settled = (dev_q4 <= kMapSettledQ4) && (dev_q4 >= -kMapSettledQ4);
+        if (settled && g_map_state.transient_strength == 0u) {
+            g_dpdt_bias_x100_per_s += (static_cast<int32_t>(dpdt_x100_per_s) -
+                                       g_dpdt_bias_x100_per_s) / 16;
+        }
+    }
 
     // Acumula em Q8 e extrai só a parte inteira, preservando a fração entre
     // chamadas (carry), para não perder incrementos sub-unitários em loops rápidos.
@@ -276,6 +320,143 @@ uint16_t map_estimator_update(uint16_t map_sensor_bar_x100,
     return g_map_state.map_estimated_bar_x100;
 }
 
+namespace {
+
+// Trajectória de Euler até horizon_us: p_q8[i] = MAP (Q8) ao fim do passo i
+// (p_q8[0] = agora). Partilhada pela predição escalar e pela por cilindro.
+void predict_trajectory(uint16_t map_now_bar_x100,
+                        uint16_t tps_pct_x10,
+                        int16_t tpsdot_x10,
+                        uint32_t rpm_x10,
+                        int16_t iat_x10,
+                        uint32_t horizon_us,
+                        int32_t* p_q8_out) noexcept {
+    const uint16_t baro = ems::engine::fuel_get_baro_bar_x100();
+    const int32_t step_us = static_cast<int32_t>(horizon_us / kPredSteps);
+
+    // Euler em Q8 (bar_x100 × 256); TPS avaliado a meio de cada passo na
+    // rampa tps + tpsdot·t (tpsdot_x10 = décimas de % por segundo).
+    int32_t p_q8 = static_cast<int32_t>(clamp_u16(map_now_bar_x100, 10u, 300u)) << 8;
+    p_q8_out[0] = p_q8;
+    for (uint32_t i = 0u; i < kPredSteps; ++i) {
+        const int32_t t_mid_us = step_us * static_cast<int32_t>(i) + step_us / 2;
+        int32_t tps = static_cast<int32_t>(tps_pct_x10) +
+                      static_cast<int32_t>((static_cast<int64_t>(tpsdot_x10) * t_mid_us) / 1000000);
+        if (tps < 0) { tps = 0; }
+        if (tps > 1000) { tps = 1000; }
+        const uint16_t p = clamp_u16(static_cast<uint16_t>(p_q8 >> 8), 10u, 300u);
+        const int32_t dpdt = model_dpdt_x100_per_s(static_cast<uint16_t>(tps), p,
+                                                   rpm_x10, iat_x10, baro) -
+                             g_dpdt_bias_x100_per_s;
+        p_q8 += static_cast<int32_t>((static_cast<int64_t>(dpdt) * step_us * 256) / 1000000);
+        if (p_q8 < (10 << 8)) { p_q8 = 10 << 8; }
+        if (p_q8 > (300 << 8)) { p_q8 = 300 << 8; }
+        p_q8_out[i + 1u] = p_q8;
+    }
+}
+
+uint16_t blend_pred(uint16_t map_now_bar_x100, uint16_t pred, uint8_t gain) noexcept {
+    const int32_t blended = static_cast<int32_t>(map_now_bar_x100) +
+        (static_cast<int32_t>(pred) - static_cast<int32_t>(map_now_bar_x100)) *
+        static_cast<int32_t>(gain) / 100;
+    return static_cast<uint16_t>(blended);
+}
+
+}  // namespace
+
+uint16_t map_estimator_predict(uint16_t map_now_bar_x100,
+                               uint16_t tps_pct_x10,
+                               int16_t tpsdot_x10,
+                               uint32_t rpm_x10,
+                               int16_t iat_x10,
+                               uint32_t horizon_us) noexcept {
+    if (horizon_us == 0u) {
+        return map_now_bar_x100;
+    }
+    if (horizon_us > kPredMaxHorizonUs) {
+        horizon_us = kPredMaxHorizonUs;
+    }
+    int32_t p_q8[kPredSteps + 1u];
+    predict_trajectory(map_now_bar_x100, tps_pct_x10, tpsdot_x10, rpm_x10, iat_x10,
+                       horizon_us, p_q8);
+    return static_cast<uint16_t>((p_q8[kPredSteps] + 128) >> 8);
+}
+
+void map_pred_horizon_cyl_us(uint32_t rpm_x10, uint16_t engine_deg,
+                             uint16_t eoi_lead_deg, uint32_t pw_us,
+                             uint32_t* horizon_us) noexcept {
+    if (rpm_x10 < 500u) {
+        for (uint8_t cyl = 0u; cyl < cfg::kCylinderCount; ++cyl) { horizon_us[cyl] = 0u; }
+        return;
+    }
+    const uint32_t eoi = (eoi_lead_deg > 719u) ? 719u : eoi_lead_deg;
+    const uint32_t ivc = (map_pred_ivc_btdc_deg > 719u) ? 719u : map_pred_ivc_btdc_deg;
+    const uint32_t eoi_to_ivc_deg = (eoi + 720u - ivc) % 720u;
+    const uint32_t now_deg = engine_deg % 720u;
+    // µs por grau em Q8: 10⁷·256 / (6·rpm_x10) — uma divisão para todos
+    // (rpm_x10 ≥ 500 → ≤ 853334; × 1440° cabe em 32 bits).
+    const uint32_t us_per_deg_q8 = 2560000000u / (6u * rpm_x10);
+    const uint32_t need_us = kPredCommitLatencyUs + pw_us;
+    for (uint8_t cyl = 0u; cyl < cfg::kCylinderCount; ++cyl) {
+        const uint32_t eoi_abs = (cfg::cyl_tdc_deg(cyl) + 720u - eoi) % 720u;
+        uint32_t to_eoi_deg = (eoi_abs + 720u - now_deg) % 720u;
+        // SOI deste cilindro já passou (ou chega antes do commit ser lido):
+        // este PW serve o ciclo seguinte.
+        if (((to_eoi_deg * us_per_deg_q8) >> 8u) < need_us) { to_eoi_deg += 720u; }
+        const uint32_t h = ((to_eoi_deg + eoi_to_ivc_deg) * us_per_deg_q8) >> 8u;
+        horizon_us[cyl] = (h > kPredMaxHorizonUs) ? kPredMaxHorizonUs : h;
+    }
+}
+
+uint16_t map_estimator_predict_ivc_cyl(uint16_t map_now_bar_x100,
+                                       uint16_t tps_pct_x10,
+                                       uint32_t rpm_x10,
+                                       int16_t iat_x10,
+                                       uint16_t engine_deg,
+                                       uint16_t eoi_lead_deg,
+                                       uint32_t pw_us,
+                                       uint16_t* map_ivc_bar_x100) noexcept {
+    const uint8_t gain = (map_pred_gain_pct > 100u) ? 100u : map_pred_gain_pct;
+    uint32_t h[cfg::kCylinderCount] = {};
+    if (gain != 0u) {
+        map_pred_horizon_cyl_us(rpm_x10, engine_deg, eoi_lead_deg, pw_us, h);
+    }
+    uint32_t h_max = 0u;
+    uint8_t next = 0u;
+    for (uint8_t cyl = 0u; cyl < cfg::kCylinderCount; ++cyl) {
+        if (h[cyl] > h_max) { h_max = h[cyl]; }
+        if (h[cyl] < h[next]) { next = cyl; }
+    }
+    if (h_max == 0u) {
+        for (uint8_t cyl = 0u; cyl < cfg::kCylinderCount; ++cyl) {
+            map_ivc_bar_x100[cyl] = map_now_bar_x100;
+        }
+        return map_now_bar_x100;
+    }
+    // Uma só trajectória até ao IVC mais distante; cada cilindro interpola
+    // linearmente entre os passos que rodeiam o seu horizonte.
+    int32_t p_q8[kPredSteps + 1u];
+    predict_trajectory(map_now_bar_x100, tps_pct_x10,
+                       clamp_i16(g_tpsdot_raw_x10, -20000, 20000),
+                       rpm_x10, iat_x10, h_max, p_q8);
+    // Posição na trajectória em passos Q8 = h · (8·256/h_max), recíproco
+    // feito uma vez (8·2²⁴/h_max) — por cilindro só multiplicações.
+    const uint32_t steps_per_us_q24 = (kPredSteps << 24u) / h_max;
+    for (uint8_t cyl = 0u; cyl < cfg::kCylinderCount; ++cyl) {
+        const uint32_t pos_q8 = static_cast<uint32_t>(
+            (static_cast<uint64_t>(h[cyl]) * steps_per_us_q24) >> 16u);
+        const uint32_t i = pos_q8 >> 8u;
+        int32_t q8 = p_q8[kPredSteps];
+        if (i < kPredSteps) {
+            const int32_t frac = static_cast<int32_t>(pos_q8 & 0xFFu);
+            q8 = p_q8[i] + (((p_q8[i + 1u] - p_q8[i]) * frac) >> 8);
+        }
+        const uint16_t pred = static_cast<uint16_t>((q8 + 128) >> 8);
+        map_ivc_bar_x100[cyl] = blend_pred(map_now_bar_x100, pred, gain);
+    }
+    return map_ivc_bar_x100[next];
+}
+
 uint16_t map_get_estimated_bar_x100() noexcept {
     return g_map_state.map_estimated_bar_x100;
 }
@@ -34,6 +34,41 @@ uint16_t map_estimator_update(uint16_t map_sensor_bar_x100,
                               int16_t iat_x10,
                               bool sensor_valid = true) noexcept;
 
+// Extrapola o MAP horizon_us à frente integrando o mesmo modelo de
+// continuidade (8 passos de Euler), com o TPS em rampa tps + tpsdot·t
+// (limitado a 0-100%). O dP/dt estático aprendido em regime é descontado:
+// sem transiente devolve ≈ map_now. Horizonte limitado a 100 ms.
+uint16_t map_estimator_predict(uint16_t map_now_bar_x100,
+                               uint16_t tps_pct_x10,
+                               int16_t tpsdot_x10,
+                               uint32_t rpm_x10,
+                               int16_t iat_x10,
+                               uint32_t horizon_us) noexcept;
+
+// Horizonte por cilindro (índice físico): agora (engine_deg, ° do ciclo de
+// 720° desde o PMS do cil. 0) → próximo EOI do cilindro (cyl_tdc_deg −
+// eoi_lead_deg) → IVC que esse combustível encontra. EOI a menos de
+// latência do slot + PW já não recebe este commit → +720°. 0 abaixo de
+// 50 RPM; limite 100 ms.
+void map_pred_horizon_cyl_us(uint32_t rpm_x10, uint16_t engine_deg,
+                             uint16_t eoi_lead_deg, uint32_t pw_us,
+                             uint32_t* horizon_us) noexcept;
+
+// MAP para o PW no commit, por cilindro: map_now + map_pred_gain_pct ×
+// (MAP previsto ao IVC do cilindro − map_now), com o tpsdot da última update
+// (sem o clamp de ±100 %/s de map_get_tpsdot_x10). Uma só trajectória até ao
+// horizonte maior, amostrada por cilindro em map_ivc_bar_x100[kCylinderCount].
+// Devolve o do próximo cilindro servido (horizonte menor) — carga do lookup
+// VE/λ do slot. gain 0 → map_now em todos.
+uint16_t map_estimator_predict_ivc_cyl(uint16_t map_now_bar_x100,
+                                       uint16_t tps_pct_x10,
+                                       uint32_t rpm_x10,
+                                       int16_t iat_x10,
+                                       uint16_t engine_deg,
+                                       uint16_t eoi_lead_deg,
+                                       uint32_t pw_us,
+                                       uint16_t* map_ivc_bar_x100) noexcept;
+
 // Sync displacement from engine_config into model (call after NVM load / page0).
 void map_estimator_sync_engine_config() noexcept;
 
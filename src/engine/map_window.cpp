@@ -1,14 +1,16 @@
 #include "engine/map_window.h"
 #include "engine/calibration.h"
+#include "engine/engine_config.h"
 
 namespace ems::engine {
 
 namespace {
 
-constexpr uint8_t  kSlots        = 4u;
-constexpr uint16_t kSlotSpanDeg  = 180u;
+// Um slot por posição de disparo; o slot k começa em cfg::kFiringTdc.deg[k]
+// (even-fire: k·720/N — 4 cil: 0/180/360/540).
+constexpr uint8_t  kSlots        = cfg::kCylinderCount;
+constexpr uint8_t  kAllSlotsMask = static_cast<uint8_t>((1u << kSlots) - 1u);
 constexpr uint16_t kCycleDeg     = 720u;
-constexpr uint16_t kDegPerTooth  = 6u;
 
 // Acumulador da janela activa (uma de cada vez — as janelas não se sobrepõem).
 uint32_t g_acc = 0u;
@@ -32,10 +34,10 @@ void close_active_window() noexcept {
     }
     g_slot_bar_x1000[slot] = static_cast<uint16_t>(g_acc / g_cnt);
     g_fresh_mask = static_cast<uint8_t>(g_fresh_mask | (1u << slot));
-    if (g_fresh_mask != 0x0Fu) {
+    if (g_fresh_mask != kAllSlotsMask) {
         return;
     }
-    // Ciclo completo: média dos 4 e EMA do desvio por slot.
+    // Ciclo completo: média dos N e EMA do desvio por slot.
     g_fresh_mask = 0u;
     ++g_cycles;
     uint32_t sum = 0u;
@@ -64,16 +66,22 @@ void map_window_on_tooth(const ems::drv::CkpSnapshot& snap,
         return;
     }
     const uint16_t deg = static_cast<uint16_t>(
-        snap.tooth_index * kDegPerTooth + (snap.phase_A ? 0u : 360u));
+        ems::drv::ckp_wheel().tooth_deg_x10[snap.tooth_index] / 10u +
+        (snap.phase_A ? 0u : 360u));
     uint16_t rel = static_cast<uint16_t>(deg + kCycleDeg - map_window_open_deg);
     if (rel >= kCycleDeg) {
         rel = static_cast<uint16_t>(rel - kCycleDeg);
     }
-    const uint8_t  slot = static_cast<uint8_t>(rel / kSlotSpanDeg);
-    const uint16_t off  = static_cast<uint16_t>(rel % kSlotSpanDeg);
+    // Último slot cujo início ≤ rel (deg[0] = 0 garante slot válido); a janela
+    // fica limitada ao intervalo até ao próximo TDC mesmo com len maior.
+    uint8_t slot = static_cast<uint8_t>(kSlots - 1u);
+    while (slot > 0u && cfg::kFiringTdc.deg[slot] > rel) {
+        --slot;
+    }
+    const uint16_t off = static_cast<uint16_t>(rel - cfg::kFiringTdc.deg[slot]);
     if (off < map_window_len_deg) {
         if (g_active_slot != static_cast<int8_t>(slot)) {
-            // Fecha a anterior (janelas adjacentes com len=180) e abre esta.
+            // Fecha a anterior (janelas adjacentes com len=span) e abre esta.
             close_active_window();
             g_active_slot = static_cast<int8_t>(slot);
             g_acc = 0u;
@@ -32,6 +32,12 @@ inline uint32_t clamp_u32(uint32_t v, uint32_t lo, uint32_t hi) noexcept {
     return v;
 }
 
+// a × q (Q15) → a·q/2^15, arredondado a −∞. Produto em 64 bits (SMULL no M33,
+// sem divisão de biblioteca); |a| ≤ 2^31, |q| ≤ 2^15.
+inline int32_t mul_q15(int32_t a, int32_t q) noexcept {
+    return static_cast<int32_t>((static_cast<int64_t>(a) * q) >> 15);
+}
+
 inline uint16_t interp_u16_8pt_u16x(const uint16_t* x_axis,
                                      const uint16_t* table,
                                      uint8_t n,
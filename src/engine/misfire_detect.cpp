@@ -1,8 +1,10 @@
 #include "engine/misfire_detect.h"
+#include "engine/calibration.h"
 #include "engine/engine_config.h"
 #include "engine/constants.h"
 #include "engine/ecu_sched.h"
 #include "drv/ckp.h"
+#include "hal/critical_section.h"
 
 #include <cstdint>
 #include <cstring>
@@ -11,10 +13,10 @@ namespace {
 
 using ems::drv::SyncState;
 
-// Posição TDC de cada cilindro na roda fônica 60-2.
+// Posição TDC de cada cilindro na roda fônica (drv/trigger_wheel.h).
 // Calculado via kFiringOrder em misfire_init().
 struct CylTdcPos {
-    uint8_t tdc_tooth;  // tooth_index do TDC (0 ou 30 para motor 4-cil / 60-2)
+    uint8_t tdc_tooth;  // tooth_index do TDC (4-cil / 60-2: 0 ou 30)
     bool    phase_A;    // qual revolução do ciclo de 4 tempos
 };
 
@@ -24,7 +26,7 @@ static CylTdcPos g_cyl_tdc[ems::engine::cfg::kCylinderCount];
 // Permite saída O(1) no ISR do CKP sem varrer todos os cilindros por dente.
 // IMPORTANTE: preenchida em misfire_init(), que DEVE ser chamada antes de habilitar
 // o ISR do CKP — BSS é zero, e 0 é um índice de cilindro válido.
-static int8_t g_tooth_to_cyl[2][ems::engine::kRealTeeth60_2];
+static int8_t g_tooth_to_cyl[2][ems::drv::kTriggerMaxTeeth];
 
 // Acumuladores por cilindro (escritos apenas no ISR do CKP → volatile).
 static volatile uint32_t g_power_sum_ns[ems::engine::cfg::kCylinderCount];
@@ -32,6 +34,10 @@ static volatile uint32_t g_pred_sum_ns[ems::engine::cfg::kCylinderCount];
 static volatile uint8_t  g_power_teeth[ems::engine::cfg::kCylinderCount];
 static volatile uint8_t  g_debounce[ems::engine::cfg::kCylinderCount];
 
+// Somas da última janela completa (latch no fecho) — telemetria por ciclo.
+static volatile uint32_t g_last_power_sum_ns[ems::engine::cfg::kCylinderCount];
+static volatile uint32_t g_last_pred_sum_ns[ems::engine::cfg::kCylinderCount];
+
 // Contadores de eventos lidos pelo main loop (uint8_t = atômico em ARM Cortex-M).
 static volatile uint8_t  g_event_count[ems::engine::cfg::kCylinderCount];
 
@@ -41,6 +47,178 @@ static volatile bool g_all_inhibit = false;
 
 constexpr uint8_t kN = ems::engine::cfg::kCylinderCount;
 
+// ── Cinemática: ISR → anel → main loop ───────────────────────────────────────
+// Flags da janela (OR dos dentes): sem combustão esperada (inibição global:
+// decel cut / cranking / flood) ou faísca do cilindro cortada.
+constexpr uint8_t kSegNoCombustion = 0x01u;
+constexpr uint8_t kSegSparkCut     = 0x02u;
+
+struct MisfireSeg {
+    uint32_t seg_ns;     // soma dos períodos da janela
+    uint32_t cycle_ns;   // fecho anterior do mesmo cilindro → este (720°); 0 = n/d
+    uint8_t  cyl;
+    uint8_t  flags;
+};
+
+static volatile uint8_t  g_win_flags[kN];
+static volatile uint32_t g_close_tick[kN];   // TIM5 no fecho da última janela
+static volatile uint8_t  g_close_valid;      // bit c = g_close_tick[c] válido
+static volatile bool     g_resync = true;    // fora de FULL_SYNC desde o último dente
+static MisfireSeg        g_ring[ems::engine::kMisfireRingSize];
+static volatile uint8_t  g_ring_head;        // escrito só na ISR
+static volatile uint8_t  g_ring_tail;        // escrito só no main loop
+static volatile uint32_t g_ring_overflows;
+
+// Estado do main loop (misfire_process).
+struct CylGeom {
+    uint8_t  prev_cyl;   // cilindro anterior na ordem de disparo
+    uint32_t k_q16;      // θ_janela[rad] × janela° / espaçamento° (Q16)
+};
+static CylGeom  g_geom[kN];
+static uint32_t g_win_deg;             // ângulo nominal da janela
+static uint32_t g_fw_acc_q15[kN];      // EMA (1/16) de ref/segmento em corte
+static uint16_t g_fw_q15[kN];          // factor aplicado (normalizado à média)
+static uint16_t g_fw_samples;
+static int32_t  g_accel_mean_q4[kN];   // EMA (1/32) de α do cilindro, Q4
+static int32_t  g_accel_last[kN];      // último α normalizado
+static uint32_t g_noise_q4;            // EMA (1/16) de |α normalizado|, Q4
+static uint32_t g_prev_seg_ns;         // último segmento corrigido avaliável
+static uint8_t  g_prev_seg_cyl = 0xFFu;
+static int32_t  g_prev_dev;            // α normalizado desse segmento
+static uint32_t g_rough_rejects;
+
+constexpr uint32_t kRadPerDegQ16   = 1144u;   // π/180 × 65536
+constexpr uint8_t  kFlywheelShift  = 4u;      // EMA do volante α = 1/16
+constexpr uint8_t  kAccelMeanShift = 5u;      // EMA da média por cilindro α = 1/32
+constexpr uint8_t  kNoiseShift     = 4u;      // EMA do ruído α = 1/16
+constexpr uint32_t kFlywheelMinQ15 = 24576u;  // razão aceite 0.75 … 1.25
+constexpr uint32_t kFlywheelMaxQ15 = 40960u;
+constexpr int32_t  kAccelClamp     = 1000000; // rad/s² (médias Q4 sem overflow)
+
+static void ring_push(uint8_t c, uint32_t seg_ns, uint32_t cycle_ns, uint8_t flags) noexcept {
+    const uint8_t h = g_ring_head;
+    const uint8_t next = static_cast<uint8_t>((h + 1u) & (ems::engine::kMisfireRingSize - 1u));
+    if (next == g_ring_tail) { ++g_ring_overflows; return; }
+    g_ring[h].seg_ns   = seg_ns;
+    g_ring[h].cycle_ns = cycle_ns;
+    g_ring[h].cyl      = c;
+    g_ring[h].flags    = flags;
+    g_ring_head = next;
+}
+
+// Limiar (rad/s²) em RPM × carga; célula 0 → default de compilação.
+static uint32_t thr_cell(uint8_t y, uint8_t x) noexcept {
+    const uint16_t v = ems::engine::misfire_thr_rad_s2[y][x];
+    return (v != 0u) ? v : ems::engine::kMisfireThrDefaultRadS2[y][x];
+}
+
+static uint32_t threshold_rad_s2(uint32_t rpm_x10, uint16_t load_bar_x100) noexcept {
+    using ems::engine::kMisfireThrLoadAxisBarX100;
+    using ems::engine::kMisfireThrRpmAxisX10;
+    constexpr uint8_t kT = ems::engine::kMisfireThrTableSize;
+    const uint8_t xi = ems::engine::table_axis_index(kMisfireThrRpmAxisX10, kT, rpm_x10);
+    const uint8_t yi = ems::engine::table_axis_index(kMisfireThrLoadAxisBarX100, kT, load_bar_x100);
+    const int32_t fx = ems::engine::table_axis_frac_q8(kMisfireThrRpmAxisX10, xi, rpm_x10);
+    const int32_t fy = ems::engine::table_axis_frac_q8(kMisfireThrLoadAxisBarX100, yi, load_bar_x100);
+    const int32_t v00 = static_cast<int32_t>(thr_cell(yi, xi));
+    const int32_t v10 = static_cast<int32_t>(thr_cell(yi, static_cast<uint8_t>(xi + 1u)));
+    const int32_t v01 = static_cast<int32_t>(thr_cell(static_cast<uint8_t>(yi + 1u), xi));
+    const int32_t v11 = static_cast<int32_t>(thr_cell(static_cast<uint8_t>(yi + 1u),
+                                                      static_cast<uint8_t>(xi + 1u)));
+    const int32_t v0 = v00 + (((v10 - v00) * fx) >> 8u);
+    const int32_t v1 = v01 + (((v11 - v01) * fx) >> 8u);
+    return static_cast<uint32_t>(v0 + (((v1 - v0) * fy) >> 8u));
+}
+
+// Segmento sem binário (corte): ref = fracção nominal do ciclo 720° medido
+// no mesmo dente (geometria cancela). O que sobra em seg/ref é o padrão do
+// volante + a tendência de desaceleração, comum a todos → a normalização à
+// média remove a tendência.
+static void flywheel_learn(uint8_t c, uint32_t seg_ns, uint32_t cycle_ns) noexcept {
+    const uint64_t ref_ns = static_cast<uint64_t>(cycle_ns) * g_win_deg / 720u;
+    const uint64_t ratio = (ref_ns << 15u) / seg_ns;
+    if (ratio < kFlywheelMinQ15 || ratio > kFlywheelMaxQ15) { return; }
+    uint32_t& acc = g_fw_acc_q15[c];
+    acc = static_cast<uint32_t>(acc + ((static_cast<int32_t>(ratio) - static_cast<int32_t>(acc))
+                                       >> kFlywheelShift));
+    uint32_t sum = 0u;
+    for (uint8_t i = 0u; i < kN; ++i) { sum += g_fw_acc_q15[i]; }
+    const uint32_t mean = sum / kN;
+    for (uint8_t i = 0u; i < kN; ++i) {
+        g_fw_q15[i] = static_cast<uint16_t>((static_cast<uint64_t>(g_fw_acc_q15[i]) << 15u) / mean);
+    }
+    if (g_fw_samples < 0xFFFFu) { ++g_fw_samples; }
+}
+
+// Desaceleração angular entre o segmento do cilindro anterior (t_prev) e o
+// deste (t_cur), ambos em ns:
+//   ω = θ/T → Δω = θ (T_cur − T_prev) / (T_cur T_prev); Δt ≈ T_cur × esp/janela
+//   α = k × (T_cur − T_prev) / T_cur × 1/(T_cur T_prev)   [k = θ × janela/esp]
+static int32_t decel_rad_s2(uint8_t c, uint32_t t_prev, uint32_t t_cur) noexcept {
+    const int64_t rel_q20 = ((static_cast<int64_t>(t_cur) - static_cast<int64_t>(t_prev)) << 20)
+                            / static_cast<int64_t>(t_cur);
+    const int64_t inv_s2 = static_cast<int64_t>(
+        1000000000000000000ULL / (static_cast<uint64_t>(t_cur) * t_prev));
+    const int64_t a = (((rel_q20 * static_cast<int64_t>(g_geom[c].k_q16)) >> 16) * inv_s2) >> 20;
+    if (a > INT32_MAX) { return INT32_MAX; }
+    if (a < INT32_MIN) { return INT32_MIN; }
+    return static_cast<int32_t>(a);
+}
+
+static void count_event(uint8_t c) noexcept {
+    if (g_event_count[c] < 255u) { ++g_event_count[c]; }
+}
+
+static void evaluate_segment(const MisfireSeg& s, uint32_t rpm_x10,
+                             uint16_t load_bar_x100, bool learn_flywheel) noexcept {
+    const uint8_t c = s.cyl;
+    if (c >= kN || s.seg_ns == 0u) { return; }
+    if ((s.flags & kSegNoCombustion) != 0u && learn_flywheel && s.cycle_ns != 0u) {
+        flywheel_learn(c, s.seg_ns, s.cycle_ns);
+    }
+    if (s.flags != 0u) {
+        // Sem combustão / faísca cortada: não avalia nem serve de referência.
+        g_prev_seg_cyl = 0xFFu;
+        return;
+    }
+    const uint32_t t_cur = static_cast<uint32_t>(
+        (static_cast<uint64_t>(s.seg_ns) * g_fw_q15[c]) >> 15u);
+    const bool have_prev = (g_prev_seg_cyl == g_geom[c].prev_cyl) && g_prev_seg_ns != 0u;
+    const uint32_t t_prev = g_prev_seg_ns;
+    const int32_t prev_dev = g_prev_dev;
+    g_prev_seg_ns = t_cur;
+    g_prev_seg_cyl = c;
+    if (!have_prev || t_cur == 0u) { g_prev_dev = 0; return; }
+
+    int32_t a_raw = decel_rad_s2(c, t_prev, t_cur);
+    if (a_raw > kAccelClamp) { a_raw = kAccelClamp; }
+    if (a_raw < -kAccelClamp) { a_raw = -kAccelClamp; }
+    const int32_t dev = a_raw - (g_accel_mean_q4[c] >> 4);
+    g_accel_last[c] = dev;
+    g_prev_dev = dev;
+
+    const uint32_t thr = threshold_rad_s2(rpm_x10, load_bar_x100);
+    const uint32_t pct = (ems::engine::misfire_rough_ratio_pct != 0u)
+        ? ems::engine::misfire_rough_ratio_pct : ems::engine::kMisfireRoughDefaultPct;
+    const bool rough = (g_noise_q4 >> 4) > (thr * pct) / 100u;
+    // Ressonância: aceleração forte logo antes (oscilação do trem de força).
+    const bool resonance = prev_dev < -static_cast<int32_t>(thr / 2u);
+    if (dev > static_cast<int32_t>(thr)) {
+        if (rough || resonance) {
+            ++g_rough_rejects;
+        } else {
+            count_event(c);
+        }
+        return;   // pico fora de banda não entra nas médias
+    }
+    g_accel_mean_q4[c] += ((a_raw * 16) - g_accel_mean_q4[c]) >> kAccelMeanShift;
+    const uint32_t mag_q4 = static_cast<uint32_t>((dev < 0) ? -dev : dev) << 4u;
+    g_noise_q4 = static_cast<uint32_t>(
+        static_cast<int32_t>(g_noise_q4) +
+        ((static_cast<int32_t>(mag_q4) - static_cast<int32_t>(g_noise_q4)) >> kNoiseShift));
+}
+
+// Detector legado (misfire_accel_enable = 0): soma real vs prevista × 1.12.
 static void evaluate_window(uint8_t cyl) noexcept {
     // threshold = predicted_sum × kMisfireThresholdQ8 / 256
     const uint64_t thresh = (static_cast<uint64_t>(g_pred_sum_ns[cyl]) *
@@ -52,7 +230,7 @@ static void evaluate_window(uint8_t cyl) noexcept {
             ++g_debounce[cyl];
         }
         if (g_debounce[cyl] >= ems::engine::kMisfireDebounceCycles) {
-            if (g_event_count[cyl] < 255u) { ++g_event_count[cyl]; }
+            count_event(cyl);
             g_debounce[cyl] = 0u;
         }
     } else {
@@ -65,17 +243,21 @@ static void evaluate_window(uint8_t cyl) noexcept {
 namespace ems::engine {
 
 void misfire_init() noexcept {
-    // Mapeia cada cilindro para sua posição TDC a partir de kFiringOrder.
-    // O i-ésimo evento de ignição ocorre a i × 180° no ciclo de 720°.
-    // Para roda 60-2: 180° = 30 dentes; os dois semiciclos distinguem-se por phase_A.
+    // Mapeia cada cilindro para sua posição TDC a partir de cfg::cyl_tdc_deg
+    // (ordem de disparo + tabela even/odd-fire). TDC em [0,360) → phase_A;
+    // o ângulo dentro da volta dá a posição da roda → último dente real.
+    // 4 cil / 60-2 (TDC a cada 180°):
     //   i=0 → tooth  0, phA=true   (  0°)
     //   i=1 → tooth 30, phA=true   (180°)
     //   i=2 → tooth  0, phA=false  (360°)
     //   i=3 → tooth 30, phA=false  (540°)
-    for (uint8_t i = 0u; i < kN; ++i) {
-        const uint8_t cyl = cfg::kFiringOrder[i];
-        g_cyl_tdc[cyl].tdc_tooth = static_cast<uint8_t>((i % 2u) * 30u);
-        g_cyl_tdc[cyl].phase_A   = (i < 2u);
+    // Roda lida no init: misfire_init() segue qualquer troca de roda (host).
+    const ems::drv::TriggerWheel& w = ems::drv::ckp_wheel();
+    for (uint8_t cyl = 0u; cyl < kN; ++cyl) {
+        const uint32_t tdc = cfg::cyl_tdc_deg(cyl);
+        const uint32_t pos = ((tdc % 360u) * w.positions) / 360u;
+        g_cyl_tdc[cyl].tdc_tooth = w.pos_to_tooth[pos];
+        g_cyl_tdc[cyl].phase_A   = (tdc < 360u);
     }
     // Pré-computa mapa dente→cilindro para lookup O(1) no ISR.
     std::memset(g_tooth_to_cyl, 0xFF, sizeof(g_tooth_to_cyl));  // -1 em int8_t
@@ -83,11 +265,23 @@ void misfire_init() noexcept {
         const uint8_t phase = g_cyl_tdc[c].phase_A ? 0u : 1u;
         for (uint8_t t = 0u; t < ems::engine::kMisfireWindowTeeth; ++t) {
             const uint8_t tooth = g_cyl_tdc[c].tdc_tooth + t;
-            if (tooth < ems::engine::kRealTeeth60_2) {
+            if (tooth < w.real_teeth) {
                 g_tooth_to_cyl[phase][tooth] = static_cast<int8_t>(c);
             }
         }
     }
+    // Cinemática: cilindro anterior na ordem de disparo e o factor k de α
+    // (janela nominal de kMisfireWindowTeeth posições; odd-fire → espaçamento
+    // próprio por cilindro).
+    g_win_deg = (static_cast<uint32_t>(kMisfireWindowTeeth) * 360u) / w.positions;
+    for (uint8_t c = 0u; c < kN; ++c) {
+        const uint8_t pos = cfg::cyl_firing_pos(c);
+        const uint8_t prev = cfg::kFiringOrder[(pos + kN - 1u) % kN];
+        uint32_t spacing = (cfg::cyl_tdc_deg(c) + 720u - cfg::cyl_tdc_deg(prev)) % 720u;
+        if (spacing == 0u) { spacing = 720u; }   // 1 cilindro
+        g_geom[c].prev_cyl = prev;
+        g_geom[c].k_q16 = (g_win_deg * kRadPerDegQ16 * g_win_deg) / spacing;
+    }
     misfire_reset();
 }
 
@@ -98,7 +292,26 @@ void misfire_reset() noexcept {
         g_power_teeth[c]  = 0u;
         g_debounce[c]     = 0u;
         g_event_count[c]  = 0u;
+        g_last_power_sum_ns[c] = 0u;
+        g_last_pred_sum_ns[c]  = 0u;
+        g_win_flags[c]    = 0u;
+        g_close_tick[c]   = 0u;
+        g_fw_acc_q15[c]   = kMisfireFlywheelOneQ15;
+        g_fw_q15[c]       = kMisfireFlywheelOneQ15;
+        g_accel_mean_q4[c] = 0;
+        g_accel_last[c]   = 0;
     }
+    g_close_valid = 0u;
+    g_resync = true;
+    g_ring_head = 0u;
+    g_ring_tail = 0u;
+    g_ring_overflows = 0u;
+    g_fw_samples = 0u;
+    g_noise_q4 = 0u;
+    g_prev_seg_ns = 0u;
+    g_prev_seg_cyl = 0xFFu;
+    g_prev_dev = 0;
+    g_rough_rejects = 0u;
 }
 
 uint8_t misfire_get_event_count(uint8_t cyl) noexcept {
@@ -110,24 +323,76 @@ void misfire_clear_events(uint8_t cyl) noexcept {
     if (cyl < kN) { g_event_count[cyl] = 0u; }
 }
 
+void misfire_get_window_sums(uint8_t cyl, uint32_t& power_ns, uint32_t& pred_ns) noexcept {
+    if (cyl >= kN) { power_ns = 0u; pred_ns = 0u; return; }
+    ems::hal::CriticalSectionGuard guard;
+    power_ns = g_last_power_sum_ns[cyl];
+    pred_ns  = g_last_pred_sum_ns[cyl];
+}
+
 void misfire_set_all_inhibit(bool inhibit) noexcept {
     g_all_inhibit = inhibit;
 }
 
+void misfire_process(uint32_t rpm_x10, uint16_t load_bar_x100, bool learn_flywheel) noexcept {
+    const bool enabled = (misfire_accel_enable != 0u);
+    uint8_t t = g_ring_tail;
+    while (t != g_ring_head) {
+        if (enabled) { evaluate_segment(g_ring[t], rpm_x10, load_bar_x100, learn_flywheel); }
+        t = static_cast<uint8_t>((t + 1u) & (kMisfireRingSize - 1u));
+        g_ring_tail = t;
+    }
+}
+
+int32_t misfire_get_accel_rad_s2(uint8_t cyl) noexcept {
+    return (cyl < kN) ? g_accel_last[cyl] : 0;
+}
+
+uint16_t misfire_get_flywheel_q15(uint8_t cyl) noexcept {
+    return (cyl < kN) ? g_fw_q15[cyl] : kMisfireFlywheelOneQ15;
+}
+
+uint16_t misfire_get_flywheel_samples() noexcept {
+    return g_fw_samples;
+}
+
+uint32_t misfire_get_rough_rejects() noexcept {
+    return g_rough_rejects;
+}
+
+uint32_t misfire_get_ring_overflows() noexcept {
+    return g_ring_overflows;
+}
+
 }  // namespace ems::engine
 
 // ── Hook ISR (ems::drv namespace — substitui símbolo fraco de ckp.cpp) ────────
 namespace ems::drv {
 
 void misfire_on_tooth(const CkpSnapshot& snap) noexcept {
-    if (snap.state != SyncState::FULL_SYNC) { return; }
+    if (snap.state != SyncState::FULL_SYNC) { g_resync = true; return; }
     if (snap.tooth_period_ns == 0u || snap.predicted_tooth_period_ns == 0u) { return; }
-    // Cortes intencionais de combustão: não acumular → evitar DTCs falsos
-    if (g_all_inhibit) { return; }
+    const bool accel = (ems::engine::misfire_accel_enable != 0u);
+    // Cortes intencionais de combustão: o legado não acumula (evita DTCs
+    // falsos); a cinemática fecha a janela marcada — é o que ensina o volante.
+    if (g_all_inhibit && !accel) { return; }
 
-    const uint8_t ti    = static_cast<uint8_t>(snap.tooth_index & 0x3Fu);
+    if (g_resync) {
+        // Primeiro dente em FULL_SYNC após perda: janelas parciais e fechos
+        // anteriores pertencem a outra referência angular.
+        g_resync = false;
+        g_close_valid = 0u;
+        for (uint8_t i = 0u; i < kN; ++i) {
+            g_power_sum_ns[i] = 0u;
+            g_pred_sum_ns[i]  = 0u;
+            g_power_teeth[i]  = 0u;
+            g_win_flags[i]    = 0u;
+        }
+    }
+
+    if (snap.tooth_index >= kTriggerMaxTeeth) { return; }
+    const uint8_t ti    = static_cast<uint8_t>(snap.tooth_index);
     const uint8_t phase = snap.phase_A ? 0u : 1u;
-    if (ti >= ems::engine::kRealTeeth60_2) { return; }
     const int8_t cyl_idx = g_tooth_to_cyl[phase][ti];
     if (cyl_idx < 0) { return; }
     const uint8_t c = static_cast<uint8_t>(cyl_idx);
@@ -140,13 +405,20 @@ void misfire_on_tooth(const CkpSnapshot& snap) noexcept {
     // eventos de janelas COMPLETAS anteriores ao corte; apaGá-lo destrói
     // histórico real de misfires (ex: vela ruim antes de atingir o limitador).
     // Falsos positivos do corte estão em g_power_sum_ns (janela parcial) —
-    // zerando esta janela é suficiente para evitá-los.
+    // zerando esta janela é suficiente para evitá-los. Na cinemática a janela
+    // segue marcada (não avaliada, não serve de referência ao cilindro seguinte).
     if ((ign_mask >> c) & 1u) {
-        g_power_sum_ns[c] = 0u;
-        g_pred_sum_ns[c]  = 0u;
-        g_power_teeth[c]  = 0u;
-        g_debounce[c]     = 0u;
-        return;
+        g_debounce[c] = 0u;
+        if (!accel) {
+            g_power_sum_ns[c] = 0u;
+            g_pred_sum_ns[c]  = 0u;
+            g_power_teeth[c]  = 0u;
+            return;
+        }
+        g_win_flags[c] = static_cast<uint8_t>(g_win_flags[c] | kSegSparkCut);
+    }
+    if (g_all_inhibit) {
+        g_win_flags[c] = static_cast<uint8_t>(g_win_flags[c] | kSegNoCombustion);
     }
 
     g_power_sum_ns[c] += snap.tooth_period_ns;
@@ -154,10 +426,27 @@ void misfire_on_tooth(const CkpSnapshot& snap) noexcept {
     ++g_power_teeth[c];
 
     if (g_power_teeth[c] >= ems::engine::kMisfireWindowTeeth) {
-        evaluate_window(c);
+        g_last_power_sum_ns[c] = g_power_sum_ns[c];
+        g_last_pred_sum_ns[c]  = g_pred_sum_ns[c];
+        if (accel) {
+            // Ciclo 720° entre fechos do mesmo dente (estilo ckp_instant_rpm):
+            // referência livre do erro de geometria para o volante.
+            const uint8_t bit = static_cast<uint8_t>(1u << c);
+            const uint32_t ticks = snap.last_tim5_capture - g_close_tick[c];
+            const uint32_t cycle_ns =
+                ((g_close_valid & bit) != 0u &&
+                 ticks < (UINT32_MAX / ems::engine::kTim5TickPeriodNs))
+                    ? ticks * ems::engine::kTim5TickPeriodNs : 0u;
+            g_close_tick[c] = snap.last_tim5_capture;
+            g_close_valid = static_cast<uint8_t>(g_close_valid | bit);
+            ring_push(c, g_power_sum_ns[c], cycle_ns, g_win_flags[c]);
+        } else {
+            evaluate_window(c);
+        }
         g_power_sum_ns[c] = 0u;
         g_pred_sum_ns[c]  = 0u;
         g_power_teeth[c]  = 0u;
+        g_win_flags[c]    = 0u;
     }
 }
 
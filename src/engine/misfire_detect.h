@@ -10,6 +10,40 @@ constexpr uint32_t kMisfireThresholdQ8    = 287u;  // 1.12 em Q8 (256 × 1.12)
 constexpr uint8_t  kMisfireDebounceCycles = 3u;    // ciclos consecutivos para confirmar
 constexpr uint8_t  kMisfireFaultThreshold = 5u;    // eventos em período de 100ms → DTC
 
+// ── Detector por cinemática da cambota (misfire_accel_enable = 1) ────────────
+// ISR (O(1) por dente): soma os períodos da janela de potência do cilindro e,
+// no fecho, empurra um resumo {tempo do segmento, tempo do ciclo 720° desde
+// o fecho anterior do MESMO dente} para um anel lido pelo main loop.
+// misfire_process (slot de 2 ms) drena o anel e, por segmento:
+//   volante   — factor por cilindro (Q15) que iguala o segmento à fracção
+//               nominal do ciclo medido dente-a-mesmo-dente (sem erro de
+//               geometria); aprendido só em corte de combustível (decel cut,
+//               sem binário) e normalizado à média dos cilindros;
+//   aceleração — desaceleração angular α (rad/s²) face ao segmento do
+//               cilindro anterior na ordem de disparo, menos a média EMA do
+//               próprio cilindro (normalização por cilindro);
+//   limiar    — misfire_thr_rad_s2 interpolado em RPM × carga;
+//   rejeição  — ruído de fundo EMA de |α| acima de misfire_rough_ratio_pct
+//               do limiar (estrada irregular) ou segmento anterior também
+//               fora de banda (ressonância da transmissão: alterna de sinal
+//               em segmentos seguidos; o misfire é um pico isolado).
+// Cada segmento acima do limiar conta um evento (mesmo contador do legado →
+// DTC de 100 ms inalterado).
+constexpr uint8_t kMisfireRingSize = 16u;   // resumos pendentes (potência de 2)
+static_assert((kMisfireRingSize & (kMisfireRingSize - 1u)) == 0u, "índice por máscara");
+inline constexpr uint32_t kMisfireThrRpmAxisX10[4]     = {8000u, 20000u, 40000u, 65000u};
+inline constexpr uint32_t kMisfireThrLoadAxisBarX100[4] = {30u, 50u, 80u, 150u};
+// Defaults [carga][rpm] — α de um misfire cresce com a carga (binário
+// perdido) e o ruído de combustão com a rotação.
+inline constexpr uint16_t kMisfireThrDefaultRadS2[4][4] = {
+    {150u, 200u, 250u, 300u},
+    {250u, 350u, 450u, 550u},
+    {400u, 600u, 800u, 1000u},
+    {600u, 900u, 1200u, 1500u},
+};
+constexpr uint8_t  kMisfireRoughDefaultPct = 60u;
+constexpr uint16_t kMisfireFlywheelOneQ15  = 32768u;
+
 void misfire_init() noexcept;
 void misfire_reset() noexcept;
 
@@ -22,6 +56,27 @@ void misfire_set_all_inhibit(bool inhibit) noexcept;
 uint8_t misfire_get_event_count(uint8_t cyl) noexcept;
 void    misfire_clear_events(uint8_t cyl) noexcept;
 
+// Somas (ns) da última janela de potência COMPLETA do cilindro: período real
+// e período previsto. Telemetria por ciclo (CAN FD); 0/0 antes da 1ª janela.
+// Leitura do main loop — o par é copiado com IRQs mascaradas (ISR escreve).
+void misfire_get_window_sums(uint8_t cyl, uint32_t& power_ns, uint32_t& pred_ns) noexcept;
+
+// Slot de 2 ms: drena os resumos do anel e avalia-os (só com
+// misfire_accel_enable = 1; senão só descarta). learn_flywheel = corte de
+// combustível activo (decel cut) → segmentos sem binário ensinam o volante.
+void misfire_process(uint32_t rpm_x10, uint16_t load_bar_x100, bool learn_flywheel) noexcept;
+
+// Última desaceleração normalizada do cilindro (rad/s², + = perdeu binário).
+int32_t  misfire_get_accel_rad_s2(uint8_t cyl) noexcept;
+// Factor do padrão do volante (Q15, 32768 = 1.0).
+uint16_t misfire_get_flywheel_q15(uint8_t cyl) noexcept;
+// Ciclos de corte usados no volante (satura); 0 = padrão por aprender.
+uint16_t misfire_get_flywheel_samples() noexcept;
+// Segmentos não avaliados por estrada irregular / ressonância.
+uint32_t misfire_get_rough_rejects() noexcept;
+// Resumos perdidos por anel cheio (main loop atrasado).
+uint32_t misfire_get_ring_overflows() noexcept;
+
 }  // namespace ems::engine
 
 // Hook chamado no ISR do CKP (ems::drv namespace, igual aos outros hooks).
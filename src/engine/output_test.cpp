@@ -93,7 +93,7 @@ void output_test_poll(uint32_t now_ms, uint32_t rpm_x10) noexcept
 
 bool output_test_fire_injector(uint8_t cyl, uint16_t pw_us) noexcept
 {
-    if (cyl > 3u || pw_us == 0u) { return false; }
+    if (cyl >= ECU_CYL_COUNT || pw_us == 0u) { return false; }
     if (!cmd_allowed(true)) { return false; }
     if (pw_us > 30000u) { pw_us = 30000u; }
     ::ecu_sched_test_pulse_inj(cyl, pw_us);
@@ -103,7 +103,7 @@ bool output_test_fire_injector(uint8_t cyl, uint16_t pw_us) noexcept
 
 bool output_test_fire_coil(uint8_t cyl, uint16_t dwell_us) noexcept
 {
-    if (cyl > 3u || dwell_us == 0u) { return false; }
+    if (cyl >= ECU_CYL_COUNT || dwell_us == 0u) { return false; }
     if (!cmd_allowed(true)) { return false; }
     if (dwell_us > 10000u) { dwell_us = 10000u; }
     ::ecu_sched_test_pulse_ign(cyl, dwell_us);
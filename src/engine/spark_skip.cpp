@@ -1,10 +1,14 @@
 #include "engine/spark_skip.h"
 
+#include "engine/engine_config.h"
+
 namespace ems::engine {
 
 namespace {
 constexpr uint8_t kMaxRatioQ8 = 128u;   // 50% — acima disso é caso p/ fuel cut
-constexpr uint8_t kFiresPerRev = 2u;    // 4-cil 4T: ~2 eventos IGN por volta
+constexpr uint8_t kCyl = cfg::kCylinderCount;
+// 4T: N/2 eventos IGN por volta (mín. 1 — monocilíndrico dispara a cada 2).
+constexpr uint8_t kFiresPerRev = (kCyl >= 2u) ? static_cast<uint8_t>(kCyl / 2u) : 1u;
 
 uint8_t  g_ratio_q8 = 0u;
 uint16_t g_acc_q8   = 0u;   // acumulador Bresenham (Q8)
@@ -34,14 +38,14 @@ void spark_skip_on_rev() noexcept {
         g_acc_q8 + static_cast<uint16_t>(g_ratio_q8) * kFiresPerRev);
     uint8_t skips = static_cast<uint8_t>(g_acc_q8 >> 8u);
     g_acc_q8 &= 0xFFu;
-    if (skips > 4u) {
-        skips = 4u;
+    if (skips > kCyl) {
+        skips = kCyl;
     }
     uint8_t mask = 0u;
     for (uint8_t i = 0u; i < skips; ++i) {
-        mask |= static_cast<uint8_t>(1u << ((g_rot + i) & 3u));
+        mask |= static_cast<uint8_t>(1u << ((g_rot + i) % kCyl));
     }
-    g_rot  = static_cast<uint8_t>((g_rot + skips) & 3u);
+    g_rot  = static_cast<uint8_t>((g_rot + skips) % kCyl);
     g_mask = mask;
 }
 
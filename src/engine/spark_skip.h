@@ -10,8 +10,8 @@ namespace ems::engine {
 // VIA a máscara de inibição IGN já existente do scheduler (purge seguro +
 // bobina LOW) — o núcleo de timing não é tocado: saltar = não armar o evento.
 //
-// Padrão Bresenham por revolução: num 4-cil 4T disparam ~2 cilindros por
-// volta; a cada volta o acumulador soma ratio×2 e o overflow (0..2) define
+// Padrão Bresenham por revolução: num N-cil 4T disparam ~N/2 cilindros por
+// volta; a cada volta o acumulador soma ratio×N/2 e o overflow define
 // quantos cilindros entram na máscara, com rotação para distribuir o salto
 // entre cilindros (sem aquecer sempre o mesmo). A atribuição por cilindro é
 // aproximada (a máscara não conhece a ordem de disparo da meia-volta), mas o
@@ -28,7 +28,7 @@ uint8_t spark_skip_get_ratio_q8() noexcept;
 // Actualiza a máscara devolvida por spark_skip_mask().
 void spark_skip_on_rev() noexcept;
 
-// Máscara de cilindros a inibir nesta revolução (bit0=cyl0..bit3=cyl3).
+// Máscara de cilindros a inibir nesta revolução (bit0=cyl0..bitN-1).
 // OR-ar com as outras fontes antes de ecu_sched_set_ign_inhibit_mask().
 uint8_t spark_skip_mask() noexcept;
 
@@ -73,8 +73,8 @@ uint32_t kLoadAxisBarX100[kTableAxisSize] = {
     94u, 100u, 110u, 130u, 160u, 190u, 220u, 250u, 273u, 300u,
 };
 
-bool table_axes_set(const uint16_t rpm[kTableAxisSize],
-                    const uint16_t load_bar_x100[kTableAxisSize]) noexcept {
+bool table_axes_valid(const uint16_t rpm[kTableAxisSize],
+                      const uint16_t load_bar_x100[kTableAxisSize]) noexcept {
     if (rpm[0] == 0u || load_bar_x100[0] == 0u) {
         return false;
     }
@@ -83,6 +83,14 @@ bool table_axes_set(const uint16_t rpm[kTableAxisSize],
             return false;
         }
     }
+    return true;
+}
+
+bool table_axes_set(const uint16_t rpm[kTableAxisSize],
+                    const uint16_t load_bar_x100[kTableAxisSize]) noexcept {
+    if (!table_axes_valid(rpm, load_bar_x100)) {
+        return false;
+    }
     for (uint8_t i = 0u; i < kTableAxisSize; ++i) {
         kRpmAxisX10[i] = static_cast<uint32_t>(rpm[i]) * 10u;
         kLoadAxisBarX100[i] = load_bar_x100[i];
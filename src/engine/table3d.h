@@ -26,9 +26,17 @@ constexpr uint16_t kCalLayoutVersionOffset = 175u;
 extern uint32_t kRpmAxisX10[kTableAxisSize];
 extern uint32_t kLoadAxisBarX100[kTableAxisSize];
 
+// Eixos na forma da página 11 são aceitáveis: estritamente crescentes e
+// rpm[0], load[0] ≠ 0.
+bool table_axes_valid(const uint16_t rpm[kTableAxisSize],
+                      const uint16_t load_bar_x100[kTableAxisSize]) noexcept;
+
 // Aplica novos eixos a partir da forma serializada da página 11
 // (RPM cru em u16, load em bar×100 u16). Rejeita (sem alterar nada) se
 // qualquer eixo não for estritamente crescente ou se rpm[0] == 0.
+// Só troca os eixos — as tabelas ficam como estão (boot/NVM, onde tabelas
+// e eixos foram gravados juntos). Mudança de eixos em runtime com as
+// tabelas re-amostradas: table_reaxis_request() (engine/table_reaxis.h).
 bool table_axes_set(const uint16_t rpm[kTableAxisSize],
                     const uint16_t load_bar_x100[kTableAxisSize]) noexcept;
 
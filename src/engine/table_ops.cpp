@@ -0,0 +1,312 @@
+/**
+ * @file engine/table_ops.cpp
+ * @brief Operações em lote sobre tabelas — SIMD DSP M33 / fallback host.
+ */
+#include "engine/table_ops.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "hal/crc32.h"
+
+namespace {
+
+inline uint32_t load32(const void* p) noexcept {
+    uint32_t w;
+    std::memcpy(&w, p, 4u);
+    return w;
+}
+
+inline void store32(void* p, uint32_t w) noexcept {
+    std::memcpy(p, &w, 4u);
+}
+
+// ── Lanes SIMD ───────────────────────────────────────────────────────────────
+// Alvo: instruções DSP do M33 (sem CMSIS no tree — asm inline). As que usam
+// as flags GE (USUB8/SSUB8 → SEL) ficam no mesmo bloco asm: GE não sobrevive
+// de forma garantida entre statements.
+#if defined(TARGET_STM32H562) && defined(__ARM_FEATURE_DSP)
+
+inline uint32_t uqadd8(uint32_t a, uint32_t b) noexcept {
+    uint32_t r;
+    __asm__("uqadd8 %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+    return r;
+}
+
+inline uint32_t uqsub8(uint32_t a, uint32_t b) noexcept {
+    uint32_t r;
+    __asm__("uqsub8 %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+    return r;
+}
+
+// Lanes i8 → parte positiva e magnitude da negativa (u8; −128 → 128 exacto).
+inline void split_s8x4(uint32_t d, uint32_t& pos, uint32_t& neg) noexcept {
+    __asm__("ssub8 %0, %2, %3\n\t"
+            "sel   %0, %2, %3\n\t"
+            "sel   %1, %3, %2\n\t"
+            "usub8 %1, %3, %1"
+            : "=&r"(pos), "=&r"(neg) : "r"(d), "r"(0u));
+}
+
+inline int32_t smlad(uint32_t x, uint32_t y, int32_t acc) noexcept {
+    int32_t r;
+    __asm__("smlad %0, %1, %2, %3" : "=r"(r) : "r"(x), "r"(y), "r"(acc));
+    return r;
+}
+
+inline uint32_t uxtb16(uint32_t x) noexcept {
+    uint32_t r;
+    __asm__("uxtb16 %0, %1" : "=r"(r) : "r"(x));
+    return r;
+}
+
+inline uint32_t uxtb16_ror8(uint32_t x) noexcept {
+    uint32_t r;
+    __asm__("uxtb16 %0, %1, ror #8" : "=r"(r) : "r"(x));
+    return r;
+}
+
+// [a.lo | b.lo] e [b.hi | a.hi] (metade baixa | metade alta).
+inline uint32_t pkhbt(uint32_t a, uint32_t b) noexcept {
+    uint32_t r;
+    __asm__("pkhbt %0, %1, %2, lsl #16" : "=r"(r) : "r"(a), "r"(b));
+    return r;
+}
+
+inline uint32_t pkhtb(uint32_t a, uint32_t b) noexcept {
+    uint32_t r;
+    __asm__("pkhtb %0, %1, %2, asr #16" : "=r"(r) : "r"(a), "r"(b));
+    return r;
+}
+
+#else  // host / núcleo sem DSP: emulação lane a lane, mesma semântica
+
+inline uint32_t lane(uint32_t w, uint32_t k) noexcept { return (w >> (8u * k)) & 0xFFu; }
+
+inline uint32_t uqadd8(uint32_t a, uint32_t b) noexcept {
+    uint32_t r = 0u;
+    for (uint32_t k = 0u; k < 4u; ++k) {
+        const uint32_t s = lane(a, k) + lane(b, k);
+        r |= ((s > 255u) ? 255u : s) << (8u * k);
+    }
+    return r;
+}
+
+inline uint32_t uqsub8(uint32_t a, uint32_t b) noexcept {
+    uint32_t r = 0u;
+    for (uint32_t k = 0u; k < 4u; ++k) {
+        const uint32_t x = lane(a, k);
+        const uint32_t y = lane(b, k);
+        r |= ((x > y) ? (x - y) : 0u) << (8u * k);
+    }
+    return r;
+}
+
+inline void split_s8x4(uint32_t d, uint32_t& pos, uint32_t& neg) noexcept {
+    pos = 0u;
+    neg = 0u;
+    for (uint32_t k = 0u; k < 4u; ++k) {
+        const int32_t v = static_cast<int8_t>(lane(d, k));
+        if (v >= 0) {
+            pos |= static_cast<uint32_t>(v) << (8u * k);
+        } else {
+            neg |= static_cast<uint32_t>(-v) << (8u * k);
+        }
+    }
+}
+
+inline int32_t smlad(uint32_t x, uint32_t y, int32_t acc) noexcept {
+    const int32_t xl = static_cast<int16_t>(x & 0xFFFFu);
+    const int32_t xh = static_cast<int16_t>(x >> 16u);
+    const int32_t yl = static_cast<int16_t>(y & 0xFFFFu);
+    const int32_t yh = static_cast<int16_t>(y >> 16u);
+    return acc + xl * yl + xh * yh;
+}
+
+inline uint32_t uxtb16(uint32_t x) noexcept { return x & 0x00FF00FFu; }
+
+inline uint32_t uxtb16_ror8(uint32_t x) noexcept {
+    return ((x >> 8u) | (x << 24u)) & 0x00FF00FFu;
+}
+
+inline uint32_t pkhbt(uint32_t a, uint32_t b) noexcept {
+    return (a & 0xFFFFu) | (b << 16u);
+}
+
+inline uint32_t pkhtb(uint32_t a, uint32_t b) noexcept {
+    return (a & 0xFFFF0000u) | (b >> 16u);
+}
+
+#endif
+
+// ── Referências escalares (cauda n % 4) ──────────────────────────────────────
+
+inline uint8_t add_sat_u8_1(uint8_t d, int8_t delta) noexcept {
+    const int32_t v = static_cast<int32_t>(d) + delta;
+    return static_cast<uint8_t>((v < 0) ? 0 : (v > 255) ? 255 : v);
+}
+
+inline int32_t blend_1(int32_t d, int32_t s, int32_t a) noexcept {
+    return (d * (256 - a) + s * a + 128) >> 8;
+}
+
+// Pesos [256−α | α] para SMLAD sobre pares [dst | src].
+inline uint32_t blend_weights(uint16_t alpha_q8) noexcept {
+    const uint32_t a = (alpha_q8 > 256u) ? 256u : alpha_q8;
+    return (256u - a) | (a << 16u);
+}
+
+// Máscara de 4 células (nibble da máscara de bits) → palavra.
+constexpr uint32_t kNibbleMask[16] = {
+    0x00000000u, 0x000000FFu, 0x0000FF00u, 0x0000FFFFu,
+    0x00FF0000u, 0x00FF00FFu, 0x00FFFF00u, 0x00FFFFFFu,
+    0xFF000000u, 0xFF0000FFu, 0xFF00FF00u, 0xFF00FFFFu,
+    0xFFFF0000u, 0xFFFF00FFu, 0xFFFFFF00u, 0xFFFFFFFFu,
+};
+
+inline void set_bit(uint8_t* bits, uint16_t i) noexcept {
+    bits[i >> 3u] = static_cast<uint8_t>(bits[i >> 3u] | (1u << (i & 7u)));
+}
+
+// Regra de bake do commit LTFT (ver fuel_trim: ltft_accum_commit_cell).
+// Devolve o passo new − old (0 = sem mudança).
+inline int32_t trim_step(int32_t old, int32_t bake, uint8_t lo, uint8_t hi) noexcept {
+    if (bake == 0) { return 0; }
+    const int32_t factor = 1000 + bake;
+    int32_t v = (old * factor + ((factor >= 0) ? 500 : -500)) / 1000;
+    if (v == old) { v = old + ((bake > 0) ? 1 : -1); }
+    if (v < lo) { v = lo; }
+    if (v > hi) { v = hi; }
+    return v - old;
+}
+
+}  // namespace
+
+namespace ems::engine {
+
+void table_ops_add_sat_u8(uint8_t* dst, const int8_t* delta, uint16_t n) noexcept {
+    uint16_t i = 0u;
+    for (; static_cast<uint16_t>(i + 4u) <= n; i = static_cast<uint16_t>(i + 4u)) {
+        uint32_t pos = 0u;
+        uint32_t neg = 0u;
+        split_s8x4(load32(delta + i), pos, neg);
+        store32(dst + i, uqsub8(uqadd8(load32(dst + i), pos), neg));
+    }
+    for (; i < n; ++i) { dst[i] = add_sat_u8_1(dst[i], delta[i]); }
+}
+
+uint16_t table_ops_trim_delta_u8_x10(const uint8_t* t, const int16_t* trim_x10,
+                                     uint16_t n, uint8_t lo, uint8_t hi,
+                                     int8_t* delta, uint8_t* changed_bits) noexcept {
+    std::memset(delta, 0, n);
+    std::memset(changed_bits, 0, (static_cast<uint32_t>(n) + 7u) / 8u);
+    uint16_t changed = 0u;
+    uint16_t i = 0u;
+    while (i < n) {
+        // 4 trims a zero (caso comum num commit parcial) → salta a palavra.
+        if (static_cast<uint16_t>(i + 4u) <= n) {
+            uint64_t z;
+            std::memcpy(&z, trim_x10 + i, sizeof z);
+            if (z == 0u) {
+                i = static_cast<uint16_t>(i + 4u);
+                continue;
+            }
+        }
+        int32_t d = trim_step(t[i], trim_x10[i], lo, hi);
+        if (d != 0) {
+            if (d > 127) { d = 127; }
+            if (d < -127) { d = -127; }
+            delta[i] = static_cast<int8_t>(d);
+            set_bit(changed_bits, i);
+            ++changed;
+        }
+        ++i;
+    }
+    return changed;
+}
+
+void table_ops_blend_u8(uint8_t* dst, const uint8_t* src, uint16_t n,
+                        uint16_t alpha_q8) noexcept {
+    const uint32_t w = blend_weights(alpha_q8);
+    uint16_t i = 0u;
+    for (; static_cast<uint16_t>(i + 4u) <= n; i = static_cast<uint16_t>(i + 4u)) {
+        const uint32_t wd = load32(dst + i);
+        const uint32_t ws = load32(src + i);
+        const uint32_t d02 = uxtb16(wd);        // [d0 | d2]
+        const uint32_t s02 = uxtb16(ws);
+        const uint32_t d13 = uxtb16_ror8(wd);   // [d1 | d3]
+        const uint32_t s13 = uxtb16_ror8(ws);
+        const uint32_t r0 = static_cast<uint32_t>(smlad(pkhbt(d02, s02), w, 128) >> 8);
+        const uint32_t r2 = static_cast<uint32_t>(smlad(pkhtb(s02, d02), w, 128) >> 8);
+        const uint32_t r1 = static_cast<uint32_t>(smlad(pkhbt(d13, s13), w, 128) >> 8);
+        const uint32_t r3 = static_cast<uint32_t>(smlad(pkhtb(s13, d13), w, 128) >> 8);
+        store32(dst + i, r0 | (r1 << 8u) | (r2 << 16u) | (r3 << 24u));
+    }
+    const int32_t a = static_cast<int32_t>(w >> 16u);
+    for (; i < n; ++i) {
+        dst[i] = static_cast<uint8_t>(blend_1(dst[i], src[i], a));
+    }
+}
+
+void table_ops_blend_s16(int16_t* dst, const int16_t* src, uint16_t n,
+                         uint16_t alpha_q8) noexcept {
+    const uint32_t w = blend_weights(alpha_q8);
+    uint16_t i = 0u;
+    for (; static_cast<uint16_t>(i + 2u) <= n; i = static_cast<uint16_t>(i + 2u)) {
+        const uint32_t wd = load32(dst + i);    // [d0 | d1]
+        const uint32_t ws = load32(src + i);
+        const int32_t r0 = smlad(pkhbt(wd, ws), w, 128) >> 8;
+        const int32_t r1 = smlad(pkhtb(ws, wd), w, 128) >> 8;
+        store32(dst + i, (static_cast<uint32_t>(r0) & 0xFFFFu) |
+                         (static_cast<uint32_t>(r1) << 16u));
+    }
+    const int32_t a = static_cast<int32_t>(w >> 16u);
+    for (; i < n; ++i) {
+        dst[i] = static_cast<int16_t>(blend_1(dst[i], src[i], a));
+    }
+}
+
+void table_ops_copy_masked_u8(uint8_t* dst, const uint8_t* src,
+                              const uint8_t* mask_bits, uint16_t n) noexcept {
+    uint16_t i = 0u;
+    for (; static_cast<uint16_t>(i + 4u) <= n; i = static_cast<uint16_t>(i + 4u)) {
+        const uint32_t m = kNibbleMask[(mask_bits[i >> 3u] >> (i & 7u)) & 0x0Fu];
+        if (m == 0u) { continue; }
+        store32(dst + i, (load32(dst + i) & ~m) | (load32(src + i) & m));
+    }
+    for (; i < n; ++i) {
+        if (table_ops_bit(mask_bits, i)) { dst[i] = src[i]; }
+    }
+}
+
+uint16_t table_ops_diff_u8(const uint8_t* a, const uint8_t* b, uint16_t n,
+                           uint8_t* diff_bits) noexcept {
+    if (diff_bits != nullptr) {
+        std::memset(diff_bits, 0, (static_cast<uint32_t>(n) + 7u) / 8u);
+    }
+    uint16_t count = 0u;
+    uint16_t i = 0u;
+    for (; static_cast<uint16_t>(i + 4u) <= n; i = static_cast<uint16_t>(i + 4u)) {
+        const uint32_t x = load32(a + i) ^ load32(b + i);
+        if (x == 0u) { continue; }  // palavra igual — caso dominante num diff
+        for (uint16_t k = 0u; k < 4u; ++k) {
+            if (((x >> (8u * k)) & 0xFFu) != 0u) {
+                ++count;
+                if (diff_bits != nullptr) { set_bit(diff_bits, static_cast<uint16_t>(i + k)); }
+            }
+        }
+    }
+    for (; i < n; ++i) {
+        if (a[i] != b[i]) {
+            ++count;
+            if (diff_bits != nullptr) { set_bit(diff_bits, i); }
+        }
+    }
+    return count;
+}
+
+uint32_t table_ops_crc32(const uint8_t* data, uint32_t len) noexcept {
+    return ems::hal::crc32_calc(data, len);
+}
+
+}  // namespace ems::engine
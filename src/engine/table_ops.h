@@ -0,0 +1,67 @@
+#pragma once
+
+/**
+ * @file engine/table_ops.h
+ * @brief Operações em lote sobre tabelas inteiras (células contíguas).
+ *
+ * Para passagens de tabela inteira fora do caminho de combustível — apply
+ * do acumulador LTFT (fuel_trim), interpolação em carga do re-eixo
+ * (table_reaxis), diff das páginas editadas pelo tuner (ui_protocol_pages).
+ * Opera sobre vectores planos (uma tabela 20×20 row-major = kTableCells
+ * células).
+ *
+ * No alvo (Cortex-M33 com extensão DSP) o corpo processa 4 células u8/i8
+ * por palavra de 32 bits com as instruções SIMD de saturação (UQADD8,
+ * UQSUB8, SSUB8/USUB8 + SEL) e SMLAD para médias ponderadas; no host
+ * as mesmas funções-lane são emuladas em C portátil, com a MESMA semântica
+ * (saturação, arredondamento) — os testes host exercitam o mesmo laço por
+ * palavra que corre no alvo. Cauda (n % 4) célula a célula.
+ *
+ * Ponteiros sem requisito de alinhamento. dst e src podem coincidir (in
+ * place), mas não sobrepor parcialmente.
+ *
+ * Máscaras de bits: célula i ↔ bit (i & 7) do byte i >> 3 (LSB primeiro);
+ * buffers de (n + 7) / 8 bytes.
+ */
+
+#include <cstdint>
+
+namespace ems::engine {
+
+// dst[i] = sat_u8(dst[i] + delta[i]), delta com sinal (−128…+127).
+void table_ops_add_sat_u8(uint8_t* dst, const int8_t* delta, uint16_t n) noexcept;
+
+// Bake LTFT (mesma regra do commit de célula), sem escrever t: células com
+// trim_x10[i] ≠ 0 passariam a round(t × (1000 + trim) / 1000); se o
+// arredondamento não mexer, ±1 no sentido do trim; clamp [lo, hi]. delta[i]
+// recebe o passo (0 nas restantes; saturado a ±127 — muito além do que o
+// acumulador produz) para aplicar com table_ops_add_sat_u8. Células que
+// mudam ficam com o bit a 1 em changed_bits (obrigatório). Devolve quantas.
+uint16_t table_ops_trim_delta_u8_x10(const uint8_t* t, const int16_t* trim_x10,
+                                     uint16_t n, uint8_t lo, uint8_t hi,
+                                     int8_t* delta, uint8_t* changed_bits) noexcept;
+
+// dst[i] = round(dst[i] + (src[i] − dst[i]) × alpha_q8 / 256), alpha 0…256
+// (0 = mantém dst, 256 = copia src).
+void table_ops_blend_u8(uint8_t* dst, const uint8_t* src, uint16_t n,
+                        uint16_t alpha_q8) noexcept;
+void table_ops_blend_s16(int16_t* dst, const int16_t* src, uint16_t n,
+                         uint16_t alpha_q8) noexcept;
+
+// dst[i] = src[i] só onde o bit i de mask_bits está a 1.
+void table_ops_copy_masked_u8(uint8_t* dst, const uint8_t* src,
+                              const uint8_t* mask_bits, uint16_t n) noexcept;
+
+// Nº de células com a[i] ≠ b[i]; diff_bits (opcional, nullptr = só contar)
+// recebe a máscara das diferentes.
+uint16_t table_ops_diff_u8(const uint8_t* a, const uint8_t* b, uint16_t n,
+                           uint8_t* diff_bits) noexcept;
+
+// CRC-32 ISO-HDLC — hal::crc32_calc, uma só implementação no tree.
+uint32_t table_ops_crc32(const uint8_t* data, uint32_t len) noexcept;
+
+inline bool table_ops_bit(const uint8_t* bits, uint16_t i) noexcept {
+    return ((bits[i >> 3u] >> (i & 7u)) & 1u) != 0u;
+}
+
+}  // namespace ems::engine
@@ -0,0 +1,331 @@
+/**
+ * @file engine/table_reaxis.cpp
+ * @brief Job de re-eixo: re-amostragem bilinear (RPM em Q16, carga por
+ *        table_ops_blend) para staging + commit.
+ */
+#include "engine/table_reaxis.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "engine/calibration.h"
+#include "engine/fuel_trim.h"
+#include "engine/knock_learn.h"
+#include "engine/table_ops.h"
+
+namespace {
+
+using ems::engine::kKnockLearnDim;
+using ems::engine::kKnockLearnNodes;
+using ems::engine::kLtftAddAxisSize;
+using ems::engine::kTableAxisSize;
+using ems::engine::kTableCells;
+
+constexpr uint8_t  kN  = kTableAxisSize;
+constexpr uint8_t  kNA = kLtftAddAxisSize;
+constexpr uint8_t  kNK = kKnockLearnDim;
+constexpr uint16_t kAddCells = static_cast<uint16_t>(kNA) * kNA;
+constexpr uint32_t kOneQ16 = 65536u;
+
+enum class JobState : uint8_t { kIdle, kSettle, kRunning };
+
+// Posição no eixo antigo: segmento i..i+1, fracção 0…65536.
+struct AxisPos {
+    uint8_t  i;
+    uint32_t f_q16;
+};
+
+// Fontes vigiadas pelo CRC: tabelas de calibração + mapas LTFT + knock aprendido.
+constexpr uint8_t kSources = 6u;
+
+struct ReaxisJob {
+    uint16_t rpm[kN];
+    uint16_t load[kN];
+    AxisPos  xs[kN];
+    AxisPos  ys[kN];
+    AxisPos  xs_add[kNA];
+    AxisPos  ys_add[kNA];
+    AxisPos  xs_knock[kNK];
+    AxisPos  ys_knock[kNK];
+    uint32_t src_crc[kSources];
+    JobState state;
+    uint8_t  settle;
+    uint8_t  row;
+    bool     learned_only;   // tabelas de calibração repostas pelo chamador
+};
+
+ReaxisJob g_job = {};
+uint16_t  g_commits = 0u;
+
+uint8_t g_stage_ve[kN][kN] = {};
+int8_t  g_stage_spark[kN][kN] = {};
+int16_t g_stage_lambda[kN][kN] = {};
+int16_t g_stage_ltft[kTableCells] = {};
+int16_t g_stage_ltft_add[kAddCells] = {};
+int32_t g_stage_knock[ems::engine::kKnockLearnCells] = {};
+
+// Linha antiga ys.i + 1 já interpolada em RPM (segundo operando do blend).
+uint8_t g_row_u8[kN] = {};
+int16_t g_row_s16[kN] = {};
+
+// stride: passo entre nós usados (2 = sub-grid LTFT aditivo, nós pares).
+AxisPos axis_pos(const uint32_t* axis, uint8_t n, uint8_t stride, uint32_t v) noexcept {
+    AxisPos p{0u, 0u};
+    const uint8_t last = static_cast<uint8_t>(n - 1u);
+    if (v <= axis[0]) {
+        return p;
+    }
+    if (v >= axis[last * stride]) {
+        p.i = static_cast<uint8_t>(last - 1u);
+        p.f_q16 = kOneQ16;
+        return p;
+    }
+    uint8_t i = 0u;
+    while (v >= axis[(i + 1u) * stride]) {
+        ++i;
+    }
+    const uint32_t x0 = axis[i * stride];
+    const uint32_t x1 = axis[(i + 1u) * stride];
+    p.i = i;
+    p.f_q16 = static_cast<uint32_t>(
+        (static_cast<uint64_t>(v - x0) << 16u) / (x1 - x0));
+    return p;
+}
+
+template <typename T>
+int32_t sample(const T* src, uint8_t dim, const AxisPos& y, const AxisPos& x) noexcept {
+    const T* r0 = src + static_cast<uint16_t>(y.i) * dim + x.i;
+    const T* r1 = r0 + dim;
+    const int64_t fx = x.f_q16;
+    const int64_t fy = y.f_q16;
+    const int64_t a = static_cast<int64_t>(r0[0]) * (kOneQ16 - fx) + static_cast<int64_t>(r0[1]) * fx;
+    const int64_t b = static_cast<int64_t>(r1[0]) * (kOneQ16 - fx) + static_cast<int64_t>(r1[1]) * fx;
+    const int64_t v = a * (kOneQ16 - fy) + b * fy;
+    // floor(v / 2^32 + 0.5) — shift aritmético.
+    return static_cast<int32_t>((v + (int64_t{1} << 31u)) >> 32u);
+}
+
+void source_crcs(uint32_t out[kSources]) noexcept {
+    using namespace ems::engine;
+    out[0] = table_ops_crc32(&ve_table[0][0], sizeof(ve_table));
+    out[1] = table_ops_crc32(reinterpret_cast<const uint8_t*>(&spark_table[0][0]),
+                             sizeof(spark_table));
+    out[2] = table_ops_crc32(reinterpret_cast<const uint8_t*>(&lambda_target_table_x1000[0][0]),
+                             sizeof(lambda_target_table_x1000));
+    out[3] = table_ops_crc32(reinterpret_cast<const uint8_t*>(fuel_ltft_pct_cells()),
+                             2u * kTableCells);
+    out[4] = table_ops_crc32(reinterpret_cast<const uint8_t*>(fuel_ltft_add_cells()),
+                             2u * kAddCells);
+    out[5] = table_ops_crc32(reinterpret_cast<const uint8_t*>(knock_learn_cells()),
+                             4u * kKnockLearnCells);
+}
+
+// Posições dos nós novos na grelha antiga (eixos vigentes) + CRC das fontes.
+void job_start() noexcept {
+    using namespace ems::engine;
+    for (uint8_t i = 0u; i < kN; ++i) {
+        g_job.xs[i] = axis_pos(kRpmAxisX10, kN, 1u, static_cast<uint32_t>(g_job.rpm[i]) * 10u);
+        g_job.ys[i] = axis_pos(kLoadAxisBarX100, kN, 1u, g_job.load[i]);
+    }
+    for (uint8_t i = 0u; i < kNA; ++i) {
+        const uint8_t node = static_cast<uint8_t>(i << 1u);
+        g_job.xs_add[i] = axis_pos(kRpmAxisX10, kNA, 2u,
+                                   static_cast<uint32_t>(g_job.rpm[node]) * 10u);
+        g_job.ys_add[i] = axis_pos(kLoadAxisBarX100, kNA, 2u, g_job.load[node]);
+    }
+    // Knock aprendido: nós irregulares — eixo antigo da grelha em cópia.
+    uint32_t k_rpm[kNK];
+    uint32_t k_load[kNK];
+    for (uint8_t i = 0u; i < kNK; ++i) {
+        k_rpm[i] = kRpmAxisX10[kKnockLearnNodes[i]];
+        k_load[i] = kLoadAxisBarX100[kKnockLearnNodes[i]];
+    }
+    for (uint8_t i = 0u; i < kNK; ++i) {
+        const uint8_t node = kKnockLearnNodes[i];
+        g_job.xs_knock[i] = axis_pos(k_rpm, kNK, 1u, static_cast<uint32_t>(g_job.rpm[node]) * 10u);
+        g_job.ys_knock[i] = axis_pos(k_load, kNK, 1u, g_job.load[node]);
+    }
+    source_crcs(g_job.src_crc);
+    g_job.row = 0u;
+    g_job.state = JobState::kRunning;
+}
+
+// Passo em RPM de uma linha antiga: out[x] = round(lerp(row, xs[x])).
+// bias desloca o resultado (128 = i8 → u8 em binário deslocado).
+template <typename T, typename U>
+void lerp_row(const T* row, const AxisPos* xs, uint8_t nx, U* out, int32_t bias) noexcept {
+    for (uint8_t x = 0u; x < nx; ++x) {
+        const int64_t fx = xs[x].f_q16;
+        const T* p = row + xs[x].i;
+        const int64_t v = static_cast<int64_t>(p[0]) * (kOneQ16 - fx) + static_cast<int64_t>(p[1]) * fx;
+        out[x] = static_cast<U>(static_cast<int32_t>((v + (int64_t{1} << 15u)) >> 16u) + bias);
+    }
+}
+
+// Fracção Q16 → peso Q8 do blend em carga (0…256).
+uint16_t alpha_q8(const AxisPos& p) noexcept {
+    return static_cast<uint16_t>((p.f_q16 + 128u) >> 8u);
+}
+
+// Bilinear separável: RPM escalar nas duas linhas antigas que cercam a
+// linha nova, carga por table_ops_blend (SMLAD no alvo) sobre a linha toda.
+// Interpolação de vizinhos nunca sai da gama do tipo — sem saturação.
+void resample_cal_row(uint8_t y, uint16_t a, uint16_t r0, uint16_t r1) noexcept {
+    using namespace ems::engine;
+    lerp_row(&ve_table[0][0] + r0, g_job.xs, kN, &g_stage_ve[y][0], 0);
+    lerp_row(&ve_table[0][0] + r1, g_job.xs, kN, g_row_u8, 0);
+    table_ops_blend_u8(&g_stage_ve[y][0], g_row_u8, kN, a);
+
+    // Avanço i8 em binário deslocado para o blend u8.
+    uint8_t spark_u8[kN];
+    lerp_row(&spark_table[0][0] + r0, g_job.xs, kN, spark_u8, 128);
+    lerp_row(&spark_table[0][0] + r1, g_job.xs, kN, g_row_u8, 128);
+    table_ops_blend_u8(spark_u8, g_row_u8, kN, a);
+    for (uint8_t x = 0u; x < kN; ++x) {
+        g_stage_spark[y][x] = static_cast<int8_t>(static_cast<int32_t>(spark_u8[x]) - 128);
+    }
+
+    lerp_row(&lambda_target_table_x1000[0][0] + r0, g_job.xs, kN, &g_stage_lambda[y][0], 0);
+    lerp_row(&lambda_target_table_x1000[0][0] + r1, g_job.xs, kN, g_row_s16, 0);
+    table_ops_blend_s16(&g_stage_lambda[y][0], g_row_s16, kN, a);
+}
+
+void resample_row(uint8_t y) noexcept {
+    using namespace ems::engine;
+    const AxisPos& py = g_job.ys[y];
+    const uint16_t a = alpha_q8(py);
+    const uint16_t r0 = static_cast<uint16_t>(py.i) * kN;
+    const uint16_t r1 = static_cast<uint16_t>(r0 + kN);
+
+    if (!g_job.learned_only) {
+        resample_cal_row(y, a, r0, r1);
+    }
+
+    int16_t* const ltft = &g_stage_ltft[static_cast<uint16_t>(y) * kN];
+    lerp_row(fuel_ltft_pct_cells() + r0, g_job.xs, kN, ltft, 0);
+    lerp_row(fuel_ltft_pct_cells() + r1, g_job.xs, kN, g_row_s16, 0);
+    table_ops_blend_s16(ltft, g_row_s16, kN, a);
+
+    if (y < kNA) {
+        const AxisPos& qy = g_job.ys_add[y];
+        const uint16_t q0 = static_cast<uint16_t>(qy.i) * kNA;
+        int16_t* const add = &g_stage_ltft_add[static_cast<uint16_t>(y) * kNA];
+        lerp_row(fuel_ltft_add_cells() + q0, g_job.xs_add, kNA, add, 0);
+        lerp_row(fuel_ltft_add_cells() + q0 + kNA, g_job.xs_add, kNA, g_row_s16, 0);
+        table_ops_blend_s16(add, g_row_s16, kNA, alpha_q8(qy));
+    }
+    // Knock aprendido: int32 Q16 — fora do alcance dos lanes de 16 bits.
+    if (y < kNK) {
+        const AxisPos& ky = g_job.ys_knock[y];
+        for (uint8_t x = 0u; x < kNK; ++x) {
+            g_stage_knock[y * kNK + x] = sample(knock_learn_cells(), kNK, ky, g_job.xs_knock[x]);
+        }
+    }
+}
+
+bool axes_equal_current(const uint16_t rpm[kN], const uint16_t load[kN]) noexcept {
+    uint16_t cur_rpm[kN];
+    uint16_t cur_load[kN];
+    ems::engine::table_axes_get(cur_rpm, cur_load);
+    return std::memcmp(cur_rpm, rpm, sizeof(cur_rpm)) == 0 &&
+           std::memcmp(cur_load, load, sizeof(cur_load)) == 0;
+}
+
+}  // namespace
+
+namespace ems::engine {
+
+bool table_reaxis_request(const uint16_t rpm[kTableAxisSize],
+                          const uint16_t load_bar_x100[kTableAxisSize]) noexcept {
+    if (!table_axes_valid(rpm, load_bar_x100)) {
+        return false;
+    }
+    if (axes_equal_current(rpm, load_bar_x100)) {
+        g_job.state = JobState::kIdle;
+        return true;
+    }
+    std::memcpy(g_job.rpm, rpm, sizeof(g_job.rpm));
+    std::memcpy(g_job.load, load_bar_x100, sizeof(g_job.load));
+    g_job.settle = 0u;
+    g_job.learned_only = false;
+    g_job.state = JobState::kSettle;
+    return true;
+}
+
+bool table_reaxis_request_learned(const uint16_t rpm[kTableAxisSize],
+                                  const uint16_t load_bar_x100[kTableAxisSize]) noexcept {
+    if (!table_axes_valid(rpm, load_bar_x100)) {
+        return false;
+    }
+    std::memcpy(g_job.rpm, rpm, sizeof(g_job.rpm));
+    std::memcpy(g_job.load, load_bar_x100, sizeof(g_job.load));
+    g_job.learned_only = true;
+    job_start();
+    return true;
+}
+
+bool table_reaxis_learned_only() noexcept {
+    return g_job.state != JobState::kIdle && g_job.learned_only;
+}
+
+bool table_reaxis_pending() noexcept {
+    return g_job.state != JobState::kIdle;
+}
+
+bool table_reaxis_target_get(uint16_t rpm[kTableAxisSize],
+                             uint16_t load_bar_x100[kTableAxisSize]) noexcept {
+    if (g_job.state == JobState::kIdle) {
+        return false;
+    }
+    std::memcpy(rpm, g_job.rpm, sizeof(g_job.rpm));
+    std::memcpy(load_bar_x100, g_job.load, sizeof(g_job.load));
+    return true;
+}
+
+void table_reaxis_cancel() noexcept {
+    g_job.state = JobState::kIdle;
+}
+
+bool table_reaxis_process(uint8_t max_rows) noexcept {
+    if (g_job.state == JobState::kIdle) {
+        return false;
+    }
+    if (g_job.state == JobState::kSettle) {
+        if (++g_job.settle < kReaxisSettleCalls) {
+            return false;
+        }
+        job_start();
+    }
+    for (uint8_t n = 0u; n < max_rows && g_job.row < kN; ++n) {
+        resample_row(g_job.row);
+        ++g_job.row;
+    }
+    if (g_job.row < kN) {
+        return false;
+    }
+
+    uint32_t crc_now[kSources];
+    source_crcs(crc_now);
+    if (std::memcmp(crc_now, g_job.src_crc, sizeof(crc_now)) != 0) {
+        job_start();  // fonte editada a meio do job — staging incoerente
+        return false;
+    }
+
+    if (!g_job.learned_only) {
+        std::memcpy(ve_table, g_stage_ve, sizeof(ve_table));
+        std::memcpy(spark_table, g_stage_spark, sizeof(spark_table));
+        std::memcpy(lambda_target_table_x1000, g_stage_lambda, sizeof(lambda_target_table_x1000));
+    }
+    fuel_ltft_replace_maps(g_stage_ltft, g_stage_ltft_add);
+    knock_learn_replace_map(g_stage_knock);
+    (void)table_axes_set(g_job.rpm, g_job.load);  // validado no pedido
+    g_job.state = JobState::kIdle;
+    ++g_commits;
+    return true;
+}
+
+uint16_t table_reaxis_commit_count() noexcept {
+    return g_commits;
+}
+
+}  // namespace ems::engine
@@ -0,0 +1,73 @@
+#pragma once
+
+/**
+ * @file engine/table_reaxis.h
+ * @brief Mudança de eixos 20×20 com re-amostragem das tabelas dependentes.
+ *
+ * table_axes_set() só troca os eixos: cada célula passaria a valer noutro
+ * ponto de operação. Aqui o pedido (página 11) vira um job de fundo que
+ * re-amostra bilinearmente, na grelha nova, tudo o que é indexado pelos
+ * eixos principais — VE, avanço, lambda alvo, LTFT multiplicativo, o
+ * sub-grid LTFT aditivo (nós pares) e o mapa aprendido de knock (8 nós,
+ * engine/knock_learn) — e publica eixos + tabelas num só
+ * passo do main loop. Como todos os consumidores (fuel/ign/LTFT) correm no
+ * main loop, nunca vêem uma grelha nova com tabelas velhas.
+ *
+ * Fases:
+ *   settle  — kReaxisSettleCalls passos sem novo pedido (o tuner escreve a
+ *             página em chunks; cada chunk válido reinicia a espera, para não
+ *             re-amostrar por cada eixo intermédio);
+ *   running — max_rows linhas de carga por passo para buffers de staging;
+ *             as fontes não mudam (CRC no início e no fim; edição a meio do
+ *             job → recomeça);
+ *   commit  — memcpy das tabelas, table_axes_set, mapas LTFT via
+ *             fuel_ltft_replace_maps (acumulador descartado), knock via
+ *             knock_learn_replace_map.
+ *
+ * Fora do intervalo dos eixos antigos o valor é o da borda (igual ao lookup
+ * de runtime). Eixos iguais aos actuais = identidade exacta (fracções Q16,
+ * nós coincidentes caem em frac 0).
+ */
+
+#include <cstdint>
+
+#include "engine/table3d.h"
+
+namespace ems::engine {
+
+// Passos de espera após o último pedido (ui_process corre a cada 2 ms → 200 ms).
+constexpr uint8_t kReaxisSettleCalls = 100u;
+// Linhas de carga re-amostradas por passo (5 passos por job de 20 linhas).
+constexpr uint8_t kReaxisRowsPerCall = 4u;
+
+// Pede novos eixos (forma da página 11). false = eixos inválidos, nada muda.
+// Eixos iguais aos actuais cancelam qualquer pedido pendente.
+bool table_reaxis_request(const uint16_t rpm[kTableAxisSize],
+                          const uint16_t load_bar_x100[kTableAxisSize]) noexcept;
+
+// Rollback da flash: eixos e VE/avanço/lambda voltam exactos da cópia
+// anterior, logo só os mapas aprendidos (LTFT, knock) são re-amostrados —
+// sem settle. O chamador repõe as tabelas no passo que publica os eixos
+// (table_reaxis_process devolve true). Um table_reaxis_request posterior
+// substitui o pedido e volta ao modo completo.
+bool table_reaxis_request_learned(const uint16_t rpm[kTableAxisSize],
+                                  const uint16_t load_bar_x100[kTableAxisSize]) noexcept;
+
+// Pedido pendente é do modo table_reaxis_request_learned.
+bool table_reaxis_learned_only() noexcept;
+
+// Há pedido por publicar (settle ou running).
+bool table_reaxis_pending() noexcept;
+
+// Eixos do pedido pendente na forma da página 11; false se não há pedido.
+bool table_reaxis_target_get(uint16_t rpm[kTableAxisSize],
+                             uint16_t load_bar_x100[kTableAxisSize]) noexcept;
+
+void table_reaxis_cancel() noexcept;
+
+// Um passo do job (main loop). true no passo que publicou eixos + tabelas.
+bool table_reaxis_process(uint8_t max_rows) noexcept;
+
+uint16_t table_reaxis_commit_count() noexcept;
+
+}  // namespace ems::engine
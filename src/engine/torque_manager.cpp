@@ -3,7 +3,8 @@
  * @brief Gerenciador de Torque
  *
  * Produção: ems::engine::torque_manager_update (inteiro) — main 2 ms.
- * Host:     torque_manager_loop (float) — só EMS_HOST_TEST.
+ * Host:     torque_manager_loop (float) e a referência float do pedal map /
+ *           corte TC-launch — só EMS_HOST_TEST.
  */
 
 #include "torque_manager.h"
@@ -157,6 +158,29 @@ const torque_manager_config_t* torque_manager_get_config(void) {
     return &g_config;
 }
 
+namespace ems::engine {
+
+// Referência float do pedal map + corte (mesma geometria de
+// torque_pedal_target_x10: pontos a 0,10,…,90 %, plano acima de 90 %).
+float torque_pedal_target_ref(float app_pct) noexcept {
+    const uint8_t mode = static_cast<uint8_t>(etb_get_drive_mode());
+    if (mode >= 4u) { return 0.0f; }
+    if (app_pct < 0.0f) { app_pct = 0.0f; }
+    if (app_pct >= 90.0f) { return etb_pedal_map[mode][9] / 10.0f; }
+    const float pos = app_pct / 10.0f;
+    const int idx = static_cast<int>(pos);
+    const float lo = etb_pedal_map[mode][idx] / 10.0f;
+    const float hi = etb_pedal_map[mode][idx + 1] / 10.0f;
+    return lo + (hi - lo) * (pos - static_cast<float>(idx));
+}
+
+float torque_apply_cut_ref(float target_pct, float cut_pct) noexcept {
+    if (cut_pct >= 100.0f) { return 0.0f; }
+    return target_pct * (1.0f - cut_pct / 100.0f);
+}
+
+}  // namespace ems::engine
+
 #endif  // EMS_HOST_TEST
 
 // ── API inteira de produção ────────────────────────────────────────────────
@@ -229,7 +253,7 @@ static uint16_t g_can_wheel_kmh   = 0u;
 // 10 pontos em pedal 0%,10%,…,90% (índices 0..9); 100% pedal → ponto [9].
 // Segmentos interpolados: [i]→[i+1] para i=0..8 (app 0..899).
 // app 900..999: flat no ponto [9] (antes lia [10] → OOB).
-static uint16_t pedal_map_lookup(uint16_t app_x10) noexcept {
+uint16_t torque_pedal_target_x10(uint16_t app_x10) noexcept {
     const uint8_t mode = static_cast<uint8_t>(etb_get_drive_mode());
     if (mode >= 4u) { return 0u; }
     if (app_x10 >= 900u) { return etb_pedal_map[mode][9]; }
@@ -238,7 +262,13 @@ static uint16_t pedal_map_lookup(uint16_t app_x10) noexcept {
     const uint16_t lo   = etb_pedal_map[mode][idx];
     const uint16_t hi   = etb_pedal_map[mode][idx + 1u];
     return static_cast<uint16_t>(
-        lo + (static_cast<uint32_t>(hi - lo) * frac) / 100u);
+        lo + (static_cast<int32_t>(hi - lo) * static_cast<int32_t>(frac)) / 100);
+}
+
+uint16_t torque_apply_cut_x10(uint16_t target_x10, uint16_t cut_x10) noexcept {
+    if (cut_x10 >= 1000u) { return 0u; }
+    return static_cast<uint16_t>(
+        (static_cast<uint32_t>(target_x10) * (1000u - cut_x10)) / 1000u);
 }
 
 static bool launch_is_enabled() noexcept {
@@ -321,7 +351,7 @@ TorqueOutput torque_manager_update(
     }
 
     // Base target from driver pedal — apply response map
-    uint16_t target_x10 = pedal_map_lookup(sensors.app_pct_x10);
+    uint16_t target_x10 = torque_pedal_target_x10(sensors.app_pct_x10);
 
     // Limp mode: clamp to etb_max_open_pct_x10_limp
     if ((out.limp_reason & (TORQUE_LIMP_MAP_CLT | TORQUE_LIMP_APP_FAULT)) != 0u) {
@@ -430,8 +460,7 @@ TorqueOutput torque_manager_update(
                 // 500 rpm_x10 over → full cut of remaining
                 uint32_t cut = (over * 1000u) / 5000u;
                 if (cut > 1000u) { cut = 1000u; }
-                target_x10 = static_cast<uint16_t>(
-                    (static_cast<uint32_t>(target_x10) * (1000u - cut)) / 1000u);
+                target_x10 = torque_apply_cut_x10(target_x10, static_cast<uint16_t>(cut));
                 // Mild spark retard when far over (up to 8°)
                 const int16_t retard = static_cast<int16_t>((over * 8u) / 5000u);
                 spark_retard = (retard > 8) ? 8 : retard;
@@ -550,8 +579,7 @@ TorqueOutput torque_manager_update(
         tc_red = g_tc_reduction_x10;
         if (tc_red > 0u) {
             out.limp_reason |= TORQUE_ACTIVE_TC;
-            target_x10 = static_cast<uint16_t>(
-                (static_cast<uint32_t>(target_x10) * (1000u - tc_red)) / 1000u);
+            target_x10 = torque_apply_cut_x10(target_x10, tc_red);
             // Spark retard proportional to reduction (up to tc_spark_retard_max_deg)
             const uint16_t max_ret = (tc_spark_retard_max_deg > 30u)
                 ? 12u : tc_spark_retard_max_deg;
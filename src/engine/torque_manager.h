@@ -83,6 +83,17 @@ TorqueOutput torque_manager_update(
     bool key_on, bool map_clt_limp, bool rev_cut,
     uint16_t idle_target_rpm_x10, uint16_t period_ms) noexcept;
 
+// Estágios inteiros do pipeline (pct×10), expostos para equivalência/bench:
+// pedal map do drive mode actual; corte proporcional (TC / launch, 0–1000).
+uint16_t torque_pedal_target_x10(uint16_t app_x10) noexcept;
+uint16_t torque_apply_cut_x10(uint16_t target_x10, uint16_t cut_x10) noexcept;
+
+#if defined(EMS_HOST_TEST)
+// Referência float dos mesmos estágios (pct).
+float torque_pedal_target_ref(float app_pct) noexcept;
+float torque_apply_cut_ref(float target_pct, float cut_pct) noexcept;
+#endif
+
 // Runtime hooks (tests / future CAN)
 void torque_tc_set_external_slip_pct_x10(uint16_t slip_pct_x10) noexcept;
 void torque_tc_clear_external_slip() noexcept;
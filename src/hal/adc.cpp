@@ -24,8 +24,21 @@
  *
  * Trigger: TIM6 TRGO (Update Event) disparado pela ckp adc_trigger_on_tooth().
  *   TIM6 → prescaler configura período → TRGO → ADC1 + ADC2 disparo simultâneo
+ *   Só o dente arma o TIM6. A malha ETB tem a injectada do ADC1 (ETB_TPS1/2,
+ *   JEXTEN=00) e dispara-a por software com adc_primary_kick().
  *
- * Resolução: 12 bits (RES=00)
+ * MAP síncrona ao ângulo = SQ1 da sequência regular do ADC1. Como só o TRGO
+ *   do dente (½ passo depois dele) arranca a regular, cada SQ1 pertence a um
+ *   dente; adc_map_sync_take() recolhe-o do buffer do GPDMA no dente seguinte.
+ *   A 1.ª versão convertia a MAP numa injectada no mesmo TRGO (JEXTEN≠00),
+ *   mas no H5 o grupo injectado tem uma só configuração de trigger e o
+ *   JADSTART só converte com JEXTEN=00 (não há JSWSTART): a MAP não pode
+ *   partilhar o grupo com o kick por software da ETB. A injectada ficou para a
+ *   ETB; a MAP perde no máximo 15 µs quando uma injectada a preempta.
+ *
+ * Resolução: 12 bits (RES=00); oversampler regular ADC1 8× / ADC2 16× → 14 bits
+ *   (1 trigger = N conversões por canal; ADC1 8×8×0.96 µs = 61 µs, ADC2
+ *   5×16×0.96 µs = 77 µs — cabem no meio dente a 9000 rpm numa 60-2).
  * Amostragem: 47.5 ciclos ADC (melhor SNR para sensores de temperatura)
  * Clock ADC: HCLK/4 = 62.5 MHz (CKMODE[1:0] = 11, síncrono ao timer)
  */
@@ -33,11 +46,18 @@
 #ifndef EMS_HOST_TEST
 
 #include "hal/adc.h"
+#include "hal/adc_cic.h"
 #include "hal/regs.h"
 
 // ── Cache das últimas leituras ADC ───────────────────────────────────────────
+// Destino do GPDMA: resultado do oversampler (14 bits, escala ×4).
 static volatile uint16_t g_adc_secondary_raw[8] = {};  // canais ADC1 IN3-IN10
 static volatile uint16_t g_adc2_raw[5] = {};  // canais ADC2: CLT,IAT,FUEL,OIL,EWG
+// Saída dos decimadores CIC (escala ×16), actualizada no IRQ de fim de bloco.
+static volatile uint16_t g_adc1_x16[8] = {};
+static volatile uint16_t g_adc2_x16[5] = {};
+static ems::hal::CicDecimator g_adc1_cic[8] = {};
+static ems::hal::CicDecimator g_adc2_cic[5] = {};
 
 // LLI auto-referente por canal (CBR1, CDAR, CLLR) — torna o GPDMA contínuo: ao fim
 // de cada bloco recarrega tamanho+destino e re-aponta pra si mesmo. Em SRAM (.bss),
@@ -45,6 +65,10 @@ static volatile uint16_t g_adc2_raw[5] = {};  // canais ADC2: CLT,IAT,FUEL,OIL,E
 alignas(32) static volatile uint32_t g_adc1_lli[3] = {};
 alignas(32) static volatile uint32_t g_adc2_lli[3] = {};
 
+// MAP síncrona ao ângulo: o dente armou o TIM6 e o SQ1 desse TRGO ainda não
+// foi recolhido por adc_map_sync_take.
+static volatile bool g_map_sync_armed = false;
+
 static volatile uint32_t g_adc_dma_faults = 0u;
 static volatile uint32_t g_adc_init_faults = 0u;  // FIX: Fault counter para adc_wait_ready timeout
 
@@ -99,11 +123,73 @@ static constexpr uint32_t kAdc2Sqr1 = (4u << 0)    // L = 4 (5 conv)
                                      | (4u << 18)   // SQ3 = INP4 (FUEL_PRESS, PC4)
                                      | (11u << 24); // SQ4 = INP11 (OIL, PC1)
 static constexpr uint32_t kAdc2Sqr2 = (13u << 0);   // SQ5 = INP13 (EWG, PC3)
+static constexpr uint32_t kAdc2Smpr2 = (kSmpr << ((11-10)*3u))   // INP11 (OIL, PC1)
+                                     | (kSmpr << ((13-10)*3u));  // INP13 (EWG, PC3)
+// Oversampler: 8× (OVSR=010) soma 15 bits, shift 1; 16× (OVSR=011) soma 16
+// bits, shift 2 — ambos entregam 14 bits (×4 o LSB de 12 bits). TROVS=0: as
+// N conversões de cada canal correm seguidas a partir de um só trigger.
+static constexpr uint32_t kAdc1Cfgr2 = ADC_CFGR2_ROVSE | ADC_CFGR2_JOVSE
+                                     | ADC_CFGR2_OVSR(2u) | ADC_CFGR2_OVSS(1u);
+// Injectada: ETB_TPS1 (INP14) + ETB_TPS2 (INP8), JEXTEN=00 — só o JADSTART do
+// kick a dispara (2×8×0.96 µs = 15 µs). Preempta a sequência regular; o
+// oversampling regular retoma onde parou (ROVSM=0).
+static constexpr uint32_t kAdc1Jsqr = ADC_JSQR_JL(1u)
+                                    | ADC_JSQR_JSQ1(14u)
+                                    | ADC_JSQR_JSQ2(8u);
+// Bits rs do ADC_CR: escrever 1 num deles repete o comando — o kick escreve-os
+// a 0 (como o MODIFY_REG do LL) e só o JADSTART a 1.
+static constexpr uint32_t kAdcCrRsBits = ADC_CR_ADEN | ADC_CR_ADDIS | ADC_CR_ADSTART
+                                       | ADC_CR_JADSTART | ADC_CR_ADSTP
+                                       | ADC_CR_JADSTP | ADC_CR_ADCAL;
+static constexpr uint32_t kAdc2Cfgr2 = ADC_CFGR2_ROVSE | ADC_CFGR2_OVSR(3u) | ADC_CFGR2_OVSS(2u);
+static_assert(ems::hal::kAdcPrimaryOvsRatio == 8u && ems::hal::kAdcSecondaryOvsRatio == 16u,
+              "kAdc1Cfgr2/kAdc2Cfgr2 fora de sincronia com adc.h");
+// ADC2: trigger TIM6_TRGO simultâneo com o ADC1
+static constexpr uint32_t kAdc2Cfgr1 = ADC_CFGR1_RES_12BIT
+                                     | ADC_CFGR1_DMAEN
+                                     | ADC_CFGR1_DMACFG
+                                     | ADC_CFGR1_OVRMOD
+                                     | ADC_CFGR1_EXTSEL_TIM6_TRGO
+                                     | ADC_CFGR1_EXTEN_RISING;
+
+// ── Captura de knock no ADC2 (janela) ────────────────────────────────────────
+// INP19 (PA5) sozinho, contínuo por software (sem trigger), SMP=111 (640.5
+// ciclos): 62.5 MHz / 653 = 95.7 kS/s, sem timer dedicado. O buffer circular
+// de 2 blocos é servido por LLI auto-referente no mesmo canal GPDMA do ADC2.
+static constexpr uint32_t kKnockSmpr     = 0x07u;  // 640.5 ciclos
+static constexpr uint32_t kAdc2KnockSqr1 = (0u << 0) | (19u << 6);  // L=0, SQ1=INP19
+static constexpr uint32_t kAdc2KnockCfgr1 = ADC_CFGR1_RES_12BIT
+                                          | ADC_CFGR1_DMAEN
+                                          | ADC_CFGR1_DMACFG
+                                          | ADC_CFGR1_OVRMOD
+                                          | ADC_CFGR1_CONT;
+alignas(32) static volatile uint16_t g_knock_buf[2u * ems::hal::kAdcKnockBlock] = {};
+static volatile ems::hal::AdcKnockSink g_knock_sink = nullptr;
+// Pedido de captura (ISR do TIM5): a reconfiguração do ADC2/GPDMA corre no
+// PendSV — nullptr = sequência lenta. g_knock_hw_on = estado aplicado.
+static volatile ems::hal::AdcKnockSink g_knock_req = nullptr;
+static bool g_knock_hw_on = false;
 
 namespace ems::hal {
 
 // ── Funções auxiliares ───────────────────────────────────────────────────────
 
+static void adc_decim_init() noexcept {
+    for (uint8_t i = 0u; i < 8u; ++i) { g_adc1_cic[i] = CicDecimator(kAdcPrimaryDecimLog2[i]); }
+    for (uint8_t i = 0u; i < 5u; ++i) { g_adc2_cic[i] = CicDecimator(kAdcSecondaryDecimLog2[i]); }
+}
+
+// Integra uma sequência completa (chamado no IRQ de fim de bloco: o ADC só
+// recomeça no próximo TRGO, o buffer está estável).
+template <uint8_t N>
+static void adc_decim_push(const volatile uint16_t (&in)[N], CicDecimator (&cic)[N],
+                           volatile uint16_t (&out)[N]) noexcept {
+    for (uint8_t i = 0u; i < N; ++i) {
+        uint16_t y = 0u;
+        if (cic[i].push(in[i], y)) { out[i] = y; }
+    }
+}
+
 static bool adc_wait_ready(volatile uint32_t& isr) noexcept {
     // FIX BUG-11: o loop anterior não tratava timeout. Se o ADC não ficava
     // ready, o busy-wait consumia ~4 ms com PRIMASK ativo (interrupções
@@ -195,7 +281,7 @@ static void adc_enable(volatile uint32_t& cr, volatile uint32_t& isr) noexcept {
 
 static void gpdma_arm(uint32_t ch_base, uint32_t reqsel, uint32_t buf_bytes,
                       uint32_t src_dr, uint32_t dest_buf,
-                      volatile uint32_t* lli) noexcept {
+                      volatile uint32_t* lli, uint32_t ccr_extra = 0u) noexcept {
     GPDMA_REG(ch_base, GPDMA_CCR_OFF) = GPDMA_CCR_RESET;
     for (uint32_t i = 0u; i < 128u; ++i) {
         if ((GPDMA_REG(ch_base, GPDMA_CCR_OFF) & GPDMA_CCR_RESET) == 0u) { break; }
@@ -221,7 +307,7 @@ static void gpdma_arm(uint32_t ch_base, uint32_t reqsel, uint32_t buf_bytes,
     GPDMA_REG(ch_base, GPDMA_CLLBAR_OFF) = node & 0xFFFF0000u;  // base do LLI (high)
     GPDMA_REG(ch_base, GPDMA_CLLR_OFF)   = cllr;                // arma o link
 	GPDMA_REG(ch_base, GPDMA_CCR_OFF) = GPDMA_CCR_PRIO_HIGH | GPDMA_CCR_TCIE |
-		GPDMA_CCR_DTEIE | GPDMA_CCR_USEIE | GPDMA_CCR_EN;
+		GPDMA_CCR_DTEIE | GPDMA_CCR_USEIE | ccr_extra | GPDMA_CCR_EN;
 }
 
 static void gpdma_adc1_arm() noexcept {
@@ -295,17 +381,22 @@ ADC1_SMPR2 = (kSmpr << ((10-10)*3))   // IN10 (APP1, PC0)
     // Sequência de conversão ADC1
     ADC1_SQR1 = kAdc1Sqr1;
     ADC1_SQR2 = kAdc1Sqr2;
+    ADC1_CFGR2 = kAdc1Cfgr2;
+    ADC1_JSQR  = kAdc1Jsqr;
 
 	// CFGR1: 12-bit, trigger TIM6_TRGO rising, DMA circular (DMACFG=1) p/ o ADC
 	// requisitar DMA continuamente em cada sequência; OVRMOD=1 p/ overrun sobrescrever
 	// o DR em vez de travar o ADSTART. FIX: o "one-shot + re-arm no ISR" anterior
 	// parava de requisitar após a 1ª sequência e o OVR limpava ADSTART → ADC congelava.
+	// JQDIS=1 (valor de reset): a injectada da ETB usa um só contexto JSQR, sem a
+	// fila de contextos que a errata ES0565 pede para evitar.
 	ADC1_CFGR1 = ADC_CFGR1_RES_12BIT
 		| ADC_CFGR1_DMAEN
 		| ADC_CFGR1_DMACFG
 		| ADC_CFGR1_OVRMOD
 		| ADC_CFGR1_EXTSEL_TIM6_TRGO
-		| ADC_CFGR1_EXTEN_RISING;
+		| ADC_CFGR1_EXTEN_RISING
+		| ADC_CFGR1_JQDIS;
 
     // ── 5. Calibrar e configurar ADC2 ainda desabilitado ────────────────
     adc_prepare_for_config(ADC2_CR);
@@ -314,19 +405,13 @@ ADC1_SMPR2 = (kSmpr << ((10-10)*3))   // IN10 (APP1, PC0)
     ADC2_SMPR1 = (kSmpr << (4u * 3u))   // INP4  (FUEL, PC4)
                | (kSmpr << (5u * 3u))   // INP5  (IAT, PB1)
                | (kSmpr << (9u * 3u));  // INP9  (CLT, PB0)
-    ADC2_SMPR2 = (kSmpr << ((11-10)*3u))   // INP11 (OIL, PC1)
-               | (kSmpr << ((13-10)*3u));  // INP13 (EWG, PC3)
+    ADC2_SMPR2 = kAdc2Smpr2;
 
     ADC2_SQR1 = kAdc2Sqr1;
     ADC2_SQR2 = kAdc2Sqr2;
-
-// ADC2: trigger TIM6_TRGO simultâneo
-ADC2_CFGR1 = ADC_CFGR1_RES_12BIT
-	| ADC_CFGR1_DMAEN
-	| ADC_CFGR1_DMACFG
-	| ADC_CFGR1_OVRMOD
-	| ADC_CFGR1_EXTSEL_TIM6_TRGO
-	| ADC_CFGR1_EXTEN_RISING;
+    ADC2_CFGR1 = kAdc2Cfgr1;
+    ADC2_CFGR2 = kAdc2Cfgr2;
+    adc_decim_init();
 
     // ── 6. Configurar TIM6 como gerador de TRGO ───────────────────────────
     RCC_APB1LENR |= RCC_APB1LENR_TIM6EN;
@@ -346,13 +431,17 @@ ADC2_CFGR1 = ADC_CFGR1_RES_12BIT
     ems::hal::gpdma_adc2_arm();
     nvic_set_priority(IRQ_GPDMA1_CH0, 5u);
     nvic_set_priority(IRQ_GPDMA1_CH1, 5u);
+    // PendSV (captura de knock) na prioridade mínima: preemptado por tudo.
+    SCB_SHPR3 = (SCB_SHPR3 & ~(0xFFu << SCB_SHPR3_PENDSV_SHIFT)) |
+                (0xF0u << SCB_SHPR3_PENDSV_SHIFT);
     nvic_enable_irq(IRQ_GPDMA1_CH0);
     nvic_enable_irq(IRQ_GPDMA1_CH1);
 
     // ── 8. Habilitar ADCs e armar hardware trigger ──────────────────────
     adc_enable(ADC1_CR, ADC1_ISR);
     adc_enable(ADC2_CR, ADC2_ISR);
-    ADC1_CR |= ADC_CR_ADSTART;
+    // JADSTART com JEXTEN=00 já converte: 1.ª leitura da ETB antes do 1.º kick.
+    ADC1_CR |= ADC_CR_ADSTART | ADC_CR_JADSTART;
     ADC2_CR |= ADC_CR_ADSTART;
 }
 
@@ -371,20 +460,124 @@ void adc_trigger_on_tooth(uint32_t tooth_period_ticks) noexcept {
         TIM6_SR = 0u;
         TIM6_ARR = arr - 1u;
         TIM6_CNT = 0u;
+        g_map_sync_armed = true;
         TIM6_CR1 = TIM_CR1_OPM | TIM_CR1_URS | TIM_CR1_CEN;
     }
 }
 
-uint16_t adc_primary_read(AdcPrimaryChannel ch) noexcept {
+void adc_primary_kick() noexcept {
+    // Uma escrita no ADC1_CR, sem guarda: nenhuma ISR mais prioritária (TIM5)
+    // escreve no ADC1_CR, e o main loop não preempta a ISR da malha. Não toca
+    // no TIM6 nem no ADC2. Com o ADC desligado (recovery) ou a injectada
+    // anterior ainda em curso, não faz nada.
+    const uint32_t cr = ADC1_CR;
+    if ((cr & (ADC_CR_ADEN | ADC_CR_ADDIS | ADC_CR_JADSTART)) != ADC_CR_ADEN) { return; }
+    ADC1_CR = (cr & ~kAdcCrRsBits) | ADC_CR_JADSTART;
+}
+
+// Para conversões regulares do ADC2 (ADSTP espera o fim da conversão em
+// curso: ≤ 1 conversão, µs). Limite de iterações como em adc_wait_ready.
+static void adc2_stop() noexcept {
+    if ((ADC2_CR & ADC_CR_ADSTART) == 0u) { return; }
+    ADC2_CR |= ADC_CR_ADSTP;
+    for (uint32_t i = 0u; i < 30000u; ++i) {
+        if ((ADC2_CR & ADC_CR_ADSTP) == 0u) { return; }
+    }
+    ++g_adc_timeout_count;
+}
+
+// Início/fim da captura só registam o pedido e pendem o PendSV: o ADSTP
+// (espera o fim da conversão em curso) e o reset do canal GPDMA nunca correm
+// na ISR do TIM5. O PendSV tem a prioridade mínima — qualquer ISR o preempta.
+static void knock_capture_pend() noexcept {
+    SCB_ICSR = SCB_ICSR_PENDSVSET;
+}
+
+// PendSV: aplica ao ADC2 o último pedido. Um stop que preempte a
+// reconfiguração volta a pender o PendSV, que repõe a sequência lenta.
+static void knock_capture_apply() noexcept {
+    const AdcKnockSink want = g_knock_req;
+    if (want != nullptr && !g_knock_hw_on) {
+        adc2_stop();
+        ADC2_SQR1  = kAdc2KnockSqr1;
+        ADC2_SMPR2 = kAdc2Smpr2 | (kKnockSmpr << ((19-10)*3u));
+        ADC2_CFGR1 = kAdc2KnockCfgr1;
+        ADC2_CFGR2 = 0u;   // uma conversão por amostra de knock
+        gpdma_arm(GPDMA_CH1_BASE, GPDMA_CTR2_REQSEL_ADC2,
+                  sizeof(g_knock_buf),
+                  reinterpret_cast<uint32_t>(&ADC2_DR),
+                  reinterpret_cast<uint32_t>(&g_knock_buf[0]),
+                  g_adc2_lli, GPDMA_CCR_HTIE);
+        g_knock_hw_on = true;
+        g_knock_sink = want;
+        ADC2_CR |= ADC_CR_ADSTART;
+    } else if (want == nullptr && g_knock_hw_on) {
+        g_knock_sink = nullptr;
+        adc2_stop();
+        ADC2_SQR1  = kAdc2Sqr1;
+        ADC2_SMPR2 = kAdc2Smpr2;
+        ADC2_CFGR1 = kAdc2Cfgr1;
+        ADC2_CFGR2 = kAdc2Cfgr2;
+        gpdma_adc2_arm();
+        g_knock_hw_on = false;
+        ADC2_CR |= ADC_CR_ADSTART;   // re-arma à espera do TRGO do TIM6
+    }
+}
+
+void adc_knock_capture_start(AdcKnockSink sink) noexcept {
+    if (sink == nullptr || g_knock_req != nullptr) { return; }
+    g_knock_req = sink;
+    knock_capture_pend();
+}
+
+void adc_knock_capture_stop() noexcept {
+    if (g_knock_req == nullptr) { return; }
+    // Sink a nullptr antes do stop: um IRQ de DMA pendente descarta o bloco.
+    g_knock_req = nullptr;
+    g_knock_sink = nullptr;
+    knock_capture_pend();
+}
+
+bool adc_knock_capture_active() noexcept { return g_knock_req != nullptr; }
+
+bool adc_map_sync_take(uint16_t& x16) noexcept {
+    // TIM6 ainda a contar: o TRGO do dente anterior não chegou (o dente
+    // seguinte veio antes do ½ passo) — nada de novo.
+    if (!g_map_sync_armed || (TIM6_CR1 & TIM_CR1_CEN) != 0u) { return false; }
+    g_map_sync_armed = false;
+    // Só o TRGO do dente dispara a regular, e o SQ1 (7.7 µs, +15 µs se uma
+    // injectada da ETB o preemptar) acabou muito antes de meio passo depois.
+    x16 = static_cast<uint16_t>(g_adc_secondary_raw[kAdc1ChMap[0]] << 2u);
+    return true;
+}
+
+uint16_t adc_primary_read_fast_x16(AdcPrimaryChannel ch) noexcept {
+    // ETB: resultado da injectada do último kick (14 bits, ×4 → ×16).
+    if (ch == AdcPrimaryChannel::ETB_TPS1) { return static_cast<uint16_t>(ADC1_JDR1 << 2u); }
+    if (ch == AdcPrimaryChannel::ETB_TPS2) { return static_cast<uint16_t>(ADC1_JDR2 << 2u); }
     const uint8_t idx = static_cast<uint8_t>(ch);
     if (idx >= 8u) { return 0u; }
-    return g_adc_secondary_raw[kAdc1ChMap[idx]];
+    return static_cast<uint16_t>(g_adc_secondary_raw[kAdc1ChMap[idx]] << 2u);
 }
 
-uint16_t adc_secondary_read(AdcSecondaryChannel ch) noexcept {
+uint16_t adc_primary_read_x16(AdcPrimaryChannel ch) noexcept {
+    const uint8_t idx = static_cast<uint8_t>(ch);
+    if (idx >= 8u) { return 0u; }
+    return g_adc1_x16[kAdc1ChMap[idx]];
+}
+
+uint16_t adc_secondary_read_x16(AdcSecondaryChannel ch) noexcept {
     const uint8_t idx = static_cast<uint8_t>(ch);
     if (idx >= 5u) { return 0u; }
-    return g_adc2_raw[idx];
+    return g_adc2_x16[idx];
+}
+
+uint16_t adc_primary_read(AdcPrimaryChannel ch) noexcept {
+    return static_cast<uint16_t>(adc_primary_read_x16(ch) >> 4u);
+}
+
+uint16_t adc_secondary_read(AdcSecondaryChannel ch) noexcept {
+    return static_cast<uint16_t>(adc_secondary_read_x16(ch) >> 4u);
 }
 
 // P0 #3: ADC Recovery System - API pública para verificação de status
@@ -409,6 +602,9 @@ uint32_t adc_get_recovery_retries() noexcept {
 extern "C" void GPDMA1_Channel0_IRQHandler(void) {
     const uint32_t sr = GPDMA1_CH0_CSR;
     GPDMA1_CH0_CFCR = GPDMA_CFCR_ALL;
+    if ((sr & GPDMA_CSR_TCF) != 0u) {
+        ems::hal::adc_decim_push(g_adc_secondary_raw, g_adc1_cic, g_adc1_x16);
+    }
     if ((sr & (GPDMA_CSR_DTEF | GPDMA_CSR_USEF)) != 0u) { 
         ++g_adc_dma_faults;
         // P0 #3: DMA fault pode indicar problema no ADC - verifica se precisa de recovery
@@ -421,9 +617,27 @@ extern "C" void GPDMA1_Channel0_IRQHandler(void) {
     // limpamos as flags. O re-arm na ISV não reciclava → ADCs congelavam.
 }
 
+extern "C" void PendSV_Handler(void) {
+    ems::hal::knock_capture_apply();
+}
+
 extern "C" void GPDMA1_Channel1_IRQHandler(void) {
     const uint32_t sr = GPDMA1_CH1_CSR;
     GPDMA1_CH1_CFCR = GPDMA_CFCR_ALL;
+    // Captura de knock: HT = 1.º bloco pronto, TC = 2.º (o DMA já escreve
+    // no outro meio do buffer enquanto o sink processa este).
+    const ems::hal::AdcKnockSink sink = g_knock_sink;
+    if (sink != nullptr) {
+        const uint16_t* const buf = const_cast<const uint16_t*>(&g_knock_buf[0]);
+        if ((sr & GPDMA_CSR_HTF) != 0u) { sink(buf, ems::hal::kAdcKnockBlock); }
+        if ((sr & GPDMA_CSR_TCF) != 0u) {
+            sink(buf + ems::hal::kAdcKnockBlock, ems::hal::kAdcKnockBlock);
+        }
+    } else if ((sr & GPDMA_CSR_TCF) != 0u) {
+        // Sequência lenta: canais sem amostras novas durante o knock mantêm o
+        // último valor decimado e o estado do CIC.
+        ems::hal::adc_decim_push(g_adc2_raw, g_adc2_cic, g_adc2_x16);
+    }
     if ((sr & (GPDMA_CSR_DTEF | GPDMA_CSR_USEF)) != 0u) { 
         ++g_adc_dma_faults;
         // P0 #3: DMA fault pode indicar problema no ADC
@@ -477,23 +691,86 @@ extern "C" void adc_timeout_isr() noexcept {
 #else  // EMS_HOST_TEST ─────────────────────────────────────────────────────
 
 #include "hal/adc.h"
+#include "hal/adc_cic.h"
 namespace ems::hal {
+// Saída dos decimadores (escala ×16), como g_adc1_x16/g_adc2_x16 no target.
 static uint16_t g_adc_primary[8] = {};
 static uint16_t g_adc_secondary[5] = {};
+static CicDecimator g_adc1_cic[8] = {};
+static CicDecimator g_adc2_cic[5] = {};
+// Modelo do SQ1 (MAP) síncrono: cada trigger "converte" o valor corrente.
+static uint16_t g_map_sync_x16 = 0u;
+static bool     g_map_sync_pending = false;
 static uint32_t g_last_trigger_mod = 0u;
+// Resultado do oversampler antes do CIC (adc_primary_read_fast_x16).
+static uint16_t g_adc_primary_fast[8] = {};
+static uint32_t g_primary_kicks = 0u;
 // P0 #3: Mock variables para ADC recovery system
 static bool g_adc_recovering_mock = false;
 static bool g_adc_recovery_failed_mock = false;
 static uint32_t g_adc_timeout_count_mock = 0u;
 static uint32_t g_adc_recovery_retries_mock = 0u;
 
-void     adc_init() noexcept {}
-void     adc_trigger_on_tooth(uint32_t t) noexcept { g_last_trigger_mod = t; }
-uint16_t adc_primary_read(AdcPrimaryChannel ch) noexcept { return g_adc_primary[static_cast<uint8_t>(ch)]; }
-uint16_t adc_secondary_read(AdcSecondaryChannel ch) noexcept { return g_adc_secondary[static_cast<uint8_t>(ch)]; }
-void adc_test_set_raw_primary(AdcPrimaryChannel ch, uint16_t v) noexcept { g_adc_primary[static_cast<uint8_t>(ch)] = v; }
-void adc_test_set_raw_secondary(AdcSecondaryChannel ch, uint16_t v) noexcept { g_adc_secondary[static_cast<uint8_t>(ch)] = v; }
+static AdcKnockSink g_knock_sink = nullptr;
+
+// Os valores injectados por adc_test_set_* sobrevivem a adc_init (fixtures
+// fazem set antes de sensors_init); só o estado dos CIC/amostra síncrona é reposto.
+void     adc_init() noexcept {
+    for (uint8_t i = 0u; i < 8u; ++i) { g_adc1_cic[i] = CicDecimator(kAdcPrimaryDecimLog2[i]); }
+    for (uint8_t i = 0u; i < 5u; ++i) { g_adc2_cic[i] = CicDecimator(kAdcSecondaryDecimLog2[i]); }
+    g_map_sync_pending = false;
+}
+void     adc_trigger_on_tooth(uint32_t t) noexcept {
+    g_last_trigger_mod = t;
+    if ((t / 2u) > 0u) {   // mesmo critério do target para armar o TIM6
+        g_map_sync_x16 = g_adc_primary[static_cast<uint8_t>(AdcPrimaryChannel::MAP)];
+        g_map_sync_pending = true;
+    }
+}
+bool     adc_map_sync_take(uint16_t& x16) noexcept {
+    if (!g_map_sync_pending) { return false; }
+    x16 = g_map_sync_x16;
+    g_map_sync_pending = false;
+    return true;
+}
+void     adc_knock_capture_start(AdcKnockSink sink) noexcept {
+    if (g_knock_sink == nullptr) { g_knock_sink = sink; }
+}
+void     adc_knock_capture_stop() noexcept { g_knock_sink = nullptr; }
+bool     adc_knock_capture_active() noexcept { return g_knock_sink != nullptr; }
+void     adc_test_knock_dma_block(const uint16_t* s, uint16_t n) noexcept {
+    if (g_knock_sink != nullptr) { g_knock_sink(s, n); }
+}
+uint16_t adc_primary_read_x16(AdcPrimaryChannel ch) noexcept { return g_adc_primary[static_cast<uint8_t>(ch)]; }
+uint16_t adc_primary_read_fast_x16(AdcPrimaryChannel ch) noexcept { return g_adc_primary_fast[static_cast<uint8_t>(ch)]; }
+void     adc_primary_kick() noexcept { ++g_primary_kicks; }
+uint16_t adc_secondary_read_x16(AdcSecondaryChannel ch) noexcept { return g_adc_secondary[static_cast<uint8_t>(ch)]; }
+uint16_t adc_primary_read(AdcPrimaryChannel ch) noexcept { return static_cast<uint16_t>(adc_primary_read_x16(ch) >> 4u); }
+uint16_t adc_secondary_read(AdcSecondaryChannel ch) noexcept { return static_cast<uint16_t>(adc_secondary_read_x16(ch) >> 4u); }
+void adc_test_set_raw_primary(AdcPrimaryChannel ch, uint16_t v) noexcept {
+    g_adc_primary[static_cast<uint8_t>(ch)] = static_cast<uint16_t>(v << 4u);
+    g_adc_primary_fast[static_cast<uint8_t>(ch)] = static_cast<uint16_t>(v << 4u);
+}
+void adc_test_set_raw_secondary(AdcSecondaryChannel ch, uint16_t v) noexcept { g_adc_secondary[static_cast<uint8_t>(ch)] = static_cast<uint16_t>(v << 4u); }
+void adc_test_set_x16_primary(AdcPrimaryChannel ch, uint16_t v) noexcept {
+    g_adc_primary[static_cast<uint8_t>(ch)] = v;
+    g_adc_primary_fast[static_cast<uint8_t>(ch)] = v;
+}
+void adc_test_dma_sequence_primary(const uint16_t (&x4)[8]) noexcept {
+    for (uint8_t i = 0u; i < 8u; ++i) {
+        g_adc_primary_fast[i] = static_cast<uint16_t>(x4[i] << 2u);
+        uint16_t y = 0u;
+        if (g_adc1_cic[i].push(x4[i], y)) { g_adc_primary[i] = y; }
+    }
+}
+void adc_test_dma_sequence_secondary(const uint16_t (&x4)[5]) noexcept {
+    for (uint8_t i = 0u; i < 5u; ++i) {
+        uint16_t y = 0u;
+        if (g_adc2_cic[i].push(x4[i], y)) { g_adc_secondary[i] = y; }
+    }
+}
 uint32_t adc_test_last_trigger_mod() noexcept { return g_last_trigger_mod; }
+uint32_t adc_test_primary_kicks() noexcept { return g_primary_kicks; }
 
 // P0 #3: Mock functions para ADC recovery system - usadas em testes
 bool adc_is_recovering() noexcept { return g_adc_recovering_mock; }
@@ -7,7 +7,11 @@
  *   adc_init()          — inicializa ADC primary (MAP/MAF/TPS/O2/AN1-4) e ADC1 (CLT/IAT/FUEL/OIL)
  *   adc_primary_read()         — lê canal de ADC primary
  *   adc_secondary_read()         — lê canal de ADC1
+ *   adc_*_read_x16()     — mesma leitura a 16 bits (oversampling + CIC)
  *   adc_trigger_on_tooth()  — configura trigger TIM6 trigger para sincronização com CKP
+ *   adc_map_sync_take()     — MAP síncrona ao ângulo (SQ1 do trigger do dente)
+ *   adc_primary_read_fast_x16() / adc_primary_kick() — leitura/kick da malha ETB
+ *                                (grupo injectado do ADC1, ETB_TPS1/2)
  */
 
 #include <cstdint>
@@ -21,6 +25,8 @@
 // Se MAP vier a necessitar de 16-bit, o driver deverá reconfigurar ADC primary_CFG1
 // antes de cada leitura de MAP — a ser implementado quando um mux dedicado
 // for adicionado ao hardware.
+// Entretanto o oversampler de hardware (8×, ver abaixo) dá à MAP resolução
+// efectiva acima de 12 bits sem mudar MODE nem a sequência.
 // ADC1 (CLT/IAT/FUEL/OIL): 12-bit (MODE=01).
 // =============================================================================
 
@@ -50,8 +56,77 @@ enum class AdcSecondaryChannel : uint8_t {
 void     adc_init() noexcept;
 void     adc_trigger_on_tooth(uint32_t tooth_period_ticks) noexcept;
 
+// ── Oversampling + decimação por canal ──────────────────────────────────────
+// 1.º estágio (hardware, custo zero de CPU): oversampler regular do ADC —
+// ADC1 8× (shift 1), ADC2 16× (shift 2) → resultado de 14 bits (×4 o LSB de
+// 12 bits) por canal e por trigger. O ADC2 desliga-o durante a captura de
+// knock (95.7 kS/s precisa de uma conversão por amostra).
+// 2.º estágio: CIC de 2.ª ordem por canal (hal/adc_cic.h) no IRQ de fim de
+// bloco do GPDMA, razão 2^log2 fixa por sensor — canais lentos decimados à
+// taxa do consumidor, MAP em bypass (janela angular precisa de cada dente).
+// Saída a 16 bits (×16 o LSB de 12 bits): adc_*_read_x16. adc_*_read
+// continua a devolver 0..4095 (= x16 >> 4) para os consumidores existentes.
+inline constexpr uint8_t kAdcPrimaryOvsRatio   = 8u;
+inline constexpr uint8_t kAdcSecondaryOvsRatio = 16u;
+inline constexpr uint8_t kAdcPrimaryDecimLog2[8] = {
+    0u,  // MAP      — bypass (amostra por dente para map_window)
+    0u,  // MAF_V
+    1u,  // TPS      — 2 sequências (~1 amostra de sample_fast_channels)
+    0u,  // KNOCK    — placeholder na sequência lenta
+    2u,  // APP1     — 4
+    2u,  // APP2
+    1u,  // ETB_TPS1 — 2 (malha de posição)
+    1u,  // ETB_TPS2
+};
+inline constexpr uint8_t kAdcSecondaryDecimLog2[5] = {
+    5u,  // CLT        — 32 (consumidor a 100 ms)
+    5u,  // IAT
+    3u,  // FUEL_PRESS — 8 (consumidor a 50 ms)
+    3u,  // OIL_PRESS
+    1u,  // EWG_POS
+};
+
+// ── MAP síncrona ao ângulo (SQ1 da sequência regular) ───────────────────────
+// Só o TRGO do TIM6 (armado por adc_trigger_on_tooth a ½ dente) dispara a
+// sequência regular, e o MAP é o SQ1: a amostra fica presa ao ângulo dente +
+// ½ passo (até 15 µs mais tarde se uma injectada da ETB a preemptar). O hook
+// do dente seguinte recolhe-a do buffer do GPDMA (sem IRQ extra). true =
+// amostra nova desde a última chamada; x16 na escala de adc_primary_read_x16.
+bool adc_map_sync_take(uint16_t& x16) noexcept;
+
+// ── Leitura rápida para malhas de controlo (ETB) ────────────────────────────
+// read_fast_x16: resultado do oversampler do ADC1 sem a latência do CIC
+// (escala ×16). ETB_TPS1/2 vêm da injectada do último kick; os outros
+// canais, do buffer do GPDMA.
+// kick: dispara por software a injectada do ADC1 (ETB_TPS1/2, 15 µs) — uma
+// escrita no ADC1_CR. Não toca no TIM6: nunca atrasa nem duplica a amostra
+// do dente, nem re-dispara o ADC2. Contexto: ISR da malha.
+uint16_t adc_primary_read_fast_x16(AdcPrimaryChannel ch) noexcept;
+void     adc_primary_kick() noexcept;
+
 uint16_t adc_primary_read(AdcPrimaryChannel ch) noexcept;
 uint16_t adc_secondary_read(AdcSecondaryChannel ch) noexcept;
+uint16_t adc_primary_read_x16(AdcPrimaryChannel ch) noexcept;
+uint16_t adc_secondary_read_x16(AdcSecondaryChannel ch) noexcept;
+
+// ── Captura rápida do knock (PA5) durante a janela ──────────────────────────
+// Durante a janela de knock o ADC2 sai da sequência lenta (CLT/IAT/…, que
+// mantêm o último valor) e converte só PA5/INP19 em modo contínuo a
+// kAdcKnockSampleRateHz; o GPDMA entrega blocos de kAdcKnockBlock amostras
+// (meio buffer circular) ao sink no IRQ do canal DMA. stop repõe a sequência
+// lenta com trigger TIM6. O bloco parcial no stop é descartado (≤ 0.7 ms).
+// ADC @ 62.5 MHz, 640.5 + 12.5 ciclos por conversão → 95.7 kS/s.
+// start/stop são ISR-safe e não bloqueiam: registam o pedido e a
+// reconfiguração do ADC2/GPDMA corre no PendSV (prioridade mínima).
+// active = pedido de captura em vigor.
+constexpr uint32_t kAdcKnockSampleRateHz = 95712u;
+constexpr uint16_t kAdcKnockBlock        = 64u;
+
+using AdcKnockSink = void (*)(const uint16_t* samples, uint16_t n);
+
+void adc_knock_capture_start(AdcKnockSink sink) noexcept;
+void adc_knock_capture_stop() noexcept;
+bool adc_knock_capture_active() noexcept;
 
 // P0 #3: ADC Recovery System - status flags para verificação em tempo de execução
 bool     adc_is_recovering() noexcept;
@@ -62,7 +137,17 @@ uint32_t adc_get_recovery_retries() noexcept;
 #if defined(EMS_HOST_TEST)
 void     adc_test_set_raw_primary(AdcPrimaryChannel ch, uint16_t raw) noexcept;
 void     adc_test_set_raw_secondary(AdcSecondaryChannel ch, uint16_t raw) noexcept;
+// Saída do decimador directamente (escala ×16), sem passar pelo CIC.
+void     adc_test_set_x16_primary(AdcPrimaryChannel ch, uint16_t x16) noexcept;
+// Entrega uma sequência (resultados do oversampler, escala ×4) aos
+// decimadores, como o IRQ de fim de bloco do GPDMA no target.
+void     adc_test_dma_sequence_primary(const uint16_t (&x4)[8]) noexcept;
+void     adc_test_dma_sequence_secondary(const uint16_t (&x4)[5]) noexcept;
 uint32_t adc_test_last_trigger_mod() noexcept;
+uint32_t adc_test_primary_kicks() noexcept;
+// Entrega um bloco ao sink da captura de knock (como o IRQ do DMA no target);
+// ignorado sem captura activa.
+void     adc_test_knock_dma_block(const uint16_t* samples, uint16_t n) noexcept;
 void     adc_test_set_recovering(bool recovering) noexcept;
 void     adc_test_set_recovery_failed(bool failed) noexcept;
 void     adc_test_set_timeout_count(uint32_t count) noexcept;
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+
+namespace ems::hal {
+
+/**
+ * @brief Decimador CIC de 2.ª ordem, razão R = 2^log2_ratio (0..6).
+ *
+ * Integradores à taxa de entrada (uma sequência ADC), pentes à taxa de
+ * saída. Aritmética modular em 32 bits: correcta enquanto
+ * bits_entrada + 2·log2(R) ≤ 32 (14 + 12 = 26 no pior caso).
+ *
+ * Escalas: entrada = resultado do oversampler de hardware (14 bits, 4× o
+ * LSB de 12 bits); saída normalizada a 16 bits (16× o LSB de 12 bits) — o
+ * ganho R² do CIC dá os bits de resolução extra. log2_ratio = 0 é bypass
+ * (uma saída por amostra, só mudança de escala).
+ *
+ * Resposta sinc² (zero em fs/R): atraso de grupo R−1 amostras de entrada.
+ */
+class CicDecimator {
+public:
+    static constexpr uint8_t kMaxLog2Ratio = 6u;
+
+    constexpr CicDecimator() noexcept = default;
+    constexpr explicit CicDecimator(uint8_t log2_ratio) noexcept
+        : log2_ratio_(log2_ratio > kMaxLog2Ratio ? kMaxLog2Ratio : log2_ratio) {}
+
+    // true quando há saída nova (a cada R entradas) em out_x16.
+    bool push(uint16_t in_x4, uint16_t& out_x16) noexcept {
+        if (log2_ratio_ == 0u) {
+            out_x16 = static_cast<uint16_t>(in_x4 << 2u);
+            return true;
+        }
+        i1_ += in_x4;
+        i2_ += i1_;
+        if (++phase_ < (1u << log2_ratio_)) { return false; }
+        phase_ = 0u;
+        const uint32_t c1 = i2_ - d1_;
+        d1_ = i2_;
+        const uint32_t c2 = c1 - d2_;
+        d2_ = c1;
+        // 1.º despejo após reset: pente de 2.ª ordem ainda sem história
+        // (meia escala) — descartado; a partir do 2.º a saída é exacta.
+        if (!warm_) { warm_ = true; return false; }
+        // Ganho R² = 2^(2·log2R); entrada já é ×4 → shift 2·log2R − 2.
+        out_x16 = static_cast<uint16_t>(c2 >> (2u * log2_ratio_ - 2u));
+        return true;
+    }
+
+    void reset() noexcept {
+        i1_ = 0u; i2_ = 0u; d1_ = 0u; d2_ = 0u; phase_ = 0u; warm_ = false;
+    }
+
+    uint8_t log2_ratio() const noexcept { return log2_ratio_; }
+
+private:
+    uint32_t i1_ = 0u;
+    uint32_t i2_ = 0u;
+    uint32_t d1_ = 0u;
+    uint32_t d2_ = 0u;
+    uint8_t  phase_ = 0u;
+    bool     warm_ = false;
+    uint8_t  log2_ratio_ = 0u;
+};
+
+}  // namespace ems::hal
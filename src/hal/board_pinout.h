@@ -9,6 +9,11 @@
  *
  *   make firmware BOARD=rgt6   # default
  *   make firmware BOARD=vgt6
+ *   make firmware BOARD=vgt6 CYLINDERS=8
+ *
+ * EMS_CYLINDERS (1–8, default 4) fixa o nº de canais INJ/IGN. Até 4 cilindros
+ * usa-se o banco original (8 canais); 5–8 acrescentam INJ5–8/IGN5–8 em
+ * GPIOD PD8–PD15, que só existe no VGT6 (LQFP100).
  */
 
 #if defined(EMS_BOARD_VGT6)
@@ -21,3 +26,16 @@
 #  endif
 #  define EMS_BOARD_NAME "RGT6"
 #endif
+
+#ifndef EMS_CYLINDERS
+#  define EMS_CYLINDERS 4
+#endif
+#if (EMS_CYLINDERS < 1) || (EMS_CYLINDERS > 8)
+#  error "EMS_CYLINDERS fora de 1..8"
+#endif
+#if (EMS_CYLINDERS > 4) && !EMS_BOARD_IS_VGT6
+#  error "5-8 cilindros exigem BOARD=vgt6 (INJ5-8/IGN5-8 em GPIOD)"
+#endif
+
+// Canais de saída: [0..7] banco original, [8..15] INJ5–8 + IGN5–8.
+#define EMS_OUT_CHANNELS ((EMS_CYLINDERS > 4) ? 16 : 8)
@@ -0,0 +1,429 @@
+/**
+ * @file hal/cal_store.cpp
+ * @brief Páginas de calibração em cópias A/B com seq + CRC (ver cal_store.h).
+ */
+
+#include "hal/cal_store.h"
+
+#include <cstring>
+
+#include "hal/crc32.h"
+
+namespace {
+
+using ems::hal::CalCopyInfo;
+using ems::hal::CalGroupMember;
+using ems::hal::FlashJobDone;
+using ems::hal::kCalCopyA;
+using ems::hal::kCalCopyB;
+using ems::hal::kCalCopyNone;
+using ems::hal::kCalStoreImageBytes;
+using ems::hal::kCalStoreNoAnchor;
+using ems::hal::kCalStorePageMax;
+using ems::hal::kCalStorePages;
+
+struct Trailer {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t len;
+    uint8_t  page;
+    uint8_t  version;
+    uint32_t crc32;
+};
+static_assert(sizeof(Trailer) == 16u, "trailer A/B = 1 quad-word");
+
+struct Bind {
+    uint32_t magic;
+    uint32_t seq;        // seq da cópia da âncora
+    uint8_t  page;       // página âncora
+    uint8_t  pad[3];
+    uint32_t crc32;      // CRC-32 dos 12 bytes anteriores
+};
+static_assert(sizeof(Bind) == 16u, "bind = 1 quad-word");
+
+// Job em curso por página: burn/rollback seguinte só depois do done, porque
+// a escolha da cópia alvo depende do resultado do anterior.
+struct PageJob {
+    FlashJobDone done;
+    void*        ctx;
+    bool         busy;
+};
+
+// Burn de grupo em curso (um de cada vez): done agregado dos membros.
+struct GroupJob {
+    FlashJobDone done;
+    void*        ctx;
+    uint8_t      left;
+    bool         ok;
+};
+
+struct Copy {
+    CalCopyInfo info;
+    bool        bound;       // bind válido presente
+    uint32_t    anchor_seq;
+};
+
+// Cópia activa da âncora de uma página (ok = há uma).
+struct AnchorView {
+    bool     ok;
+    uint32_t seq;
+};
+
+struct Pick {
+    Copy   c[2];
+    int8_t active;
+};
+
+uint16_t g_sector_a0 = 0u;
+uint16_t g_sector_b0 = 0u;
+PageJob  g_jobs[kCalStorePages] = {};
+GroupJob g_group = {};
+// Âncora + 1 por página (0 = sem âncora: estado de zero-init).
+uint8_t  g_anchor1[kCalStorePages] = {};
+// Imagem montada no submit (a fila copia-a para o seu staging).
+alignas(4) uint8_t g_image[kCalStoreImageBytes];
+
+uint8_t anchor_of(uint8_t page) noexcept {
+    return (g_anchor1[page] == 0u) ? kCalStoreNoAnchor
+                                   : static_cast<uint8_t>(g_anchor1[page] - 1u);
+}
+
+uint16_t copy_sector(uint8_t page, uint8_t copy) noexcept {
+    return static_cast<uint16_t>((copy == kCalCopyA ? g_sector_a0 : g_sector_b0) + page);
+}
+
+const uint8_t* copy_base(uint8_t page, uint8_t copy) noexcept {
+    const ems::hal::FlashJobIo* io = ems::hal::flash_jobs_io();
+    return (io != nullptr) ? io->sector(copy_sector(page, copy)) : nullptr;
+}
+
+uint32_t trailer_crc(const uint8_t* data, const Trailer& t) noexcept {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (uint16_t i = 0u; i < t.len; ++i) { crc = ems::hal::crc32_update(crc, data[i]); }
+    const uint8_t* tb = reinterpret_cast<const uint8_t*>(&t);
+    for (uint32_t i = 0u; i < 12u; ++i) { crc = ems::hal::crc32_update(crc, tb[i]); }
+    return ~crc;
+}
+
+uint32_t bind_crc(const Bind& b) noexcept {
+    return ems::hal::crc32_calc(reinterpret_cast<const uint8_t*>(&b), 12u);
+}
+
+bool erased_qw(const uint8_t* p) noexcept {
+    for (uint32_t i = 0u; i < 16u; ++i) {
+        if (p[i] != 0xFFu) { return false; }
+    }
+    return true;
+}
+
+Copy read_copy(uint8_t page, uint8_t copy) noexcept {
+    Copy c = {{false, false, 0u, 0u}, false, 0u};
+    const uint8_t* base = copy_base(page, copy);
+    if (base == nullptr) { return c; }
+    Trailer t;
+    std::memcpy(&t, base + ems::hal::kCalStoreTrailerOff, sizeof(t));
+    if (t.magic != ems::hal::kCalStoreMagic || t.page != page ||
+        t.version != ems::hal::kCalStoreVersion ||
+        t.len == 0u || t.len > kCalStorePageMax ||
+        t.crc32 != trailer_crc(base, t)) {
+        return c;
+    }
+    // Página ligada: bind ilegível invalida a cópia; apagado = cópia
+    // anterior às ligações (layout sem bind).
+    if (anchor_of(page) != kCalStoreNoAnchor &&
+        !erased_qw(base + ems::hal::kCalStoreBindOff)) {
+        Bind b;
+        std::memcpy(&b, base + ems::hal::kCalStoreBindOff, sizeof(b));
+        if (b.magic != ems::hal::kCalStoreBindMagic || b.page != anchor_of(page) ||
+            b.crc32 != bind_crc(b)) {
+            return c;
+        }
+        c.bound = true;
+        c.anchor_seq = b.seq;
+    }
+    c.info.valid = true;
+    c.info.seq = t.seq;
+    c.info.len = t.len;
+    c.info.revoked = !erased_qw(base + ems::hal::kCalStoreRevokeOff);
+    return c;
+}
+
+bool usable(const Copy& c, const AnchorView& av) noexcept {
+    if (!c.info.valid || c.info.revoked) { return false; }
+    return !c.bound || (av.ok && c.anchor_seq == av.seq);
+}
+
+// Utilizável e gravada com a cópia activa da âncora (ou página sem âncora
+// activa): destino válido de um rollback.
+bool usable_on_anchor(const Copy& c, const AnchorView& av) noexcept {
+    return usable(c, av) && (c.bound || !av.ok);
+}
+
+// a mais recente que b (contador de burns pode dar a volta).
+bool seq_newer(uint32_t a, uint32_t b) noexcept {
+    return static_cast<int32_t>(a - b) > 0;
+}
+
+// Cópia ligada à âncora activa ganha a uma sem ligação (gravada antes das
+// ligações); entre iguais, o seq mais recente.
+int8_t pick_active(const Copy& a, const Copy& b, const AnchorView& av) noexcept {
+    const bool ua = usable(a, av);
+    const bool ub = usable(b, av);
+    if (ua && ub) {
+        if (a.bound != b.bound) {
+            return a.bound ? static_cast<int8_t>(kCalCopyA) : static_cast<int8_t>(kCalCopyB);
+        }
+        return seq_newer(b.info.seq, a.info.seq) ? static_cast<int8_t>(kCalCopyB)
+                                                 : static_cast<int8_t>(kCalCopyA);
+    }
+    if (ua) { return static_cast<int8_t>(kCalCopyA); }
+    if (ub) { return static_cast<int8_t>(kCalCopyB); }
+    return kCalCopyNone;
+}
+
+Pick pick_page(uint8_t page, const AnchorView& av) noexcept {
+    Pick p;
+    p.c[kCalCopyA] = read_copy(page, kCalCopyA);
+    p.c[kCalCopyB] = read_copy(page, kCalCopyB);
+    p.active = pick_active(p.c[kCalCopyA], p.c[kCalCopyB], av);
+    return p;
+}
+
+AnchorView anchor_view(uint8_t page) noexcept {
+    const uint8_t anchor = anchor_of(page);
+    if (anchor == kCalStoreNoAnchor) { return AnchorView{false, 0u}; }
+    const Pick p = pick_page(anchor, AnchorView{false, 0u});
+    if (p.active == kCalCopyNone) { return AnchorView{false, 0u}; }
+    return AnchorView{true, p.c[static_cast<uint8_t>(p.active)].info.seq};
+}
+
+Pick pick(uint8_t page) noexcept { return pick_page(page, anchor_view(page)); }
+
+bool has_dependents(uint8_t page) noexcept {
+    for (uint8_t p = 0u; p < kCalStorePages; ++p) {
+        if (anchor_of(p) == page) { return true; }
+    }
+    return false;
+}
+
+void page_job_done(void* ctx, bool ok) noexcept {
+    PageJob* j = static_cast<PageJob*>(ctx);
+    j->busy = false;
+    if (j->done != nullptr) { j->done(j->ctx, ok); }
+}
+
+void group_member_done(void* ctx, bool ok) noexcept {
+    GroupJob* g = static_cast<GroupJob*>(ctx);
+    g->ok = g->ok && ok;
+    if (--g->left != 0u) { return; }
+    if (g->done != nullptr) { g->done(g->ctx, g->ok); }
+}
+
+// Alvo e seq de um burn: cópia inactiva, seq = activa + 1. Sem cópia
+// válida, B: o setor A pode ter a página no layout legado, que continua a
+// ser o fallback do load.
+void burn_target(const Pick& p, uint8_t* target, uint32_t* seq) noexcept {
+    *target = kCalCopyB;
+    *seq = 1u;
+    if (p.active != kCalCopyNone) {
+        const uint8_t active = static_cast<uint8_t>(p.active);
+        *target = (active == kCalCopyA) ? kCalCopyB : kCalCopyA;
+        *seq = p.c[active].info.seq + 1u;
+    }
+}
+
+// Monta a imagem (dados + bind opcional + trailer) e enfileira o burn.
+bool submit_copy(uint8_t page, uint8_t target, uint32_t seq, const uint8_t* data,
+                 uint16_t len, const AnchorView& bind, FlashJobDone done,
+                 void* ctx) noexcept {
+    std::memset(g_image, 0xFF, sizeof(g_image));
+    std::memcpy(g_image, data, len);
+    if (bind.ok) {
+        Bind b;
+        b.magic = ems::hal::kCalStoreBindMagic;
+        b.seq = bind.seq;
+        b.page = anchor_of(page);
+        b.pad[0] = b.pad[1] = b.pad[2] = 0u;
+        b.crc32 = bind_crc(b);
+        std::memcpy(g_image + ems::hal::kCalStoreBindOff, &b, sizeof(b));
+    }
+    Trailer t;
+    t.magic = ems::hal::kCalStoreMagic;
+    t.seq = seq;
+    t.len = len;
+    t.page = page;
+    t.version = ems::hal::kCalStoreVersion;
+    t.crc32 = trailer_crc(data, t);
+    std::memcpy(g_image + ems::hal::kCalStoreTrailerOff, &t, sizeof(t));
+
+    PageJob& j = g_jobs[page];
+    j.done = done;
+    j.ctx = ctx;
+    if (!ems::hal::flash_jobs_submit_burn(copy_sector(page, target), g_image,
+                                          kCalStoreImageBytes, page_job_done, &j)) {
+        return false;
+    }
+    j.busy = true;
+    return true;
+}
+
+bool burn_args_ok(uint8_t page, const uint8_t* data, uint16_t len) noexcept {
+    return page < kCalStorePages && data != nullptr && len != 0u && len <= kCalStorePageMax;
+}
+
+}  // namespace
+
+namespace ems::hal {
+
+void cal_store_configure(uint16_t sector_a0, uint16_t sector_b0) noexcept {
+    g_sector_a0 = sector_a0;
+    g_sector_b0 = sector_b0;
+    std::memset(g_anchor1, 0, sizeof(g_anchor1));
+}
+
+bool cal_store_bind(uint8_t page, uint8_t anchor) noexcept {
+    if (page >= kCalStorePages || anchor >= kCalStorePages || page == anchor ||
+        anchor_of(anchor) != kCalStoreNoAnchor || has_dependents(page)) {
+        return false;
+    }
+    g_anchor1[page] = static_cast<uint8_t>(anchor + 1u);
+    return true;
+}
+
+CalCopyInfo cal_store_copy_info(uint8_t page, uint8_t copy) noexcept {
+    if (page >= kCalStorePages || copy > kCalCopyB) { return CalCopyInfo{false, false, 0u, 0u}; }
+    return read_copy(page, copy).info;
+}
+
+int8_t cal_store_active_copy(uint8_t page) noexcept {
+    if (page >= kCalStorePages) { return kCalCopyNone; }
+    return pick(page).active;
+}
+
+bool cal_store_page_busy(uint8_t page) noexcept {
+    return page < kCalStorePages && g_jobs[page].busy;
+}
+
+bool cal_store_load(uint8_t page, uint8_t* data, uint16_t len) noexcept {
+    if (page >= kCalStorePages || data == nullptr || len == 0u || len > kCalStorePageMax) {
+        return false;
+    }
+    const Pick p = pick(page);
+    if (p.active == kCalCopyNone) {
+        const uint8_t* raw = copy_base(page, kCalCopyA);
+        if (raw == nullptr) { return false; }
+        std::memcpy(data, raw, len);
+        return true;
+    }
+    const uint8_t copy = static_cast<uint8_t>(p.active);
+    const uint16_t stored = p.c[copy].info.len;
+    const uint16_t n = (len < stored) ? len : stored;
+    std::memcpy(data, copy_base(page, copy), n);
+    if (n < len) { std::memset(data + n, 0xFF, len - n); }
+    return true;
+}
+
+bool cal_store_queue_burn(uint8_t page, const uint8_t* data, uint16_t len,
+                          FlashJobDone done, void* ctx) noexcept {
+    if (!burn_args_ok(page, data, len)) { return false; }
+    if (g_jobs[page].busy || flash_jobs_io() == nullptr) { return false; }
+    // Âncora com páginas ligadas só muda no burn de grupo: sozinha deixaria
+    // as ligadas sem cópia utilizável.
+    if (has_dependents(page)) { return false; }
+    const AnchorView av = anchor_view(page);
+    const Pick p = pick_page(page, av);
+    uint8_t target = kCalCopyB;
+    uint32_t seq = 1u;
+    burn_target(p, &target, &seq);
+    return submit_copy(page, target, seq, data, len, av, done, ctx);
+}
+
+bool cal_store_queue_group_burn(const CalGroupMember* members, uint8_t n,
+                                FlashJobDone done, void* ctx) noexcept {
+    if (members == nullptr || n == 0u || n > kFlashJobQueueDepth ||
+        flash_jobs_io() == nullptr || g_group.left != 0u) {
+        return false;
+    }
+    const uint8_t anchor = members[n - 1u].page;
+    for (uint8_t i = 0u; i < n; ++i) {
+        const CalGroupMember& m = members[i];
+        if (!burn_args_ok(m.page, m.data, m.len) || g_jobs[m.page].busy) { return false; }
+        const bool is_anchor = (i + 1u == n);
+        if (is_anchor ? (anchor_of(m.page) != kCalStoreNoAnchor)
+                      : (anchor_of(m.page) != anchor)) {
+            return false;
+        }
+    }
+    // Seq da âncora nova acima de ambas as cópias (mesmo revogadas): um
+    // membro ligado a um grupo revogado nunca volta a parecer actual.
+    const Pick ap = pick_page(anchor, AnchorView{false, 0u});
+    uint8_t anchor_target = kCalCopyB;
+    uint32_t anchor_seq = 1u;
+    burn_target(ap, &anchor_target, &anchor_seq);
+    for (const Copy& c : ap.c) {
+        if (c.info.valid && !seq_newer(anchor_seq, c.info.seq)) { anchor_seq = c.info.seq + 1u; }
+    }
+    if (!flash_jobs_begin_group(n)) { return false; }
+    g_group = GroupJob{done, ctx, n, true};
+    const AnchorView bind = {true, anchor_seq};
+    for (uint8_t i = 0u; i + 1u < n; ++i) {
+        const CalGroupMember& m = members[i];
+        uint8_t target = kCalCopyB;
+        uint32_t seq = 1u;
+        burn_target(pick(m.page), &target, &seq);
+        static_cast<void>(submit_copy(m.page, target, seq, m.data, m.len, bind,
+                                      group_member_done, &g_group));
+    }
+    const CalGroupMember& a = members[n - 1u];
+    static_cast<void>(submit_copy(a.page, anchor_target, anchor_seq, a.data, a.len,
+                                  AnchorView{false, 0u}, group_member_done, &g_group));
+    return true;
+}
+
+bool cal_store_queue_rollback(uint8_t page, FlashJobDone done, void* ctx) noexcept {
+    if (page >= kCalStorePages || g_jobs[page].busy || flash_jobs_io() == nullptr) {
+        return false;
+    }
+    const AnchorView av = anchor_view(page);
+    const Pick p = pick_page(page, av);
+    if (p.active == kCalCopyNone) { return false; }
+    const uint8_t active = static_cast<uint8_t>(p.active);
+    const Copy& prev = p.c[active == kCalCopyA ? kCalCopyB : kCalCopyA];
+    // Só há para onde voltar com a outra cópia utilizável — numa página
+    // ligada, gravada sobre os mesmos eixos (mesma cópia da âncora).
+    if (!usable_on_anchor(prev, av)) { return false; }
+    if (has_dependents(page)) {
+        // Âncora: cada página ligada tem de ter uma cópia gravada com a
+        // cópia anterior da âncora, senão o grupo ficaria misturado.
+        const AnchorView next = {true, prev.info.seq};
+        for (uint8_t d = 0u; d < kCalStorePages; ++d) {
+            if (anchor_of(d) != page) { continue; }
+            if (g_jobs[d].busy) { return false; }
+            const Pick dp = pick_page(d, next);
+            if (dp.active == kCalCopyNone ||
+                !dp.c[static_cast<uint8_t>(dp.active)].bound) {
+                return false;
+            }
+        }
+    }
+    const uint32_t rvk[4] = {kCalStoreRevokeMagic, p.c[active].info.seq, 0u, 0u};
+    PageJob& j = g_jobs[page];
+    j.done = done;
+    j.ctx = ctx;
+    if (!flash_jobs_submit_program(copy_sector(page, active), kCalStoreRevokeOff,
+                                   reinterpret_cast<const uint8_t*>(rvk), sizeof(rvk),
+                                   page_job_done, &j)) {
+        return false;
+    }
+    j.busy = true;
+    return true;
+}
+
+#if defined(EMS_HOST_TEST)
+void cal_store_test_reset() noexcept {
+    for (PageJob& j : g_jobs) { j = PageJob{nullptr, nullptr, false}; }
+    g_group = GroupJob{nullptr, nullptr, 0u, false};
+}
+#endif
+
+}  // namespace ems::hal
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+
+#include "hal/flash_jobs.h"
+
+namespace ems::hal {
+
+// ── Páginas de calibração A/B (double-buffer com seq + CRC) ──────────────────
+// Cada página tem duas cópias em setores Bank2 distintos (A = sector_a0 + page,
+// B = sector_b0 + page). Um burn grava SEMPRE a cópia que não está activa:
+// a cópia em uso nunca é apagada, e um power-loss a meio do burn deixa-a
+// intacta para o boot seguinte.
+//
+//   Setor:   [dados 0 .. len)[0xFF …][bind 16 B][trailer 16 B][revoke 16 B][0xFF…]
+//   Trailer: magic "CAB1" | seq u32 | len u16 | page u8 | version u8 | crc32
+//            crc32 = CRC-32 de dados[0 .. len) ‖ trailer[0 .. 12)
+//   Bind:    magic "CAX1" | seq âncora u32 | página âncora u8 | 0 ×3 | crc32
+//            (só em páginas ligadas a uma âncora; 0xFF = sem ligação)
+//   Revoke:  quad-word qualquer ≠ 0xFF → cópia retirada (rollback)
+//
+// O trailer é o último quad-word programado pelo job de burn: funciona como
+// commit. Boot escolhe a cópia válida, não revogada, com seq mais recente
+// (wrap-aware). Sem nenhuma cópia válida (flash anterior ao A/B ou apagada)
+// lê-se o setor A em bruto, como no layout antigo; o primeiro burn vai então
+// para B, preservando os dados legados até haver uma cópia válida.
+//
+// Âncora (cal_store_bind): páginas cujo conteúdo só vale com outra — as
+// tabelas 3D e os eixos onde foram amostradas. Cada cópia de uma página
+// ligada guarda o seq da cópia da âncora com que foi gravada e só é
+// utilizável enquanto essa for a cópia activa da âncora. O burn de grupo
+// grava os membros e a âncora por último: o trailer da âncora é o commit
+// único do grupo (power-loss antes dele = grupo anterior inteiro), e
+// revogar a âncora devolve o grupo inteiro ao burn anterior.
+//
+// Rollback: programa o revoke da cópia activa (sem erase) — a outra cópia,
+// se válida e mais antiga, volta a ser a activa. Um só nível: a cópia
+// revogada só volta a ser usada depois de regravada por um burn.
+//
+// Módulo puro (target e host): escritas via fila hal/flash_jobs, leituras
+// pelo mapeamento em memória de FlashJobIo::sector.
+
+constexpr uint8_t  kCalStorePages       = 10u;
+constexpr uint32_t kCalStoreTrailerOff  = 1024u;
+constexpr uint32_t kCalStoreBindOff     = kCalStoreTrailerOff - 16u;
+constexpr uint16_t kCalStorePageMax     = static_cast<uint16_t>(kCalStoreBindOff);
+constexpr uint32_t kCalStoreRevokeOff   = kCalStoreTrailerOff + 16u;
+constexpr uint16_t kCalStoreImageBytes  = static_cast<uint16_t>(kCalStoreRevokeOff);
+constexpr uint32_t kCalStoreMagic       = 0x31424143u;  // "CAB1"
+constexpr uint32_t kCalStoreBindMagic   = 0x31584143u;  // "CAX1"
+constexpr uint32_t kCalStoreRevokeMagic = 0x314B5652u;  // "RVK1"
+constexpr uint8_t  kCalStoreVersion     = 1u;
+constexpr uint8_t  kCalStoreNoAnchor    = 0xFFu;
+static_assert(kCalStoreImageBytes <= kFlashJobMaxBytes,
+              "imagem A/B (dados + trailer) tem de caber no staging da fila");
+
+constexpr uint8_t kCalCopyA    = 0u;
+constexpr uint8_t kCalCopyB    = 1u;
+constexpr int8_t  kCalCopyNone = -1;   // nenhuma cópia válida (layout legado)
+
+struct CalCopyInfo {
+    bool     valid;     // trailer + CRC ok
+    bool     revoked;
+    uint32_t seq;
+    uint16_t len;
+};
+
+// Setores base das cópias A e B (relativos ao Bank2). Desfaz as ligações.
+void cal_store_configure(uint16_t sector_a0, uint16_t sector_b0) noexcept;
+// Liga page à âncora anchor (ela própria sem âncora). false = inválido.
+bool cal_store_bind(uint8_t page, uint8_t anchor) noexcept;
+
+// Copia a cópia activa para data: min(len, len gravado) bytes, resto 0xFF.
+// Sem cópia válida: setor A em bruto. false = argumentos inválidos.
+bool cal_store_load(uint8_t page, uint8_t* data, uint16_t len) noexcept;
+
+// Enfileira o burn da cópia inactiva com seq = activa + 1. false = fila
+// cheia / argumentos inválidos / já há um job desta página em curso.
+bool cal_store_queue_burn(uint8_t page, const uint8_t* data, uint16_t len,
+                          FlashJobDone done, void* ctx) noexcept;
+
+// Burn de grupo: members[0 .. n-1) ligados à âncora members[n-1]. Reserva
+// os n slots da fila de uma vez; a primeira falha cancela o resto e a âncora
+// (último job) só comita com todos os membros gravados. done(ctx, ok) uma
+// vez no fim. false = fila sem n slots, página ocupada, membros que não
+// estão ligados à âncora.
+struct CalGroupMember {
+    uint8_t        page;
+    const uint8_t* data;
+    uint16_t       len;
+};
+bool cal_store_queue_group_burn(const CalGroupMember* members, uint8_t n,
+                                FlashJobDone done, void* ctx) noexcept;
+
+// Revoga a cópia activa. false = sem cópia anterior válida para onde voltar,
+// fila cheia ou job desta página em curso. Numa âncora, também false se
+// alguma página ligada ficasse sem cópia utilizável com a âncora anterior.
+bool cal_store_queue_rollback(uint8_t page, FlashJobDone done, void* ctx) noexcept;
+
+bool        cal_store_page_busy(uint8_t page) noexcept;
+int8_t      cal_store_active_copy(uint8_t page) noexcept;
+CalCopyInfo cal_store_copy_info(uint8_t page, uint8_t copy) noexcept;
+
+#if defined(EMS_HOST_TEST)
+void cal_store_test_reset() noexcept;
+#endif
+
+}  // namespace ems::hal
@@ -26,10 +26,19 @@
  * Pinos: PB8 (FDCAN1_RX), PB9 (FDCAN1_TX) — AF9
  * (PA11/PA12 reservados para USB CDC; ignição usa TIM8 em PC6-PC9)
  *
- * Message RAM layout (FDCAN_SRAM @ 0x4000AC00):
- *   Offset 0x000: Std ID filters  (2 × 4 bytes)
- *   Offset 0x008: RX FIFO0        (3 elementos × 16 bytes)
- *   Offset 0x038: TX Buffer       (2 elementos × 16 bytes)
+ * Message RAM (FDCAN_SRAM @ 0x4000AC00, RM0481 §51.3.3): layout FIXO de
+ * 212 words por instância, como no G4 — não há RXF0C/TXBC.TBSA/TXESC, e todos
+ * os elementos RX/TX têm 18 words (72 B, payload de 64 B) em clássico ou FD:
+ *   0x000: 28 filtros std (1 word)      0x070: 8 filtros ext (2 words)
+ *   0x0B0: RX FIFO0 (3 × 72 B)          0x188: RX FIFO1 (3 × 72 B)
+ *   0x260: TX event FIFO (3 × 8 B)      0x278: TX FIFO (3 × 72 B)
+ *
+ * TX: os 3 buffers formam uma FIFO (TXBC.TFQM = 0) partilhada por clássico e
+ * FD; cada frame vai para o put index de TXFQS.
+ *
+ * Modo FD opcional (can0_set_fd_mode): fase nominal inalterada (500 kbps),
+ * fase de dados a 2.5 Mbps com BRS. Só FDOE/BRSE + DBTP/TDCR — os elementos
+ * já têm 64 B de payload.
  */
 
 #ifndef EMS_HOST_TEST
@@ -37,14 +46,16 @@
 #include "hal/can.h"
 #include "hal/regs.h"
 
-// ── Message RAM layout ────────────────────────────────────────────────────────
+// ── Message RAM layout (fixo no H5) ───────────────────────────────────────────
 // Endereços offset dentro do FDCAN_SRAM (0x4000AC00)
-static constexpr uint32_t kSramStdFilters = 0x000u;  // 2 filtros × 4 bytes
-static constexpr uint32_t kSramRxFifo0    = 0x008u;  // 3 elem × 16 bytes
-static constexpr uint32_t kSramTxBuf      = 0x038u;  // 2 elem × 16 bytes
+static constexpr uint32_t kSramStdFilters = 0x000u;  // 28 filtros × 4 bytes
+static constexpr uint32_t kSramRxFifo0    = 0x0B0u;  // 3 elem × 72 bytes
+static constexpr uint32_t kSramTxFifo     = 0x278u;  // 3 elem × 72 bytes
+static constexpr uint32_t kSramWords      = 212u;    // 0x350 B por instância
 
-// Para 8-byte CAN classic: 2 words header + 2 words data = 4 words = 16 bytes
-static constexpr uint32_t kElemSizeWords = 4u;  // 4 × 32-bit words por elemento
+// 2 words header + 16 words data (64 B) = 18 words = 72 bytes, RX e TX
+static constexpr uint32_t kElemSizeBytes = 18u * 4u;
+static constexpr uint32_t kRxFifo0Elems  = 3u;
 
 // Inline: acesso a palavra na Message RAM
 static inline volatile uint32_t& sram_word(uint32_t offset_bytes) noexcept {
@@ -76,6 +87,35 @@ static inline bool rx_fifo_pop(CanFrame& out) noexcept {
 }
 
 static uint32_t g_can_init_faults = 0u;
+static bool     g_fd_mode = false;
+static int8_t   g_fd_tx_idx = -1;   // buffer do último frame FD (-1 = nenhum)
+
+// INIT + CCE (configuração). Timeout conta como falha de init; false = os
+// registos de configuração continuam protegidos.
+static bool config_enter() noexcept {
+    FDCAN1_CCCR |= FDCAN_CCCR_INIT;
+    constexpr uint32_t kTimeout = 30000u;
+    for (uint32_t n = kTimeout; n > 0u; --n) {
+        if (FDCAN1_CCCR & FDCAN_CCCR_INIT) { break; }
+    }
+    if ((FDCAN1_CCCR & FDCAN_CCCR_INIT) == 0u) {
+        ++g_can_init_faults;
+        return false;
+    }
+    FDCAN1_CCCR |= FDCAN_CCCR_CCE;   // habilita configuração
+    return (FDCAN1_CCCR & FDCAN_CCCR_CCE) != 0u;
+}
+
+// Sai de INIT e aguarda sincronização no barramento.
+static void config_leave() noexcept {
+    FDCAN1_CCCR &= ~FDCAN_CCCR_CCE;
+    FDCAN1_CCCR &= ~FDCAN_CCCR_INIT;
+    constexpr uint32_t kTimeout = 30000u;
+    for (uint32_t n = kTimeout; n > 0u; --n) {
+        if ((FDCAN1_CCCR & FDCAN_CCCR_INIT) == 0u) { break; }
+    }
+    if (FDCAN1_CCCR & FDCAN_CCCR_INIT) { ++g_can_init_faults; }
+}
 
 // ── Inicialização ─────────────────────────────────────────────────────────────
 
@@ -89,15 +129,7 @@ void can0_init() noexcept {
     gpio_set_af(&GPIOB_MODER, &GPIOB_AFRL, &GPIOB_AFRH, &GPIOB_OSPEEDR, 9u, GPIO_AF9);
 
     // ── 3. Entrar em modo de inicialização ───────────────────────────────
-    FDCAN1_CCCR |= FDCAN_CCCR_INIT;
-    {
-        constexpr uint32_t kTimeout = 30000u;
-        for (uint32_t n = kTimeout; n > 0u; --n) {
-            if (FDCAN1_CCCR & FDCAN_CCCR_INIT) { break; }
-        }
-        if ((FDCAN1_CCCR & FDCAN_CCCR_INIT) == 0u) { ++g_can_init_faults; }
-    }
-    FDCAN1_CCCR |= FDCAN_CCCR_CCE;   // habilita configuração
+    (void)config_enter();   // timeout já contado em g_can_init_faults
 
     // ── 4. Bit timing 500 kbps a 62.5 MHz ────────────────────────────────
     // NBRP+1=5, Tq=80ns, NTSEG1=17 (18 Tq), NTSEG2=5 (6 Tq) → 25 Tq → 500 kbps
@@ -110,8 +142,8 @@ void can0_init() noexcept {
                | ((5u  & 0x7Fu)  << 0);   // NTSEG2 = 5 (Phase_Seg2 = 6 Tq)
 
     // ── 5. Configurar Message RAM ─────────────────────────────────────────
-    // Limpar área de Message RAM
-    for (uint32_t i = 0u; i < 128u; ++i) {
+    // Limpar a Message RAM da instância (filtros/elementos não usados = 0)
+    for (uint32_t i = 0u; i < kSramWords; ++i) {
         sram_word(i * 4u) = 0u;
     }
 
@@ -125,27 +157,49 @@ void can0_init() noexcept {
       | (0x180u << 0);     // SFID2 = 0x180
 
     // Global filter: 2 filtros standard; frames não casados continuam aceitos em FIFO0.
-    FDCAN1_RXGFC = (2u << 16);  // LSS = 2, LSE = 0, ANFS/ANFE = accept FIFO0
-
-    // RX FIFO0: 3 elementos de 16 bytes cada
-    FDCAN1_RXF0C = (kSramRxFifo0 / 4u)   // F0SA: start address em words
-                 | (3u << 16);             // F0S: 3 elementos
+    FDCAN1_RXGFC = (2u << 16);  // LSS[20:16] = 2, LSE = 0, ANFS/ANFE = accept FIFO0
 
-    // TX Buffer: 2 elementos de 16 bytes cada
-    FDCAN1_TXBC = (kSramTxBuf / 4u)      // TBSA: start address em words
-               | (2u << 16);              // NDTB: 2 Dedicated TX Buffers
+    // RX FIFO0 e TX FIFO têm endereço e tamanho fixos; só o modo TX é escolhido.
+    FDCAN1_TXBC = 0u;                     // TFQM = 0: FIFO (ordem de escrita)
+    FDCAN1_CCCR &= ~(FDCAN_CCCR_FDOE | FDCAN_CCCR_BRSE);
+    g_fd_mode = false;
+    g_fd_tx_idx = -1;
 
     // ── 6. Sair do modo de inicialização ─────────────────────────────────
-    FDCAN1_CCCR &= ~FDCAN_CCCR_CCE;
-    FDCAN1_CCCR &= ~FDCAN_CCCR_INIT;
-    // Aguardar sincronização no barramento
-    {
-        constexpr uint32_t kTimeout = 30000u;
-        for (uint32_t n = kTimeout; n > 0u; --n) {
-            if ((FDCAN1_CCCR & FDCAN_CCCR_INIT) == 0u) { break; }
-        }
-        if (FDCAN1_CCCR & FDCAN_CCCR_INIT) { ++g_can_init_faults; }
+    config_leave();
+}
+
+bool can0_set_fd_mode(bool enable) noexcept {
+    if (!config_enter()) {
+        config_leave();   // INIT pode ter subido tarde: não deixar o bus parado
+        return false;
+    }
+    if (enable) {
+        // Fase de dados 2.5 Mbps a 62.5 MHz: DBRP=0 (Tq = 16 ns),
+        // DTSEG1=18 (19 Tq), DTSEG2=4 (5 Tq) → 25 Tq = 400 ns, SP = 80%.
+        // DBTP: TDC @23, DBRP[4:0] @ [20:16], DTSEG1[4:0] @ [12:8],
+        //       DTSEG2[3:0] @ [7:4], DSJW[3:0] @ [3:0]
+        FDCAN1_DBTP = FDCAN_DBTP_TDC
+                    | ((0u  & 0x1Fu) << 16)
+                    | ((18u & 0x1Fu) << 8)
+                    | ((4u  & 0x0Fu) << 4)
+                    | ((4u  & 0x0Fu) << 0);
+        // TDC acima de 1 Mbps: offset = sample point da fase de dados (20 mtq).
+        FDCAN1_TDCR  = (20u & 0x7Fu) << 8;
+        FDCAN1_CCCR |= FDCAN_CCCR_FDOE | FDCAN_CCCR_BRSE;
+    } else {
+        FDCAN1_CCCR &= ~(FDCAN_CCCR_FDOE | FDCAN_CCCR_BRSE);
     }
+    // O modo em vigor é o que o CCCR aceitou (só escrevível com INIT+CCE).
+    const bool fd_now = (FDCAN1_CCCR & FDCAN_CCCR_FDOE) != 0u;
+    config_leave();
+    g_fd_mode = fd_now;
+    g_fd_tx_idx = -1;
+    return fd_now == enable;
+}
+
+bool can0_fd_enabled() noexcept {
+    return g_fd_mode;
 }
 
 uint32_t can0_get_init_faults() noexcept {
@@ -154,14 +208,19 @@ uint32_t can0_get_init_faults() noexcept {
 
 // ── Transmissão ───────────────────────────────────────────────────────────────
 
+// Put index da TX FIFO, ou -1 se cheia.
+static inline int8_t tx_put_index() noexcept {
+    const uint32_t fqs = FDCAN1_TXFQS;
+    if (fqs & FDCAN_TXFQS_TFQF) { return -1; }
+    return static_cast<int8_t>((fqs >> FDCAN_TXFQS_TFQPI_POS) & 0x3u);
+}
+
 bool can0_tx(const CanFrame& frame) noexcept {
-    // Buffer dedicado 0: não sobrescrever enquanto a requisição estiver pendente.
-    if (FDCAN1_TXBRP & (1u << 0)) {
-        return false;
-    }
+    const int8_t idx = tx_put_index();
+    if (idx < 0) { return false; }
 
-    // Endereço do elemento TX Buffer 0 na Message RAM
-    const uint32_t tx_addr = kSramTxBuf;
+    // Endereço do elemento no put index da TX FIFO
+    const uint32_t tx_addr = kSramTxFifo + static_cast<uint32_t>(idx) * kElemSizeBytes;
 
     // Word 0: ID + flags
     // Bit 30 = XTD (0=std 11-bit), Bit 29 = RTR, Bits [28:18] = ID[10:0]
@@ -185,8 +244,47 @@ bool can0_tx(const CanFrame& frame) noexcept {
     sram_word(tx_addr + 8u)  = d0;
     sram_word(tx_addr + 12u) = d1;
 
-    // Solicitar transmissão do Buffer 0
-    FDCAN1_TXBAR = (1u << 0);
+    // Solicitar transmissão do buffer no put index
+    FDCAN1_TXBAR = (1u << static_cast<uint32_t>(idx));
+    return true;
+}
+
+bool can0_tx_fd(const CanFdFrame& frame) noexcept {
+    if (!g_fd_mode) { return false; }
+    // Telemetria é best-effort: se o frame FD anterior ainda não saiu (ou a
+    // FIFO está cheia), descarta o novo em vez de bloquear o loop — no
+    // máximo um FD na FIFO, os outros buffers ficam para os clássicos.
+    if (g_fd_tx_idx >= 0 &&
+        (FDCAN1_TXBRP & (1u << static_cast<uint32_t>(g_fd_tx_idx))) != 0u) {
+        return false;
+    }
+    const int8_t idx = tx_put_index();
+    if (idx < 0) { return false; }
+    const uint32_t tx_addr = kSramTxFifo + static_cast<uint32_t>(idx) * kElemSizeBytes;
+
+    const uint8_t dlc = can_fd_len_to_dlc(frame.len);
+    const uint8_t len = can_fd_dlc_to_len(dlc);
+
+    sram_word(tx_addr + 0u) = frame.extended
+        ? ((frame.id & 0x1FFFFFFFu) | (1u << 30))   // XTD
+        : ((frame.id & 0x7FFu) << 18);
+    sram_word(tx_addr + 4u) = (static_cast<uint32_t>(dlc) << 16)
+                            | FDCAN_TXE1_FDF
+                            | (frame.brs ? FDCAN_TXE1_BRS : 0u);
+
+    // Payload em words little-endian; bytes além de frame.len vão a zero.
+    for (uint8_t w = 0u; w < (len + 3u) / 4u; ++w) {
+        uint32_t word = 0u;
+        for (uint8_t b = 0u; b < 4u; ++b) {
+            const uint8_t i = static_cast<uint8_t>(w * 4u + b);
+            const uint8_t v = (i < frame.len && i < kCanFdMaxPayload) ? frame.data[i] : 0u;
+            word |= static_cast<uint32_t>(v) << (8u * b);
+        }
+        sram_word(tx_addr + 8u + w * 4u) = word;
+    }
+
+    FDCAN1_TXBAR = (1u << static_cast<uint32_t>(idx));
+    g_fd_tx_idx = idx;
     return true;
 }
 
@@ -195,15 +293,15 @@ bool can0_tx(const CanFrame& frame) noexcept {
 bool can0_rx_pop(CanFrame& out) noexcept {
     // 1. Verificar se há mensagem no RX FIFO0
     const uint32_t fqs = FDCAN1_RXF0S;
-    if ((fqs & 0x7Fu) == 0u) {
+    if ((fqs & FDCAN_RXF0S_F0FL_MASK) == 0u) {
         // Nenhum elemento disponível; drena o FIFO de software se houver
         return rx_fifo_pop(out);
     }
 
     // 2. Índice do próximo elemento a ler (hardware garante 0-2, mas valida defensivamente)
-    const uint32_t get_idx_raw = (fqs >> 8) & 0x3Fu;
-    const uint32_t get_idx = (get_idx_raw < 3u) ? get_idx_raw : 0u;
-    const uint32_t elem_addr = kSramRxFifo0 + get_idx * (kElemSizeWords * 4u);
+    const uint32_t get_idx_raw = (fqs >> FDCAN_RXF0S_F0GI_POS) & 0x3u;
+    const uint32_t get_idx = (get_idx_raw < kRxFifo0Elems) ? get_idx_raw : 0u;
+    const uint32_t elem_addr = kSramRxFifo0 + get_idx * kElemSizeBytes;
 
     // 3. Ler dados do elemento
     const uint32_t w0 = sram_word(elem_addr + 0u);
@@ -240,12 +338,31 @@ bool can0_rx_pop(CanFrame& out) noexcept {
 #include "hal/can.h"
 namespace ems::hal {
 static CanFrame g_tx_buf[8];
+static CanFdFrame g_tx_fd_buf[8];
+static uint8_t  g_tx_fd_cnt = 0u;
+static uint32_t g_tx_fd_total = 0u;
+static bool     g_fd_mode = false;
+static bool     g_fd_mode_fail = false;
+static uint32_t g_fd_mode_calls = 0u;
 static CanFrame g_rx_inject[8];
 static uint8_t  g_tx_cnt = 0u, g_rx_cnt = 0u, g_rx_pop_idx = 0u;
 static uint32_t g_test_ctrl1 = 0u;
 
-void can0_init() noexcept {}
+void can0_init() noexcept { g_fd_mode = false; }
 uint32_t can0_get_init_faults() noexcept { return 0u; }
+bool can0_set_fd_mode(bool enable) noexcept {
+    ++g_fd_mode_calls;
+    if (g_fd_mode_fail) { return false; }   // INIT não confirmado: modo mantém-se
+    g_fd_mode = enable;
+    return true;
+}
+bool can0_fd_enabled() noexcept { return g_fd_mode; }
+bool can0_tx_fd(const CanFdFrame& f) noexcept {
+    if (!g_fd_mode) { return false; }
+    if (g_tx_fd_cnt < 8u) { g_tx_fd_buf[g_tx_fd_cnt++] = f; }
+    ++g_tx_fd_total;
+    return true;
+}
 bool can0_tx(const CanFrame& f) noexcept {
     if (g_tx_cnt < 8u) { g_tx_buf[g_tx_cnt++] = f; }
     return true;
@@ -257,6 +374,11 @@ bool can0_rx_pop(CanFrame& out) noexcept {
 }
 void can_test_reset() noexcept {
     g_tx_cnt = g_rx_cnt = g_rx_pop_idx = 0u;
+    g_tx_fd_cnt = 0u;
+    g_tx_fd_total = 0u;
+    g_fd_mode = false;
+    g_fd_mode_fail = false;
+    g_fd_mode_calls = 0u;
 }
 bool can_test_inject_rx(const CanFrame& f) noexcept {
     if (g_rx_cnt < 8u) { g_rx_inject[g_rx_cnt++] = f; return true; }
@@ -267,6 +389,35 @@ bool can_test_pop_tx(CanFrame& out) noexcept {
     out = g_tx_buf[--g_tx_cnt]; return true;
 }
 uint32_t can_test_ctrl1() noexcept { return g_test_ctrl1; }
+bool can_test_pop_tx_fd(CanFdFrame& out) noexcept {
+    if (g_tx_fd_cnt == 0u) { return false; }
+    out = g_tx_fd_buf[--g_tx_fd_cnt]; return true;
+}
+uint32_t can_test_fd_tx_count() noexcept { return g_tx_fd_total; }
+void can_test_fail_fd_mode(bool fail) noexcept { g_fd_mode_fail = fail; }
+uint32_t can_test_fd_mode_calls() noexcept { return g_fd_mode_calls; }
 } // namespace ems::hal
 
 #endif  // EMS_HOST_TEST
+
+// ── DLC FD (comum a target e host) ────────────────────────────────────────────
+namespace ems::hal {
+
+uint8_t can_fd_dlc_to_len(uint8_t dlc) noexcept {
+    static constexpr uint8_t kLen[16] = {0u, 1u, 2u, 3u, 4u, 5u, 6u, 7u,
+                                         8u, 12u, 16u, 20u, 24u, 32u, 48u, 64u};
+    return kLen[dlc & 0x0Fu];
+}
+
+uint8_t can_fd_len_to_dlc(uint8_t len) noexcept {
+    if (len <= 8u)  { return len; }
+    if (len <= 12u) { return 9u; }
+    if (len <= 16u) { return 10u; }
+    if (len <= 20u) { return 11u; }
+    if (len <= 24u) { return 12u; }
+    if (len <= 32u) { return 13u; }
+    if (len <= 48u) { return 14u; }
+    return 15u;
+}
+
+}  // namespace ems::hal
@@ -7,8 +7,11 @@
  *   can0_init()        — inicializa FDCAN1 em 500 kbps
  *   can0_tx()          — transmite frame CAN
  *   can0_rx_pop()      — recebe frame CAN (FIFO)
+ *   can0_set_fd_mode() — liga/desliga CAN FD (payload 64 B + bit-rate switch)
+ *   can0_tx_fd()       — transmite frame FD (TX FIFO, no máximo um pendente)
  *
- * Protocolos: WBO2 lambda RX (0x180), diagnósticos TX (0x400, 0x401)
+ * Protocolos: WBO2 lambda RX (0x180), diagnósticos TX (0x400, 0x401),
+ * telemetria FD por ciclo (0x410, app/can_fd_telemetry).
  */
 
 #include <cstdint>
@@ -22,16 +25,47 @@ struct CanFrame {
     bool extended;
 };
 
+// Frame CAN FD: até 64 bytes de payload. len é arredondado para o próximo
+// tamanho DLC válido (0-8, 12, 16, 20, 24, 32, 48, 64) com padding a zero.
+static constexpr uint8_t kCanFdMaxPayload = 64u;
+
+struct CanFdFrame {
+    uint32_t id;
+    uint8_t len;
+    uint8_t data[kCanFdMaxPayload];
+    bool extended;
+    bool brs;       // bit-rate switch na fase de dados
+};
+
 void can0_init() noexcept;
 bool can0_tx(const CanFrame& frame) noexcept;
 bool can0_rx_pop(CanFrame& out) noexcept;
 uint32_t can0_get_init_faults() noexcept;
 
+// Modo FD opcional: reconfigura o FDCAN1 (FDOE/BRSE, fase de dados a
+// 2.5 Mbps). Frames clássicos e FD partilham a TX FIFO de 3 elementos.
+// Passa brevemente por INIT — chamar no arranque ou em mudança de calibração.
+// false se INIT/CCE não foi confirmado ou o CCCR não aceitou o FDOE; nesse
+// caso can0_fd_enabled() continua a reportar o modo que o CCCR tem.
+bool can0_set_fd_mode(bool enable) noexcept;
+bool can0_fd_enabled() noexcept;
+// false se o modo FD está desligado, o FD anterior ainda está pendente ou a
+// TX FIFO está cheia.
+bool can0_tx_fd(const CanFdFrame& frame) noexcept;
+
+// Tamanho DLC FD → bytes, e bytes → menor código DLC que os contém.
+uint8_t can_fd_dlc_to_len(uint8_t dlc) noexcept;
+uint8_t can_fd_len_to_dlc(uint8_t len) noexcept;
+
 #if defined(EMS_HOST_TEST)
 void can_test_reset() noexcept;
 bool can_test_inject_rx(const CanFrame& frame) noexcept;
 bool can_test_pop_tx(CanFrame& out) noexcept;
 uint32_t can_test_ctrl1() noexcept;
+bool can_test_pop_tx_fd(CanFdFrame& out) noexcept;
+uint32_t can_test_fd_tx_count() noexcept;
+void can_test_fail_fd_mode(bool fail) noexcept;   // can0_set_fd_mode devolve false
+uint32_t can_test_fd_mode_calls() noexcept;
 #endif
 
 }  // namespace ems::hal
@@ -167,3 +167,9 @@ void etb_driver_test_reset(void) {
     g_fault      = ETB_DRV_OK;
     g_fault_count = 0u;
 }
+
+#if defined(EMS_HOST_TEST)
+int16_t etb_driver_test_motor_pwm(void) {
+    return g_etb_data.motor_pwm;
+}
+#endif
@@ -55,6 +55,9 @@ float             etb_driver_adc_to_percent(uint16_t adc_raw);
 
 // Test hook
 void etb_driver_test_reset(void);
+#if defined(EMS_HOST_TEST)
+int16_t etb_driver_test_motor_pwm(void);   // último comando aplicado (±1023)
+#endif
 
 #ifdef __cplusplus
 }
@@ -4,15 +4,18 @@
  *
  * Layout da Flash Bank2 (base 0x08080000 — H562RG = 1MB, 512K/bank):
  *   Setor 0 (0x08080000, 8 KB): LTFT map + Knock map (página quente)
- *   Setor 1 (0x08082000, 8 KB): Calibração página 0 (512 bytes)
- *   Setor 2 (0x08084000, 8 KB): Calibração página 1 (256 bytes)
- *   Setor 3 (0x08086000, 8 KB): Calibração página 2 (256 bytes)
- *   Setores 4-6: Calibração páginas 3-5
- *   Setor 7: reservado
+ *   Setor 1 (0x08082000, 8 KB): Calibração página 0 (512 bytes), cópia A
+ *   Setor 2 (0x08084000, 8 KB): Calibração página 1 (256 bytes), cópia A
+ *   Setor 3 (0x08086000, 8 KB): Calibração página 2 (256 bytes), cópia A
+ *   Setores 4-10: Calibração páginas 3-9, cópia A
+ *   Setores 11-14: journal dos mapas adaptativos (hal/nvm_journal.h)
+ *   Setores 15-24: Calibração páginas 0-9, cópia B (hal/cal_store.h)
  *
  * Emulação de SRAM:
  *   LTFT e knock maps usam buffer em SRAM (g_ltft_ram / g_knock_ram)
  *   e escrevemos na Flash periodicamente (quando dirty bit ativo).
+ *   Desde o journal, o setor 0 só é lido no boot (migração do layout LTF3
+ *   de setor inteiro); cada flush grava apenas as células alteradas.
  *
  * Procedimento de escrita:
  *   1. Aguardar BSY
@@ -20,10 +23,21 @@
  *   3. Apagar setor (SER + SNB + STRT)
  *   4. Programar em palavras de 32 bits (PG mode)
  *   5. Re-travar
+ *
+ * Em run, burns de calibração e o flush do journal passam pela fila de
+ * hal/flash_jobs.h (passos ≤ kFlashJobSliceUs no slot de 2 ms): nenhum
+ * erase/program bloqueia o main loop.
+ *
+ * Shadows, imagem adaptativa, mount e flush do journal são comuns ao target
+ * e ao host-test; só os backends (NvmJournalIo / FlashJobIo / setor legado)
+ * mudam. No host os setores vêm do modelo de flash em RAM de hal/flash_jobs.
  */
 
 #include "hal/flash.h"
+#include "hal/cal_store.h"
 #include "hal/crc32.h"
+#include "hal/flash_jobs.h"
+#include "hal/nvm_journal.h"
 #include "hal/runtime_seed.h"
 
 // kNvmEtbCalOffset = kNvmSeedOffset + 16: o EtbCalRecord assume que o seed
@@ -80,46 +94,27 @@ inline void nvm_stamp_adaptive_header(uint8_t* sector) noexcept {
     __builtin_memcpy(sector + kNvmOffMapsCrc, &crc, sizeof(crc));
 }
 
+// Tabelas 3D (slots 1-3) só valem sobre os eixos do slot 9 com que foram
+// gravadas: ligadas a ele no cal_store logo após configurar os setores.
+static void cal_store_bind_tables() noexcept {
+    for (uint8_t slot = 1u; slot <= 3u; ++slot) {
+        static_cast<void>(cal_store_bind(slot, kNvmCalSlotAxes));
+    }
+}
+
 }  // namespace ems::hal
 
+
 #ifndef EMS_HOST_TEST
 
 #include "hal/regs.h"
-
-// ── Buffers SRAM para LTFT e Knock maps ─────────────────────────────────────
-// Espelham os dados da Flash; modificados em RAM e flushed periodicamente.
-// Layout do Setor 0: ver kNvmOff* em flash.h (offsets derivados das dimensões).
-static int8_t  g_ltft_ram[ems::hal::kNvmLtftDim][ems::hal::kNvmLtftDim] = {};
-static int8_t  g_knock_ram[8][8]  = {};     // 8×8 fixo (por-cilindro, não segue o grid)
-static int8_t  g_ltft_add_ram[ems::hal::kNvmLtftAddDim][ems::hal::kNvmLtftAddDim] = {};  // 50µs/count
-static bool    g_ltft_dirty     = false;
-static bool    g_knock_dirty    = false;
-static bool    g_ltft_add_dirty = false;
-static uint32_t g_nvm_now_ms              = 0u;
-static uint32_t g_last_adaptive_flush_ms  = 0u;
-static bool     g_adaptive_flush_asap     = false;
-// True while nvm_flush_adaptive_maps SM holds sector 0 (erase/program in flight).
-static bool     g_sector0_flush_active    = false;
-// Seed lives in the same sector as adaptive maps — never erase independently.
-// g_seed_ram is always the source of truth for the next flush; g_seed_dirty
-// forces a sector rewrite even when LTFT/knock/add are clean.
-static ems::hal::RuntimeSyncSeed g_seed_ram{};
-static bool g_seed_dirty = false;
-// EtbCalRecord: mesma regra do seed — shadow no setor 0, nunca erase próprio.
-// pack só sobrepõe o registro quando o shadow é válido (magic ok), senão a
-// cópia da flash é preservada.
-static ems::hal::EtbCalRecord g_etbcal_ram{};
-static bool g_etbcal_dirty = false;
+#include "hal/system.h"
 
 // ── Endereços dos setores Bank2 ───────────────────────────────────────────────
-static constexpr uint32_t kSectorLtft  = 0u;   // Setor 0: LTFT + knock
-static constexpr uint32_t kSectorCal0  = 1u;   // Setor 1: Cal page 0
-static constexpr uint32_t kSectorCal1  = 2u;   // Setor 2: Cal page 1
-static constexpr uint32_t kSectorCal2  = 3u;   // Setor 3: Cal page 2
-static constexpr uint32_t kSectorCal6  = 7u;   // Setor 7: Cal page 6 (ETB)
-static constexpr uint32_t kSectorCal7  = 8u;   // Setor 8: Cal page 7 (Pedal map)
-static constexpr uint32_t kSectorCal8  = 9u;   // Setor 9: Cal page 8 (Boost map)
-static constexpr uint32_t kSectorCal9  = 10u;  // Setor 10: Cal page 9 (eixos tabela)
+static constexpr uint32_t kSectorLtft  = 0u;   // Setor 0: LTFT + knock (legado, só leitura)
+static constexpr uint32_t kSectorCal0  = 1u;   // Setores 1-10: Cal pages 0-9, cópia A
+static constexpr uint32_t kSectorJournal0 = 11u;  // Setores 11-14: journal adaptativo
+static constexpr uint32_t kSectorCalB0 = 15u;  // Setores 15-24: Cal pages 0-9, cópia B
 
 static constexpr uint32_t kBank2Base   = FLASH_BANK2_BASE;
 static constexpr uint32_t kSectorSize  = FLASH_SECTOR_SIZE;
@@ -129,8 +124,6 @@ static constexpr uint32_t kFlashKey1 = 0x45670123u;
 static constexpr uint32_t kFlashKey2 = 0xCDEF89ABu;
 static constexpr uint32_t kFlashErrorMask = FLASH_SR_PGSERR | FLASH_SR_WRPERR;
 static constexpr uint32_t kFlashBusyMask = FLASH_SR_BSY | FLASH_SR_WBNE | FLASH_SR_DBNE;
-static constexpr uint32_t kFlashWordsPerStep = 16u;
-static volatile uint32_t g_flash_wait_timeouts = 0u;
 
 // ── Funções auxiliares ───────────────────────────────────────────────────────
 
@@ -145,87 +138,431 @@ static void flash_lock_bank2() noexcept {
     FLASH_NSCR |= FLASH_CR_LOCK;
 }
 
-static void flash_wait_ready() noexcept {
-    // Timeout defensivo: evita busy-wait infinito se hardware de flash falhar.
-    // ~300k iterações ≈ vários ms de margem para operações de erase/program.
-    constexpr uint32_t kFlashWaitTimeout = 300000u;
-    for (uint32_t i = 0u; i < kFlashWaitTimeout; ++i) {
-        if ((FLASH_NSSR & kFlashBusyMask) == 0u) { return; }
+// STM32H5 (RM0481): a Flash programa-se em "flash words" de 128 bits
+// (4×32-bit). O write buffer interno (SR.WBNE/DBNE) só comita as 4 palavras
+// para a célula não-volátil quando chegam em sucessão imediata; um poll de
+// BSY/WBNE/DBNE ENTRE palavras do MESMO quad-word deixa o buffer preso — BSY
+// nunca chega a subir e os dados nunca saem do buffer volátil: sobrevivem a
+// leituras da mesma sessão mas perdem-se num power-cycle. Corresponde a
+// FLASH_Program_QuadWord do HAL oficial da ST (stm32h5xx_hal_flash.c), que
+// também desabilita IRQs durante o loop das 4 palavras — uma ISR longa a meio
+// do quad-word pode violar o timing exigido pelo write buffer.
+// Só inicia a escrita: o chamador observa BSY/erros no poll do seu backend
+// (nenhum caminho de run espera pelo controlador).
+static bool flash_program_qw_start(uint32_t dest_addr, const uint8_t* qw) noexcept {
+    if (FLASH_NSSR & kFlashBusyMask) { return false; }
+    alignas(4) uint8_t buf[16];
+    std::memcpy(buf, qw, sizeof(buf));
+    flash_unlock_bank2();
+    FLASH_NSCCR = 0xFFFFFFFFu;
+    FLASH_NSCR |= FLASH_CR_PG;
+    volatile uint32_t* dst32 = reinterpret_cast<volatile uint32_t*>(dest_addr);
+    const uint32_t* src32 = reinterpret_cast<const uint32_t*>(buf);
+    {
+        ems::hal::CriticalSectionGuard guard;
+        for (uint32_t i = 0u; i < 4u; ++i) { dst32[i] = src32[i]; }
     }
-    // Timeout: contabiliza e prossegue — caller verifica FLASH_NSSR por erros.
-    ++g_flash_wait_timeouts;
+    return true;
 }
 
-static bool flash_erase_sector(uint32_t sector_num) noexcept {
-    flash_wait_ready();
-    FLASH_NSCCR = 0xFFFFFFFFu;  // limpa todos os flags de erro
 
-    // BKSEL=1: toda a calibração vive no Bank2 (0x08080000+); sector_num é
+// ── Backend do journal (Bank2, setores kSectorJournal0..+3) ─────────────────
+static_assert(ems::hal::kNvmJournalSectorBytes == FLASH_SECTOR_SIZE,
+              "journal assume setores de 8 KB");
+
+static const uint8_t* journal_sector(uint8_t idx) noexcept {
+    return reinterpret_cast<const uint8_t*>(
+        kBank2Base + (kSectorJournal0 + idx) * kSectorSize);
+}
+
+// Erase/program não-bloqueantes: o journal só os inicia com o controlador
+// livre (poll Ready) e a conclusão (e lock) é observada em journal_poll().
+static bool journal_erase(uint8_t idx) noexcept {
+    if (FLASH_NSSR & kFlashBusyMask) { return false; }
+    flash_unlock_bank2();
+    FLASH_NSCCR = 0xFFFFFFFFu;
+    FLASH_NSCR = FLASH_CR_SER
+              | FLASH_CR_BKSEL
+              | (((kSectorJournal0 + idx) << FLASH_CR_SNB_SHIFT) & FLASH_CR_SNB_MASK)
+              | FLASH_CR_STRT;
+    return true;
+}
+
+static bool journal_program(uint8_t idx, uint32_t offset, const uint8_t* qw) noexcept {
+    return flash_program_qw_start(
+        kBank2Base + (kSectorJournal0 + idx) * kSectorSize + offset, qw);
+}
+
+static ems::hal::NvmIoPoll journal_poll() noexcept {
+    if (FLASH_NSSR & kFlashBusyMask) { return ems::hal::NvmIoPoll::Busy; }
+    FLASH_NSCR &= ~(FLASH_CR_PG | FLASH_CR_SER | FLASH_CR_BKSEL | FLASH_CR_SNB_MASK);
+    const bool err = (FLASH_NSSR & kFlashErrorMask) != 0u;
+    flash_lock_bank2();
+    return err ? ems::hal::NvmIoPoll::Error : ems::hal::NvmIoPoll::Ready;
+}
+
+static const ems::hal::NvmJournalIo kJournalIo = {
+    journal_sector, journal_erase, journal_program, journal_poll,
+};
+
+// ── Backend da fila de jobs (hal/flash_jobs.h) ───────────────────────────────
+// Operações só iniciadas aqui; a conclusão é observada por job_poll() —
+// a fila nunca escreve no controlador com BSY activo.
+static const uint8_t* job_sector(uint16_t sector) noexcept {
+    return reinterpret_cast<const uint8_t*>(kBank2Base + sector * kSectorSize);
+}
+
+static bool job_erase(uint16_t sector) noexcept {
+    if (sector >= (0x80000u / kSectorSize)) { return false; }
+    flash_unlock_bank2();
+    FLASH_NSCCR = 0xFFFFFFFFu;  // limpa todos os flags de erro
+    // BKSEL=1: toda a calibração vive no Bank2 (0x08080000+); sector é
     // relativo ao banco (0-63), igual em ambos os bancos — só o bit BKSEL
     // desambigua qual metade física da flash o número de sector referencia.
     FLASH_NSCR = FLASH_CR_SER
               | FLASH_CR_BKSEL
-              | ((sector_num << FLASH_CR_SNB_SHIFT) & FLASH_CR_SNB_MASK)
+              | ((static_cast<uint32_t>(sector) << FLASH_CR_SNB_SHIFT) & FLASH_CR_SNB_MASK)
               | FLASH_CR_STRT;
+    return true;
+}
 
-    flash_wait_ready();
-    FLASH_NSCR &= ~(FLASH_CR_SER | FLASH_CR_BKSEL | FLASH_CR_SNB_MASK);
+static bool job_program(uint16_t sector, uint32_t offset, const uint8_t* qw) noexcept {
+    return flash_program_qw_start(kBank2Base + sector * kSectorSize + offset, qw);
+}
 
-    return (FLASH_NSSR & kFlashErrorMask) == 0u;
+static ems::hal::FlashOpPoll job_poll() noexcept {
+    const uint32_t sr = FLASH_NSSR;
+    if (sr & kFlashBusyMask)  { return ems::hal::FlashOpPoll::Busy; }
+    if (sr & kFlashErrorMask) { return ems::hal::FlashOpPoll::Error; }
+    return ems::hal::FlashOpPoll::Ready;
 }
 
-// STM32H5 (RM0481): a Flash programa-se em "flash words" de 128 bits
-// (4×32-bit). O write buffer interno (SR.WBNE/DBNE) só comita as 4 palavras
-// para a célula não-volátil quando chegam em sucessão imediata; fazer
-// flash_wait_ready() (poll de BSY/WBNE/DBNE) ENTRE palavras do MESMO
-// quad-word deixa o buffer preso — BSY nunca chega a subir porque a escrita
-// nunca se completa, o timeout defensivo de flash_wait_ready() expira e
-// "segue em frente" sem erro reportado (nenhum bit de kFlashErrorMask é
-// setado), então flash_write_words devolve true mas os dados nunca saem do
-// buffer volátil: sobrevive a leituras da mesma sessão (RAM/SRAM cache) mas
-// perde-se num power-cycle. Corresponde exactamente a FLASH_Program_QuadWord
-// do HAL oficial da ST (stm32h5xx_hal_flash.c), que também desabilita IRQs
-// durante o loop das 4 palavras — uma ISR longa a meio do quad-word pode
-// violar o timing exigido pelo write buffer.
-// len_bytes DEVE ser múltiplo de 16 (4 words); ver nvm_save_calibration.
-static bool flash_write_words(uint32_t dest_addr,
-                              const uint8_t* src,
-                              uint32_t len_bytes) noexcept {
-    flash_wait_ready();
-    FLASH_NSCR |= FLASH_CR_PG;
+static void job_idle() noexcept {
+    FLASH_NSCR &= ~(FLASH_CR_PG | FLASH_CR_SER | FLASH_CR_BKSEL | FLASH_CR_SNB_MASK);
+    flash_lock_bank2();
+}
 
-    const uint32_t* src32 = reinterpret_cast<const uint32_t*>(src);
-    volatile uint32_t* dst32 = reinterpret_cast<volatile uint32_t*>(dest_addr);
-    const uint32_t nwords = len_bytes / 4u;
-
-    for (uint32_t qw = 0u; qw < nwords; qw += 4u) {
-        const uint32_t n = (nwords - qw < 4u) ? (nwords - qw) : 4u;
-        {
-            // As (até) 4 palavras do quad-word em sucessão imediata, sem
-            // poll de status nem IRQs no meio — só assim o hardware comita
-            // o quad-word (ver comentário acima).
-            ems::hal::CriticalSectionGuard guard;
-            for (uint32_t i = 0u; i < n; ++i) {
-                dst32[qw + i] = src32[qw + i];
-            }
-        }
-        flash_wait_ready();
-        if (FLASH_NSSR & kFlashErrorMask) {
-            FLASH_NSCR &= ~FLASH_CR_PG;
-            return false;
-        }
+static uint32_t job_now_us() noexcept { return micros(); }
+
+static const ems::hal::FlashJobIo kFlashJobIo = {
+    job_sector, job_erase, job_program, job_poll, job_idle, job_now_us,
+};
+
+static void ensure_flash_jobs() noexcept {
+    if (ems::hal::flash_jobs_io() != &kFlashJobIo) {
+        ems::hal::flash_jobs_attach(&kFlashJobIo);
+        ems::hal::cal_store_configure(static_cast<uint16_t>(kSectorCal0),
+                                      static_cast<uint16_t>(kSectorCalB0));
+        ems::hal::cal_store_bind_tables();
     }
+}
+
+namespace ems::hal {
+
+// ── Backends da imagem adaptativa ────────────────────────────────────────────
+static const NvmJournalIo* adaptive_journal_io() noexcept { return &kJournalIo; }
+
+// Setor 0 legado (LTF3 de setor inteiro): lido na migração do boot e apagado
+// depois do primeiro commit do journal.
+static const uint8_t* adaptive_legacy_sector() noexcept {
+    return reinterpret_cast<const uint8_t*>(kBank2Base + kSectorLtft * kSectorSize);
+}
+
+static constexpr uint16_t adaptive_legacy_sector_id() noexcept {
+    return static_cast<uint16_t>(kSectorLtft);
+}
+
+static constexpr bool adaptive_writes_blocked() noexcept { return false; }
+
+// ── Calibração (páginas) ──────────────────────────────────────────────────────
+
+bool nvm_queue_calibration(uint8_t page, const uint8_t* data, uint16_t len,
+                           void (*done)(void* ctx, bool ok), void* ctx) noexcept {
+    if (page > 9u || data == nullptr || len == 0u) { return false; }
+    ensure_flash_jobs();
+    // Burn da cópia inactiva (A/B): erase → program (quad-words, trailer por
+    // último) → readback. O verify apanha o caso do write buffer de 128 bits
+    // não comitado; a cópia activa nunca é apagada.
+    return cal_store_queue_burn(page, data, len, done, ctx);
+}
+
+bool nvm_queue_calibration_group(const CalGroupMember* members, uint8_t n,
+                                 void (*done)(void* ctx, bool ok), void* ctx) noexcept {
+    ensure_flash_jobs();
+    return cal_store_queue_group_burn(members, n, done, ctx);
+}
+
+bool nvm_queue_rollback(uint8_t page, void (*done)(void* ctx, bool ok), void* ctx) noexcept {
+    if (page > 9u) { return false; }
+    ensure_flash_jobs();
+    return cal_store_queue_rollback(page, done, ctx);
+}
+
+static void cal_save_done(void* ctx, bool ok) noexcept {
+    *static_cast<int8_t*>(ctx) = ok ? 1 : 0;
+}
 
-    FLASH_NSCR &= ~FLASH_CR_PG;
+bool nvm_save_calibration(uint8_t page, const uint8_t* data, uint16_t len) noexcept {
+    int8_t result = -1;
+    if (!nvm_queue_calibration(page, data, len, cal_save_done, &result)) { return false; }
+    // Timeout generoso: erase de 8 KB + 64 quad-words, com margem para jobs
+    // já enfileirados à frente.
+    constexpr uint32_t kSaveDrainTimeoutUs = 200000u;
+    static_cast<void>(flash_jobs_drain(kSaveDrainTimeoutUs));
+    return result == 1;
+}
+
+bool nvm_load_calibration(uint8_t page, uint8_t* data, uint16_t len) noexcept {
+    if (page > 9u || data == nullptr || len == 0u) { return false; }
+    ensure_flash_jobs();
+    // Leitura direta da Flash (mapeada em memória) da cópia activa.
+    return cal_store_load(page, data, len);
+}
+
+bool nvm_jobs_process(uint32_t budget_us) noexcept {
+    ensure_flash_jobs();
+    return flash_jobs_step(budget_us);
+}
+
+} // namespace ems::hal
+
+#else  // EMS_HOST_TEST ─────────────────────────────────────────────────────
+
+namespace ems::hal {
+
+// Páginas de calibração no modelo de flash de hal/flash_jobs (cópia A no
+// setor 1 + page, B no 15 + page, como no target); burns passam pela mesma
+// fila de jobs e por hal/cal_store.
+static constexpr uint16_t kHostCalSector0  = 1u;
+static constexpr uint16_t kHostCalSectorB0 = 15u;
+// Journal adaptativo nos setores 11-14 do modelo; setor 0 = legado LTF3.
+static constexpr uint16_t kHostJournalSector0 = 11u;
+static constexpr uint16_t kHostLegacySector   = 0u;
+static uint32_t g_erase_cnt   = 0u, g_prog_cnt = 0u;
+static bool     g_flash_busy      = false;  // simulates flash BSY timeout when set
+static uint32_t g_flash_busy_polls = 0u;     // non-zero → simulate timeout on next op
+
+// ── Backend do journal sobre o modelo de flash (hal/flash_jobs.h) ───────────
+// Mesma disciplina do target: o poll não-Busy fecha a operação (idle) e
+// reporta o erro latched do controlador.
+static const uint8_t* host_journal_sector(uint8_t idx) noexcept {
+    return flash_host_model_io()->sector(static_cast<uint16_t>(kHostJournalSector0 + idx));
+}
+
+static bool host_journal_erase(uint8_t idx) noexcept {
+    return flash_host_model_io()->erase(static_cast<uint16_t>(kHostJournalSector0 + idx));
+}
+
+static bool host_journal_program(uint8_t idx, uint32_t offset, const uint8_t* qw) noexcept {
+    return flash_host_model_io()->program(
+        static_cast<uint16_t>(kHostJournalSector0 + idx), offset, qw);
+}
+
+static NvmIoPoll host_journal_poll() noexcept {
+    const FlashJobIo* io = flash_host_model_io();
+    const FlashOpPoll p = io->poll();
+    if (p == FlashOpPoll::Busy) { return NvmIoPoll::Busy; }
+    io->idle();
+    return (p == FlashOpPoll::Error) ? NvmIoPoll::Error : NvmIoPoll::Ready;
+}
+
+static const NvmJournalIo kHostJournalIo = {
+    host_journal_sector, host_journal_erase, host_journal_program, host_journal_poll,
+};
+
+static const NvmJournalIo* adaptive_journal_io() noexcept { return &kHostJournalIo; }
+
+static const uint8_t* adaptive_legacy_sector() noexcept {
+    return flash_host_model_sector(kHostLegacySector);
+}
+
+static constexpr uint16_t adaptive_legacy_sector_id() noexcept { return kHostLegacySector; }
+
+// flash_test_set_busy_polls: escritas LTFT/knock recusadas como no BSY.
+static bool adaptive_writes_blocked() noexcept { return g_flash_busy; }
+
+// Callback do chamador por slot da fila: os contadores de teste só contam
+// páginas efectivamente gravadas (job concluído com verify ok).
+struct HostCalBurn {
+    void (*done)(void*, bool);
+    void* ctx;
+    bool  in_use;
+};
+static HostCalBurn g_cal_burns[kFlashJobQueueDepth] = {};
+
+static void ensure_flash_jobs() noexcept {
+    if (flash_jobs_io() != flash_host_model_io()) {
+        flash_jobs_attach(flash_host_model_io());
+        cal_store_configure(kHostCalSector0, kHostCalSectorB0);
+        cal_store_bind_tables();
+    }
+}
+
+static void host_cal_done(void* ctx, bool ok) noexcept {
+    HostCalBurn* b = static_cast<HostCalBurn*>(ctx);
+    b->in_use = false;
+    if (ok) { ++g_erase_cnt; ++g_prog_cnt; }
+    if (b->done != nullptr) { b->done(b->ctx, ok); }
+}
+
+bool nvm_queue_calibration(uint8_t pg, const uint8_t* d, uint16_t l,
+                           void (*done)(void*, bool), void* ctx) noexcept {
+    if (pg > 9u || d == nullptr || l == 0u) return false;
+    if (g_flash_busy) { return false; }
+    ensure_flash_jobs();
+    HostCalBurn* b = nullptr;
+    for (HostCalBurn& e : g_cal_burns) {
+        if (!e.in_use) { b = &e; break; }
+    }
+    if (b == nullptr) { return false; }
+    *b = HostCalBurn{done, ctx, true};
+    if (!cal_store_queue_burn(pg, d, l, host_cal_done, b)) {
+        b->in_use = false;
+        return false;
+    }
     return true;
 }
 
+struct HostCalGroup {
+    void (*done)(void*, bool);
+    void*   ctx;
+    uint8_t n;
+};
+static HostCalGroup g_cal_group = {};
+
+static void host_cal_group_done(void* ctx, bool ok) noexcept {
+    HostCalGroup* g = static_cast<HostCalGroup*>(ctx);
+    if (ok) { g_erase_cnt += g->n; g_prog_cnt += g->n; }
+    if (g->done != nullptr) { g->done(g->ctx, ok); }
+}
+
+bool nvm_queue_calibration_group(const CalGroupMember* members, uint8_t n,
+                                 void (*done)(void*, bool), void* ctx) noexcept {
+    if (g_flash_busy) { return false; }
+    ensure_flash_jobs();
+    const HostCalGroup prev = g_cal_group;
+    g_cal_group = HostCalGroup{done, ctx, n};
+    if (!cal_store_queue_group_burn(members, n, host_cal_group_done, &g_cal_group)) {
+        g_cal_group = prev;
+        return false;
+    }
+    return true;
+}
+
+bool nvm_queue_rollback(uint8_t pg, void (*done)(void*, bool), void* ctx) noexcept {
+    if (pg > 9u) return false;
+    if (g_flash_busy) { return false; }
+    ensure_flash_jobs();
+    return cal_store_queue_rollback(pg, done, ctx);
+}
+
+static void host_cal_save_done(void* ctx, bool ok) noexcept {
+    *static_cast<int8_t*>(ctx) = ok ? 1 : 0;
+}
+
+bool nvm_save_calibration(uint8_t pg, const uint8_t* d, uint16_t l) noexcept {
+    int8_t result = -1;
+    if (!nvm_queue_calibration(pg, d, l, host_cal_save_done, &result)) { return false; }
+    static_cast<void>(flash_jobs_drain(1000000u));
+    return result == 1;
+}
+bool nvm_load_calibration(uint8_t pg, uint8_t* d, uint16_t l) noexcept {
+    if (pg > 9u || d == nullptr || l == 0u) return false;
+    ensure_flash_jobs();
+    return cal_store_load(pg, d, l);
+}
+bool nvm_jobs_process(uint32_t budget_us) noexcept {
+    ensure_flash_jobs();
+    return flash_jobs_step(budget_us);
+}
+
+} // namespace ems::hal
+
+#endif  // EMS_HOST_TEST
+
+// ── Journal com priming ES0565 ───────────────────────────────────────────────
+// O journal corre como task job e fala com a flash pelo seu próprio backend:
+// este wrapper arma flash_jobs_primed() só quando um erase/program iniciado
+// por ele conclui Ready (flush sem células alteradas não conta).
+namespace ems::hal {
+
+static bool g_journal_op_issued = false;
+
+static const uint8_t* primed_journal_sector(uint8_t idx) noexcept {
+    return adaptive_journal_io()->sector(idx);
+}
+
+static bool primed_journal_erase(uint8_t idx) noexcept {
+    const bool ok = adaptive_journal_io()->erase(idx);
+    if (ok) { g_journal_op_issued = true; }
+    return ok;
+}
+
+static bool primed_journal_program(uint8_t idx, uint32_t offset, const uint8_t* qw) noexcept {
+    const bool ok = adaptive_journal_io()->program(idx, offset, qw);
+    if (ok) { g_journal_op_issued = true; }
+    return ok;
+}
+
+static NvmIoPoll primed_journal_poll() noexcept {
+    const NvmIoPoll p = adaptive_journal_io()->poll();
+    if (p != NvmIoPoll::Busy && g_journal_op_issued) {
+        g_journal_op_issued = false;
+        if (p == NvmIoPoll::Ready) { flash_jobs_mark_primed(); }
+    }
+    return p;
+}
+
+static const NvmJournalIo kPrimedJournalIo = {
+    primed_journal_sector, primed_journal_erase, primed_journal_program, primed_journal_poll,
+};
+
+}  // namespace ems::hal
+
+// ── Buffers SRAM para LTFT e Knock maps ─────────────────────────────────────
+// Espelham os dados da Flash; modificados em RAM e flushed periodicamente.
+// Layout do Setor 0: ver kNvmOff* em flash.h (offsets derivados das dimensões).
+static int8_t  g_ltft_ram[ems::hal::kNvmLtftDim][ems::hal::kNvmLtftDim] = {};
+static int8_t  g_knock_ram[8][8]  = {};     // 8×8 fixo (por-cilindro, não segue o grid)
+static int8_t  g_ltft_add_ram[ems::hal::kNvmLtftAddDim][ems::hal::kNvmLtftAddDim] = {};  // 50µs/count
+static bool    g_ltft_dirty     = false;
+static bool    g_knock_dirty    = false;
+static bool    g_ltft_add_dirty = false;
+static uint32_t g_nvm_now_ms              = 0u;
+static uint32_t g_last_adaptive_flush_ms  = 0u;
+static bool     g_adaptive_flush_asap     = false;
+// True while nvm_flush_adaptive_maps holds the journal (erase/program in flight).
+static bool     g_journal_flush_active    = false;
+// Setor 0 legado: g_legacy_migrated = imagem montada dele, à espera do primeiro
+// commit do journal; g_legacy_revoke = journal já tem a imagem e o setor 0
+// ainda tem LTF3 válido — apagá-lo (senão um anel corrompido mais tarde
+// ressuscitaria os mapas antigos na migração).
+static bool     g_legacy_migrated         = false;
+static bool     g_legacy_revoke           = false;
+// Seed lives in the same image as adaptive maps — never erase independently.
+// g_seed_ram is always the source of truth for the next flush; g_seed_dirty
+// forces a journal flush even when LTFT/knock/add are clean.
+static ems::hal::RuntimeSyncSeed g_seed_ram{};
+static bool g_seed_dirty = false;
+// EtbCalRecord: mesma regra do seed — shadow na imagem adaptativa, nunca
+// erase próprio. pack só sobrepõe o registro quando o shadow é válido (magic
+// ok), senão a cópia montada do journal é preservada.
+static ems::hal::EtbCalRecord g_etbcal_ram{};
+static bool g_etbcal_dirty = false;
+// Memória de DTCs: blob opaco (validado no engine), mesma regra do seed.
+static uint8_t g_dtc_ram[ems::hal::kNvmDtcStoreBytes] = {};
+static bool g_dtc_dirty = false;
+// Imagem adaptativa (layout kNvmOff* até ao EtbCalRecord) que o journal
+// persiste por deltas; montada no boot, re-empacotada a cada flush.
+static uint8_t g_adaptive_image[ems::hal::kNvmAdaptiveImageBytes] = {};
+
 namespace ems::hal {
 
 // ── LTFT map ─────────────────────────────────────────────────────────────────
 
 bool nvm_write_ltft(uint8_t rpm_i, uint8_t load_i, int8_t val) noexcept {
     if (rpm_i >= kNvmLtftDim || load_i >= kNvmLtftDim) { return false; }
+    if (adaptive_writes_blocked()) { return false; }
     if (g_ltft_ram[rpm_i][load_i] != val) {
         g_ltft_ram[rpm_i][load_i] = val;
         g_ltft_dirty = true;
@@ -238,45 +575,71 @@ int8_t nvm_read_ltft(uint8_t rpm_i, uint8_t load_i) noexcept {
     return g_ltft_ram[rpm_i][load_i];
 }
 
+static void unpack_adaptive_image(const uint8_t* img) noexcept {
+    std::memcpy(g_ltft_ram,     img + kNvmOffLtft,      sizeof(g_ltft_ram));
+    std::memcpy(g_knock_ram,    img + kNvmOffKnock,     sizeof(g_knock_ram));
+    std::memcpy(g_ltft_add_ram, img + kNvmOffLtftAdd,   sizeof(g_ltft_add_ram));
+    std::memcpy(&g_seed_ram,    img + kNvmSeedOffset,   sizeof(g_seed_ram));
+    std::memcpy(&g_etbcal_ram,  img + kNvmEtbCalOffset, sizeof(g_etbcal_ram));
+    std::memcpy(g_dtc_ram,      img + kNvmDtcStoreOffset, sizeof(g_dtc_ram));
+}
+
+
 bool nvm_load_adaptive_maps() noexcept {
-    // Magic+CRC gate: setor apagado, layout antigo (LTF2), ou bit-rot nos
-    // mapas → zera e marca dirty; o flush regrava LTF3 + CRC + seed.
-    const uint8_t* sector = reinterpret_cast<const uint8_t*>(kBank2Base);
-    if (!nvm_adaptive_sector_valid(sector)) {
-        std::memset(g_ltft_ram, 0, sizeof(g_ltft_ram));
-        std::memset(g_knock_ram, 0, sizeof(g_knock_ram));
-        std::memset(g_ltft_add_ram, 0, sizeof(g_ltft_add_ram));
-        std::memset(&g_seed_ram, 0, sizeof(g_seed_ram));
-        std::memset(&g_etbcal_ram, 0, sizeof(g_etbcal_ram));
-        g_ltft_dirty     = true;
-        g_knock_dirty    = true;
-        g_ltft_add_dirty = true;
-        g_seed_dirty     = false;  // blank seed need not force rewrite alone
+    // Ordem: journal (setores 11-14) → setor 0 legado (migração única) →
+    // zeros. Magic+CRC gate em ambos: imagem sem LTF3 válido não é aplicada.
+    g_journal_flush_active = false;
+    g_legacy_migrated = false;
+    g_legacy_revoke   = false;
+    g_journal_op_issued = false;
+    if (nvm_journal_attach(&kPrimedJournalIo,
+                           static_cast<uint16_t>(kNvmAdaptiveImageBytes)) &&
+        nvm_journal_mount(g_adaptive_image) &&
+        nvm_adaptive_sector_valid(g_adaptive_image)) {
+        // Erase do setor 0 interrompido no ciclo anterior: repete no flush.
+        g_legacy_revoke = nvm_adaptive_sector_valid(adaptive_legacy_sector());
+        unpack_adaptive_image(g_adaptive_image);
+        g_ltft_dirty     = false;
+        g_knock_dirty    = false;
+        g_ltft_add_dirty = false;
+        g_seed_dirty     = false;
         g_etbcal_dirty   = false;
+        g_dtc_dirty      = false;
         return true;
     }
 
-    std::memcpy(g_ltft_ram,
-                reinterpret_cast<const void*>(kBank2Base + kNvmOffLtft),
-                sizeof(g_ltft_ram));
-    std::memcpy(g_knock_ram,
-                reinterpret_cast<const void*>(kBank2Base + kNvmOffKnock),
-                sizeof(g_knock_ram));
-    std::memcpy(g_ltft_add_ram,
-                reinterpret_cast<const void*>(kBank2Base + kNvmOffLtftAdd),
-                sizeof(g_ltft_add_ram));
-    std::memcpy(&g_seed_ram,
-                reinterpret_cast<const void*>(kBank2Base + kNvmSeedOffset),
-                sizeof(g_seed_ram));
-    std::memcpy(&g_etbcal_ram,
-                reinterpret_cast<const void*>(kBank2Base + kNvmEtbCalOffset),
-                sizeof(g_etbcal_ram));
+    const uint8_t* legacy = adaptive_legacy_sector();
+    if (nvm_adaptive_sector_valid(legacy)) {
+        // Firmware anterior ao journal: importa o setor 0 e agenda o
+        // primeiro flush (formata o anel com o snapshot migrado).
+        std::memcpy(g_adaptive_image, legacy, sizeof(g_adaptive_image));
+        unpack_adaptive_image(g_adaptive_image);
+        g_ltft_dirty          = true;
+        g_knock_dirty         = false;
+        g_ltft_add_dirty      = false;
+        g_seed_dirty          = false;
+        g_etbcal_dirty        = false;
+        g_dtc_dirty           = false;
+        g_adaptive_flush_asap = true;
+        g_legacy_migrated     = true;
+        return true;
+    }
 
-    g_ltft_dirty     = false;
-    g_knock_dirty    = false;
-    g_ltft_add_dirty = false;
-    g_seed_dirty     = false;
+    // Anel vazio/corrompido e setor 0 sem LTF3 → zera e marca dirty; o
+    // flush formata o journal.
+    std::memset(g_adaptive_image, 0, sizeof(g_adaptive_image));
+    std::memset(g_ltft_ram, 0, sizeof(g_ltft_ram));
+    std::memset(g_knock_ram, 0, sizeof(g_knock_ram));
+    std::memset(g_ltft_add_ram, 0, sizeof(g_ltft_add_ram));
+    std::memset(&g_seed_ram, 0, sizeof(g_seed_ram));
+    std::memset(&g_etbcal_ram, 0, sizeof(g_etbcal_ram));
+    std::memset(g_dtc_ram, 0, sizeof(g_dtc_ram));
+    g_ltft_dirty     = true;
+    g_knock_dirty    = true;
+    g_ltft_add_dirty = true;
+    g_seed_dirty     = false;  // blank seed need not force rewrite alone
     g_etbcal_dirty   = false;
+    g_dtc_dirty      = false;
     return true;
 }
 
@@ -298,6 +661,7 @@ int8_t nvm_read_ltft_add(uint8_t rpm_i, uint8_t load_i) noexcept {
 
 bool nvm_write_knock(uint8_t rpm_i, uint8_t load_i, int8_t retard_deci_deg) noexcept {
     if (rpm_i >= 8u || load_i >= 8u) { return false; }
+    if (adaptive_writes_blocked()) { return false; }
     if (g_knock_ram[rpm_i][load_i] != retard_deci_deg) {
         g_knock_ram[rpm_i][load_i] = retard_deci_deg;
         g_knock_dirty = true;
@@ -315,65 +679,13 @@ void nvm_reset_knock_map() noexcept {
     g_knock_dirty = true;
 }
 
-// ── Calibração (páginas) ──────────────────────────────────────────────────────
-
-bool nvm_save_calibration(uint8_t page, const uint8_t* data, uint16_t len) noexcept {
-    if (page > 9u || data == nullptr || len == 0u) { return false; }
-
-    const uint32_t sector = (page == 9u) ? kSectorCal9 :
-                            (page == 8u) ? kSectorCal8 :
-                            (page == 7u) ? kSectorCal7 :
-                            (page == 6u) ? kSectorCal6 : (kSectorCal0 + page);
-    const uint32_t dest   = kBank2Base + sector * kSectorSize;
-
-    // flash_write_words exige múltiplo de 16 (quad-word de 128 bits, ver
-    // comentário no seu topo) — arredondar para cima ao verificar limites.
-    const uint32_t len16 = (static_cast<uint32_t>(len) + 15u) & ~15u;
-    if (len16 > kSectorSize) { return false; }
-
-    const uint32_t whole_len = static_cast<uint32_t>(len) & ~15u;
-    const uint32_t tail_len = static_cast<uint32_t>(len) - whole_len;  // 0..15
-
-    flash_unlock_bank2();
-    bool ok = flash_erase_sector(sector);
-    if (ok && whole_len != 0u) {
-        ok = flash_write_words(dest, data, whole_len);
-    }
-    if (ok && tail_len != 0u) {
-        uint8_t tail[16];
-        std::memset(tail, 0xFFu, sizeof(tail));
-        std::memcpy(tail, data + whole_len, tail_len);
-        ok = flash_write_words(dest + whole_len, tail, sizeof(tail));
-    }
-    flash_lock_bank2();
-    // DIAG (2026-07-09): burn reportava OK mas não sobrevivia a power-cycle.
-    // Suspeita: write buffer de 128 bits (WBNE/DBNE) do STM32H5 não é
-    // forçado a comitar para NV storage nas mesmas condições em que
-    // flash_wait_ready() considera "pronto". Readback imediato expõe
-    // isto sem esperar por reboot — se falhar aqui, confirma a hipótese.
-    if (ok) {
-        ok = std::memcmp(reinterpret_cast<const void*>(dest), data, len) == 0;
-    }
-    return ok;
-}
-
-bool nvm_load_calibration(uint8_t page, uint8_t* data, uint16_t len) noexcept {
-    if (page > 9u || data == nullptr || len == 0u) { return false; }
-
-    const uint32_t sector = (page == 9u) ? kSectorCal9 :
-                            (page == 8u) ? kSectorCal8 :
-                            (page == 7u) ? kSectorCal7 :
-                            (page == 6u) ? kSectorCal6 : (kSectorCal0 + page);
-    const uint32_t src    = kBank2Base + sector * kSectorSize;
-
-    // Leitura direta da Flash (mapeada em memória)
-    std::memcpy(data, reinterpret_cast<const void*>(src), len);
-    return true;
-}
 
 // ── Flush LTFT + Knock para Flash ─────────────────────────────────────────────
-// Poll do main (ex. 500 ms). Rate-limit: no máximo 1 erase/program completo
-// por kMinAdaptiveFlushIntervalMs, salvo nvm_request_adaptive_flush_now().
+// Poll do main (ex. 500 ms). Rate-limit: no máximo 1 flush completo por
+// kMinAdaptiveFlushIntervalMs, salvo nvm_request_adaptive_flush_now(). Cada
+// flush enfileira um job (hal/flash_jobs.h) que só acrescenta registos das
+// células alteradas ao journal — o erase (não-bloqueante) acontece apenas
+// na compactação de um setor cheio.
 
 void nvm_set_now_ms(uint32_t now_ms) noexcept {
     g_nvm_now_ms = now_ms;
@@ -385,169 +697,112 @@ void nvm_request_adaptive_flush_now() noexcept {
 
 bool nvm_adaptive_maps_dirty() noexcept {
     return g_ltft_dirty || g_knock_dirty || g_ltft_add_dirty || g_seed_dirty ||
-           g_etbcal_dirty;
-}
-
-// Pack RAM maps + seed + LTF3 header into sector_buf (full FLASH_SECTOR_SIZE).
-static void pack_adaptive_sector(uint8_t* sector_buf) noexcept {
-    std::memcpy(sector_buf,
-                reinterpret_cast<const void*>(kBank2Base),
-                FLASH_SECTOR_SIZE);
-    std::memcpy(sector_buf + kNvmOffLtft,    g_ltft_ram,     sizeof(g_ltft_ram));
-    std::memcpy(sector_buf + kNvmOffKnock,   g_knock_ram,    sizeof(g_knock_ram));
-    std::memcpy(sector_buf + kNvmOffLtftAdd, g_ltft_add_ram, sizeof(g_ltft_add_ram));
-    nvm_stamp_adaptive_header(sector_buf);
-    std::memcpy(sector_buf + kNvmSeedOffset, &g_seed_ram, sizeof(g_seed_ram));
+           g_etbcal_dirty || g_dtc_dirty;
+}
+
+// Pack RAM maps + seed + LTF3 header into the adaptive image. O EtbCalRecord
+// só é sobreposto quando o shadow é válido (senão mantém o valor montado).
+static void pack_adaptive_image(uint8_t* img) noexcept {
+    std::memcpy(img + kNvmOffLtft,    g_ltft_ram,     sizeof(g_ltft_ram));
+    std::memcpy(img + kNvmOffKnock,   g_knock_ram,    sizeof(g_knock_ram));
+    std::memcpy(img + kNvmOffLtftAdd, g_ltft_add_ram, sizeof(g_ltft_add_ram));
+    nvm_stamp_adaptive_header(img);
+    std::memcpy(img + kNvmSeedOffset, &g_seed_ram, sizeof(g_seed_ram));
     if (etb_cal_record_ok(g_etbcal_ram)) {
-        std::memcpy(sector_buf + kNvmEtbCalOffset, &g_etbcal_ram, sizeof(g_etbcal_ram));
+        std::memcpy(img + kNvmEtbCalOffset, &g_etbcal_ram, sizeof(g_etbcal_ram));
     }
+    std::memcpy(img + kNvmDtcStoreOffset, g_dtc_ram, sizeof(g_dtc_ram));
 }
 
-bool nvm_flush_adaptive_maps() noexcept {
-    enum class FlushState : uint8_t {
-        Idle,
-        WaitErase,
-        Program,
-        WaitFinal,
-    };
-    static uint8_t sector_buf[FLASH_SECTOR_SIZE] = {};
-    static FlushState state = FlushState::Idle;
-    static uint32_t word_i = 0u;
-    static uint32_t bsy_stall_count = 0u;  // FIX C8: detect permanently stuck BSY
-    static bool held_seed_dirty = false;
-
-    const auto fail = []() noexcept {
-        FLASH_NSCR &= ~(FLASH_CR_PG | FLASH_CR_SER | FLASH_CR_BKSEL | FLASH_CR_SNB_MASK);
-        flash_lock_bank2();
-        g_ltft_dirty     = true;
-        g_knock_dirty    = true;
-        g_ltft_add_dirty = true;
-        g_seed_dirty     = true;  // re-attempt seed with maps
-        g_etbcal_dirty   = etb_cal_record_ok(g_etbcal_ram);  // re-attempt se shadow válido
-        g_sector0_flush_active = false;
-        return false;
+static void clear_adaptive_dirty() noexcept {
+    g_ltft_dirty     = false;
+    g_knock_dirty    = false;
+    g_ltft_add_dirty = false;
+    g_seed_dirty     = false;
+    g_etbcal_dirty   = false;
+    g_dtc_dirty      = false;
+}
+
+// Task da fila: 1 registo do journal por chamada (a fila fatia pelo tempo).
+static FlashTaskStatus journal_flush_task(void*) noexcept {
+    const NvmJournalStatus st = nvm_journal_flush_step(g_adaptive_image, 1u);
+    if (st == NvmJournalStatus::Busy) { return FlashTaskStatus::Busy; }
+    return (st == NvmJournalStatus::Idle) ? FlashTaskStatus::Done : FlashTaskStatus::Error;
+}
+
+// Revogação do setor 0: burn de 1 quad-word apagado = só o erase do setor
+// (a fila não programa quad-words 0xFF) + verify. Falha → tenta no flush
+// seguinte.
+static void legacy_revoke_done(void*, bool ok) noexcept {
+    if (!ok) { g_legacy_revoke = true; }
+}
+
+static void submit_legacy_revoke() noexcept {
+    static const uint8_t kErasedQuadWord[16] = {
+        0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu,
+        0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu,
     };
+    if (!g_legacy_revoke) { return; }
+    ensure_flash_jobs();
+    if (flash_jobs_submit_burn(adaptive_legacy_sector_id(), kErasedQuadWord,
+                               sizeof(kErasedQuadWord), legacy_revoke_done, nullptr)) {
+        g_legacy_revoke = false;
+    }
+}
 
-    if (state == FlushState::Idle) {
-        if (!g_ltft_dirty && !g_knock_dirty && !g_ltft_add_dirty && !g_seed_dirty &&
-            !g_etbcal_dirty) {
-            return true;
+static void journal_flush_done(void*, bool ok) noexcept {
+    g_journal_flush_active = false;
+    if (ok) {
+        g_last_adaptive_flush_ms = g_nvm_now_ms;
+        // Primeiro commit depois da migração: o journal é agora a única
+        // cópia; o slot deste job já foi libertado para o erase do setor 0.
+        if (g_legacy_migrated) {
+            g_legacy_migrated = false;
+            g_legacy_revoke   = true;
         }
+        submit_legacy_revoke();
+    } else {
+        // O journal força compactação no próximo flush; basta re-agendar.
+        g_ltft_dirty = true;
+    }
+}
+
+bool nvm_flush_adaptive_maps() noexcept {
+    if (g_journal_flush_active) { return false; }  // job na fila
+    submit_legacy_revoke();
+    {
+        if (!nvm_adaptive_maps_dirty()) { return true; }
 
         // Rate-limit: adia flush se ainda dentro do intervalo (mantém dirty).
-        // Seed-only writes (engine stop) always bypass rate-limit via asap or
-        // when only g_seed_dirty — still respect asap flag from request_now.
+        // Seed-only writes (engine stop) always bypass rate-limit.
         if (!g_adaptive_flush_asap && g_last_adaptive_flush_ms != 0u) {
             const uint32_t age = g_nvm_now_ms - g_last_adaptive_flush_ms;
-            // Seed-only: allow without waiting 60 s (stop-sync must persist).
             const bool seed_only = g_seed_dirty &&
-                !g_ltft_dirty && !g_knock_dirty && !g_ltft_add_dirty && !g_etbcal_dirty;
+                !g_ltft_dirty && !g_knock_dirty && !g_ltft_add_dirty && !g_etbcal_dirty &&
+                !g_dtc_dirty;
             if (!seed_only && age < kMinAdaptiveFlushIntervalMs) {
                 return true;  // defer — main re-agenda no próximo tick
             }
         }
         g_adaptive_flush_asap = false;
 
-        pack_adaptive_sector(sector_buf);
-        held_seed_dirty  = g_seed_dirty;
-        g_ltft_dirty     = false;
-        g_knock_dirty    = false;
-        g_ltft_add_dirty = false;
-        g_seed_dirty     = false;
-        g_etbcal_dirty   = false;
-
-        flash_unlock_bank2();
-        FLASH_NSCCR = 0xFFFFFFFFu;
-        FLASH_NSCR = FLASH_CR_SER
-                  | FLASH_CR_BKSEL
-                  | ((kSectorLtft << FLASH_CR_SNB_SHIFT) & FLASH_CR_SNB_MASK)
-                  | FLASH_CR_STRT;
-        g_sector0_flush_active = true;
-        state = FlushState::WaitErase;
-        return false;
-    }
-
-    if (FLASH_NSSR & kFlashBusyMask) { return false; }
-    if (FLASH_NSSR & kFlashErrorMask) {
-        state = FlushState::Idle;
-        return fail();
-    }
-
-    if (state == FlushState::WaitErase) {
-        FLASH_NSCR &= ~(FLASH_CR_SER | FLASH_CR_BKSEL | FLASH_CR_SNB_MASK);
-        FLASH_NSCCR = 0xFFFFFFFFu;
-        FLASH_NSCR |= FLASH_CR_PG;
-        word_i = 0u;
-        state = FlushState::Program;
-    }
-
-    if (state == FlushState::Program) {
-        // DIAG (2026-07-09): escrever 1 palavra/iteração e verificar BSY antes
-        // da SEGUINTE fazia o loop ler SR.WBNE=1 (buffer com 1-3 palavras do
-        // quad-word ainda por completar) como "ocupado" — exactamente o
-        // sintoma que o "FIX C8" abaixo mascarava (BSY nunca liberta,
-        // word_i nunca avança) sem resolver a causa: as 4 palavras de um
-        // flash-word de 128 bits têm de ser escritas em sucessão imediata,
-        // sem poll de status entre elas (ver flash_write_words). kFlashWordsPerStep
-        // é múltiplo de 4 — orçamento agora em quad-words, não em palavras soltas.
-        volatile uint32_t* dst32 = reinterpret_cast<volatile uint32_t*>(kBank2Base);
-        const uint32_t* src32 = reinterpret_cast<const uint32_t*>(sector_buf);
-        const uint32_t nwords = sizeof(sector_buf) / sizeof(uint32_t);
-        uint32_t budget_qw = kFlashWordsPerStep / 4u;
-        while ((word_i < nwords) && (budget_qw-- != 0u)) {
-            if (FLASH_NSSR & kFlashBusyMask) {
-                // FIX C8: se BSY nunca limpar entre quad-words (ex.: hardware
-                // preso), aborta e remarca dirty para o próximo ciclo tentar.
-                constexpr uint32_t kBsyStallLimit = 50000u;
-                if (++bsy_stall_count >= kBsyStallLimit) {
-                    bsy_stall_count = 0u;
-                    state = FlushState::Idle;
-                    return fail();
-                }
-                return false;
-            }
-            bsy_stall_count = 0u;  // Reset on any successful progress
-            if (FLASH_NSSR & kFlashErrorMask) {
-                state = FlushState::Idle;
-                return fail();
-            }
-            const uint32_t n = (nwords - word_i < 4u) ? (nwords - word_i) : 4u;
-            {
-                // As (até) 4 palavras do quad-word em sucessão imediata, sem
-                // IRQs no meio (ver flash_write_words).
-                ems::hal::CriticalSectionGuard guard;
-                for (uint32_t i = 0u; i < n; ++i) {
-                    dst32[word_i + i] = src32[word_i + i];
-                }
-            }
-            word_i += n;
-        }
-        if (word_i < nwords) { return false; }
-        state = FlushState::WaitFinal;
-    }
-
-    if (state == FlushState::WaitFinal) {
-        if (FLASH_NSSR & kFlashBusyMask) { return false; }
-        if (FLASH_NSSR & kFlashErrorMask) {
-            state = FlushState::Idle;
-            return fail();
+        // Snapshot da RAM: escritas durante o flush voltam a marcar dirty e
+        // entram no flush seguinte. g_adaptive_image fica congelada até o
+        // job concluir (journal_flush_done).
+        ensure_flash_jobs();
+        pack_adaptive_image(g_adaptive_image);
+        if (!flash_jobs_submit_task(journal_flush_task, nullptr, journal_flush_done)) {
+            return false;  // fila cheia (burns) — dirty mantido, tenta de novo
         }
-        FLASH_NSCR &= ~FLASH_CR_PG;
-        flash_lock_bank2();
-        state = FlushState::Idle;
-        g_sector0_flush_active = false;
-        g_last_adaptive_flush_ms = g_nvm_now_ms;
-        (void)held_seed_dirty;
-        return !g_ltft_dirty && !g_knock_dirty && !g_ltft_add_dirty && !g_seed_dirty &&
-               !g_etbcal_dirty;
+        clear_adaptive_dirty();
+        g_journal_flush_active = true;
     }
-
     return false;
 }
 
 // ── RuntimeSyncSeed (boot rápido) ────────────────────────────────────────────
-// Sempre via shadow RAM + flush SM do setor 0 (nunca erase independente).
-// Layout antigo / LTF2 / CRC maps inválido → seed rejeitado no load.
+// Sempre via shadow RAM + journal da imagem adaptativa (nunca erase próprio).
+// Imagem sem LTF3 / CRC maps inválido → seed rejeitado no load.
 
 bool nvm_save_runtime_seed(const RuntimeSyncSeed* seed) noexcept {
     if (seed == nullptr) { return false; }
@@ -562,35 +817,13 @@ bool nvm_save_runtime_seed(const RuntimeSyncSeed* seed) noexcept {
     w.crc32 = runtime_seed_crc32(w);
     g_seed_ram = w;
     g_seed_dirty = true;
-    g_adaptive_flush_asap = true;  // stop-sync must not wait 60 s rate-limit
+    g_adaptive_flush_asap = true;  // stop-sync must not wait for the rate-limit
 
-    // If flush SM already owns the sector, RAM shadow is enough — SM will
-    // re-read dirty flags after completion or on next Idle entry.
-    if (g_sector0_flush_active) { return true; }
-
-    // Idle: pack + blocking erase/program so seed survives power-cycle even
-    // if main loop does not re-enter flush before shutdown.
-    static uint8_t sector_buf[FLASH_SECTOR_SIZE] = {};
-    const bool etbcal_packed = etb_cal_record_ok(g_etbcal_ram);
-    pack_adaptive_sector(sector_buf);
-    flash_unlock_bank2();
-    const bool ok = flash_erase_sector(kSectorLtft) &&
-                    flash_write_words(kBank2Base, sector_buf, sizeof(sector_buf));
-    flash_lock_bank2();
-    if (ok) {
-        g_seed_dirty = false;
-        // Maps were co-written; clear dirty if they were only dirty because of
-        // a concurrent edit — actually maps may still be dirty in RAM if we
-        // packed current RAM. Clear all dirty on success (sector matches RAM).
-        g_ltft_dirty = false;
-        g_knock_dirty = false;
-        g_ltft_add_dirty = false;
-        // EtbCalRecord foi co-escrito no pack quando o shadow era válido —
-        // limpar o dirty evita um erase extra do setor no próximo flush.
-        if (etbcal_packed) { g_etbcal_dirty = false; }
-        g_last_adaptive_flush_ms = g_nvm_now_ms;
-    }
-    return ok;
+    // Nunca grava aqui: o flush do journal entra na fila como qualquer outro
+    // (fura o rate-limit via asap) e o main conclui-o nos slots de 2 ms. Com
+    // flush/burn já na fila o seed fica dirty e segue no flush seguinte.
+    static_cast<void>(nvm_flush_adaptive_maps());
+    return true;
 }
 
 bool nvm_load_runtime_seed(RuntimeSyncSeed* seed_out) noexcept {
@@ -601,13 +834,9 @@ bool nvm_load_runtime_seed(RuntimeSyncSeed* seed_out) noexcept {
         *seed_out = g_seed_ram;
         return true;
     }
-    const uint32_t addr = kBank2Base + kNvmSeedOffset;
-    std::memcpy(seed_out, reinterpret_cast<const void*>(addr),
-                sizeof(RuntimeSyncSeed));
-    if (seed_out->crc32 != runtime_seed_crc32(*seed_out)) { return false; }
-    if (!runtime_seed_boot_compatible_60_2(*seed_out)) { return false; }
-    g_seed_ram = *seed_out;
-    return true;
+    // Sem fallback à flash: o shadow é populado por nvm_load_adaptive_maps()
+    // (journal ou migração do setor 0) — fora disso não há seed válido.
+    return false;
 }
 
 bool nvm_clear_runtime_seed() noexcept {
@@ -616,8 +845,8 @@ bool nvm_clear_runtime_seed() noexcept {
 }
 
 // ── EtbCalRecord (última auto-cal ETB) ───────────────────────────────────────
-// Mesma disciplina do seed: shadow RAM + flush SM do setor 0. Diferente do
-// seed, não faz write bloqueante — a auto-cal acontece no key-on e o main
+// Mesma disciplina do seed: shadow RAM + journal adaptativo. Diferente do
+// seed, não submete o flush de imediato — a auto-cal acontece no key-on e o main
 // loop roda tempo de sobra para o flush não-bloqueante completar.
 
 bool nvm_save_etb_cal(const EtbCalRecord* rec) noexcept {
@@ -630,7 +859,7 @@ bool nvm_save_etb_cal(const EtbCalRecord* rec) noexcept {
     w.crc32    = etb_cal_crc32(w);
     g_etbcal_ram = w;
     g_etbcal_dirty = true;
-    g_adaptive_flush_asap = true;  // não esperar o rate-limit de 60 s
+    g_adaptive_flush_asap = true;  // não esperar o rate-limit
     return true;
 }
 
@@ -640,167 +869,63 @@ bool nvm_load_etb_cal(EtbCalRecord* out) noexcept {
         *out = g_etbcal_ram;
         return true;
     }
-    const uint32_t addr = kBank2Base + kNvmEtbCalOffset;
-    std::memcpy(out, reinterpret_cast<const void*>(addr), sizeof(EtbCalRecord));
-    if (!etb_cal_record_ok(*out)) { return false; }
-    g_etbcal_ram = *out;
-    return true;
+    // Shadow populado no mount do journal; sem fallback à flash.
+    return false;
 }
 
-} // namespace ems::hal
-
-#else  // EMS_HOST_TEST ─────────────────────────────────────────────────────
-
-namespace ems::hal {
-
-static constexpr uint8_t kTestSeedSlots = 8u;
-
-static int8_t g_ltft[kNvmLtftDim][kNvmLtftDim] = {};
-static int8_t g_knock[8][8]      = {};
-static int8_t g_ltft_add[kNvmLtftAddDim][kNvmLtftAddDim] = {};
-static uint8_t g_cal[10][1024]   = {};  // linha ≥ maior página (lambda 2×kTableCells)
-static uint32_t g_erase_cnt   = 0u, g_prog_cnt = 0u;
-static bool     g_flash_busy      = false;  // simulates flash BSY timeout when set
-static uint32_t g_flash_busy_polls = 0u;     // non-zero → simulate timeout on next op
-
-// Runtime seed: slot array (mirrors the STM32 flash-backed slot layout)
-static RuntimeSyncSeed g_seed_slots[kTestSeedSlots] = {};
-static bool g_seed_slot_valid[kTestSeedSlots] = {};
-
-// EtbCalRecord (última auto-cal ETB)
-static EtbCalRecord g_etbcal_mock{};
-static bool g_etbcal_mock_valid = false;
-
-bool nvm_save_etb_cal(const EtbCalRecord* rec) noexcept {
-    if (rec == nullptr) { return false; }
-    EtbCalRecord w = *rec;
-    w.magic    = ETB_CAL_RECORD_MAGIC;
-    w.version  = ETB_CAL_RECORD_VERSION;
-    w.reserved = 0u;
-    w.crc32    = 0u;
-    w.crc32    = etb_cal_crc32(w);
-    g_etbcal_mock = w;
-    g_etbcal_mock_valid = true;
+bool nvm_save_dtc_store(const uint8_t* data, uint16_t len) noexcept {
+    if (data == nullptr || len > sizeof(g_dtc_ram)) { return false; }
+    if (std::memcmp(g_dtc_ram, data, len) != 0) {
+        std::memcpy(g_dtc_ram, data, len);
+        g_dtc_dirty = true;
+    }
     return true;
 }
 
-bool nvm_load_etb_cal(EtbCalRecord* out) noexcept {
-    if (out == nullptr || !g_etbcal_mock_valid) { return false; }
-    if (!etb_cal_record_ok(g_etbcal_mock)) { return false; }
-    *out = g_etbcal_mock;
+bool nvm_load_dtc_store(uint8_t* out, uint16_t len) noexcept {
+    if (out == nullptr || len > sizeof(g_dtc_ram)) { return false; }
+    std::memcpy(out, g_dtc_ram, len);
     return true;
 }
 
-bool nvm_write_ltft(uint8_t r, uint8_t l, int8_t v) noexcept {
-    if (r >= kNvmLtftDim || l >= kNvmLtftDim) { return false; }
-    if (g_flash_busy) { return false; }
-    g_ltft[r][l] = v; return true;
-}
-int8_t nvm_read_ltft(uint8_t r, uint8_t l) noexcept {
-    if (r >= kNvmLtftDim || l >= kNvmLtftDim) { return 0; }
-    return g_ltft[r][l];
-}
-bool nvm_load_adaptive_maps() noexcept { return true; }
-void nvm_set_now_ms(uint32_t) noexcept {}
-void nvm_request_adaptive_flush_now() noexcept {}
-bool nvm_adaptive_maps_dirty() noexcept { return false; }
-bool nvm_write_knock(uint8_t r, uint8_t l, int8_t v) noexcept {
-    if (r >= 8u || l >= 8u) { return false; }
-    if (g_flash_busy) { return false; }
-    g_knock[r][l] = v; return true;
-}
-int8_t nvm_read_knock(uint8_t r, uint8_t l) noexcept {
-    if (r >= 8u || l >= 8u) { return 0; }
-    return g_knock[r][l];
-}
-void nvm_reset_knock_map() noexcept { std::memset(g_knock, 0, sizeof(g_knock)); }
-bool nvm_write_ltft_add(uint8_t r, uint8_t l, int8_t v) noexcept {
-    if (r >= kNvmLtftAddDim || l >= kNvmLtftAddDim) { return false; }
-    g_ltft_add[r][l] = v; return true;
-}
-int8_t nvm_read_ltft_add(uint8_t r, uint8_t l) noexcept {
-    if (r >= kNvmLtftAddDim || l >= kNvmLtftAddDim) { return 0; }
-    return g_ltft_add[r][l];
-}
-
-bool nvm_save_calibration(uint8_t pg, const uint8_t* d, uint16_t l) noexcept {
-    if (pg > 9u || d == nullptr || l == 0u) return false;
-    if (g_flash_busy) { return false; }
-    ++g_erase_cnt; ++g_prog_cnt;
-    std::memcpy(g_cal[pg], d, l); return true;
-}
-bool nvm_load_calibration(uint8_t pg, uint8_t* d, uint16_t l) noexcept {
-    if (pg > 9u || d == nullptr || l == 0u) return false;
-    std::memcpy(d, g_cal[pg], l); return true;
-}
-bool nvm_flush_adaptive_maps() noexcept { return true; }
-
-bool nvm_save_runtime_seed(const RuntimeSyncSeed* s) noexcept {
-    if (!s) { return false; }
-    // Find slot with highest sequence number to determine next write slot
-    uint32_t max_seq = 0u;
-    uint8_t write_slot = 0u;
-    bool found_any = false;
-    for (uint8_t i = 0u; i < kTestSeedSlots; ++i) {
-        if (!g_seed_slot_valid[i]) {
-            if (!found_any) { write_slot = i; }
-            break;
-        }
-        if (g_seed_slots[i].sequence >= max_seq) {
-            max_seq = g_seed_slots[i].sequence;
-            write_slot = static_cast<uint8_t>((i + 1u) % kTestSeedSlots);
-            found_any = true;
-        }
-    }
-    RuntimeSyncSeed w = *s;
-    w.magic   = RUNTIME_SYNC_SEED_MAGIC;
-    w.version = RUNTIME_SYNC_SEED_VERSION;
-    w.sequence = found_any ? max_seq + 1u : 0u;
-    w.crc32 = runtime_seed_crc32(w);
-    g_seed_slots[write_slot] = w;
-    g_seed_slot_valid[write_slot] = true;
-    return true;
-}
+} // namespace ems::hal
 
-bool nvm_load_runtime_seed(RuntimeSyncSeed* s) noexcept {
-    if (!s) { return false; }
-    // Find valid slot with highest sequence (wrap-aware)
-    bool found = false;
-    uint32_t best_seq = 0u;
-    const RuntimeSyncSeed* best = nullptr;
-    for (uint8_t i = 0u; i < kTestSeedSlots; ++i) {
-        if (!g_seed_slot_valid[i]) { continue; }
-        const RuntimeSyncSeed& sl = g_seed_slots[i];
-        if (sl.crc32 != runtime_seed_crc32(sl)) { continue; }
-        if (!runtime_seed_boot_compatible_60_2(sl)) { continue; }
-        if (!found || static_cast<int32_t>(sl.sequence - best_seq) > 0) {
-            best_seq = sl.sequence;
-            best = &sl;
-            found = true;
-        }
-    }
-    if (!found || best == nullptr) { return false; }
-    *s = *best;
-    return true;
-}
+#if defined(EMS_HOST_TEST)
 
-bool nvm_clear_runtime_seed() noexcept {
-    std::memset(g_seed_slots, 0, sizeof(g_seed_slots));
-    std::memset(g_seed_slot_valid, 0, sizeof(g_seed_slot_valid));
-    return true;
-}
+namespace ems::hal {
 
 void nvm_test_reset() noexcept {
-    std::memset(g_ltft, 0, sizeof(g_ltft));
-    std::memset(g_knock, 0, sizeof(g_knock));
-    std::memset(g_cal, 0, sizeof(g_cal));
+    // Páginas nunca gravadas lêem-se como zeros (contrato do mock anterior);
+    // o journal vê o anel por formatar e o setor legado sem LTF3.
+    flash_host_model_reset(0x00u);
+    flash_jobs_attach(flash_host_model_io());
+    flash_jobs_test_reset();
+    cal_store_configure(kHostCalSector0, kHostCalSectorB0);
+    cal_store_bind_tables();
+    cal_store_test_reset();
+    std::memset(g_cal_burns, 0, sizeof(g_cal_burns));
+    g_cal_group = HostCalGroup{};
     g_erase_cnt = g_prog_cnt = 0u;
     g_flash_busy = false;
     g_flash_busy_polls = 0u;
-    std::memset(g_seed_slots, 0, sizeof(g_seed_slots));
-    std::memset(g_seed_slot_valid, 0, sizeof(g_seed_slot_valid));
-    std::memset(&g_etbcal_mock, 0, sizeof(g_etbcal_mock));
-    g_etbcal_mock_valid = false;
+
+    std::memset(g_ltft_ram, 0, sizeof(g_ltft_ram));
+    std::memset(g_knock_ram, 0, sizeof(g_knock_ram));
+    std::memset(g_ltft_add_ram, 0, sizeof(g_ltft_add_ram));
+    std::memset(&g_seed_ram, 0, sizeof(g_seed_ram));
+    std::memset(&g_etbcal_ram, 0, sizeof(g_etbcal_ram));
+    std::memset(g_dtc_ram, 0, sizeof(g_dtc_ram));
+    std::memset(g_adaptive_image, 0, sizeof(g_adaptive_image));
+    clear_adaptive_dirty();
+    g_nvm_now_ms             = 0u;
+    g_last_adaptive_flush_ms = 0u;
+    g_adaptive_flush_asap    = false;
+    g_journal_flush_active   = false;
+    g_legacy_migrated        = false;
+    g_legacy_revoke          = false;
+    g_journal_op_issued = false;
+    static_cast<void>(nvm_journal_attach(&kPrimedJournalIo,
+                                         static_cast<uint16_t>(kNvmAdaptiveImageBytes)));
 }
 void flash_test_set_busy_polls(uint32_t polls) noexcept {
     g_flash_busy_polls = polls;
@@ -808,20 +933,21 @@ void flash_test_set_busy_polls(uint32_t polls) noexcept {
 }
 uint32_t nvm_test_erase_count() noexcept { return g_erase_cnt; }
 uint32_t nvm_test_program_count() noexcept { return g_prog_cnt; }
+const NvmJournalIo* nvm_test_journal_io() noexcept { return &kHostJournalIo; }
 
+// Um único slot: o seed vive no shadow da imagem adaptativa, como no target.
 bool nvm_test_runtime_seed_inject_slot(uint8_t slot,
                                        const RuntimeSyncSeed* seed,
                                        bool recompute_crc) noexcept {
-    if (seed == nullptr || slot >= kTestSeedSlots) { return false; }
+    if (seed == nullptr || slot >= nvm_test_runtime_seed_slot_count()) { return false; }
     RuntimeSyncSeed w = *seed;
     if (recompute_crc) { w.crc32 = runtime_seed_crc32(w); }
-    g_seed_slots[slot] = w;
-    g_seed_slot_valid[slot] = true;
+    g_seed_ram = w;
     return true;
 }
 
 uint8_t nvm_test_runtime_seed_slot_count() noexcept {
-    return kTestSeedSlots;
+    return 1u;
 }
 
 } // namespace ems::hal
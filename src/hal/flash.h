@@ -2,6 +2,9 @@
 
 #include <cstdint>
 
+#include "hal/cal_store.h"
+#include "hal/nvm_journal.h"
+
 namespace ems::hal {
 
 // ── Dimensões NVM dos mapas adaptativos ──────────────────────────────────────
@@ -30,6 +33,17 @@ constexpr uint32_t kNvmOffMapsCrc     = kNvmOffLayoutMagic + 4u;
 constexpr uint32_t kNvmSeedOffset     = kNvmOffLayoutMagic + 16u;
 // EtbCalRecord @ seed+16 (16 B, quad-word alinhado)
 constexpr uint32_t kNvmEtbCalOffset   = kNvmSeedOffset + 16u;
+// Memória de DTCs @ EtbCal+16: blob opaco do engine/diagnostic_manager
+// (magic/CRC próprios, validados no engine). Imagens anteriores sem esta
+// cauda montam como prefixo (journal) → blob a zeros = memória vazia.
+constexpr uint32_t kNvmDtcStoreOffset = kNvmEtbCalOffset + 16u;
+constexpr uint32_t kNvmDtcStoreBytes  = 384u;
+// Imagem persistida pelo journal (hal/nvm_journal.h): [0 .. DTC store].
+constexpr uint32_t kNvmAdaptiveImageBytes = kNvmDtcStoreOffset + kNvmDtcStoreBytes;
+// nvm_journal_attach recusa imagens maiores: crescer o layout além do limite
+// do journal tem de falhar aqui, não no boot.
+static_assert(kNvmAdaptiveImageBytes <= kNvmJournalImageMax,
+              "imagem adaptativa excede kNvmJournalImageMax");
 
 // ── Última calibração ETB bem-sucedida (auto-cal de power-on) ────────────────
 // Persistida no setor adaptativo para servir de fallback quando uma partida
@@ -50,9 +64,15 @@ constexpr uint8_t  ETB_CAL_RECORD_VERSION = 1u;
 
 // Guarda no shadow RAM + agenda flush (asap) do setor adaptativo.
 bool nvm_save_etb_cal(const EtbCalRecord* rec) noexcept;
-// Lê shadow (se válido) ou flash; false se ausente/CRC inválido.
+// Lê o shadow (montado do journal no boot); false se ausente/CRC inválido.
 bool nvm_load_etb_cal(EtbCalRecord* out) noexcept;
 
+// Memória de DTCs: copia len (≤ kNvmDtcStoreBytes) bytes para o shadow e
+// marca dirty — sem asap: segue o rate-limit do flush adaptativo.
+bool nvm_save_dtc_store(const uint8_t* data, uint16_t len) noexcept;
+// Lê o shadow (montado do journal no boot; zeros se nunca gravado).
+bool nvm_load_dtc_store(uint8_t* out, uint16_t len) noexcept;
+
 // Valida layout: magic LTF3 + CRC dos mapas. Pura (testável em host).
 bool nvm_adaptive_sector_valid(const uint8_t* sector) noexcept;
 // CRC-32 do payload adaptativo [0 .. kNvmOffLayoutMagic).
@@ -67,8 +87,9 @@ bool nvm_write_ltft_add(uint8_t rpm_i, uint8_t load_i, int8_t val_50us) noexcept
 int8_t nvm_read_ltft_add(uint8_t rpm_i, uint8_t load_i) noexcept;
 
 bool nvm_load_adaptive_maps() noexcept;
-// Flush state machine do sector adaptativo. Rate-limit: no máximo 1 commit
-// completo por kMinAdaptiveFlushIntervalMs salvo force (Z / request_now).
+// Flush incremental da imagem adaptativa para o journal (só células
+// alteradas). Rate-limit: no máximo 1 flush por kMinAdaptiveFlushIntervalMs
+// salvo force (Z / request_now).
 // Retorna true quando idle e sem trabalho pendente (ou defer por rate-limit).
 bool nvm_flush_adaptive_maps() noexcept;
 // Relógio do main (ms) para rate-limit; chamar a cada loop ou antes do flush.
@@ -77,23 +98,51 @@ void nvm_set_now_ms(uint32_t now_ms) noexcept;
 void nvm_request_adaptive_flush_now() noexcept;
 // true se LTFT/knock/add shadows têm alterações por gravar.
 bool nvm_adaptive_maps_dirty() noexcept;
-// Intervalo mínimo entre flushes completos em run (ms).
-constexpr uint32_t kMinAdaptiveFlushIntervalMs = 60000u;
+// Intervalo mínimo entre flushes em run (ms). Com o journal um flush típico
+// são poucos quad-words e o erase só ocorre a cada ~500 registos por setor.
+constexpr uint32_t kMinAdaptiveFlushIntervalMs = 10000u;
 
-// knock_map[8×8]: retraso de ignição por cilindro (unidade: 0.1°, range –12.7°..+12.7°)
+// knock_map[8×8]: retardo aprendido RPM × carga (engine/knock_learn; 0.1°/count, –12.7°..+12.7°)
 // Mapeado em SRAM (EEPROM emulada) logo após o LTFT, offset 256 bytes.
 bool nvm_write_knock(uint8_t rpm_i, uint8_t load_i, int8_t retard_deci_deg) noexcept;
 int8_t nvm_read_knock(uint8_t rpm_i, uint8_t load_i) noexcept;
 void nvm_reset_knock_map() noexcept;  // zera todo o mapa (e.g. ao ligar)
 
+// Burn bloqueante (boot / ferramentas): enfileira + drena a fila de flash.
 bool nvm_save_calibration(uint8_t page, const uint8_t* data, uint16_t len) noexcept;
 bool nvm_load_calibration(uint8_t page, uint8_t* data, uint16_t len) noexcept;
+// Burn em background (hal/flash_jobs.h): os dados são copiados no submit e
+// gravados na cópia inactiva da página (A/B, hal/cal_store.h).
+// true = enfileirado; o resultado chega em done(ctx, ok) dentro de
+// nvm_jobs_process(). false = fila cheia / página inválida / flash ocupada /
+// burn da mesma página ainda em curso.
+bool nvm_queue_calibration(uint8_t page, const uint8_t* data, uint16_t len,
+                           void (*done)(void* ctx, bool ok), void* ctx) noexcept;
+// Slot dos eixos de tabela: as cópias dos slots 1-3 (VE, spark, lambda)
+// ficam ligadas à cópia dos eixos com que foram gravadas (âncora de
+// hal/cal_store.h) — eixos e tabelas só mudam juntos em flash.
+constexpr uint8_t kNvmCalSlotAxes = 9u;
+// Burn de grupo (hal/cal_store.h): slots ligados primeiro, kNvmCalSlotAxes
+// por último; um só done(ctx, ok) e o trailer dos eixos como commit único.
+// false = fila sem slots para o grupo inteiro / página ocupada.
+bool nvm_queue_calibration_group(const CalGroupMember* members, uint8_t n,
+                                 void (*done)(void* ctx, bool ok), void* ctx) noexcept;
+// Rollback para o burn anterior (hal/cal_store.h): revoga a cópia activa
+// da página; a outra cópia volta a ser lida no load/boot seguinte. Nos eixos
+// (kNvmCalSlotAxes) as tabelas ligadas voltam com eles.
+// false = sem cópia anterior válida / fila cheia / job da página em curso.
+bool nvm_queue_rollback(uint8_t page, void (*done)(void* ctx, bool ok), void* ctx) noexcept;
+// Slot do main (2 ms): avança burns + flush do journal por ≤ budget_us.
+// true = ainda há jobs de flash pendentes.
+bool nvm_jobs_process(uint32_t budget_us) noexcept;
 
 #if defined(EMS_HOST_TEST)
 void nvm_test_reset() noexcept;
 void flash_test_set_busy_polls(uint32_t polls) noexcept;
 uint32_t nvm_test_erase_count() noexcept;
 uint32_t nvm_test_program_count() noexcept;
+// Backend do journal adaptativo no host (setores 11-14 do modelo de flash).
+const NvmJournalIo* nvm_test_journal_io() noexcept;
 #endif
 
 }  // namespace ems::hal
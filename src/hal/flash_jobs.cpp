@@ -0,0 +1,380 @@
+/**
+ * @file hal/flash_jobs.cpp
+ * @brief Fila de jobs de flash executada em fatias de tempo (ver flash_jobs.h).
+ */
+
+#include "hal/flash_jobs.h"
+
+#include <cstring>
+
+namespace {
+
+using ems::hal::FlashJobDone;
+using ems::hal::FlashJobIo;
+using ems::hal::FlashOpPoll;
+using ems::hal::FlashTaskFn;
+using ems::hal::FlashTaskStatus;
+using ems::hal::kFlashJobMaxBytes;
+using ems::hal::kFlashJobQueueDepth;
+
+constexpr uint32_t kQuadWord = 16u;
+
+enum class JobKind : uint8_t { Burn, Task };
+
+enum class BurnState : uint8_t {
+    Start,      // espera controlador livre e inicia o erase (se pedido)
+    Erasing,    // erase em curso (cede o slot enquanto BSY)
+    Program,    // um quad-word por iteração
+};
+
+struct Job {
+    JobKind      kind;
+    BurnState    burn_state;
+    uint16_t     sector;
+    uint16_t     len;
+    bool         erase;     // false = só program (região já apagada)
+    bool         chain;     // o job seguinte pertence ao mesmo grupo
+    uint32_t     base;      // offset do staging[0] no setor
+    uint32_t     offset;
+    FlashTaskFn  fn;
+    FlashJobDone done;
+    void*        ctx;
+    alignas(4) uint8_t staging[kFlashJobMaxBytes];
+};
+
+const FlashJobIo* g_io = nullptr;
+Job      g_jobs[kFlashJobQueueDepth] = {};
+uint8_t  g_head  = 0u;
+uint8_t  g_count = 0u;
+uint32_t g_completed   = 0u;
+uint32_t g_failed      = 0u;
+uint32_t g_max_step_us = 0u;
+uint8_t  g_group_left  = 0u;   // submits que ainda pertencem ao grupo aberto
+bool     g_primed      = false;  // 1ª operação pós-reset concluída (ES0565)
+bool     g_op_issued   = false;  // erase/program iniciado via g_io, por fechar
+
+Job* push_slot() noexcept {
+    if (g_io == nullptr || g_count >= kFlashJobQueueDepth) { return nullptr; }
+    Job* j = &g_jobs[(g_head + g_count) % kFlashJobQueueDepth];
+    j->burn_state = BurnState::Start;
+    j->offset = 0u;
+    j->base = 0u;
+    j->erase = true;
+    j->chain = false;
+    j->fn = nullptr;
+    if (g_group_left != 0u) {
+        --g_group_left;
+        j->chain = (g_group_left != 0u);
+    }
+    return j;
+}
+
+struct Retired {
+    FlashJobDone done;
+    void*        ctx;
+    bool         chain;
+};
+
+Retired retire(bool ok) noexcept {
+    const Job& j = g_jobs[g_head];
+    const Retired r = {j.done, j.ctx, j.chain};
+    g_head = static_cast<uint8_t>((g_head + 1u) % kFlashJobQueueDepth);
+    --g_count;
+    if (ok) { ++g_completed; } else { ++g_failed; }
+    return r;
+}
+
+void finish(bool ok) noexcept {
+    g_io->idle();
+    // Retira antes dos callbacks: done() pode submeter o job seguinte. Uma
+    // falha dentro de um grupo retira também o resto da cadeia.
+    Retired r[kFlashJobQueueDepth];
+    uint8_t n = 0u;
+    r[n++] = retire(ok);
+    while (!ok && r[n - 1u].chain && g_count != 0u) { r[n++] = retire(false); }
+    for (uint8_t i = 0u; i < n; ++i) {
+        if (r[i].done != nullptr) { r[i].done(r[i].ctx, i == 0u && ok); }
+    }
+}
+
+// Poll de g_io que arma g_primed: só um erase/program realmente iniciado e
+// concluído Ready conta (jobs sem operação — quad-words 0xFF — não).
+FlashOpPoll poll_io() noexcept {
+    const FlashOpPoll p = g_io->poll();
+    if (p != FlashOpPoll::Busy && g_op_issued) {
+        g_op_issued = false;
+        if (p == FlashOpPoll::Ready) { g_primed = true; }
+    }
+    return p;
+}
+
+// Uma iteração do job da frente. false = ceder o slot (hardware ocupado
+// com uma operação longa).
+bool run_burn(Job& j) noexcept {
+    switch (j.burn_state) {
+    case BurnState::Start:
+        if (poll_io() == FlashOpPoll::Busy) { return false; }
+        if (!j.erase) { j.burn_state = BurnState::Program; return true; }
+        if (!g_io->erase(j.sector)) { finish(false); return true; }
+        g_op_issued = true;
+        j.burn_state = BurnState::Erasing;
+        return false;  // erase leva ms: nada a fazer neste slot
+    case BurnState::Erasing: {
+        const FlashOpPoll p = poll_io();
+        if (p == FlashOpPoll::Busy) { return false; }
+        if (p == FlashOpPoll::Error) { finish(false); return true; }
+        g_io->idle();
+        j.burn_state = BurnState::Program;
+        return true;
+    }
+    case BurnState::Program: {
+        // Program de 1 quad-word é curto: espera activa dentro do orçamento.
+        const FlashOpPoll p = poll_io();
+        if (p == FlashOpPoll::Busy) { return true; }
+        if (p == FlashOpPoll::Error) { finish(false); return true; }
+        if (j.offset >= j.len) {
+            g_io->idle();
+            const uint8_t* base = g_io->sector(j.sector);
+            finish(base != nullptr &&
+                   std::memcmp(base + j.base, j.staging, j.len) == 0);
+            return true;
+        }
+        // Cauda < 16 B preenchida com 0xFF (estado apagado).
+        alignas(4) uint8_t qw[kQuadWord];
+        const uint32_t n = (j.len - j.offset < kQuadWord) ? (j.len - j.offset) : kQuadWord;
+        std::memset(qw, 0xFF, sizeof(qw));
+        std::memcpy(qw, j.staging + j.offset, n);
+        const uint32_t off = j.offset;
+        j.offset += kQuadWord;
+        // Quad-word todo 0xFF já é o estado apagado: não gasta um program
+        // (padding entre os dados e o trailer de hal/cal_store).
+        bool erased = true;
+        for (uint32_t i = 0u; i < kQuadWord; ++i) {
+            if (qw[i] != 0xFFu) { erased = false; break; }
+        }
+        if (erased) { return true; }
+        if (!g_io->program(j.sector, j.base + off, qw)) { finish(false); return true; }
+        g_op_issued = true;
+        return true;
+    }
+    }
+    return false;
+}
+
+bool run_task(Job& j) noexcept {
+    const FlashTaskStatus st = j.fn(j.ctx);
+    if (st == FlashTaskStatus::Done)  { finish(true);  return true; }
+    if (st == FlashTaskStatus::Error) { finish(false); return true; }
+    // Task à espera de um erase: ceder o slot em vez de girar no poll.
+    return g_io->poll() != FlashOpPoll::Busy;
+}
+
+}  // namespace
+
+namespace ems::hal {
+
+void flash_jobs_attach(const FlashJobIo* io) noexcept {
+    g_io = io;
+    g_op_issued = false;
+    g_head = 0u;
+    g_count = 0u;
+    g_group_left = 0u;
+}
+
+const FlashJobIo* flash_jobs_io() noexcept { return g_io; }
+
+bool flash_jobs_submit_burn(uint16_t sector, const uint8_t* data, uint16_t len,
+                            FlashJobDone done, void* ctx) noexcept {
+    if (data == nullptr || len == 0u || len > kFlashJobMaxBytes) { return false; }
+    Job* j = push_slot();
+    if (j == nullptr) { return false; }
+    j->kind = JobKind::Burn;
+    j->sector = sector;
+    j->len = len;
+    j->done = done;
+    j->ctx = ctx;
+    std::memcpy(j->staging, data, len);
+    ++g_count;
+    return true;
+}
+
+bool flash_jobs_submit_program(uint16_t sector, uint32_t offset, const uint8_t* data,
+                               uint16_t len, FlashJobDone done, void* ctx) noexcept {
+    if (data == nullptr || len == 0u || len > kFlashJobMaxBytes ||
+        (offset % kQuadWord) != 0u) {
+        return false;
+    }
+    Job* j = push_slot();
+    if (j == nullptr) { return false; }
+    j->kind = JobKind::Burn;
+    j->erase = false;
+    j->base = offset;
+    j->sector = sector;
+    j->len = len;
+    j->done = done;
+    j->ctx = ctx;
+    std::memcpy(j->staging, data, len);
+    ++g_count;
+    return true;
+}
+
+bool flash_jobs_submit_task(FlashTaskFn fn, void* ctx, FlashJobDone done) noexcept {
+    if (fn == nullptr) { return false; }
+    Job* j = push_slot();
+    if (j == nullptr) { return false; }
+    j->kind = JobKind::Task;
+    j->fn = fn;
+    j->ctx = ctx;
+    j->done = done;
+    j->sector = 0u;
+    j->len = 0u;
+    ++g_count;
+    return true;
+}
+
+bool flash_jobs_begin_group(uint8_t n) noexcept {
+    if (g_io == nullptr || n == 0u || n > kFlashJobQueueDepth - g_count) { return false; }
+    g_group_left = n;
+    return true;
+}
+
+bool flash_jobs_step(uint32_t budget_us) noexcept {
+    if (g_io == nullptr || g_count == 0u) { return false; }
+    const uint32_t t0 = g_io->now_us();
+    uint32_t dt = 0u;
+    while (g_count != 0u) {
+        Job& j = g_jobs[g_head];
+        const bool more = (j.kind == JobKind::Burn) ? run_burn(j) : run_task(j);
+        dt = g_io->now_us() - t0;
+        if (!more || dt >= budget_us) { break; }
+    }
+    if (dt > g_max_step_us) { g_max_step_us = dt; }
+    return g_count != 0u;
+}
+
+bool flash_jobs_drain(uint32_t timeout_us) noexcept {
+    if (g_io == nullptr) { return g_count == 0u; }
+    const uint32_t t0 = g_io->now_us();
+    while (g_count != 0u) {
+        static_cast<void>(flash_jobs_step(kFlashJobSliceUs));
+        if (g_io->now_us() - t0 >= timeout_us) { break; }
+    }
+    return g_count == 0u;
+}
+
+bool flash_jobs_busy() noexcept { return g_count != 0u; }
+uint8_t flash_jobs_pending() noexcept { return g_count; }
+bool flash_jobs_primed() noexcept { return g_primed; }
+void flash_jobs_mark_primed() noexcept { g_primed = true; }
+uint32_t flash_jobs_completed() noexcept { return g_completed; }
+uint32_t flash_jobs_failed() noexcept { return g_failed; }
+uint32_t flash_jobs_max_step_us() noexcept { return g_max_step_us; }
+
+}  // namespace ems::hal
+
+#if defined(EMS_HOST_TEST)
+
+namespace {
+
+constexpr uint32_t kModelSectorBytes = 8192u;
+
+uint8_t  g_model_mem[ems::hal::kFlashHostModelSectors][kModelSectorBytes];
+uint32_t g_model_now_us      = 0u;
+uint32_t g_model_busy_until  = 0u;
+uint32_t g_model_erase_us    = 0u;
+uint32_t g_model_program_us  = 0u;
+bool     g_model_error       = false;
+bool     g_model_fail_next   = false;
+uint32_t g_model_erases      = 0u;
+uint32_t g_model_programs    = 0u;
+
+const uint8_t* model_sector(uint16_t s) {
+    return (s < ems::hal::kFlashHostModelSectors) ? g_model_mem[s] : nullptr;
+}
+
+bool model_erase(uint16_t s) {
+    if (s >= ems::hal::kFlashHostModelSectors) { return false; }
+    if (g_model_fail_next) { g_model_fail_next = false; g_model_error = true; return true; }
+    std::memset(g_model_mem[s], 0xFF, kModelSectorBytes);
+    g_model_busy_until = g_model_now_us + g_model_erase_us;
+    ++g_model_erases;
+    return true;
+}
+
+bool model_program(uint16_t s, uint32_t off, const uint8_t* qw) {
+    if (s >= ems::hal::kFlashHostModelSectors || off + 16u > kModelSectorBytes ||
+        (off % 16u) != 0u) {
+        return false;
+    }
+    if (g_model_fail_next) { g_model_fail_next = false; g_model_error = true; return true; }
+    for (uint32_t i = 0u; i < 16u; ++i) {
+        if (g_model_mem[s][off + i] != 0xFFu) { g_model_error = true; return true; }  // PGSERR
+    }
+    std::memcpy(&g_model_mem[s][off], qw, 16u);
+    g_model_busy_until = g_model_now_us + g_model_program_us;
+    ++g_model_programs;
+    return true;
+}
+
+FlashOpPoll model_poll() {
+    ++g_model_now_us;
+    if (static_cast<int32_t>(g_model_busy_until - g_model_now_us) > 0) {
+        return FlashOpPoll::Busy;
+    }
+    return g_model_error ? FlashOpPoll::Error : FlashOpPoll::Ready;
+}
+
+void model_idle() { g_model_error = false; }
+
+uint32_t model_now_us() { return g_model_now_us; }
+
+const FlashJobIo kModelIo = {
+    model_sector, model_erase, model_program, model_poll, model_idle, model_now_us,
+};
+
+}  // namespace
+
+namespace ems::hal {
+
+const FlashJobIo* flash_host_model_io() noexcept { return &kModelIo; }
+
+void flash_host_model_reset(uint8_t fill) noexcept {
+    std::memset(g_model_mem, fill, sizeof(g_model_mem));
+    g_model_busy_until = g_model_now_us;
+    g_model_erase_us   = 0u;
+    g_model_program_us = 0u;
+    g_model_error      = false;
+    g_model_fail_next  = false;
+    g_model_erases     = 0u;
+    g_model_programs   = 0u;
+}
+
+void flash_host_model_set_latency(uint32_t erase_us, uint32_t program_us) noexcept {
+    g_model_erase_us = erase_us;
+    g_model_program_us = program_us;
+}
+
+void flash_host_model_advance_us(uint32_t dt_us) noexcept { g_model_now_us += dt_us; }
+void flash_host_model_fail_next_op() noexcept { g_model_fail_next = true; }
+
+uint8_t* flash_host_model_sector(uint16_t sector) noexcept {
+    return (sector < kFlashHostModelSectors) ? g_model_mem[sector] : nullptr;
+}
+
+uint32_t flash_host_model_erase_count() noexcept { return g_model_erases; }
+uint32_t flash_host_model_program_count() noexcept { return g_model_programs; }
+
+void flash_jobs_test_reset() noexcept {
+    g_head = 0u;
+    g_count = 0u;
+    g_group_left = 0u;
+    g_primed = false;
+    g_op_issued = false;
+    g_completed = 0u;
+    g_failed = 0u;
+    g_max_step_us = 0u;
+}
+
+}  // namespace ems::hal
+
+#endif  // EMS_HOST_TEST
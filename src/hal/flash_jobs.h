@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ems::hal {
+
+// ── Fila de jobs de flash (execução fatiada) ─────────────────────────────────
+// Dono único do controlador de flash Bank2 em run: burns de calibração e o
+// flush do journal adaptativo entram como jobs e avançam em passos de, no
+// máximo, budget_us por chamada de flash_jobs_step() (slot de 2 ms do main).
+// Nenhum passo espera por um erase (~ms): o erase é iniciado e o job cede o
+// slot até o BSY limpar; cada quad-word programado é iniciado e verificado
+// na iteração seguinte.
+//
+//   Burn:    [erase setor] → [program quad-words] → [verify] → done(ctx, ok)
+//   Program: [program quad-words a partir de offset] → [verify] (sem erase)
+//   Task: fn(ctx) chamada repetidamente até Done/Error → done(ctx, ok)
+//
+// Grupo: flash_jobs_begin_group(n) reserva n slots e os n submits seguintes
+// formam uma cadeia — correm em ordem e a primeira falha termina os
+// restantes com done(ctx, false) sem tocarem na flash.
+//
+// Quad-words todos 0xFF não são programados (já é o estado apagado).
+// Os dados de um Burn são copiados no submit (staging por slot da fila):
+// o chamador pode editar o buffer logo a seguir sem rasgar a página gravada.
+// Callbacks correm no contexto de flash_jobs_step() (main loop, nunca ISR).
+//
+// Módulo puro: acesso ao hardware via FlashJobIo (registos FLASH no target,
+// modelo com latência configurável nos host tests).
+
+constexpr uint8_t  kFlashJobQueueDepth = 4u;
+constexpr uint16_t kFlashJobMaxBytes   = 1040u;   // página de calibração + trailer
+constexpr uint32_t kFlashJobSliceUs    = 250u;    // orçamento por slot de 2 ms
+
+enum class FlashOpPoll : uint8_t { Ready, Busy, Error };
+
+struct FlashJobIo {
+    // Base mapeada em memória do setor (verify).
+    const uint8_t* (*sector)(uint16_t sector);
+    // Inicia o erase do setor; não espera.
+    bool (*erase)(uint16_t sector);
+    // Inicia a programação de 1 quad-word (16 B, offset múltiplo de 16).
+    bool (*program)(uint16_t sector, uint32_t offset, const uint8_t* qw);
+    FlashOpPoll (*poll)();
+    // Operação concluída/abortada: limpa bits de operação e re-trava.
+    void (*idle)();
+    uint32_t (*now_us)();
+};
+
+enum class FlashTaskStatus : uint8_t {
+    Busy,    // mais trabalho — chamar de novo
+    Done,
+    Error,
+};
+
+using FlashJobDone = void (*)(void* ctx, bool ok);
+using FlashTaskFn  = FlashTaskStatus (*)(void* ctx);
+
+// Liga a fila a um backend. Descarta jobs pendentes (sem callback).
+void flash_jobs_attach(const FlashJobIo* io) noexcept;
+const FlashJobIo* flash_jobs_io() noexcept;
+
+// false = fila cheia / argumentos inválidos (nada foi enfileirado).
+bool flash_jobs_submit_burn(uint16_t sector, const uint8_t* data, uint16_t len,
+                            FlashJobDone done, void* ctx) noexcept;
+// Programa uma região já apagada (offset múltiplo de 16) sem erase do setor.
+bool flash_jobs_submit_program(uint16_t sector, uint32_t offset, const uint8_t* data,
+                               uint16_t len, FlashJobDone done, void* ctx) noexcept;
+bool flash_jobs_submit_task(FlashTaskFn fn, void* ctx, FlashJobDone done) noexcept;
+// Abre um grupo de n jobs. false = menos de n slots livres (nada reservado);
+// o chamador submete logo a seguir os n jobs, já validados.
+bool flash_jobs_begin_group(uint8_t n) noexcept;
+
+// Avança a fila durante no máximo ~budget_us. Retorna true se ainda há jobs.
+bool flash_jobs_step(uint32_t budget_us) noexcept;
+// Bloqueante (boot / shutdown): corre passos até a fila esvaziar ou timeout.
+bool flash_jobs_drain(uint32_t timeout_us) noexcept;
+
+bool    flash_jobs_busy() noexcept;
+uint8_t flash_jobs_pending() noexcept;
+// true depois do primeiro erase/program concluído Ready desde o reset (jobs
+// que terminam sem tocar na flash não contam). Errata ES0565: só a primeira
+// operação erase/program após o reset pode congelar o fetch (~120 µs); daí em
+// diante a flash pode ser escrita com o motor a rodar.
+bool    flash_jobs_primed() noexcept;
+// Backends que operam a flash fora de FlashJobIo (journal adaptativo dentro
+// de um task job): chamar quando um erase/program seu conclui Ready.
+void    flash_jobs_mark_primed() noexcept;
+
+// Diagnóstico
+uint32_t flash_jobs_completed() noexcept;
+uint32_t flash_jobs_failed() noexcept;
+uint32_t flash_jobs_max_step_us() noexcept;   // maior passo medido
+
+#if defined(EMS_HOST_TEST)
+// ── Modelo host da flash Bank2 ──────────────────────────────────────────────
+// kFlashHostModelSectors setores de 8 KB em RAM, relógio virtual em µs.
+// erase/program aplicam o efeito de imediato mas mantêm Busy durante a
+// latência configurada; cada poll avança o relógio 1 µs (custo do loop).
+// Programar um quad-word não apagado falha (PGSERR) como no H5.
+constexpr uint16_t kFlashHostModelSectors = 32u;
+
+const FlashJobIo* flash_host_model_io() noexcept;
+void     flash_host_model_reset(uint8_t fill) noexcept;
+void     flash_host_model_set_latency(uint32_t erase_us, uint32_t program_us) noexcept;
+void     flash_host_model_advance_us(uint32_t dt_us) noexcept;
+void     flash_host_model_fail_next_op() noexcept;
+uint8_t* flash_host_model_sector(uint16_t sector) noexcept;
+uint32_t flash_host_model_erase_count() noexcept;
+uint32_t flash_host_model_program_count() noexcept;
+void     flash_jobs_test_reset() noexcept;
+#endif
+
+}  // namespace ems::hal
@@ -0,0 +1,325 @@
+/**
+ * @file hal/nvm_journal.cpp
+ * @brief Journal append-only com wear levelling para os mapas adaptativos.
+ *
+ * Formato e algoritmo descritos em nvm_journal.h. Sem acesso directo a
+ * registos: o backend (flash Bank2 no target, RAM simulada nos host tests)
+ * chega por NvmJournalIo — a lógica de replay/compactação é a mesma nos dois.
+ */
+
+#include "hal/nvm_journal.h"
+#include "hal/crc32.h"
+
+#include <cstring>
+
+namespace {
+
+using ems::hal::kNvmJournalImageMax;
+using ems::hal::kNvmJournalRecordBytes;
+using ems::hal::kNvmJournalRunBytes;
+using ems::hal::kNvmJournalSectorBytes;
+using ems::hal::kNvmJournalSectors;
+using ems::hal::NvmIoPoll;
+using ems::hal::NvmJournalStatus;
+
+constexpr uint8_t  kTypeData   = 0x01u;
+constexpr uint8_t  kTypeCommit = 0x02u;
+constexpr uint8_t  kNoSector   = 0xFFu;
+constexpr uint32_t kSlots      = kNvmJournalSectorBytes / kNvmJournalRecordBytes;
+
+static_assert((kNvmJournalSectorBytes % kNvmJournalRecordBytes) == 0u,
+              "setor deve conter um nº inteiro de quad-words");
+
+enum class State : uint8_t {
+    Delta,      // setor activo aceita deltas
+    Erasing,    // erase do próximo setor em curso
+    Snapshot,   // snapshot da imagem no novo setor
+    Commit,     // falta o registo COMMIT
+};
+
+const ems::hal::NvmJournalIo* g_io = nullptr;
+uint16_t g_image_len   = 0u;
+uint8_t  g_persisted[kNvmJournalImageMax] = {};  // o que o próximo mount reproduz
+uint8_t  g_active      = kNoSector;
+uint32_t g_seq         = 0u;
+uint32_t g_write_off   = 0u;       // próximo slot livre no setor activo
+State    g_state       = State::Delta;
+uint8_t  g_target      = 0u;       // setor em compactação
+uint32_t g_target_off  = 0u;
+uint16_t g_snap_off    = 0u;       // cursor da imagem no snapshot
+bool     g_force_rotate = false;
+bool     g_prog_pending = false;   // quad-word iniciado, conclusão via poll
+uint32_t g_erase_count  = 0u;
+uint32_t g_record_count = 0u;
+
+inline void put_u16(uint8_t* p, uint16_t v) noexcept {
+    p[0] = static_cast<uint8_t>(v & 0xFFu);
+    p[1] = static_cast<uint8_t>(v >> 8u);
+}
+inline void put_u32(uint8_t* p, uint32_t v) noexcept {
+    for (uint8_t i = 0u; i < 4u; ++i) { p[i] = static_cast<uint8_t>(v >> (8u * i)); }
+}
+inline uint16_t get_u16(const uint8_t* p) noexcept {
+    return static_cast<uint16_t>(p[0] | (static_cast<uint16_t>(p[1]) << 8u));
+}
+inline uint32_t get_u32(const uint8_t* p) noexcept {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8u) |
+           (static_cast<uint32_t>(p[2]) << 16u) | (static_cast<uint32_t>(p[3]) << 24u);
+}
+
+inline bool slot_erased(const uint8_t* q) noexcept {
+    for (uint8_t i = 0u; i < kNvmJournalRecordBytes; ++i) {
+        if (q[i] != 0xFFu) { return false; }
+    }
+    return true;
+}
+
+inline bool slot_crc_ok(const uint8_t* q) noexcept {
+    return get_u32(q + 12u) == ems::hal::crc32_calc(q, 12u);
+}
+
+void make_header(uint8_t* q, uint32_t seq) noexcept {
+    std::memset(q, 0, kNvmJournalRecordBytes);
+    put_u32(q + 0u, ems::hal::kNvmJournalMagic);
+    put_u32(q + 4u, seq);
+    put_u16(q + 8u, g_image_len);
+    q[10] = ems::hal::kNvmJournalVersion;
+    put_u32(q + 12u, ems::hal::crc32_calc(q, 12u));
+}
+
+void make_record(uint8_t* q, uint8_t type, uint16_t off, const uint8_t* data, uint8_t len) noexcept {
+    std::memset(q, 0xFF, kNvmJournalRecordBytes);
+    put_u16(q + 0u, off);
+    q[2] = len;
+    q[3] = type;
+    if (data != nullptr && len != 0u) { std::memcpy(q + 4u, data, len); }
+    put_u32(q + 12u, ems::hal::crc32_calc(q, 12u));
+}
+
+// Imagem gravada mais curta que a actual (firmware anterior, antes de a
+// imagem crescer por cauda) monta como prefixo: a cauda fica a zeros e os
+// deltas seguintes cabem no setor. Mais longa → layout desconhecido.
+bool header_ok(const uint8_t* q) noexcept {
+    const uint16_t len = get_u16(q + 8u);
+    return get_u32(q + 0u) == ems::hal::kNvmJournalMagic &&
+           len != 0u && len <= g_image_len &&
+           q[10] == ems::hal::kNvmJournalVersion &&
+           slot_crc_ok(q);
+}
+
+bool record_ok(const uint8_t* q) noexcept {
+    if (!slot_crc_ok(q)) { return false; }
+    const uint8_t len = q[2];
+    if (q[3] == kTypeCommit) { return true; }
+    return q[3] == kTypeData && len != 0u && len <= kNvmJournalRunBytes &&
+           static_cast<uint32_t>(get_u16(q)) + len <= g_image_len;
+}
+
+// Percorre o setor: aplica DATA a image (se não nulo), devolve se há COMMIT
+// e o offset do primeiro slot apagado.
+bool scan_sector(const uint8_t* base, uint8_t* image, uint32_t& free_off) noexcept {
+    bool committed = false;
+    free_off = kNvmJournalSectorBytes;
+    for (uint32_t s = 1u; s < kSlots; ++s) {
+        const uint8_t* q = base + s * kNvmJournalRecordBytes;
+        if (slot_erased(q)) { free_off = s * kNvmJournalRecordBytes; break; }
+        if (!record_ok(q)) { continue; }  // escrita rasgada: ignora o slot
+        if (q[3] == kTypeCommit) { committed = true; continue; }
+        if (image != nullptr) { std::memcpy(image + get_u16(q), q + 4u, q[2]); }
+    }
+    return committed;
+}
+
+bool program_slot(uint8_t sector, uint32_t off, const uint8_t* q) noexcept {
+    ++g_record_count;
+    if (!g_io->program(sector, off, q)) { return false; }
+    g_prog_pending = true;
+    return true;
+}
+
+NvmJournalStatus fail() noexcept {
+    // Estado em RAM já não corresponde a nenhum setor consistente: a próxima
+    // chamada compacta num setor novo (snapshot completo).
+    g_state = State::Delta;
+    g_force_rotate = true;
+    return NvmJournalStatus::Error;
+}
+
+// Primeiro run de diferenças a partir de 0: devolve false se nada difere.
+bool next_run(const uint8_t* image, uint16_t& off, uint8_t& len) noexcept {
+    for (uint16_t i = 0u; i < g_image_len; ++i) {
+        if (image[i] == g_persisted[i]) { continue; }
+        uint16_t end = static_cast<uint16_t>(i + kNvmJournalRunBytes);
+        if (end > g_image_len) { end = g_image_len; }
+        // Encurta o run até ao último byte alterado (menos escrita redundante).
+        while (end > i + 1u && image[end - 1u] == g_persisted[end - 1u]) { --end; }
+        off = i;
+        len = static_cast<uint8_t>(end - i);
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+namespace ems::hal {
+
+bool nvm_journal_attach(const NvmJournalIo* io, uint16_t image_len) noexcept {
+    // Sem clamp: truncar a imagem perderia a cauda em silêncio a cada flush.
+    // Tamanho inválido desliga o journal (mount/flush passam a falhar).
+    const bool ok = io != nullptr && image_len != 0u && image_len <= kNvmJournalImageMax;
+    g_io = ok ? io : nullptr;
+    g_image_len = ok ? image_len : 0u;
+    std::memset(g_persisted, 0, sizeof(g_persisted));
+    g_active = kNoSector;
+    g_seq = 0u;
+    g_write_off = 0u;
+    g_state = State::Delta;
+    g_target = 0u;
+    g_target_off = 0u;
+    g_snap_off = 0u;
+    g_force_rotate = false;
+    g_prog_pending = false;
+    g_erase_count = 0u;
+    g_record_count = 0u;
+    return ok;
+}
+
+bool nvm_journal_mount(uint8_t* image_out) noexcept {
+    if (g_io == nullptr || image_out == nullptr) { return false; }
+    std::memset(image_out, 0, g_image_len);
+    std::memset(g_persisted, 0, sizeof(g_persisted));
+    g_active = kNoSector;
+    g_state = State::Delta;
+    g_force_rotate = false;
+
+    uint32_t best_seq = 0u;
+    uint32_t best_free = 0u;
+    for (uint8_t idx = 0u; idx < kNvmJournalSectors; ++idx) {
+        const uint8_t* base = g_io->sector(idx);
+        if (base == nullptr || !header_ok(base)) { continue; }
+        uint32_t free_off = 0u;
+        if (!scan_sector(base, nullptr, free_off)) { continue; }  // compactação interrompida
+        const uint32_t seq = get_u32(base + 4u);
+        if (g_active == kNoSector || static_cast<int32_t>(seq - best_seq) > 0) {
+            g_active = idx;
+            best_seq = seq;
+            best_free = free_off;
+        }
+    }
+    if (g_active == kNoSector) { return false; }
+
+    uint32_t free_off = 0u;
+    static_cast<void>(scan_sector(g_io->sector(g_active), g_persisted, free_off));
+    std::memcpy(image_out, g_persisted, g_image_len);
+    g_seq = best_seq;
+    g_write_off = best_free;
+    return true;
+}
+
+NvmJournalStatus nvm_journal_flush_step(const uint8_t* image, uint8_t budget) noexcept {
+    if (g_io == nullptr || image == nullptr) { return NvmJournalStatus::Error; }
+    uint8_t q[kNvmJournalRecordBytes];
+
+    while (budget != 0u) {
+        // O program só é iniciado: o próximo acesso ao controlador espera o
+        // BSY limpar cedendo a chamada (nunca em spin).
+        if (g_prog_pending) {
+            const NvmIoPoll p = g_io->poll();
+            if (p == NvmIoPoll::Busy) { return NvmJournalStatus::Busy; }
+            g_prog_pending = false;
+            if (p == NvmIoPoll::Error) { return fail(); }
+        }
+        switch (g_state) {
+        case State::Delta: {
+            const bool pending = nvm_journal_pending(image);
+            if (!pending && !g_force_rotate) { return NvmJournalStatus::Idle; }
+            const bool full = (g_write_off + kNvmJournalRecordBytes > kNvmJournalSectorBytes);
+            if (g_active == kNoSector || full || g_force_rotate) {
+                g_target = (g_active == kNoSector) ? 0u
+                         : static_cast<uint8_t>((g_active + 1u) % kNvmJournalSectors);
+                if (!g_io->erase(g_target)) { return fail(); }
+                ++g_erase_count;
+                g_state = State::Erasing;
+                --budget;
+                break;
+            }
+            uint16_t off = 0u;
+            uint8_t  len = 0u;
+            static_cast<void>(next_run(image, off, len));
+            make_record(q, kTypeData, off, image + off, len);
+            if (!program_slot(g_active, g_write_off, q)) {
+                g_write_off += kNvmJournalRecordBytes;  // slot perdido: não reprogramar
+                return fail();
+            }
+            std::memcpy(g_persisted + off, image + off, len);
+            g_write_off += kNvmJournalRecordBytes;
+            --budget;
+            break;
+        }
+        case State::Erasing: {
+            const NvmIoPoll p = g_io->poll();
+            if (p == NvmIoPoll::Busy) { return NvmJournalStatus::Busy; }
+            if (p == NvmIoPoll::Error) { return fail(); }
+            make_header(q, g_seq + 1u);
+            if (!program_slot(g_target, 0u, q)) { return fail(); }
+            g_target_off = kNvmJournalRecordBytes;
+            g_snap_off = 0u;
+            g_state = State::Snapshot;
+            --budget;
+            break;
+        }
+        case State::Snapshot: {
+            uint8_t len = kNvmJournalRunBytes;
+            if (g_snap_off + len > g_image_len) {
+                len = static_cast<uint8_t>(g_image_len - g_snap_off);
+            }
+            if (len != 0u) {
+                make_record(q, kTypeData, g_snap_off, image + g_snap_off, len);
+                if (!program_slot(g_target, g_target_off, q)) { return fail(); }
+                // O setor antigo deixa de receber deltas: g_persisted passa a
+                // descrever o novo (erro a meio → fail() força nova compactação).
+                std::memcpy(g_persisted + g_snap_off, image + g_snap_off, len);
+                g_target_off += kNvmJournalRecordBytes;
+                g_snap_off = static_cast<uint16_t>(g_snap_off + len);
+                --budget;
+            }
+            if (g_snap_off >= g_image_len) { g_state = State::Commit; }
+            break;
+        }
+        case State::Commit: {
+            make_record(q, kTypeCommit, 0u, nullptr, 0u);
+            if (!program_slot(g_target, g_target_off, q)) { return fail(); }
+            g_active = g_target;
+            g_seq += 1u;
+            g_write_off = g_target_off + kNvmJournalRecordBytes;
+            g_force_rotate = false;
+            g_state = State::Delta;
+            --budget;
+            break;
+        }
+        }
+    }
+    return (g_state == State::Delta && !g_force_rotate && !g_prog_pending &&
+            !nvm_journal_pending(image))
+        ? NvmJournalStatus::Idle
+        : NvmJournalStatus::Busy;
+}
+
+bool nvm_journal_pending(const uint8_t* image) noexcept {
+    if (image == nullptr) { return false; }
+    return std::memcmp(image, g_persisted, g_image_len) != 0;
+}
+
+uint8_t nvm_journal_active_sector() noexcept { return g_active; }
+uint32_t nvm_journal_sequence() noexcept { return g_seq; }
+
+uint16_t nvm_journal_free_records() noexcept {
+    if (g_active == kNoSector || g_write_off >= kNvmJournalSectorBytes) { return 0u; }
+    return static_cast<uint16_t>((kNvmJournalSectorBytes - g_write_off) / kNvmJournalRecordBytes);
+}
+
+uint32_t nvm_journal_erase_count() noexcept { return g_erase_count; }
+uint32_t nvm_journal_record_count() noexcept { return g_record_count; }
+
+}  // namespace ems::hal
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ems::hal {
+
+// ── Journal log-structured dos mapas adaptativos ─────────────────────────────
+// Substitui o rewrite do setor inteiro a cada flush: a imagem adaptativa
+// (LTFT + knock + LTFT-add + seed + ETB cal, layout kNvmOff* de flash.h) é
+// persistida como registos append-only de 16 B (1 quad-word de flash) num
+// anel de kNvmJournalSectors setores Bank2.
+//
+//   Setor:   [header 16 B][registo][registo]...[0xFF…]
+//   Header:  magic "NJL1" | seq u32 | image_len u16 | version u8 | rsv | crc32
+//   Registo: off u16 | len u8 (1-8) | type u8 | data[8] | crc32 (bytes 0-11)
+//
+// Cada setor abre com um snapshot completo da imagem (registos DATA) seguido
+// de COMMIT; depois só deltas — runs de ≤ 8 células alteradas. Setor cheio →
+// compactação: apaga o PRÓXIMO setor do anel (round-robin = wear levelling),
+// escreve seq+1 + snapshot + COMMIT. O setor anterior continua válido até o
+// COMMIT do novo: power-loss a meio da compactação remonta o antigo.
+//
+// Mount: escolhe o setor com header válido + COMMIT e seq mais recente
+// (wrap-aware); replay aplica os DATA por ordem. Registo com CRC inválido
+// (escrita rasgada) é ignorado; o primeiro slot apagado marca o fim.
+//
+// Módulo puro (target e host): o acesso à flash é injectado via NvmJournalIo.
+
+constexpr uint8_t  kNvmJournalSectors     = 4u;
+constexpr uint32_t kNvmJournalSectorBytes = 8192u;   // == FLASH_SECTOR_SIZE
+constexpr uint32_t kNvmJournalRecordBytes = 16u;     // quad-word
+constexpr uint8_t  kNvmJournalRunBytes    = 8u;      // células por registo
+constexpr uint32_t kNvmJournalMagic       = 0x314C4A4Eu;  // "NJL1"
+constexpr uint8_t  kNvmJournalVersion     = 1u;
+constexpr uint16_t kNvmJournalImageMax    = 1024u;
+
+enum class NvmIoPoll : uint8_t { Ready, Busy, Error };
+
+struct NvmJournalIo {
+    // Base mapeada em memória do setor idx (0..kNvmJournalSectors-1).
+    const uint8_t* (*sector)(uint8_t idx);
+    // Inicia o erase do setor (não bloqueia; conclusão via poll).
+    bool (*erase)(uint8_t idx);
+    // Inicia a programação de 1 quad-word (16 B, offset múltiplo de 16) num
+    // slot apagado (não bloqueia; conclusão via poll).
+    bool (*program)(uint8_t idx, uint32_t offset, const uint8_t* qw);
+    NvmIoPoll (*poll)();
+};
+
+enum class NvmJournalStatus : uint8_t {
+    Idle,    // imagem toda persistida
+    Busy,    // trabalho pendente — chamar de novo
+    Error,   // falha de flash; próxima chamada recomeça (compactação forçada)
+};
+
+// Liga o journal a um backend e fixa o tamanho da imagem. false (journal
+// desligado) se io == nullptr ou image_len fora de 1..kNvmJournalImageMax.
+bool nvm_journal_attach(const NvmJournalIo* io, uint16_t image_len) noexcept;
+
+// Replay do setor mais recente para image_out. false = nenhum setor válido
+// (image_out zerada; o primeiro flush formata o anel).
+bool nvm_journal_mount(uint8_t* image_out) noexcept;
+
+// Persiste as diferenças entre image e o estado já gravado. budget = máx. de
+// quad-words programados nesta chamada (o erase conta como um passo). Nunca
+// espera pelo controlador: erase/program em curso → Busy (chamar de novo).
+NvmJournalStatus nvm_journal_flush_step(const uint8_t* image, uint8_t budget) noexcept;
+
+// true se image difere do que o journal reproduz no próximo mount.
+bool nvm_journal_pending(const uint8_t* image) noexcept;
+
+// Diagnóstico
+uint8_t  nvm_journal_active_sector() noexcept;    // 0xFF = anel por formatar
+uint32_t nvm_journal_sequence() noexcept;
+uint16_t nvm_journal_free_records() noexcept;
+uint32_t nvm_journal_erase_count() noexcept;      // desde attach
+uint32_t nvm_journal_record_count() noexcept;     // quad-words programados desde attach
+
+}  // namespace ems::hal
@@ -13,6 +13,7 @@ uint32_t gpioa_otyper = 0u, gpiob_otyper = 0u, gpioc_otyper = 0u, gpioe_otyper =
 uint32_t gpioa_pupdr = 0u, gpiob_pupdr = 0u, gpioc_pupdr = 0u, gpioe_pupdr = 0u;
 uint32_t gpioa_afrh = 0u;
 uint32_t gpioa_bsrr = 0u, gpiob_bsrr = 0u, gpioc_bsrr = 0u, gpioe_bsrr = 0u;
+uint32_t gpiod_moder = 0u, gpiod_otyper = 0u, gpiod_pupdr = 0u, gpiod_bsrr = 0u;
 }  // namespace ems::hal::out_pins_host
 
 #else
@@ -38,6 +39,17 @@ void out_pins_hw_init() noexcept {
     GPIOE_BSRR = (1U << (0U + 16U)) | (1U << (2U + 16U)) | (1U << (4U + 16U))
                | (1U << (6U + 16U)) | (1U << (9U + 16U)) | (1U << (11U + 16U))
                | (1U << (13U + 16U)) | (1U << (15U + 16U));
+#if EMS_OUT_CHANNELS > 8
+    // 5–8 cilindros: INJ5–8 PD8–11 · IGN5–8 PD12–15 (PD3 = EWG, intocado).
+    RCC_AHB2ENR1 |= RCC_AHB2ENR1_GPIODEN;
+    for (volatile uint32_t d = 0u; d < 8u; ++d) {}
+    for (uint8_t pin = 8U; pin <= 15U; ++pin) {
+        GPIOD_OTYPER &= ~(1U << pin);
+        GPIOD_PUPDR  = (GPIOD_PUPDR & ~(3U << (pin * 2U)));
+        GPIOD_MODER  = (GPIOD_MODER & ~(3U << (pin * 2U))) | (1U << (pin * 2U));
+    }
+    GPIOD_BSRR = 0xFF00U << 16U;
+#endif
 #else
     // RGT6: INJ PA15/PB3/PC10/PC11 · IGN PC6–9
     // PA15 after reset is often JTDI with pull-up → HIGH until here.
@@ -76,6 +88,7 @@ uint32_t out_pins_test_bsrr_snapshot(uint8_t port) noexcept {
     case 1: return gpiob_bsrr;
     case 2: return gpioc_bsrr;
     case 3: return gpioe_bsrr;
+    case 4: return gpiod_bsrr;
     default: return 0u;
     }
 }
@@ -88,6 +101,7 @@ void out_pins_test_reset_stubs() noexcept {
     gpioa_pupdr = gpiob_pupdr = gpioc_pupdr = gpioe_pupdr = 0u;
     gpioa_afrh = 0u;
     gpioa_bsrr = gpiob_bsrr = gpioc_bsrr = gpioe_bsrr = 0u;
+    gpiod_moder = gpiod_otyper = gpiod_pupdr = gpiod_bsrr = 0u;
 }
 #endif
 
@@ -5,6 +5,7 @@
  *
  * Channel index MUST match ecu_sched ECU_CH_* / event.channel order:
  *   [0]=INJ3 [1]=INJ4 [2]=INJ1 [3]=INJ2 [4]=IGN4 [5]=IGN3 [6]=IGN2 [7]=IGN1
+ *   [8..11]=INJ5..8 [12..15]=IGN5..8  (só EMS_CYLINDERS > 4, VGT6 GPIOD)
  *
  * Hot-path rule: out_pin_write is inline in this header so ecu_sched can
  * inline without LTO (see ecu_sched_internal.h).
@@ -21,28 +22,57 @@
 
 namespace ems::hal {
 
-enum : uint8_t { kOutPortA = 0U, kOutPortB = 1U, kOutPortC = 2U, kOutPortE = 3U };
+enum : uint8_t {
+    kOutPortA = 0U, kOutPortB = 1U, kOutPortC = 2U, kOutPortE = 3U, kOutPortD = 4U
+};
+
+inline constexpr uint8_t kOutChannelCount = EMS_OUT_CHANNELS;
 
 // Pin metric index 0..3 INJ, 4..7 IGN — same as former k_ch_to_pin_idx.
-inline constexpr uint8_t kOutChToPinIdx[8] = {2U, 3U, 0U, 1U, 7U, 6U, 5U, 4U};
+// Banco 5–8: índice = canal (8..11 INJ5..8, 12..15 IGN5..8), i.e. o índice
+// segue sempre o padrão [banco×8 + (0..3 INJ | 4..7 IGN)].
+#if EMS_OUT_CHANNELS > 8
+inline constexpr uint8_t kOutChToPinIdx[kOutChannelCount] = {
+    2U, 3U, 0U, 1U, 7U, 6U, 5U, 4U,
+    8U, 9U, 10U, 11U, 12U, 13U, 14U, 15U
+};
+#else
+inline constexpr uint8_t kOutChToPinIdx[kOutChannelCount] = {2U, 3U, 0U, 1U, 7U, 6U, 5U, 4U};
+#endif
 
 #if EMS_BOARD_IS_VGT6
 // VGT6: INJ PE0/2/4/6 · IGN PE9/11/13/15 — ordered by ECU_CH_*
-inline constexpr uint8_t kOutBsrrPort[8] = {
+// 5–8 cil: INJ5–8 PD8–11 · IGN5–8 PD12–15 (PE livres colidem com ETB PE5/7/8).
+#if EMS_OUT_CHANNELS > 8
+inline constexpr uint8_t kOutBsrrPort[kOutChannelCount] = {
+    kOutPortE, kOutPortE, kOutPortE, kOutPortE,
+    kOutPortE, kOutPortE, kOutPortE, kOutPortE,
+    kOutPortD, kOutPortD, kOutPortD, kOutPortD,
+    kOutPortD, kOutPortD, kOutPortD, kOutPortD
+};
+inline constexpr uint8_t kOutBsrrPin[kOutChannelCount] = {
+    4U, 6U, 0U, 2U,
+    15U, 13U, 11U, 9U,
+    8U, 9U, 10U, 11U,
+    12U, 13U, 14U, 15U
+};
+#else
+inline constexpr uint8_t kOutBsrrPort[kOutChannelCount] = {
     kOutPortE, kOutPortE, kOutPortE, kOutPortE,
     kOutPortE, kOutPortE, kOutPortE, kOutPortE
 };
-inline constexpr uint8_t kOutBsrrPin[8] = {
+inline constexpr uint8_t kOutBsrrPin[kOutChannelCount] = {
     4U, 6U, 0U, 2U,
     15U, 13U, 11U, 9U
 };
+#endif
 #else
 // RGT6: INJ PA15/PB3/PC10/PC11 · IGN PC6–9 — ordered by ECU_CH_*
-inline constexpr uint8_t kOutBsrrPort[8] = {
+inline constexpr uint8_t kOutBsrrPort[kOutChannelCount] = {
     kOutPortC, kOutPortC, kOutPortA, kOutPortB,
     kOutPortC, kOutPortC, kOutPortC, kOutPortC
 };
-inline constexpr uint8_t kOutBsrrPin[8] = {
+inline constexpr uint8_t kOutBsrrPin[kOutChannelCount] = {
     10U, 11U, 15U, 3U,
     9U, 8U, 7U, 6U
 };
@@ -52,6 +82,10 @@ inline constexpr uint8_t kOutBsrrPin[8] = {
 #if EMS_BOARD_IS_VGT6
 static_assert(kOutBsrrPort[2] == kOutPortE && kOutBsrrPin[2] == 0U, "INJ1=PE0");
 static_assert(kOutBsrrPort[7] == kOutPortE && kOutBsrrPin[7] == 9U, "IGN1=PE9");
+#if EMS_OUT_CHANNELS > 8
+static_assert(kOutBsrrPort[8] == kOutPortD && kOutBsrrPin[8] == 8U, "INJ5=PD8");
+static_assert(kOutBsrrPort[15] == kOutPortD && kOutBsrrPin[15] == 15U, "IGN8=PD15");
+#endif
 #else
 static_assert(kOutBsrrPort[2] == kOutPortA && kOutBsrrPin[2] == 15U, "INJ1=PA15");
 static_assert(kOutBsrrPort[3] == kOutPortB && kOutBsrrPin[3] == 3U, "INJ2=PB3");
@@ -60,7 +94,7 @@ static_assert(kOutBsrrPort[7] == kOutPortC && kOutBsrrPin[7] == 6U, "IGN1=PC6");
 
 /** Active-high actuators: high=1 drives pin high (ON/DWELL), high=0 drives low (OFF/SPARK). */
 inline void out_pin_write(uint8_t channel, uint8_t high) noexcept {
-    if (channel >= 8U) { return; }
+    if (channel >= kOutChannelCount) { return; }
     const uint8_t pin = kOutBsrrPin[channel];
     const uint32_t mask = high ? (1U << pin)
                                : (1U << (static_cast<uint32_t>(pin) + 16U));
@@ -68,6 +102,9 @@ inline void out_pin_write(uint8_t channel, uint8_t high) noexcept {
     case kOutPortA: GPIOA_BSRR = mask; break;
     case kOutPortB: GPIOB_BSRR = mask; break;
     case kOutPortE: GPIOE_BSRR = mask; break;
+#if EMS_OUT_CHANNELS > 8
+    case kOutPortD: GPIOD_BSRR = mask; break;
+#endif
     default:        GPIOC_BSRR = mask; break;
     }
 }
@@ -79,7 +116,7 @@ inline void out_pin_write(uint8_t channel, uint8_t high) noexcept {
 void out_pins_hw_init() noexcept;
 
 #if defined(EMS_HOST_TEST)
-/** Port index: A=0 B=1 C=2 E=3 — last BSRR write value (host mock). */
+/** Port index: A=0 B=1 C=2 E=3 D=4 — last BSRR write value (host mock). */
 uint32_t out_pins_test_bsrr_snapshot(uint8_t port) noexcept;
 void out_pins_test_reset_stubs() noexcept;
 #endif
@@ -14,6 +14,7 @@ extern uint32_t gpioa_otyper, gpiob_otyper, gpioc_otyper, gpioe_otyper;
 extern uint32_t gpioa_pupdr, gpiob_pupdr, gpioc_pupdr, gpioe_pupdr;
 extern uint32_t gpioa_afrh;
 extern uint32_t gpioa_bsrr, gpiob_bsrr, gpioc_bsrr, gpioe_bsrr;
+extern uint32_t gpiod_moder, gpiod_otyper, gpiod_pupdr, gpiod_bsrr;
 }  // namespace ems::hal::out_pins_host
 
 #define RCC_AHB2ENR1 ems::hal::out_pins_host::rcc_ahb2enr1
@@ -34,11 +35,16 @@ extern uint32_t gpioa_bsrr, gpiob_bsrr, gpioc_bsrr, gpioe_bsrr;
 #define GPIOB_BSRR   ems::hal::out_pins_host::gpiob_bsrr
 #define GPIOC_BSRR   ems::hal::out_pins_host::gpioc_bsrr
 #define GPIOE_BSRR   ems::hal::out_pins_host::gpioe_bsrr
+#define GPIOD_MODER  ems::hal::out_pins_host::gpiod_moder
+#define GPIOD_OTYPER ems::hal::out_pins_host::gpiod_otyper
+#define GPIOD_PUPDR  ems::hal::out_pins_host::gpiod_pupdr
+#define GPIOD_BSRR   ems::hal::out_pins_host::gpiod_bsrr
 
 #ifndef RCC_AHB2ENR1_GPIOAEN
 #define RCC_AHB2ENR1_GPIOAEN 1U
 #define RCC_AHB2ENR1_GPIOBEN 2U
 #define RCC_AHB2ENR1_GPIOCEN 4U
+#define RCC_AHB2ENR1_GPIODEN 8U
 #define RCC_AHB2ENR1_GPIOEEN 16U
 #endif
 
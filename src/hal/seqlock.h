@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+
+namespace ems::hal {
+
+/**
+ * @brief Bloco duplo com contador de sequência (seqlock sem espera do leitor).
+ *
+ * Um ÚNICO escritor (ou escritores que nunca se interrompem entre si, p.ex.
+ * ISRs da mesma prioridade, ou main loop dentro de CriticalSectionGuard)
+ * escreve sempre no buffer inactivo e publica com um incremento de seq:
+ *
+ *   seq par   → publicado = buf[(seq/2) & 1]
+ *   seq ímpar → escrita em curso no OUTRO buffer (o publicado continua válido)
+ *
+ * O leitor nunca desliga interrupções nem espera pelo escritor: copia o
+ * buffer publicado e confirma que o escritor não voltou a ele durante a
+ * cópia (isso exige dois commits completos + início de um terceiro). Só
+ * ordenação de compilador: alvo single-core (Cortex-M33), sem cache de dados
+ * partilhada com DMA para estes blocos.
+ *
+ * Estado inicial: seq = 0 → buf[0] publicado (T{} ou o valor do construtor).
+ *
+ * @code
+ *   SeqLock<Cal> g_cal;
+ *   g_cal.write(c);                // main loop
+ *   const Cal c = g_cal.read();    // qualquer contexto
+ *   g_cal.view().field;            // só em contexto que o escritor não preempta
+ * @endcode
+ */
+template <typename T>
+class SeqLock {
+public:
+    constexpr SeqLock() noexcept = default;
+    constexpr explicit SeqLock(const T& init) noexcept : buf_{init, init} {}
+
+    void write(const T& v) noexcept {
+        const uint32_t base = seq_ & ~1u;
+        seq_ = base + 1u;
+        barrier();
+        buf_[((base >> 1u) + 1u) & 1u] = v;
+        barrier();
+        seq_ = base + 2u;
+    }
+
+    // Uma tentativa; false = cópia possivelmente rasgada (repetir).
+    bool try_read(T& out) const noexcept {
+        const uint32_t s0 = seq_;
+        barrier();
+        out = buf_[(s0 >> 1u) & 1u];
+        barrier();
+        return (seq_ - (s0 & ~1u)) <= 2u;
+    }
+
+    // Repete até cópia consistente. Numa ISR que o escritor não preempta a
+    // primeira tentativa é sempre boa; no main loop falha só se o escritor
+    // completar dois commits durante a cópia.
+    T read() const noexcept {
+        T out;
+        while (!try_read(out)) {}
+        return out;
+    }
+
+    // Referência ao publicado — SÓ em contexto que o escritor não preempta
+    // (ISR de prioridade ≥ à do escritor, ou o próprio escritor).
+    const T& view() const noexcept { return buf_[(seq_ >> 1u) & 1u]; }
+
+    uint32_t sequence() const noexcept { return seq_; }
+
+#if defined(EMS_HOST_TEST)
+    // Simula um escritor interrompido a meio (seq ímpar pendente).
+    void test_begin_write() noexcept { seq_ = (seq_ & ~1u) + 1u; }
+    void test_reset() noexcept { seq_ = 0u; buf_[0] = T{}; buf_[1] = T{}; }
+#endif
+
+private:
+    static void barrier() noexcept { __asm__ volatile("" ::: "memory"); }
+
+    T buf_[2] = {};
+    volatile uint32_t seq_ = 0u;
+};
+
+}  // namespace ems::hal
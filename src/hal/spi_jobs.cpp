@@ -0,0 +1,134 @@
+/**
+ * @file hal/spi_jobs.cpp
+ * @brief Fila de bursts SPI assíncronos (ver spi_jobs.h).
+ */
+
+#include "hal/spi_jobs.h"
+
+#include <cstring>
+
+namespace {
+
+using ems::hal::SpiJobDone;
+using ems::hal::SpiJobIo;
+using ems::hal::SpiXferPoll;
+using ems::hal::kSpiJobMaxFrames;
+using ems::hal::kSpiJobQueueDepth;
+
+struct Job {
+    uint8_t    n;
+    SpiJobDone done;
+    void*      ctx;
+    alignas(4) uint16_t tx[kSpiJobMaxFrames];
+    alignas(4) uint16_t rx[kSpiJobMaxFrames];
+};
+
+const SpiJobIo* g_io = nullptr;
+Job      g_jobs[kSpiJobQueueDepth] = {};
+uint8_t  g_head     = 0u;
+uint8_t  g_count    = 0u;
+bool     g_active   = false;   // job da frente arrancado no hardware
+uint32_t g_start_us = 0u;
+uint32_t g_completed = 0u;
+uint32_t g_failed    = 0u;
+uint32_t g_timeouts  = 0u;
+
+void finish(bool ok) noexcept {
+    Job& j = g_jobs[g_head];
+    g_io->idle();
+    g_active = false;
+    // Retira antes do callback: done() pode submeter o job seguinte para o
+    // mesmo slot (fila cheia) — rx é copiado antes.
+    const SpiJobDone done = j.done;
+    void* const ctx = j.ctx;
+    const uint8_t n = j.n;
+    uint16_t rx[kSpiJobMaxFrames];
+    std::memcpy(rx, j.rx, sizeof(rx));
+    g_head = static_cast<uint8_t>((g_head + 1u) % kSpiJobQueueDepth);
+    --g_count;
+    if (ok) { ++g_completed; } else { ++g_failed; }
+    if (done != nullptr) { done(ctx, ok, rx, n); }
+}
+
+}  // namespace
+
+namespace ems::hal {
+
+void spi_jobs_attach(const SpiJobIo* io) noexcept {
+    if (g_io != nullptr && g_active) { g_io->idle(); }
+    g_io = io;
+    g_head = 0u;
+    g_count = 0u;
+    g_active = false;
+}
+
+const SpiJobIo* spi_jobs_io() noexcept { return g_io; }
+
+bool spi_jobs_submit(const uint16_t* tx, uint8_t n, SpiJobDone done, void* ctx) noexcept {
+    if (g_io == nullptr || g_count >= kSpiJobQueueDepth ||
+        tx == nullptr || n == 0u || n > kSpiJobMaxFrames) {
+        return false;
+    }
+    Job& j = g_jobs[(g_head + g_count) % kSpiJobQueueDepth];
+    j.n = n;
+    j.done = done;
+    j.ctx = ctx;
+    std::memcpy(j.tx, tx, n * sizeof(uint16_t));
+    std::memset(j.rx, 0, sizeof(j.rx));
+    ++g_count;
+    return true;
+}
+
+bool spi_jobs_step() noexcept {
+    if (g_io == nullptr) { return g_count != 0u; }
+    if (g_active) {
+        const SpiXferPoll p = g_io->poll();
+        if (p == SpiXferPoll::Busy) {
+            if (g_io->now_us() - g_start_us < kSpiJobTimeoutUs) { return true; }
+            ++g_timeouts;
+            finish(false);
+        } else {
+            finish(p == SpiXferPoll::Done);
+        }
+    }
+    if (!g_active && g_count != 0u) {
+        Job& j = g_jobs[g_head];
+        g_start_us = g_io->now_us();
+        if (g_io->start(j.tx, j.rx, j.n)) {
+            g_active = true;
+        } else {
+            finish(false);
+        }
+    }
+    return g_count != 0u;
+}
+
+bool spi_jobs_drain(uint32_t timeout_us) noexcept {
+    if (g_io == nullptr) { return g_count == 0u; }
+    const uint32_t t0 = g_io->now_us();
+    while (g_count != 0u) {
+        static_cast<void>(spi_jobs_step());
+        if (g_io->now_us() - t0 >= timeout_us) { break; }
+    }
+    return g_count == 0u;
+}
+
+bool spi_jobs_busy() noexcept { return g_count != 0u; }
+uint8_t spi_jobs_pending() noexcept { return g_count; }
+uint32_t spi_jobs_completed() noexcept { return g_completed; }
+uint32_t spi_jobs_failed() noexcept { return g_failed; }
+uint32_t spi_jobs_timeouts() noexcept { return g_timeouts; }
+
+#if defined(EMS_HOST_TEST)
+void spi_jobs_test_reset() noexcept {
+    if (g_io != nullptr && g_active) { g_io->idle(); }
+    g_head = 0u;
+    g_count = 0u;
+    g_active = false;
+    g_completed = 0u;
+    g_failed = 0u;
+    g_timeouts = 0u;
+}
+#endif
+
+}  // namespace ems::hal
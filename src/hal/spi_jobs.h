@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ems::hal {
+
+// ── Fila de transacções SPI assíncronas (bus do TLE8888) ─────────────────────
+// Cada job é um burst de até kSpiJobMaxFrames frames de 16 bits, com CS
+// pulsado entre frames (o TLE8888 trava cada comando na subida do CS). O
+// burst corre sem CPU (GPDMA TX/RX + NSS por hardware no target); o main loop
+// só arranca o job da frente e recolhe o resultado em spi_jobs_step().
+//
+//   submit(tx, n, done) → [start] → … poll Busy … → [Done] → done(ctx, ok, rx, n)
+//
+// Um burst que não conclui em kSpiJobTimeoutUs (chip sem clock, DMA preso) é
+// abortado e reportado com ok = false — nunca há espera activa por frame.
+// tx é copiado no submit; o rx entregue ao callback só vale durante a chamada.
+// Callbacks correm no contexto de spi_jobs_step() (main loop, nunca ISR) e
+// podem submeter o job seguinte.
+//
+// Módulo puro: acesso ao hardware via SpiJobIo (SPI2 + GPDMA no target,
+// modelo de registos do TLE8888 nos host tests — hal/tle8888.h).
+
+constexpr uint8_t  kSpiJobQueueDepth = 4u;
+constexpr uint8_t  kSpiJobMaxFrames  = 16u;
+constexpr uint32_t kSpiJobTimeoutUs  = 1000u;  // 16 frames a 3.9 MHz ≈ 80 µs
+
+enum class SpiXferPoll : uint8_t { Busy, Done, Error };
+
+struct SpiJobIo {
+    // Inicia o burst (tx/rx com n frames, memória estável até idle()); não espera.
+    bool (*start)(const uint16_t* tx, uint16_t* rx, uint8_t n);
+    SpiXferPoll (*poll)();
+    // Fim ou abort: periférico e DMA prontos para o próximo start().
+    void (*idle)();
+    uint32_t (*now_us)();
+};
+
+using SpiJobDone = void (*)(void* ctx, bool ok, const uint16_t* rx, uint8_t n);
+
+// Liga a fila a um backend. Descarta jobs pendentes (sem callback).
+void spi_jobs_attach(const SpiJobIo* io) noexcept;
+const SpiJobIo* spi_jobs_io() noexcept;
+
+// false = fila cheia / argumentos inválidos (nada foi enfileirado).
+bool spi_jobs_submit(const uint16_t* tx, uint8_t n, SpiJobDone done, void* ctx) noexcept;
+
+// Recolhe o burst em curso (se concluído/expirado) e arranca o seguinte.
+// Retorna true se ainda há jobs.
+bool spi_jobs_step() noexcept;
+// Bloqueante (boot): corre passos até a fila esvaziar ou timeout.
+bool spi_jobs_drain(uint32_t timeout_us) noexcept;
+
+bool    spi_jobs_busy() noexcept;
+uint8_t spi_jobs_pending() noexcept;
+
+// Diagnóstico
+uint32_t spi_jobs_completed() noexcept;
+uint32_t spi_jobs_failed() noexcept;
+uint32_t spi_jobs_timeouts() noexcept;
+
+#if defined(EMS_HOST_TEST)
+void spi_jobs_test_reset() noexcept;
+#endif
+
+}  // namespace ems::hal
@@ -30,6 +30,7 @@
 #define TIM4_BASE    0x40000800UL
 #define TIM5_BASE    0x40000C00UL
 #define TIM6_BASE    0x40001000UL
+#define TIM7_BASE    0x40001400UL
 #define TIM1_BASE    0x40012C00UL
 #define TIM8_BASE    0x40013400UL
 #define USART1_BASE  0x40013800UL
@@ -125,6 +126,7 @@
 #define RCC_APB1LENR_TIM4EN   (1u << 2)
 #define RCC_APB1LENR_TIM5EN   (1u << 3)
 #define RCC_APB1LENR_TIM6EN   (1u << 4)
+#define RCC_APB1LENR_TIM7EN   (1u << 5)
 #define RCC_APB1LENR_FDCAN1EN (1u << 9)
 #define RCC_APB1LENR_IWDGEN   (1u << 12)
 #define RCC_APB1LENR_SPI2EN   (1u << 14)
@@ -173,6 +175,8 @@
 #define GPIOC_BSRR    STM32_REG32(GPIOC_BASE + GPIO_BSRR_OFF)
 
 #define GPIOD_MODER   STM32_REG32(GPIOD_BASE + GPIO_MODER_OFF)
+#define GPIOD_OTYPER  STM32_REG32(GPIOD_BASE + GPIO_OTYPER_OFF)
+#define GPIOD_PUPDR   STM32_REG32(GPIOD_BASE + GPIO_PUPDR_OFF)
 #define GPIOD_OSPEEDR STM32_REG32(GPIOD_BASE + GPIO_OSPEEDR_OFF)
 #define GPIOD_AFRL    STM32_REG32(GPIOD_BASE + GPIO_AFRL_OFF)
 #define GPIOD_AFRH    STM32_REG32(GPIOD_BASE + GPIO_AFRH_OFF)
@@ -451,6 +455,15 @@ static inline void gpio_set_analog(volatile uint32_t* moder, uint8_t pin) noexce
 #define TIM6_ARR   STM32_REG32(TIM6_BASE + TIM_ARR_OFF)
 #define TIM6_EGR   STM32_REG32(TIM6_BASE + TIM_EGR_OFF)
 
+// TIM7 — basic timer (base de tempo da malha de posição ETB, update IRQ)
+#define TIM7_CR1   STM32_REG32(TIM7_BASE + TIM_CR1_OFF)
+#define TIM7_DIER  STM32_REG32(TIM7_BASE + TIM_DIER_OFF)
+#define TIM7_SR    STM32_REG32(TIM7_BASE + TIM_SR_OFF)
+#define TIM7_CNT   STM32_REG32(TIM7_BASE + TIM_CNT_OFF)
+#define TIM7_PSC   STM32_REG32(TIM7_BASE + TIM_PSC_OFF)
+#define TIM7_ARR   STM32_REG32(TIM7_BASE + TIM_ARR_OFF)
+#define TIM7_EGR   STM32_REG32(TIM7_BASE + TIM_EGR_OFF)
+
 // TIM15 — advanced timer (legacy PE5 on VGT6; RGT6 ETB uses TIM3_CH1/PA6)
 #define TIM15_BASE   0x40014000UL
 #define RCC_APB2ENR_TIM15EN (1u << 16)
@@ -476,7 +489,10 @@ static inline void gpio_set_analog(volatile uint32_t* moder, uint8_t pin) noexce
 #define ADC_SQR3_OFF   0x38UL
 #define ADC_SQR4_OFF   0x3CUL
 #define ADC_DR_OFF     0x40UL
+#define ADC_JSQR_OFF   0x4CUL
 #define ADC_OFR1_OFF   0x60UL
+#define ADC_JDR1_OFF   0x80UL
+#define ADC_JDR2_OFF   0x84UL
 
 // Common registers (ADC1+ADC2 shared)
 #define ADC12_CCR_OFF  0x08UL
@@ -490,6 +506,9 @@ static inline void gpio_set_analog(volatile uint32_t* moder, uint8_t pin) noexce
 #define ADC1_SQR1  STM32_REG32(ADC1_BASE + ADC_SQR1_OFF)
 #define ADC1_SQR2  STM32_REG32(ADC1_BASE + ADC_SQR2_OFF)
 #define ADC1_DR    STM32_REG32(ADC1_BASE + ADC_DR_OFF)
+#define ADC1_JSQR  STM32_REG32(ADC1_BASE + ADC_JSQR_OFF)
+#define ADC1_JDR1  STM32_REG32(ADC1_BASE + ADC_JDR1_OFF)
+#define ADC1_JDR2  STM32_REG32(ADC1_BASE + ADC_JDR2_OFF)
 
 #define ADC2_ISR   STM32_REG32(ADC2_BASE + ADC_ISR_OFF)
 #define ADC2_CR    STM32_REG32(ADC2_BASE + ADC_CR_OFF)
@@ -507,7 +526,9 @@ static inline void gpio_set_analog(volatile uint32_t* moder, uint8_t pin) noexce
 #define ADC_CR_ADEN    (1u << 0)
 #define ADC_CR_ADDIS   (1u << 1)
 #define ADC_CR_ADSTART (1u << 2)
+#define ADC_CR_JADSTART (1u << 3)
 #define ADC_CR_ADSTP   (1u << 4)
+#define ADC_CR_JADSTP  (1u << 5)
 #define ADC_CR_ADCAL   (1u << 31)
 #define ADC_CR_ADCALDIF (1u << 30)
 #define ADC_CR_DEEPPWD (1u << 29)
@@ -517,6 +538,7 @@ static inline void gpio_set_analog(volatile uint32_t* moder, uint8_t pin) noexce
 #define ADC_ISR_ADRDY  (1u << 0)
 #define ADC_ISR_EOC    (1u << 2)
 #define ADC_ISR_EOS    (1u << 3)
+#define ADC_ISR_JEOC   (1u << 5)   // fim de conversão injectada (rc_w1)
 
 // ADC_IER — interrupt enable register (offset 0x04)
 #define ADC_IER_OFF    0x04UL
@@ -536,6 +558,21 @@ static inline void gpio_set_analog(volatile uint32_t* moder, uint8_t pin) noexce
 #define ADC_CFGR1_OVRMOD (1u << 12)  // 1 = overrun sobrescreve DR (não trava ADSTART)
 #define ADC_CFGR1_CONT   (1u << 13)
 #define ADC_CFGR1_DISCEN (1u << 16)
+#define ADC_CFGR1_JQDIS  (1u << 31)  // 1 = fila de contextos JSQR desligada (reset = 1)
+
+// ADC_CFGR2 bits — oversampler regular (RM0481 §25.4.31)
+#define ADC_CFGR2_ROVSE      (1u << 0)               // oversampling regular
+#define ADC_CFGR2_OVSR(r)    ((uint32_t)(r) << 2)    // razão 2^(r+1): 0=2× … 7=256×
+#define ADC_CFGR2_OVSS(s)    ((uint32_t)(s) << 5)    // shift à direita 0..8
+#define ADC_CFGR2_JOVSE      (1u << 1)               // oversampling injectado (mesma razão)
+
+// ADC_JSQR — sequência injectada (RM0481 §25.6.16)
+#define ADC_JSQR_JL(n)             ((uint32_t)(n) << 0)   // nº conversões − 1
+// JEXTSEL[4:0] = 0b01110 → TIM6_TRGO (adc_jext_trg14, RM0481 Tab.126)
+#define ADC_JSQR_JEXTSEL_TIM6_TRGO (14u << 2)
+#define ADC_JSQR_JEXTEN_RISING     (1u << 7)
+#define ADC_JSQR_JSQ1(ch)          ((uint32_t)(ch) << 9)
+#define ADC_JSQR_JSQ2(ch)          ((uint32_t)(ch) << 15)
 
 // ADC12_CCR bits
 #define ADC12_CCR_CKMODE_HCLK_DIV4 (3u << 16)  // CKMODE[1:0] = 11 → adc_hclk/4
@@ -545,6 +582,8 @@ static inline void gpio_set_analog(volatile uint32_t* moder, uint8_t pin) noexce
 #define GPDMA_CH_STRIDE 0x80UL
 #define GPDMA_CH0_BASE  (GPDMA1_BASE + 0x050UL)
 #define GPDMA_CH1_BASE  (GPDMA1_BASE + 0x0D0UL)
+#define GPDMA_CH2_BASE  (GPDMA1_BASE + 0x150UL)   // SPI2 RX (TLE8888)
+#define GPDMA_CH3_BASE  (GPDMA1_BASE + 0x1D0UL)   // SPI2 TX (TLE8888)
 
 #define GPDMA_CLLBAR_OFF 0x00UL
 #define GPDMA_CFCR_OFF   0x0CUL
@@ -587,6 +626,7 @@ static inline void gpio_set_analog(volatile uint32_t* moder, uint8_t pin) noexce
 #define GPDMA_CCR_EN      (1u << 0)
 #define GPDMA_CCR_RESET   (1u << 1)
 #define GPDMA_CCR_TCIE    (1u << 8)
+#define GPDMA_CCR_HTIE    (1u << 9)
 #define GPDMA_CCR_DTEIE   (1u << 10)
 #define GPDMA_CCR_USEIE   (1u << 12)
 #define GPDMA_CCR_PRIO_HIGH (2u << 22)
@@ -598,41 +638,49 @@ static inline void gpio_set_analog(volatile uint32_t* moder, uint8_t pin) noexce
 #define GPDMA_CLLR_UB1    (1u << 29)    // recarrega CBR1 do LLI
 
 #define GPDMA_CSR_TCF     (1u << 8)
+#define GPDMA_CSR_HTF     (1u << 9)
 #define GPDMA_CSR_DTEF    (1u << 10)
 #define GPDMA_CSR_USEF    (1u << 12)
 #define GPDMA_CFCR_ALL    (GPDMA_CSR_TCF | (1u << 9) | GPDMA_CSR_DTEF | (1u << 11) | GPDMA_CSR_USEF | (1u << 13) | (1u << 14))
 
 #define GPDMA_CTR1_HALFWORD_TO_HALFWORD_INC_DEST \
     ((1u << 0) | (1u << 16) | (1u << 19))
+#define GPDMA_CTR1_HALFWORD_INC_SRC_TO_HALFWORD \
+    ((1u << 0) | (1u << 3) | (1u << 16))
 #define GPDMA_CTR2_REQSEL_ADC1 0u
 #define GPDMA_CTR2_REQSEL_ADC2 1u
+#define GPDMA_CTR2_REQSEL_SPI2_RX 8u   // RM0481 tabela de requests GPDMA1
+#define GPDMA_CTR2_REQSEL_SPI2_TX 9u
+#define GPDMA_CTR2_DREQ        (1u << 10)  // request do lado destino (mem → periférico)
 #define GPDMA_CTR2_TCEM_BLOCK  0u
 
 // ─── FDCAN1 (RM0481 §51) ──────────────────────────────────────────────────────
+// Mapa do FDCAN do H5 (= G4): Message RAM de layout fixo, sem RXF0C/TXESC.
 #define FDCAN_CCCR_OFF   0x018UL   // CC Control Register
 #define FDCAN_NBTP_OFF   0x01CUL   // Nominal Bit Timing
 #define FDCAN_DBTP_OFF   0x00CUL   // Data Bit Timing
+#define FDCAN_TDCR_OFF   0x048UL   // Transmitter Delay Compensation
 #define FDCAN_RXGFC_OFF  0x080UL   // Global Filter Config
-#define FDCAN_TXBC_OFF   0x0C0UL   // TX Buffer Config
+#define FDCAN_HPMS_OFF   0x088UL   // High Priority Message Status
+#define FDCAN_RXF0S_OFF  0x090UL   // RX FIFO0 Status
+#define FDCAN_RXF0A_OFF  0x094UL   // RX FIFO0 Acknowledge
+#define FDCAN_TXBC_OFF   0x0C0UL   // TX Buffer Config (só TFQM)
 #define FDCAN_TXFQS_OFF  0x0C4UL   // TX FIFO/Queue Status
-#define FDCAN_TXBRP_OFF  0x0CCUL   // TX Buffer Request Pending
-#define FDCAN_TXBAR_OFF  0x0D0UL   // TX Buffer Add Request
-#define FDCAN_RXF0C_OFF  0x0A0UL   // RX FIFO0 Config
-#define FDCAN_RXF0S_OFF  0x0A4UL   // RX FIFO0 Status
-#define FDCAN_RXF0A_OFF  0x0A8UL   // RX FIFO0 Acknowledge
+#define FDCAN_TXBRP_OFF  0x0C8UL   // TX Buffer Request Pending
+#define FDCAN_TXBAR_OFF  0x0CCUL   // TX Buffer Add Request
 #define FDCAN_IR_OFF     0x050UL   // Interrupt Register
 #define FDCAN_IE_OFF     0x054UL   // Interrupt Enable
 #define FDCAN_ILE_OFF    0x05CUL   // Interrupt Line Enable
-#define FDCAN_SHPAM_OFF  0x094UL   // Standard ID filter area
 
 #define FDCAN1_CCCR  STM32_REG32(FDCAN1_BASE + FDCAN_CCCR_OFF)
 #define FDCAN1_NBTP  STM32_REG32(FDCAN1_BASE + FDCAN_NBTP_OFF)
+#define FDCAN1_DBTP  STM32_REG32(FDCAN1_BASE + FDCAN_DBTP_OFF)
+#define FDCAN1_TDCR  STM32_REG32(FDCAN1_BASE + FDCAN_TDCR_OFF)
 #define FDCAN1_RXGFC STM32_REG32(FDCAN1_BASE + FDCAN_RXGFC_OFF)
 #define FDCAN1_TXBC  STM32_REG32(FDCAN1_BASE + FDCAN_TXBC_OFF)
 #define FDCAN1_TXFQS STM32_REG32(FDCAN1_BASE + FDCAN_TXFQS_OFF)
 #define FDCAN1_TXBRP STM32_REG32(FDCAN1_BASE + FDCAN_TXBRP_OFF)
 #define FDCAN1_TXBAR STM32_REG32(FDCAN1_BASE + FDCAN_TXBAR_OFF)
-#define FDCAN1_RXF0C STM32_REG32(FDCAN1_BASE + FDCAN_RXF0C_OFF)
 #define FDCAN1_RXF0S STM32_REG32(FDCAN1_BASE + FDCAN_RXF0S_OFF)
 #define FDCAN1_RXF0A STM32_REG32(FDCAN1_BASE + FDCAN_RXF0A_OFF)
 #define FDCAN1_IR    STM32_REG32(FDCAN1_BASE + FDCAN_IR_OFF)
@@ -649,6 +697,17 @@ static inline void gpio_set_analog(volatile uint32_t* moder, uint8_t pin) noexce
 #define FDCAN_CCCR_TEST  (1u << 7)    // Test Mode Enable
 #define FDCAN_CCCR_FDOE  (1u << 8)    // FD Operation Enable
 #define FDCAN_CCCR_BRSE  (1u << 9)    // Bit Rate Switch Enable
+#define FDCAN_DBTP_TDC   (1u << 23)   // Transceiver Delay Compensation
+
+// TX element word 1 (FD)
+#define FDCAN_TXE1_BRS   (1u << 20)
+#define FDCAN_TXE1_FDF   (1u << 21)
+
+// RXF0S / TXFQS
+#define FDCAN_RXF0S_F0FL_MASK   0x0000000FUL   // fill level [3:0]
+#define FDCAN_RXF0S_F0GI_POS    8u             // get index [9:8]
+#define FDCAN_TXFQS_TFQPI_POS   16u            // put index [17:16]
+#define FDCAN_TXFQS_TFQF        (1u << 21)     // FIFO/queue cheia
 
 // ─── USART1 / USART2 (RM0481 §49) ────────────────────────────────────────────
 #define USART_CR1_OFF  0x00UL
@@ -823,6 +882,7 @@ static inline void nvic_set_priority(uint8_t irq, uint8_t prio) noexcept {
 // IRQ_COMP1 is intentionally undefined; update knock.cpp when hardware is known.
 #define IRQ_TIM2         45u   // TIM2 global (master timebase — reserved)
 #define IRQ_TIM5         48u   // TIM5 global (CKP input capture)
+#define IRQ_TIM7         50u   // TIM7 global (malha de posição ETB)
 #define IRQ_TIM1_CC      44u   // TIM1 capture/compare (ignition OC match)
 #define IRQ_TIM3         46u   // TIM3 global (injection OC match)
 #define IRQ_TIM4         47u   // TIM4 (PWM VVT — não usa IRQ)
@@ -833,6 +893,19 @@ static inline void nvic_set_priority(uint8_t irq, uint8_t prio) noexcept {
 #define IRQ_FDCAN1_IT0   39u   // FDCAN1 interrupt line 0
 // SysTick não usa NVIC — configurado via SCB->SHP diretamente (ARM core)
 
+// ─── SCB: PendSV (trabalho diferido de ISR, prioridade mínima) ──────────────
+#define SCB_ICSR            STM32_REG32(0xE000ED04UL)
+#define SCB_ICSR_PENDSVSET  (1u << 28)
+#define SCB_SHPR3           STM32_REG32(0xE000ED20UL)   // [23:16] = PendSV
+#define SCB_SHPR3_PENDSV_SHIFT 16u
+
+// ─── DWT: contador de ciclos (perfil de kernels no alvo) ────────────────────
+#define DEMCR               STM32_REG32(0xE000EDFCUL)
+#define DEMCR_TRCENA        (1u << 24)
+#define DWT_CTRL            STM32_REG32(0xE0001000UL)
+#define DWT_CTRL_CYCCNTENA  (1u << 0)
+#define DWT_CYCCNT          STM32_REG32(0xE0001004UL)
+
 // ─── USB DRD FS (RM0481 §52.7) ───────────────────────────────────────────────
 // Base: APB2 @ 0x40016000
 // Packet Buffer Area: 0x40016C00 (2 KB)
@@ -1026,6 +1099,8 @@ static inline void nvic_set_priority(uint8_t irq, uint8_t prio) noexcept {
 
 // SPI_CFG1 — DSIZE[4:0] bits 0-4, MBR[30:28] prescaler
 #define SPI_CFG1_DSIZE_16BIT  (15u << 0u)  // 16-bit frame
+#define SPI_CFG1_RXDMAEN      (1u << 14u)
+#define SPI_CFG1_TXDMAEN      (1u << 15u)
 
 // SPI_CFG2
 #define SPI_CFG2_MASTER   (1u << 22u)
@@ -1035,6 +1110,8 @@ static inline void nvic_set_priority(uint8_t irq, uint8_t prio) noexcept {
 #define SPI_CFG2_CPHA     (1u << 24u)
 #define SPI_CFG2_CPOL     (1u << 25u)
 #define SPI_CFG2_COMM_FULLDUPLEX  (0u << 17u)
+#define SPI_CFG2_MSSI(n)  ((static_cast<uint32_t>(n) & 0xFu) << 0u)  // SS → 1.º clock
+#define SPI_CFG2_MIDI(n)  ((static_cast<uint32_t>(n) & 0xFu) << 4u)  // idle entre frames
 
 // SPI_SR
 #define SPI_SR_TXP        (1u << 1u)
@@ -1045,3 +1122,4 @@ static inline void nvic_set_priority(uint8_t irq, uint8_t prio) noexcept {
 // SPI_IFCR
 #define SPI_IFCR_EOTC     (1u << 3u)
 #define SPI_IFCR_TXTFC    (1u << 4u)
+#define SPI_IFCR_ALL      (0x0FF8u)  // EOTC…SUSPC (bits 3-11)
@@ -11,6 +11,7 @@
  *   TIM2_CH3 PB10: EWG PWM (motor wastegate)
  *   TIM4_CH1 PB6: VVT escape PWM
  *   TIM4_CH2 PB7: VVT admissao PWM
+ *   TIM7       --: base de tempo da malha de posição ETB (update IRQ)
  *
  * Clock dos timers:
  *   TIM5, TIM3, TIM4, TIM2 (APB1): timer clock = 250 MHz (timer doubler ativo)
@@ -248,6 +249,41 @@ void etb_pwm_set_duty_x10(uint16_t duty_pct_x10) noexcept {
 #endif
 }
 
+// ------------------------------------------------------------------------------
+// TIM7 — base de tempo periódica (malha de posição ETB)
+// Basic timer, só update IRQ; PSC/ARR como nos PWM (ARR ≤ 16 bits).
+// ------------------------------------------------------------------------------
+
+static TimPeriodicFn g_tim7_fn = nullptr;
+
+void tim7_periodic_init(uint32_t rate_hz, TimPeriodicFn fn) noexcept {
+    if (rate_hz == 0u || fn == nullptr) {
+        tim7_periodic_stop();
+        return;
+    }
+    RCC_APB1LENR |= RCC_APB1LENR_TIM7EN;
+    TIM7_CR1 = 0u;
+    TIM7_DIER = 0u;
+    uint32_t psc = 0u;
+    uint32_t arr = kTimClockHz / rate_hz;
+    while (arr > 0xFFFFu) { ++psc; arr = kTimClockHz / (rate_hz * (psc + 1u)); }
+    TIM7_PSC = psc;
+    TIM7_ARR = arr - 1u;
+    TIM7_EGR = 1u;          // carrega PSC/ARR
+    TIM7_SR = 0u;           // descarta o UIF do EGR
+    g_tim7_fn = fn;
+    TIM7_DIER = TIM_DIER_UIE;
+    nvic_set_priority(IRQ_TIM7, 4u); nvic_enable_irq(IRQ_TIM7);
+    TIM7_CR1 = TIM_CR1_ARPE | TIM_CR1_URS | TIM_CR1_CEN;
+}
+
+void tim7_periodic_stop() noexcept {
+    TIM7_CR1 = 0u;
+    TIM7_DIER = 0u;
+    TIM7_SR = 0u;
+    g_tim7_fn = nullptr;
+}
+
 // ----------------------------------------------------------------------------
 // ISR Handlers
 // ----------------------------------------------------------------------------
@@ -273,6 +309,16 @@ extern "C" void TIM5_IRQHandler(void) {
     }
 }
 
+/**
+ * @brief TIM7_IRQHandler — período da malha de posição ETB
+ */
+extern "C" void TIM7_IRQHandler(void) {
+    if ((TIM7_SR & TIM_SR_UIF) == 0u) { return; }
+    TIM7_SR = ~TIM_SR_UIF;
+    const TimPeriodicFn fn = g_tim7_fn;
+    if (fn != nullptr) { fn(); }
+}
+
 } // namespace ems::hal
 
 // ----------------------------------------------------------------------------
@@ -295,6 +341,8 @@ void timer_etb_set_duty(uint16_t duty) {
 #include "hal/timer.h"
 namespace ems::hal {
 static uint32_t g_mock_tim5_cnt = 0u;
+static uint32_t g_mock_tim7_rate_hz = 0u;
+static TimPeriodicFn g_mock_tim7_fn = nullptr;
 void tim5_ic_init(void) {}
 void tim3_pwm_init(uint32_t) {}
 void tim4_pwm_init(uint32_t) {}
@@ -305,6 +353,14 @@ void tim4_set_duty(uint8_t, uint16_t) noexcept {}
 void etb_pwm_init(uint32_t) {}
 void etb_pwm_set_duty_x10(uint16_t) noexcept {}
 uint32_t tim5_count() noexcept { return g_mock_tim5_cnt; }
+void tim7_periodic_init(uint32_t rate_hz, TimPeriodicFn fn) noexcept {
+    if (rate_hz == 0u || fn == nullptr) { tim7_periodic_stop(); return; }
+    g_mock_tim7_rate_hz = rate_hz;
+    g_mock_tim7_fn = fn;
+}
+void tim7_periodic_stop() noexcept { g_mock_tim7_rate_hz = 0u; g_mock_tim7_fn = nullptr; }
+uint32_t tim7_test_rate_hz() noexcept { return g_mock_tim7_rate_hz; }
+void tim7_test_fire() noexcept { if (g_mock_tim7_fn != nullptr) { g_mock_tim7_fn(); } }
 } // namespace ems::hal
 
 void timer_etb_pwm_init(void) {}
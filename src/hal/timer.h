@@ -22,6 +22,19 @@ void tim4_set_duty(uint8_t ch, uint16_t duty_pct_x10) noexcept;
 void etb_pwm_init(uint32_t freq_hz);
 void etb_pwm_set_duty_x10(uint16_t duty_pct_x10) noexcept;
 
+// TIM7 — base de tempo periódica (update IRQ a rate_hz, prioridade NVIC 4:
+// abaixo do CKP/TIM5 e do USB, acima do DMA do ADC). fn corre em contexto de
+// ISR a cada período; rate_hz = 0 ou fn nulo equivale a stop.
+using TimPeriodicFn = void (*)();
+void tim7_periodic_init(uint32_t rate_hz, TimPeriodicFn fn) noexcept;
+void tim7_periodic_stop() noexcept;
+
+#if defined(EMS_HOST_TEST)
+// Sem ISR no host: os testes disparam o período à mão.
+uint32_t tim7_test_rate_hz() noexcept;   // 0 = parado
+void     tim7_test_fire() noexcept;
+#endif
+
 // Deprecated aliases (hygiene PR-13) — prefer etb_pwm_*.
 inline void tim15_etb_pwm_init(uint32_t freq_hz) { etb_pwm_init(freq_hz); }
 inline void tim15_etb_set_duty_x10(uint16_t duty_pct_x10) noexcept {
@@ -1,7 +1,23 @@
+/**
+ * @file hal/tle8888.cpp
+ * @brief Driver TLE8888 sobre a fila SPI assíncrona (hal/spi_jobs.h).
+ *
+ * Cada operação é um burst único de frames (CS pulsado entre frames) com
+ * callback: probe do chip ID, configuração com read-back, passagem a modo
+ * normal e o lote de diag de 100 ms. Nenhum caminho espera pelo SPI fora do
+ * boot. Backend: SPI2 + GPDMA no target, modelo de registos no host.
+ */
 #include "hal/tle8888.h"
 
+#include <cstdint>
+#include <cstring>
+
+#include "hal/spi_jobs.h"
+
 #ifdef TARGET_STM32H562
 #include "hal/stm32h562/regs.h"
+#include "hal/system.h"
+#endif
 
 namespace {
 
@@ -53,167 +69,302 @@ constexpr uint8_t VRS_THRESH_DEFAULT = 0x30u;
 // 00=OK, 01=open-load, 10=short-to-GND, 11=short-to-VBAT
 constexpr uint8_t CH_FAULT_MASK = 0x03u;
 
+
+// Espera máxima no boot (probe + configuração + modo normal).
+constexpr uint32_t kBootDrainUs = 5000u;
+
+constexpr uint16_t rd(uint8_t addr) noexcept {
+    return static_cast<uint16_t>(TLE_READ | (static_cast<uint16_t>(addr) << 8u));
+}
+constexpr uint16_t wr(uint8_t addr, uint8_t data) noexcept {
+    return static_cast<uint16_t>(TLE_WRITE | (static_cast<uint16_t>(addr) << 8u) | data);
+}
+
+struct RegInit {
+    uint8_t addr;
+    uint8_t value;
+};
+
+// INJ ch0-3: low-side switch (2 bits each, packed 2 per register)
+// INCONFIG0: ch0[1:0]=01, ch1[3:2]=01 → 0x05; INCONFIG1 idem para ch2/ch3.
+// IGN ch0-3: push-pull, IGNCONFIG ch0..3 = 10 → 0xAA.
+// Overcurrent: INJ 10A, IGN 6A. Slew rate: fast for both banks.
+// VRS conditioner: enable, medium filter (60-2 tooth wheel), 20mV hysteresis
+// CKP reluctor → TLE8888 VRS_IN → conditioned digital → VRS_OUT → PA0 (TIM5_CH1)
+constexpr RegInit kConfig[] = {
+    {REG_INCONFIG0,  (CHMODE_LOW_SIDE << 2u) | CHMODE_LOW_SIDE},
+    {REG_INCONFIG1,  (CHMODE_LOW_SIDE << 2u) | CHMODE_LOW_SIDE},
+    {REG_IGNCONFIG,  (IGNMODE_PUSH_PULL << 6u) | (IGNMODE_PUSH_PULL << 4u) |
+                     (IGNMODE_PUSH_PULL << 2u) | IGNMODE_PUSH_PULL},
+    {REG_OC_THRESH,  (OC_IGN_6A << 4u) | OC_INJ_10A},
+    {REG_SLEW_RATE,  SLEW_FAST},
+    {REG_VRS_CTRL,   VRS_ENABLE | VRS_FILTER_MED | VRS_HYST_20MV},
+    {REG_VRS_THRESH, VRS_THRESH_DEFAULT},
+};
+constexpr uint8_t kConfigRegs = sizeof(kConfig) / sizeof(kConfig[0]);
+
+// Write + read-back por registo e um dummy read no fim: a resposta ao read
+// do registo i chega no frame 2i+2 (pipeline de 1 frame).
+constexpr uint8_t kConfigFrames = 2u * kConfigRegs + 1u;
+static_assert(kConfigFrames <= ems::hal::kSpiJobMaxFrames, "config não cabe num burst");
+
+// Lote de diag: 4 reads + trigger do watchdog; o read i responde no frame i+1.
+constexpr uint8_t kDiagRegs[4] = {
+    REG_DIAG_OUT0,  // INJ 0-1
+    REG_DIAG_OUT1,  // INJ 2-3
+    REG_DIAG_OUT2,  // IGN 0-1
+    REG_DIAG_OUT3,  // IGN 2-3
+};
+
+enum class TleOp : uint8_t { kIdle, kProbe, kConfig, kOpmode, kDiag };
+
 volatile uint16_t g_fault_count = 0u;
 volatile bool g_tle_ok = false;
 volatile bool g_tle_configured = false;
 // Per-channel fault status: [0-3]=INJ, [4-7]=IGN
 // Each byte: 0=OK, 1=open-load, 2=short-GND, 3=short-VBAT
 volatile uint8_t g_channel_faults[8] = {};
+TleOp    g_op = TleOp::kIdle;
+uint16_t g_busy_skips = 0u;
 
-inline void cs_low()  noexcept { GPIOB_BSRR = (1u << (12u + 16u)); }  // reset PB12
-inline void cs_high() noexcept { GPIOB_BSRR = (1u << 12u); }          // set PB12
+void decode_diag_pair(uint8_t reg_val, uint8_t base_ch) noexcept {
+    g_channel_faults[base_ch]     = reg_val & CH_FAULT_MASK;
+    g_channel_faults[base_ch + 1] = (reg_val >> 2u) & CH_FAULT_MASK;
+}
 
-constexpr uint32_t SPI_TIMEOUT = 50000u;  // ~500µs at 250MHz
+inline uint8_t resp_data(uint16_t rx) noexcept {
+    return static_cast<uint8_t>(rx & 0xFFu);
+}
 
-uint16_t spi2_txrx(uint16_t tx) noexcept {
-    uint32_t tries = SPI_TIMEOUT;
-    while (!(SPI2_SR & SPI_SR_TXP) && --tries) {}
-    if (!tries) { return 0xFFFFu; }
-    SPI2_TXDR = tx;
+void submit(TleOp op, const uint16_t* tx, uint8_t n, ems::hal::SpiJobDone done) noexcept {
+    g_op = ems::hal::spi_jobs_submit(tx, n, done, nullptr) ? op : TleOp::kIdle;
+}
 
-    SPI2_CR1 |= SPI_CR1_CSTART;
+void probe_done(void*, bool ok, const uint16_t* rx, uint8_t n) noexcept;
+void config_done(void*, bool ok, const uint16_t* rx, uint8_t n) noexcept;
+void opmode_done(void*, bool ok, const uint16_t*, uint8_t) noexcept;
 
-    tries = SPI_TIMEOUT;
-    while (!(SPI2_SR & SPI_SR_RXP) && --tries) {}
-    if (!tries) { SPI2_IFCR = SPI_IFCR_EOTC | SPI_IFCR_TXTFC; return 0xFFFFu; }
-    const uint16_t rx = static_cast<uint16_t>(SPI2_RXDR);
+void submit_probe() noexcept {
+    // Comando + dummy read para trazer a resposta.
+    const uint16_t tx[2] = {rd(REG_CHIP_ID), TLE_READ};
+    submit(TleOp::kProbe, tx, 2u, probe_done);
+}
 
-    tries = SPI_TIMEOUT;
-    while (!(SPI2_SR & SPI_SR_EOT) && --tries) {}
-    SPI2_IFCR = SPI_IFCR_EOTC | SPI_IFCR_TXTFC;
+void submit_config() noexcept {
+    uint16_t tx[kConfigFrames];
+    for (uint8_t i = 0u; i < kConfigRegs; ++i) {
+        tx[2u * i]      = wr(kConfig[i].addr, kConfig[i].value);
+        tx[2u * i + 1u] = rd(kConfig[i].addr);
+    }
+    tx[kConfigFrames - 1u] = TLE_READ;
+    submit(TleOp::kConfig, tx, kConfigFrames, config_done);
+}
 
-    return rx;
+void probe_done(void*, bool ok, const uint16_t* rx, uint8_t n) noexcept {
+    g_op = TleOp::kIdle;
+    g_tle_ok = ok && n >= 2u && resp_data(rx[1]) == EXPECTED_CHIP_ID;
+    if (!g_tle_ok) {
+        ++g_fault_count;
+        return;
+    }
+    // Configure channels: INJ low-side, IGN push-pull, OC thresholds, slew
+    if (!g_tle_configured) {
+        submit_config();
+    }
 }
 
-uint8_t tle_read(uint8_t addr) noexcept {
-    const uint16_t cmd = TLE_READ | (static_cast<uint16_t>(addr) << 8u);
-    cs_low();
-    spi2_txrx(cmd);      // send command, response is from previous
-    cs_high();
-    // Second transaction to clock out the response
-    cs_low();
-    const uint16_t resp = spi2_txrx(TLE_READ);  // dummy read
-    cs_high();
-    return static_cast<uint8_t>(resp & 0xFFu);
+void config_done(void*, bool ok, const uint16_t* rx, uint8_t n) noexcept {
+    g_op = TleOp::kIdle;
+    bool verified = ok && n == kConfigFrames;
+    for (uint8_t i = 0u; verified && i < kConfigRegs; ++i) {
+        verified = resp_data(rx[2u * i + 2u]) == kConfig[i].value;
+    }
+    if (!verified) {
+        ++g_fault_count;
+        if (!ok) { g_tle_ok = false; }
+        return;
+    }
+    // Normal operation mode — só com a configuração confirmada.
+    const uint16_t tx[1] = {wr(REG_OPMODE, 0x01u)};
+    submit(TleOp::kOpmode, tx, 1u, opmode_done);
+}
+
+void opmode_done(void*, bool ok, const uint16_t*, uint8_t) noexcept {
+    g_op = TleOp::kIdle;
+    g_tle_configured = ok;
+    if (!ok) {
+        ++g_fault_count;
+        g_tle_ok = false;
+    }
 }
 
-void tle_write(uint8_t addr, uint8_t data) noexcept {
-    const uint16_t cmd = TLE_WRITE | (static_cast<uint16_t>(addr) << 8u) | data;
-    cs_low();
-    spi2_txrx(cmd);
-    cs_high();
+void diag_done(void*, bool ok, const uint16_t* rx, uint8_t n) noexcept {
+    g_op = TleOp::kIdle;
+    if (!ok || n < 5u) {
+        // Burst expirado/abortado: chip sem resposta → re-probe no próximo poll.
+        ++g_fault_count;
+        g_tle_ok = false;
+        return;
+    }
+    for (uint8_t i = 0u; i < 4u; ++i) {
+        decode_diag_pair(resp_data(rx[i + 1u]), static_cast<uint8_t>(2u * i));
+    }
+
+    bool any_fault = false;
+    for (uint8_t i = 0u; i < 8u; ++i) {
+        if (g_channel_faults[i] != 0u) { any_fault = true; break; }
+    }
+    if (any_fault) { ++g_fault_count; }
 }
 
-bool write_verify(uint8_t addr, uint8_t data) noexcept {
-    tle_write(addr, data);
-    return tle_read(addr) == data;
+void submit_diag() noexcept {
+    // Per-channel diagnostics: INJ ch0-3 (regs 0x38-0x39), IGN ch0-3 (0x3A-0x3B)
+    uint16_t tx[5];
+    for (uint8_t i = 0u; i < 4u; ++i) {
+        tx[i] = rd(kDiagRegs[i]);
+    }
+    tx[4] = wr(REG_WD_TRIG, 0x01u);
+    submit(TleOp::kDiag, tx, 5u, diag_done);
 }
 
-bool configure_channels() noexcept {
-    // INJ ch0-3: low-side switch (2 bits each, packed 2 per register)
-    // INCONFIG0: ch0[1:0]=01, ch1[3:2]=01 → 0x05
-    // INCONFIG1: ch2[1:0]=01, ch3[3:2]=01 → 0x05
-    if (!write_verify(REG_INCONFIG0, (CHMODE_LOW_SIDE << 2u) | CHMODE_LOW_SIDE)) return false;
-    if (!write_verify(REG_INCONFIG1, (CHMODE_LOW_SIDE << 2u) | CHMODE_LOW_SIDE)) return false;
+}  // namespace
 
-    // IGN ch0-3: push-pull (2 bits each, packed 4 per register)
-    // IGNCONFIG: ch0[1:0]=10, ch1[3:2]=10, ch2[5:4]=10, ch3[7:6]=10 → 0xAA
-    const uint8_t ign_all_pp = (IGNMODE_PUSH_PULL << 6u) | (IGNMODE_PUSH_PULL << 4u)
-                              | (IGNMODE_PUSH_PULL << 2u) | IGNMODE_PUSH_PULL;
-    if (!write_verify(REG_IGNCONFIG, ign_all_pp)) return false;
+#ifdef TARGET_STM32H562
 
-    // Overcurrent: INJ 10A, IGN 6A
-    if (!write_verify(REG_OC_THRESH, (OC_IGN_6A << 4u) | OC_INJ_10A)) return false;
+// ── Backend SPI2 + GPDMA (CH2 = RX, CH3 = TX) ───────────────────────────────
+// NSS por hardware em PB12 (AF5) com SSOM: o SPI pulsa o CS entre frames, por
+// isso um burst inteiro (TSIZE = n) corre sem CPU. Fim = EOT do SPI + TC do
+// canal RX; erro de transferência/configuração do GPDMA aborta o burst.
+namespace {
 
-    // Slew rate: fast for both banks
-    if (!write_verify(REG_SLEW_RATE, SLEW_FAST)) return false;
+// CFG1: 16-bit data, prescaler = 32 → 125MHz/32 ≈ 3.9 MHz (< 5 MHz max)
+constexpr uint32_t kSpi2Cfg1 = SPI_CFG1_DSIZE_16BIT | (4u << 28u);  // MBR=100b → /32
 
-    // VRS conditioner: enable, medium filter (60-2 tooth wheel), 20mV hysteresis
-    // CKP reluctor → TLE8888 VRS_IN → conditioned digital → VRS_OUT → PA0 (TIM5_CH1)
-    if (!write_verify(REG_VRS_CTRL, VRS_ENABLE | VRS_FILTER_MED | VRS_HYST_20MV)) return false;
-    if (!write_verify(REG_VRS_THRESH, VRS_THRESH_DEFAULT)) return false;
+void gpdma_stop(uint32_t ch_base) noexcept {
+    GPDMA_REG(ch_base, GPDMA_CCR_OFF) = GPDMA_CCR_RESET;
+    for (uint32_t i = 0u; i < 128u; ++i) {
+        if ((GPDMA_REG(ch_base, GPDMA_CCR_OFF) & GPDMA_CCR_RESET) == 0u) { break; }
+    }
+    GPDMA_REG(ch_base, GPDMA_CFCR_OFF) = GPDMA_CFCR_ALL;
+}
 
-    // Normal operation mode
-    tle_write(REG_OPMODE, 0x01u);
+void gpdma_block(uint32_t ch_base, uint32_t ctr1, uint32_t ctr2, uint32_t bytes,
+                 uint32_t src, uint32_t dst) noexcept {
+    gpdma_stop(ch_base);
+    GPDMA_REG(ch_base, GPDMA_CTR1_OFF) = ctr1;
+    GPDMA_REG(ch_base, GPDMA_CTR2_OFF) = ctr2 | GPDMA_CTR2_TCEM_BLOCK;
+    GPDMA_REG(ch_base, GPDMA_CBR1_OFF) = bytes;
+    GPDMA_REG(ch_base, GPDMA_CSAR_OFF) = src;
+    GPDMA_REG(ch_base, GPDMA_CDAR_OFF) = dst;
+    GPDMA_REG(ch_base, GPDMA_CTR3_OFF) = 0u;
+    GPDMA_REG(ch_base, GPDMA_CBR2_OFF) = 0u;
+    GPDMA_REG(ch_base, GPDMA_CLLR_OFF) = 0u;   // bloco único, sem LLI
+    GPDMA_REG(ch_base, GPDMA_CCR_OFF) = GPDMA_CCR_EN;
+}
 
+bool spi2_start(const uint16_t* tx, uint16_t* rx, uint8_t n) noexcept {
+    // CR2/CFG1 só são escritos com SPE=0. Ordem RM0481: RXDMAEN → canais →
+    // TXDMAEN → SPE → CSTART.
+    SPI2_CR1 = 0u;
+    SPI2_IFCR = SPI_IFCR_ALL;
+    SPI2_CR2 = n;  // TSIZE
+    SPI2_CFG1 = kSpi2Cfg1 | SPI_CFG1_RXDMAEN;
+    const uint32_t bytes = static_cast<uint32_t>(n) * 2u;
+    gpdma_block(GPDMA_CH2_BASE, GPDMA_CTR1_HALFWORD_TO_HALFWORD_INC_DEST,
+                GPDMA_CTR2_REQSEL_SPI2_RX, bytes,
+                reinterpret_cast<uint32_t>(&SPI2_RXDR), reinterpret_cast<uint32_t>(rx));
+    gpdma_block(GPDMA_CH3_BASE, GPDMA_CTR1_HALFWORD_INC_SRC_TO_HALFWORD,
+                GPDMA_CTR2_REQSEL_SPI2_TX | GPDMA_CTR2_DREQ, bytes,
+                reinterpret_cast<uint32_t>(tx), reinterpret_cast<uint32_t>(&SPI2_TXDR));
+    SPI2_CFG1 = kSpi2Cfg1 | SPI_CFG1_RXDMAEN | SPI_CFG1_TXDMAEN;
+    SPI2_CR1 = SPI_CR1_SPE;
+    SPI2_CR1 = SPI_CR1_SPE | SPI_CR1_CSTART;
     return true;
 }
 
-void decode_diag_pair(uint8_t reg_val, uint8_t base_ch) noexcept {
-    g_channel_faults[base_ch]     = reg_val & CH_FAULT_MASK;
-    g_channel_faults[base_ch + 1] = (reg_val >> 2u) & CH_FAULT_MASK;
+ems::hal::SpiXferPoll spi2_poll() noexcept {
+    constexpr uint32_t kDmaErr = GPDMA_CSR_DTEF | GPDMA_CSR_USEF;
+    if (((GPDMA_REG(GPDMA_CH2_BASE, GPDMA_CSR_OFF) |
+          GPDMA_REG(GPDMA_CH3_BASE, GPDMA_CSR_OFF)) & kDmaErr) != 0u) {
+        return ems::hal::SpiXferPoll::Error;
+    }
+    if ((SPI2_SR & SPI_SR_EOT) != 0u &&
+        (GPDMA_REG(GPDMA_CH2_BASE, GPDMA_CSR_OFF) & GPDMA_CSR_TCF) != 0u) {
+        return ems::hal::SpiXferPoll::Done;
+    }
+    return ems::hal::SpiXferPoll::Busy;
 }
 
-}  // namespace
+void spi2_idle() noexcept {
+    // SPE=0 também aborta um burst em curso (timeout).
+    SPI2_CR1 = 0u;
+    SPI2_IFCR = SPI_IFCR_ALL;
+    SPI2_CFG1 = kSpi2Cfg1;
+    gpdma_stop(GPDMA_CH2_BASE);
+    gpdma_stop(GPDMA_CH3_BASE);
+}
 
-namespace ems::hal {
+uint32_t spi2_now_us() noexcept { return micros(); }
 
-void tle8888_init() noexcept {
-    // 1. Clock enable SPI2
+const ems::hal::SpiJobIo kSpi2Io = {spi2_start, spi2_poll, spi2_idle, spi2_now_us};
+
+void spi2_hw_init() noexcept {
+    // 1. Clock enable SPI2 + GPDMA1 (já ligado pelo ADC; idempotente)
     RCC_APB1LENR |= RCC_APB1LENR_SPI2EN;
+    RCC_AHB1ENR |= RCC_AHB1ENR_GPDMA1EN;
     for (volatile int i = 0; i < 4; ++i) {}  // wait clock propagation
 
-    // 2. GPIO: PB12=CS (output), PB13=SCK (AF5), PB14=MISO (AF5), PB15=MOSI (AF5)
-    gpio_set_output(&GPIOB_MODER, &GPIOB_OSPEEDR, 12u);
-    cs_high();  // CS idle high
-
+    // 2. GPIO: PB12=NSS, PB13=SCK, PB14=MISO, PB15=MOSI — todos AF5
+    gpio_set_af(&GPIOB_MODER, &GPIOB_AFRL, &GPIOB_AFRH, &GPIOB_OSPEEDR, 12u, GPIO_AF5);
     gpio_set_af(&GPIOB_MODER, &GPIOB_AFRL, &GPIOB_AFRH, &GPIOB_OSPEEDR, 13u, GPIO_AF5);
     gpio_set_af(&GPIOB_MODER, &GPIOB_AFRL, &GPIOB_AFRH, &GPIOB_OSPEEDR, 14u, GPIO_AF5);
     gpio_set_af(&GPIOB_MODER, &GPIOB_AFRL, &GPIOB_AFRH, &GPIOB_OSPEEDR, 15u, GPIO_AF5);
 
-    // 3. SPI2 config: master, 16-bit, CPOL=0 CPHA=1, software CS
+    // 3. SPI2 config: master, 16-bit, CPOL=0 CPHA=1, NSS por hardware pulsado
+    //    entre frames (MIDI = 2 ciclos de idle, MSSI = 1 ciclo até ao 1.º clock).
     SPI2_CR1 = 0u;  // disable first
-    // CFG1: 16-bit data, prescaler = 32 → 125MHz/32 ≈ 3.9 MHz (< 5 MHz max)
-    SPI2_CFG1 = SPI_CFG1_DSIZE_16BIT | (4u << 28u);  // MBR=100b → /32
-    // CFG2: master, full-duplex, software SS management, CPHA=1
-    SPI2_CFG2 = SPI_CFG2_MASTER | SPI_CFG2_SSM | SPI_CFG2_CPHA
-              | SPI_CFG2_COMM_FULLDUPLEX;
-    // TSIZE=1 for single-frame transfers
-    SPI2_CR2 = 1u;
-    // Enable
-    SPI2_CR1 = SPI_CR1_SPE;
+    SPI2_CFG1 = kSpi2Cfg1;
+    SPI2_CFG2 = SPI_CFG2_MASTER | SPI_CFG2_SSOE | SPI_CFG2_SSOM | SPI_CFG2_CPHA
+              | SPI_CFG2_COMM_FULLDUPLEX | SPI_CFG2_MIDI(2u) | SPI_CFG2_MSSI(1u);
+}
 
-    // 4. Handshake: read chip ID
-    const uint8_t id = tle_read(REG_CHIP_ID);
-    g_tle_ok = (id == EXPECTED_CHIP_ID);
-    if (!g_tle_ok) {
-        ++g_fault_count;
-        return;
-    }
+}  // namespace
 
-    // 5. Configure channels: INJ low-side, IGN push-pull, OC thresholds, slew
-    g_tle_configured = configure_channels();
-    if (!g_tle_configured) {
-        ++g_fault_count;
+#endif  // TARGET_STM32H562
+
+namespace ems::hal {
+
+void tle8888_init() noexcept {
+#ifdef TARGET_STM32H562
+    spi2_hw_init();
+    spi_jobs_attach(&kSpi2Io);
+#else
+    if (spi_jobs_io() != tle8888_host_model_io()) {
+        tle8888_host_model_reset();  // chip saudável por omissão
+        spi_jobs_attach(tle8888_host_model_io());
     }
+#endif
+    g_op = TleOp::kIdle;
+    g_tle_ok = false;
+    g_tle_configured = false;
+
+    // Handshake: chip ID → (callback) configuração → modo normal.
+    submit_probe();
+    static_cast<void>(spi_jobs_drain(kBootDrainUs));
 }
 
 void tle8888_poll_diag() noexcept {
-    if (!g_tle_ok) {
-        const uint8_t id = tle_read(REG_CHIP_ID);
-        g_tle_ok = (id == EXPECTED_CHIP_ID);
-        if (!g_tle_ok) {
-            ++g_fault_count;
-            return;
-        }
-        if (!g_tle_configured) {
-            g_tle_configured = configure_channels();
-        }
+    if (g_op != TleOp::kIdle) {
+        ++g_busy_skips;  // lote anterior ainda em voo (chip lento / timeout)
+        return;
     }
-
-    // Per-channel diagnostics: INJ ch0-3 (regs 0x38-0x39), IGN ch0-3 (0x3A-0x3B)
-    decode_diag_pair(tle_read(REG_DIAG_OUT0), 0);  // INJ 0-1
-    decode_diag_pair(tle_read(REG_DIAG_OUT1), 2);  // INJ 2-3
-    decode_diag_pair(tle_read(REG_DIAG_OUT2), 4);  // IGN 0-1
-    decode_diag_pair(tle_read(REG_DIAG_OUT3), 6);  // IGN 2-3
-
-    bool any_fault = false;
-    for (uint8_t i = 0u; i < 8u; ++i) {
-        if (g_channel_faults[i] != 0u) { any_fault = true; break; }
+    if (!g_tle_ok) {
+        submit_probe();
+    } else if (!g_tle_configured) {
+        submit_config();
+    } else {
+        submit_diag();
     }
-    if (any_fault) { ++g_fault_count; }
-
-    tle_write(REG_WD_TRIG, 0x01u);
 }
 
 bool tle8888_ok() noexcept {
@@ -236,17 +387,126 @@ uint8_t tle8888_fault_bitmap() noexcept {
     return bm;
 }
 
+uint16_t tle8888_busy_skips() noexcept {
+    return g_busy_skips;
+}
+
 }  // namespace ems::hal
 
-#else  // host test stub
+#if defined(EMS_HOST_TEST)
+
+namespace {
+
+uint8_t  g_model_regs[128] = {};
+uint16_t g_model_last_resp = 0u;
+uint16_t g_model_rx_buf[ems::hal::kSpiJobMaxFrames] = {};
+uint16_t* g_model_rx   = nullptr;
+uint8_t  g_model_n     = 0u;
+uint32_t g_model_now_us     = 0u;
+uint32_t g_model_done_at_us = 0u;
+uint32_t g_model_frame_us   = 0u;
+bool     g_model_hang       = false;
+bool     g_model_miso_stuck = false;
+uint32_t g_model_frames     = 0u;
+uint32_t g_model_wd_triggers = 0u;
+
+bool model_read_only(uint8_t addr) noexcept {
+    return addr == REG_CHIP_ID || addr == REG_OP_STAT ||
+           (addr >= REG_DIAG_OUT0 && addr <= REG_DIAG_OUT3);
+}
+
+// Um frame: devolve a resposta ao frame anterior e executa o actual.
+uint16_t model_frame(uint16_t tx) noexcept {
+    ++g_model_frames;
+    const uint16_t out = g_model_miso_stuck ? 0xFFFFu : g_model_last_resp;
+    const uint8_t addr = static_cast<uint8_t>((tx >> 8u) & 0x7Fu);
+    if ((tx & TLE_READ) != 0u) {
+        g_model_last_resp = static_cast<uint16_t>((addr << 8u) | g_model_regs[addr]);
+    } else {
+        const uint8_t data = static_cast<uint8_t>(tx & 0xFFu);
+        if (addr == REG_WD_TRIG) {
+            ++g_model_wd_triggers;
+        } else if (!model_read_only(addr)) {
+            g_model_regs[addr] = data;
+        }
+        g_model_last_resp = static_cast<uint16_t>((addr << 8u) | data);
+    }
+    return out;
+}
+
+// Os frames correm no start; o rx só é publicado no buffer do job quando o
+// burst "termina" (n × frame_us), como o DMA no fim da transferência.
+bool model_start(const uint16_t* tx, uint16_t* rx, uint8_t n) {
+    for (uint8_t i = 0u; i < n; ++i) {
+        g_model_rx_buf[i] = model_frame(tx[i]);
+    }
+    g_model_rx = rx;
+    g_model_n = n;
+    g_model_done_at_us = g_model_now_us + g_model_frame_us * n;
+    return true;
+}
+
+ems::hal::SpiXferPoll model_poll() {
+    ++g_model_now_us;
+    if (g_model_hang || static_cast<int32_t>(g_model_done_at_us - g_model_now_us) > 0) {
+        return ems::hal::SpiXferPoll::Busy;
+    }
+    if (g_model_rx != nullptr) {
+        std::memcpy(g_model_rx, g_model_rx_buf, g_model_n * sizeof(uint16_t));
+    }
+    return ems::hal::SpiXferPoll::Done;
+}
+
+void model_idle() { g_model_rx = nullptr; }
+
+uint32_t model_now_us() { return g_model_now_us; }
+
+const ems::hal::SpiJobIo kModelIo = {model_start, model_poll, model_idle, model_now_us};
+
+}  // namespace
 
 namespace ems::hal {
-void tle8888_init() noexcept {}
-void tle8888_poll_diag() noexcept {}
-bool tle8888_ok() noexcept { return true; }
-uint16_t tle8888_fault_count() noexcept { return 0u; }
-uint8_t tle8888_channel_fault(uint8_t) noexcept { return 0u; }
-uint8_t tle8888_fault_bitmap() noexcept { return 0u; }
+
+const SpiJobIo* tle8888_host_model_io() noexcept { return &kModelIo; }
+
+void tle8888_host_model_reset() noexcept {
+    std::memset(g_model_regs, 0, sizeof(g_model_regs));
+    g_model_regs[REG_CHIP_ID] = static_cast<uint8_t>(EXPECTED_CHIP_ID);
+    g_model_last_resp   = 0u;
+    g_model_rx          = nullptr;
+    g_model_done_at_us  = g_model_now_us;
+    g_model_frame_us    = 0u;
+    g_model_hang        = false;
+    g_model_miso_stuck  = false;
+    g_model_frames      = 0u;
+    g_model_wd_triggers = 0u;
 }
 
-#endif
+uint8_t tle8888_host_model_reg(uint8_t addr) noexcept {
+    return g_model_regs[addr & 0x7Fu];
+}
+
+void tle8888_host_model_set_reg(uint8_t addr, uint8_t value) noexcept {
+    g_model_regs[addr & 0x7Fu] = value;
+}
+
+void tle8888_host_model_set_frame_us(uint32_t frame_us) noexcept { g_model_frame_us = frame_us; }
+void tle8888_host_model_set_hang(bool hang) noexcept { g_model_hang = hang; }
+void tle8888_host_model_set_miso_stuck(bool stuck) noexcept { g_model_miso_stuck = stuck; }
+void tle8888_host_model_advance_us(uint32_t dt_us) noexcept { g_model_now_us += dt_us; }
+uint32_t tle8888_host_model_frames() noexcept { return g_model_frames; }
+uint32_t tle8888_host_model_wd_triggers() noexcept { return g_model_wd_triggers; }
+
+void tle8888_test_reset() noexcept {
+    spi_jobs_test_reset();
+    g_op = TleOp::kIdle;
+    g_tle_ok = false;
+    g_tle_configured = false;
+    g_fault_count = 0u;
+    g_busy_skips = 0u;
+    for (uint8_t i = 0u; i < 8u; ++i) { g_channel_faults[i] = 0u; }
+}
+
+}  // namespace ems::hal
+
+#endif  // EMS_HOST_TEST
@@ -1,9 +1,15 @@
 #pragma once
 #include <cstdint>
 
+#include "hal/spi_jobs.h"
+
 namespace ems::hal {
 
+// Boot: probe + configuração com espera limitada (fila SPI drenada aqui).
 void tle8888_init() noexcept;
+// Main loop (100 ms): só enfileira — re-probe/configuração se o chip caiu,
+// senão leitura dos 4 registos de diag + trigger do watchdog. Resultado
+// chega por callback em spi_jobs_step(); com um lote ainda em voo não faz nada.
 void tle8888_poll_diag() noexcept;
 bool tle8888_ok() noexcept;
 uint16_t tle8888_fault_count() noexcept;
@@ -11,5 +17,28 @@ uint16_t tle8888_fault_count() noexcept;
 uint8_t tle8888_channel_fault(uint8_t ch) noexcept;
 // Bitmap: bit N set = channel N has a fault
 uint8_t tle8888_fault_bitmap() noexcept;
+// Polls a 100 ms ignorados porque o lote anterior ainda não tinha concluído.
+uint16_t tle8888_busy_skips() noexcept;
+
+#if defined(EMS_HOST_TEST)
+// ── Modelo host do TLE8888 (mapa de registos) ───────────────────────────────
+// Frame 16 bits: [15]=R/W (1=read), [14:8]=endereço, [7:0]=dado. A resposta
+// a um frame sai no frame seguinte (pipeline de 1 frame, como no chip):
+// [14:8]=endereço do comando anterior, [7:0]=valor lido/escrito.
+// Registos de estado/diag (0x34, 0x38-0x3B) e o chip ID só mudam pelo teste;
+// escrita em WD_TRIG conta um trigger. Cada poll avança o relógio 1 µs; o
+// burst conclui após n × frame_us.
+const SpiJobIo* tle8888_host_model_io() noexcept;
+void     tle8888_host_model_reset() noexcept;   // ID 0x88, regs a 0, sem latência
+uint8_t  tle8888_host_model_reg(uint8_t addr) noexcept;
+void     tle8888_host_model_set_reg(uint8_t addr, uint8_t value) noexcept;
+void     tle8888_host_model_set_frame_us(uint32_t frame_us) noexcept;
+void     tle8888_host_model_set_hang(bool hang) noexcept;        // EOT nunca chega
+void     tle8888_host_model_set_miso_stuck(bool stuck) noexcept;  // lê 0xFFFF
+void     tle8888_host_model_advance_us(uint32_t dt_us) noexcept;
+uint32_t tle8888_host_model_frames() noexcept;
+uint32_t tle8888_host_model_wd_triggers() noexcept;
+void     tle8888_test_reset() noexcept;   // estado do driver (sem tocar no modelo)
+#endif
 
 }  // namespace ems::hal
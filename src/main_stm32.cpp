@@ -31,24 +31,31 @@ int main() { return 0; }
 #include "hal/uart.h"
 
 #include "app/can_stack.h"
+#include "app/can_fd_telemetry.h"
 #include "app/can_rx_map.h"
+#include "app/loop_sched.h"
 #include "app/nvm_boot.h"
 #include "app/ui_protocol.h"
 #include "drv/ckp.h"
 #include "drv/sensors.h"
+#include "drv/tooth_geom.h"
 #include "engine/auxiliaries.h"
 #include "engine/calibration.h"
 #include "engine/constants.h"
 #include "engine/cut_reason.h"
+#include "engine/cyl_pulse.h"
 #include "engine/vehicle_inputs.h"
 #include "engine/ecu_sched.h"
 #include "engine/engine_config.h"
 #include "engine/etb_control.h"
 #include "engine/etb_autocal.h"
+#include "engine/etb_loop.h"
 #include "hal/etb_driver.h"
 #include "engine/fuel_calc.h"
+#include "engine/fuel_pw_kernel.h"
 #include "engine/ign_calc.h"
 #include "engine/knock.h"
+#include "engine/knock_learn.h"
 #include "engine/map_estimator.h"
 #include "engine/output_test.h"
 #include "engine/diagnostic_manager.h"
@@ -62,6 +69,8 @@ int main() { return 0; }
 #include "hal/adc.h"
 #include "hal/can.h"
 #include "hal/flash.h"
+#include "hal/flash_jobs.h"
+#include "hal/spi_jobs.h"
 #include "hal/tle8888.h"
 #include "hal/flex_fuel.h"
 #include "hal/runtime_seed.h"
@@ -80,6 +89,134 @@ static bool                g_calib_dirty  = false;
 volatile uint32_t g_datalog_us = 0u;
 volatile uint32_t g_flash_write_faults = 0u; // FIX: fault counter para falhas de escrita NVM
 
+// Conclusão do burn de page0 (fila de flash, main loop): falha volta a
+// marcar dirty — o slot de 500 ms re-tenta após kCalibSaveMinIntervalMs.
+static void calib_page0_burn_done(void*, bool ok) noexcept {
+    if (!ok) {
+        g_calib_dirty = true;
+        ++g_flash_write_faults;
+    }
+}
+
+// Page0 → globals do engine/drivers. Boot e após um rollback do page0 (a
+// cópia activa na flash mudou por baixo de g_calib_page0).
+static void calib_page0_apply() noexcept {
+	ems::engine::cfg::engine_config_load(g_calib_page0, kCalibPageBytes);
+	ems::engine::map_estimator_sync_engine_config();  // displacement → MAP model
+	// Calibração de sensores persistida (página 0, bytes 16-55) → drivers
+	ems::engine::apply_etb_calibration_from_page(g_calib_page0 + 16, 40u);
+	ems::engine::push_sensor_calibration_to_drivers();
+	// Closed-loop / LEARN (page0[80-85])
+	ems::engine::closed_loop_enable =
+	    (g_calib_page0[80] != 0u) ? 1u : 0u;
+	ems::engine::ltft_apply_burn_ve = (g_calib_page0[81] != 0u) ? 1u : 0u;
+	std::memcpy(&ems::engine::closed_loop_post_start_s, g_calib_page0 + 82, 2u);
+	std::memcpy(&ems::engine::ltft_adapt_min_rpm_x10,   g_calib_page0 + 84, 2u);
+	// Authority LTFT (176-184) só se layout version actual — blob v2 tem lixo/zeros.
+	if (g_calib_page0[ems::engine::kCalLayoutVersionOffset] ==
+	    ems::engine::kCalLayoutVersion) {
+		// EOI blend (164-168): idle EOI + janela RPM lo/hi. Serialize grava
+		// sempre os globals vivos aqui, então página na versão actual tem
+		// valores válidos; hi<=lo = blend off (honrado). Mesmo clamp do
+		// handler de escrita (eoi_idle_deg ∈ [0,719]).
+		std::memcpy(&ems::engine::eoi_idle_deg,     g_calib_page0 + 164, 2u);
+		std::memcpy(&ems::engine::eoi_blend_rpm_lo, g_calib_page0 + 166, 2u);
+		std::memcpy(&ems::engine::eoi_blend_rpm_hi, g_calib_page0 + 168, 2u);
+		if (ems::engine::eoi_idle_deg > 719u) { ems::engine::eoi_idle_deg = 719u; }
+		uint16_t mult_c = 0u, add_c = 0u, max_s = 0u;
+		std::memcpy(&mult_c, g_calib_page0 + 176, 2u);
+		std::memcpy(&add_c,  g_calib_page0 + 178, 2u);
+		std::memcpy(&max_s,  g_calib_page0 + 182, 2u);
+		if (mult_c != 0u) { ems::engine::ltft_mult_clamp_pct_x10 = mult_c; }
+		if (add_c  != 0u) { ems::engine::ltft_add_clamp_us = add_c; }
+		if (g_calib_page0[180] != 0u) { ems::engine::ltft_learn_div = g_calib_page0[180]; }
+		if (g_calib_page0[181] != 0u) { ems::engine::ltft_commit_gain_pct = g_calib_page0[181]; }
+		ems::engine::ltft_max_step_x10 = max_s;
+		if (g_calib_page0[184] <= 1u) {
+			ems::engine::ltft_adapt_enable = g_calib_page0[184];
+		}
+		{
+			uint16_t hits = 0u;
+			std::memcpy(&hits, g_calib_page0 + 185, 2u);
+			if (hits != 0u) { ems::engine::ltft_learn_ready_hits = hits; }
+			if (g_calib_page0[187] != 0u) {
+				ems::engine::ltft_learn_max_err_x1000 = g_calib_page0[187];
+			}
+			if (g_calib_page0[188] != 0u) {
+				ems::engine::ltft_learn_ready_max_mean_err = g_calib_page0[188];
+			}
+			if (g_calib_page0[189] != 0u) {
+				ems::engine::ltft_learn_ready_min_stft_x10 = g_calib_page0[189];
+			}
+			if (g_calib_page0[190] != 0u) {
+				ems::engine::ltft_learn_ready_max_stft_x10 = g_calib_page0[190];
+			}
+		}
+		// Launch + TC knobs (page0 191-215, layout v5)
+		ems::engine::launch_tc_apply_from_page0(g_calib_page0, kCalibPageBytes);
+		// CAN RX map: gear / vehicle / driven wheel (216-245)
+		ems::app::can_rx_map_apply_from_page0(g_calib_page0, kCalibPageBytes);
+		// CKP skip pós-silêncio (byte 71, era pad — blob antigo = 0 = off)
+		ems::engine::ckp_skip_pulses_after_gap =
+		    (g_calib_page0[71] > 57u) ? 57u : g_calib_page0[71];
+		// MAP janela angular (246-251); len=0 não substitui o default
+		ems::engine::map_window_enable = (g_calib_page0[246] != 0u) ? 1u : 0u;
+		// Ganho do balance por cilindro (247, era pad — blob antigo = 0 = off)
+		ems::engine::map_balance_gain_pct =
+		    (g_calib_page0[247] > 100u) ? 100u : g_calib_page0[247];
+		{
+			uint16_t od = 0u, wl = 0u;
+			std::memcpy(&od, g_calib_page0 + 248, 2u);
+			std::memcpy(&wl, g_calib_page0 + 250, 2u);
+			ems::engine::map_window_open_deg =
+			    (od >= 720u) ? static_cast<uint16_t>(od % 720u) : od;
+			if (wl != 0u) {
+				ems::engine::map_window_len_deg =
+				    (wl < 10u) ? 10u : (wl > 180u) ? 180u : wl;
+			}
+		}
+		// Protecção de duty INJ + gates DFCO + knock morto (252-257);
+		// blob antigo = zeros = tudo off (tol=0 mantém default 300 ms).
+		ems::engine::inj_duty_max_pct = g_calib_page0[252];
+		if (g_calib_page0[253] != 0u) {
+			ems::engine::inj_duty_tol_ms10 = g_calib_page0[253];
+		}
+		std::memcpy(&ems::engine::decel_cut_map_max_bar_x100,
+		            g_calib_page0 + 254, 2u);
+		ems::engine::decel_cut_gear_inhibit_ms10 = g_calib_page0[256];
+		ems::engine::knock_dead_min_p2p = g_calib_page0[257];
+		// Telemetria CAN FD (258); blob antigo = 0 = clássico
+		ems::engine::can_fd_telemetry_enable = (g_calib_page0[258] != 0u) ? 1u : 0u;
+		// Knock DSP em banda (259-261); blob antigo = 0 = contagem legada
+		ems::engine::knock_intensity_thr_x10 = g_calib_page0[259];
+		std::memcpy(&ems::engine::knock_band_hz, g_calib_page0 + 260, 2u);
+		// Predição de MAP ao IVC (270-272); blob antigo = 0 = off / IVC default
+		ems::engine::map_pred_gain_pct =
+		    (g_calib_page0[270] > 100u) ? 100u : g_calib_page0[270];
+		{
+			uint16_t ivc = 0u;
+			std::memcpy(&ivc, g_calib_page0 + 271, 2u);
+			if (ivc != 0u) {
+				ems::engine::map_pred_ivc_btdc_deg = (ivc > 719u) ? 719u : ivc;
+			}
+		}
+		// Malha de posição ETB (273-274); blob antigo = 0 = PID no main loop
+		std::memcpy(&ems::engine::etb_loop_rate_hz, g_calib_page0 + 273, 2u);
+		// Mapa aprendido de knock (275-276); blob antigo = 0 = desligado
+		ems::engine::knock_learn_step_x10 = g_calib_page0[275];
+		ems::engine::knock_learn_max_x10 =
+		    (g_calib_page0[276] > 127u) ? 127u : g_calib_page0[276];
+		// Misfire por cinemática (277-310); blob antigo = 0 = detector legado
+		ems::engine::misfire_accel_enable = (g_calib_page0[277] != 0u) ? 1u : 0u;
+		ems::engine::misfire_rough_ratio_pct = g_calib_page0[278];
+		std::memcpy(ems::engine::misfire_thr_rad_s2, g_calib_page0 + 279,
+		            sizeof(ems::engine::misfire_thr_rad_s2));
+		ems::engine::tooth_geom_enable = (g_calib_page0[311] != 0u) ? 1u : 0u;
+		std::memcpy(ems::engine::diag_freeze_vars, g_calib_page0 + 312,
+		            sizeof(ems::engine::diag_freeze_vars));
+	}
+}
+
 
 static int8_t  g_last_advance_deg = 0;
 // Spark retard from torque manager (TC/launch), updated in 2 ms ETB slot.
@@ -116,6 +253,9 @@ static bool g_runtime_seed_saved_for_stop = false;
 static bool g_runtime_seed_arm_window_active = false;
 static bool     g_ae_active        = false;
 static uint32_t g_last_net_pw_us   = 0u;
+// Carga em que o spark_table (e o mapa aprendido de knock) foi lido no último
+// slot: (1) MAP previsto ao IVC, (3) MAP actual. 0 = ainda sem avanço calculado.
+static uint16_t g_spark_load_bar_x100 = 0u;
 // Barometric correction: amostrar MAP quando motor parado por >300ms após key-on
 static uint32_t g_baro_stopped_since_ms = 0u;
 static bool     g_baro_sampled          = false;
@@ -144,6 +284,7 @@ static constexpr uint16_t kAePeriodMs = 2u;
 // =============================================================================
 
 static bool g_etb_initialized = false;
+static uint16_t g_etb_loop_rate_applied = 0u;   // etb_loop_rate_hz em vigor
 
 // =============================================================================
 // Utilitários
@@ -177,6 +318,17 @@ static inline uint16_t build_status_bits(const ems::drv::CkpSnapshot& snap,
     return status;
 }
 
+// Ângulo do motor (° no ciclo de 720°, 0 = PMS do cil. 0) no último dente:
+// inverso de engine_angle_to_trigger_angle do scheduler. Só em FULL_SYNC.
+static inline uint16_t engine_deg_at_tooth(const ems::drv::CkpSnapshot& snap) noexcept {
+    const ems::drv::TriggerWheel& w = ems::drv::ckp_wheel();
+    const uint8_t ti = (snap.tooth_index < w.real_teeth)
+        ? static_cast<uint8_t>(snap.tooth_index) : 0u;
+    const uint32_t trig_deg = (snap.phase_A ? 0u : 360u) + w.tooth_deg_x10[ti] / 10u;
+    return static_cast<uint16_t>(
+        (trig_deg + ems::engine::cfg::g_eng_cfg.trigger_tooth0_engine_deg) % 720u);
+}
+
 using ems::engine::clamp_u16;
 using ems::engine::clamp_i16;
 
@@ -229,11 +381,14 @@ static inline void comms_pump() noexcept {
     // garantia esse gluing; a 2 ms cada comando é respondido a tempo, como nas
     // implementações de referência (Speeduino/rusEFI: request→resposta→flush
     // sub-ms). Nada aqui bloqueia (drena TX só com espaço no FIFO/rings).
+    //
+    // Uma sessão de protocolo por transporte (UiPort): cada uma tem o seu
+    // parser e TX — o USB já não fica limitado ao orçamento da UART.
     ems::hal::uart0_poll_rx(32u);
     {
         uint8_t b = 0u;
         while (ems::hal::uart0_rx_pop(b)) {
-            ems::app::ui_rx_byte(b);
+            ems::app::ui_rx_byte(ems::app::UiPort::kUart, b);
         }
     }
     ems::hal::usb_cdc_poll();
@@ -241,27 +396,37 @@ static inline void comms_pump() noexcept {
         uint8_t rx_buf[64] = {};
         const uint16_t rx_n = ems::hal::usb_cdc_read_bytes(rx_buf, 64u);
         for (uint16_t i = 0u; i < rx_n; ++i) {
-            ems::app::ui_rx_byte(rx_buf[i]);
+            ems::app::ui_rx_byte(ems::app::UiPort::kUsb, rx_buf[i]);
         }
     }
     ems::app::ui_process();
 
-    // Drena ui_tx → UART + USB (espelhado), limitado pelo MENOR espaço livre
-    // entre os dois rings de destino — usb_cdc_send_bytes() descarta bytes
-    // em silêncio se o seu próprio ring encher, então o orçamento tem de
-    // respeitar ambos, não só o do UART, para nunca perder bytes de um frame.
-    uint16_t budget = ems::hal::uart0_tx_free();
-    const uint16_t usb_free = ems::hal::usb_cdc_tx_free();
-    if (usb_free < budget) { budget = usb_free; }
-    if (budget > 32u) { budget = 32u; }
-    uint8_t tx_buf[32] = {};
-    uint16_t tx_n = 0u;
-    while (tx_n < budget && ems::app::ui_tx_pop(tx_buf[tx_n])) { ++tx_n; }
-    if (tx_n != 0u) {
+    // UART: orçamento pelo FIFO de software da UART (≈ 23 B por 2 ms a 115200).
+    {
+        uint16_t budget = ems::hal::uart0_tx_free();
+        if (budget > 32u) { budget = 32u; }
+        uint8_t tx_buf[32] = {};
+        const uint16_t tx_n =
+            ems::app::ui_tx_pop_bytes(ems::app::UiPort::kUart, tx_buf, budget);
         for (uint16_t i = 0u; i < tx_n; ++i) {
             ems::hal::uart0_tx_push(tx_buf[i]);
         }
-        ems::hal::usb_cdc_send_bytes(tx_buf, tx_n);
+    }
+    // USB: tudo o que cabe no ring do CDC (usb_cdc_send_bytes descarta o que
+    // não couber — nunca exceder tx_free). Sem host (DTR=0) a sessão USB
+    // retém o TX; o ring da sessão limita o acumulado.
+    if (ems::hal::usb_cdc_dtr()) {
+        uint16_t budget = ems::hal::usb_cdc_tx_free();
+        uint8_t tx_buf[128] = {};
+        while (budget != 0u) {
+            const uint16_t chunk = (budget > sizeof(tx_buf))
+                ? static_cast<uint16_t>(sizeof(tx_buf)) : budget;
+            const uint16_t tx_n =
+                ems::app::ui_tx_pop_bytes(ems::app::UiPort::kUsb, tx_buf, chunk);
+            if (tx_n == 0u) { break; }
+            ems::hal::usb_cdc_send_bytes(tx_buf, tx_n);
+            budget = static_cast<uint16_t>(budget - tx_n);
+        }
     }
     ems::hal::uart0_tx_poll_nb(16u);
 }
@@ -437,12 +602,17 @@ static void openems_init() noexcept {
     // 1) PLL → 250 MHz + SysTick 1ms + IWDG 100ms
     system_stm32_init();
 
+    // DWT CYCCNT livre: perfil do kernel de PW em ciclos reais (dump 'D').
+    DEMCR |= DEMCR_TRCENA;
+    DWT_CYCCNT = 0u;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+
     // 1a) CRITICAL: INJ/IGN LOW before any delay.
     // PA15 resets as JTDI with pull-up → HIGH → injectors on (active-high).
     // PC10/11 float; external pull-ups can also pull INJ high.
     // Must run before the USB 300 ms wait (was: ECU_Hardware_Init after that).
     ::ecu_sched_outputs_safe_early();
-    ::ecu_sched_set_inj_inhibit_mask(0x0Fu);
+    ::ecu_sched_set_inj_inhibit_mask(ECU_CYL_MASK_ALL);
     ::ecu_sched_set_inj_pw_ticks(0u);
 
     // 1b) Reabilitar IRQs globais EXPLICITAMENTE. O Reset_Handler faz cpsid i e nunca
@@ -478,13 +648,14 @@ static void openems_init() noexcept {
     // BSS (zero), mas 0 é um índice de cilindro válido — o ISR do CKP leria cyl=0
     // para todos os dentes antes da tabela ser preenchida, gerando DTCs falsos.
     ems::engine::misfire_init();
+    ems::drv::tooth_geom_init();
     ems::hal::tim5_ic_init();   // → TIM5 input capture (CKP + CMP)
     iwdg_kick();
 
     // 2a) Scheduler unificado (re-asserts pin safe + clears event queue)
     ::ECU_Hardware_Init();
     ::ecu_sched_set_presync_inj_auto(1u);  // auto-select SIMULTANEOUS/SEMI_SEQUENTIAL by cranking
-    ::ecu_sched_set_inj_inhibit_mask(0x0Fu);
+    ::ecu_sched_set_inj_inhibit_mask(ECU_CYL_MASK_ALL);
     ::ecu_sched_set_inj_pw_ticks(0u);
     iwdg_kick();
 
@@ -506,88 +677,7 @@ static void openems_init() noexcept {
 	if (!ems::hal::nvm_load_calibration(0u, g_calib_page0, kCalibPageBytes)) {
 		++g_flash_write_faults; // FIX: rastrear falha de leitura NVM
 	}
-	ems::engine::cfg::engine_config_load(g_calib_page0, kCalibPageBytes);
-	ems::engine::map_estimator_sync_engine_config();  // displacement → MAP model
-	// Calibração de sensores persistida (página 0, bytes 16-55) → drivers
-	ems::engine::apply_etb_calibration_from_page(g_calib_page0 + 16, 40u);
-	ems::engine::push_sensor_calibration_to_drivers();
-	// Closed-loop / LEARN (page0[80-85])
-	ems::engine::closed_loop_enable =
-	    (g_calib_page0[80] != 0u) ? 1u : 0u;
-	ems::engine::ltft_apply_burn_ve = (g_calib_page0[81] != 0u) ? 1u : 0u;
-	std::memcpy(&ems::engine::closed_loop_post_start_s, g_calib_page0 + 82, 2u);
-	std::memcpy(&ems::engine::ltft_adapt_min_rpm_x10,   g_calib_page0 + 84, 2u);
-	// Authority LTFT (176-184) só se layout version actual — blob v2 tem lixo/zeros.
-	if (g_calib_page0[ems::engine::kCalLayoutVersionOffset] ==
-	    ems::engine::kCalLayoutVersion) {
-		// EOI blend (164-168): idle EOI + janela RPM lo/hi. Serialize grava
-		// sempre os globals vivos aqui, então página na versão actual tem
-		// valores válidos; hi<=lo = blend off (honrado). Mesmo clamp do
-		// handler de escrita (eoi_idle_deg ∈ [0,719]).
-		std::memcpy(&ems::engine::eoi_idle_deg,     g_calib_page0 + 164, 2u);
-		std::memcpy(&ems::engine::eoi_blend_rpm_lo, g_calib_page0 + 166, 2u);
-		std::memcpy(&ems::engine::eoi_blend_rpm_hi, g_calib_page0 + 168, 2u);
-		if (ems::engine::eoi_idle_deg > 719u) { ems::engine::eoi_idle_deg = 719u; }
-		uint16_t mult_c = 0u, add_c = 0u, max_s = 0u;
-		std::memcpy(&mult_c, g_calib_page0 + 176, 2u);
-		std::memcpy(&add_c,  g_calib_page0 + 178, 2u);
-		std::memcpy(&max_s,  g_calib_page0 + 182, 2u);
-		if (mult_c != 0u) { ems::engine::ltft_mult_clamp_pct_x10 = mult_c; }
-		if (add_c  != 0u) { ems::engine::ltft_add_clamp_us = add_c; }
-		if (g_calib_page0[180] != 0u) { ems::engine::ltft_learn_div = g_calib_page0[180]; }
-		if (g_calib_page0[181] != 0u) { ems::engine::ltft_commit_gain_pct = g_calib_page0[181]; }
-		ems::engine::ltft_max_step_x10 = max_s;
-		if (g_calib_page0[184] <= 1u) {
-			ems::engine::ltft_adapt_enable = g_calib_page0[184];
-		}
-		{
-			uint16_t hits = 0u;
-			std::memcpy(&hits, g_calib_page0 + 185, 2u);
-			if (hits != 0u) { ems::engine::ltft_learn_ready_hits = hits; }
-			if (g_calib_page0[187] != 0u) {
-				ems::engine::ltft_learn_max_err_x1000 = g_calib_page0[187];
-			}
-			if (g_calib_page0[188] != 0u) {
-				ems::engine::ltft_learn_ready_max_mean_err = g_calib_page0[188];
-			}
-			if (g_calib_page0[189] != 0u) {
-				ems::engine::ltft_learn_ready_min_stft_x10 = g_calib_page0[189];
-			}
-			if (g_calib_page0[190] != 0u) {
-				ems::engine::ltft_learn_ready_max_stft_x10 = g_calib_page0[190];
-			}
-		}
-		// Launch + TC knobs (page0 191-215, layout v5)
-		ems::engine::launch_tc_apply_from_page0(g_calib_page0, kCalibPageBytes);
-		// CAN RX map: gear / vehicle / driven wheel (216-245)
-		ems::app::can_rx_map_apply_from_page0(g_calib_page0, kCalibPageBytes);
-		// CKP skip pós-silêncio (byte 71, era pad — blob antigo = 0 = off)
-		ems::engine::ckp_skip_pulses_after_gap =
-		    (g_calib_page0[71] > 57u) ? 57u : g_calib_page0[71];
-		// MAP janela angular (246-251); len=0 não substitui o default
-		ems::engine::map_window_enable = (g_calib_page0[246] != 0u) ? 1u : 0u;
-		{
-			uint16_t od = 0u, wl = 0u;
-			std::memcpy(&od, g_calib_page0 + 248, 2u);
-			std::memcpy(&wl, g_calib_page0 + 250, 2u);
-			ems::engine::map_window_open_deg =
-			    (od >= 720u) ? static_cast<uint16_t>(od % 720u) : od;
-			if (wl != 0u) {
-				ems::engine::map_window_len_deg =
-				    (wl < 10u) ? 10u : (wl > 180u) ? 180u : wl;
-			}
-		}
-		// Protecção de duty INJ + gates DFCO + knock morto (252-257);
-		// blob antigo = zeros = tudo off (tol=0 mantém default 300 ms).
-		ems::engine::inj_duty_max_pct = g_calib_page0[252];
-		if (g_calib_page0[253] != 0u) {
-			ems::engine::inj_duty_tol_ms10 = g_calib_page0[253];
-		}
-		std::memcpy(&ems::engine::decel_cut_map_max_bar_x100,
-		            g_calib_page0 + 254, 2u);
-		ems::engine::decel_cut_gear_inhibit_ms10 = g_calib_page0[256];
-		ems::engine::knock_dead_min_p2p = g_calib_page0[257];
-	}
+	calib_page0_apply();
 	// Gate de layout: páginas de tabela só carregam se a versão gravada no
 	// page0 (byte 175) bater com o firmware — um blob de dimensão antiga
 	// lido com o tamanho novo ganharia cauda 0xFF (VE=255!). Sem versão →
@@ -629,6 +719,10 @@ static void openems_init() noexcept {
     // pulada se harness ausente; falha mantém a calibração de flash).
     if (g_etb_initialized) {
         ems::engine::etb_autocal_start();
+        // Malha de posição na ISR do TIM7 (arranca em Release: a auto-cal
+        // conduz a ponte até concluir).
+        g_etb_loop_rate_applied = ems::engine::etb_loop_rate_hz;
+        ems::engine::etb_loop_init(g_etb_loop_rate_applied);
     }
     torque_manager_init();
     iwdg_kick();
@@ -637,12 +731,14 @@ static void openems_init() noexcept {
     ems::engine::fuel_reset_adaptives();
     ems::engine::auxiliaries_init();
     ems::engine::knock_init();
+    ems::engine::knock_learn_init();
     ems::engine::quick_crank_reset();
     iwdg_kick();
 
     // 8) Aplicação
     ems::app::ui_init();
     ems::app::can_stack_init(ems::engine::wbo2_can_id);
+    ems::app::can_fd_telemetry_init();
 
     // 9) NVIC — CKP fica com prioridade máxima. Injeção/ignição em TIM2/TIM1
     //    usam output compare direto por hardware, sem ISR no caminho crítico.
@@ -673,797 +769,969 @@ static void openems_init() noexcept {
 
 
 // =============================================================================
-// main() — substituição do setup()/loop() do STM32 runtime
+// Tarefas do main loop — período/prioridade/orçamento em kLoopTasks (main)
 // =============================================================================
 
-int main() {
-    openems_init();
-
-    uint32_t g_t2ms_   = millis();
-    uint32_t g_t10ms_  = g_t2ms_;
-    uint32_t g_t20ms_  = g_t2ms_;
-    uint32_t g_t50ms_  = g_t2ms_;
-    uint32_t g_t100ms_ = g_t2ms_;
-    uint32_t g_t500ms_ = g_t2ms_;
-    uint32_t g_t_etb_ms = g_t2ms_;
-    uint32_t g_t_comms_ms = g_t2ms_;
-
-    // Estreitar IWDG de 10s (boot) para 100ms (runtime): o main loop kica a cada
-    // ciclo; 100ms detecta travamento de runtime sem tolerar os inits longos do boot.
-    // Nota: IWDG_PR segue /256 (boot) → RLR=99 dá ~0.8s efetivo; suficiente p/ runtime
-    // e evita esperar PVU/RVU de novo no caminho crítico.
-    IWDG_KR  = IWDG_KR_ACCESS;
-    IWDG_RLR = IWDG_RLR_100MS;
-    IWDG_KR  = IWDG_KR_REFRESH;
+// 2 ms: fuel + ign recalc + commit calibration.
+static void task_fuel_ign_2ms(uint32_t now) noexcept {
+    const uint32_t loop2ms_start_us = micros();
+
+    // Stall watchdog: detecta virabrequim parado entre dentes.
+    // Deve preceder ckp_snapshot() para que o snapshot deste ciclo
+    // já reflicta LOSS_OF_SYNC se o motor parou.
+    // Reactivado: os falsos stalls vinham do wrap 16-bit do TIM3;
+    // desde a migração para TIM5 (32-bit) o elapsed é correcto.
+    // Também decai rpm_x10 fantasma de ruído em CKP sem sync.
+    ems::drv::ckp_stall_poll(ems::hal::tim5_count());
+
+    // Dwell / injector open watchdogs (lost SPARK / lost INJ_OFF).
+    ecu_sched_dwell_watchdog();
+    ecu_sched_inj_watchdog();
+
+    const auto snap    = ems::drv::ckp_snapshot();
+    const auto sensors = ems::drv::sensors_get();
+
+    // Teste de saídas em bancada: aborto imediato se RPM > 0 e
+    // timeout de keepalive (o dwell watchdog acima continua activo).
+    ems::engine::output_test_poll(now, snap.rpm_x10);
+    const bool full_sync = (snap.state == ems::drv::SyncState::FULL_SYNC);
+    const bool sched_sync = (snap.state == ems::drv::SyncState::HALF_SYNC || full_sync);
+
+    if (g_runtime_seed_arm_window_active) {
+        if (elapsed(now, g_runtime_seed_arm_window_start_ms,
+                    kRuntimeSeedArmWindowMs)) {
+            ems::drv::ckp_seed_disarm();
+            g_runtime_seed_arm_window_active = false;
+        }
+    }
 
-    for (;;) {
-        // ── Watchdog kick (primeiro statement) ───────────────────────────
-        iwdg_kick();
-        g_datalog_us = micros();
+    if (full_sync) {
+        g_have_last_full_sync = true;
+        g_last_full_sync_snapshot = snap;
+    }
+    if (sched_sync && snap.tooth_index == 0u) {
+        g_have_last_gap_sync = true;
+        g_last_gap_sync_snapshot = snap;
+    }
 
-        const uint32_t now = millis();
+    const bool map_fault = (sensors.fault_bits & kFaultBitMap) != 0u;
+    const uint16_t map_bar_x100_raw = static_cast<uint16_t>(sensors.map_bar_x1000 / 10u);
+    const uint16_t map_bar_x100_sensor = clamp_u16(map_bar_x100_raw, kMapMinBarX100, kMapMaxBarX100);
+    // Throttle signal for manifold model: ETB blade if harness present, else APP.
+    const uint16_t tps_for_map = (ems::engine::etb_harness_present != 0u)
+        ? sensors.etb_tps_pct_x10
+        : sensors.app_pct_x10;
+    // Fusion: sensor_valid=false on MAP fault so fallback 1 bar is not trusted.
+    const uint16_t map_bar_x100 = ems::engine::map_estimator_update(
+        map_bar_x100_sensor,
+        tps_for_map,
+        kAePeriodMs,
+        snap.rpm_x10,
+        sensors.iat_degc_x10,
+        !map_fault);
+    // Variáveis vivas para o freeze frame dos DTCs (capturadas no report).
+    {
+        using ems::engine::DiagnosticManager;
+        using ems::engine::FreezeVar;
+        DiagnosticManager::set_live_value(
+            FreezeVar::RPM_X10,
+            static_cast<uint16_t>((snap.rpm_x10 > 0xFFFFu) ? 0xFFFFu : snap.rpm_x10));
+        DiagnosticManager::set_live_value(FreezeVar::MAP_BAR_X100, map_bar_x100);
+        DiagnosticManager::set_live_value(FreezeVar::TPS_PCT_X10, tps_for_map);
+        DiagnosticManager::set_live_value(FreezeVar::APP_PCT_X10, sensors.app_pct_x10);
+        DiagnosticManager::set_live_value(FreezeVar::CLT_DEGC_X10,
+                                          static_cast<uint16_t>(sensors.clt_degc_x10));
+        DiagnosticManager::set_live_value(FreezeVar::IAT_DEGC_X10,
+                                          static_cast<uint16_t>(sensors.iat_degc_x10));
+        DiagnosticManager::set_live_value(FreezeVar::VBATT_MV, sensors.vbatt_mv);
+        DiagnosticManager::set_live_value(FreezeVar::FUEL_PRESS_BAR_X1000,
+                                          sensors.fuel_press_bar_x1000);
+        DiagnosticManager::set_live_value(FreezeVar::OIL_PRESS_BAR_X1000,
+                                          sensors.oil_press_bar_x1000);
+        DiagnosticManager::set_live_value(FreezeVar::SYNC_STATE,
+                                          static_cast<uint16_t>(snap.state));
+        DiagnosticManager::set_live_value(FreezeVar::SENSOR_FAULT_BITS, sensors.fault_bits);
+    }
+    const bool clt_fault = (sensors.fault_bits & kFaultBitClt) != 0u;
+    const bool oil_fault = (sensors.fault_bits & kFaultBitOil) != 0u;
+    const bool fuel_press_fault = (sensors.fault_bits & kFaultBitFuel) != 0u;
+    // Overtemp from CLT value (open/short already covered by clt_fault).
+    const bool overtemp_warn = sensors.clt_degc_x10 >= kOvertempWarnX10;
+    const bool overtemp_crit = sensors.clt_degc_x10 >= kOvertempCritX10;
+    if (overtemp_crit) {
+        ems::engine::DiagnosticManager::report_fault(
+            ems::engine::DiagnosticCode::OVERTEMP_CRITICAL,
+            ems::engine::FaultSeverity::CRITICAL,
+            static_cast<uint16_t>(sensors.clt_degc_x10), 0u);
+    } else if (overtemp_warn) {
+        ems::engine::DiagnosticManager::report_fault(
+            ems::engine::DiagnosticCode::OVERTEMP_WARNING,
+            ems::engine::FaultSeverity::WARNING,
+            static_cast<uint16_t>(sensors.clt_degc_x10), 0u);
+    } else {
+        ems::engine::DiagnosticManager::clear_fault(
+            ems::engine::DiagnosticCode::OVERTEMP_CRITICAL);
+        ems::engine::DiagnosticManager::clear_fault(
+            ems::engine::DiagnosticCode::OVERTEMP_WARNING);
+    }
+    const bool diag_critical =
+        !ems::engine::DiagnosticManager::is_system_ready();
+    // Falha trancada da malha ETB (ISR do TIM7): a ponte já está na mola.
+    const bool etb_fault = ems::engine::etb_loop_diag_tick();
+    g_limp_active = map_fault || clt_fault || oil_fault || overtemp_warn || etb_fault;
+    // CLT limp: fuel+ign cut only above kLimpRpmLimit (reduced performance below).
+    // MAP fault: always cut fuel — fallback MAP≈1 bar is unsafe load for PW at any RPM.
+    // Oil range fault while spinning: cut fuel+ign (bearing protection).
+    // Fuel-rail range fault after crank: cut fuel only (lean/dry risk).
+    // Overtemp critical: fuel+ign cut while spinning (same floor as oil).
+    // Fuel angular policy:
+    //   (1) FULL_SYNC → running fuel (VE / ASE / semi-seq / sequential)
+    //   (2) HALF_SYNC + is_cranking → batch only (simultaneous, crank PW)
+    //   (3) else (exit crank, flood, protect, anomaly/no-sync) → inj cut
+    const bool rev_cut = g_limp_active &&
+        (snap.rpm_x10 > kLimpRpmLimit_x10);
+    const bool map_fuel_cut = map_fault;
+    const bool oil_protect_cut =
+        oil_fault && (snap.rpm_x10 > kOilProtectRpmX10);
+    const bool fuel_rail_cut =
+        fuel_press_fault && (snap.rpm_x10 > kFuelRailMinRpmX10);
+    const bool overtemp_cut =
+        overtemp_crit && (snap.rpm_x10 > kOilProtectRpmX10);
+    const bool fuel_protect_cut =
+        rev_cut || map_fuel_cut || oil_protect_cut || fuel_rail_cut ||
+        overtemp_cut || diag_critical;
+    const CachedFuelCorrections& fuel_corr = fuel_corrections_for(sensors);
+    const ems::engine::FuelSensorSnapshot fuel_snap =
+        ems::engine::fuel_pw_kernel_snapshot(fuel_corr.corr_clt_x256,
+                                             fuel_corr.corr_iat_x256,
+                                             fuel_corr.dead_time_us,
+                                             sensors.fuel_press_bar_x1000,
+                                             map_bar_x100);
+    // Dwell 2D: tensão × RPM (MS42 §2.2.2.2.1).
+    // Calculado fora do cache porque depende de RPM que varia a cada dente.
+    const uint16_t dwell_ms_x10 = ems::engine::dwell_ms_x10_from_vbatt_rpm(
+        sensors.vbatt_mv, snap.rpm_x10);
+    const uint32_t dwell_ticks =
+        (static_cast<uint32_t>(dwell_ms_x10) * kSchedulerTicksPerMs) / 10u;
+
+    // Multi-spark (MS42 §2.2.3): habilita/desabilita conforme RPM gate.
+    // Hard ceiling 1500 RPM (kMsparkRpmCeilingX10) — window too short above.
+    // O dwell inter-spark é mais curto (tabela dedicada mspark_inter_dwell_ms_x10).
+    // Limite 18°ATDC garante que o último spark contribui para a combustão.
+    {
+        uint16_t ms_gate = ems::engine::mspark_max_rpm_x10;
+        if (ms_gate == 0u || ms_gate > ems::engine::kMsparkRpmCeilingX10) {
+            ms_gate = ems::engine::kMsparkRpmCeilingX10;
+        }
+        if (snap.rpm_x10 < ms_gate && ems::engine::mspark_count > 0u) {
+            const uint32_t inter_dwell_ticks =
+                (static_cast<uint32_t>(ems::engine::mspark_inter_dwell_ms_x10)
+                 * kSchedulerTicksPerMs) / 10u;
+            ::ecu_sched_set_mspark(ems::engine::mspark_count, inter_dwell_ticks, 18u);
+        } else {
+            ::ecu_sched_set_mspark(0u, 0u, 18u);
+        }
+    }
+    // Quick-crank state once per 2 ms tick (HALF + FULL + stopped).
+    // Must not be gated on FULL_SYNC fuel — is_cranking() drives presync
+    // SIMULTANEOUS, ETB crank open-loop, and HALF batch fuel.
+    ems::engine::quick_crank_set_prime_context(sensors.clt_degc_x10,
+                                               fuel_corr.dead_time_us);
+    const auto qc = ems::engine::quick_crank_update(
+        now, snap.rpm_x10, sched_sync, sensors.clt_degc_x10, 0);
+    // Gate closed-loop enrichments during crank + afterstart (not raw RPM).
+    const bool crank_or_ase = qc.cranking || qc.afterstart_active;
+    // Janelas de knock latchadas pela ISR → decisão/retard aqui.
+    ems::engine::knock_process();
+    // Mapa aprendido de knock: as janelas fechadas neste slot pertencem às
+    // faíscas do avanço já calculado — crédito na carga em que o spark_table
+    // (e o retardo aprendido) foi lido; só em sequencial fora de cranking.
+    ems::engine::knock_learn_update(snap.rpm_x10,
+                                    g_spark_load_bar_x100 != 0u ? g_spark_load_bar_x100
+                                                                : map_bar_x100,
+                                    full_sync && !qc.cranking &&
+                                    ::ecu_sched_is_sequential() != 0u);
+    const bool flood_clear =
+        ems::engine::crank_flood_clear_active(sensors.app_pct_x10);
+    const bool half_sync = sched_sync && !full_sync;
+    // HALF batch: cranking only, no flood/protect. Auto presync → SIMULTANEOUS.
+    const bool allow_half_crank_batch =
+        half_sync && qc.cranking && !flood_clear && !fuel_protect_cut;
+    // Lock out angular fuel in HALF unless batch-allowed (exit crank / flood / cut).
+    const bool half_fuel_lockout = half_sync && !allow_half_crank_batch;
+
+    // Limitador de RPM — rusEFI-style: fuel cut only, total cut + hysteresis.
+    // Corta 100% injecção ao atingir hard limit; reativa ao descer
+    // abaixo de (hard - hysteresis). IGN nunca é cortada (só limp mode).
+    {
+        const uint32_t hard      = ems::engine::rev_limit_rpm_x10;
+        const uint32_t hyst      = ems::engine::rev_limit_soft_window_x10;
+        const uint32_t resume    = (hard > hyst) ? hard - hyst : 0u;
 
-        // ── 2ms: fuel + ign recalc + commit calibration ───────────────────
-        if (elapsed(now, g_t2ms_, 2u)) {
-            g_t2ms_ = now;
-            const uint32_t loop2ms_start_us = micros();
-
-            // Stall watchdog: detecta virabrequim parado entre dentes.
-            // Deve preceder ckp_snapshot() para que o snapshot deste ciclo
-            // já reflicta LOSS_OF_SYNC se o motor parou.
-            // Reactivado: os falsos stalls vinham do wrap 16-bit do TIM3;
-            // desde a migração para TIM5 (32-bit) o elapsed é correcto.
-            // Também decai rpm_x10 fantasma de ruído em CKP sem sync.
-            ems::drv::ckp_stall_poll(ems::hal::tim5_count());
-
-            // Dwell / injector open watchdogs (lost SPARK / lost INJ_OFF).
-            ecu_sched_dwell_watchdog();
-            ecu_sched_inj_watchdog();
-
-            const auto snap    = ems::drv::ckp_snapshot();
-            const auto sensors = ems::drv::sensors_get();
-
-            // Teste de saídas em bancada: aborto imediato se RPM > 0 e
-            // timeout de keepalive (o dwell watchdog acima continua activo).
-            ems::engine::output_test_poll(now, snap.rpm_x10);
-            const bool full_sync = (snap.state == ems::drv::SyncState::FULL_SYNC);
-            const bool sched_sync = (snap.state == ems::drv::SyncState::HALF_SYNC || full_sync);
-
-            if (g_runtime_seed_arm_window_active) {
-                if (elapsed(now, g_runtime_seed_arm_window_start_ms,
-                            kRuntimeSeedArmWindowMs)) {
-                    ems::drv::ckp_seed_disarm();
-                    g_runtime_seed_arm_window_active = false;
-                }
+        if (snap.rpm_x10 > g_dbg_rev_limit_rpm_max) {
+            g_dbg_rev_limit_rpm_max = snap.rpm_x10;  // pico global (apanha glitch)
+        }
+        if (snap.rpm_x10 >= hard) {
+            if (!g_rev_limit_active) {           // borda de subida = 1 trip
+                ++g_dbg_rev_limit_trips;
+                g_dbg_rev_limit_rpm_x10 = snap.rpm_x10;  // rpm que disparou
             }
-
-            if (full_sync) {
-                g_have_last_full_sync = true;
-                g_last_full_sync_snapshot = snap;
+            g_rev_limit_active = true;
+        } else if (snap.rpm_x10 <= resume) {
+            g_rev_limit_active = false;
+        }
+        ems::app::ui_set_rev_limit_active(g_rev_limit_active);
+
+        // Spark-skip soft limiter: na janela [hard−window, hard) o
+        // ratio rampa 0→max — torque cai progressivamente ANTES do
+        // corte duro de fuel (que permanece inalterado no hard).
+        {
+            const uint16_t win = ems::engine::spark_skip_window_rpm_x10;
+            const uint8_t  mx  = ems::engine::spark_skip_max_q8;
+            uint8_t ratio = 0u;
+            if (win != 0u && mx != 0u && !g_rev_limit_active &&
+                hard > win && snap.rpm_x10 >= (hard - win)) {
+                const uint32_t into = snap.rpm_x10 - (hard - win);
+                ratio = static_cast<uint8_t>(
+                    (static_cast<uint32_t>(mx) * into) / win);
             }
-            if (sched_sync && snap.tooth_index == 0u) {
-                g_have_last_gap_sync = true;
-                g_last_gap_sync_snapshot = snap;
+            ems::engine::spark_skip_set_ratio_q8(ratio);
+            // Edge de revolução: tooth_index recua (wrap no gap).
+            static uint16_t s_prev_tooth = 0u;
+            if (snap.tooth_index < s_prev_tooth) {
+                ems::engine::spark_skip_on_rev();
             }
+            s_prev_tooth = snap.tooth_index;
+        }
 
-            const bool map_fault = (sensors.fault_bits & kFaultBitMap) != 0u;
-            const uint16_t map_bar_x100_raw = static_cast<uint16_t>(sensors.map_bar_x1000 / 10u);
-            const uint16_t map_bar_x100_sensor = clamp_u16(map_bar_x100_raw, kMapMinBarX100, kMapMaxBarX100);
-            // Throttle signal for manifold model: ETB blade if harness present, else APP.
-            const uint16_t tps_for_map = (ems::engine::etb_harness_present != 0u)
-                ? sensors.etb_tps_pct_x10
-                : sensors.app_pct_x10;
-            // Fusion: sensor_valid=false on MAP fault so fallback 1 bar is not trusted.
-            const uint16_t map_bar_x100 = ems::engine::map_estimator_update(
-                map_bar_x100_sensor,
-                tps_for_map,
-                kAePeriodMs,
-                snap.rpm_x10,
-                sensors.iat_degc_x10,
-                !map_fault);
-            const bool clt_fault = (sensors.fault_bits & kFaultBitClt) != 0u;
-            const bool oil_fault = (sensors.fault_bits & kFaultBitOil) != 0u;
-            const bool fuel_press_fault = (sensors.fault_bits & kFaultBitFuel) != 0u;
-            // Overtemp from CLT value (open/short already covered by clt_fault).
-            const bool overtemp_warn = sensors.clt_degc_x10 >= kOvertempWarnX10;
-            const bool overtemp_crit = sensors.clt_degc_x10 >= kOvertempCritX10;
-            if (overtemp_crit) {
-                ems::engine::DiagnosticManager::report_fault(
-                    ems::engine::DiagnosticCode::OVERTEMP_CRITICAL,
-                    ems::engine::FaultSeverity::CRITICAL,
-                    static_cast<uint16_t>(sensors.clt_degc_x10), 0u);
-            } else if (overtemp_warn) {
-                ems::engine::DiagnosticManager::report_fault(
-                    ems::engine::DiagnosticCode::OVERTEMP_WARNING,
-                    ems::engine::FaultSeverity::WARNING,
-                    static_cast<uint16_t>(sensors.clt_degc_x10), 0u);
-            } else {
-                ems::engine::DiagnosticManager::clear_fault(
-                    ems::engine::DiagnosticCode::OVERTEMP_CRITICAL);
-                ems::engine::DiagnosticManager::clear_fault(
-                    ems::engine::DiagnosticCode::OVERTEMP_WARNING);
+        // Duty do injector: estado do tick anterior (o PW final só é
+        // conhecido mais abaixo) — 2 ms de latência, irrelevante vs
+        // a tolerância de centenas de ms da protecção.
+        const bool inj_duty_cut = ems::engine::fuel_inj_duty_cut_active();
+        const uint8_t inj_mask =
+            (fuel_protect_cut || g_rev_limit_active ||
+             half_fuel_lockout || inj_duty_cut) ? ECU_CYL_MASK_ALL : 0u;
+        const uint8_t ign_mask_cut =
+            (rev_cut || oil_protect_cut || overtemp_cut ||
+             diag_critical) ? ECU_CYL_MASK_ALL : 0u;
+        const uint8_t ign_mask = static_cast<uint8_t>(
+            ign_mask_cut | ems::engine::spark_skip_mask());
+        ::ecu_sched_set_inj_inhibit_mask(inj_mask);
+        ::ecu_sched_set_ign_inhibit_mask(ign_mask);
+
+        // Razões tipadas de corte (cut_reason.h) — telemetria 'D' [51].
+        // DFCO é decidido mais abaixo no caminho FULL_SYNC (OR posterior).
+        uint16_t fr = 0u;
+        if (g_rev_limit_active) fr |= ems::engine::kFuelCutRevLimit;
+        if (rev_cut)            fr |= ems::engine::kFuelCutLimpRpm;
+        if (map_fuel_cut)       fr |= ems::engine::kFuelCutMapFault;
+        if (oil_protect_cut)    fr |= ems::engine::kFuelCutOilPress;
+        if (fuel_rail_cut)      fr |= ems::engine::kFuelCutFuelRail;
+        if (overtemp_cut)       fr |= ems::engine::kFuelCutOvertemp;
+        if (diag_critical)      fr |= ems::engine::kFuelCutDiagCrit;
+        if (half_fuel_lockout)  fr |= ems::engine::kFuelCutNoSync;
+        if (flood_clear)        fr |= ems::engine::kFuelCutFlood;
+        if (inj_duty_cut)       fr |= ems::engine::kFuelCutInjDuty;
+        uint16_t sr = 0u;
+        if (rev_cut)          sr |= ems::engine::kSparkCutLimpRpm;
+        if (oil_protect_cut)  sr |= ems::engine::kSparkCutOilPress;
+        if (overtemp_cut)     sr |= ems::engine::kSparkCutOvertemp;
+        if (diag_critical)    sr |= ems::engine::kSparkCutDiagCrit;
+        if (ems::engine::spark_skip_mask() != 0u) {
+            sr |= ems::engine::kSparkSkipActive;
+        }
+        ems::engine::g_fuel_cut_reasons  = fr;
+        ems::engine::g_spark_cut_reasons = sr;
+    }
+
+    // Telemetry PW must match actuators: only when injectors are actually cut.
+    const bool fuel_cut_active =
+        g_rev_limit_active || fuel_protect_cut || half_fuel_lockout ||
+        ems::engine::fuel_inj_duty_cut_active();
+
+    // (1) FULL_SYNC: running fuel path (VE / trims / AE / X-τ when not crank-ASE).
+    if (full_sync && !fuel_protect_cut) {
+        // Carga do PW = MAP previsto ao IVC de cada cilindro (o ar que o
+        // combustível vai encontrar), não o MAP do commit — tira o pico
+        // pobre do tip-in. O lookup VE/λ usa o do próximo cilindro
+        // servido; cyl_pulse_build escala os restantes pelo seu IVC.
+        // map_pred_gain_pct=0 → MAP fundido em todos. LTFT/X-τ/DFCO
+        // continuam na célula do MAP actual.
+        uint16_t map_ivc_x100[ems::engine::cfg::kCylinderCount];
+        const uint16_t map_fuel_x100 = ems::engine::map_estimator_predict_ivc_cyl(
+            map_bar_x100, tps_for_map, snap.rpm_x10, sensors.iat_degc_x10,
+            engine_deg_at_tooth(snap),
+            ems::engine::calc_eoi_lead_deg(snap.rpm_x10), g_last_net_pw_us,
+            map_ivc_x100);
+        const ems::engine::Table2dLookup fuel_lookup =
+            ems::engine::table3d_prepare_lookup(ems::engine::kRpmAxisX10,
+                                                ems::engine::kLoadAxisBarX100,
+                                                snap.rpm_x10,
+                                                map_fuel_x100);
+        const uint8_t  ve = ems::engine::get_ve_prepared(fuel_lookup);
+        const uint16_t lambda_target_x1000 =
+            ems::engine::get_lambda_target_x1000_prepared(fuel_lookup);
+        // LTFT apply = nearest cell (mesma política que crédito/store LEARN).
+        // fuel_lookup.yi/xi são floor da bilineal VE — mid-bin errava a célula.
+        const int16_t fuel_trim_pct_x10 = crank_or_ase ? 0 : clamp_i16(
+            static_cast<int16_t>(ems::engine::fuel_get_stft_pct_x10() +
+                                 ems::engine::fuel_get_ltft_at(snap.rpm_x10, map_bar_x100)),
+            -500, 500);
+        // AE/DE from map-fusion TPSdot (signed: tip-in >0, tip-out <0).
+        const int16_t ae_tpsdot = ems::engine::map_get_tpsdot_x10();
+        int32_t ae_pw_us = crank_or_ase ? 0
+            : ems::engine::calc_ae_pw_from_tpsdot(ae_tpsdot, sensors.clt_degc_x10);
+        // Kernel fundido (= calc_fuel_pw_us_default_fast, 1 divisão).
+        const ems::engine::FuelOperatingPoint fuel_op = {
+            ve, map_fuel_x100, lambda_target_x1000, fuel_trim_pct_x10};
+        const uint32_t kern_cyc0 = DWT_CYCCNT;
+        uint32_t final_pw_us_base =
+            ems::engine::fuel_pw_kernel(fuel_op, fuel_snap, &ems::engine::g_fuel_pw_breakdown);
+        uint32_t kern_cycles = DWT_CYCCNT - kern_cyc0;
+        // Corte de combustível na desaceleração (MS42 TI_PUR).
+        // Avaliado ANTES do X-Tau: evita alimentar o modelo de parede com PW
+        // real e depois descartar o resultado, contaminando a auto-calibração.
+        // Contexto DFCO: MAP p/ o gate de vácuo e marcha p/ inibição
+        // pós-troca (ambos inertes com as respectivas cals a 0).
+        ems::engine::fuel_decel_cut_notify_map(map_bar_x100);
+        {
+            uint8_t gr = 0u;
+            if (ems::engine::vehicle_gear(gr, now)) {
+                ems::engine::fuel_decel_cut_notify_gear(gr, now);
             }
-            const bool diag_critical =
-                !ems::engine::DiagnosticManager::is_system_ready();
-            g_limp_active = map_fault || clt_fault || oil_fault || overtemp_warn;
-            // CLT limp: fuel+ign cut only above kLimpRpmLimit (reduced performance below).
-            // MAP fault: always cut fuel — fallback MAP≈1 bar is unsafe load for PW at any RPM.
-            // Oil range fault while spinning: cut fuel+ign (bearing protection).
-            // Fuel-rail range fault after crank: cut fuel only (lean/dry risk).
-            // Overtemp critical: fuel+ign cut while spinning (same floor as oil).
-            // Fuel angular policy:
-            //   (1) FULL_SYNC → running fuel (VE / ASE / semi-seq / sequential)
-            //   (2) HALF_SYNC + is_cranking → batch only (simultaneous, crank PW)
-            //   (3) else (exit crank, flood, protect, anomaly/no-sync) → inj cut
-            const bool rev_cut = g_limp_active &&
-                (snap.rpm_x10 > kLimpRpmLimit_x10);
-            const bool map_fuel_cut = map_fault;
-            const bool oil_protect_cut =
-                oil_fault && (snap.rpm_x10 > kOilProtectRpmX10);
-            const bool fuel_rail_cut =
-                fuel_press_fault && (snap.rpm_x10 > kFuelRailMinRpmX10);
-            const bool overtemp_cut =
-                overtemp_crit && (snap.rpm_x10 > kOilProtectRpmX10);
-            const bool fuel_protect_cut =
-                rev_cut || map_fuel_cut || oil_protect_cut || fuel_rail_cut ||
-                overtemp_cut || diag_critical;
-            const CachedFuelCorrections& fuel_corr = fuel_corrections_for(sensors);
-            // Dwell 2D: tensão × RPM (MS42 §2.2.2.2.1).
-            // Calculado fora do cache porque depende de RPM que varia a cada dente.
-            const uint16_t dwell_ms_x10 = ems::engine::dwell_ms_x10_from_vbatt_rpm(
-                sensors.vbatt_mv, snap.rpm_x10);
-            const uint32_t dwell_ticks =
-                (static_cast<uint32_t>(dwell_ms_x10) * kSchedulerTicksPerMs) / 10u;
-
-            // Multi-spark (MS42 §2.2.3): habilita/desabilita conforme RPM gate.
-            // Hard ceiling 1500 RPM (kMsparkRpmCeilingX10) — window too short above.
-            // O dwell inter-spark é mais curto (tabela dedicada mspark_inter_dwell_ms_x10).
-            // Limite 18°ATDC garante que o último spark contribui para a combustão.
-            {
-                uint16_t ms_gate = ems::engine::mspark_max_rpm_x10;
-                if (ms_gate == 0u || ms_gate > ems::engine::kMsparkRpmCeilingX10) {
-                    ms_gate = ems::engine::kMsparkRpmCeilingX10;
-                }
-                if (snap.rpm_x10 < ms_gate && ems::engine::mspark_count > 0u) {
-                    const uint32_t inter_dwell_ticks =
-                        (static_cast<uint32_t>(ems::engine::mspark_inter_dwell_ms_x10)
-                         * kSchedulerTicksPerMs) / 10u;
-                    ::ecu_sched_set_mspark(ems::engine::mspark_count, inter_dwell_ticks, 18u);
-                } else {
-                    ::ecu_sched_set_mspark(0u, 0u, 18u);
-                }
+        }
+        const bool decel_cut_active = !crank_or_ase &&
+            ems::engine::fuel_decel_cut_update(
+                snap.rpm_x10, sensors.etb_tps_pct_x10, sensors.clt_degc_x10);
+        ems::engine::misfire_set_all_inhibit(
+            decel_cut_active || crank_or_ase || flood_clear);
+        // X-τ desde !cranking (inclui afterstart frio — pior wall-wetting).
+        // AE residual a 50% quando X-τ activo (evita empilhar enrich).
+        const bool xtau_enabled = !qc.cranking;
+        if (xtau_enabled && ae_pw_us > 0) {
+            ae_pw_us /= 2;
+        }
+        if (decel_cut_active) {
+            ems::engine::g_fuel_cut_reasons = static_cast<uint16_t>(
+                ems::engine::g_fuel_cut_reasons | ems::engine::kFuelCutDfco);
+            g_last_net_pw_us = 0u;
+            g_ae_active = false;
+            ems::engine::transient_fuel_reset();
+        } else if (final_pw_us_base > fuel_corr.dead_time_us) {
+            uint32_t fuel_pw_us =
+                final_pw_us_base - static_cast<uint32_t>(fuel_corr.dead_time_us);
+
+            // LTFT aditivo (MS42 TI_AD_ADD_MMV): offset no PW líquido, célula nearest
+            if (!crank_or_ase) {
+                const int16_t ltft_add =
+                    ems::engine::fuel_get_ltft_add_at(snap.rpm_x10, map_bar_x100);
+                const int32_t pw_adj = static_cast<int32_t>(fuel_pw_us) + ltft_add;
+                fuel_pw_us = (pw_adj <= 0) ? 0u
+                           : (pw_adj > 100000) ? 100000u
+                           : static_cast<uint32_t>(pw_adj);
             }
-            // Quick-crank state once per 2 ms tick (HALF + FULL + stopped).
-            // Must not be gated on FULL_SYNC fuel — is_cranking() drives presync
-            // SIMULTANEOUS, ETB crank open-loop, and HALF batch fuel.
-            ems::engine::quick_crank_set_prime_context(sensors.clt_degc_x10,
-                                                       fuel_corr.dead_time_us);
-            const auto qc = ems::engine::quick_crank_update(
-                now, snap.rpm_x10, sched_sync, sensors.clt_degc_x10, 0);
-            // Gate closed-loop enrichments during crank + afterstart (not raw RPM).
-            const bool crank_or_ase = qc.cranking || qc.afterstart_active;
-            const bool flood_clear =
-                ems::engine::crank_flood_clear_active(sensors.app_pct_x10);
-            const bool half_sync = sched_sync && !full_sync;
-            // HALF batch: cranking only, no flood/protect. Auto presync → SIMULTANEOUS.
-            const bool allow_half_crank_batch =
-                half_sync && qc.cranking && !flood_clear && !fuel_protect_cut;
-            // Lock out angular fuel in HALF unless batch-allowed (exit crank / flood / cut).
-            const bool half_fuel_lockout = half_sync && !allow_half_crank_batch;
-
-            // Limitador de RPM — rusEFI-style: fuel cut only, total cut + hysteresis.
-            // Corta 100% injecção ao atingir hard limit; reativa ao descer
-            // abaixo de (hard - hysteresis). IGN nunca é cortada (só limp mode).
-            {
-                const uint32_t hard      = ems::engine::rev_limit_rpm_x10;
-                const uint32_t hyst      = ems::engine::rev_limit_soft_window_x10;
-                const uint32_t resume    = (hard > hyst) ? hard - hyst : 0u;
-
-                if (snap.rpm_x10 > g_dbg_rev_limit_rpm_max) {
-                    g_dbg_rev_limit_rpm_max = snap.rpm_x10;  // pico global (apanha glitch)
-                }
-                if (snap.rpm_x10 >= hard) {
-                    if (!g_rev_limit_active) {           // borda de subida = 1 trip
-                        ++g_dbg_rev_limit_trips;
-                        g_dbg_rev_limit_rpm_x10 = snap.rpm_x10;  // rpm que disparou
-                    }
-                    g_rev_limit_active = true;
-                } else if (snap.rpm_x10 <= resume) {
-                    g_rev_limit_active = false;
-                }
-                ems::app::ui_set_rev_limit_active(g_rev_limit_active);
-
-                // Spark-skip soft limiter: na janela [hard−window, hard) o
-                // ratio rampa 0→max — torque cai progressivamente ANTES do
-                // corte duro de fuel (que permanece inalterado no hard).
-                {
-                    const uint16_t win = ems::engine::spark_skip_window_rpm_x10;
-                    const uint8_t  mx  = ems::engine::spark_skip_max_q8;
-                    uint8_t ratio = 0u;
-                    if (win != 0u && mx != 0u && !g_rev_limit_active &&
-                        hard > win && snap.rpm_x10 >= (hard - win)) {
-                        const uint32_t into = snap.rpm_x10 - (hard - win);
-                        ratio = static_cast<uint8_t>(
-                            (static_cast<uint32_t>(mx) * into) / win);
-                    }
-                    ems::engine::spark_skip_set_ratio_q8(ratio);
-                    // Edge de revolução: tooth_index recua (wrap no gap).
-                    static uint16_t s_prev_tooth = 0u;
-                    if (snap.tooth_index < s_prev_tooth) {
-                        ems::engine::spark_skip_on_rev();
-                    }
-                    s_prev_tooth = snap.tooth_index;
-                }
-
-                // Duty do injector: estado do tick anterior (o PW final só é
-                // conhecido mais abaixo) — 2 ms de latência, irrelevante vs
-                // a tolerância de centenas de ms da protecção.
-                const bool inj_duty_cut = ems::engine::fuel_inj_duty_cut_active();
-                const uint8_t inj_mask =
-                    (fuel_protect_cut || g_rev_limit_active ||
-                     half_fuel_lockout || inj_duty_cut) ? 0x0Fu : 0u;
-                const uint8_t ign_mask_cut =
-                    (rev_cut || oil_protect_cut || overtemp_cut ||
-                     diag_critical) ? 0x0Fu : 0u;
-                const uint8_t ign_mask = static_cast<uint8_t>(
-                    ign_mask_cut | ems::engine::spark_skip_mask());
-                ::ecu_sched_set_inj_inhibit_mask(inj_mask);
-                ::ecu_sched_set_ign_inhibit_mask(ign_mask);
-
-                // Razões tipadas de corte (cut_reason.h) — telemetria 'D' [51].
-                // DFCO é decidido mais abaixo no caminho FULL_SYNC (OR posterior).
-                uint16_t fr = 0u;
-                if (g_rev_limit_active) fr |= ems::engine::kFuelCutRevLimit;
-                if (rev_cut)            fr |= ems::engine::kFuelCutLimpRpm;
-                if (map_fuel_cut)       fr |= ems::engine::kFuelCutMapFault;
-                if (oil_protect_cut)    fr |= ems::engine::kFuelCutOilPress;
-                if (fuel_rail_cut)      fr |= ems::engine::kFuelCutFuelRail;
-                if (overtemp_cut)       fr |= ems::engine::kFuelCutOvertemp;
-                if (diag_critical)      fr |= ems::engine::kFuelCutDiagCrit;
-                if (half_fuel_lockout)  fr |= ems::engine::kFuelCutNoSync;
-                if (flood_clear)        fr |= ems::engine::kFuelCutFlood;
-                if (inj_duty_cut)       fr |= ems::engine::kFuelCutInjDuty;
-                uint16_t sr = 0u;
-                if (rev_cut)          sr |= ems::engine::kSparkCutLimpRpm;
-                if (oil_protect_cut)  sr |= ems::engine::kSparkCutOilPress;
-                if (overtemp_cut)     sr |= ems::engine::kSparkCutOvertemp;
-                if (diag_critical)    sr |= ems::engine::kSparkCutDiagCrit;
-                if (ems::engine::spark_skip_mask() != 0u) {
-                    sr |= ems::engine::kSparkSkipActive;
-                }
-                ems::engine::g_fuel_cut_reasons  = fr;
-                ems::engine::g_spark_cut_reasons = sr;
+            g_last_net_pw_us = fuel_pw_us;
+
+            // Learn X-τ: apenas no slot 100ms (λ + STFT + tpsdot gates).
+            // Modelo de parede com τ escalado a wall-clock (period_ms).
+            const uint32_t xtau_fuel_pw_us =
+                ems::engine::transient_fuel_xtau_with_autocalib(fuel_pw_us,
+                                                                snap.rpm_x10,
+                                                                map_bar_x100,
+                                                                sensors.clt_degc_x10,
+                                                                xtau_enabled,
+                                                                kAePeriodMs);
+            // Só a parcela de FLUXO segue no pipeline; o dead-time
+            // eléctrico é somado no fim, depois de ΔP/S-curve
+            // (convenção de calc_final_pw_us — dead-time nunca escala).
+            final_pw_us_base = xtau_fuel_pw_us;
+        } else {
+            ems::engine::transient_fuel_reset();
+            final_pw_us_base = 0u;  // fluxo ≈ 0 (base ≤ dead-time)
+        }
+        // AE tip-in (add) ou DE tip-out (subtract), clamp a [0, 100ms].
+        if (!decel_cut_active && ae_pw_us != 0) {
+            const int64_t adj = static_cast<int64_t>(final_pw_us_base) + ae_pw_us;
+            if (adj <= 0) {
+                final_pw_us_base = 0u;
+            } else if (adj > 100000) {
+                final_pw_us_base = 100000u;
+            } else {
+                final_pw_us_base = static_cast<uint32_t>(adj);
             }
-
-            // Telemetry PW must match actuators: only when injectors are actually cut.
-            const bool fuel_cut_active =
-                g_rev_limit_active || fuel_protect_cut || half_fuel_lockout ||
-                ems::engine::fuel_inj_duty_cut_active();
-
-            // (1) FULL_SYNC: running fuel path (VE / trims / AE / X-τ when not crank-ASE).
-            if (full_sync && !fuel_protect_cut) {
-                const ems::engine::Table2dLookup fuel_lookup =
-                    ems::engine::table3d_prepare_lookup(ems::engine::kRpmAxisX10,
-                                                        ems::engine::kLoadAxisBarX100,
-                                                        snap.rpm_x10,
+            // STFT freeze only on tip-in enrich (not DE).
+            g_ae_active = (ae_pw_us > 0);
+        }
+        const int16_t base_advance_deg = ems::engine::get_advance_prepared(fuel_lookup);
+        g_spark_load_bar_x100 = map_fuel_x100;
+        const uint16_t idle_target_rpm_x10 =
+            ems::engine::auxiliaries_idle_target_rpm_x10(sensors.clt_degc_x10);
+        // Idle spark OK during afterstart (helps settle); suppressed only while cranking.
+        const int16_t idle_spark_corr_deg = qc.cranking ? 0 :
+            ems::engine::calc_idle_spark_correction_deg(snap.rpm_x10,
+                                                        idle_target_rpm_x10,
+                                                        sensors.etb_tps_pct_x10,
                                                         map_bar_x100);
-                const uint8_t  ve = ems::engine::get_ve_prepared(fuel_lookup);
-                const uint16_t lambda_target_x1000 =
-                    ems::engine::get_lambda_target_x1000_prepared(fuel_lookup);
-                // LTFT apply = nearest cell (mesma política que crédito/store LEARN).
-                // fuel_lookup.yi/xi são floor da bilineal VE — mid-bin errava a célula.
-                const int16_t fuel_trim_pct_x10 = crank_or_ase ? 0 : clamp_i16(
-                    static_cast<int16_t>(ems::engine::fuel_get_stft_pct_x10() +
-                                         ems::engine::fuel_get_ltft_at(snap.rpm_x10, map_bar_x100)),
-                    -500, 500);
-                // AE/DE from map-fusion TPSdot (signed: tip-in >0, tip-out <0).
-                const int16_t ae_tpsdot = ems::engine::map_get_tpsdot_x10();
-                int32_t ae_pw_us = crank_or_ase ? 0
-                    : ems::engine::calc_ae_pw_from_tpsdot(ae_tpsdot, sensors.clt_degc_x10);
-                uint32_t final_pw_us_base =
-                    ems::engine::calc_fuel_pw_us_default_fast(ve,
-                                                               map_bar_x100,
-                                                               lambda_target_x1000,
-                                                               fuel_trim_pct_x10,
-                                                               fuel_corr.corr_clt_x256,
-                                                               fuel_corr.corr_iat_x256,
-                                                               fuel_corr.dead_time_us);
-                // Corte de combustível na desaceleração (MS42 TI_PUR).
-                // Avaliado ANTES do X-Tau: evita alimentar o modelo de parede com PW
-                // real e depois descartar o resultado, contaminando a auto-calibração.
-                // Contexto DFCO: MAP p/ o gate de vácuo e marcha p/ inibição
-                // pós-troca (ambos inertes com as respectivas cals a 0).
-                ems::engine::fuel_decel_cut_notify_map(map_bar_x100);
-                {
-                    uint8_t gr = 0u;
-                    if (ems::engine::vehicle_gear(gr, now)) {
-                        ems::engine::fuel_decel_cut_notify_gear(gr, now);
-                    }
-                }
-                const bool decel_cut_active = !crank_or_ase &&
-                    ems::engine::fuel_decel_cut_update(
-                        snap.rpm_x10, sensors.etb_tps_pct_x10, sensors.clt_degc_x10);
-                ems::engine::misfire_set_all_inhibit(
-                    decel_cut_active || crank_or_ase || flood_clear);
-                // X-τ desde !cranking (inclui afterstart frio — pior wall-wetting).
-                // AE residual a 50% quando X-τ activo (evita empilhar enrich).
-                const bool xtau_enabled = !qc.cranking;
-                if (xtau_enabled && ae_pw_us > 0) {
-                    ae_pw_us /= 2;
-                }
-                if (decel_cut_active) {
-                    ems::engine::g_fuel_cut_reasons = static_cast<uint16_t>(
-                        ems::engine::g_fuel_cut_reasons | ems::engine::kFuelCutDfco);
-                    g_last_net_pw_us = 0u;
-                    g_ae_active = false;
-                    ems::engine::transient_fuel_reset();
-                } else if (final_pw_us_base > fuel_corr.dead_time_us) {
-                    uint32_t fuel_pw_us =
-                        final_pw_us_base - static_cast<uint32_t>(fuel_corr.dead_time_us);
-
-                    // LTFT aditivo (MS42 TI_AD_ADD_MMV): offset no PW líquido, célula nearest
-                    if (!crank_or_ase) {
-                        const int16_t ltft_add =
-                            ems::engine::fuel_get_ltft_add_at(snap.rpm_x10, map_bar_x100);
-                        const int32_t pw_adj = static_cast<int32_t>(fuel_pw_us) + ltft_add;
-                        fuel_pw_us = (pw_adj <= 0) ? 0u
-                                   : (pw_adj > 100000) ? 100000u
-                                   : static_cast<uint32_t>(pw_adj);
-                    }
-                    g_last_net_pw_us = fuel_pw_us;
-
-                    // Learn X-τ: apenas no slot 100ms (λ + STFT + tpsdot gates).
-                    // Modelo de parede com τ escalado a wall-clock (period_ms).
-                    const uint32_t xtau_fuel_pw_us =
-                        ems::engine::transient_fuel_xtau_with_autocalib(fuel_pw_us,
-                                                                        snap.rpm_x10,
-                                                                        map_bar_x100,
-                                                                        sensors.clt_degc_x10,
-                                                                        xtau_enabled,
-                                                                        kAePeriodMs);
-                    // Só a parcela de FLUXO segue no pipeline; o dead-time
-                    // eléctrico é somado no fim, depois de ΔP/S-curve
-                    // (convenção de calc_final_pw_us — dead-time nunca escala).
-                    final_pw_us_base = xtau_fuel_pw_us;
-                } else {
-                    ems::engine::transient_fuel_reset();
-                    final_pw_us_base = 0u;  // fluxo ≈ 0 (base ≤ dead-time)
-                }
-                // AE tip-in (add) ou DE tip-out (subtract), clamp a [0, 100ms].
-                if (!decel_cut_active && ae_pw_us != 0) {
-                    const int64_t adj = static_cast<int64_t>(final_pw_us_base) + ae_pw_us;
-                    if (adj <= 0) {
-                        final_pw_us_base = 0u;
-                    } else if (adj > 100000) {
-                        final_pw_us_base = 100000u;
-                    } else {
-                        final_pw_us_base = static_cast<uint32_t>(adj);
-                    }
-                    // STFT freeze only on tip-in enrich (not DE).
-                    g_ae_active = (ae_pw_us > 0);
-                }
-                const int16_t base_advance_deg = ems::engine::get_advance_prepared(fuel_lookup);
-                const uint16_t knock_retard_x10 = ems::engine::knock_get_retard_x10(0u);
-                const uint16_t idle_target_rpm_x10 =
-                    ems::engine::auxiliaries_idle_target_rpm_x10(sensors.clt_degc_x10);
-                // Idle spark OK during afterstart (helps settle); suppressed only while cranking.
-                const int16_t idle_spark_corr_deg = qc.cranking ? 0 :
-                    ems::engine::calc_idle_spark_correction_deg(snap.rpm_x10,
-                                                                idle_target_rpm_x10,
-                                                                sensors.etb_tps_pct_x10,
-                                                                map_bar_x100);
-                const int16_t iat_spark_deg = qc.cranking ? 0 :
-                    ems::engine::calc_ign_iat_correction_deg(sensors.iat_degc_x10);
-                const int16_t clt_spark_deg = qc.cranking ? 0 :
-                    ems::engine::calc_ign_clt_correction_deg(sensors.clt_degc_x10);
-                const int16_t antijerk_retard = crank_or_ase ? 0 :
-                    ems::engine::calc_antijerk_retard_deg(ae_tpsdot);
-                const int16_t advance_deg = ems::engine::calc_total_advance(
-                    base_advance_deg,
-                    {iat_spark_deg, clt_spark_deg,
-                     static_cast<int16_t>(knock_retard_x10 / 10u),
-                     idle_spark_corr_deg, antijerk_retard,
-                     g_torque_spark_retard_deg});
-                // Cranking spark from qc (base was 0 at update); else table+corr.
-                const int16_t sched_spark_deg = qc.cranking
-                    ? ems::engine::crank_spark_deg
-                    : advance_deg;
-                // Decel / flood: force PW=0 (do not apply min_pw floor).
-                const uint32_t quick_crank_pw_us =
-                    (decel_cut_active || flood_clear) ? 0u :
-                    ems::engine::quick_crank_apply_pw_us(final_pw_us_base,
-                                                         qc.fuel_mult_x256,
-                                                         qc.min_pw_us);
-                // Correções físicas finais do bico: pressão diferencial de combustível
-                // (real, via sensor) e não-linearidade de abertura em PW pequeno.
-                // Aplicam-se apenas ao fluxo; o dead-time entra DEPOIS, sem escalar,
-                // e só quando há fluxo (PW=0 em corte não ganha dead-time).
-                const uint32_t delta_p_pw_us = ems::engine::apply_delta_p_compensation(
-                    quick_crank_pw_us, sensors.fuel_press_bar_x1000, map_bar_x100);
-                const uint32_t scurve_pw_us = ems::engine::apply_injector_scurve(delta_p_pw_us);
-                const uint32_t final_pw_us = (scurve_pw_us > 0u)
-                    ? scurve_pw_us + static_cast<uint32_t>(fuel_corr.dead_time_us)
-                    : 0u;
-                // Com fuel cut (rev limiter/limp) os injectores estão inibidos pela
-                // mask — a telemetria (dash/CAN) tem de mostrar 0, não o PW calculado
-                // que continua a ser comitado para retoma suave.
-                const uint32_t pw_100 = final_pw_us / 100u;
-                g_last_pw_ms_x10 = fuel_cut_active ? 0u
-                    : static_cast<uint8_t>(pw_100 > 255u ? 255u : pw_100);
-                g_last_advance_deg = clamp_i8(sched_spark_deg, -10, 40);
-
-                // Protecção de duty (FOME #215): alimenta com o PW final
-                // comandado; o corte em si entra na mask do próximo tick.
-                ems::engine::fuel_inj_duty_update(final_pw_us, snap.rpm_x10, 2u);
-
-                const uint32_t inj_pw_ticks = ems::engine::inj_pw_us_to_scheduler_ticks(final_pw_us);
-
-                ::ecu_sched_commit_calibration(
-                    static_cast<uint32_t>(sched_spark_deg < 0 ? 0 : sched_spark_deg),
-                    dwell_ticks,
-                    inj_pw_ticks,
-                    static_cast<uint32_t>(ems::engine::calc_eoi_lead_deg(snap.rpm_x10)));
-            } else if (allow_half_crank_batch) {
-                // (2) HALF_SYNC + cranking: simultaneous batch, crank PW only (no VE/STFT/AE).
-                // Presync auto already selects SIMULTANEOUS while is_cranking().
-                // Force mode in case auto was off or race with tooth ISR.
-                ::ecu_sched_set_presync_inj_mode(ECU_PRESYNC_INJ_SIMULTANEOUS);
-                ems::engine::misfire_set_all_inhibit(true);
-                g_ae_active = false;
-                ems::engine::transient_fuel_reset();
-
-                const uint32_t req_us = ems::engine::default_req_fuel_us();
-                const uint32_t crank_flow_us = ems::engine::quick_crank_apply_pw_us(
-                    req_us, qc.fuel_mult_x256, qc.min_pw_us);
-                g_last_net_pw_us = crank_flow_us;
-                const uint32_t delta_p_pw_us = ems::engine::apply_delta_p_compensation(
-                    crank_flow_us, sensors.fuel_press_bar_x1000, map_bar_x100);
-                const uint32_t scurve_pw_us = ems::engine::apply_injector_scurve(delta_p_pw_us);
-                const uint32_t final_pw_us = (scurve_pw_us > 0u)
-                    ? scurve_pw_us + static_cast<uint32_t>(fuel_corr.dead_time_us)
-                    : 0u;
-                const uint32_t pw_100 = final_pw_us / 100u;
-                g_last_pw_ms_x10 = fuel_cut_active ? 0u
-                    : static_cast<uint8_t>(pw_100 > 255u ? 255u : pw_100);
-                const int16_t sched_spark_deg = ems::engine::crank_spark_deg;
-                g_last_advance_deg = clamp_i8(sched_spark_deg, -10, 40);
-                const uint32_t inj_pw_ticks =
-                    ems::engine::inj_pw_us_to_scheduler_ticks(final_pw_us);
-                ::ecu_sched_commit_calibration(
-                    static_cast<uint32_t>(sched_spark_deg < 0 ? 0 : sched_spark_deg),
-                    dwell_ticks,
-                    inj_pw_ticks,
-                    static_cast<uint32_t>(ems::engine::calc_eoi_lead_deg(snap.rpm_x10)));
-            } else if (sched_sync &&
-                       (fuel_protect_cut || half_fuel_lockout || g_rev_limit_active)) {
-                // (3) Spark-only: exit-crank HALF, flood, protect, rev-limit, anomaly path.
-                // qc already updated — use crank spark only while still latched cranking.
-                const int16_t base_advance_deg = ems::engine::get_advance(snap.rpm_x10, map_bar_x100);
-                const int16_t sched_spark_deg = qc.cranking
-                    ? ems::engine::crank_spark_deg
-                    : base_advance_deg;
-                ::ecu_sched_commit_calibration(
-                    static_cast<uint32_t>(sched_spark_deg < 0 ? 0 : sched_spark_deg),
-                    dwell_ticks,
-                    0u,
-                    static_cast<uint32_t>(ems::engine::calc_eoi_lead_deg(snap.rpm_x10)));
-                g_last_pw_ms_x10 = 0u;
-                g_last_net_pw_us = 0u;
-                g_last_advance_deg = clamp_i8(sched_spark_deg, -10, 40);
-                g_ae_active = false;
-            }
-            g_prev_tps_pct_x10 = sensors.etb_tps_pct_x10;
-            ems::app::ui_update_rt_map_fuel(map_bar_x100, g_last_net_pw_us);
-            g_last_map_fused_x100 = map_bar_x100;
-
-            // Prime one-shot: suppressed on flood-clear, fuel-protect (MAP/oil/rail/
-            // overtemp/diag/rev limp), and whenever inj mask already locks all cyls.
-            // force_output also honors the mask (defense in depth vs bypass).
-            const bool prime_blocked =
-                flood_clear || fuel_protect_cut || half_fuel_lockout ||
-                g_rev_limit_active;
-            const uint32_t prime_pw = prime_blocked
-                ? 0u
-                : ems::engine::quick_crank_consume_prime();
-            if (prime_pw != 0u && !ems::engine::output_test_active()) {
-                ::ecu_sched_fire_prime_pulse(prime_pw);
-            } else if (prime_blocked) {
-                // Drop pending prime so protect/flood cannot fire after condition clears mid-tooth.
-                static_cast<void>(ems::engine::quick_crank_consume_prime());
-            }
+        const int16_t iat_spark_deg = qc.cranking ? 0 :
+            ems::engine::calc_ign_iat_correction_deg(sensors.iat_degc_x10);
+        const int16_t clt_spark_deg = qc.cranking ? 0 :
+            ems::engine::calc_ign_clt_correction_deg(sensors.clt_degc_x10);
+        const int16_t antijerk_retard = crank_or_ase ? 0 :
+            ems::engine::calc_antijerk_retard_deg(ae_tpsdot);
+        // Knock: o mapa aprendido entra aqui, no ponto do spark_table; o
+        // retardo reactivo é por cilindro (cyl_pulse_build).
+        const int16_t knock_learn_deg = qc.cranking ? 0 : static_cast<int16_t>(
+            (ems::engine::knock_learn_retard_x10_at(snap.rpm_x10, map_fuel_x100) + 5u) / 10u);
+        const int16_t advance_deg = ems::engine::calc_total_advance(
+            base_advance_deg,
+            {iat_spark_deg, clt_spark_deg, knock_learn_deg,
+             idle_spark_corr_deg, antijerk_retard,
+             g_torque_spark_retard_deg});
+        // Decel / flood: force PW=0 (do not apply min_pw floor).
+        const uint32_t quick_crank_pw_us =
+            (decel_cut_active || flood_clear) ? 0u :
+            ems::engine::quick_crank_apply_pw_us(final_pw_us_base,
+                                                 qc.fuel_mult_x256,
+                                                 qc.min_pw_us);
+        // Correções físicas finais do bico: pressão diferencial de combustível
+        // (real, via sensor) e não-linearidade de abertura em PW pequeno.
+        // Aplicam-se apenas ao fluxo; o dead-time entra DEPOIS, sem escalar,
+        // e só quando há fluxo (PW=0 em corte não ganha dead-time).
+        const uint32_t kern_cyc1 = DWT_CYCCNT;
+        const uint32_t final_pw_us = ems::engine::fuel_pw_kernel_injector(
+            quick_crank_pw_us, fuel_snap, &ems::engine::g_fuel_pw_breakdown);
+        kern_cycles += DWT_CYCCNT - kern_cyc1;
+        if (kern_cycles > ems::engine::g_fuel_pw_kernel_cycles_max) {
+            ems::engine::g_fuel_pw_kernel_cycles_max = kern_cycles;
+        }
+        // Vector por cilindro (trim, balance MAP, knock): O(N) sobre o
+        // fluxo já calculado. Cranking spark from qc (base was 0 at
+        // update); escalar = avanço − maior retardo (presync/wasted).
+        EcuSchedCylVector cyl_vec;
+        const int16_t sched_spark_deg = ems::engine::cyl_pulse_build(
+            {ems::engine::g_fuel_pw_breakdown.scurve_pw_us, fuel_snap.dead_time_us,
+             qc.cranking ? ems::engine::crank_spark_deg : advance_deg,
+             map_bar_x100, !qc.cranking, map_ivc_x100, map_fuel_x100},
+            &cyl_vec);
+        // Com fuel cut (rev limiter/limp) os injectores estão inibidos pela
+        // mask — a telemetria (dash/CAN) tem de mostrar 0, não o PW calculado
+        // que continua a ser comitado para retoma suave.
+        const uint32_t pw_100 = final_pw_us / 100u;
+        g_last_pw_ms_x10 = fuel_cut_active ? 0u
+            : static_cast<uint8_t>(pw_100 > 255u ? 255u : pw_100);
+        g_last_advance_deg = clamp_i8(sched_spark_deg, -10, 40);
+
+        // Protecção de duty (FOME #215): alimenta com o PW final
+        // comandado; o corte em si entra na mask do próximo tick.
+        ems::engine::fuel_inj_duty_update(final_pw_us, snap.rpm_x10, 2u);
+
+        const uint32_t inj_pw_ticks = ems::engine::inj_pw_us_to_scheduler_ticks(final_pw_us);
+
+        ::ecu_sched_commit_calibration_cyl(
+            static_cast<uint32_t>(sched_spark_deg < 0 ? 0 : sched_spark_deg),
+            dwell_ticks,
+            inj_pw_ticks,
+            static_cast<uint32_t>(ems::engine::calc_eoi_lead_deg(snap.rpm_x10)),
+            &cyl_vec);
+    } else if (allow_half_crank_batch) {
+        // (2) HALF_SYNC + cranking: simultaneous batch, crank PW only (no VE/STFT/AE).
+        // Presync auto already selects SIMULTANEOUS while is_cranking().
+        // Force mode in case auto was off or race with tooth ISR.
+        ::ecu_sched_set_presync_inj_mode(ECU_PRESYNC_INJ_SIMULTANEOUS);
+        ems::engine::misfire_set_all_inhibit(true);
+        g_ae_active = false;
+        ems::engine::transient_fuel_reset();
+
+        const uint32_t req_us = ems::engine::default_req_fuel_us();
+        const uint32_t crank_flow_us = ems::engine::quick_crank_apply_pw_us(
+            req_us, qc.fuel_mult_x256, qc.min_pw_us);
+        g_last_net_pw_us = crank_flow_us;
+        ems::engine::g_fuel_pw_breakdown = {};
+        const uint32_t final_pw_us = ems::engine::fuel_pw_kernel_injector(
+            crank_flow_us, fuel_snap, &ems::engine::g_fuel_pw_breakdown);
+        const uint32_t pw_100 = final_pw_us / 100u;
+        g_last_pw_ms_x10 = fuel_cut_active ? 0u
+            : static_cast<uint8_t>(pw_100 > 255u ? 255u : pw_100);
+        const int16_t sched_spark_deg = ems::engine::crank_spark_deg;
+        g_last_advance_deg = clamp_i8(sched_spark_deg, -10, 40);
+        const uint32_t inj_pw_ticks =
+            ems::engine::inj_pw_us_to_scheduler_ticks(final_pw_us);
+        ::ecu_sched_commit_calibration(
+            static_cast<uint32_t>(sched_spark_deg < 0 ? 0 : sched_spark_deg),
+            dwell_ticks,
+            inj_pw_ticks,
+            static_cast<uint32_t>(ems::engine::calc_eoi_lead_deg(snap.rpm_x10)));
+    } else if (sched_sync &&
+               (fuel_protect_cut || half_fuel_lockout || g_rev_limit_active)) {
+        // (3) Spark-only: exit-crank HALF, flood, protect, rev-limit, anomaly path.
+        // qc already updated — use crank spark only while still latched cranking.
+        // Mapa aprendido de knock no ponto do spark_table, como em (1).
+        g_spark_load_bar_x100 = map_bar_x100;
+        const int16_t knock_learn_deg = static_cast<int16_t>(
+            (ems::engine::knock_learn_retard_x10_at(snap.rpm_x10, map_bar_x100) + 5u) / 10u);
+        const int16_t base_advance_deg = static_cast<int16_t>(
+            ems::engine::get_advance(snap.rpm_x10, map_bar_x100) - knock_learn_deg);
+        // Vector com fluxo 0: o limitador de rotação/protect corre em carga
+        // plena — o retardo de knock fica por cilindro como no caminho (1).
+        EcuSchedCylVector cyl_vec;
+        const int16_t sched_spark_deg = ems::engine::cyl_pulse_build(
+            {0u, fuel_snap.dead_time_us,
+             qc.cranking ? ems::engine::crank_spark_deg : base_advance_deg,
+             map_bar_x100, !qc.cranking},
+            &cyl_vec);
+        ::ecu_sched_commit_calibration_cyl(
+            static_cast<uint32_t>(sched_spark_deg < 0 ? 0 : sched_spark_deg),
+            dwell_ticks,
+            0u,
+            static_cast<uint32_t>(ems::engine::calc_eoi_lead_deg(snap.rpm_x10)),
+            &cyl_vec);
+        g_last_pw_ms_x10 = 0u;
+        g_last_net_pw_us = 0u;
+        g_last_advance_deg = clamp_i8(sched_spark_deg, -10, 40);
+        g_ae_active = false;
+    }
+    g_prev_tps_pct_x10 = sensors.etb_tps_pct_x10;
+    ems::app::ui_update_rt_map_fuel(map_bar_x100, g_last_net_pw_us);
+    g_last_map_fused_x100 = map_bar_x100;
+
+    // Prime one-shot: suppressed on flood-clear, fuel-protect (MAP/oil/rail/
+    // overtemp/diag/rev limp), and whenever inj mask already locks all cyls.
+    // force_output also honors the mask (defense in depth vs bypass).
+    const bool prime_blocked =
+        flood_clear || fuel_protect_cut || half_fuel_lockout ||
+        g_rev_limit_active;
+    const uint32_t prime_pw = prime_blocked
+        ? 0u
+        : ems::engine::quick_crank_consume_prime();
+    if (prime_pw != 0u && !ems::engine::output_test_active()) {
+        ::ecu_sched_fire_prime_pulse(prime_pw);
+    } else if (prime_blocked) {
+        // Drop pending prime so protect/flood cannot fire after condition clears mid-tooth.
+        static_cast<void>(ems::engine::quick_crank_consume_prime());
+    }
 
-            // EWG position inner loop (2ms cadence)
-            if (!ems::engine::output_test_active()) {
-                const uint16_t demand = ems::engine::auxiliaries_ewg_position_demand_x10();
-                const uint16_t pos = ems::engine::ewg_read_position_pct_x10();
-                ems::engine::ewg_control_update(demand, pos);
-            }
+    // EWG position inner loop (2ms cadence)
+    if (!ems::engine::output_test_active()) {
+        const uint16_t demand = ems::engine::auxiliaries_ewg_position_demand_x10();
+        const uint16_t pos = ems::engine::ewg_read_position_pct_x10();
+        ems::engine::ewg_control_update(demand, pos);
+    }
+
+    // Misfire por cinemática: resumos por cilindro do anel da ISR; o corte
+    // de desaceleração (sem binário) ensina o padrão do volante.
+    ems::engine::misfire_process(snap.rpm_x10, map_bar_x100,
+                                 full_sync && ems::engine::fuel_decel_cut_active());
+    // Geometria por dente: arma lotes em corte/cruzeiro, integra os completos.
+    ems::drv::tooth_geom_update(snap.rpm_x10, ems::engine::fuel_decel_cut_active(),
+                                full_sync);
+
+    // Telemetria CAN FD: 1 frame por ciclo de 720° (no-op em clássico)
+    ems::app::can_fd_telemetry_process(snap);
+
+    g_loop2ms_last_us = micros() - loop2ms_start_us;
+    if (g_loop2ms_last_us > g_loop2ms_max_us) {
+        g_loop2ms_max_us = g_loop2ms_last_us;
+    }
+    ems::app::ui_update_loop_diag(g_loop2ms_last_us, g_loop2ms_max_us);
+}
 
-            g_loop2ms_last_us = micros() - loop2ms_start_us;
-            if (g_loop2ms_last_us > g_loop2ms_max_us) {
-                g_loop2ms_max_us = g_loop2ms_last_us;
+// 2 ms: torque manager + PID ETB (parado durante o teste de saídas).
+static void task_etb_2ms(uint32_t) noexcept {
+    // Taxa da malha alterada pelo protocolo → re-arranca a ISR do TIM7.
+    if (g_etb_initialized && ems::engine::etb_loop_rate_hz != g_etb_loop_rate_applied) {
+        g_etb_loop_rate_applied = ems::engine::etb_loop_rate_hz;
+        ems::engine::etb_loop_init(g_etb_loop_rate_applied);
+    }
+    if (ems::engine::output_test_active()) {
+        ems::engine::etb_loop_release();
+        return;
+    }
+    const auto sensors_etb = ems::drv::sensors_get();
+    const auto snap_etb = ems::drv::ckp_snapshot();
+    // Auto-cal power-on em curso: varre batentes e pula torque/PID.
+    if (ems::engine::etb_autocal_active()) {
+        ems::engine::etb_loop_release();
+        ems::engine::etb_autocal_tick(2u, snap_etb.rpm_x10);
+    } else {
+        const bool etb_rev_cut = g_limp_active && (snap_etb.rpm_x10 > kLimpRpmLimit_x10);
+        const auto torque_out = ems::engine::torque_manager_update(
+            snap_etb, sensors_etb, true, g_limp_active, etb_rev_cut,
+            ems::engine::auxiliaries_idle_target_rpm_x10(sensors_etb.clt_degc_x10), 2u);
+        g_torque_spark_retard_deg = torque_out.spark_retard_deg;
+        if (ems::engine::etb_loop_running()) {
+            // PID na ISR do TIM7: o torque manager só escreve o setpoint.
+            ems::engine::etb_loop_set_target(
+                torque_out.etb_target_pct_x10,
+                torque_out.etb_enable_request && g_etb_initialized);
+            return;
+        }
+        const auto etb = ems::engine::etb_control_update(
+            torque_out.etb_target_pct_x10, sensors_etb.etb_tps_pct_x10,
+            torque_out.etb_enable_request, 2u);
+        // Apply PID → H-bridge. On disable/fault/no-cal, spring-return safe.
+        if (!torque_out.etb_enable_request || !etb.active || !g_etb_initialized) {
+            ::etb_driver_shutdown();
+        } else {
+            // output_pct_x10 ∈ [-1000, 1000] → driver PWM ∈ [-1023, 1023]
+            int32_t pwm = (static_cast<int32_t>(etb.output_pct_x10) * 1023) / 1000;
+            if (pwm > 1023) { pwm = 1023; }
+            if (pwm < -1023) { pwm = -1023; }
+            if (!::etb_driver_set_motor_pwm(static_cast<int16_t>(pwm))) {
+                ::etb_driver_shutdown();
             }
-            ems::app::ui_update_loop_diag(g_loop2ms_last_us, g_loop2ms_max_us);
         }
+    }
+}
 
-        // ── 10ms: VVT, wastegate PID ─────────────────────────────────────
-        if (elapsed(now, g_t10ms_, 10u)) {
-            g_t10ms_ = now;
-            ems::engine::auxiliaries_tick_10ms();
-        }
+// 10 ms: VVT, wastegate PID.
+static void task_aux_10ms(uint32_t) noexcept {
+    ems::engine::auxiliaries_tick_10ms();
+}
 
-        // ── 20ms: UI proprietaria + aux tasks ───────────────────────────
-        if (elapsed(now, g_t20ms_, 20u)) {
-            g_t20ms_ = now;
-            const auto snap = ems::drv::ckp_snapshot();
-            const auto sensors = ems::drv::sensors_get();
-            ems::app::ui_update_rt_metrics(
-	            // In presync+SIMULTANEOUS the scheduler halves PW per pulse
-	            (!ecu_sched_is_sequential() && ecu_sched_presync_inj_mode() == 0u)
-	                ? static_cast<uint8_t>(g_last_pw_ms_x10 / 2u) : g_last_pw_ms_x10,
-	            g_last_advance_deg, g_last_stft_pct,
-                                           g_last_lambda_target_d4, g_last_ltft_pct);
-            ems::app::ui_update_rt_sched_diag(
-                g_late_event_count,
-                g_cycle_schedule_drop_count,
-                g_calibration_clamp_count,
-                ems::drv::ckp_seed_loaded_count(),
-                ems::drv::ckp_seed_confirmed_count(),
-                ems::drv::ckp_seed_rejected_count(),
-                static_cast<uint8_t>(snap.state));
-            // Transporte (UART+USB RX/TX/parse) vive em comms_pump() a 2 ms.
-            ems::engine::auxiliaries_tick_20ms();
-            ems::app::can_stack_process(now, snap, sensors,
-                                        g_last_advance_deg,
-                                        g_last_pw_ms_x10,
-                                        g_last_stft_pct,
-                                        0u, 0u,
-                                        build_status_bits(snap, sensors));
-        }
+// 50 ms: sensores lentos.
+static void task_sensors_50ms(uint32_t) noexcept {
+    ems::drv::sensors_tick_50ms();
+}
 
-        // ── 50ms: sensores lentos ──────────────────────────────────────────
-        if (elapsed(now, g_t50ms_, 50u)) {
-            g_t50ms_ = now;
-            ems::drv::sensors_tick_50ms();
-        }
+// 100 ms: sensores, diag TLE8888, knock morto, flex, baro, DTC de misfire.
+static void task_sensors_100ms(uint32_t now) noexcept {
+    ems::drv::sensors_tick_100ms();
+    ems::engine::diagnostic_tick(100u);
+    ems::hal::tle8888_poll_diag();
 
-        // ── 100ms: sensores + STFT + misfire report + baro ──────────────
-        if (elapsed(now, g_t100ms_, 100u)) {
-            g_t100ms_ = now;
-            ems::drv::sensors_tick_100ms();
-            ems::hal::tle8888_poll_diag();
-
-            // Knock sensor morto (FOME #578): report único na transição.
-            {
-                static bool s_knock_dead_reported = false;
-                const bool dead = ems::engine::knock_sensor_dead();
-                if (dead && !s_knock_dead_reported) {
-                    ems::engine::DiagnosticManager::report_fault(
-                        ems::engine::DiagnosticCode::KNOCK_SENSOR_FAULT,
-                        ems::engine::FaultSeverity::WARNING);
-                    s_knock_dead_reported = true;
-                } else if (!dead) {
-                    s_knock_dead_reported = false;
-                }
-            }
+    // Knock sensor morto (FOME #578): report único na transição.
+    {
+        static bool s_knock_dead_reported = false;
+        const bool dead = ems::engine::knock_sensor_dead();
+        if (dead && !s_knock_dead_reported) {
+            ems::engine::DiagnosticManager::report_fault(
+                ems::engine::DiagnosticCode::KNOCK_SENSOR_FAULT,
+                ems::engine::FaultSeverity::WARNING);
+            s_knock_dead_reported = true;
+        } else if (!dead) {
+            s_knock_dead_reported = false;
+        }
+    }
 
-            // Flex fuel: update stoich AFR based on ethanol %
-            // E0=14.7 (1470), E100=9.0 (900), linear
-            if (ems::hal::flex_fuel_valid()) {
-                const uint16_t eth = ems::hal::flex_fuel_ethanol_pct();
-                ems::engine::cfg::g_eng_cfg.stoich_afr_x100 =
-                    static_cast<uint16_t>(1470u - (eth * 570u) / 100u);
-            }
-            const auto snap    = ems::drv::ckp_snapshot();
-            const auto sensors = ems::drv::sensors_get();
-
-            // Compensação barométrica: amostrar MAP enquanto motor parado.
-            // Aguarda 300ms estabilizado antes de aceitar a leitura (ADC settle).
-            if (snap.rpm_x10 == 0u) {
-                if (g_baro_stopped_since_ms == 0u) {
-                    g_baro_stopped_since_ms = now;
-                    g_baro_sampled = false;
-                } else if (!g_baro_sampled &&
-                           (now - g_baro_stopped_since_ms) >= 300u) {
-                    const uint16_t map_baro = clamp_u16(
-                        static_cast<uint16_t>(sensors.map_bar_x1000 / 10u),
-                        70u, 110u);
-                    ems::engine::fuel_set_baro_bar_x100(map_baro);
-                    g_baro_sampled = true;
-                }
-            } else {
-                g_baro_stopped_since_ms = 0u;
-            }
+    // Flex fuel: update stoich AFR based on ethanol %
+    // E0=14.7 (1470), E100=9.0 (900), linear
+    if (ems::hal::flex_fuel_valid()) {
+        const uint16_t eth = ems::hal::flex_fuel_ethanol_pct();
+        const uint16_t stoich = static_cast<uint16_t>(1470u - (eth * 570u) / 100u);
+        if (stoich != ems::engine::cfg::g_eng_cfg.stoich_afr_x100) {
+            ems::engine::cfg::g_eng_cfg.stoich_afr_x100 = stoich;
+            ems::engine::fuel_pw_kernel_invalidate();  // REQ_FUEL mudou
+        }
+    }
+    const auto snap    = ems::drv::ckp_snapshot();
+    const auto sensors = ems::drv::sensors_get();
+
+    // Compensação barométrica: amostrar MAP enquanto motor parado.
+    // Aguarda 300ms estabilizado antes de aceitar a leitura (ADC settle).
+    if (snap.rpm_x10 == 0u) {
+        if (g_baro_stopped_since_ms == 0u) {
+            g_baro_stopped_since_ms = now;
+            g_baro_sampled = false;
+        } else if (!g_baro_sampled &&
+                   (now - g_baro_stopped_since_ms) >= 300u) {
+            const uint16_t map_baro = clamp_u16(
+                static_cast<uint16_t>(sensors.map_bar_x1000 / 10u),
+                70u, 110u);
+            ems::engine::fuel_set_baro_bar_x100(map_baro);
+            g_baro_sampled = true;
+        }
+    } else {
+        g_baro_stopped_since_ms = 0u;
+    }
 
-            // Misfire: reporte de DTCs acumulados no período de 100ms
-            if (snap.state == ems::drv::SyncState::FULL_SYNC) {
-                constexpr ems::engine::DiagnosticCode kMisfireCodes[4] = {
-                    ems::engine::DiagnosticCode::MISFIRE_CYLINDER_1,
-                    ems::engine::DiagnosticCode::MISFIRE_CYLINDER_2,
-                    ems::engine::DiagnosticCode::MISFIRE_CYLINDER_3,
-                    ems::engine::DiagnosticCode::MISFIRE_CYLINDER_4,
-                };
-                for (uint8_t c = 0u; c < 4u; ++c) {
-                    if (ems::engine::misfire_get_event_count(c) >=
-                        ems::engine::kMisfireFaultThreshold) {
-                        ems::engine::DiagnosticManager::report_fault(
-                            kMisfireCodes[c],
-                            ems::engine::FaultSeverity::WARNING);
-                        ems::engine::misfire_clear_events(c);
-                    }
-                }
+    // Misfire: reporte de DTCs acumulados no período de 100ms
+    if (snap.state == ems::drv::SyncState::FULL_SYNC) {
+        constexpr ems::engine::DiagnosticCode kMisfireCodes[8] = {
+            ems::engine::DiagnosticCode::MISFIRE_CYLINDER_1,
+            ems::engine::DiagnosticCode::MISFIRE_CYLINDER_2,
+            ems::engine::DiagnosticCode::MISFIRE_CYLINDER_3,
+            ems::engine::DiagnosticCode::MISFIRE_CYLINDER_4,
+            ems::engine::DiagnosticCode::MISFIRE_CYLINDER_5,
+            ems::engine::DiagnosticCode::MISFIRE_CYLINDER_6,
+            ems::engine::DiagnosticCode::MISFIRE_CYLINDER_7,
+            ems::engine::DiagnosticCode::MISFIRE_CYLINDER_8,
+        };
+        for (uint8_t c = 0u; c < ems::engine::cfg::kCylinderCount; ++c) {
+            if (ems::engine::misfire_get_event_count(c) >=
+                ems::engine::kMisfireFaultThreshold) {
+                ems::engine::DiagnosticManager::report_fault(
+                    kMisfireCodes[c],
+                    ems::engine::FaultSeverity::WARNING);
+                ems::engine::misfire_clear_events(c);
             }
+        }
+    }
+}
 
-            if (snap.state == ems::drv::SyncState::FULL_SYNC) {
-                // MAP fundido (mesma fonte do cálculo de combustível de 2ms):
-                // o cru daqui divergia na fronteira de célula → alvo λ do
-                // gauge oscilava sem o ponto de operação mudar.
-                const uint16_t map_bar_x100 = clamp_u16(
-                    g_last_map_fused_x100, kMapMinBarX100, kMapMaxBarX100);
-                const uint16_t lambda_measured = clamp_u16(
-                    ems::app::can_stack_lambda_milli_safe(now), kLambdaMinMilli, kLambdaMaxMilli);
-                const bool lambda_valid = ems::app::can_stack_wbo2_fresh(now);
-                const uint16_t lambda_target_x1000 =
-                    ems::engine::get_lambda_target_x1000(snap.rpm_x10, map_bar_x100);
-                const bool rev_cut = g_limp_active &&
-                    (snap.rpm_x10 > kLimpRpmLimit_x10);
-                const bool ae_active = g_ae_active;
-                // STFT congelado em qualquer condição de corte intencional de combustível:
-                // - rev_cut: limp mode
-                // - decel_cut: borboleta fechada em desaceleração
-                // - inj_inhibit_mask != 0: rev limiter cortou injeção em ≥1 cilindro
-                //   (lambda leria lean sem combustível → STFT aprenderia errado)
-                const bool stft_inhibit = rev_cut ||
-                    ems::engine::fuel_decel_cut_active() ||
-                    (::ecu_sched_get_inj_inhibit_mask() != 0u);
-                // APP (pedido do condutor) para estabilidade do acumulador LTFT:
-                // ETB mexe sozinho em idle e rejeitaria hits sem o condutor mexer.
-                // Célula continua a ser (MAP, RPM); APP só filtra regime.
-                const int16_t stft = ems::engine::fuel_update_stft_delayed(
-                    now, snap.rpm_x10, map_bar_x100,
-                    static_cast<int16_t>(lambda_target_x1000),
-                    static_cast<int16_t>(lambda_measured),
-                    sensors.clt_degc_x10, lambda_valid,
-                    ae_active, stft_inhibit, g_last_net_pw_us,
-                    sensors.app_pct_x10);
-                g_ae_active = false;
-                g_last_stft_pct = clamp_i8(static_cast<int16_t>(stft / 10), -25, 25);
-                // ÷5 (não ÷4): ÷4 saturava o u8 em 1020 — alvos 1.02-1.27 exibiam 1.02
-                g_last_lambda_target_d4 = ems::engine::clamp_u8(lambda_target_x1000 / 5u);
-                g_last_ltft_pct = clamp_i8(
-                    ems::engine::fuel_get_ltft_at(snap.rpm_x10, map_bar_x100) / 10,
-                    -25, 25);
-
-                // X-τ learn (100ms): exige transiente real (tpsdot) E gates de
-                // qualidade λ/STFT/RPM. Nunca tratar "learning_ok" sozinho como
-                // is_transient — isso corrompia a tabela 2D em regime estável.
-                const bool xtau_learning_ok = (stft >= -500 && stft <= 500 &&
-                    lambda_valid && snap.rpm_x10 >= 20000u);
-                const bool xtau_transient = ems::engine::map_is_transient() &&
-                    xtau_learning_ok && !ae_active;
-                ems::engine::xtau_autocalib_update(
-                    snap.rpm_x10,
-                    map_bar_x100,  // MAP fundido (mesma fonte do PW 2ms)
-                    static_cast<int16_t>(lambda_target_x1000),
-                    static_cast<int16_t>(ems::app::can_stack_lambda_milli_safe(now)),
-                    sensors.clt_degc_x10,
-                    xtau_transient);
-            } else {
-                g_last_stft_pct = 0;
-            }
+// 100 ms: STFT + X-τ learn + runtime seed.
+static void task_trim_100ms(uint32_t now) noexcept {
+    const auto snap    = ems::drv::ckp_snapshot();
+    const auto sensors = ems::drv::sensors_get();
+    
+    if (snap.state == ems::drv::SyncState::FULL_SYNC) {
+        // MAP fundido (mesma fonte do cálculo de combustível de 2ms):
+        // o cru daqui divergia na fronteira de célula → alvo λ do
+        // gauge oscilava sem o ponto de operação mudar.
+        const uint16_t map_bar_x100 = clamp_u16(
+            g_last_map_fused_x100, kMapMinBarX100, kMapMaxBarX100);
+        const uint16_t lambda_measured = clamp_u16(
+            ems::app::can_stack_lambda_milli_safe(now), kLambdaMinMilli, kLambdaMaxMilli);
+        const bool lambda_valid = ems::app::can_stack_wbo2_fresh(now);
+        const uint16_t lambda_target_x1000 =
+            ems::engine::get_lambda_target_x1000(snap.rpm_x10, map_bar_x100);
+        const bool rev_cut = g_limp_active &&
+            (snap.rpm_x10 > kLimpRpmLimit_x10);
+        const bool ae_active = g_ae_active;
+        // STFT congelado em qualquer condição de corte intencional de combustível:
+        // - rev_cut: limp mode
+        // - decel_cut: borboleta fechada em desaceleração
+        // - inj_inhibit_mask != 0: rev limiter cortou injeção em ≥1 cilindro
+        //   (lambda leria lean sem combustível → STFT aprenderia errado)
+        const bool stft_inhibit = rev_cut ||
+            ems::engine::fuel_decel_cut_active() ||
+            (::ecu_sched_get_inj_inhibit_mask() != 0u);
+        // APP (pedido do condutor) para estabilidade do acumulador LTFT:
+        // ETB mexe sozinho em idle e rejeitaria hits sem o condutor mexer.
+        // Célula continua a ser (MAP, RPM); APP só filtra regime.
+        const int16_t stft = ems::engine::fuel_update_stft_delayed(
+            now, snap.rpm_x10, map_bar_x100,
+            static_cast<int16_t>(lambda_target_x1000),
+            static_cast<int16_t>(lambda_measured),
+            sensors.clt_degc_x10, lambda_valid,
+            ae_active, stft_inhibit, g_last_net_pw_us,
+            sensors.app_pct_x10);
+        g_ae_active = false;
+        g_last_stft_pct = clamp_i8(static_cast<int16_t>(stft / 10), -25, 25);
+        // ÷5 (não ÷4): ÷4 saturava o u8 em 1020 — alvos 1.02-1.27 exibiam 1.02
+        g_last_lambda_target_d4 = ems::engine::clamp_u8(lambda_target_x1000 / 5u);
+        g_last_ltft_pct = clamp_i8(
+            ems::engine::fuel_get_ltft_at(snap.rpm_x10, map_bar_x100) / 10,
+            -25, 25);
+
+        // X-τ learn (100ms): exige transiente real (tpsdot) E gates de
+        // qualidade λ/STFT/RPM. Nunca tratar "learning_ok" sozinho como
+        // is_transient — isso corrompia a tabela 2D em regime estável.
+        const bool xtau_learning_ok = (stft >= -500 && stft <= 500 &&
+            lambda_valid && snap.rpm_x10 >= 20000u);
+        const bool xtau_transient = ems::engine::map_is_transient() &&
+            xtau_learning_ok && !ae_active;
+        ems::engine::xtau_autocalib_update(
+            snap.rpm_x10,
+            map_bar_x100,  // MAP fundido (mesma fonte do PW 2ms)
+            static_cast<int16_t>(lambda_target_x1000),
+            static_cast<int16_t>(ems::app::can_stack_lambda_milli_safe(now)),
+            sensors.clt_degc_x10,
+            xtau_transient);
+    } else {
+        g_last_stft_pct = 0;
+    }
 
-            // Runtime seed — salva posição para re-sincronização rápida
-            const uint32_t rpm = snap.rpm_x10;
-            if (rpm > 0u) {
-                g_engine_was_running = true;
-                g_zero_rpm_since_ms  = 0u;
-                g_runtime_seed_saved_for_stop = false;
-            } else {
-                if (g_engine_was_running && g_zero_rpm_since_ms == 0u) {
-                    g_zero_rpm_since_ms = now;
-                }
-                if (g_engine_was_running && !g_runtime_seed_saved_for_stop &&
-                    g_zero_rpm_since_ms != 0u &&
-                    elapsed(now, g_zero_rpm_since_ms, kRuntimeSeedSaveDelayMs) &&
-                    g_have_last_gap_sync) {
-                    const auto seed_snap = g_last_gap_sync_snapshot;
-                    ems::hal::RuntimeSyncSeed seed = {};
-                    seed.flags = static_cast<uint8_t>(
-                        ems::hal::RUNTIME_SYNC_SEED_FLAG_VALID |
-                        ems::hal::RUNTIME_SYNC_SEED_FLAG_FULL_SYNC |
-                        (seed_snap.phase_A
-                             ? ems::hal::RUNTIME_SYNC_SEED_FLAG_PHASE_A : 0u));
-                    seed.tooth_index = seed_snap.tooth_index;
-                    seed.decoder_tag =
-                        ems::hal::RUNTIME_SYNC_SEED_DECODER_TAG_60_2;
+    // Runtime seed — salva posição para re-sincronização rápida
+    const uint32_t rpm = snap.rpm_x10;
+    if (rpm > 0u) {
+        g_engine_was_running = true;
+        g_zero_rpm_since_ms  = 0u;
+        g_runtime_seed_saved_for_stop = false;
+    } else {
+        if (g_engine_was_running && g_zero_rpm_since_ms == 0u) {
+            g_zero_rpm_since_ms = now;
+        }
+        if (g_engine_was_running && !g_runtime_seed_saved_for_stop &&
+            g_zero_rpm_since_ms != 0u &&
+            elapsed(now, g_zero_rpm_since_ms, kRuntimeSeedSaveDelayMs) &&
+            g_have_last_gap_sync) {
+            const auto seed_snap = g_last_gap_sync_snapshot;
+            ems::hal::RuntimeSyncSeed seed = {};
+            seed.flags = static_cast<uint8_t>(
+                ems::hal::RUNTIME_SYNC_SEED_FLAG_VALID |
+                ems::hal::RUNTIME_SYNC_SEED_FLAG_FULL_SYNC |
+                (seed_snap.phase_A
+                     ? ems::hal::RUNTIME_SYNC_SEED_FLAG_PHASE_A : 0u));
+            seed.tooth_index = seed_snap.tooth_index;
+            seed.decoder_tag =
+                ems::hal::RUNTIME_SYNC_SEED_DECODER_TAG_60_2;
 	if (!ems::hal::nvm_save_runtime_seed(&seed)) {
 		// FIX: não descartar retorno — falha de flash deve ser rastreada
 		++g_flash_write_faults; // fault counter para diagnóstico
 	}
 	g_runtime_seed_saved_for_stop = true;
-                }
-            }
         }
+    }
+}
 
-        // ── 500ms: agenda flush Flash + LED heartbeat (PB2 WeAct blue LED) ─
-        // PB2 = LED blue on-board da WeAct STM32H562 LQFP100.
-        // FIX P0: Only allow flash writes when engine is stopped or below safe RPM
-        static bool adaptive_flush_pending = false;
-        static uint32_t last_calib_save_ms = 0u;
-        ems::hal::nvm_set_now_ms(now);
-        if (elapsed(now, g_t500ms_, 500u)) {
-            g_t500ms_ = now;
-            // LED heartbeat: toggle PB2 a cada 500ms (1 Hz)
-            GPIOB_MODER = (GPIOB_MODER & ~(3u << 4u)) | (1u << 4u);
-            GPIOB_ODR ^= (1u << 2u);  // toggle PB2
-            const auto snap = ems::drv::ckp_snapshot();
-            // FIX: gate ALL flash writes behind the same RPM threshold — calibration
-            // writes had no RPM check, creating a latent bug (see Blocker #3).
-            const bool engine_running_fast = (snap.rpm_x10 > ems::engine::kFlashWriteSafeRpmX10);
-            if (!engine_running_fast) {
-                if (g_calib_dirty &&
-                    (last_calib_save_ms == 0u ||
-                     elapsed(now, last_calib_save_ms, kCalibSaveMinIntervalMs))) {
-                    ems::engine::cfg::engine_config_serialize(g_calib_page0, kCalibPageBytes);
-                    if (ems::hal::nvm_save_calibration(0u, g_calib_page0,
-                                                       kCalibPageBytes)) {
-                        g_calib_dirty = false;
-                        last_calib_save_ms = now;
-                    }
-                }
-                // Adaptive LTFT/knock: só agenda se dirty (rate-limit dentro do flush).
-                if (ems::hal::nvm_adaptive_maps_dirty()) {
-                    adaptive_flush_pending = true;
-                }
+// 20 ms: métricas RT do protocolo + aux tasks.
+static void task_rt_ui_20ms(uint32_t) noexcept {
+    const auto snap = ems::drv::ckp_snapshot();
+    ems::app::ui_update_rt_metrics(
+	            // In presync+SIMULTANEOUS the scheduler halves PW per pulse
+	            (!ecu_sched_is_sequential() && ecu_sched_presync_inj_mode() == 0u)
+	                ? static_cast<uint8_t>(g_last_pw_ms_x10 / 2u) : g_last_pw_ms_x10,
+	            g_last_advance_deg, g_last_stft_pct,
+                                   g_last_lambda_target_d4, g_last_ltft_pct);
+    ems::app::ui_update_rt_sched_diag(
+        g_late_event_count,
+        g_cycle_schedule_drop_count,
+        g_calibration_clamp_count,
+        ems::drv::ckp_seed_loaded_count(),
+        ems::drv::ckp_seed_confirmed_count(),
+        ems::drv::ckp_seed_rejected_count(),
+        static_cast<uint8_t>(snap.state));
+    // Transporte (UART+USB RX/TX/parse) vive em comms_pump() a 2 ms.
+    ems::engine::auxiliaries_tick_20ms();
+}
+
+// 20 ms: CAN (broadcast, RX WBO2/veículo).
+static void task_can_20ms(uint32_t now) noexcept {
+    const auto snap    = ems::drv::ckp_snapshot();
+    const auto sensors = ems::drv::sensors_get();
+    ems::app::can_stack_process(now, snap, sensors,
+                                g_last_advance_deg,
+                                g_last_pw_ms_x10,
+                                g_last_stft_pct,
+                                0u, 0u,
+                                build_status_bits(snap, sensors));
+}
+
+// 500 ms: agenda flush Flash + LED heartbeat (PB2 WeAct blue LED).
+// PB2 = LED blue on-board da WeAct STM32H562 LQFP100.
+static bool g_adaptive_flush_pending = false;
+static uint32_t g_last_calib_save_ms = 0u;
+
+// Errata ES0565: só a primeira operação erase/program após o reset pode
+// congelar o fetch (~120 µs) — essa espera pelo motor parado/lento. Depois
+// dela, o save do page0 e o flush do journal (job fatiado, 1 registo por
+// passo) correm com o motor a rodar: o delta adaptativo não fica preso até
+// ao próximo desligar.
+static bool flash_write_safe(const ems::drv::CkpSnapshot& snap) noexcept {
+    return ems::hal::flash_jobs_primed() ||
+           snap.rpm_x10 <= ems::engine::kFlashWriteSafeRpmX10;
+}
+
+static void task_nvm_500ms(uint32_t now) noexcept {
+    // LED heartbeat: toggle PB2 a cada 500ms (1 Hz)
+    GPIOB_MODER = (GPIOB_MODER & ~(3u << 4u)) | (1u << 4u);
+    GPIOB_ODR ^= (1u << 2u);  // toggle PB2
+    const auto snap = ems::drv::ckp_snapshot();
+    // Todas as escritas (calibração e adaptativo) passam pelo mesmo gate.
+    // Memória de DTCs → shadow NVM (≤ 1/min); o flush segue o gate abaixo.
+    (void)ems::engine::DiagnosticManager::persist_process(now);
+    if (flash_write_safe(snap)) {
+        if (g_calib_dirty &&
+            (g_last_calib_save_ms == 0u ||
+             elapsed(now, g_last_calib_save_ms, kCalibSaveMinIntervalMs))) {
+            ems::engine::cfg::engine_config_serialize(g_calib_page0, kCalibPageBytes);
+            // Burn em background (fila de flash): a página é copiada
+            // no submit; falha reaparece em g_calib_dirty.
+            if (ems::hal::nvm_queue_calibration(0u, g_calib_page0, kCalibPageBytes,
+                                                calib_page0_burn_done, nullptr)) {
+                g_calib_dirty = false;
+                g_last_calib_save_ms = now;
             }
         }
-        if (adaptive_flush_pending) {
-            // Double-check RPM before actually writing (engine may have started)
-            const auto snap = ems::drv::ckp_snapshot();
-            const bool engine_running_fast = (snap.rpm_x10 > ems::engine::kFlashWriteSafeRpmX10);
-            if (!engine_running_fast) {
-                adaptive_flush_pending = !ems::hal::nvm_flush_adaptive_maps();
-            }
+        // Adaptive LTFT/knock: só agenda se dirty (rate-limit dentro do flush).
+        if (ems::hal::nvm_adaptive_maps_dirty()) {
+            g_adaptive_flush_pending = true;
         }
+    }
+}
 
-        // ── Comms pump UART (2ms cadence, fora da medição de loop2) ──────
-        if (elapsed(now, g_t_comms_ms, 2u)) {
-            g_t_comms_ms = now;
-            comms_pump();
-        }
+// Flush dos mapas adaptativos agendado pelo slot de 500 ms.
+static void task_nvm_flush(uint32_t) noexcept {
+    if (!g_adaptive_flush_pending) {
+        return;
+    }
+    // Reavalia o gate: o motor pode ter arrancado antes da 1ª operação.
+    if (flash_write_safe(ems::drv::ckp_snapshot())) {
+        g_adaptive_flush_pending = !ems::hal::nvm_flush_adaptive_maps();
+    }
+}
 
-        // ── ETB control (2ms cadence) ─────────────────────────────────────
-        if (elapsed(now, g_t_etb_ms, 2u) && !ems::engine::output_test_active()) {
-            g_t_etb_ms = now;
-            const auto sensors_etb = ems::drv::sensors_get();
-            const auto snap_etb = ems::drv::ckp_snapshot();
-            // Auto-cal power-on em curso: varre batentes e pula torque/PID.
-            if (ems::engine::etb_autocal_active()) {
-                ems::engine::etb_autocal_tick(2u, snap_etb.rpm_x10);
-            } else {
-                const bool etb_rev_cut = g_limp_active && (snap_etb.rpm_x10 > kLimpRpmLimit_x10);
-                const auto torque_out = ems::engine::torque_manager_update(
-                    snap_etb, sensors_etb, true, g_limp_active, etb_rev_cut,
-                    ems::engine::auxiliaries_idle_target_rpm_x10(sensors_etb.clt_degc_x10), 2u);
-                g_torque_spark_retard_deg = torque_out.spark_retard_deg;
-                const auto etb = ems::engine::etb_control_update(
-                    torque_out.etb_target_pct_x10, sensors_etb.etb_tps_pct_x10,
-                    torque_out.etb_enable_request, 2u);
-                // Apply PID → H-bridge. On disable/fault/no-cal, spring-return safe.
-                if (!torque_out.etb_enable_request || !etb.active || !g_etb_initialized) {
-                    ::etb_driver_shutdown();
-                } else {
-                    // output_pct_x10 ∈ [-1000, 1000] → driver PWM ∈ [-1023, 1023]
-                    int32_t pwm = (static_cast<int32_t>(etb.output_pct_x10) * 1023) / 1000;
-                    if (pwm > 1023) { pwm = 1023; }
-                    if (pwm < -1023) { pwm = -1023; }
-                    if (!::etb_driver_set_motor_pwm(static_cast<int16_t>(pwm))) {
-                        ::etb_driver_shutdown();
-                    }
-                }
-            }
+// Comms pump UART+USB (fora da medição de loop2).
+static void task_comms(uint32_t) noexcept {
+    comms_pump();
+}
+
+// Fila de flash: burns + flush do journal em fatias de kFlashJobSliceUs —
+// erase/program nunca bloqueiam o loop.
+static void task_flash_jobs(uint32_t) noexcept {
+    static_cast<void>(ems::hal::nvm_jobs_process(ems::hal::kFlashJobSliceUs));
+    // Rollback do page0 concluído neste passo: a imagem local ainda tem a
+    // cópia retirada — um re-burn pendente gravá-la-ia de novo.
+    if (ems::app::ui_take_page0_reload()) {
+        if (ems::hal::nvm_load_calibration(0u, g_calib_page0, kCalibPageBytes)) {
+            calib_page0_apply();
+            g_calib_dirty = false;
+        } else {
+            ++g_flash_write_faults;
         }
     }
 }
 
+// Fila SPI do TLE8888: recolhe o burst DMA concluído (callbacks de diag) e
+// arranca o seguinte — nunca espera pelo SPI.
+static void task_spi_jobs(uint32_t) noexcept {
+    static_cast<void>(ems::hal::spi_jobs_step());
+}
+
+// Ordem na mesma prioridade = ordem da tabela: fuel antes do ETB (o retardo
+// de torque do ETB entra no avanço do passo seguinte, como antes). Só kLow
+// (NVM, comms, fila de flash) é adiado quando o frame de 2 ms aperta.
+using ems::app::LoopPrio;
+static constexpr ems::app::LoopTask kLoopTasks[] = {
+    {"fuel_ign",  task_fuel_ign_2ms,    2u, LoopPrio::kCritical, 600u},
+    {"etb",       task_etb_2ms,         2u, LoopPrio::kCritical, 150u},
+    {"aux_10",    task_aux_10ms,       10u, LoopPrio::kHigh,     150u},
+    {"sens_50",   task_sensors_50ms,   50u, LoopPrio::kHigh,     100u},
+    {"sens_100",  task_sensors_100ms, 100u, LoopPrio::kHigh,     200u},
+    {"rt_ui",     task_rt_ui_20ms,     20u, LoopPrio::kNormal,   100u},
+    {"can",       task_can_20ms,       20u, LoopPrio::kNormal,   200u},
+    {"trim_100",  task_trim_100ms,    100u, LoopPrio::kNormal,   250u},
+    {"spi_jobs",  task_spi_jobs,        2u, LoopPrio::kNormal,    30u},
+    {"nvm_500",   task_nvm_500ms,     500u, LoopPrio::kLow,      250u},
+    {"nvm_flush", task_nvm_flush,       2u, LoopPrio::kLow,      300u},
+    {"comms",     task_comms,           2u, LoopPrio::kLow,      400u},
+    {"flash_job", task_flash_jobs,      2u, LoopPrio::kLow,      300u},
+};
+static_assert(sizeof(kLoopTasks) / sizeof(kLoopTasks[0]) <= ems::app::kLoopSchedMaxTasks,
+              "kLoopTasks excede kLoopSchedMaxTasks");
+
+// Estatísticas por tarefa (runs/overruns/late/sheds/max_us) via debugger.
+static ems::app::LoopScheduler g_loop_sched(
+    kLoopTasks, static_cast<uint8_t>(sizeof(kLoopTasks) / sizeof(kLoopTasks[0])), micros);
+
+// =============================================================================
+// main() — substituição do setup()/loop() do STM32 runtime
+// =============================================================================
+
+int main() {
+    openems_init();
+
+    g_loop_sched.start(millis());
+
+    // Estreitar IWDG de 10s (boot) para 100ms (runtime): o main loop kica a cada
+    // ciclo; 100ms detecta travamento de runtime sem tolerar os inits longos do boot.
+    // Nota: IWDG_PR segue /256 (boot) → RLR=99 dá ~0.8s efetivo; suficiente p/ runtime
+    // e evita esperar PVU/RVU de novo no caminho crítico.
+    IWDG_KR  = IWDG_KR_ACCESS;
+    IWDG_RLR = IWDG_RLR_100MS;
+    IWDG_KR  = IWDG_KR_REFRESH;
+
+    for (;;) {
+        // ── Watchdog kick (primeiro statement) ───────────────────────────
+        iwdg_kick();
+        g_datalog_us = micros();
+
+        const uint32_t now = millis();
+        ems::hal::nvm_set_now_ms(now);
+
+        // ── Tarefas periódicas (kLoopTasks) ──────────────────────────────
+        static_cast<void>(g_loop_sched.run(now));
+    }
+}
+
 #endif  // TARGET_STM32H562
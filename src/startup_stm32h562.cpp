@@ -12,6 +12,7 @@ extern "C" uint32_t _ebss;
 
 extern "C" void Default_Handler();
 extern "C" [[noreturn]] void Reset_Handler();
+extern "C" void PendSV_Handler()             noexcept __attribute__((weak, alias("Default_Handler")));
 extern "C" void SysTick_Handler()            noexcept __attribute__((weak, alias("Default_Handler")));
 extern "C" void ADC1_IRQHandler()            noexcept __attribute__((weak, alias("Default_Handler")));
 extern "C" void ADC2_IRQHandler()            noexcept __attribute__((weak, alias("Default_Handler")));
@@ -21,6 +22,7 @@ extern "C" void TIM1_CC_IRQHandler()         noexcept __attribute__((weak, alias
 extern "C" void TIM2_IRQHandler()            noexcept __attribute__((weak, alias("Default_Handler")));
 extern "C" void TIM3_IRQHandler()            noexcept __attribute__((weak, alias("Default_Handler")));
 extern "C" void TIM5_IRQHandler()            noexcept __attribute__((weak, alias("Default_Handler")));
+extern "C" void TIM7_IRQHandler()            noexcept __attribute__((weak, alias("Default_Handler")));
 extern "C" void USB_IRQHandler()             noexcept __attribute__((weak, alias("Default_Handler")));
 extern "C" void EXTI5_9_IRQHandler()        noexcept __attribute__((weak, alias("Default_Handler")));
 
@@ -108,7 +110,7 @@ Handler const g_vector_table[] = {
     Default_Handler,
     Default_Handler,
     nullptr,
-    Default_Handler,
+    PendSV_Handler,
     SysTick_Handler,
     // IRQ0..IRQ15
     Default_Handler, Default_Handler, Default_Handler, Default_Handler,
@@ -126,7 +128,7 @@ Handler const g_vector_table[] = {
     Default_Handler, Default_Handler, Default_Handler, Default_Handler,
     TIM1_CC_IRQHandler, TIM2_IRQHandler, TIM3_IRQHandler, Default_Handler, // IRQ44=TIM1_CC, 45=TIM2, 46=TIM3, 47=TIM4
     // IRQ48..IRQ63
-    TIM5_IRQHandler, Default_Handler, Default_Handler, Default_Handler,
+    TIM5_IRQHandler, Default_Handler, TIM7_IRQHandler, Default_Handler,  // IRQ48=TIM5, 50=TIM7
     Default_Handler, Default_Handler, Default_Handler, Default_Handler,
     Default_Handler, Default_Handler, Default_Handler, Default_Handler,
     Default_Handler, Default_Handler, Default_Handler, Default_Handler,
@@ -0,0 +1,162 @@
+/**
+ * @file test/bench_adc_decim.cpp
+ * Host model — oversampling de hardware + CIC por canal (make host-bench-adc).
+ *
+ * Alimenta formas de onda sintéticas (DC varrido com fracção de LSB, ruído
+ * gaussiano de ignição/alimentação) a um ADC ideal de 12 bits, ao modelo do
+ * oversampler (soma de N conversões, shift com arredondamento, como ROVSE/
+ * OVSS) e ao hal::CicDecimator. Reporta ENOB efectivo por estágio e ns por
+ * amostra do CIC. ENOB = 12 − log2(erro_rms_LSB·√12): o erro inclui ruído e
+ * quantização residual, referido ao LSB de 12 bits.
+ * Sai com 1 só se o ganho de resolução ficar abaixo do esperado; o tempo é
+ * informativo (x86; no M33 são 2 somas + 2 subtracções por amostra).
+ */
+#include "test/harness.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "hal/adc.h"
+#include "hal/adc_cic.h"
+
+using ems::hal::CicDecimator;
+
+namespace {
+
+constexpr uint32_t kLevels       = 64u;    // níveis DC por ensaio
+constexpr uint32_t kOutPerLevel  = 32u;    // saídas medidas por nível
+constexpr double   kFullScale    = 4095.0;
+
+struct Rng {
+    uint64_t s = 0x9E3779B97F4A7C15ull;
+    double uniform() {
+        s = s * 6364136223846793005ull + 1442695040888963407ull;
+        return (static_cast<double>(s >> 11u) + 0.5) / 9007199254740992.0;
+    }
+    double gauss() {  // Box-Muller
+        const double u1 = uniform();
+        const double u2 = uniform();
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+};
+
+uint16_t adc12(double v_lsb, double sigma, Rng& rng) {
+    double x = v_lsb + sigma * rng.gauss();
+    x = std::floor(x + 0.5);
+    if (x < 0.0) { x = 0.0; }
+    if (x > kFullScale) { x = kFullScale; }
+    return static_cast<uint16_t>(x);
+}
+
+// Oversampler do ADC: N conversões somadas, shift com arredondamento.
+uint16_t ovs(double v_lsb, double sigma, uint8_t ratio, uint8_t shift, Rng& rng) {
+    uint32_t sum = 0u;
+    for (uint8_t i = 0u; i < ratio; ++i) { sum += adc12(v_lsb, sigma, rng); }
+    return static_cast<uint16_t>((sum + ((1u << shift) >> 1u)) >> shift);
+}
+
+struct Stage {
+    const char* name;
+    uint8_t ovs_ratio;   // 1 = sem oversampling
+    uint8_t ovs_shift;
+    uint8_t cic_log2;    // só com oversampling
+    bool    use_cic;
+};
+
+// Erro rms (LSB de 12 bits) do estágio sobre DC varrido.
+double stage_error_rms(const Stage& st, double sigma) {
+    Rng rng;
+    double sq = 0.0;
+    uint32_t n = 0u;
+    for (uint32_t lv = 0u; lv < kLevels; ++lv) {
+        // Níveis espalhados por 5..95 % com fracção de LSB não trivial.
+        const double v = 0.05 * kFullScale + (0.9 * kFullScale) * lv / kLevels + 0.37;
+        CicDecimator cic(st.cic_log2);
+        uint32_t got = 0u;
+        while (got < kOutPerLevel) {
+            double out_lsb = 0.0;
+            if (st.ovs_ratio <= 1u) {
+                out_lsb = adc12(v, sigma, rng);
+            } else {
+                const uint16_t x4 = ovs(v, sigma, st.ovs_ratio, st.ovs_shift, rng);
+                if (!st.use_cic) {
+                    out_lsb = x4 / 4.0;
+                } else {
+                    uint16_t y = 0u;
+                    if (!cic.push(x4, y)) { continue; }
+                    out_lsb = y / 16.0;
+                }
+            }
+            const double e = out_lsb - v;
+            sq += e * e;
+            ++n;
+            ++got;
+        }
+    }
+    return std::sqrt(sq / n);
+}
+
+double enob(double err_rms_lsb) {
+    return 12.0 - std::log2(err_rms_lsb * std::sqrt(12.0));
+}
+
+double cic_ns_per_sample() {
+    constexpr uint32_t kSamples = 1u << 22u;
+    std::vector<uint16_t> in(4096u);
+    Rng rng;
+    for (uint16_t& x : in) { x = ovs(2048.3, 2.0, 16u, 2u, rng); }
+    CicDecimator cic(5u);
+    uint32_t acc = 0u;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0u; i < kSamples; ++i) {
+        uint16_t y = 0u;
+        if (cic.push(in[i & 4095u], y)) { acc += y; }
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    volatile uint32_t sink = acc;
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / kSamples;
+}
+
+}  // namespace
+
+int main(void) {
+    printf("OpenEMS ADC oversampling + CIC model\n");
+    printf("============================================================\n");
+
+    const double sigmas[] = {0.5, 2.0, 6.0};  // LSB rms: bancada / motor / ignição suja
+    const Stage stages[] = {
+        {"12 bits, 1 conversão      ", 1u, 0u, 0u, false},
+        {"ADC1 OVS 8× (MAP)         ", ems::hal::kAdcPrimaryOvsRatio, 1u, 0u, false},
+        {"ADC2 OVS 16×              ", ems::hal::kAdcSecondaryOvsRatio, 2u, 0u, false},
+        {"ADC2 OVS 16× + CIC 8× (P) ", ems::hal::kAdcSecondaryOvsRatio, 2u, 3u, true},
+        {"ADC2 OVS 16× + CIC 32× (T)", ems::hal::kAdcSecondaryOvsRatio, 2u, 5u, true},
+    };
+    constexpr uint8_t kStages = sizeof(stages) / sizeof(stages[0]);
+
+    for (const double sigma : sigmas) {
+        printf("  ruído σ = %.1f LSB\n", sigma);
+        double e[kStages] = {};
+        for (uint8_t i = 0u; i < kStages; ++i) {
+            e[i] = enob(stage_error_rms(stages[i], sigma));
+            printf("    %s  ENOB %5.2f\n", stages[i].name, e[i]);
+        }
+        char msg[96];
+        // Ganho teórico: ½·log2(N) bits por oversampling de N (ruído branco).
+        snprintf(msg, sizeof msg, "σ=%.1f: OVS 16× ganha ≥ 1.5 bits", sigma);
+        if (sigma >= 2.0) { CHECK_TRUE(e[2] - e[0] >= 1.5, msg); }
+        snprintf(msg, sizeof msg, "σ=%.1f: CIC 32× acrescenta ≥ 1 bit ao OVS", sigma);
+        if (sigma >= 2.0) { CHECK_TRUE(e[4] - e[2] >= 1.0, msg); }
+        snprintf(msg, sizeof msg, "σ=%.1f: cadeia completa ≥ 12 bits efectivos", sigma);
+        CHECK_TRUE(e[4] >= 12.0, msg);
+    }
+
+    const double ns = cic_ns_per_sample();
+    printf("  CIC 2.ª ordem: %.2f ns/amostra (host)\n", ns);
+    printf("\n============================================================\n");
+    printf("ADC decimation model: %d passed, %d failed\n", g_pass, g_fail);
+    return g_fail ? 1 : 0;
+}
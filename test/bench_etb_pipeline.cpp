@@ -0,0 +1,127 @@
+/**
+ * @file test/bench_etb_pipeline.cpp
+ * Host benchmark — pipeline pedal → corte TC → PID ETB, inteiro/Q15 vs
+ * referência float (make host-bench-etb).
+ *
+ * Corre as duas implementações sobre a mesma sequência (pré-gerada, fora do
+ * tempo medido) e confirma, estágio a estágio, que alvo e saída do PID batem
+ * com a referência (±0.1 % / ±0.5 %). O número do host
+ * é informativo (x86 tem FPU rápida); no M33 o ganho é o caminho de 2 ms sem
+ * registos FP — sem stacking lazy de s0–s15 quando uma ISR o preempta.
+ * Sai com 1 só se houver divergência.
+ */
+#include "test/harness.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "engine/calibration.h"
+#include "engine/etb_control.h"
+#include "engine/torque_manager.h"
+
+using namespace ems::engine;
+
+namespace {
+
+struct BenchStep {
+    uint16_t app_x10;
+    uint16_t cut_x10;
+    uint16_t tps_x10;
+};
+
+constexpr uint32_t kSteps  = 4096u;
+constexpr uint32_t kRounds = 500u;
+
+std::vector<BenchStep> make_steps() {
+    std::vector<BenchStep> st(kSteps);
+    uint32_t lcg = 0xE7B0u;
+    auto rnd = [&lcg](uint32_t lo, uint32_t hi) {
+        lcg = lcg * 1664525u + 1013904223u;
+        return lo + (lcg >> 8u) % (hi - lo + 1u);
+    };
+    uint16_t app = 0u;
+    uint16_t tps = 0u;
+    for (uint32_t i = 0u; i < kSteps; ++i) {
+        if ((i % 128u) == 0u) { app = static_cast<uint16_t>(rnd(0u, 1000u)); }
+        // TPS persegue o pedal com ruído de ±2 LSB
+        const int32_t t = static_cast<int32_t>(tps) + (static_cast<int32_t>(app) - tps) / 16
+                          + static_cast<int32_t>(rnd(0u, 4u)) - 2;
+        tps = static_cast<uint16_t>(t < 0 ? 0 : (t > 1000 ? 1000 : t));
+        st[i] = {app, static_cast<uint16_t>((i % 1024u) < 200u ? 300u : 0u), tps};
+    }
+    return st;
+}
+
+int32_t q15_step(const BenchStep& s) {
+    const uint16_t tgt = torque_apply_cut_x10(torque_pedal_target_x10(s.app_x10), s.cut_x10);
+    return etb_control_update(tgt, s.tps_x10, true, 2u).output_pct_x10;
+}
+
+float ref_step(const BenchStep& s) {
+    const float tgt = torque_apply_cut_ref(torque_pedal_target_ref(s.app_x10 / 10.0f),
+                                           s.cut_x10 / 10.0f);
+    return etb_control_ref_update(tgt, s.tps_x10 / 10.0f, true, 2.0f).output_pct;
+}
+
+template <typename F>
+double time_ns_per_step(const std::vector<BenchStep>& st, F fn, double* sink) {
+    const auto t0 = std::chrono::steady_clock::now();
+    double acc = 0.0;
+    for (uint32_t r = 0u; r < kRounds; ++r) {
+        for (const BenchStep& s : st) { acc += fn(s); }
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    *sink += acc;
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    return ns / (static_cast<double>(kRounds) * st.size());
+}
+
+}  // namespace
+
+int main(void) {
+    printf("OpenEMS ETB pipeline benchmark (Q15 vs float)\n");
+    printf("============================================================\n");
+    etb_cal_valid = 1u;
+    const std::vector<BenchStep> st = make_steps();
+
+    etb_control_reset();
+    etb_control_ref_reset();
+    int32_t worst = 0;
+    int32_t worst_tgt = 0;
+    for (const BenchStep& s : st) {
+        // Equivalência por estágio: o PID float recebe o mesmo alvo quantizado
+        // (com kd=4 a 2 ms, 0.1 % de diferença no alvo vale 40 pct×10 de D).
+        const uint16_t tgt = torque_apply_cut_x10(torque_pedal_target_x10(s.app_x10),
+                                                  s.cut_x10);
+        const float tgt_f = torque_apply_cut_ref(torque_pedal_target_ref(s.app_x10 / 10.0f),
+                                                 s.cut_x10 / 10.0f);
+        const int32_t a = etb_control_update(tgt, s.tps_x10, true, 2u).output_pct_x10;
+        const int32_t b = static_cast<int32_t>(lroundf(
+            etb_control_ref_update(tgt / 10.0f, s.tps_x10 / 10.0f, true, 2.0f).output_pct * 10.0f));
+        const int32_t dt = std::abs(static_cast<int32_t>(tgt) -
+                                    static_cast<int32_t>(lroundf(tgt_f * 10.0f)));
+        if (std::abs(a - b) > worst) { worst = std::abs(a - b); }
+        if (dt > worst_tgt) { worst_tgt = dt; }
+    }
+    CHECK_TRUE(worst_tgt <= 1, "pedal map × corte: inteiro = float (±1 pct×10)");
+    CHECK_TRUE(worst <= 5, "PID Q15 = referência float (±0.5 %) na sequência do benchmark");
+
+    volatile double sink_out = 0.0;
+    double sink = 0.0;
+    const double float_ns = time_ns_per_step(st, ref_step, &sink);
+    const double q15_ns = time_ns_per_step(st, q15_step, &sink);
+    sink_out = sink;
+    (void)sink_out;
+
+    printf("  passos=%u  rondas=%u  pior |Δ| alvo=%d  PID=%d pct×10\n",
+           kSteps, kRounds, worst_tgt, worst);
+    printf("  referência float   : %7.1f ns/passo\n", float_ns);
+    printf("  inteiro/Q15        : %7.1f ns/passo\n", q15_ns);
+    printf("\n============================================================\n");
+    printf("ETB pipeline bench: %d passed, %d failed\n", g_pass, g_fail);
+    return g_fail ? 1 : 0;
+}
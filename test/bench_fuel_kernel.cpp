@@ -0,0 +1,167 @@
+/**
+ * @file test/bench_fuel_kernel.cpp
+ * Host benchmark — kernel fundido de PW vs cadeia fuel_calc (make host-bench-fuel).
+ *
+ * Mede ns/slot das duas implementações sobre dois conjuntos pré-gerados
+ * (fora do tempo medido) e confirma que os resultados batem a ±1 µs:
+ *   - sequência de slots como no main loop (pressão a 50 ms, MAP a derivar);
+ *   - pior caso, com todas as entradas a mudar a cada slot (ΔP sem cache).
+ * No x86 a divisão de 64 bits é nativa, por isso o ganho aqui é pequeno; no
+ * M33 a cadeia original chama __aeabi_uldivmod, e só o DWT no alvo
+ * (g_fuel_pw_kernel_cycles_max, dump 'D' [56]) dá o número em ciclos.
+ * Sai com 1 só se houver divergência; o tempo é informativo.
+ */
+#include "test/harness.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "engine/calibration.h"
+#include "engine/fuel_calc.h"
+#include "engine/fuel_pw_kernel.h"
+
+using namespace ems::engine;
+
+namespace {
+
+struct BenchPoint {
+    FuelOperatingPoint op;
+    uint16_t corr_clt_x256;
+    uint16_t corr_iat_x256;
+    uint16_t dead_time_us;
+    uint16_t fuel_press_bar_x1000;
+    uint32_t transient_flow_us;  // fluxo após X-τ/AE (entrada da cauda)
+};
+
+constexpr uint32_t kPoints = 4096u;
+constexpr uint32_t kRounds = 500u;
+
+uint32_t g_lcg = 0xC0FFEEu;
+
+uint32_t rnd(uint32_t lo, uint32_t hi) {
+    g_lcg = g_lcg * 1664525u + 1013904223u;
+    return lo + (g_lcg >> 8u) % (hi - lo + 1u);
+}
+
+void random_point(BenchPoint& p) {
+    p.op = {static_cast<uint8_t>(rnd(30u, 110u)),
+            static_cast<uint16_t>(rnd(25u, 250u)),
+            static_cast<uint16_t>(rnd(780u, 1050u)),
+            static_cast<int16_t>(static_cast<int32_t>(rnd(0u, 300u)) - 150)};
+    p.corr_clt_x256 = static_cast<uint16_t>(rnd(256u, 384u));
+    p.corr_iat_x256 = static_cast<uint16_t>(rnd(256u, 288u));
+    p.dead_time_us = static_cast<uint16_t>(rnd(600u, 1200u));
+    p.fuel_press_bar_x1000 = static_cast<uint16_t>(rnd(2800u, 3200u));
+    p.transient_flow_us = rnd(300u, 12000u);
+}
+
+// Pior caso: todas as entradas mudam a cada slot (ΔP recalculado sempre).
+std::vector<BenchPoint> make_points() {
+    std::vector<BenchPoint> pts(kPoints);
+    for (BenchPoint& p : pts) { random_point(p); }
+    return pts;
+}
+
+// Sequência de slots de 2 ms como no main loop: pressão de combustível
+// amostrada a 50 ms (25 slots), MAP em bar×100 a derivar ±1 de vez em
+// quando; VE/λ/trim/fluxo transitório mudam a cada slot.
+std::vector<BenchPoint> make_trace() {
+    std::vector<BenchPoint> pts(kPoints);
+    BenchPoint prev = {};
+    random_point(prev);
+    for (uint32_t i = 0u; i < kPoints; ++i) {
+        BenchPoint& p = pts[i];
+        random_point(p);
+        p.fuel_press_bar_x1000 = ((i % 25u) == 0u) ? p.fuel_press_bar_x1000
+                                                   : prev.fuel_press_bar_x1000;
+        const uint32_t step = rnd(0u, 7u);
+        uint32_t map = prev.op.map_bar_x100;
+        if (step == 0u && map > 25u) { --map; }
+        if (step == 1u && map < 250u) { ++map; }
+        p.op.map_bar_x100 = static_cast<uint16_t>(map);
+        prev = p;
+    }
+    return pts;
+}
+
+// Cadeia original do slot de 2 ms (calc_fuel_pw_us_default_fast + cauda).
+uint32_t legacy_slot(const BenchPoint& p) {
+    const uint32_t steady = calc_fuel_pw_us_default_fast(
+        p.op.ve, p.op.map_bar_x100, p.op.lambda_target_x1000, p.op.trim_pct_x10,
+        p.corr_clt_x256, p.corr_iat_x256, p.dead_time_us);
+    const uint32_t sc = apply_injector_scurve(apply_delta_p_compensation(
+        p.transient_flow_us, p.fuel_press_bar_x1000, p.op.map_bar_x100));
+    return steady + ((sc > 0u) ? sc + p.dead_time_us : 0u);
+}
+
+uint32_t kernel_slot(const BenchPoint& p, FuelPwBreakdown* bd) {
+    const FuelSensorSnapshot snap = fuel_pw_kernel_snapshot(
+        p.corr_clt_x256, p.corr_iat_x256, p.dead_time_us,
+        p.fuel_press_bar_x1000, p.op.map_bar_x100);
+    const uint32_t steady = fuel_pw_kernel(p.op, snap, bd);
+    return steady + fuel_pw_kernel_injector(p.transient_flow_us, snap, bd);
+}
+
+template <typename F>
+double time_ns_per_call(const std::vector<BenchPoint>& pts, F fn, uint64_t* sink) {
+    const auto t0 = std::chrono::steady_clock::now();
+    uint64_t acc = 0u;
+    for (uint32_t r = 0u; r < kRounds; ++r) {
+        for (const BenchPoint& p : pts) { acc += fn(p); }
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    *sink += acc;
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    return ns / (static_cast<double>(kRounds) * pts.size());
+}
+
+
+bool check_equal(const std::vector<BenchPoint>& pts, FuelPwBreakdown* bd, uint32_t* worst) {
+    for (const BenchPoint& p : pts) {
+        const uint32_t a = legacy_slot(p);
+        const uint32_t b = kernel_slot(p, bd);
+        const uint32_t d = (a > b) ? a - b : b - a;
+        if (d > *worst) { *worst = d; }
+    }
+    return *worst <= 1u;
+}
+
+void report(const char* name, const std::vector<BenchPoint>& pts, FuelPwBreakdown* bdp,
+            uint64_t* sink) {
+    const double legacy_ns = time_ns_per_call(pts, legacy_slot, sink);
+    const double kernel_ns = time_ns_per_call(
+        pts, [bdp](const BenchPoint& p) { return kernel_slot(p, bdp); }, sink);
+    printf("  %s\n", name);
+    printf("    fuel_calc (cadeia) : %7.1f ns/slot\n", legacy_ns);
+    printf("    fuel_pw_kernel     : %7.1f ns/slot\n", kernel_ns);
+    printf("    speedup            : %7.2fx\n", (kernel_ns > 0.0) ? legacy_ns / kernel_ns : 0.0);
+}
+
+}  // namespace
+
+int main(void) {
+    printf("OpenEMS fuel PW kernel benchmark\n");
+    printf("============================================================\n");
+    fuel_set_baro_bar_x100(101u);
+    const std::vector<BenchPoint> pts = make_points();
+    const std::vector<BenchPoint> trace = make_trace();
+
+    uint32_t worst = 0u;
+    FuelPwBreakdown bd = {};
+    CHECK_TRUE(check_equal(pts, &bd, &worst) && check_equal(trace, &bd, &worst),
+               "kernel = cadeia original (±1 µs) no conjunto do benchmark");
+
+    volatile uint64_t sink_out = 0u;
+    uint64_t sink = 0u;
+    printf("  pontos=%u  rondas=%u  pior |Δ|=%u µs\n", kPoints, kRounds, worst);
+    report("slots de 2 ms (pressão a 50 ms, MAP a derivar):", trace, &bd, &sink);
+    report("pior caso (todas as entradas mudam a cada slot):", pts, &bd, &sink);
+    sink_out = sink;
+    (void)sink_out;
+
+    printf("\n============================================================\n");
+    printf("fuel PW kernel bench: %d passed, %d failed\n", g_pass, g_fail);
+    return g_fail ? 1 : 0;
+}
@@ -116,6 +116,9 @@ int main(void) {
     test_knock_window();
     test_knock_detection_and_recovery();
     test_knock_dead_sensor();
+    test_knock_band_dsp();
+    test_knock_intensity_history();
+    test_knock_learn_map();
 
     // ── Fuel Calc — Segunda Fase ──────────────────────────────────────────────
     printf("\n=== FUEL CALC (fase 2) ===");
@@ -140,6 +143,7 @@ int main(void) {
     test_fuel_ltft_accum_commit_ve();
     test_fuel_ltft_center_gate();
     test_fuel_inj_two_slope();
+    test_fuel_pw_kernel_equivalence();
     test_spark_skip();
 
     // ── Ign Calc — Segunda Fase ───────────────────────────────────────────────
@@ -151,6 +155,8 @@ int main(void) {
     // ── ETB Control C++ ns ───────────────────────────────────────────────────
     printf("\n=== ETB CONTROL (C++ ns) ===");
     test_etb_cpp_update();
+    test_etb_q15_pipeline();
+    test_etb_loop_isr();
 
     // ── Torque Manager C++ ns ──────────────────────────────────────────────
     printf("\n=== TORQUE MANAGER (C++ ns) ===");
@@ -166,6 +172,8 @@ int main(void) {
     // ── Sensors — Segunda Fase ───────────────────────────────────────────────
     printf("\n=== SENSORS (fase 2) ===");
     test_sensors_on_tooth();
+    test_adc_oversample_decimation();
+    test_map_angle_sync();
     test_map_window_angular();
     test_sensors_tick_50ms();
     test_sensors_set_range();
@@ -189,6 +197,12 @@ int main(void) {
     // ── TABLE3D ──────────────────────────────────────────────────────────
     printf("\n=== TABLE3D ===");
     test_table3d_all();
+    test_table_ops_all();
+    test_table_reaxis();
+
+    // ── LOOP SCHED ──────────────────────────────────────────────────────
+    printf("\n=== LOOP SCHED ===");
+    test_loop_sched();
 
     // ── ECU SCHED ───────────────────────────────────────────────────────
     printf("\n=== ECU SCHED ===");
@@ -201,6 +215,8 @@ int main(void) {
     test_ecu_sched_inhibit_masks();
     test_ecu_sched_mspark();
     test_ecu_sched_eoi_targeting();
+    test_ecu_sched_cyl_vector();
+    test_cyl_pulse_build();
     test_eoi_blend();
     test_ecu_sched_presync();
     test_ecu_sched_dwell_watchdog();
@@ -216,14 +232,17 @@ int main(void) {
     // ── MAP ESTIMATOR ───────────────────────────────────────────────────
     printf("\n=== MAP ESTIMATOR ===");
     test_map_estimator_all();
+    test_map_predictor_ivc();
 
     // ── MISFIRE DETECT ──────────────────────────────────────────────────
     printf("\n=== MISFIRE DETECT ===");
     test_misfire_all();
+    test_misfire_kinematics();
 
     // ── DIAGNOSTIC MANAGER ──────────────────────────────────────────────
     printf("\n=== DIAGNOSTIC MANAGER ===");
     test_diagnostic_manager_all();
+    test_diagnostic_dtc_store();
 
     // ── HAL ADC ───────────────────────────────────────────────────────────
     printf("\n=== HAL ADC ===");
@@ -232,6 +251,14 @@ int main(void) {
     // ── HAL FLASH (NVM) ─────────────────────────────────────────────────
     printf("\n=== HAL FLASH (NVM) ===");
     test_hal_flash_all();
+    test_nvm_journal_all();
+    test_flash_jobs_all();
+    test_nvm_adaptive_journal_all();
+    test_cal_store_all();
+
+    // ── HAL SPI (TLE8888) ───────────────────────────────────────────────
+    printf("\n=== HAL SPI (TLE8888) ===");
+    test_spi_jobs_tle8888();
 
     // ── XTAU AUTOCALIB ──────────────────────────────────────────────────
     printf("\n=== XTAU AUTOCALIB ===");
@@ -273,6 +300,12 @@ int main(void) {
     test_ckp_snap_fields();
     test_ckp_tooth_index_progression();
     test_ckp_phase_toggle();
+    test_ckp_wheel_tables();
+    test_ckp_wheel_36_1();
+    test_ckp_wheel_36_2_2_2();
+    test_ckp_snapshot_seqlock();
+    test_ckp_tooth_geometry_learning();
+    test_ckp_tooth_geometry_fine();
 
     // ── UI PROTOCOL / TUNERSTUDIO ENVELOPE ────────────────────────────────
     printf("\n=== UI PROTOCOL / TS ENVELOPE ===");
@@ -283,16 +316,21 @@ int main(void) {
     test_ts_envelope_read_write_burn();
     test_eoi_blend_page0_roundtrip();
     test_ts_envelope_burn_gate();
+    test_ts_envelope_rollback();
     test_ts_axes_page();
+    test_ts_axes_rollback();
     test_ts_envelope_canid_forms();
     test_och_launch_tc_status();
     test_ts_envelope_signature_via_r();
     test_ts_whole_page_800();
+    test_ui_sessions_per_port();
     test_adaptives_reset_cmd_z();
     test_ltft_apply_cmd_y();
+    test_stored_dtc_cmds();
     test_ltft_hit_matches_ve_dominant_cell();
     test_ltft_accum_page12();
     test_ltft_page_offsets_20();
+    test_can_fd_telemetry_cycle_frame();
 
     printf("\n=== OUTPUT TEST (teste de saídas) ===");
     test_output_test_enter_gate();
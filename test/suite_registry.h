@@ -42,6 +42,8 @@ void test_ckp_full_sync(void);
 void test_ckp_tooth_index_increments(void);
 void test_ckp_instant_rpm_360(void);
 void test_ckp_skip_after_silence(void);
+void test_adc_oversample_decimation(void);
+void test_map_angle_sync(void);
 void test_map_window_angular(void);
 void test_ckp_loss_of_sync_too_many_teeth(void);
 void test_ckp_loss_of_sync_early_gap(void);
@@ -75,6 +77,9 @@ void test_aux_pump_prime(void);
 void test_aux_ticks_no_crash(void);
 void test_knock_init_and_threshold(void);
 void test_knock_dead_sensor(void);
+void test_knock_band_dsp(void);
+void test_knock_intensity_history(void);
+void test_knock_learn_map(void);
 void test_fuel_decel_cut_gates(void);
 void test_fuel_inj_duty_protection(void);
 void test_knock_window(void);
@@ -100,11 +105,14 @@ void test_fuel_ltft_accum(void);
 void test_fuel_ltft_accum_commit_ve(void);
 void test_fuel_ltft_center_gate(void);
 void test_fuel_inj_two_slope(void);
+void test_fuel_pw_kernel_equivalence(void);
 void test_spark_skip(void);
 void test_ign_get_advance(void);
 void test_ign_dwell_vbatt_rpm(void);
 void test_ign_idle_spark_correction(void);
 void test_etb_cpp_update(void);
+void test_etb_q15_pipeline(void);
+void test_etb_loop_isr(void);
 void test_torque_manager_cpp_update(void);
 void test_launch_tc_page0_roundtrip(void);
 void test_ckp_seed_confirmed(void);
@@ -121,6 +129,9 @@ void test_aux_test_getters(void);
 void test_timer_stubs(void);
 void test_out_pins_bsrr_rgt6(void);
 void test_table3d_all(void);
+void test_table_ops_all(void);
+void test_table_reaxis(void);
+void test_loop_sched(void);
 void test_ecu_sched_setters(void);
 void test_ecu_sched_angle_table(void);
 void test_ecu_sched_wasted_to_sequential(void);
@@ -130,16 +141,26 @@ void test_ecu_sched_recovers_after_fallback(void);
 void test_ecu_sched_inhibit_masks(void);
 void test_ecu_sched_mspark(void);
 void test_ecu_sched_eoi_targeting(void);
+void test_ecu_sched_cyl_vector(void);
+void test_cyl_pulse_build(void);
 void test_eoi_blend(void);
 void test_ecu_sched_presync(void);
 void test_ecu_sched_dwell_watchdog(void);
 void test_quick_crank_all(void);
 void test_transient_fuel_all(void);
 void test_map_estimator_all(void);
+void test_map_predictor_ivc(void);
 void test_misfire_all(void);
+void test_misfire_kinematics(void);
 void test_diagnostic_manager_all(void);
+void test_diagnostic_dtc_store(void);
 void test_hal_adc_all(void);
 void test_hal_flash_all(void);
+void test_nvm_journal_all(void);
+void test_flash_jobs_all(void);
+void test_nvm_adaptive_journal_all(void);
+void test_spi_jobs_tle8888(void);
+void test_cal_store_all(void);
 void test_xtau_autocalib_all(void);
 void test_ecu_sched_hardware_init(void);
 void test_ecu_sched_ccr_write(void);
@@ -169,6 +190,12 @@ void test_ckp_prime_on_tooth(void);
 void test_ckp_snap_fields(void);
 void test_ckp_tooth_index_progression(void);
 void test_ckp_phase_toggle(void);
+void test_ckp_wheel_tables(void);
+void test_ckp_wheel_36_1(void);
+void test_ckp_wheel_36_2_2_2(void);
+void test_ckp_snapshot_seqlock(void);
+void test_ckp_tooth_geometry_learning(void);
+void test_ckp_tooth_geometry_fine(void);
 void test_crc32_vectors(void);
 void test_legacy_protocol_regression(void);
 void test_ts_envelope_basic(void);
@@ -176,16 +203,21 @@ void test_ts_envelope_crc_reject(void);
 void test_ts_envelope_read_write_burn(void);
 void test_eoi_blend_page0_roundtrip(void);
 void test_ts_envelope_burn_gate(void);
+void test_ts_envelope_rollback(void);
 void test_ts_axes_page(void);
+void test_ts_axes_rollback(void);
 void test_ts_envelope_canid_forms(void);
 void test_och_launch_tc_status(void);
 void test_ts_envelope_signature_via_r(void);
 void test_ts_whole_page_800(void);
+void test_ui_sessions_per_port(void);
 void test_adaptives_reset_cmd_z(void);
 void test_ltft_apply_cmd_y(void);
+void test_stored_dtc_cmds(void);
 void test_ltft_hit_matches_ve_dominant_cell(void);
 void test_ltft_accum_page12(void);
 void test_ltft_page_offsets_20(void);
+void test_can_fd_telemetry_cycle_frame(void);
 void test_output_test_enter_gate(void);
 void test_output_test_fire_inj(void);
 void test_output_test_busy_window(void);
@@ -21,6 +21,8 @@
 #include "engine/ign_calc.h"
 #include "engine/auxiliaries.h"
 #include "engine/knock.h"
+#include "engine/knock_dsp.h"
+#include "engine/knock_learn.h"
 #include "engine/table3d.h"
 #include "engine/ecu_sched.h"
 #include "engine/quick_crank.h"
@@ -132,6 +134,8 @@ void test_knock_detection_and_recovery(void) {
     knock_window_close(0u);
     const uint16_t r0 = knock_get_retard_x10(0u);
     knock_cycle_complete(0u);
+    CHECK_EQ(knock_get_retard_x10(0u), r0, "ISR só latcha: decisão no knock_process");
+    knock_process();
     CHECK_TRUE(knock_get_retard_x10(0u) > r0, "retard increases after knock");
     CHECK_EQ(knock_get_retard_x10(0u) - r0, 20u, "retard += 2.0° (20 x10)");
 
@@ -142,7 +146,7 @@ void test_knock_detection_and_recovery(void) {
     // max clamp: force many knock events
     knock_set_event_threshold(0u);
     for (int i = 0; i < 20; ++i) {
-        knock_window_open(3u); knock_test_set_adc_raw(2500u); knock_window_close(3u); knock_cycle_complete(3u);
+        knock_window_open(3u); knock_test_set_adc_raw(2500u); knock_window_close(3u); knock_cycle_complete(3u); knock_process();
     }
     CHECK_TRUE(knock_get_retard_x10(3u) <= 100u, "retard clamped at 10.0° (100 x10)");
 
@@ -150,7 +154,7 @@ void test_knock_detection_and_recovery(void) {
     knock_set_event_threshold(2u);
     const uint16_t peak = knock_get_retard_x10(0u);
     for (int i = 0; i < 11; ++i) {
-        knock_window_open(0u); knock_test_set_adc_raw(500u); knock_window_close(0u); knock_cycle_complete(0u);
+        knock_window_open(0u); knock_test_set_adc_raw(500u); knock_window_close(0u); knock_cycle_complete(0u); knock_process();
     }
     CHECK_TRUE(knock_get_retard_x10(0u) < peak, "retard decreases after clean cycles");
 }
@@ -170,7 +174,7 @@ void test_knock_dead_sensor(void) {
         knock_window_open(0u);
         knock_test_set_adc_raw(2000u); knock_test_set_adc_raw(2000u);
         knock_window_close(0u);
-        knock_cycle_complete(0u);
+        knock_cycle_complete(0u); knock_process();
     }
     CHECK_FALSE(knock_sensor_dead(), "detecção off: nunca morto");
 
@@ -182,13 +186,13 @@ void test_knock_dead_sensor(void) {
         knock_window_open(0u);
         knock_test_set_adc_raw(2000u); knock_test_set_adc_raw(2000u);
         knock_window_close(0u);
-        knock_cycle_complete(0u);
+        knock_cycle_complete(0u); knock_process();
     }
     CHECK_FALSE(knock_sensor_dead(), "99 janelas planas: ainda não");
     knock_window_open(0u);
     knock_test_set_adc_raw(2000u); knock_test_set_adc_raw(2000u);
     knock_window_close(0u);
-    knock_cycle_complete(0u);
+    knock_cycle_complete(0u); knock_process();
     CHECK_TRUE(knock_sensor_dead(), "100 janelas planas: sensor morto");
 
     // Ruído de fundo real (p2p=80) recupera: EMA sobe, contador zera.
@@ -196,7 +200,7 @@ void test_knock_dead_sensor(void) {
         knock_window_open(0u);
         knock_test_set_adc_raw(1960u); knock_test_set_adc_raw(2040u);
         knock_window_close(0u);
-        knock_cycle_complete(0u);
+        knock_cycle_complete(0u); knock_process();
     }
     CHECK_FALSE(knock_sensor_dead(), "ruído vivo: recupera");
     CHECK_TRUE(knock_test_get_noise_p2p_ema() > 8u, "EMA do p2p subiu");
@@ -204,6 +208,242 @@ void test_knock_dead_sensor(void) {
     knock_init();
 }
 
+// Bloco DMA sintético: dc + amp·sin(2π·f·(t0+i)/fs).
+static void knock_synth_block(uint16_t* x, uint32_t f_hz, int32_t amp, uint32_t t0) {
+    for (uint16_t i = 0u; i < kAdcKnockBlock; ++i) {
+        const double ph = 2.0 * 3.14159265358979 * f_hz * (t0 + i) / kAdcKnockSampleRateHz;
+        x[i] = static_cast<uint16_t>(2048 + std::lround(amp * std::sin(ph)));
+    }
+}
+
+// Uma janela completa pelo caminho do ecu_sched: dwell → faísca → blocos DMA.
+static void knock_dsp_window(uint8_t cyl, int32_t amp) {
+    uint16_t x[kAdcKnockBlock];
+    knock_on_dwell_start(cyl);
+    knock_process();  // main loop: avalia a janela anterior
+    knock_window_spark(cyl);
+    for (uint32_t b = 0u; b < 8u; ++b) {  // 8 > limite de 6: o excesso é ignorado
+        knock_synth_block(x, 8973u, amp, b * kAdcKnockBlock);
+        adc_test_knock_dma_block(x, kAdcKnockBlock);
+    }
+}
+
+void test_knock_band_dsp(void) {
+    section("knock: DSP Goertzel em banda + fundo por cilindro");
+    // Kernel: bin 6 de 64 a 95.7 kS/s = 8973 Hz.
+    const int32_t c = knock_goertzel_coeff_q14(8973u, kAdcKnockSampleRateHz);
+    uint16_t x[kAdcKnockBlock];
+    knock_synth_block(x, 8973u, 500, 0u);
+    const uint16_t in_band = knock_goertzel_amplitude(
+        knock_goertzel_energy(x, kAdcKnockBlock, c, 2048), kAdcKnockBlock);
+    CHECK_TRUE(in_band > 480u && in_band < 520u, "tom em banda: amplitude ≈ 500");
+    knock_synth_block(x, 20000u, 500, 0u);
+    const uint16_t off_band = knock_goertzel_amplitude(
+        knock_goertzel_energy(x, kAdcKnockBlock, c, 2048), kAdcKnockBlock);
+    CHECK_TRUE(off_band < 50u, "tom fora de banda (20 kHz) rejeitado");
+
+    // Desligado (band_hz = 0): faísca não captura, contagem legada decide.
+    knock_init();
+    ems::engine::knock_band_hz = 0u;
+    knock_set_adc_threshold(2000u);
+    knock_set_event_threshold(2u);
+    knock_on_dwell_start(0u);
+    knock_window_spark(0u);
+    CHECK_FALSE(adc_knock_capture_active(), "band_hz=0: sem captura rápida");
+    knock_test_set_adc_raw(2500u); knock_test_set_adc_raw(2500u); knock_test_set_adc_raw(2500u);
+    knock_window_cycle_end(); knock_process();
+    CHECK_EQ(knock_get_retard_x10(0u), 20u, "band_hz=0: contagem legada aplica retard");
+
+    knock_init();
+    ems::engine::knock_band_hz = 8973u;
+    ems::engine::knock_intensity_thr_x10 = 0u;  // default 3.0×
+    knock_on_dwell_start(0u);
+    CHECK_FALSE(adc_knock_capture_active(), "DWELL_START ainda não captura");
+    knock_window_spark(0u);
+    CHECK_FALSE(adc_knock_capture_active(), "coeficiente por calcular: sem captura");
+    knock_process();  // main loop: coeficiente da nova banda
+    knock_window_spark(0u);
+    CHECK_TRUE(adc_knock_capture_active(), "faísca inicia a captura");
+    for (uint32_t b = 0u; b < 6u; ++b) {
+        knock_synth_block(x, 8973u, 40, b * kAdcKnockBlock);
+        adc_test_knock_dma_block(x, kAdcKnockBlock);
+    }
+    CHECK_FALSE(adc_knock_capture_active(), "captura termina após 6 blocos");
+    knock_window_cycle_end(); knock_process();
+    CHECK_TRUE(knock_get_background(0u) >= 38u && knock_get_background(0u) <= 42u,
+               "1.ª janela semeia o fundo do cilindro");
+    CHECK_EQ(knock_get_retard_x10(0u), 0u, "semente: sem decisão");
+
+    // Cil. 1 com fundo mais alto (ressonância própria): 400 counts = 2×.
+    knock_dsp_window(1u, 200);
+    for (int w = 0; w < 4; ++w) { knock_dsp_window(0u, 40); knock_dsp_window(1u, 200); }
+    knock_window_cycle_end(); knock_process();
+    CHECK_EQ(knock_get_retard_x10(0u) + knock_get_retard_x10(1u), 0u,
+             "ruído de fundo estável: sem knock");
+
+    knock_dsp_window(0u, 400);
+    knock_dsp_window(1u, 400);
+    CHECK_TRUE(knock_get_intensity_q8(0u) > 9u * 256u, "cil. 0: 400/40 → intensidade ≈ 10×");
+    CHECK_EQ(knock_get_retard_x10(0u), 20u, "cil. 0: knock → retard");
+    knock_window_cycle_end(); knock_process();
+    CHECK_TRUE(knock_get_intensity_q8(1u) < 3u * 256u, "cil. 1: 400/200 → 2×");
+    CHECK_EQ(knock_get_retard_x10(1u), 0u, "cil. 1: normalizado pelo fundo → sem knock");
+    CHECK_TRUE(knock_get_background(0u) <= 42u, "janela com knock não arrasta o fundo");
+
+    // Limiar calibrável: 1.5× → os 400 do cil. 1 já contam.
+    ems::engine::knock_intensity_thr_x10 = 15u;
+    knock_dsp_window(1u, 400);
+    knock_window_cycle_end(); knock_process();
+    CHECK_EQ(knock_get_retard_x10(1u), 20u, "thr 1.5×: cil. 1 detecta");
+
+    // Multi-spark: re-dwell do mesmo cilindro não fecha a janela.
+    knock_on_dwell_start(2u);
+    knock_on_dwell_start(2u);
+    CHECK_TRUE(knock_test_window_active() && knock_test_window_cyl() == 2u,
+               "re-dwell do mesmo cilindro mantém a janela");
+    knock_window_cycle_end(); knock_process();
+
+    ems::engine::knock_band_hz = 0u;  // isolamento entre testes
+    ems::engine::knock_intensity_thr_x10 = 0u;
+    knock_init();
+}
+
+void test_knock_intensity_history(void) {
+    section("knock: histórico de intensidade por cilindro (anel u8)");
+    knock_init();
+    ems::engine::knock_band_hz = 0u;
+    knock_set_adc_threshold(2000u);
+    knock_set_event_threshold(3u);   // limiar = 4 amostras
+
+    uint8_t h[kKnockHistoryLen] = {};
+    CHECK_EQ(knock_history_read(2u, h, 4u), 0u, "init: contador 0");
+    CHECK_EQ(h[3], 0u, "init: entradas a 0");
+
+    // Contagem: 2 amostras = meio limiar (16), 4 = limiar + knock, 20 = satura.
+    const uint8_t counts[3] = {2u, 4u, 20u};
+    for (uint8_t n : counts) {
+        knock_on_dwell_start(2u);
+        for (uint8_t i = 0u; i < n; ++i) { knock_test_set_adc_raw(2500u); }
+        knock_window_cycle_end(); knock_process();
+    }
+    CHECK_EQ(knock_history_read(2u, h, 3u), 3u, "3 janelas no cil. 2");
+    CHECK_EQ(h[0], 16u, "2/4 amostras: nível 16, sem knock");
+    CHECK_EQ(h[1], kKnockHistKnockBit | kKnockHistLevelLimit, "4/4: no limiar, knock");
+    CHECK_EQ(h[2], kKnockHistKnockBit | kKnockHistLevelMask, "20/4: nível saturado");
+    CHECK_EQ(knock_history_read(0u, h, 3u), 0u, "cil. 0 sem janelas: anel próprio vazio");
+    CHECK_EQ(knock_get_retard_x10(0u), 0u, "cil. 0 sem retardo");
+
+    // Anel: 20 janelas limpas no cil. 2 → só as 16 últimas, contador segue.
+    for (int w = 0; w < 20; ++w) {
+        knock_on_dwell_start(2u);
+        knock_test_set_adc_raw(2500u);
+        knock_window_cycle_end(); knock_process();
+    }
+    CHECK_EQ(knock_history_read(2u, h, kKnockHistoryLen), 23u, "contador = 23 janelas");
+    bool all_8 = true;
+    for (uint8_t i = 0u; i < kKnockHistoryLen; ++i) { all_8 = all_8 && (h[i] == 8u); }
+    CHECK_TRUE(all_8, "anel cheio só com as janelas mais recentes (1/4 → 8)");
+
+    // DSP: mesmo Q5 relativo a knock_intensity_thr_x10 (3.0× → 10× ≈ 106).
+    knock_init();
+    ems::engine::knock_band_hz = 8973u;
+    ems::engine::knock_intensity_thr_x10 = 30u;
+    // Alterna cilindros: re-dwell do mesmo cilindro não fecha a janela.
+    for (int w = 0; w < 3; ++w) { knock_dsp_window(1u, 40); knock_dsp_window(0u, 40); }
+    knock_dsp_window(1u, 400);
+    knock_window_cycle_end(); knock_process();
+    CHECK_EQ(knock_history_read(1u, h, 2u), 4u, "DSP: 4 janelas no cil. 1");
+    CHECK_EQ(h[0] & kKnockHistKnockBit, 0u, "fundo: sem knock");
+    CHECK_TRUE(h[0] >= 9u && h[0] <= 12u, "fundo ≈ 1× → nível ≈ 32/3");
+    CHECK_TRUE((h[1] & kKnockHistKnockBit) != 0u, "400/40: knock marcado");
+    CHECK_TRUE((h[1] & kKnockHistLevelMask) >= 96u, "10×/3.0× → nível ≥ 3× limiar");
+    CHECK_EQ(knock_get_retard_x10(1u), 20u, "a entrada acompanha a decisão de retardo");
+
+    ems::engine::knock_band_hz = 0u;  // isolamento entre testes
+    ems::engine::knock_intensity_thr_x10 = 0u;
+    knock_init();
+}
+
+// n janelas alternando cilindros 0/1: knock = 1 amostra acima do limiar.
+static void knock_learn_windows(uint16_t n, bool knock) {
+    for (uint16_t w = 0u; w < n; ++w) {
+        knock_on_dwell_start(static_cast<uint8_t>(w & 1u));
+        if (knock) { knock_test_set_adc_raw(2500u); }
+        knock_window_cycle_end();
+        knock_process();
+    }
+}
+
+void test_knock_learn_map(void) {
+    section("knock_learn: crédito bilinear, retardo interpolado, NVM diferido");
+    knock_init();
+    knock_learn_reset();
+    ems::engine::knock_band_hz = 0u;
+    ems::engine::knock_learn_step_x10 = 10u;
+    ems::engine::knock_learn_max_x10 = 0u;
+    knock_set_adc_threshold(2000u);
+    knock_set_event_threshold(0u);
+
+    const uint32_t rpm2 = kRpmAxisX10[kKnockLearnNodes[2]];
+    const uint32_t rpm3 = kRpmAxisX10[kKnockLearnNodes[3]];
+    const uint16_t load3 = kLoadAxisBarX100[kKnockLearnNodes[3]];
+
+    knock_learn_windows(1u, true);
+    knock_learn_update(rpm2, load3, true);
+    CHECK_EQ(knock_learn_cell_x10(3u, 2u), 10u, "knock no nó: +1.0° na célula");
+    CHECK_EQ(knock_learn_cell_x10(3u, 3u), 0u, "vizinha com peso 0 intacta");
+    CHECK_EQ(knock_learn_retard_x10_at(rpm2, load3), 10u, "retardo no nó = célula");
+    CHECK_EQ(nvm_read_knock(2u, 3u), 10, "≥ 0.5° → célula persistida");
+
+    // A meio de dois nós RPM: o crédito divide-se entre as duas células.
+    ems::engine::knock_learn_step_x10 = 4u;
+    const uint32_t rpm_mid = (rpm2 + rpm3) / 2u;
+    knock_learn_windows(1u, true);
+    knock_learn_update(rpm_mid, load3, true);
+    CHECK_EQ(knock_learn_cell_x10(3u, 2u), 12u, "metade do passo na célula baixa");
+    CHECK_EQ(knock_learn_cell_x10(3u, 3u), 2u, "metade do passo na célula alta");
+    const uint16_t mid = knock_learn_retard_x10_at(rpm_mid, load3);
+    CHECK_TRUE(mid >= 6u && mid <= 8u, "retardo interpolado ≈ 0.7°");
+    CHECK_EQ(nvm_read_knock(2u, 3u), 10, "+0.2° abaixo do delta → NVM inalterado");
+    CHECK_EQ(nvm_read_knock(3u, 3u), 0, "célula alta ainda só em RAM");
+
+    // ~1000 janelas limpas com peso total ≈ −1.0°; deriva de 0.8° vai ao NVM.
+    knock_learn_windows(1000u, false);
+    knock_learn_update(rpm2, load3, true);
+    CHECK_EQ(knock_learn_cell_x10(3u, 2u), 2u, "decaimento ≈ 1° por 1000 janelas");
+    CHECK_EQ(nvm_read_knock(2u, 3u), 2, "afastamento ≥ 0.5° → persistido");
+    knock_learn_save();
+    CHECK_EQ(nvm_read_knock(3u, 3u), 2, "save força as diferenças pendentes");
+
+    section("knock_learn: limite, learn=false, init, desligado, reset");
+    ems::engine::knock_learn_step_x10 = 10u;
+    ems::engine::knock_learn_max_x10 = 30u;
+    knock_learn_windows(10u, true);
+    knock_learn_update(rpm2, load3, true);
+    CHECK_EQ(knock_learn_cell_x10(3u, 2u), 30u, "limitado a knock_learn_max_x10");
+    knock_learn_windows(4u, true);
+    knock_learn_update(rpm3, load3, false);
+    knock_learn_update(rpm3, load3, true);
+    CHECK_EQ(knock_learn_cell_x10(3u, 3u), 2u, "learn=false descarta as janelas");
+
+    knock_learn_init();
+    CHECK_EQ(knock_learn_cell_x10(3u, 2u), 30u, "init recarrega do shadow NVM");
+    knock_init();
+    CHECK_EQ(knock_get_retard_x10(0u), 0u, "retardo reactivo arranca a 0");
+
+    ems::engine::knock_learn_step_x10 = 0u;
+    CHECK_EQ(knock_learn_retard_x10_at(rpm2, load3), 0u, "step = 0 → mapa desligado");
+    knock_learn_windows(1u, true);
+    knock_learn_update(rpm2, load3, true);
+    CHECK_EQ(knock_learn_cell_x10(3u, 2u), 30u, "step = 0 → sem crédito");
+
+    knock_learn_reset();
+    CHECK_EQ(knock_learn_cell_x10(3u, 2u), 0u, "reset zera a RAM");
+    CHECK_EQ(nvm_read_knock(2u, 3u), 0, "reset zera o NVM");
+    ems::engine::knock_learn_max_x10 = 0u;
+    knock_init();
+}
+
 void test_knock_window_cycle_end(void) {
     section("knock: knock_window_cycle_end");
     knock_init();
@@ -217,7 +457,7 @@ void test_knock_window_cycle_end(void) {
     knock_test_set_adc_raw(2500u);  // count=3 > threshold=2
     CHECK_TRUE(knock_test_window_active(), "pre-cond: window active");
 
-    knock_window_cycle_end();
+    knock_window_cycle_end(); knock_process();
     CHECK_FALSE(knock_test_window_active(), "window closed by cycle_end");
     CHECK_TRUE(knock_get_retard_x10(0u) > 0u, "retard applied by cycle_end");
 }
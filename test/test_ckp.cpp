@@ -17,6 +17,7 @@
 #include "hal/system.h"
 #include "drv/ckp.h"
 #include "drv/sensors.h"
+#include "drv/tooth_geom.h"
 #include "engine/fuel_calc.h"
 #include "engine/ign_calc.h"
 #include "engine/auxiliaries.h"
@@ -36,6 +37,7 @@
 #include "app/ui_protocol.h"
 #include "app/status_bits.h"
 #include "hal/crc32.h"
+#include "hal/seqlock.h"
 
 namespace ems::engine {
     int16_t etb_get_idle_spark_trim() noexcept;
@@ -443,6 +445,304 @@ void test_ckp_phase_toggle(void) {
     CHECK_EQ(ckp_snapshot().phase_A, !phase_before, "after glitch: phase_A toggles normally (no CMP correction)");
 }
 
+// ── Rodas N-M: streams sintéticos pela mesma ISR ─────────────────────────────
+// Dispara os dentes reais [from..to] da roda w; cada borda chega após o
+// espaço que a precede (span_after do dente anterior × p) — gaps incluídos.
+static void wheel_fire_teeth(const TriggerWheel& w, uint8_t from, uint8_t to, uint32_t p) {
+    for (uint8_t t = from; t <= to; ++t) {
+        const uint8_t prev = (t == 0u) ? static_cast<uint8_t>(w.real_teeth - 1u)
+                                       : static_cast<uint8_t>(t - 1u);
+        ckp_fire(w.span_after[prev] * p);
+    }
+}
+
+void test_ckp_wheel_tables(void) {
+    section("ckp: tabelas N-M + replay 60-2 pelo gerador genérico");
+    CHECK_EQ(kWheel60_2.real_teeth, 58u, "60-2: 58 dentes");
+    CHECK_EQ(kWheel36_1.real_teeth, 35u, "36-1: 35 dentes");
+    CHECK_EQ(kWheel36_2_2_2.real_teeth, 30u, "36-2-2-2: 30 dentes");
+    CHECK_EQ(kWheel36_2_2_2.tooth_pos[16], 18u, "36-2-2-2: dente 16 na posição 18");
+    CHECK_EQ(kWheel36_2_2_2.tooth_deg_x10[23], 2700u, "36-2-2-2: dente 23 a 270.0°");
+    CHECK_EQ(kWheel36_2_2_2.ident_next_tooth[6], kTriggerNoTooth,
+             "36-2-2-2: segmento de 7 não identifica (repetido)");
+    CHECK_EQ(kWheel36_2_2_2.ident_next_tooth[15], 16u,
+             "36-2-2-2: segmento de 16 identifica o dente 16");
+    CHECK_EQ(&ckp_wheel(), &kWheel60_2, "host: roda default = 60-2");
+
+    ckp_test_reset(); g_ckp_cap = 0u;
+    wheel_fire_teeth(kWheel60_2, 10u, 57u, kNormalPeriod);
+    wheel_fire_teeth(kWheel60_2, 0u, 57u, kNormalPeriod);
+    wheel_fire_teeth(kWheel60_2, 0u, 0u, kNormalPeriod);
+    const CkpSnapshot s = ckp_snapshot();
+    CHECK_EQ(static_cast<uint8_t>(s.state), static_cast<uint8_t>(SyncState::FULL_SYNC),
+             "60-2: FULL_SYNC no 2.º gap");
+    CHECK_EQ(s.tooth_index, 0u, "60-2: dente 0 após o gap");
+    CHECK_EQ(s.rpm_x10, 62500u, "60-2: 10000 ticks/posição → 6250.0 rpm");
+}
+
+void test_ckp_wheel_36_1(void) {
+    section("ckp: roda 36-1 — sync, índice, rpm, perdas");
+    ckp_test_reset(); g_ckp_cap = 0u;
+    ckp_test_set_wheel(TriggerWheelId::Wheel36_1);
+    const TriggerWheel& w = ckp_wheel();
+    CHECK_EQ(w.real_teeth, 35u, "roda activa 36-1");
+
+    wheel_fire_teeth(w, 5u, 34u, kNormalPeriod);
+    wheel_fire_teeth(w, 0u, 0u, kNormalPeriod);
+    CHECK_EQ(static_cast<uint8_t>(ckp_snapshot().state),
+             static_cast<uint8_t>(SyncState::HALF_SYNC), "1.º gap (2×) → HALF_SYNC");
+    wheel_fire_teeth(w, 1u, 34u, kNormalPeriod);
+    wheel_fire_teeth(w, 0u, 0u, kNormalPeriod);
+    CkpSnapshot s = ckp_snapshot();
+    CHECK_EQ(static_cast<uint8_t>(s.state), static_cast<uint8_t>(SyncState::FULL_SYNC),
+             "2.º gap → FULL_SYNC");
+    CHECK_EQ(s.tooth_index, 0u, "dente 0 após o gap");
+
+    wheel_fire_teeth(w, 1u, 9u, kNormalPeriod);
+    s = ckp_snapshot();
+    CHECK_EQ(s.tooth_index, 9u, "tooth_index=9");
+    CHECK_EQ(s.rpm_x10, 104166u, "10000 ticks/posição (10°) → 10416.6 rpm");
+    CHECK_EQ(w.tooth_deg_x10[s.tooth_index], 900u, "dente 9 a 90.0°");
+
+    // Volta completa sem perder sync; depois gap prematuro → LOSS.
+    wheel_fire_teeth(w, 10u, 34u, kNormalPeriod);
+    wheel_fire_teeth(w, 0u, 20u, kNormalPeriod);
+    CHECK_EQ(static_cast<uint8_t>(ckp_snapshot().state),
+             static_cast<uint8_t>(SyncState::FULL_SYNC), "FULL_SYNC mantido na volta seguinte");
+    ckp_fire(kNormalPeriod * 2u);
+    CHECK_EQ(static_cast<uint8_t>(ckp_snapshot().state),
+             static_cast<uint8_t>(SyncState::LOSS_OF_SYNC), "gap no dente 21 → LOSS");
+
+    // Re-sync a partir de LOSS exige o segmento (quase) completo.
+    wheel_fire_teeth(w, 22u, 34u, kNormalPeriod);
+    wheel_fire_teeth(w, 0u, 0u, kNormalPeriod);
+    CHECK_EQ(static_cast<uint8_t>(ckp_snapshot().state),
+             static_cast<uint8_t>(SyncState::LOSS_OF_SYNC), "segmento parcial não re-sincroniza");
+    wheel_fire_teeth(w, 1u, 34u, kNormalPeriod);
+    wheel_fire_teeth(w, 0u, 0u, kNormalPeriod);
+    CHECK_EQ(static_cast<uint8_t>(ckp_snapshot().state),
+             static_cast<uint8_t>(SyncState::HALF_SYNC), "segmento completo → HALF_SYNC");
+
+    // Gap ausente: 35 posições sem o dente largo → wrap do último dente → LOSS.
+    for (uint32_t i = 0u; i < 35u; ++i) { ckp_fire(kNormalPeriod); }
+    CHECK_EQ(static_cast<uint8_t>(ckp_snapshot().state),
+             static_cast<uint8_t>(SyncState::LOSS_OF_SYNC), "gap ausente → LOSS");
+    ckp_test_reset();
+    CHECK_EQ(&ckp_wheel(), &kTriggerWheel, "reset repõe a roda do build");
+}
+
+void test_ckp_wheel_36_2_2_2(void) {
+    section("ckp: roda 36-2-2-2 — identificação pelo segmento longo");
+    ckp_test_reset(); g_ckp_cap = 0u;
+    ckp_test_set_wheel(TriggerWheelId::Wheel36_2_2_2);
+    const TriggerWheel& w = ckp_wheel();
+    const uint32_t gaps0 = g_dbg_gap_accepted;
+
+    // Arranque a meio do 2.º segmento: os gaps após segmentos de 7 (iguais)
+    // não dão posição.
+    wheel_fire_teeth(w, 17u, 23u, kNormalPeriod);
+    CHECK_EQ(static_cast<uint8_t>(ckp_snapshot().state),
+             static_cast<uint8_t>(SyncState::WAIT_GAP), "gap após segmento parcial: sem sync");
+    wheel_fire_teeth(w, 24u, 29u, kNormalPeriod);
+    wheel_fire_teeth(w, 0u, 0u, kNormalPeriod);
+    CHECK_EQ(static_cast<uint8_t>(ckp_snapshot().state),
+             static_cast<uint8_t>(SyncState::WAIT_GAP), "gap após segmento de 7: ambíguo");
+
+    wheel_fire_teeth(w, 1u, 16u, kNormalPeriod);
+    CkpSnapshot s = ckp_snapshot();
+    CHECK_EQ(static_cast<uint8_t>(s.state), static_cast<uint8_t>(SyncState::HALF_SYNC),
+             "gap após segmento de 16 → HALF_SYNC");
+    CHECK_EQ(s.tooth_index, 16u, "posição identificada: dente 16 (180°)");
+    const bool phase0 = s.phase_A;
+
+    wheel_fire_teeth(w, 17u, 23u, kNormalPeriod);
+    s = ckp_snapshot();
+    CHECK_EQ(static_cast<uint8_t>(s.state), static_cast<uint8_t>(SyncState::FULL_SYNC),
+             "gap seguinte na posição esperada → FULL_SYNC");
+    CHECK_EQ(s.tooth_index, 23u, "dente 23 após o 2.º gap");
+    CHECK_EQ(s.phase_A, phase0, "gap intermédio não avança a fase");
+    CHECK_EQ(s.rpm_x10, 104166u, "rpm pela roda de 36 posições");
+
+    wheel_fire_teeth(w, 24u, 29u, kNormalPeriod);
+    wheel_fire_teeth(w, 0u, 0u, kNormalPeriod);
+    s = ckp_snapshot();
+    CHECK_EQ(s.tooth_index, 0u, "gap de referência → dente 0");
+    CHECK_EQ(s.phase_A, !phase0, "gap de referência avança a fase (360°)");
+
+    // Volta completa em sync: 3 gaps aceites por volta.
+    wheel_fire_teeth(w, 1u, 29u, kNormalPeriod);
+    wheel_fire_teeth(w, 0u, 0u, kNormalPeriod);
+    CHECK_EQ(static_cast<uint8_t>(ckp_snapshot().state),
+             static_cast<uint8_t>(SyncState::FULL_SYNC), "FULL_SYNC mantido numa volta");
+    CHECK_EQ(g_dbg_gap_accepted - gaps0, 4u, "gaps aceites em FULL_SYNC: 1 + 3 por volta");
+
+    // Gap prematuro a meio do segmento de 16 → LOSS.
+    wheel_fire_teeth(w, 1u, 5u, kNormalPeriod);
+    ckp_fire(kNormalPeriod * 3u);
+    CHECK_EQ(static_cast<uint8_t>(ckp_snapshot().state),
+             static_cast<uint8_t>(SyncState::LOSS_OF_SYNC), "gap prematuro → LOSS");
+    ckp_test_reset();
+}
+
+// Uma volta 60-2 a partir do dente 0: intervalos 10 e 11 com ±5 % (dente 11
+// deslocado 0.3° para trás), soma igual à nominal.
+static void geom_fire_rev(uint32_t p) {
+    for (uint8_t t = 0u; t < 57u; ++t) {
+        if (t == 10u) { ckp_fire(p * 105u / 100u); }
+        else if (t == 11u) { ckp_fire(p * 95u / 100u); }
+        else { ckp_fire(p); }
+    }
+    ckp_fire(p * 3u);
+}
+
+void test_ckp_tooth_geometry_learning(void) {
+    section("ckp: aprendizagem da geometria por dente (corte + cruzeiro)");
+    tooth_geom_enable = 1u;
+    tooth_geom_init();
+    ckp_reach_full_sync();
+
+    // Corte de desaceleração: lotes de 8 voltas aceites sem critério de RPM.
+    tooth_geom_update(62500u, true, true);
+    for (uint32_t rev = 0u; rev < 200u; ++rev) {
+        geom_fire_rev(kNormalPeriod);
+        tooth_geom_update(62500u, true, true);
+    }
+    CHECK_TRUE(tooth_geom_batches() >= 20u, "lotes integrados em corte");
+    CHECK_EQ(tooth_geom_rejected(), 0u, "nenhum lote rejeitado");
+    const int32_t l10 = tooth_geom_len_q15(10u);
+    const int32_t l11 = tooth_geom_len_q15(11u);
+    const int32_t l5 = tooth_geom_len_q15(5u);
+    CHECK_TRUE(std::abs(l10 - 34406) < 200, "intervalo 10 aprendido ≈ 1.05");
+    CHECK_TRUE(std::abs(l11 - 31130) < 200, "intervalo 11 aprendido ≈ 0.95");
+    CHECK_TRUE(std::abs(l5 - 32768) < 40, "intervalo nominal fica em 1.0");
+    CHECK_EQ(tooth_geom_len_q15(57u), kToothGeomOneQ15, "intervalo do gap não aprende");
+
+    // Predição: antes do intervalo longo prevê o período longo; depois dele,
+    // o curto — o trend nominal é zero (velocidade constante).
+    for (uint8_t t = 0u; t < 10u; ++t) { ckp_fire(kNormalPeriod); }
+    uint32_t pred = ckp_snapshot().predicted_tooth_period_ns;
+    CHECK_TRUE(pred > 166000u && pred < 170000u, "prevê intervalo 10 ≈ 10500 ticks");
+    ckp_fire(kNormalPeriod * 105u / 100u);
+    pred = ckp_snapshot().predicted_tooth_period_ns;
+    CHECK_TRUE(pred > 150000u && pred < 154000u,
+               "prevê intervalo 11 ≈ 9500 ticks (legado: 11000)");
+
+    // Ângulo: início nominal do dente 11 cai ainda no intervalo real 10.
+    uint8_t tooth = 0u;
+    uint8_t frac = 0u;
+    tooth_geom_map_position(11u * 256u, &tooth, &frac);
+    CHECK_EQ(tooth, 10u, "posição 11.0 → dente real 10");
+    CHECK_TRUE(frac >= 240u && frac <= 246u, "fracção ≈ 1/1.05 do intervalo 10");
+    tooth_geom_map_position(30u * 256u + 128u, &tooth, &frac);
+    CHECK_EQ(tooth, 30u, "dente longe do erro mantém o índice");
+    CHECK_TRUE(frac >= 126u && frac <= 130u, "fracção nominal ≈ 128");
+
+    // Cruzeiro com o RPM a variar > 2 % no lote: rejeitado, tabela intacta.
+    ckp_reach_full_sync();
+    const uint16_t rej0 = tooth_geom_rejected();
+    tooth_geom_update(30000u, false, true);
+    for (uint32_t rev = 0u; rev < 9u; ++rev) { geom_fire_rev(kNormalPeriod); }
+    tooth_geom_update(31000u, false, true);
+    CHECK_EQ(tooth_geom_rejected(), static_cast<uint16_t>(rej0 + 1u),
+             "lote de cruzeiro com Δrpm > 2 % rejeitado");
+    CHECK_EQ(tooth_geom_len_q15(10u), static_cast<uint16_t>(l10), "rejeição não altera a tabela");
+
+    // Desligar volta à identidade (predição e mapeamento nominais).
+    tooth_geom_enable = 0u;
+    tooth_geom_update(62500u, true, true);
+    CHECK_EQ(tooth_geom_len_q15(10u), kToothGeomOneQ15, "enable=0 repõe identidade");
+    CHECK_EQ(tooth_geom_pred(10u).len_next_q15, kToothGeomOneQ15, "preditor na identidade");
+    ckp_test_reset();
+}
+
+// Erro fino alternado: intervalos pares 1.002, ímpares 0.998 (0-55), 56
+// nominal — abaixo de 1 LSB de ×256 por dente, mas a volta fecha em 360°.
+static void geom_fire_rev_fine(uint32_t p) {
+    for (uint8_t t = 0u; t < 57u; ++t) {
+        if (t == 56u) { ckp_fire(p); }
+        else { ckp_fire((t % 2u) == 0u ? p * 1002u / 1000u : p * 998u / 1000u); }
+    }
+    ckp_fire(p * 3u);
+}
+
+void test_ckp_tooth_geometry_fine(void) {
+    section("ckp: geometria por dente — erro de 0.2 % sem deriva ao longo da roda");
+    tooth_geom_enable = 1u;
+    tooth_geom_init();
+    ckp_reach_full_sync();
+    const uint32_t seq0 = tooth_geom_tables.sequence();
+
+    tooth_geom_update(62500u, true, true);
+    for (uint32_t rev = 0u; rev < 200u; ++rev) {
+        geom_fire_rev_fine(kNormalPeriod);
+        tooth_geom_update(62500u, true, true);
+    }
+    CHECK_TRUE(tooth_geom_batches() >= 20u, "lotes integrados em corte");
+    CHECK_TRUE(std::abs(static_cast<int32_t>(tooth_geom_len_q15(0u)) - 32834) < 12,
+               "intervalo 0 aprendido ≈ 1.002");
+    CHECK_TRUE(std::abs(static_cast<int32_t>(tooth_geom_len_q15(1u)) - 32702) < 12,
+               "intervalo 1 aprendido ≈ 0.998");
+
+    // Cada lote publica o bloco inteiro no buffer inactivo (seq +2).
+    const uint32_t seq1 = tooth_geom_tables.sequence();
+    CHECK_EQ(seq1 & 1u, 0u, "nenhuma escrita pendente");
+    CHECK_EQ(seq1 - seq0, 2u * tooth_geom_batches(), "um commit por lote");
+    const ToothGeomTables& g = tooth_geom_tables.view();
+    const TriggerWheel& w = ckp_wheel();
+    CHECK_EQ(g.start_q15[w.real_teeth], static_cast<uint32_t>(w.positions) * kToothGeomOneQ15,
+             "a volta fecha exactamente em positions");
+    CHECK_EQ(tooth_geom_pred(0u).len_next_q15, tooth_geom_len_q15(1u),
+             "preditor do mesmo lote que as posições");
+
+    // Fim da roda: sem deriva acumulada (×256 truncado perdia 1/256 por par).
+    uint8_t tooth = 0u;
+    uint8_t frac = 0u;
+    tooth_geom_map_position(56u * 256u + 128u, &tooth, &frac);
+    CHECK_EQ(tooth, 56u, "posição 56.5 → dente 56");
+    CHECK_TRUE(frac >= 126u && frac <= 130u, "fracção ≈ 128 no último dente normal");
+    tooth_geom_map_position(57u * 256u, &tooth, &frac);
+    CHECK_EQ(tooth, 57u, "posição 57.0 → dente do gap");
+    CHECK_TRUE(frac <= 1u, "início do gap no nominal");
+    tooth_geom_map_position(1u * 256u, &tooth, &frac);
+    CHECK_EQ(tooth, 0u, "posição 1.0 ainda no intervalo 0 (1.002)");
+    CHECK_TRUE(frac >= 254u, "fracção ≈ 1/1.002 do intervalo 0");
+
+    tooth_geom_enable = 0u;
+    tooth_geom_update(62500u, true, true);
+    ckp_test_reset();
+}
+
+void test_ckp_snapshot_seqlock(void) {
+    section("ckp: snapshot publicado por seqlock (leitor sem CPSID)");
+    struct Pair { uint32_t a; uint32_t b; };
+    SeqLock<Pair> lk{Pair{1u, 1u}};
+    CHECK_EQ(lk.sequence(), 0u, "seq inicial par");
+    lk.write(Pair{2u, 2u});
+    CHECK_EQ(lk.sequence(), 2u, "um commit avança seq em 2");
+    Pair p = lk.read();
+    CHECK_EQ(p.a, 2u, "leitura devolve o último commit");
+
+    // Escritor interrompido a meio: o buffer publicado continua legível.
+    lk.test_begin_write();
+    CHECK_EQ(lk.sequence() & 1u, 1u, "escrita pendente: seq ímpar");
+    CHECK_TRUE(lk.try_read(p), "try_read com escrita pendente é consistente");
+    CHECK_EQ(p.b, 2u, "escrita pendente não é visível");
+    lk.write(Pair{3u, 3u});
+    CHECK_EQ(lk.sequence(), 4u, "commit após escrita interrompida fecha a sequência");
+    CHECK_EQ(lk.view().a, 3u, "view = buffer publicado");
+
+    // O snapshot da CKP é publicado à saída de cada ISR e no stall poll.
+    ckp_reach_full_sync();
+    const uint32_t idx0 = ckp_snapshot().tooth_index;
+    ckp_fire(kNormalPeriod);
+    CHECK_EQ(ckp_snapshot().tooth_index, idx0 + 1u, "snapshot reflecte o dente seguinte");
+    ckp_test_reset();
+    const CkpSnapshot s = ckp_snapshot();
+    CHECK_EQ(static_cast<uint8_t>(s.state), static_cast<uint8_t>(SyncState::WAIT_GAP),
+             "reset republica WAIT_GAP");
+    CHECK_EQ(s.rpm_x10, 0u, "reset republica rpm=0");
+}
+
 // (all includes moved to top of file)
 
 // ============================================================================
@@ -13,6 +13,7 @@
 #include "engine/torque_manager.h"
 #include "engine/calibration.h"
 #include "app/can_rx_map.h"
+#include "app/loop_sched.h"
 #include "hal/adc.h"
 #include "hal/system.h"
 #include "drv/ckp.h"
@@ -21,7 +22,10 @@
 #include "engine/ign_calc.h"
 #include "engine/auxiliaries.h"
 #include "engine/knock.h"
+#include "engine/knock_learn.h"
 #include "engine/table3d.h"
+#include "engine/table_ops.h"
+#include "engine/table_reaxis.h"
 #include "engine/ecu_sched.h"
 #include "engine/quick_crank.h"
 #include "engine/transient_fuel.h"
@@ -33,6 +37,11 @@
 #include "engine/engine_config.h"
 #include "hal/timer.h"
 #include "hal/flash.h"
+#include "hal/flash_jobs.h"
+#include "hal/spi_jobs.h"
+#include "hal/tle8888.h"
+#include "hal/cal_store.h"
+#include "hal/nvm_journal.h"
 #include "app/ui_protocol.h"
 #include "app/status_bits.h"
 #include "hal/crc32.h"
@@ -177,6 +186,386 @@ void test_table3d_all(void) {
     CHECK_EQ(adv_q10, 1000 << 10, "flat adv=1000 → adv_q10=1000<<10");
 }
 
+// Referências célula a célula; n = kTableCells + 3 (cauda não múltipla de 4)
+// e ponteiros desalinhados (+1) exercitam o laço por palavra e a cauda.
+void test_table_ops_all(void) {
+    using namespace ems::engine;
+
+    constexpr uint16_t kN = kTableCells + 3u;
+    static uint8_t a_buf[kN + 1u];
+    static uint8_t b_buf[kN + 1u];
+    static uint8_t ref[kN];
+    static int8_t  d_buf[kN + 1u];
+    static int16_t s16_a[kN];
+    static int16_t s16_b[kN];
+    static int16_t s16_ref[kN];
+    static int16_t trims[kN];
+    static uint8_t bits[(kN + 7u) / 8u];
+    uint8_t* const a = a_buf + 1;
+    uint8_t* const b = b_buf + 1;
+    int8_t* const d = d_buf + 1;
+    uint32_t seed = 0x1234567u;
+    auto rnd = [&seed]() noexcept -> uint8_t {
+        seed = seed * 1103515245u + 12345u;
+        return static_cast<uint8_t>(seed >> 16u);
+    };
+    auto fill = [&]() noexcept {
+        for (uint16_t i = 0u; i < kN; ++i) {
+            a[i] = rnd();
+            b[i] = rnd();
+            d[i] = static_cast<int8_t>(rnd());
+        }
+        a[0] = 250u; d[0] = 100;     // satura em 255
+        a[1] = 5u;   d[1] = -128;    // satura em 0 (−128 exacto)
+        a[2] = 0u;   d[2] = 127;
+    };
+
+    section("table_ops: add_sat_u8 (UQADD8/UQSUB8)");
+    fill();
+    for (uint16_t i = 0u; i < kN; ++i) {
+        const int32_t v = static_cast<int32_t>(a[i]) + d[i];
+        ref[i] = static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+    table_ops_add_sat_u8(a, d, kN);
+    CHECK_TRUE(std::memcmp(a, ref, kN) == 0, "add_sat_u8 == referência (satura 0/255)");
+
+    section("table_ops: blend u8/s16 (SMLAD)");
+    static const uint16_t kAlphas[] = {0u, 1u, 77u, 128u, 255u, 256u};
+    for (const uint16_t alpha : kAlphas) {
+        fill();
+        for (uint16_t i = 0u; i < kN; ++i) {
+            ref[i] = static_cast<uint8_t>(
+                (a[i] * (256 - alpha) + b[i] * alpha + 128u) >> 8u);
+            s16_a[i] = static_cast<int16_t>((a[i] << 7) - (b[i] << 6));
+            s16_b[i] = static_cast<int16_t>((b[i] << 7) - 20000);
+            s16_ref[i] = static_cast<int16_t>(
+                (s16_a[i] * static_cast<int32_t>(256 - alpha) +
+                 s16_b[i] * static_cast<int32_t>(alpha) + 128) >> 8);
+        }
+        table_ops_blend_u8(a, b, kN, alpha);
+        table_ops_blend_s16(s16_a, s16_b, kN, alpha);
+        char msg[64];
+        std::snprintf(msg, sizeof msg, "blend_u8 α=%u == referência", alpha);
+        CHECK_TRUE(std::memcmp(a, ref, kN) == 0, msg);
+        std::snprintf(msg, sizeof msg, "blend_s16 α=%u == referência (com sinal)", alpha);
+        CHECK_TRUE(std::memcmp(s16_a, s16_ref, sizeof s16_a) == 0, msg);
+    }
+
+    section("table_ops: copy_masked / diff");
+    fill();
+    for (uint16_t i = 0u; i < sizeof bits; ++i) { bits[i] = rnd(); }
+    for (uint16_t i = 0u; i < kN; ++i) {
+        ref[i] = table_ops_bit(bits, i) ? b[i] : a[i];
+    }
+    table_ops_copy_masked_u8(a, b, bits, kN);
+    CHECK_TRUE(std::memcmp(a, ref, kN) == 0, "copy_masked_u8 só nas células marcadas");
+    std::memcpy(a, b, kN);
+    CHECK_EQ(table_ops_diff_u8(a, b, kN, bits), 0u, "diff de cópias = 0");
+    a[5] ^= 1u; a[200] ^= 0x80u; a[kN - 1u] ^= 0x10u;
+    CHECK_EQ(table_ops_diff_u8(a, b, kN, nullptr), 3u, "diff conta 3 células");
+    (void)table_ops_diff_u8(a, b, kN, bits);
+    CHECK_TRUE(table_ops_bit(bits, 5u) && table_ops_bit(bits, 200u) &&
+               table_ops_bit(bits, kN - 1u) && !table_ops_bit(bits, 6u),
+               "diff_bits marca exactamente as diferentes");
+
+    section("table_ops: trim_delta_u8_x10 + add_sat_u8 (regra do commit LTFT)");
+    fill();
+    std::memcpy(ref, a, kN);
+    uint16_t expect_changed = 0u;
+    for (uint16_t i = 0u; i < kN; ++i) {
+        trims[i] = ((i % 7u) == 0u) ? static_cast<int16_t>(static_cast<int8_t>(rnd())) : 0;
+        if (trims[i] == 0) { continue; }
+        const int32_t old = ref[i];
+        const int32_t f = 1000 + trims[i];
+        int32_t v = (old * f + (f >= 0 ? 500 : -500)) / 1000;
+        if (v == old) { v = old + (trims[i] > 0 ? 1 : -1); }
+        if (v < 1) { v = 1; }
+        if (v > 200) { v = 200; }
+        if (v != old) { ref[i] = static_cast<uint8_t>(v); ++expect_changed; }
+    }
+    std::memcpy(b, a, kN);
+    const uint16_t changed = table_ops_trim_delta_u8_x10(a, trims, kN, 1u, 200u, d, bits);
+    CHECK_TRUE(std::memcmp(a, b, kN) == 0, "trim_delta_u8_x10 não escreve a tabela");
+    table_ops_add_sat_u8(a, d, kN);
+    CHECK_TRUE(std::memcmp(a, ref, kN) == 0, "trim_delta + add_sat == regra célula a célula");
+    CHECK_EQ(changed, expect_changed, "trim_delta_u8_x10 conta células alteradas");
+    uint16_t nbits = 0u;
+    uint16_t ndelta = 0u;
+    for (uint16_t i = 0u; i < kN; ++i) {
+        nbits = static_cast<uint16_t>(nbits + (table_ops_bit(bits, i) ? 1u : 0u));
+        ndelta = static_cast<uint16_t>(ndelta + ((d[i] != 0) ? 1u : 0u));
+    }
+    CHECK_EQ(nbits, expect_changed, "changed_bits coerente com a contagem");
+    CHECK_EQ(ndelta, expect_changed, "delta a 0 nas células sem mudança");
+    uint8_t one = 200u;
+    int16_t up = 40;
+    int8_t one_delta = 5;
+    CHECK_EQ(table_ops_trim_delta_u8_x10(&one, &up, 1u, 1u, 200u, &one_delta, bits), 0u,
+             "VE no tecto: clamp mata a mudança → 0 alteradas");
+    CHECK_EQ(one_delta, 0, "VE no tecto: delta 0");
+
+    section("table_ops: crc32 == hal::crc32_calc");
+    fill();
+    CHECK_EQ(table_ops_crc32(a, kN), ems::hal::crc32_calc(a, kN), "CRC-32 sobre ponteiro desalinhado");
+    CHECK_EQ(table_ops_crc32(reinterpret_cast<const uint8_t*>("123456789"), 9u), 0xCBF43926u,
+             "CRC-32 check value");
+}
+
+void test_table_reaxis(void) {
+    using namespace ems::engine;
+
+    static uint8_t ve_saved[sizeof(ve_table)];
+    static int8_t  spark_saved[sizeof(spark_table)];
+    static int16_t lambda_saved[kTableCells];
+    std::memcpy(ve_saved, ve_table, sizeof(ve_saved));
+    std::memcpy(spark_saved, spark_table, sizeof(spark_saved));
+    std::memcpy(lambda_saved, lambda_target_table_x1000, sizeof(lambda_saved));
+    uint16_t rpm0[kTableAxisSize];
+    uint16_t load0[kTableAxisSize];
+    table_axes_get(rpm0, load0);
+    auto run_job = []() noexcept -> uint16_t {
+        uint16_t steps = 0u;
+        while (table_reaxis_pending() && steps < 1000u) {
+            (void)table_reaxis_process(kReaxisRowsPerCall);
+            ++steps;
+        }
+        return steps;
+    };
+
+    // Tabelas planas em y e lineares em x (RPM): a re-amostragem bilinear de
+    // uma função linear é exacta nos nós novos dentro da grelha antiga.
+    static int16_t ltft[kTableCells];
+    static int16_t ltft_add[kLtftAddAxisSize * kLtftAddAxisSize];
+    for (uint8_t y = 0u; y < kTableAxisSize; ++y) {
+        for (uint8_t x = 0u; x < kTableAxisSize; ++x) {
+            ve_table[y][x] = static_cast<uint8_t>(40u + 5u * x);
+            spark_table[y][x] = static_cast<int8_t>(-10 + 2 * static_cast<int>(x));
+            lambda_target_table_x1000[y][x] = static_cast<int16_t>(800 + 10 * y);
+            ltft[y * kTableAxisSize + x] = static_cast<int16_t>(10 * x - 100);
+        }
+    }
+    for (uint16_t i = 0u; i < kLtftAddAxisSize * kLtftAddAxisSize; ++i) {
+        ltft_add[i] = static_cast<int16_t>(50 * (i % kLtftAddAxisSize));
+    }
+    fuel_ltft_replace_maps(ltft, ltft_add);
+    static int32_t knock_map[kKnockLearnCells];
+    for (uint16_t i = 0u; i < kKnockLearnCells; ++i) {
+        knock_map[i] = static_cast<int32_t>(8u * (i % kKnockLearnDim)) << 16;   // 0.8°/nó
+    }
+    knock_learn_replace_map(knock_map);
+
+    section("table_reaxis: validação e identidade");
+    uint16_t bad[kTableAxisSize];
+    std::memcpy(bad, rpm0, sizeof(bad));
+    bad[5] = bad[4];
+    CHECK_TRUE(!table_reaxis_request(bad, load0), "eixo não monotónico rejeitado");
+    CHECK_TRUE(!table_reaxis_pending(), "rejeição não cria job");
+    CHECK_TRUE(table_reaxis_request(rpm0, load0) && !table_reaxis_pending(),
+               "eixos iguais aos actuais → sem job");
+
+    section("table_reaxis: settle, fatias e commit atómico");
+    // RPM: nós novos a meio dos antigos na zona baixa (500..2750 → 625..2875).
+    uint16_t rpm1[kTableAxisSize];
+    std::memcpy(rpm1, rpm0, sizeof(rpm1));
+    for (uint8_t i = 0u; i < 10u; ++i) { rpm1[i] = static_cast<uint16_t>(rpm0[i] + 125u); }
+    const uint16_t commits0 = table_reaxis_commit_count();
+    CHECK_TRUE(table_reaxis_request(rpm1, load0), "pedido válido aceite");
+    for (uint8_t i = 0u; i + 1u < kReaxisSettleCalls; ++i) {
+        (void)table_reaxis_process(kReaxisRowsPerCall);
+    }
+    // Novo chunk a meio do settle reinicia a espera.
+    CHECK_TRUE(table_reaxis_request(rpm1, load0), "pedido repetido");
+    uint16_t steps = 0u;
+    bool published_early = false;
+    while (table_reaxis_pending() && steps < 1000u) {
+        const uint32_t axis_before = kRpmAxisX10[0];
+        const uint8_t ve_before = ve_table[0][0];
+        const bool done = table_reaxis_process(kReaxisRowsPerCall);
+        if (!done && (kRpmAxisX10[0] != axis_before || ve_table[0][0] != ve_before)) {
+            published_early = true;
+        }
+        ++steps;
+    }
+    CHECK_EQ(steps, kReaxisSettleCalls + (kTableAxisSize + kReaxisRowsPerCall - 1u) / kReaxisRowsPerCall - 1u,
+             "settle reiniciado + 5 fatias de 4 linhas");
+    CHECK_TRUE(!published_early, "nada publicado antes do commit");
+    CHECK_EQ(table_reaxis_commit_count(), static_cast<uint16_t>(commits0 + 1u), "um commit");
+    CHECK_EQ(kRpmAxisX10[0], 6250u, "eixo RPM novo publicado");
+    // 625 RPM = meio de 500..750 → VE 40 + 2.5 = 42.5 → 43.
+    CHECK_EQ(ve_table[7][0], 43u, "VE a meio do segmento (arredonda)");
+    CHECK_EQ(ve_table[7][12], 100u, "VE em nó coincidente inalterada");
+    CHECK_EQ(spark_table[0][1], -7, "spark com sinal a meio do segmento");
+    CHECK_EQ(lambda_target_table_x1000[5][3], 850, "lambda constante em x preservada");
+    CHECK_EQ(fuel_get_ltft_pct_x10(4u, 0u), -95, "LTFT multiplicativo re-amostrado");
+    // Sub-grid (nós pares): nó novo rpm1[2] = 1125 está a 25 % de 1000..1500
+    // no sub-eixo antigo → 50 + 12.5 µs.
+    CHECK_EQ(fuel_get_ltft_add_us(0u, 2u), 63, "LTFT aditivo re-amostrado no sub-grid");
+    // Knock (nós 0,3,5,…): nó novo rpm1[3] = 1375 a 25 % de 1250..1750 → 0.8 + 0.2°.
+    CHECK_EQ(knock_learn_cell_x10(2u, 1u), 10u, "knock aprendido re-amostrado na grelha 8×8");
+    CHECK_EQ(knock_learn_cell_x10(2u, 7u), 56u, "knock em nó coincidente inalterado");
+
+    section("table_reaxis: borda e edição a meio do job");
+    uint16_t rpm2[kTableAxisSize];
+    for (uint8_t i = 0u; i < kTableAxisSize; ++i) {
+        rpm2[i] = static_cast<uint16_t>(rpm1[i] + 1500u);  // topo 9500 > 8000 antigo
+    }
+    CHECK_TRUE(table_reaxis_request(rpm2, load0), "pedido de expansão");
+    for (uint8_t i = 0u; i < kReaxisSettleCalls; ++i) {
+        (void)table_reaxis_process(kReaxisRowsPerCall);
+    }
+    // Linhas 0..3 já em staging; o tuner reescreve a linha 0 da VE.
+    for (uint8_t x = 0u; x < kTableAxisSize; ++x) { ve_table[0][x] = 200u; }
+    (void)run_job();
+    CHECK_EQ(ve_table[0][3], 200u, "fonte editada a meio → job recomeça (edição preservada)");
+    CHECK_EQ(ve_table[5][kTableAxisSize - 1u], 135u, "fora do eixo antigo → valor da borda");
+
+    section("table_reaxis: eixo de carga (blend de linhas)");
+    // Carga: nós 0..1 a meio dos antigos (20/30 → 25/35 bar×100).
+    uint16_t load1[kTableAxisSize];
+    std::memcpy(load1, load0, sizeof(load1));
+    load1[0] = static_cast<uint16_t>(load0[0] + 5u);
+    load1[1] = static_cast<uint16_t>(load0[1] + 5u);
+    const int8_t spark_before = spark_table[1][4];
+    CHECK_TRUE(table_reaxis_request(rpm2, load1), "pedido de carga aceite");
+    (void)run_job();
+    CHECK_EQ(kLoadAxisBarX100[0], 25u, "eixo de carga novo publicado");
+    CHECK_EQ(lambda_target_table_x1000[0][6], 805, "lambda a meio de 800..810 em carga");
+    CHECK_EQ(lambda_target_table_x1000[1][6], 815, "lambda a meio de 810..820 em carga");
+    CHECK_EQ(lambda_target_table_x1000[2][6], 820, "linha em nó coincidente inalterada");
+    CHECK_EQ(spark_table[1][4], spark_before, "avanço constante em carga preservado");
+
+    table_axes_set(rpm0, load0);
+    std::memcpy(ve_table, ve_saved, sizeof(ve_saved));
+    std::memcpy(spark_table, spark_saved, sizeof(spark_saved));
+    std::memcpy(lambda_target_table_x1000, lambda_saved, sizeof(lambda_saved));
+    fuel_reset_ltft();
+    knock_learn_reset();
+}
+
+// ── Loop scheduler (relógio virtual) ─────────────────────────────────────
+
+namespace {
+
+uint32_t g_vclock_us = 0u;
+uint32_t vclock_us() { return g_vclock_us; }
+
+// Cada tarefa regista a ordem de execução e avança o relógio pela sua duração.
+char     g_ls_trace[32] = {};
+uint8_t  g_ls_trace_n = 0u;
+uint32_t g_ls_cost_us[3] = {};
+
+void ls_mark(uint8_t id) {
+    if (g_ls_trace_n < sizeof(g_ls_trace) - 1u) {
+        g_ls_trace[g_ls_trace_n++] = static_cast<char>('A' + id);
+        g_ls_trace[g_ls_trace_n] = '\0';
+    }
+    g_vclock_us += g_ls_cost_us[id];
+}
+void ls_task_a(uint32_t) { ls_mark(0u); }
+void ls_task_b(uint32_t) { ls_mark(1u); }
+void ls_task_c(uint32_t) { ls_mark(2u); }
+
+void ls_reset(uint32_t a, uint32_t b, uint32_t c) {
+    g_vclock_us = 0u;
+    g_ls_trace_n = 0u;
+    g_ls_trace[0] = '\0';
+    g_ls_cost_us[0] = a;
+    g_ls_cost_us[1] = b;
+    g_ls_cost_us[2] = c;
+}
+
+}  // namespace
+
+void test_loop_sched(void) {
+    using ems::app::LoopPrio;
+    using ems::app::LoopScheduler;
+    using ems::app::LoopTask;
+
+    // Tabela fora de ordem: C (kLow) declarada primeiro.
+    static constexpr LoopTask kTasks[] = {
+        {"c_low",  ls_task_c,  2u, LoopPrio::kLow,      400u},
+        {"a_crit", ls_task_a,  2u, LoopPrio::kCritical, 600u},
+        {"b_norm", ls_task_b, 10u, LoopPrio::kNormal,   200u},
+    };
+
+    {
+        ls_reset(100u, 100u, 100u);
+        LoopScheduler s(kTasks, 3u, vclock_us);
+        s.start(0u);
+        CHECK_EQ(s.run(1u), 0u, "loop_sched: nada vencido antes do 1.º período");
+        uint8_t ran = s.run(10u);
+        CHECK_EQ(ran, 3u, "loop_sched: 3 tarefas vencidas a 10 ms");
+        CHECK_TRUE(std::strcmp(g_ls_trace, "ABC") == 0,
+                   "loop_sched: ordem por prioridade, não pela tabela");
+        // 10…100 ms a passos de 1 ms: 2 ms → a cada 2 passos, 10 ms → a cada 10.
+        for (uint32_t t = 11u; t <= 100u; ++t) {
+            g_vclock_us += 1000u;
+            static_cast<void>(s.run(t));
+        }
+        CHECK_EQ(s.stats(1u).runs, 46u, "loop_sched: 2 ms corre 46× em 10…100 ms");
+        CHECK_EQ(s.stats(2u).runs, 10u, "loop_sched: 10 ms corre 10× em 10…100 ms");
+        CHECK_EQ(s.stats(1u).last_run_ms, 100u, "loop_sched: last_run = now do passo");
+        CHECK_EQ(s.stats(1u).late, 0u, "loop_sched: 1.ª execução nunca conta atraso");
+        CHECK_EQ(s.stats(1u).overruns, 0u, "loop_sched: 100 µs dentro do orçamento");
+        CHECK_EQ(s.stats(0u).sheds, 0u, "loop_sched: sem carga, kLow nunca é adiada");
+        CHECK_EQ(s.frame_overruns(), 0u, "loop_sched: passos dentro do frame");
+        CHECK_EQ(s.pass_max_us(), 300u, "loop_sched: passo máximo = 3 tarefas");
+    }
+
+    {
+        // Overrun + atraso: A demora 700 µs (> 600), passo saltado 2→6 ms.
+        ls_reset(700u, 0u, 0u);
+        LoopScheduler s(kTasks, 3u, vclock_us);
+        s.start(0u);
+        static_cast<void>(s.run(2u));
+        static_cast<void>(s.run(6u));
+        CHECK_EQ(s.stats(1u).runs, 2u, "loop_sched: A corre em 2 e 6 ms");
+        CHECK_EQ(s.stats(1u).overruns, 2u, "loop_sched: 700 µs > 600 µs conta overrun");
+        CHECK_EQ(s.stats(1u).max_us, 700u, "loop_sched: max_us da tarefa");
+        CHECK_EQ(s.stats(1u).late, 1u, "loop_sched: 4 ms desde a anterior = atraso");
+        s.clear_stats();
+        CHECK_EQ(s.stats(1u).overruns, 0u, "loop_sched: clear_stats zera contadores");
+        CHECK_EQ(s.stats(1u).last_run_ms, 6u, "loop_sched: clear_stats mantém referência");
+    }
+
+    {
+        // Shedding: A gasta 1800 µs → C (400 µs) não cabe no frame de 2 ms,
+        // fica vencida e corre no passo seguinte (A já não vencida).
+        ls_reset(1800u, 0u, 300u);
+        LoopScheduler s(kTasks, 3u, vclock_us);
+        s.start(0u);
+        static_cast<void>(s.run(2u));
+        CHECK_TRUE(std::strcmp(g_ls_trace, "A") == 0, "loop_sched: C adiada atrás de A");
+        CHECK_EQ(s.stats(0u).sheds, 1u, "loop_sched: shed contado");
+        CHECK_EQ(s.frame_overruns(), 0u, "loop_sched: adiar C mantém o frame");
+        static_cast<void>(s.run(2u));
+        CHECK_TRUE(std::strcmp(g_ls_trace, "AC") == 0, "loop_sched: C corre no passo seguinte");
+        CHECK_EQ(s.stats(0u).runs, 1u, "loop_sched: C executada uma vez");
+        CHECK_EQ(s.stats(0u).shed_streak, 0u, "loop_sched: streak zera ao correr");
+    }
+
+    {
+        // Anti-fome: A vencida em todos os passos e a 1900 µs — C é adiada
+        // kLoopShedMaxStreak vezes seguidas e depois corre mesmo assim.
+        ls_reset(1900u, 0u, 300u);
+        LoopScheduler s(kTasks, 3u, vclock_us);
+        s.start(0u);
+        uint32_t t = 0u;
+        for (uint8_t i = 0u; i < ems::app::kLoopShedMaxStreak; ++i) {
+            t += 2u;
+            static_cast<void>(s.run(t));
+        }
+        CHECK_EQ(s.stats(0u).runs, 0u, "loop_sched: C adiada durante a carga");
+        CHECK_EQ(s.stats(0u).sheds, ems::app::kLoopShedMaxStreak,
+                 "loop_sched: 1 shed por passo carregado");
+        t += 2u;
+        static_cast<void>(s.run(t));
+        CHECK_EQ(s.stats(0u).runs, 1u, "loop_sched: C forçada após o limite de sheds");
+        CHECK_EQ(s.frame_overruns(), 1u, "loop_sched: passo forçado excede o frame");
+        CHECK_EQ(s.pass_max_us(), 2200u, "loop_sched: passo forçado = A + C");
+    }
+}
+
 // ============================================================================
 // ECU SCHED
 // ============================================================================
@@ -416,6 +805,158 @@ void test_map_estimator_all(void) {
                "IAT baixo (ar mais denso) → fluxo de admissão maior ou igual ao de IAT alto");
 }
 
+// Colector "real" para o ensaio de tip-in: mesma física de continuidade do
+// estimador, com coeficientes ±10% desviados (o modelo nunca é exacto) e
+// integração a 0.1 ms em double.
+namespace {
+struct ManifoldPlant {
+    double p = 25.0;  // bar_x100
+    void step(double tps_x10, double rpm_x10, double dt_s) {
+        const double tk_x10 = 2950.0;
+        for (int i = 0; i < 10; ++i) {
+            const double in = 1.10 * 800.0 * (tps_x10 / 1000.0) *
+                              ((100.0 - p) / 100.0) * (2930.0 / tk_x10);
+            const double out = 0.92 * 256.0 * p * rpm_x10 * 2000.0 / (tk_x10 * 1e6);
+            p += (in - out) * 5000.0 / 5000.0 * (dt_s / 10.0);
+        }
+    }
+};
+}  // namespace
+
+void test_map_predictor_ivc(void) {
+    using namespace ems::engine;
+
+    const uint8_t  saved_gain = map_pred_gain_pct;
+    const uint16_t saved_ivc  = map_pred_ivc_btdc_deg;
+    fuel_set_baro_bar_x100(100u);
+    map_pred_ivc_btdc_deg = 140u;
+
+    section("map_pred: horizonte por cilindro agora → EOI → IVC");
+    uint32_t h[cfg::kCylinderCount];
+    // 2000 RPM, EOI 355° (open-valve), IVC 140°, cambota no PMS do cil. 0.
+    // cil. 0: EOI a 365°, +215° até ao IVC = 580° = 48.3 ms.
+    map_pred_horizon_cyl_us(20000u, 0u, 355u, 3000u, h);
+    CHECK_EQ(h[0], 48332u, "cil. 0: 365° até ao EOI + 215° até ao IVC");
+    if (cfg::kCylinderCount == 4u) {
+        CHECK_EQ(h[1], 33332u, "cil. 1 (PMS 540°): 185° + 215° — o próximo servido");
+        CHECK_EQ(h[2], 63332u, "cil. 2 (PMS 180°): 545° + 215°");
+        // EOI do cil. 3 a 5° (0.4 ms < latência + PW): SOI já passou → +720°.
+        CHECK_EQ(h[3], 78332u, "cil. 3: injecção em curso → IVC do ciclo seguinte");
+    }
+    // Mesmo ponto com a cambota 24° à frente: todos 2 ms mais perto.
+    uint32_t h24[cfg::kCylinderCount];
+    map_pred_horizon_cyl_us(20000u, 24u, 355u, 3000u, h24);
+    CHECK_EQ(h24[0], 46332u, "cambota +24° @2000 rpm → −2 ms");
+    // EOI 60° (closed-valve, depois do IVC) → ar do ciclo seguinte (+640°).
+    map_pred_horizon_cyl_us(60000u, 0u, 60u, 0u, h);
+    CHECK_EQ(h[0], 36110u, "EOI após IVC: 660° + 640° @6000 rpm");
+    map_pred_horizon_cyl_us(3000u, 0u, 60u, 0u, h);
+    CHECK_EQ(h[0], 100000u, "ralenti baixo → limite 100 ms");
+    map_pred_horizon_cyl_us(400u, 0u, 355u, 0u, h);
+    CHECK_EQ(h[0], 0u, "cranking / parado → sem predição");
+
+    section("map_pred: regime → MAP actual; gain 0 → bypass");
+    map_estimator_init();
+    ManifoldPlant plant;
+    for (uint32_t t = 0u; t < 2000u; t += 2u) {  // 2 s a 15% / 2000 rpm
+        plant.step(150.0, 20000.0, 0.002);
+        map_estimator_update(static_cast<uint16_t>(plant.p + 0.5), 150u, 2u, 20000u, 220);
+    }
+    const uint16_t now = map_get_estimated_bar_x100();
+    const uint16_t pred = map_estimator_predict(now, 150u, 0, 20000u, 220, 40000u);
+    CHECK_TRUE(std::abs(static_cast<int>(pred) - static_cast<int>(now)) <= 2,
+               "regime: predição a 40 ms ≈ MAP actual (bias do modelo descontado)");
+    map_pred_gain_pct = 0u;
+    uint16_t ivc_map[cfg::kCylinderCount];
+    CHECK_EQ(map_estimator_predict_ivc_cyl(now, 900u, 20000u, 220, 0u, 355u, 3000u, ivc_map),
+             now, "map_pred_gain_pct=0 → MAP fundido inalterado");
+    CHECK_EQ(ivc_map[cfg::kCylinderCount - 1u], now, "gain 0 → todos os cilindros no MAP fundido");
+    CHECK_TRUE(map_estimator_predict(now, 900u, 0, 20000u, 220, 40000u) > now + 5u,
+               "borboleta aberta → MAP previsto sobe");
+    CHECK_EQ(map_estimator_predict(now, 900u, 0, 20000u, 220, 0u), now,
+             "horizonte 0 → MAP actual");
+
+    section("map_pred: tip-in 15→90% — erro de lambda ao IVC de cada cilindro");
+    // Simulador host: slot de 2 ms comita PW com MAP(t) (off) ou MAP previsto
+    // por cilindro (on); a cambota avança 24° por slot a 2000 rpm. O ar real
+    // de cada cilindro é o MAP da planta em t + horizonte desse cilindro,
+    // avaliado no commit que o scheduler efectivamente usa.
+    // Erro de lambda do speed-density ≈ MAP_usado / MAP_IVC − 1 (negativo =
+    // pobre).
+    uint32_t spread_ms = 0u;
+    auto run_snap = [&spread_ms](uint8_t gain, double& worst_lean,
+                                 double& worst_rich) noexcept {
+        map_pred_gain_pct = gain;
+        map_estimator_init();
+        ManifoldPlant pl;
+        constexpr uint32_t kSimMs = 1400u;
+        constexpr uint32_t kSnapMs = 1000u;
+        constexpr uint8_t kCyl = cfg::kCylinderCount;
+        static double p_true[kSimMs + 1u];
+        static double used[kSimMs + 1u][kCyl];
+        static uint32_t h_us[kSimMs + 1u][kCyl];
+        double tps = 150.0;
+        for (uint32_t t = 0u; t <= kSimMs; ++t) {
+            if (t >= kSnapMs && tps < 900.0) { tps += 25.0; }  // 2500 %/s, 30 ms
+            if (tps > 900.0) { tps = 900.0; }
+            pl.step(tps, 20000.0, 0.001);
+            p_true[t] = pl.p;
+            if ((t % 2u) == 0u) {
+                const uint16_t m = map_estimator_update(
+                    static_cast<uint16_t>(pl.p + 0.5), static_cast<uint16_t>(tps),
+                    2u, 20000u, 220);
+                const uint16_t deg = static_cast<uint16_t>((t * 12u) % 720u);
+                uint16_t cyl_map[kCyl];
+                map_estimator_predict_ivc_cyl(m, static_cast<uint16_t>(tps), 20000u, 220,
+                                              deg, 355u, 3000u, cyl_map);
+                map_pred_horizon_cyl_us(20000u, deg, 355u, 3000u, h_us[t]);
+                for (uint8_t c = 0u; c < kCyl; ++c) { used[t][c] = cyl_map[c]; }
+                // Em pleno enchimento, o cilindro de IVC mais tardio vê mais ar.
+                if (gain != 0u && t == kSnapMs + 20u) {
+                    uint8_t lo = 0u, hi = 0u;
+                    for (uint8_t c = 1u; c < kCyl; ++c) {
+                        if (h_us[t][c] < h_us[t][lo]) { lo = c; }
+                        if (h_us[t][c] > h_us[t][hi]) { hi = c; }
+                    }
+                    spread_ms = (cyl_map[hi] > cyl_map[lo])
+                        ? static_cast<uint32_t>(cyl_map[hi] - cyl_map[lo]) : 0u;
+                }
+            }
+        }
+        // Desvio estático do MAP fundido (regime) é absorvido pelo STFT/LTFT:
+        // normalizado. Commits anteriores ao snap ficam fora — nenhum
+        // preditor vê o pedal antes de ele se mexer.
+        const uint32_t ts = kSnapMs - 50u;
+        worst_lean = 0.0;
+        worst_rich = 0.0;
+        for (uint8_t c = 0u; c < kCyl; ++c) {
+            const double ss = used[ts][c] / p_true[ts + (h_us[ts][c] + 500u) / 1000u];
+            for (uint32_t t = kSnapMs; t < kSimMs - 150u; t += 2u) {
+                // Só conta o commit que o cilindro consome: o último antes do
+                // SOI (no slot seguinte o horizonte já salta para o ciclo +1).
+                if (h_us[t + 2u][c] <= h_us[t][c]) { continue; }
+                const uint32_t ti = t + (h_us[t][c] + 500u) / 1000u;
+                const double e = used[t][c] / p_true[ti] / ss - 1.0;
+                if (e < worst_lean) { worst_lean = e; }
+                if (e > worst_rich) { worst_rich = e; }
+            }
+        }
+    };
+    double lean_off = 0.0, rich_off = 0.0, lean_on = 0.0, rich_on = 0.0;
+    run_snap(0u, lean_off, rich_off);
+    run_snap(100u, lean_on, rich_on);
+    printf("  tip-in λ erro ao IVC: sem predição %.1f%% / %.1f%%, com predição %.1f%% / %.1f%%\n",
+           lean_off * 100.0, rich_off * 100.0, lean_on * 100.0, rich_on * 100.0);
+    CHECK_TRUE(lean_off < -0.08, "sem predição: pico pobre > 8% no tip-in");
+    CHECK_TRUE(lean_on > lean_off * 0.5, "com predição: pico pobre reduzido a menos de metade");
+    CHECK_TRUE(rich_on < rich_off + 0.03, "com predição: rico no fim do enchimento ≤ +3% vs sem");
+    CHECK_TRUE(spread_ms >= 2u, "tip-in: IVC mais tardio → MAP previsto maior que o do próximo");
+
+    map_pred_gain_pct = saved_gain;
+    map_pred_ivc_btdc_deg = saved_ivc;
+    map_estimator_init();
+}
+
 // ============================================================================
 // MISFIRE DETECT
 // ============================================================================
@@ -466,6 +1007,134 @@ void test_misfire_all(void) {
     misfire_set_all_inhibit(false);  // restore
 }
 
+// Ciclo 720° sintético (60-2, 4 cil): período base por dente; win_pm = factor
+// ‰ da janela de potência de cada posição de disparo neste ciclo; fw_pm =
+// erro de geometria dos dentes 30-39 (janelas das posições 1 e 3); jitter_pm
+// alterna de sinal a cada janela (ressonância/estrada irregular).
+static uint32_t g_mf_cap = 0u;
+
+static void mf_cycle(uint32_t base_ns, const uint16_t win_pm[4], uint16_t fw_pm,
+                     uint16_t jitter_pm = 0u) {
+    for (uint8_t half = 0u; half < 2u; ++half) {
+        g_mf_cap += 2u * base_ns / 16u;   // dentes ausentes antes do dente 0
+        for (uint8_t t = 0u; t < 58u; ++t) {
+            uint64_t p = base_ns;
+            const bool w30 = (t >= 30u && t < 40u);
+            if (w30) { p = p * fw_pm / 1000u; }
+            if (t < 10u || w30) {
+                const uint8_t slot = static_cast<uint8_t>(half * 2u + (w30 ? 1u : 0u));
+                p = p * win_pm[slot] / 1000u;
+                if (jitter_pm != 0u) {
+                    p = (slot & 1u) ? p * (1000u + jitter_pm) / 1000u
+                                    : p * (1000u - jitter_pm) / 1000u;
+                }
+            }
+            g_mf_cap += static_cast<uint32_t>(p / 16u);
+            ems::drv::CkpSnapshot sn{};
+            sn.state = ems::drv::SyncState::FULL_SYNC;
+            sn.tooth_index = t;
+            sn.phase_A = (half == 0u);
+            sn.tooth_period_ns = static_cast<uint32_t>(p);
+            sn.predicted_tooth_period_ns = base_ns;
+            sn.last_tim5_capture = g_mf_cap;
+            ems::drv::misfire_on_tooth(sn);
+        }
+    }
+}
+
+static uint16_t mf_total_events() {
+    uint16_t n = 0u;
+    for (uint8_t c = 0u; c < 4u; ++c) { n = static_cast<uint16_t>(n + misfire_get_event_count(c)); }
+    return n;
+}
+
+void test_misfire_kinematics(void) {
+    using namespace ems::engine;
+    const uint32_t base_ns = 500000u;          // 6° a 2000 rpm
+    const uint32_t rpm_x10 = 20000u;
+    const uint16_t load = 50u;                  // limiar default 350 rad/s²
+    const uint16_t even[4] = {1000u, 1000u, 1000u, 1000u};
+    const uint8_t cyl_pos1 = cfg::kFiringOrder[1];   // janela nos dentes 30-39
+
+    section("misfire cinemática: erro de volante sem aprendizagem → falsos eventos");
+    misfire_accel_enable = 1u;
+    misfire_rough_ratio_pct = 0u;
+    misfire_init();
+    for (uint8_t k = 0u; k < 20u; ++k) {
+        mf_cycle(base_ns, even, 1040u);
+        misfire_process(rpm_x10, load, false);
+    }
+    CHECK_TRUE(mf_total_events() > 0u, "dentes 30-39 +4% → desaceleração aparente");
+    CHECK_EQ(misfire_get_flywheel_samples(), 0u, "sem corte → volante por aprender");
+
+    section("misfire cinemática: volante aprendido em decel cut");
+    misfire_reset();
+    misfire_set_all_inhibit(true);
+    for (uint8_t k = 0u; k < 60u; ++k) {
+        mf_cycle(base_ns, even, 1040u);
+        misfire_process(rpm_x10, load, true);
+    }
+    misfire_set_all_inhibit(false);
+    CHECK_EQ(mf_total_events(), 0u, "corte: nenhum segmento avaliado");
+    CHECK_TRUE(misfire_get_flywheel_samples() > 100u, "segmentos de corte usados");
+    const uint16_t fw_long = misfire_get_flywheel_q15(cyl_pos1);
+    const uint16_t fw_ref = misfire_get_flywheel_q15(cfg::kFiringOrder[0]);
+    // Janela 4% longa → factor ≈ 1/1.04 face às outras (normalizado à média).
+    CHECK_TRUE(fw_long * 104u / 100u > fw_ref - 200u && fw_long * 104u / 100u < fw_ref + 200u,
+               "factor do cilindro nos dentes 30-39 ≈ 1/1.04 do de referência");
+    for (uint8_t k = 0u; k < 40u; ++k) {
+        mf_cycle(base_ns, even, 1040u);
+        misfire_process(rpm_x10, load, false);
+    }
+    CHECK_EQ(mf_total_events(), 0u, "volante corrigido → sem falsos eventos");
+    const int32_t a = misfire_get_accel_rad_s2(cyl_pos1);
+    CHECK_TRUE(a > -50 && a < 50, "α normalizado ≈ 0 em regime");
+
+    section("misfire cinemática: misfire isolado detectado no cilindro certo");
+    const uint8_t cyl_pos2 = cfg::kFiringOrder[2];
+    const uint16_t miss[4] = {1000u, 1000u, 1060u, 1000u};   // posição 2 lenta 6%
+    for (uint8_t k = 0u; k < 5u; ++k) {
+        mf_cycle(base_ns, miss, 1040u);
+        misfire_process(rpm_x10, load, false);
+        mf_cycle(base_ns, even, 1040u);
+        misfire_process(rpm_x10, load, false);
+    }
+    CHECK_EQ(misfire_get_event_count(cyl_pos2), 5u, "5 misfires → 5 eventos");
+    CHECK_EQ(mf_total_events(), 5u, "recuperação no cilindro seguinte não conta");
+    CHECK_TRUE(misfire_get_accel_rad_s2(cyl_pos2) < 50, "α volta ao normal");
+    CHECK_EQ(misfire_get_ring_overflows(), 0u, "anel drenado a cada ciclo");
+
+    section("misfire cinemática: ressonância / estrada irregular rejeitadas");
+    for (uint8_t c = 0u; c < 4u; ++c) { misfire_clear_events(c); }
+    const uint32_t rejects0 = misfire_get_rough_rejects();
+    for (uint8_t k = 0u; k < 10u; ++k) {
+        mf_cycle(base_ns, even, 1040u, 20u);
+        misfire_process(rpm_x10, load, false);
+    }
+    CHECK_EQ(mf_total_events(), 0u, "oscilação ±2% alternada: sem eventos");
+    CHECK_TRUE(misfire_get_rough_rejects() > rejects0, "picos contados como rejeitados");
+
+    section("misfire cinemática: limiar por RPM × carga");
+    misfire_thr_rad_s2[1][1] = 5000u;   // nó (50 kPa, 2000 rpm) → insensível
+    for (uint8_t c = 0u; c < 4u; ++c) { misfire_clear_events(c); }
+    for (uint8_t k = 0u; k < 20u; ++k) {
+        mf_cycle(base_ns, even, 1040u);
+        misfire_process(rpm_x10, load, false);
+    }
+    mf_cycle(base_ns, miss, 1040u);
+    misfire_process(rpm_x10, load, false);
+    CHECK_EQ(mf_total_events(), 0u, "limiar calibrado no nó → misfire de 6% abaixo");
+    misfire_thr_rad_s2[1][1] = 0u;
+    mf_cycle(base_ns, even, 1040u);
+    misfire_process(rpm_x10, load, false);
+    mf_cycle(base_ns, miss, 1040u);
+    misfire_process(rpm_x10, load, false);
+    CHECK_EQ(misfire_get_event_count(cyl_pos2), 1u, "célula 0 → default volta a detectar");
+
+    misfire_accel_enable = 0u;
+    misfire_init();
+}
+
 // ============================================================================
 // DIAGNOSTIC MANAGER
 // ============================================================================
@@ -533,7 +1202,7 @@ void test_diagnostic_manager_all(void) {
     DiagnosticManager::report_fault(DiagnosticCode::CLT_SENSOR_RANGE, FaultSeverity::WARNING,
                                     1000u, 3000u);
     const uint16_t ff[4] = {900u, 100u, 30000u, 12000u};
-    DiagnosticManager::record_freeze_frame(DiagnosticCode::CLT_SENSOR_RANGE, ff);
+    DiagnosticManager::record_freeze_frame(DiagnosticCode::CLT_SENSOR_RANGE, ff, 4u);
     const DiagnosticEvent* ev = DiagnosticManager::get_event(
         DiagnosticCode::CLT_SENSOR_RANGE);
     CHECK_TRUE(ev != nullptr, "get_event returns non-null for active fault");
@@ -555,6 +1224,125 @@ void test_diagnostic_manager_all(void) {
                "low TPS + mid MAP + mid RPM: plausible");
 }
 
+void test_diagnostic_dtc_store(void) {
+    using namespace ems::engine;
+    ems::hal::nvm_test_reset();
+
+    section("DiagnosticManager: code → slot O(1) cobre todos os códigos");
+    bool slots_ok = true;
+    for (uint8_t i = 0u; i < kDiagCodeCount; ++i) {
+        slots_ok = slots_ok && (diag_code_slot(kDiagnosticCodes[i]) == i);
+    }
+    CHECK_TRUE(slots_ok, "cada código mapeia para a sua posição");
+    CHECK_EQ(diag_code_slot(DiagnosticCode::NONE), kDiagNoSlot, "NONE sem slot");
+    CHECK_EQ(diag_code_slot(static_cast<DiagnosticCode>(0x0199u)), kDiagNoSlot,
+             "código desconhecido sem slot");
+
+    section("DiagnosticManager: severidade por máscara segue escalada e clear");
+    DiagnosticManager::init();
+    DiagnosticManager::report_fault(DiagnosticCode::ADC_RECOVERY_FAILED, FaultSeverity::WARNING);
+    CHECK_TRUE(DiagnosticManager::is_system_ready(), "WARNING: sistema pronto");
+    DiagnosticManager::report_fault(DiagnosticCode::ADC_RECOVERY_FAILED, FaultSeverity::CRITICAL);
+    CHECK_FALSE(DiagnosticManager::is_system_ready(), "mesmo código escalado a CRITICAL");
+    CHECK_EQ(DiagnosticManager::get_active_fault_count(), 1u, "continua 1 falha activa");
+    DiagnosticManager::clear_fault(DiagnosticCode::ADC_RECOVERY_FAILED);
+    CHECK_EQ(static_cast<uint8_t>(DiagnosticManager::get_highest_severity()),
+             static_cast<uint8_t>(FaultSeverity::INFO), "sem falhas → INFO");
+    for (uint8_t i = 0u; i < kDiagCodeCount; ++i) {
+        DiagnosticManager::report_fault(kDiagnosticCodes[i], FaultSeverity::WARNING);
+    }
+    CHECK_EQ(DiagnosticManager::get_active_fault_count(), kDiagCodeCount,
+             "todos os códigos activos em simultâneo (sem despejo)");
+    DiagnosticManager::clear_all_faults();
+    CHECK_EQ(DiagnosticManager::get_active_fault_count(), 0u, "clear_all limpa o bitmap");
+
+    section("DiagnosticManager: freeze frame das variáveis vivas configuradas");
+    ems::hal::nvm_test_reset();
+    DiagnosticManager::init();
+    DiagnosticManager::set_live_value(FreezeVar::RPM_X10, 31000u);
+    DiagnosticManager::set_live_value(FreezeVar::CLT_DEGC_X10, 1050u);
+    DiagnosticManager::set_live_value(FreezeVar::VBATT_MV, 13800u);
+    DiagnosticManager::report_fault(DiagnosticCode::OVERTEMP_WARNING, FaultSeverity::WARNING, 1050u);
+    const DiagnosticEvent* ev = DiagnosticManager::get_event(DiagnosticCode::OVERTEMP_WARNING);
+    CHECK_TRUE(ev != nullptr, "evento activo");
+    if (ev != nullptr) {
+        CHECK_EQ(ev->freeze_vars[0], static_cast<uint8_t>(FreezeVar::RPM_X10), "default: palavra 0 = RPM");
+        CHECK_EQ(ev->freeze_frame[0], 31000u, "RPM congelado");
+        CHECK_EQ(ev->freeze_frame[3], 1050u, "CLT congelado");
+        CHECK_EQ(ev->param[0], 1050u, "param1 guardado à parte");
+    }
+    DiagnosticManager::set_live_value(FreezeVar::RPM_X10, 50000u);
+    DiagnosticManager::report_fault(DiagnosticCode::OVERTEMP_WARNING, FaultSeverity::WARNING);
+    CHECK_EQ(ev != nullptr ? ev->freeze_frame[0] : 0u, 31000u,
+             "repetição não reescreve o freeze frame");
+
+    diag_freeze_vars[0] = static_cast<uint8_t>(FreezeVar::VBATT_MV);
+    diag_freeze_vars[1] = static_cast<uint8_t>(FreezeVar::RPM_X10);
+    DiagnosticManager::report_fault(DiagnosticCode::VBATT_HIGH, FaultSeverity::WARNING);
+    const DiagnosticEvent* ev2 = DiagnosticManager::get_event(DiagnosticCode::VBATT_HIGH);
+    CHECK_TRUE(ev2 != nullptr, "segundo evento activo");
+    if (ev2 != nullptr) {
+        CHECK_EQ(ev2->freeze_frame[0], 13800u, "config: palavra 0 = VBATT");
+        CHECK_EQ(ev2->freeze_frame[1], 50000u, "config: palavra 1 = RPM actual");
+        CHECK_EQ(ev2->freeze_vars[2], 0u, "palavra não configurada livre");
+    }
+    std::memset(diag_freeze_vars, 0, sizeof(diag_freeze_vars));
+
+    section("DiagnosticManager: memória de DTCs persistente (ocorrências, 1ª/última)");
+    diagnostic_tick(5000u);
+    DiagnosticManager::clear_fault(DiagnosticCode::OVERTEMP_WARNING);
+    diagnostic_tick(10000u);
+    DiagnosticManager::report_fault(DiagnosticCode::OVERTEMP_WARNING, FaultSeverity::WARNING);
+    const StoredDtc* st = DiagnosticManager::find_stored_dtc(DiagnosticCode::OVERTEMP_WARNING);
+    CHECK_TRUE(st != nullptr, "DTC guardado");
+    if (st != nullptr) {
+        CHECK_EQ(st->occurrences, 2u, "2 activações (repetições não contam)");
+        CHECK_EQ(st->first_seen_s, 0u, "primeira vez em t=0 s");
+        CHECK_EQ(st->last_seen_s, 15u, "última activação em t=15 s");
+    }
+    CHECK_EQ(DiagnosticManager::get_stored_dtc_count(), 2u, "2 códigos na memória");
+
+    CHECK_TRUE(DiagnosticManager::persist_process(1000u), "primeira escrita imediata");
+    DiagnosticManager::report_fault(DiagnosticCode::FUEL_PRESS_LOW, FaultSeverity::WARNING);
+    CHECK_FALSE(DiagnosticManager::persist_process(30000u), "rate-limit: dentro do intervalo");
+    CHECK_TRUE(DiagnosticManager::persist_process(61000u), "escreve após o intervalo");
+    CHECK_FALSE(DiagnosticManager::persist_process(200000u), "nada mudou → sem escrita");
+
+    // Power cycle: init recarrega do NVM; activas perdem-se, memória fica.
+    DiagnosticManager::init();
+    CHECK_EQ(DiagnosticManager::get_active_fault_count(), 0u, "sem falhas activas após boot");
+    CHECK_EQ(DiagnosticManager::get_stored_dtc_count(), 3u, "3 DTCs recarregados");
+    st = DiagnosticManager::find_stored_dtc(DiagnosticCode::OVERTEMP_WARNING);
+    CHECK_TRUE(st != nullptr && st->occurrences == 2u, "ocorrências persistidas");
+    CHECK_TRUE(st != nullptr && st->freeze_frame[0] == 50000u,
+               "freeze frame da última activação persistido");
+    DiagnosticManager::report_fault(DiagnosticCode::OVERTEMP_WARNING, FaultSeverity::WARNING);
+    st = DiagnosticManager::find_stored_dtc(DiagnosticCode::OVERTEMP_WARNING);
+    CHECK_TRUE(st != nullptr && st->occurrences == 3u && st->last_seen_s == 15u,
+               "nova activação soma; tempo retoma do guardado");
+
+    // Memória cheia: despeja a entrada inactiva menos recente.
+    for (uint8_t i = 0u; i < 12u; ++i) {
+        diagnostic_tick(1000u);
+        DiagnosticManager::report_fault(kDiagnosticCodes[i], FaultSeverity::INFO);
+        DiagnosticManager::clear_fault(kDiagnosticCodes[i]);
+    }
+    CHECK_EQ(DiagnosticManager::get_stored_dtc_count(), DiagnosticManager::kMaxStoredDtcs,
+             "memória limitada a kMaxStoredDtcs");
+    CHECK_TRUE(DiagnosticManager::find_stored_dtc(DiagnosticCode::OVERTEMP_WARNING) != nullptr,
+               "DTC activo não é despejado");
+    CHECK_TRUE(DiagnosticManager::find_stored_dtc(kDiagnosticCodes[11]) != nullptr,
+               "o mais recente está guardado");
+
+    DiagnosticManager::clear_stored_dtcs();
+    CHECK_EQ(DiagnosticManager::get_stored_dtc_count(), 0u, "clear_stored_dtcs esvazia");
+    CHECK_TRUE(DiagnosticManager::persist_process(400000u), "limpeza persistida");
+    DiagnosticManager::init();
+    CHECK_EQ(DiagnosticManager::get_stored_dtc_count(), 0u, "vazia após boot");
+    ems::hal::nvm_test_reset();
+    DiagnosticManager::init();
+}
+
 // ============================================================================
 // HAL ADC
 // ============================================================================
@@ -723,6 +1511,862 @@ void test_hal_flash_all(void) {
     CHECK_TRUE(nvm_write_ltft(0u, 0u, 10), "write succeeds after busy cleared");
 }
 
+// ============================================================================
+// HAL NVM JOURNAL (mapas adaptativos)
+// ============================================================================
+
+namespace {
+
+// Flash simulada: 4 setores de 8 KB; programar um slot não apagado falha
+// (como o ECC de 128 bits do H5), erase leva g_fj_erase_polls polls e cada
+// program g_fj_prog_polls; iniciar operação com BSY activo falha.
+uint8_t  g_fj_mem[ems::hal::kNvmJournalSectors][ems::hal::kNvmJournalSectorBytes];
+uint32_t g_fj_erase_polls = 0u;
+uint32_t g_fj_prog_polls  = 0u;
+uint32_t g_fj_busy_left   = 0u;
+uint32_t g_fj_programs    = 0u;
+uint32_t g_fj_fail_after  = 0xFFFFFFFFu;  // programs até simular power-loss
+
+const uint8_t* fj_sector(uint8_t idx) { return g_fj_mem[idx]; }
+bool fj_erase(uint8_t idx) {
+    if (g_fj_busy_left != 0u) { return false; }
+    memset(g_fj_mem[idx], 0xFF, sizeof(g_fj_mem[idx]));
+    g_fj_busy_left = g_fj_erase_polls;
+    return true;
+}
+bool fj_program(uint8_t idx, uint32_t off, const uint8_t* qw) {
+    if (g_fj_busy_left != 0u) { return false; }
+    if (g_fj_programs >= g_fj_fail_after) { return false; }
+    for (uint32_t i = 0u; i < 16u; ++i) {
+        if (g_fj_mem[idx][off + i] != 0xFFu) { return false; }
+    }
+    memcpy(&g_fj_mem[idx][off], qw, 16u);
+    ++g_fj_programs;
+    g_fj_busy_left = g_fj_prog_polls;
+    return true;
+}
+ems::hal::NvmIoPoll fj_poll() {
+    if (g_fj_busy_left != 0u) { --g_fj_busy_left; return ems::hal::NvmIoPoll::Busy; }
+    return ems::hal::NvmIoPoll::Ready;
+}
+const ems::hal::NvmJournalIo kFjIo = {fj_sector, fj_erase, fj_program, fj_poll};
+
+void fj_reset() {
+    memset(g_fj_mem, 0xFF, sizeof(g_fj_mem));
+    g_fj_erase_polls = 0u;
+    g_fj_prog_polls  = 0u;
+    g_fj_busy_left   = 0u;
+    g_fj_programs    = 0u;
+    g_fj_fail_after  = 0xFFFFFFFFu;
+}
+
+ems::hal::NvmJournalStatus fj_flush(const uint8_t* img) {
+    ems::hal::NvmJournalStatus st = ems::hal::NvmJournalStatus::Busy;
+    for (uint32_t i = 0u; i < 100000u && st == ems::hal::NvmJournalStatus::Busy; ++i) {
+        st = ems::hal::nvm_journal_flush_step(img, 4u);
+    }
+    return st;
+}
+
+}  // namespace
+
+void test_nvm_journal_all(void) {
+    using namespace ems::hal;
+    constexpr uint16_t kLen = static_cast<uint16_t>(kNvmAdaptiveImageBytes);
+    static uint8_t img[kNvmJournalImageMax];
+    static uint8_t out[kNvmJournalImageMax];
+
+    section("nvm_journal: anel vazio não monta; primeiro flush formata");
+    fj_reset();
+    nvm_journal_attach(&kFjIo, kLen);
+    CHECK_FALSE(nvm_journal_mount(out), "anel apagado → mount false");
+    CHECK_EQ(nvm_journal_active_sector(), 0xFFu, "sem setor activo");
+    for (uint16_t i = 0u; i < kLen; ++i) { img[i] = static_cast<uint8_t>(i * 7u + 1u); }
+    g_fj_erase_polls = 3u;
+    CHECK_TRUE(fj_flush(img) == NvmJournalStatus::Idle, "flush inicial conclui");
+    CHECK_EQ(nvm_journal_erase_count(), 1u, "formatação = 1 erase");
+    CHECK_EQ(nvm_journal_active_sector(), 0u, "setor 0 activo");
+    CHECK_FALSE(nvm_journal_pending(img), "nada pendente após flush");
+
+    section("nvm_journal: remount reproduz a imagem");
+    nvm_journal_attach(&kFjIo, kLen);
+    CHECK_TRUE(nvm_journal_mount(out), "mount após flush");
+    CHECK_TRUE(memcmp(out, img, kLen) == 0, "imagem montada == gravada");
+
+    section("nvm_journal: flush grava só as células alteradas");
+    {
+        const uint32_t rec0 = nvm_journal_record_count();
+        const uint16_t free0 = nvm_journal_free_records();
+        img[5] ^= 0x5Au;
+        img[kNvmOffKnock + 3u] ^= 0x11u;
+        img[kNvmSeedOffset] ^= 0x22u;
+        CHECK_TRUE(fj_flush(img) == NvmJournalStatus::Idle, "delta flush conclui");
+        CHECK_EQ(nvm_journal_record_count() - rec0, 3u, "3 células → 3 quad-words");
+        CHECK_EQ(nvm_journal_erase_count(), 0u, "delta sem erase");
+        CHECK_EQ(free0 - nvm_journal_free_records(), 3u, "3 slots consumidos");
+        nvm_journal_attach(&kFjIo, kLen);
+        CHECK_TRUE(nvm_journal_mount(out) && memcmp(out, img, kLen) == 0,
+                   "replay inclui os deltas");
+    }
+
+    section("nvm_journal: program em curso cede o passo (sem spin)");
+    {
+        g_fj_prog_polls = 2u;
+        const uint32_t rec0 = nvm_journal_record_count();
+        img[17] ^= 0x33u;
+        img[kNvmOffKnock + 9u] ^= 0x44u;
+        CHECK_TRUE(nvm_journal_flush_step(img, 4u) == NvmJournalStatus::Busy,
+                   "1.º quad-word iniciado → Busy");
+        CHECK_EQ(nvm_journal_record_count() - rec0, 1u, "um program por BSY");
+        CHECK_TRUE(nvm_journal_flush_step(img, 4u) == NvmJournalStatus::Busy,
+                   "BSY activo → Busy sem novo program");
+        CHECK_EQ(nvm_journal_record_count() - rec0, 1u, "nada iniciado com BSY");
+        CHECK_TRUE(fj_flush(img) == NvmJournalStatus::Idle, "conclui após os polls");
+        CHECK_EQ(nvm_journal_record_count() - rec0, 2u, "2 células → 2 quad-words");
+        g_fj_prog_polls = 0u;
+        nvm_journal_attach(&kFjIo, kLen);
+        CHECK_TRUE(nvm_journal_mount(out) && memcmp(out, img, kLen) == 0,
+                   "replay após programs assíncronos");
+    }
+
+    section("nvm_journal: setor cheio → compactação round-robin");
+    {
+        const uint32_t seq0 = nvm_journal_sequence();
+        uint8_t rotations = 0u;
+        bool in_order = true;
+        uint8_t prev = nvm_journal_active_sector();
+        for (uint32_t n = 0u; n < 3000u; ++n) {
+            img[(n * 13u) % kLen] = static_cast<uint8_t>(n);
+            if (fj_flush(img) != NvmJournalStatus::Idle) { break; }
+            if (nvm_journal_active_sector() != prev) {
+                in_order = in_order && nvm_journal_active_sector() ==
+                           static_cast<uint8_t>((prev + 1u) % kNvmJournalSectors);
+                prev = nvm_journal_active_sector();
+                ++rotations;
+            }
+        }
+        CHECK_TRUE(rotations >= 4u, "anel percorrido (wear levelling)");
+        CHECK_TRUE(in_order, "compactação vai sempre para o próximo setor");
+        CHECK_EQ(nvm_journal_erase_count(), rotations, "1 erase por compactação");
+        CHECK_TRUE(nvm_journal_sequence() - seq0 == rotations, "seq +1 por setor");
+        nvm_journal_attach(&kFjIo, kLen);
+        CHECK_TRUE(nvm_journal_mount(out) && memcmp(out, img, kLen) == 0,
+                   "replay após várias compactações");
+    }
+
+    section("nvm_journal: power-loss a meio da compactação → setor anterior");
+    {
+        static uint8_t before[kNvmJournalImageMax];
+        memcpy(before, img, kLen);
+        const uint8_t old_active = nvm_journal_active_sector();
+        // Enche o setor activo até ao limite sem rodar.
+        uint32_t n = 0u;
+        while (nvm_journal_free_records() != 0u &&
+               nvm_journal_active_sector() == old_active) {
+            img[(n++ * 31u) % kLen] ^= 0x01u;
+            static_cast<void>(fj_flush(img));
+            memcpy(before, img, kLen);
+        }
+        if (nvm_journal_active_sector() == old_active) {
+            img[0] ^= 0x80u;
+            g_fj_fail_after = g_fj_programs + 5u;  // header + 4 snapshot, sem COMMIT
+            CHECK_TRUE(fj_flush(img) == NvmJournalStatus::Error, "compactação interrompida");
+            nvm_journal_attach(&kFjIo, kLen);
+            CHECK_TRUE(nvm_journal_mount(out), "mount usa o setor antigo");
+            CHECK_EQ(nvm_journal_active_sector(), old_active, "setor sem COMMIT ignorado");
+            CHECK_TRUE(memcmp(out, before, kLen) == 0, "imagem anterior intacta");
+            g_fj_fail_after = 0xFFFFFFFFu;
+            CHECK_TRUE(fj_flush(img) == NvmJournalStatus::Idle, "retoma após power-loss");
+            nvm_journal_attach(&kFjIo, kLen);
+            CHECK_TRUE(nvm_journal_mount(out) && memcmp(out, img, kLen) == 0,
+                       "nova imagem após retoma");
+        } else {
+            CHECK_TRUE(false, "setor rodou antes do teste de power-loss");
+        }
+    }
+
+    section("nvm_journal: registo com CRC inválido é ignorado");
+    {
+        const uint8_t act = nvm_journal_active_sector();
+        const uint32_t slot = kNvmJournalSectorBytes -
+                              nvm_journal_free_records() * kNvmJournalRecordBytes;
+        const uint8_t keep = img[9];
+        img[9] = static_cast<uint8_t>(keep + 1u);
+        CHECK_TRUE(fj_flush(img) == NvmJournalStatus::Idle, "delta gravado");
+        g_fj_mem[act][slot + 4u] ^= 0xFFu;  // escrita rasgada
+        nvm_journal_attach(&kFjIo, kLen);
+        CHECK_TRUE(nvm_journal_mount(out), "mount com registo corrompido");
+        CHECK_EQ(out[9], keep, "valor anterior mantido");
+        img[9] = keep;
+        CHECK_FALSE(nvm_journal_pending(img), "shadow == replay");
+    }
+
+    section("nvm_journal: imagem gravada maior é rejeitada; menor monta como prefixo");
+    nvm_journal_attach(&kFjIo, static_cast<uint16_t>(kLen - 16u));
+    CHECK_FALSE(nvm_journal_mount(out), "image_len gravado maior → mount false");
+
+    // Firmware novo com a imagem crescida por cauda: o anel antigo monta.
+    constexpr uint16_t kGrown = static_cast<uint16_t>(kLen + 16u);
+    static_assert(kGrown <= kNvmJournalImageMax, "cauda de teste cabe na imagem máxima");
+    memset(out, 0xAA, sizeof(out));
+    nvm_journal_attach(&kFjIo, kGrown);
+    CHECK_TRUE(nvm_journal_mount(out), "image_len gravado menor → mount ok");
+    CHECK_TRUE(memcmp(out, img, kLen) == 0, "prefixo == imagem antiga");
+    bool tail_zero = true;
+    for (uint16_t i = kLen; i < kGrown; ++i) { tail_zero = tail_zero && (out[i] == 0u); }
+    CHECK_TRUE(tail_zero, "cauda nova a zeros");
+    memcpy(img, out, kGrown);
+    img[kLen + 3u] = 0x5Au;
+    CHECK_TRUE(fj_flush(img) == NvmJournalStatus::Idle, "delta na cauda gravado");
+    nvm_journal_attach(&kFjIo, kGrown);
+    CHECK_TRUE(nvm_journal_mount(out), "remount com cauda");
+    CHECK_EQ(out[kLen + 3u], 0x5Au, "delta da cauda reproduzido");
+
+    section("nvm_journal: image_len fora do limite é recusado (sem clamp)");
+    CHECK_FALSE(nvm_journal_attach(&kFjIo, static_cast<uint16_t>(kNvmJournalImageMax + 1u)),
+                "image_len > kNvmJournalImageMax → attach false");
+    CHECK_FALSE(nvm_journal_mount(out), "journal desligado → mount false");
+    CHECK_TRUE(nvm_journal_flush_step(img, 1u) == NvmJournalStatus::Error,
+               "journal desligado → flush Error");
+    CHECK_FALSE(nvm_journal_attach(&kFjIo, 0u), "image_len 0 → attach false");
+    CHECK_FALSE(nvm_journal_attach(nullptr, kLen), "io nulo → attach false");
+    CHECK_TRUE(nvm_journal_attach(&kFjIo, kNvmJournalImageMax), "image_len máximo aceite");
+}
+
+// ============================================================================
+// HAL FLASH JOBS (fila fatiada + modelo de latência)
+// ============================================================================
+
+namespace {
+
+struct FjDone {
+    uint8_t calls;
+    bool    ok;
+    uint8_t order[4];
+};
+FjDone g_fjd = {};
+
+void fjd_cb(void* ctx, bool ok) {
+    if (g_fjd.calls < 4u) {
+        g_fjd.order[g_fjd.calls] = static_cast<uint8_t>(reinterpret_cast<uintptr_t>(ctx));
+    }
+    ++g_fjd.calls;
+    g_fjd.ok = ok;
+}
+
+uint8_t g_task_calls = 0u;
+ems::hal::FlashTaskStatus fj_task(void*) {
+    return (++g_task_calls >= 3u) ? ems::hal::FlashTaskStatus::Done
+                                  : ems::hal::FlashTaskStatus::Busy;
+}
+
+}  // namespace
+
+void test_flash_jobs_all(void) {
+    using namespace ems::hal;
+    static uint8_t page[600];
+    for (uint16_t i = 0u; i < sizeof(page); ++i) { page[i] = static_cast<uint8_t>(i ^ 0x5Au); }
+
+    section("flash_jobs: burn fatiado — erase nunca bloqueia o slot");
+    flash_host_model_reset(0x00u);
+    flash_jobs_attach(flash_host_model_io());
+    flash_jobs_test_reset();
+    flash_host_model_set_latency(3000u, 60u);  // erase 3 ms, quad-word 60 µs
+    g_fjd = {};
+    CHECK_TRUE(flash_jobs_submit_burn(3u, page, sizeof(page), fjd_cb,
+                                      reinterpret_cast<void*>(uintptr_t{1})),
+               "burn enfileirado");
+    page[0] ^= 0xFFu;  // staging: editar o buffer após submit não rasga o burn
+    uint32_t slots = 0u;
+    while (flash_jobs_step(kFlashJobSliceUs) && slots < 100u) {
+        ++slots;
+        flash_host_model_advance_us(2000u);  // resto do slot de 2 ms
+    }
+    page[0] ^= 0xFFu;
+    CHECK_EQ(g_fjd.calls, 1u, "callback chamado uma vez");
+    CHECK_TRUE(g_fjd.ok, "burn concluído com verify ok");
+    CHECK_TRUE(slots >= 2u, "burn distribuído por vários slots");
+    CHECK_TRUE(flash_jobs_max_step_us() <= kFlashJobSliceUs + 60u,
+               "passo ≤ orçamento + 1 quad-word");
+    CHECK_TRUE(memcmp(flash_host_model_sector(3u), page, sizeof(page)) == 0,
+               "setor contém a página (snapshot do submit)");
+    CHECK_EQ(flash_host_model_sector(3u)[sizeof(page)], 0xFFu, "resto do setor apagado");
+    CHECK_EQ(flash_host_model_erase_count(), 1u, "1 erase");
+    CHECK_EQ(flash_host_model_program_count(), (sizeof(page) + 15u) / 16u,
+             "quad-words = ceil(len/16)");
+
+    section("flash_jobs: FIFO, fila cheia e task jobs");
+    flash_host_model_set_latency(0u, 0u);
+    g_fjd = {};
+    g_task_calls = 0u;
+    CHECK_TRUE(flash_jobs_submit_burn(4u, page, 64u, fjd_cb, reinterpret_cast<void*>(uintptr_t{1})), "job 1");
+    CHECK_TRUE(flash_jobs_submit_task(fj_task, reinterpret_cast<void*>(uintptr_t{2}), fjd_cb), "job 2 (task)");
+    CHECK_TRUE(flash_jobs_submit_burn(5u, page, 64u, fjd_cb, reinterpret_cast<void*>(uintptr_t{3})), "job 3");
+    CHECK_TRUE(flash_jobs_submit_burn(6u, page, 64u, fjd_cb, reinterpret_cast<void*>(uintptr_t{4})), "job 4");
+    CHECK_FALSE(flash_jobs_submit_burn(7u, page, 64u, fjd_cb, nullptr), "fila cheia → false");
+    CHECK_EQ(flash_jobs_pending(), kFlashJobQueueDepth, "4 pendentes");
+    CHECK_TRUE(flash_jobs_drain(100000u), "drain esvazia a fila");
+    CHECK_EQ(g_fjd.calls, 4u, "4 callbacks");
+    CHECK_TRUE(g_fjd.order[0] == 1u && g_fjd.order[1] == 2u &&
+               g_fjd.order[2] == 3u && g_fjd.order[3] == 4u, "ordem FIFO");
+    CHECK_EQ(g_task_calls, 3u, "task chamada até Done");
+
+    section("flash_jobs: erro de flash → done(ok=false), fila continua");
+    g_fjd = {};
+    flash_host_model_fail_next_op();
+    CHECK_TRUE(flash_jobs_submit_burn(8u, page, 32u, fjd_cb, nullptr), "job com erro");
+    CHECK_TRUE(flash_jobs_submit_burn(9u, page, 32u, fjd_cb, nullptr), "job seguinte");
+    CHECK_TRUE(flash_jobs_drain(100000u), "drain");
+    CHECK_EQ(g_fjd.calls, 2u, "ambos concluídos");
+    CHECK_TRUE(g_fjd.ok, "segundo job ok após falha do primeiro");
+    CHECK_EQ(flash_jobs_failed(), 1u, "1 falha contabilizada");
+
+    section("flash_jobs: grupo reserva os slots e cancela a cadeia na falha");
+    g_fjd = {};
+    CHECK_TRUE(flash_jobs_submit_task(fj_task, reinterpret_cast<void*>(uintptr_t{9}), nullptr),
+               "job alheio já na fila");
+    CHECK_FALSE(flash_jobs_begin_group(kFlashJobQueueDepth), "grupo maior que os slots livres");
+    CHECK_EQ(flash_jobs_pending(), 1u, "nada reservado");
+    CHECK_TRUE(flash_jobs_drain(100000u), "drain");
+    flash_host_model_sector(12u)[0] = 0x00u;  // marca: não pode ser apagado
+    CHECK_TRUE(flash_jobs_begin_group(3u), "grupo de 3");
+    CHECK_TRUE(flash_jobs_submit_burn(10u, page, 32u, fjd_cb, reinterpret_cast<void*>(uintptr_t{1})) &&
+               flash_jobs_submit_burn(11u, page, 32u, fjd_cb, reinterpret_cast<void*>(uintptr_t{2})) &&
+               flash_jobs_submit_burn(12u, page, 32u, fjd_cb, reinterpret_cast<void*>(uintptr_t{3})),
+               "3 membros enfileirados");
+    CHECK_TRUE(flash_jobs_submit_burn(13u, page, 32u, fjd_cb, reinterpret_cast<void*>(uintptr_t{4})),
+               "job fora do grupo");
+    const uint32_t erases0 = flash_host_model_erase_count();
+    CHECK_TRUE(flash_jobs_step(kFlashJobSliceUs), "membro 1 gravado");
+    flash_host_model_fail_next_op();
+    CHECK_TRUE(flash_jobs_drain(100000u), "drain");
+    CHECK_EQ(g_fjd.calls, 4u, "um done por job");
+    CHECK_TRUE(g_fjd.order[0] == 1u && g_fjd.order[1] == 2u &&
+               g_fjd.order[2] == 3u && g_fjd.order[3] == 4u, "ordem mantida");
+    CHECK_EQ(flash_host_model_sector(12u)[0], 0x00u, "membro 3 cancelado sem tocar na flash");
+    CHECK_EQ(flash_host_model_erase_count(), erases0 + 2u, "membro 1 + job seguinte");
+    CHECK_TRUE(g_fjd.ok, "job fora do grupo corre após o cancelamento");
+
+    section("flash_jobs: priming só com erase/program concluído");
+    flash_jobs_test_reset();
+    static const uint8_t blank[32] = {
+        0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu,
+        0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu,
+        0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu,
+        0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu,
+    };
+    memset(flash_host_model_sector(14u), 0xFF, 64u);
+    CHECK_TRUE(flash_jobs_submit_program(14u, 0u, blank, sizeof(blank), nullptr, nullptr),
+               "program todo 0xFF");
+    CHECK_TRUE(flash_jobs_drain(100000u), "drain");
+    CHECK_EQ(flash_jobs_completed(), 1u, "job ok sem program");
+    CHECK_FALSE(flash_jobs_primed(), "nenhuma operação → não primed");
+    flash_host_model_fail_next_op();
+    CHECK_TRUE(flash_jobs_submit_burn(15u, page, 32u, nullptr, nullptr), "burn com erro");
+    CHECK_TRUE(flash_jobs_drain(100000u), "drain");
+    CHECK_FALSE(flash_jobs_primed(), "erase com erro → não primed");
+    CHECK_TRUE(flash_jobs_submit_burn(15u, page, 32u, nullptr, nullptr), "burn");
+    CHECK_TRUE(flash_jobs_drain(100000u), "drain");
+    CHECK_TRUE(flash_jobs_primed(), "erase + program concluídos → primed");
+
+    section("flash_jobs: argumentos inválidos");
+    CHECK_FALSE(flash_jobs_submit_burn(1u, nullptr, 16u, nullptr, nullptr), "data nula");
+    CHECK_FALSE(flash_jobs_submit_burn(1u, page, 0u, nullptr, nullptr), "len 0");
+    CHECK_FALSE(flash_jobs_submit_burn(1u, page, kFlashJobMaxBytes + 1u, nullptr, nullptr),
+                "len > kFlashJobMaxBytes");
+    CHECK_FALSE(flash_jobs_submit_task(nullptr, nullptr, nullptr), "task nula");
+    nvm_test_reset();
+}
+
+// ============================================================================
+// HAL FLASH — mapas adaptativos via journal (modelo de flash em RAM)
+// ============================================================================
+
+void test_nvm_adaptive_journal_all(void) {
+    using namespace ems::hal;
+    static const uint8_t dtc_blob[8] = {0xD7u, 0x01u, 0x02u, 0x03u, 0x04u, 0x05u, 0x06u, 0x07u};
+    uint8_t dtc_out[8] = {};
+
+    section("nvm adaptativo: anel vazio → zeros, dirty para formatar");
+    nvm_test_reset();
+    CHECK_TRUE(nvm_load_adaptive_maps(), "load com anel vazio");
+    CHECK_TRUE(nvm_adaptive_maps_dirty(), "mapas zerados marcados dirty");
+    CHECK_EQ(nvm_journal_active_sector(), 0xFFu, "anel por formatar");
+
+    section("nvm adaptativo: flush → journal → remount");
+    CHECK_TRUE(nvm_write_ltft(3u, 4u, 12), "ltft");
+    CHECK_TRUE(nvm_write_knock(1u, 2u, -7), "knock");
+    CHECK_TRUE(nvm_write_ltft_add(2u, 3u, 5), "ltft_add");
+    EtbCalRecord cal{};
+    cal.tps1_min = 120u;
+    cal.tps1_max = 3900u;
+    CHECK_TRUE(nvm_save_etb_cal(&cal), "etb cal no shadow");
+    CHECK_TRUE(nvm_save_dtc_store(dtc_blob, sizeof(dtc_blob)), "dtc no shadow");
+    nvm_request_adaptive_flush_now();
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "flush enfileirado (false)");
+    CHECK_FALSE(nvm_adaptive_maps_dirty(), "dirty limpo no submit");
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "segundo flush com job na fila → false");
+    CHECK_TRUE(flash_jobs_drain(1000000u), "fila drenada");
+    CHECK_TRUE(nvm_journal_active_sector() != 0xFFu, "anel formatado");
+    CHECK_TRUE(nvm_flush_adaptive_maps(), "limpo após o job → true");
+
+    nvm_reset_knock_map();
+    CHECK_TRUE(nvm_write_ltft(3u, 4u, 0), "shadow alterado");
+    CHECK_TRUE(nvm_write_ltft_add(2u, 3u, 0), "shadow add alterado");
+    CHECK_TRUE(nvm_load_adaptive_maps(), "remount");
+    CHECK_FALSE(nvm_adaptive_maps_dirty(), "remount limpa dirty");
+    CHECK_EQ(nvm_read_ltft(3u, 4u), (int8_t)12, "ltft reproduzido");
+    CHECK_EQ(nvm_read_knock(1u, 2u), (int8_t)-7, "knock reproduzido");
+    CHECK_EQ(nvm_read_ltft_add(2u, 3u), (int8_t)5, "ltft_add reproduzido");
+    EtbCalRecord cal_out{};
+    CHECK_TRUE(nvm_load_etb_cal(&cal_out), "etb cal reproduzido");
+    CHECK_EQ(cal_out.tps1_min, 120u, "etb tps1_min");
+    CHECK_TRUE(nvm_load_dtc_store(dtc_out, sizeof(dtc_out)), "dtc load");
+    CHECK_TRUE(memcmp(dtc_out, dtc_blob, sizeof(dtc_blob)) == 0, "dtc reproduzido");
+
+    section("nvm adaptativo: falha de flash no flush re-marca dirty");
+    CHECK_TRUE(nvm_write_ltft(5u, 6u, -3), "ltft");
+    nvm_request_adaptive_flush_now();
+    flash_host_model_fail_next_op();
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "flush enfileirado");
+    CHECK_FALSE(nvm_adaptive_maps_dirty(), "dirty limpo no submit");
+    static_cast<void>(flash_jobs_drain(1000000u));
+    CHECK_TRUE(nvm_adaptive_maps_dirty(), "job falhado → dirty outra vez");
+    nvm_request_adaptive_flush_now();
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "re-flush enfileirado");
+    CHECK_TRUE(flash_jobs_drain(1000000u), "re-flush drenado");
+    CHECK_FALSE(nvm_adaptive_maps_dirty(), "re-flush limpo");
+    CHECK_TRUE(nvm_load_adaptive_maps(), "remount após falha");
+    CHECK_EQ(nvm_read_ltft(5u, 6u), (int8_t)-3, "valor do re-flush reproduzido");
+    CHECK_EQ(nvm_read_ltft(3u, 4u), (int8_t)12, "valor anterior intacto");
+
+    section("nvm adaptativo: imagem antiga sem cauda DTC monta como prefixo");
+    nvm_test_reset();
+    static uint8_t old_img[kNvmAdaptiveImageBytes];
+    memset(old_img, 0, sizeof(old_img));
+    old_img[kNvmOffLtft + 5u] = 9u;  // célula (0,5)
+    memcpy(old_img + kNvmOffLayoutMagic, &kNvmLayoutMagic, sizeof(kNvmLayoutMagic));
+    const uint32_t crc = nvm_adaptive_maps_crc(old_img);
+    memcpy(old_img + kNvmOffMapsCrc, &crc, sizeof(crc));
+    CHECK_TRUE(nvm_journal_attach(nvm_test_journal_io(),
+                                  static_cast<uint16_t>(kNvmDtcStoreOffset)),
+               "journal com a imagem antiga (sem DTC)");
+    NvmJournalStatus st = NvmJournalStatus::Busy;
+    for (uint16_t n = 0u; n < 1000u && st == NvmJournalStatus::Busy; ++n) {
+        st = nvm_journal_flush_step(old_img, 8u);
+    }
+    CHECK_TRUE(st == NvmJournalStatus::Idle, "imagem antiga gravada");
+    CHECK_TRUE(nvm_save_dtc_store(dtc_blob, sizeof(dtc_blob)), "shadow dtc sujo");
+    CHECK_TRUE(nvm_load_adaptive_maps(), "imagem antiga monta");
+    CHECK_FALSE(nvm_adaptive_maps_dirty(), "prefixo montado limpo");
+    CHECK_EQ(nvm_read_ltft(0u, 5u), (int8_t)9, "ltft do prefixo");
+    CHECK_TRUE(nvm_load_dtc_store(dtc_out, sizeof(dtc_out)), "dtc load");
+    bool dtc_zero = true;
+    for (uint8_t b : dtc_out) { dtc_zero = dtc_zero && (b == 0u); }
+    CHECK_TRUE(dtc_zero, "cauda DTC a zeros = memória vazia");
+
+    section("nvm adaptativo: flush fatiado pela fila (slot de 2 ms)");
+    nvm_test_reset();
+    CHECK_TRUE(nvm_load_adaptive_maps(), "load com anel vazio");
+    CHECK_TRUE(nvm_write_ltft(7u, 8u, 21), "ltft");
+    flash_host_model_set_latency(3000u, 60u);  // erase 3 ms, quad-word 60 µs
+    nvm_request_adaptive_flush_now();
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "flush enfileirado");
+    uint32_t slots = 0u;
+    while (nvm_jobs_process(kFlashJobSliceUs) && slots < 1000u) {
+        ++slots;
+        flash_host_model_advance_us(2000u);  // resto do slot de 2 ms
+    }
+    CHECK_EQ(flash_jobs_pending(), 0u, "flush concluído");
+    CHECK_TRUE(slots >= 2u, "formatação distribuída por vários slots");
+    CHECK_TRUE(flash_jobs_max_step_us() <= kFlashJobSliceUs + 60u,
+               "passo ≤ kFlashJobSliceUs + 1 quad-word");
+    CHECK_EQ(nvm_journal_erase_count(), 1u, "formatação = 1 erase");
+    CHECK_FALSE(nvm_adaptive_maps_dirty(), "limpo após o job");
+
+    section("nvm adaptativo: fila cheia → flush mantém dirty e re-enfileira");
+    flash_host_model_set_latency(0u, 0u);
+    static uint8_t burn[64];
+    memset(burn, 0x3Cu, sizeof(burn));
+    for (uint16_t i = 0u; i < kFlashJobQueueDepth; ++i) {
+        CHECK_TRUE(flash_jobs_submit_burn(static_cast<uint16_t>(26u + i), burn, sizeof(burn),
+                                          nullptr, nullptr),
+                   "burn enche a fila");
+    }
+    CHECK_TRUE(nvm_write_ltft(7u, 8u, -4), "ltft alterado");
+    nvm_request_adaptive_flush_now();
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "fila cheia → false");
+    CHECK_TRUE(nvm_adaptive_maps_dirty(), "dirty mantido sem submit");
+    CHECK_EQ(flash_jobs_pending(), kFlashJobQueueDepth, "flush não entrou na fila");
+    while (flash_jobs_pending() == kFlashJobQueueDepth && slots < 2000u) {
+        static_cast<void>(nvm_jobs_process(kFlashJobSliceUs));
+        ++slots;
+    }
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "slot livre → flush enfileirado");
+    CHECK_FALSE(nvm_adaptive_maps_dirty(), "dirty limpo no submit");
+    CHECK_TRUE(flash_jobs_drain(1000000u), "fila drenada");
+    CHECK_TRUE(nvm_load_adaptive_maps(), "remount");
+    CHECK_EQ(nvm_read_ltft(7u, 8u), (int8_t)-4, "valor re-enfileirado persistido");
+
+    section("nvm adaptativo: setor 0 legado apagado após o 1º commit do journal");
+    nvm_test_reset();
+    memset(old_img, 0, sizeof(old_img));
+    old_img[kNvmOffLtft + 9u] = 17u;  // célula (0,9)
+    memcpy(old_img + kNvmOffLayoutMagic, &kNvmLayoutMagic, sizeof(kNvmLayoutMagic));
+    const uint32_t lcrc = nvm_adaptive_maps_crc(old_img);
+    memcpy(old_img + kNvmOffMapsCrc, &lcrc, sizeof(lcrc));
+    memcpy(flash_host_model_sector(0u), old_img, sizeof(old_img));
+    CHECK_TRUE(nvm_load_adaptive_maps(), "migração do setor 0");
+    CHECK_EQ(nvm_read_ltft(0u, 9u), (int8_t)17, "ltft migrado");
+    nvm_request_adaptive_flush_now();
+    flash_host_model_fail_next_op();
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "1º flush enfileirado");
+    static_cast<void>(flash_jobs_drain(1000000u));
+    CHECK_TRUE(nvm_adaptive_sector_valid(flash_host_model_sector(0u)),
+               "commit falhado → setor 0 intacto");
+    nvm_request_adaptive_flush_now();
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "re-flush enfileirado");
+    CHECK_TRUE(flash_jobs_drain(1000000u), "journal + erase do setor 0 drenados");
+    CHECK_FALSE(nvm_adaptive_sector_valid(flash_host_model_sector(0u)),
+                "setor 0 revogado após o commit");
+    CHECK_EQ(flash_host_model_sector(0u)[0], 0xFFu, "setor 0 apagado");
+    CHECK_TRUE(nvm_load_adaptive_maps(), "remount do journal");
+    CHECK_EQ(nvm_read_ltft(0u, 9u), (int8_t)17, "ltft vem do journal");
+
+    section("nvm adaptativo: erase do setor 0 interrompido → repetido no flush");
+    memcpy(flash_host_model_sector(0u), old_img, sizeof(old_img));
+    CHECK_TRUE(nvm_load_adaptive_maps(), "journal monta; setor 0 ainda LTF3");
+    CHECK_EQ(flash_jobs_pending(), 0u, "boot não escreve na flash");
+    CHECK_TRUE(nvm_flush_adaptive_maps(), "mapas limpos: nada a gravar");
+    CHECK_EQ(flash_jobs_pending(), 1u, "erase do setor 0 enfileirado");
+    CHECK_TRUE(flash_jobs_drain(1000000u), "erase drenado");
+    CHECK_FALSE(nvm_adaptive_sector_valid(flash_host_model_sector(0u)), "setor 0 revogado");
+
+    section("nvm adaptativo: flush sem células alteradas não arma o priming ES0565");
+    nvm_test_reset();
+    CHECK_TRUE(nvm_load_adaptive_maps(), "load com anel vazio");
+    nvm_request_adaptive_flush_now();
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "formatação enfileirada");
+    CHECK_TRUE(flash_jobs_drain(1000000u), "anel formatado");
+    flash_jobs_test_reset();  // "reset" do MCU com o journal já gravado
+    const uint32_t erases0 = flash_host_model_erase_count();
+    const uint32_t progs0 = flash_host_model_program_count();
+    nvm_reset_knock_map();  // dirty, mas o mapa já é zeros
+    nvm_request_adaptive_flush_now();
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "flush no-op enfileirado");
+    CHECK_TRUE(flash_jobs_drain(1000000u), "flush no-op drenado");
+    CHECK_EQ(flash_jobs_completed(), 1u, "job concluído ok");
+    CHECK_EQ(flash_host_model_erase_count(), erases0, "sem erase");
+    CHECK_EQ(flash_host_model_program_count(), progs0, "sem program");
+    CHECK_FALSE(flash_jobs_primed(), "job sem operação de flash não arma o priming");
+    CHECK_TRUE(nvm_write_ltft(1u, 1u, 4), "célula alterada");
+    nvm_request_adaptive_flush_now();
+    CHECK_FALSE(nvm_flush_adaptive_maps(), "flush real enfileirado");
+    CHECK_TRUE(flash_jobs_drain(1000000u), "flush real drenado");
+    CHECK_TRUE(flash_jobs_primed(), "program do journal concluído → primed");
+    nvm_test_reset();
+}
+
+// ── SPI jobs + TLE8888 (modelo de registos) ──────────────────────────────
+
+namespace {
+
+uint16_t g_spi_cb_calls = 0u;
+bool     g_spi_cb_ok = false;
+
+void spi_test_done(void*, bool ok, const uint16_t*, uint8_t) {
+    ++g_spi_cb_calls;
+    g_spi_cb_ok = ok;
+}
+
+void tle_boot_healthy() {
+    using namespace ems::hal;
+    spi_jobs_attach(tle8888_host_model_io());
+    tle8888_host_model_reset();
+    tle8888_test_reset();
+    tle8888_init();
+}
+
+}  // namespace
+
+void test_spi_jobs_tle8888(void) {
+    using namespace ems::hal;
+
+    // Boot: probe → configuração com read-back → modo normal.
+    tle_boot_healthy();
+    CHECK_TRUE(tle8888_ok(), "tle8888: chip ID 0x88 no boot");
+    CHECK_EQ(tle8888_fault_count(), 0u, "tle8888: boot sem faults");
+    CHECK_EQ(tle8888_host_model_reg(0x04u), 0x05u, "tle8888: INCONFIG0 low-side ch0/ch1");
+    CHECK_EQ(tle8888_host_model_reg(0x05u), 0x05u, "tle8888: INCONFIG1 low-side ch2/ch3");
+    CHECK_EQ(tle8888_host_model_reg(0x08u), 0xAAu, "tle8888: IGNCONFIG push-pull ×4");
+    CHECK_EQ(tle8888_host_model_reg(0x0Au), 0x35u, "tle8888: OC INJ 10A / IGN 6A");
+    CHECK_EQ(tle8888_host_model_reg(0x0Cu), 0x15u, "tle8888: VRS enable + filtro + 20mV");
+    CHECK_EQ(tle8888_host_model_reg(0x01u), 0x01u, "tle8888: OPMODE normal após verify");
+    CHECK_TRUE(!spi_jobs_busy(), "tle8888: fila vazia após o boot");
+
+    // Diag assíncrono: poll só enfileira; decode chega no callback.
+    tle8888_host_model_set_reg(0x38u, 0x09u);  // ch0 open-load, ch1 short-GND
+    tle8888_host_model_set_reg(0x3Bu, 0x0Cu);  // ch7 short-VBAT
+    const uint32_t frames0 = tle8888_host_model_frames();
+    tle8888_poll_diag();
+    CHECK_EQ(spi_jobs_pending(), 1u, "tle8888: poll enfileira 1 burst");
+    CHECK_EQ(tle8888_fault_bitmap(), 0u, "tle8888: nada decodificado antes do step");
+    static_cast<void>(spi_jobs_step());   // arranca o burst
+    static_cast<void>(spi_jobs_step());   // recolhe + callback
+    CHECK_EQ(tle8888_host_model_frames() - frames0, 5u, "tle8888: diag = 4 reads + WD num burst");
+    CHECK_EQ(tle8888_channel_fault(0u), 1u, "tle8888: ch0 open-load");
+    CHECK_EQ(tle8888_channel_fault(1u), 2u, "tle8888: ch1 short-GND");
+    CHECK_EQ(tle8888_channel_fault(7u), 3u, "tle8888: ch7 short-VBAT");
+    CHECK_EQ(tle8888_fault_bitmap(), 0x83u, "tle8888: bitmap ch0|ch1|ch7");
+    CHECK_EQ(tle8888_fault_count(), 1u, "tle8888: 1 fault por lote com canal em falha");
+    CHECK_EQ(tle8888_host_model_wd_triggers(), 1u, "tle8888: WD trigger no mesmo burst");
+
+    // Latência: burst em voo não bloqueia; poll seguinte é ignorado.
+    tle8888_host_model_set_reg(0x38u, 0x00u);
+    tle8888_host_model_set_reg(0x3Bu, 0x00u);
+    tle8888_host_model_set_frame_us(40u);  // 5 frames → 200 µs
+    tle8888_poll_diag();
+    static_cast<void>(spi_jobs_step());
+    static_cast<void>(spi_jobs_step());
+    CHECK_TRUE(spi_jobs_busy(), "tle8888: burst de 200 µs ainda em voo");
+    tle8888_poll_diag();
+    CHECK_EQ(tle8888_busy_skips(), 1u, "tle8888: poll com lote em voo não empilha");
+    CHECK_EQ(spi_jobs_pending(), 1u, "tle8888: continua 1 burst na fila");
+    tle8888_host_model_advance_us(200u);
+    static_cast<void>(spi_jobs_step());
+    CHECK_TRUE(!spi_jobs_busy(), "tle8888: burst concluído após a latência");
+    CHECK_EQ(tle8888_fault_bitmap(), 0u, "tle8888: diag limpo decodificado");
+    tle8888_host_model_set_frame_us(0u);
+
+    // Chip preso (EOT nunca chega): timeout aborta, ok cai, re-probe depois.
+    const uint32_t timeouts0 = spi_jobs_timeouts();
+    const uint16_t faults0 = tle8888_fault_count();
+    tle8888_host_model_set_hang(true);
+    tle8888_poll_diag();
+    static_cast<void>(spi_jobs_step());
+    static_cast<void>(spi_jobs_step());
+    CHECK_TRUE(tle8888_ok(), "tle8888: ok mantém-se dentro do timeout");
+    tle8888_host_model_advance_us(kSpiJobTimeoutUs);
+    static_cast<void>(spi_jobs_step());
+    CHECK_EQ(spi_jobs_timeouts() - timeouts0, 1u, "tle8888: timeout contado");
+    CHECK_TRUE(!tle8888_ok(), "tle8888: burst expirado → chip não ok");
+    CHECK_EQ(tle8888_fault_count() - faults0, 1u, "tle8888: timeout conta fault");
+    CHECK_TRUE(!spi_jobs_busy(), "tle8888: fila liberta após abort");
+    tle8888_host_model_set_hang(false);
+    tle8888_poll_diag();  // re-probe
+    static_cast<void>(spi_jobs_step());
+    static_cast<void>(spi_jobs_step());
+    CHECK_TRUE(tle8888_ok(), "tle8888: re-probe recupera o chip");
+
+    // MISO preso a 1: probe lê 0xFF ≠ ID.
+    tle8888_host_model_set_miso_stuck(true);
+    tle8888_test_reset();
+    tle8888_init();
+    CHECK_TRUE(!tle8888_ok(), "tle8888: MISO 0xFFFF falha o probe");
+    CHECK_EQ(tle8888_fault_count(), 1u, "tle8888: probe falhado conta fault");
+
+    // Chip ausente/errado: sem configuração escrita.
+    tle8888_host_model_reset();
+    tle8888_host_model_set_reg(0x7Eu, 0x00u);
+    tle8888_test_reset();
+    tle8888_init();
+    CHECK_TRUE(!tle8888_ok(), "tle8888: chip ID errado");
+    CHECK_EQ(tle8888_host_model_reg(0x04u), 0x00u, "tle8888: sem ID não configura");
+
+    // Fila: profundidade, limites de frames, callback.
+    tle8888_host_model_reset();
+    spi_jobs_test_reset();
+    const uint16_t tx[2] = {0x8000u, 0x8000u};
+    bool all = true;
+    for (uint8_t i = 0u; i < kSpiJobQueueDepth; ++i) {
+        all = spi_jobs_submit(tx, 2u, spi_test_done, nullptr) && all;
+    }
+    CHECK_TRUE(all, "spi_jobs: kSpiJobQueueDepth jobs aceites");
+    CHECK_TRUE(!spi_jobs_submit(tx, 2u, spi_test_done, nullptr), "spi_jobs: fila cheia rejeita");
+    CHECK_TRUE(!spi_jobs_submit(tx, 0u, spi_test_done, nullptr), "spi_jobs: n = 0 rejeitado");
+    g_spi_cb_calls = 0u;
+    CHECK_TRUE(spi_jobs_drain(1000u), "spi_jobs: drain esvazia a fila");
+    CHECK_EQ(g_spi_cb_calls, kSpiJobQueueDepth, "spi_jobs: 1 callback por job");
+    CHECK_TRUE(g_spi_cb_ok, "spi_jobs: callback com ok");
+
+    tle_boot_healthy();  // estado saudável para os suites seguintes
+}
+
+// ============================================================================
+// HAL CAL STORE (páginas de calibração A/B)
+// ============================================================================
+
+void test_cal_store_all(void) {
+    using namespace ems::hal;
+    static uint8_t p1[512], p2[512], p3[512], legacy[512], out[512];
+    for (uint16_t i = 0u; i < 512u; ++i) {
+        p1[i] = static_cast<uint8_t>(i);
+        p2[i] = static_cast<uint8_t>(i ^ 0xA5u);
+        p3[i] = static_cast<uint8_t>(255u - i);
+        legacy[i] = static_cast<uint8_t>(i * 7u);
+    }
+    constexpr uint16_t kA0 = 1u, kB0 = 15u;
+
+    section("cal_store: layout legado (sem trailer) lido em bruto do setor A");
+    flash_host_model_reset(0xFFu);
+    flash_host_model_set_latency(0u, 0u);
+    flash_jobs_attach(flash_host_model_io());
+    flash_jobs_test_reset();
+    cal_store_configure(kA0, kB0);
+    cal_store_test_reset();
+    memcpy(flash_host_model_sector(kA0), legacy, sizeof(legacy));
+    CHECK_EQ(cal_store_active_copy(0u), kCalCopyNone, "nenhuma cópia A/B válida");
+    CHECK_TRUE(cal_store_load(0u, out, sizeof(out)) && memcmp(out, legacy, sizeof(out)) == 0,
+               "load devolve o setor A legado");
+
+    section("cal_store: primeiro burn vai para B, preserva o legado em A");
+    g_fjd = {};
+    CHECK_TRUE(cal_store_queue_burn(0u, p1, sizeof(p1), fjd_cb, nullptr), "burn 1 enfileirado");
+    CHECK_TRUE(cal_store_page_busy(0u), "página ocupada até ao done");
+    CHECK_FALSE(cal_store_queue_burn(0u, p2, sizeof(p2), fjd_cb, nullptr),
+                "segundo burn da mesma página rejeitado com job em curso");
+    CHECK_TRUE(flash_jobs_drain(100000u) && g_fjd.ok, "burn 1 ok");
+    CHECK_FALSE(cal_store_page_busy(0u), "página livre após done");
+    CHECK_EQ(cal_store_active_copy(0u), static_cast<int8_t>(kCalCopyB), "activa = B");
+    CHECK_TRUE(memcmp(flash_host_model_sector(kA0), legacy, sizeof(legacy)) == 0,
+               "setor A legado intocado");
+    const CalCopyInfo b1 = cal_store_copy_info(0u, kCalCopyB);
+    CHECK_TRUE(b1.valid && !b1.revoked && b1.seq == 1u && b1.len == 512u, "trailer B: seq 1, len 512");
+    CHECK_TRUE(cal_store_load(0u, out, sizeof(out)) && memcmp(out, p1, sizeof(out)) == 0,
+               "load = burn 1");
+    uint8_t wide[600];
+    CHECK_TRUE(cal_store_load(0u, wide, sizeof(wide)) && wide[511] == p1[511] &&
+               wide[512] == 0xFFu && wide[599] == 0xFFu,
+               "load além do len gravado → 0xFF (estado apagado)");
+
+    section("cal_store: burns alternam A/B com seq crescente");
+    CHECK_TRUE(cal_store_queue_burn(0u, p2, sizeof(p2), nullptr, nullptr), "burn 2");
+    CHECK_TRUE(flash_jobs_drain(100000u), "drain");
+    CHECK_EQ(cal_store_active_copy(0u), static_cast<int8_t>(kCalCopyA), "activa = A");
+    CHECK_EQ(cal_store_copy_info(0u, kCalCopyA).seq, 2u, "seq A = 2");
+    CHECK_TRUE(cal_store_load(0u, out, sizeof(out)) && memcmp(out, p2, sizeof(out)) == 0,
+               "load = burn 2");
+
+    section("cal_store: power-loss a meio do burn mantém a cópia activa");
+    flash_host_model_set_latency(3000u, 60u);
+    const uint32_t progs0 = flash_host_model_program_count();
+    CHECK_TRUE(cal_store_queue_burn(0u, p3, sizeof(p3), nullptr, nullptr), "burn 3 (alvo B)");
+    uint32_t slots = 0u;
+    while (flash_host_model_program_count() < progs0 + 10u && slots < 200u) {
+        static_cast<void>(flash_jobs_step(kFlashJobSliceUs));
+        flash_host_model_advance_us(2000u);
+        ++slots;
+    }
+    CHECK_TRUE(flash_jobs_busy(), "burn 3 interrompido antes do trailer");
+    // reset: fila e estado RAM perdidos, flash fica como está
+    flash_jobs_attach(flash_host_model_io());
+    flash_jobs_test_reset();
+    cal_store_test_reset();
+    flash_host_model_set_latency(0u, 0u);
+    CHECK_FALSE(cal_store_copy_info(0u, kCalCopyB).valid, "cópia B rasgada → inválida");
+    CHECK_EQ(cal_store_active_copy(0u), static_cast<int8_t>(kCalCopyA), "boot fica em A");
+    CHECK_TRUE(cal_store_load(0u, out, sizeof(out)) && memcmp(out, p2, sizeof(out)) == 0,
+               "load = burn 2 (último completo)");
+
+    section("cal_store: CRC apanha bit-rot na cópia mais recente");
+    CHECK_TRUE(cal_store_queue_burn(0u, p3, sizeof(p3), nullptr, nullptr), "burn 3 repetido");
+    CHECK_TRUE(flash_jobs_drain(100000u), "drain");
+    CHECK_EQ(cal_store_active_copy(0u), static_cast<int8_t>(kCalCopyB), "activa = B (seq 3)");
+    flash_host_model_sector(kB0)[100] ^= 0x01u;
+    CHECK_EQ(cal_store_active_copy(0u), static_cast<int8_t>(kCalCopyA), "B corrompida → A");
+    flash_host_model_sector(kB0)[100] ^= 0x01u;
+
+    section("cal_store: rollback revoga a activa, um só nível");
+    g_fjd = {};
+    CHECK_TRUE(cal_store_queue_rollback(0u, fjd_cb, nullptr), "rollback enfileirado");
+    CHECK_TRUE(flash_jobs_drain(100000u) && g_fjd.ok, "rollback ok");
+    const CalCopyInfo b3 = cal_store_copy_info(0u, kCalCopyB);
+    CHECK_TRUE(b3.valid && b3.revoked, "B válida mas revogada");
+    CHECK_EQ(cal_store_active_copy(0u), static_cast<int8_t>(kCalCopyA), "activa = A");
+    CHECK_TRUE(cal_store_load(0u, out, sizeof(out)) && memcmp(out, p2, sizeof(out)) == 0,
+               "load = burn 2 após rollback");
+    CHECK_FALSE(cal_store_queue_rollback(0u, nullptr, nullptr), "sem cópia anterior → false");
+    CHECK_TRUE(cal_store_queue_burn(0u, p1, sizeof(p1), nullptr, nullptr), "burn após rollback");
+    CHECK_TRUE(flash_jobs_drain(100000u), "drain");
+    const CalCopyInfo b4 = cal_store_copy_info(0u, kCalCopyB);
+    CHECK_TRUE(b4.valid && !b4.revoked && b4.seq == 3u, "B regravada (seq A+1), revoke apagado");
+    CHECK_TRUE(cal_store_load(0u, out, sizeof(out)) && memcmp(out, p1, sizeof(out)) == 0,
+               "load = burn após rollback");
+
+    section("cal_store: seq wrap-aware e argumentos inválidos");
+    CHECK_FALSE(cal_store_queue_burn(kCalStorePages, p1, 16u, nullptr, nullptr), "página fora");
+    CHECK_FALSE(cal_store_queue_burn(1u, p1, kCalStorePageMax + 1u, nullptr, nullptr),
+                "len > kCalStorePageMax");
+    CHECK_FALSE(cal_store_load(1u, nullptr, 16u), "destino nulo");
+    CHECK_FALSE(cal_store_queue_rollback(1u, nullptr, nullptr), "página sem burns → false");
+
+    // Âncora: páginas 1 e 2 ligadas à 3 (tabelas ↔ eixos).
+    section("cal_store: âncora — burn isolado da âncora recusado, membros ligados");
+    flash_host_model_reset(0xFFu);
+    flash_jobs_test_reset();
+    cal_store_configure(kA0, kB0);
+    cal_store_test_reset();
+    CHECK_TRUE(cal_store_bind(1u, 3u) && cal_store_bind(2u, 3u), "1, 2 → âncora 3");
+    CHECK_FALSE(cal_store_bind(3u, 0u), "âncora não pode ter âncora");
+    CHECK_FALSE(cal_store_queue_burn(3u, p1, 64u, nullptr, nullptr),
+                "âncora com ligadas só no burn de grupo");
+    const CalGroupMember g1[] = {{1u, p1, 64u}, {2u, p1, 64u}, {3u, p1, 64u}};
+    g_fjd = {};
+    CHECK_TRUE(cal_store_queue_group_burn(g1, 3u, fjd_cb, nullptr), "grupo 1");
+    CHECK_TRUE(flash_jobs_drain(100000u) && g_fjd.calls == 1u && g_fjd.ok, "grupo 1: um done ok");
+    CHECK_TRUE(cal_store_active_copy(1u) == kCalCopyB && cal_store_active_copy(3u) == kCalCopyB,
+               "grupo 1 activo");
+    const CalGroupMember bad[] = {{0u, p1, 64u}, {3u, p1, 64u}};
+    CHECK_FALSE(cal_store_queue_group_burn(bad, 2u, nullptr, nullptr), "membro não ligado");
+
+    section("cal_store: âncora — power-loss antes do commit mantém o grupo anterior");
+    const CalGroupMember g2[] = {{1u, p2, 64u}, {2u, p2, 64u}, {3u, p2, 64u}};
+    flash_host_model_set_latency(3000u, 60u);
+    CHECK_TRUE(cal_store_queue_group_burn(g2, 3u, nullptr, nullptr), "grupo 2");
+    slots = 0u;
+    while (!cal_store_copy_info(2u, kCalCopyA).valid && slots < 200u) {
+        static_cast<void>(flash_jobs_step(kFlashJobSliceUs));
+        flash_host_model_advance_us(2000u);
+        ++slots;
+    }
+    flash_jobs_attach(flash_host_model_io());
+    flash_jobs_test_reset();
+    cal_store_test_reset();
+    flash_host_model_set_latency(0u, 0u);
+    CHECK_TRUE(cal_store_copy_info(1u, kCalCopyA).valid, "membro novo gravado");
+    CHECK_EQ(cal_store_active_copy(1u), static_cast<int8_t>(kCalCopyB),
+             "sem o trailer da âncora o membro novo não é usado");
+    CHECK_TRUE(cal_store_load(2u, out, 64u) && memcmp(out, p1, 64u) == 0, "grupo 1 inteiro");
+
+    section("cal_store: âncora — falha de um membro não comita o grupo");
+    g_fjd = {};
+    flash_host_model_fail_next_op();
+    CHECK_TRUE(cal_store_queue_group_burn(g2, 3u, fjd_cb, nullptr), "grupo 2 repetido");
+    CHECK_TRUE(flash_jobs_drain(100000u) && g_fjd.calls == 1u && !g_fjd.ok, "done(false)");
+    CHECK_EQ(cal_store_active_copy(3u), static_cast<int8_t>(kCalCopyB), "âncora intocada");
+    CHECK_TRUE(cal_store_load(1u, out, 64u) && memcmp(out, p1, 64u) == 0, "membros no grupo 1");
+    CHECK_TRUE(cal_store_queue_group_burn(g2, 3u, nullptr, nullptr) && flash_jobs_drain(100000u),
+               "grupo 2 comitado");
+    CHECK_TRUE(cal_store_load(1u, out, 64u) && memcmp(out, p2, 64u) == 0 &&
+               cal_store_load(3u, out, 64u) && memcmp(out, p2, 64u) == 0, "grupo 2 activo");
+
+    section("cal_store: âncora — rollback leva o grupo, membro só sobre os mesmos eixos");
+    CHECK_FALSE(cal_store_queue_rollback(1u, nullptr, nullptr),
+                "membro cuja cópia anterior é do grupo 1 → false");
+    CHECK_TRUE(cal_store_queue_rollback(3u, nullptr, nullptr) && flash_jobs_drain(100000u),
+               "rollback da âncora");
+    CHECK_TRUE(cal_store_load(1u, out, 64u) && memcmp(out, p1, 64u) == 0 &&
+               cal_store_load(2u, out, 64u) && memcmp(out, p1, 64u) == 0 &&
+               cal_store_load(3u, out, 64u) && memcmp(out, p1, 64u) == 0,
+               "grupo 1 inteiro de volta");
+    CHECK_TRUE(cal_store_queue_burn(2u, p3, 64u, nullptr, nullptr) && flash_jobs_drain(100000u),
+               "burn isolado do membro 2 (mesmos eixos)");
+    CHECK_TRUE(cal_store_queue_rollback(2u, nullptr, nullptr) && flash_jobs_drain(100000u),
+               "rollback do membro 2 sobre os mesmos eixos");
+    CHECK_TRUE(cal_store_load(2u, out, 64u) && memcmp(out, p1, 64u) == 0, "membro 2 = grupo 1");
+    nvm_test_reset();
+}
+
 // ============================================================================
 // XTAU AUTOCALIB
 // ============================================================================
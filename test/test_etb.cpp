@@ -10,6 +10,7 @@
 
 #include "engine/etb_control.h"
 #include "engine/etb_autocal.h"
+#include "engine/etb_loop.h"
 #include "hal/etb_driver.h"
 #include "engine/torque_manager.h"
 #include "engine/calibration.h"
@@ -529,6 +530,338 @@ void test_etb_cpp_update(void) {
     CHECK_EQ(ems::engine::etb_control_test_get_integrator(), 0, "no error → integrator stays 0");
 }
 
+// Pipeline inteiro/Q15 vs modelo de referência float (mesma lei, sem quantização).
+void test_etb_q15_pipeline(void) {
+    section("etb/torque: pipeline inteiro Q15 vs referência float");
+
+    etb_cal_valid = 1u;
+    etb_kp_x10 = 120u;
+    etb_ki_x10 = 8u;
+    etb_kd_x10 = 40u;
+
+    // Integrador Q15: a 2 ms, ki=8 e erro 5 % dão 0.8 pct×10/passo — antes
+    // truncava a 0 e o erro estacionário nunca era integrado.
+    etb_control_reset();
+    for (int i = 0; i < 100; ++i) {
+        etb_control_update(50u, 0u, true, 2u);
+    }
+    CHECK_EQ(etb_control_get_integrator(), 80, "2 ms, e=5 %: 100 × 0.8 = 80 pct×10");
+
+    // Malha aberta: sequência pseudo-aleatória de alvo/medida.
+    etb_control_reset();
+    etb_control_ref_reset();
+    uint32_t lcg = 0x5EEDu;
+    int32_t worst_out = 0;
+    int32_t worst_int = 0;
+    uint16_t target = 200u;
+    uint16_t meas = 180u;
+    for (int i = 0; i < 5000; ++i) {
+        lcg = lcg * 1664525u + 1013904223u;
+        if ((i % 250) == 0) { target = static_cast<uint16_t>((lcg >> 8u) % 1001u); }
+        // medida segue o alvo com ruído de ±2 LSB
+        const int32_t noise = static_cast<int32_t>((lcg >> 20u) % 5u) - 2;
+        int32_t m = static_cast<int32_t>(meas) + (static_cast<int32_t>(target) - meas) / 50 + noise;
+        meas = static_cast<uint16_t>(m < 0 ? 0 : (m > 1000 ? 1000 : m));
+        const EtbControlState q = etb_control_update(target, meas, true, 2u);
+        const EtbControlRef f = etb_control_ref_update(target / 10.0f, meas / 10.0f, true, 2.0f);
+        const int32_t d_out = std::abs(q.output_pct_x10 -
+                                       static_cast<int32_t>(lroundf(f.output_pct * 10.0f)));
+        const int32_t d_int = std::abs(etb_control_get_integrator() -
+                                       static_cast<int32_t>(lroundf(f.integrator_pct * 10.0f)));
+        if (d_out > worst_out) { worst_out = d_out; }
+        if (d_int > worst_int) { worst_int = d_int; }
+    }
+    // Diferenças: truncagem de P (< 1) e do filtro Q4 da derivada; a decisão de
+    // anti-windup pode divergir num passo na fronteira de saturação.
+    CHECK_TRUE(worst_out <= 5, "saída Q15 = referência float (±0.5 %)");
+    CHECK_TRUE(worst_int <= 2, "integrador Q15 = referência float (±0.2 %)");
+
+    // Anti-windup: erro grande sustentado → P+I encosta no limite e I pára.
+    etb_control_reset();
+    etb_control_ref_reset();
+    EtbControlState q{};
+    EtbControlRef f{};
+    for (int i = 0; i < 2000; ++i) {
+        q = etb_control_update(500u, 0u, true, 2u);
+        f = etb_control_ref_update(50.0f, 0.0f, true, 2.0f);
+    }
+    CHECK_EQ(q.output_pct_x10, 1000, "saturado a 100 %");
+    CHECK_TRUE(etb_control_get_integrator() <= 400, "I limitado a 1000 − P (anti-windup)");
+    CHECK_TRUE(std::abs(etb_control_get_integrator() -
+                        static_cast<int32_t>(lroundf(f.integrator_pct * 10.0f))) <= 1,
+               "anti-windup igual à referência");
+
+    // Pedal map + corte TC/launch em todos os drive modes.
+    int32_t worst_map = 0;
+    for (uint8_t mode = 0u; mode < ETB_MODE_COUNT; ++mode) {
+        etb_set_drive_mode(static_cast<etb_drive_mode_t>(mode));
+        for (uint16_t app = 0u; app <= 1000u; ++app) {
+            const uint16_t t = torque_pedal_target_x10(app);
+            const float tf = torque_pedal_target_ref(app / 10.0f);
+            for (uint16_t cut = 0u; cut <= 1000u; cut = static_cast<uint16_t>(cut + 125u)) {
+                const int32_t a = torque_apply_cut_x10(t, cut);
+                const int32_t b = static_cast<int32_t>(
+                    lroundf(torque_apply_cut_ref(tf, cut / 10.0f) * 10.0f));
+                if (std::abs(a - b) > worst_map) { worst_map = std::abs(a - b); }
+            }
+        }
+    }
+    etb_set_drive_mode(ETB_MODE_NORMAL);
+    CHECK_TRUE(worst_map <= 2, "pedal map × corte: inteiro = float (±2 pct×10)");
+
+    // Malha fechada: rampa de pedal com corte TC a meio, planta de 1.ª ordem.
+    // Os dois caminhos correm em paralelo; a lâmina não pode divergir > 0.5 %.
+    // Ganhos sintonizados para esta planta (com kd=4 a malha entra em ciclo
+    // limite e a comparação deixa de ser significativa).
+    etb_kp_x10 = 30u;
+    etb_ki_x10 = 20u;
+    etb_kd_x10 = 1u;
+    etb_control_reset();
+    etb_control_ref_reset();
+    float pos_q = 0.0f;
+    float pos_f = 0.0f;
+    float worst_pos = 0.0f;
+    for (int i = 0; i < 1500; ++i) {
+        const uint16_t app = static_cast<uint16_t>(i < 500 ? i * 2 : (i < 1000 ? 1000 : 300));
+        const uint16_t cut = (i >= 700 && i < 900) ? 400u : 0u;
+        const uint16_t tgt = torque_apply_cut_x10(torque_pedal_target_x10(app), cut);
+        const float tgt_f = torque_apply_cut_ref(torque_pedal_target_ref(app / 10.0f),
+                                                 cut / 10.0f);
+        const uint16_t meas_q = static_cast<uint16_t>(lroundf(pos_q * 10.0f));
+        const EtbControlState cq = etb_control_update(tgt, meas_q, true, 2u);
+        const EtbControlRef cf = etb_control_ref_update(tgt_f, pos_f, true, 2.0f);
+        // planta: mola + motor, 1.ª ordem τ = 100 ms (regime: posição = comando)
+        pos_q += (cq.output_pct_x10 / 10.0f - pos_q) * 0.02f;
+        pos_f += (cf.output_pct - pos_f) * 0.02f;
+        pos_q = pos_q < 0.0f ? 0.0f : (pos_q > 100.0f ? 100.0f : pos_q);
+        pos_f = pos_f < 0.0f ? 0.0f : (pos_f > 100.0f ? 100.0f : pos_f);
+        const float d = fabsf(pos_q - pos_f);
+        if (d > worst_pos) { worst_pos = d; }
+    }
+    CHECK_TRUE(worst_pos <= 0.5f, "malha fechada: lâmina inteira ≈ float (≤ 0.5 %)");
+    CHECK_TRUE(fabsf(pos_q - torque_pedal_target_ref(30.0f)) <= 0.5f,
+               "malha fechada converge para o alvo do pedal");
+
+    etb_kp_x10 = 120u;
+    etb_ki_x10 = 8u;
+    etb_kd_x10 = 40u;
+}
+
+struct EtbLoopStep {
+    float overshoot;   // % acima do alvo (degrau de subida)
+    float settle_ms;   // último instante fora de ±1 %
+    float final_err;
+};
+
+// Corre ms de malha na ISR (disparada pelo stub do TIM7) contra o modelo da
+// borboleta, com o alvo dado a partir de t=0.
+static EtbLoopStep etb_loop_run(uint16_t rate_hz, float ms, float target_pct,
+                                float* trace = nullptr) {
+    EtbLoopStep r{0.0f, 0.0f, 0.0f};
+    etb_loop_set_target(static_cast<uint16_t>(lroundf(target_pct * 10.0f)), true);
+    const int n = static_cast<int>(ms * rate_hz / 1000.0f);
+    for (int i = 0; i < n; ++i) {
+        tim7_test_fire();
+        etb_plant_step(1.0f / rate_hz);
+        const float p = etb_plant_position_pct();
+        if (p - target_pct > r.overshoot) { r.overshoot = p - target_pct; }
+        if (fabsf(p - target_pct) > 1.0f) { r.settle_ms = (i + 1) * 1000.0f / rate_hz; }
+        if (trace != nullptr && (i % (rate_hz / 1000u)) == 0) {
+            trace[i / (rate_hz / 1000u)] = p;
+        }
+    }
+    r.final_err = etb_plant_position_pct() - target_pct;
+    return r;
+}
+
+static void etb_loop_setup(uint16_t rate_hz, float pos_pct) {
+    drv_setup();
+    etb_driver_init();
+    etb_plant_reset(pos_pct);
+    etb_loop_init(rate_hz);
+}
+
+void test_etb_loop_isr(void) {
+    section("etb_loop: malha de posição na ISR do TIM7 + modelo da borboleta");
+
+    etb_cal_valid = 1u;
+    etb_kp_x10 = 120u;
+    etb_ki_x10 = 8u;
+    etb_kd_x10 = 40u;
+
+    // Versão µs = versão ms no mesmo período (o main loop delega).
+    etb_control_reset();
+    EtbControlState a[64];
+    for (int i = 0; i < 64; ++i) {
+        a[i] = etb_control_update(static_cast<uint16_t>(300 + (i % 7) * 40), 280u, true, 2u);
+    }
+    etb_control_reset();
+    bool same = true;
+    for (int i = 0; i < 64; ++i) {
+        const EtbControlState b = etb_control_update_us(
+            static_cast<uint16_t>(300 + (i % 7) * 40), 280u, true, 2000u);
+        same = same && b.output_pct_x10 == a[i].output_pct_x10;
+    }
+    CHECK_TRUE(same, "update_us(2000) = update(2 ms)");
+
+    // A 1 ms (filtro da derivada com τ fixo) continua igual à referência float.
+    etb_control_reset();
+    etb_control_ref_reset();
+    int32_t worst = 0;
+    uint16_t meas = 200u;
+    for (int i = 0; i < 3000; ++i) {
+        const uint16_t tgt = static_cast<uint16_t>((i / 300) % 2 ? 600u : 250u);
+        const EtbControlState q = etb_control_update_us(tgt, meas, true, 1000u);
+        const EtbControlRef f = etb_control_ref_update(tgt / 10.0f, meas / 10.0f, true, 1.0f);
+        const int32_t d = std::abs(q.output_pct_x10 -
+                                   static_cast<int32_t>(lroundf(f.output_pct * 10.0f)));
+        if (d > worst) { worst = d; }
+        meas = static_cast<uint16_t>(meas + (static_cast<int32_t>(tgt) - meas) / 40);
+    }
+    CHECK_TRUE(worst <= 5, "1 ms: Q15 = referência float (±0.5 %)");
+
+    // Arranque / taxa
+    etb_loop_setup(0u, 7.0f);
+    CHECK_FALSE(etb_loop_running(), "rate 0 → PID no main loop");
+    CHECK_EQ(tim7_test_rate_hz(), 0u, "TIM7 parado");
+    etb_loop_init(400u);
+    CHECK_EQ(tim7_test_rate_hz(), 1000u, "taxa limitada a ≥ 1 kHz");
+    etb_loop_init(5000u);
+    CHECK_EQ(etb_loop_stats().rate_hz, 2000u, "taxa limitada a ≤ 2 kHz");
+
+    // Leitura rápida: a ISR vê a sequência do DMA já, o CIC (÷2) ainda não.
+    adc_init();
+    const uint16_t seq[8] = {0u, 0u, 0u, 0u, 0u, 0u, 8000u, 8000u};
+    adc_test_dma_sequence_primary(seq);
+    CHECK_EQ(adc_primary_read_fast_x16(AdcPrimaryChannel::ETB_TPS1), 32000u,
+             "fast_x16 = oversampler ×4 sem decimação");
+    CHECK_TRUE(adc_primary_read_x16(AdcPrimaryChannel::ETB_TPS1) != 32000u,
+               "CIC ainda não entregou a amostra");
+
+    // Release: a ISR lê e faz kick do ADC mas não toca na ponte.
+    etb_loop_setup(1000u, 7.0f);
+    etb_driver_set_motor_pwm(300);
+    const uint32_t kicks0 = adc_test_primary_kicks();
+    for (int i = 0; i < 20; ++i) { tim7_test_fire(); }
+    CHECK_EQ(etb_driver_test_motor_pwm(), 300, "Release: ponte intocada (auto-cal/teste)");
+    CHECK_EQ(adc_test_primary_kicks() - kicks0, 20u, "um kick do ADC por período");
+    CHECK_EQ(etb_loop_stats().runs, 20u, "ISR contada");
+
+    // Disabled: ponte desligada (mola → limp).
+    etb_loop_set_target(400u, false);
+    tim7_test_fire();
+    CHECK_EQ(etb_driver_test_motor_pwm(), 0, "Disabled: ponte desligada");
+
+    // Degrau 20 → 60 % a 1 kHz, ganhos para esta planta (a mola pede ~35 %
+    // de duty a 60 %: o I faz o grosso, o D amortece o motor).
+    etb_kp_x10 = 200u;
+    etb_ki_x10 = 400u;
+    etb_kd_x10 = 4u;
+    etb_loop_setup(1000u, 7.0f);
+    etb_loop_run(1000u, 300.0f, 20.0f);
+    float trace_1k[300];
+    const EtbLoopStep s1 = etb_loop_run(1000u, 300.0f, 60.0f, trace_1k);
+    CHECK_TRUE(s1.settle_ms <= 150.0f, "1 kHz: 20→60 % assenta (±1 %) em ≤ 150 ms");
+    CHECK_TRUE(s1.overshoot <= 1.5f, "1 kHz: overshoot ≤ 1.5 %");
+    CHECK_TRUE(fabsf(s1.final_err) <= 0.3f, "1 kHz: erro em regime ≤ 0.3 % contra a mola");
+    CHECK_FALSE(etb_loop_fault(), "sem falha de plausibilidade em funcionamento normal");
+
+    // A 2 kHz a mesma cal dá a mesma resposta (D com τ fixo, I por dt).
+    etb_loop_setup(2000u, 7.0f);
+    etb_loop_run(2000u, 300.0f, 20.0f);
+    float trace_2k[300];
+    const EtbLoopStep s2 = etb_loop_run(2000u, 300.0f, 60.0f, trace_2k);
+    float worst_traj = 0.0f;
+    for (int i = 0; i < 300; ++i) {
+        worst_traj = fmaxf(worst_traj, fabsf(trace_1k[i] - trace_2k[i]));
+    }
+    CHECK_TRUE(s2.settle_ms <= 150.0f && fabsf(s2.final_err) <= 0.3f,
+               "2 kHz: assenta em ≤ 150 ms, erro ≤ 0.3 %");
+    CHECK_TRUE(worst_traj <= 1.5f, "trajectória 1 kHz ≈ 2 kHz (≤ 1.5 %) sem re-sintonia");
+
+    // Vbat baixa (cranking): menos binário, o I compensa.
+    etb_plant_params().vbatt = 9.0f;
+    const EtbLoopStep s3 = etb_loop_run(2000u, 400.0f, 30.0f);
+    CHECK_TRUE(fabsf(s3.final_err) <= 0.3f, "Vbat 9 V: erro em regime ≤ 0.3 %");
+
+    // Plausibilidade: TPS2 aberto → falha trancada em 10 ms, ponte desligada.
+    etb_loop_setup(1000u, 7.0f);
+    etb_loop_run(1000u, 100.0f, 20.0f);
+    CHECK_TRUE(etb_driver_test_motor_pwm() != 0, "a seguir o alvo (ponte activa)");
+    adc_test_set_raw_primary(AdcPrimaryChannel::ETB_TPS2, 30u);
+    for (int i = 0; i < 9; ++i) { tim7_test_fire(); }
+    CHECK_FALSE(etb_loop_fault(), "9 ms fora de gama: ainda não");
+    tim7_test_fire();
+    CHECK_TRUE(etb_loop_fault(), "10 ms: falha trancada");
+    CHECK_EQ(etb_driver_test_motor_pwm(), 0, "falha → ponte desligada");
+    etb_plant_step(0.001f);   // TPS2 volta a ler bem
+    for (int i = 0; i < 20; ++i) { tim7_test_fire(); }
+    CHECK_TRUE(etb_loop_fault() && etb_driver_test_motor_pwm() == 0,
+               "trancada mesmo com o sensor de volta");
+
+    // Main loop: DTC uma vez por trancamento, limp e STATUS_ETB_LIMP.
+    DiagnosticManager::init();
+    CHECK_TRUE(etb_loop_diag_tick(), "diag_tick devolve a falha (limp)");
+    CHECK_TRUE(DiagnosticManager::is_fault_active(DiagnosticCode::ETB_TPS_FAULT),
+               "ETB_TPS_FAULT activo");
+    CHECK_TRUE(DiagnosticManager::get_highest_severity() == FaultSeverity::ERROR,
+               "severidade ERROR (limp, sem corte crítico)");
+    etb_loop_diag_tick();
+    const StoredDtc* dtc = DiagnosticManager::find_stored_dtc(DiagnosticCode::ETB_TPS_FAULT);
+    CHECK_TRUE(dtc != nullptr && dtc->occurrences == 1u, "DTC guardado, uma ocorrência");
+    sensor_setup();           // MAP válido para o VE vivo da página
+    sensors_init();
+    {
+        CkpSnapshot snap{};
+        snap.tooth_period_ns = 160000u;
+        snap.rpm_x10 = 62500u;
+        for (int i = 0; i < 5; ++i) { sensors_on_tooth(snap); }
+        sensors_test_tick_100ms();
+    }
+    ui_test_reset();
+    {
+        const uint8_t och[7] = {'r', 0x00u, 0x03u, 0x00u, 0x00u, 0x56u, 0x00u};
+        const EnvResp r = env_txn(och, 7u);
+        uint16_t st = 0u;
+        std::memcpy(&st, r.data + 12, 2u);
+        CHECK_TRUE(r.code == 0x00u && (st & STATUS_ETB_LIMP) != 0u,
+                   "página de tempo real: STATUS_ETB_LIMP");
+    }
+
+    etb_loop_init(1000u);
+    CHECK_FALSE(etb_loop_fault(), "etb_loop_init limpa a falha");
+    CHECK_FALSE(etb_loop_diag_tick(), "diag_tick sem falha após init");
+    CHECK_FALSE(DiagnosticManager::is_fault_active(DiagnosticCode::ETB_TPS_FAULT),
+                "DTC activo limpo (fica na memória)");
+    {
+        const uint8_t och[7] = {'r', 0x00u, 0x03u, 0x00u, 0x00u, 0x56u, 0x00u};
+        const EnvResp r = env_txn(och, 7u);
+        uint16_t st = 0u;
+        std::memcpy(&st, r.data + 12, 2u);
+        CHECK_TRUE((st & STATUS_ETB_LIMP) == 0u, "STATUS_ETB_LIMP limpo");
+    }
+
+    // TPS1 vs TPS2 a divergir mais que etb_max_delta_pct_x10 → falha.
+    etb_loop_set_target(200u, true);
+    for (int i = 0; i < 30; ++i) {
+        adc_test_set_raw_primary(AdcPrimaryChannel::ETB_TPS1, 1200u);
+        adc_test_set_raw_primary(AdcPrimaryChannel::ETB_TPS2, 2000u);
+        tim7_test_fire();
+    }
+    CHECK_TRUE(etb_loop_fault(), "TPS1/TPS2 incoerentes → falha");
+    CHECK_TRUE(etb_loop_diag_tick() &&
+               DiagnosticManager::is_fault_active(DiagnosticCode::ETB_TPS_FAULT),
+               "novo trancamento → novo report");
+
+    etb_loop_init(0u);
+    etb_loop_diag_tick();
+    DiagnosticManager::init();
+    etb_kp_x10 = 120u;
+    etb_ki_x10 = 8u;
+    etb_kd_x10 = 40u;
+    drv_set_valid_adc();
+}
+
 // ═══════════════════════════════════════════════════════════════════════════
 // TORQUE MANAGER — C++ namespace (ems::engine)
 // ═══════════════════════════════════════════════════════════════════════════
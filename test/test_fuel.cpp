@@ -18,6 +18,7 @@
 #include "drv/ckp.h"
 #include "drv/sensors.h"
 #include "engine/fuel_calc.h"
+#include "engine/fuel_pw_kernel.h"
 #include "engine/ign_calc.h"
 #include "engine/auxiliaries.h"
 #include "engine/knock.h"
@@ -1130,6 +1131,131 @@ void test_fuel_inj_two_slope(void) {
     inj_small_pulse_rate_q8  = 0u;
 }
 
+// ── Kernel fundido de PW: equivalência com a cadeia de fuel_calc ────────────
+// Varredura determinística (LCG) incluindo pontos fora de gama (VE=0, MAP>300,
+// λ fora de [650,1200], trim além de ±50%, Q8 fora de [64,512]); exige
+// |kernel − original| ≤ 1 µs em todos os pontos (por construção dá 0).
+namespace {
+uint32_t g_kern_lcg = 12345u;
+uint32_t kern_rand(uint32_t lo, uint32_t hi) {
+    g_kern_lcg = g_kern_lcg * 1664525u + 1013904223u;
+    return lo + (g_kern_lcg >> 8u) % (hi - lo + 1u);
+}
+uint32_t abs_diff_u32(uint32_t a, uint32_t b) { return (a > b) ? a - b : b - a; }
+}  // namespace
+
+void test_fuel_pw_kernel_equivalence(void) {
+    section("fuel_pw_kernel: equivalência ±1 µs com fuel_calc (main + cauda)");
+
+    const uint16_t saved_baro = fuel_get_baro_bar_x100();
+    g_kern_lcg = 12345u;
+    uint32_t max_main = 0u, max_tail = 0u, stage_mismatch = 0u, bd_mismatch = 0u;
+    for (uint32_t i = 0u; i < 20000u; ++i) {
+        // 2-slope e baro variam a meio da varredura → a cache de recíprocos
+        // acompanha a cal (página: invalidação explícita; baro: o setter).
+        if ((i % 5000u) == 0u) {
+            const bool two = ((i / 5000u) & 1u) != 0u;
+            inj_small_pulse_break_us = two ? 1000u : 0u;
+            inj_small_pulse_rate_q8  = two ? 128u : 0u;
+            fuel_pw_kernel_invalidate();
+            fuel_set_baro_bar_x100((i < 10000u) ? 101u : 72u);
+        }
+        const FuelOperatingPoint op = {
+            static_cast<uint8_t>(kern_rand(0u, 255u)),
+            static_cast<uint16_t>(kern_rand(10u, 310u)),
+            static_cast<uint16_t>(kern_rand(600u, 1250u)),
+            static_cast<int16_t>(static_cast<int32_t>(kern_rand(0u, 1200u)) - 600)};
+        const uint16_t c_clt = static_cast<uint16_t>(kern_rand(32u, 600u));
+        const uint16_t c_iat = static_cast<uint16_t>(kern_rand(200u, 320u));
+        const uint16_t dead  = static_cast<uint16_t>(kern_rand(0u, 1500u));
+        const uint16_t press = static_cast<uint16_t>((kern_rand(0u, 3u) == 0u) ? 0u
+                             : kern_rand(1500u, 5000u));
+        const FuelSensorSnapshot snap =
+            fuel_pw_kernel_snapshot(c_clt, c_iat, dead, press, op.map_bar_x100);
+
+        FuelPwBreakdown bd = {};
+        const uint32_t k = fuel_pw_kernel(op, snap, &bd);
+        const uint32_t ref = calc_fuel_pw_us_default_fast(
+            op.ve, op.map_bar_x100, op.lambda_target_x1000, op.trim_pct_x10,
+            c_clt, c_iat, dead);
+        const uint32_t d = abs_diff_u32(k, ref);
+        if (d > max_main) { max_main = d; }
+        if (bd.final_pw_us != k) { ++bd_mismatch; }
+        // Estágios intermédios = funções individuais sobre o estágio anterior.
+        if (bd.lambda_pw_us != 0u &&
+            (bd.lambda_pw_us != apply_lambda_target_pw_us(bd.base_pw_us, op.lambda_target_x1000) ||
+             bd.trimmed_pw_us != apply_fuel_trim_pw_us(bd.lambda_pw_us, op.trim_pct_x10))) {
+            ++stage_mismatch;
+        }
+        if (bd.trimmed_pw_us != 0u &&
+            bd.final_pw_us != calc_final_pw_us(bd.trimmed_pw_us, c_clt, c_iat, dead)) {
+            ++stage_mismatch;
+        }
+
+        // Cauda: fluxo transitório arbitrário (cobre a zona S-curve < 1500 µs).
+        const uint32_t flow = (kern_rand(0u, 1u) == 0u) ? kern_rand(0u, 1600u)
+                                                        : kern_rand(0u, 60000u);
+        const uint32_t kt = fuel_pw_kernel_injector(flow, snap, &bd);
+        const uint32_t sc = apply_injector_scurve(
+            apply_delta_p_compensation(flow, press, op.map_bar_x100));
+        const uint32_t rt = (sc > 0u) ? sc + dead : 0u;
+        const uint32_t dt = abs_diff_u32(kt, rt);
+        if (dt > max_tail) { max_tail = dt; }
+        if (bd.inj_pw_us != kt || bd.scurve_pw_us != sc) { ++bd_mismatch; }
+    }
+    CHECK_TRUE(max_main <= 1u, "kernel principal = calc_fuel_pw_us_default_fast (±1 µs)");
+    CHECK_TRUE(max_tail <= 1u, "cauda ΔP/S-curve = apply_delta_p + apply_scurve (±1 µs)");
+    CHECK_EQ(stage_mismatch, 0u, "estágios do breakdown = funções individuais");
+    CHECK_EQ(bd_mismatch, 0u, "breakdown coerente com o valor devolvido");
+
+    // Eixo S-curve mexido em runtime: invalidação refaz os spans.
+    const uint16_t saved_axis = injector_scurve_pw_axis_us[6];
+    injector_scurve_pw_axis_us[6] = 1300u;
+    fuel_pw_kernel_invalidate();
+    const FuelSensorSnapshot s0 = fuel_pw_kernel_snapshot(256u, 256u, 0u, 0u, 100u);
+    uint32_t max_axis = 0u;
+    for (uint32_t f = 1000u; f < 1600u; f += 7u) {
+        const uint32_t d = abs_diff_u32(fuel_pw_kernel_injector(f, s0, nullptr),
+                                        apply_injector_scurve(
+                                            apply_delta_p_compensation(f, 0u, 100u)));
+        if (d > max_axis) { max_axis = d; }
+    }
+    injector_scurve_pw_axis_us[6] = saved_axis;
+    fuel_pw_kernel_invalidate();
+    CHECK_TRUE(max_axis <= 1u, "eixo S-curve alterado → recíprocos refeitos (±1 µs)");
+
+    CHECK_EQ(fuel_pw_kernel_injector(0u, s0, nullptr), 0u,
+             "fluxo 0 → PW 0 (sem dead-time fantasma)");
+
+    inj_small_pulse_break_us = 0u;
+    inj_small_pulse_rate_q8  = 0u;
+    fuel_pw_kernel_invalidate();
+    fuel_set_baro_bar_x100(saved_baro);
+
+    section("fuel_pw_kernel: invalidação pelos escritores da calibração");
+    FuelPwBreakdown bd = {};
+    const FuelOperatingPoint op = {80u, 100u, 1000u, 0};
+    const FuelSensorSnapshot sn = fuel_pw_kernel_snapshot(256u, 256u, 0u, 0u, 100u);
+    static_cast<void>(fuel_pw_kernel(op, sn, &bd));
+    const uint32_t base_ref = bd.base_pw_us;
+    fuel_set_baro_bar_x100(static_cast<uint16_t>(saved_baro == 80u ? 90u : 80u));
+    static_cast<void>(fuel_pw_kernel(op, sn, &bd));
+    CHECK_TRUE(bd.base_pw_us != base_ref, "fuel_set_baro_bar_x100 invalida 100×baro");
+    fuel_set_baro_bar_x100(saved_baro);
+    static_cast<void>(fuel_pw_kernel(op, sn, &bd));
+    CHECK_EQ(bd.base_pw_us, base_ref, "baro reposto → base de volta");
+    uint8_t page0[256] = {};
+    const uint16_t disp_saved = cfg::g_eng_cfg.displacement_cc;
+    cfg::g_eng_cfg.displacement_cc = static_cast<uint16_t>(disp_saved / 2u);
+    cfg::engine_config_serialize(page0, sizeof(page0));
+    cfg::g_eng_cfg.displacement_cc = disp_saved;
+    cfg::engine_config_load(page0, sizeof(page0));  // página com metade da cilindrada
+    static_cast<void>(fuel_pw_kernel(op, sn, &bd));
+    CHECK_TRUE(bd.base_pw_us < base_ref, "engine_config_load invalida REQ_FUEL");
+    cfg::g_eng_cfg.displacement_cc = disp_saved;
+    fuel_pw_kernel_invalidate();
+}
+
 // ═══════════════════════════════════════════════════════════════════════════
 // IGN CALC — SEGUNDA FASE
 // ═══════════════════════════════════════════════════════════════════════════
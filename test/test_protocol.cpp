@@ -13,6 +13,9 @@
 #include "engine/torque_manager.h"
 #include "engine/calibration.h"
 #include "app/can_rx_map.h"
+#include "app/can_fd_telemetry.h"
+#include "hal/can.h"
+#include "engine/map_window.h"
 #include "hal/adc.h"
 #include "hal/system.h"
 #include "drv/ckp.h"
@@ -22,6 +25,7 @@
 #include "engine/auxiliaries.h"
 #include "engine/knock.h"
 #include "engine/table3d.h"
+#include "engine/table_reaxis.h"
 #include "engine/ecu_sched.h"
 #include "engine/quick_crank.h"
 #include "engine/transient_fuel.h"
@@ -33,6 +37,7 @@
 #include "engine/engine_config.h"
 #include "hal/timer.h"
 #include "hal/flash.h"
+#include "hal/flash_jobs.h"
 #include "app/ui_protocol.h"
 #include "app/status_bits.h"
 #include "hal/crc32.h"
@@ -173,11 +178,20 @@ void test_ts_envelope_read_write_burn(void) {
     const uint8_t burn[2] = {'b', 0x01u};
     r = env_txn(burn, 2u);
     CHECK_TRUE(r.frame_ok && r.code == 0x00u, "'b' page1 @ 0 RPM → OK");
+    CHECK_EQ(ems::hal::nvm_test_program_count(), prog_before,
+             "burn enfileirado: resposta sem esperar a flash");
+    CHECK_TRUE(ems::hal::flash_jobs_drain(100000u), "fila de flash drenada");
     CHECK_EQ(ems::hal::nvm_test_program_count(), prog_before + 1u,
              "burn gravou 1 página");
 
     r = env_txn(&d, 1u);
     CHECK_TRUE(r.frame_ok && (r.data[0] & 0x01u) == 0u, "dirty limpo após burn");
+
+    // Re-envio do mesmo chunk: diff página ↔ VE vazio → nada a marcar.
+    r = env_txn(wr, 10u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x00u, "'w' repetido → OK");
+    r = env_txn(&d, 1u);
+    CHECK_TRUE(r.frame_ok && (r.data[0] & 0x01u) == 0u, "'w' sem mudança não suja a página");
 }
 
 void test_eoi_blend_page0_roundtrip(void) {
@@ -215,7 +229,9 @@ void test_eoi_blend_page0_roundtrip(void) {
 }
 
 void test_ts_envelope_burn_gate(void) {
-    section("envelope TS: burn bloqueado com motor girando");
+    section("envelope TS: burn bloqueado com motor girando até a 1ª operação");
+    ckp_test_reset(); g_ckp_cap = 0u;
+    ems::hal::nvm_test_reset();  // flash ainda não escrita desde o "reset"
     ems::app::ui_test_reset();
     ckp_reach_full_sync();  // ~6250 RPM > kFlashWriteSafeRpmX10 (300 RPM)
 
@@ -231,10 +247,112 @@ void test_ts_envelope_burn_gate(void) {
     ui_feed(lb, 2u);
     const uint16_t n = ui_drain(buf, sizeof(buf));
     CHECK_TRUE(n == 1u && buf[0] == 0x01u, "legacy 'b' com RPM alto → NACK");
+    CHECK_FALSE(ems::hal::flash_jobs_primed(), "nenhuma operação de flash ainda");
+
+    // Primeira operação com o motor parado: daí em diante a errata não se
+    // aplica e o burn é aceito a qualquer RPM.
+    ckp_test_reset(); g_ckp_cap = 0u;
+    r = env_txn(burn, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x00u, "'b' @ 0 RPM → OK");
+    CHECK_TRUE(ems::hal::flash_jobs_drain(100000u), "primeiro burn gravado");
+    CHECK_TRUE(ems::hal::flash_jobs_primed(), "1ª operação pós-reset concluída");
+    ckp_reach_full_sync();
+    r = env_txn(burn, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x00u, "'b' com RPM alto após a 1ª operação → OK");
+    CHECK_TRUE(ems::hal::flash_jobs_drain(100000u), "burn em rotação gravado");
+    ui_feed(lb, 2u);
+    const uint16_t n2 = ui_drain(buf, sizeof(buf));
+    CHECK_TRUE(n2 == 1u && buf[0] == 0x00u, "legacy 'b' com RPM alto → ACK");
+    CHECK_TRUE(ems::hal::flash_jobs_drain(100000u), "burn legacy gravado");
 
     ckp_test_reset(); g_ckp_cap = 0u;  // restaura RPM=0 p/ testes seguintes
 }
 
+void test_ts_envelope_rollback(void) {
+    section("envelope TS: 'U' rollback da página para o burn anterior");
+    ckp_test_reset(); g_ckp_cap = 0u;
+    ems::hal::nvm_test_reset();
+    ems::app::ui_test_reset();
+
+    const uint8_t burn[2] = {'b', 0x01u};
+    const uint8_t rb[2]   = {'U', 0x01u};
+    EnvResp r = env_txn(rb, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x84u, "'U' sem burns → 0x84");
+
+    const uint8_t w1[7] = {'w', 0x01u, 0x00u, 0x00u, 0x01u, 0x00u, 11u};
+    r = env_txn(w1, 7u);
+    r = env_txn(burn, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x00u, "burn 1 (VE[0][0]=11) → OK");
+    CHECK_TRUE(ems::hal::flash_jobs_drain(100000u), "burn 1 gravado");
+    const uint8_t w2[7] = {'w', 0x01u, 0x00u, 0x00u, 0x01u, 0x00u, 22u};
+    r = env_txn(w2, 7u);
+    r = env_txn(burn, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x00u, "burn 2 (VE[0][0]=22) → OK");
+    CHECK_TRUE(ems::hal::flash_jobs_drain(100000u), "burn 2 gravado");
+    CHECK_EQ(ve_table[0][0], 22u, "RAM com o burn 2");
+
+    r = env_txn(rb, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x00u, "'U' page1 → OK (enfileirado)");
+    CHECK_EQ(ve_table[0][0], 22u, "globals intocados até o job concluir");
+    CHECK_TRUE(ems::hal::flash_jobs_drain(100000u), "rollback gravado");
+    CHECK_EQ(ve_table[0][0], 11u, "VE de volta ao burn 1");
+    CHECK_FALSE(ems::app::ui_take_page0_reload(), "rollback de outra página: page0 intacto");
+    const uint8_t d = 'd';
+    r = env_txn(&d, 1u);
+    CHECK_TRUE(r.frame_ok && (r.data[0] & 0x01u) == 0u, "página limpa: RAM == flash");
+    uint8_t nvm[4] = {};
+    CHECK_TRUE(ems::hal::nvm_load_calibration(1u, nvm, sizeof(nvm)) && nvm[0] == 11u,
+               "boot seguinte lê o burn 1");
+
+    r = env_txn(rb, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x84u, "segundo 'U' → 0x84 (um só nível)");
+    const uint8_t rb3[2] = {'U', 0x03u};
+    r = env_txn(rb3, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x84u, "'U' página realtime → 0x84");
+
+    // legacy 'U': mesmo caminho, ACK/NACK de 1 byte
+    uint8_t buf[8] = {};
+    ui_feed(rb, 2u);
+    uint16_t n = ui_drain(buf, sizeof(buf));
+    CHECK_TRUE(n == 1u && buf[0] == 0x01u, "legacy 'U' sem cópia anterior → NACK");
+    r = env_txn(w2, 7u);
+    r = env_txn(burn, 2u);
+    static_cast<void>(ems::hal::flash_jobs_drain(100000u));
+    // Flash já escrita desde o reset: rollback aceito com o motor girando.
+    ckp_reach_full_sync();
+    ui_feed(rb, 2u);
+    n = ui_drain(buf, sizeof(buf));
+    CHECK_TRUE(n == 1u && buf[0] == 0x00u, "legacy 'U' com RPM alto → ACK");
+    static_cast<void>(ems::hal::flash_jobs_drain(100000u));
+    CHECK_EQ(ve_table[0][0], 11u, "legacy 'U' repôs o burn 1");
+    ckp_test_reset(); g_ckp_cap = 0u;
+
+    // Page0: o main guarda a sua imagem — o rollback pede-lhe o reload.
+    const uint8_t burn0[2] = {'b', 0x00u};
+    const uint8_t rb0[2]   = {'U', 0x00u};
+    const uint8_t cl_on[7]  = {'w', 0x00u, 80u, 0x00u, 0x01u, 0x00u, 1u};
+    const uint8_t cl_off[7] = {'w', 0x00u, 80u, 0x00u, 0x01u, 0x00u, 0u};
+    const uint8_t rd0[6] = {'r', 0x00u, 80u, 0x00u, 0x01u, 0x00u};
+    const uint8_t cl_keep = ems::engine::closed_loop_enable;
+    r = env_txn(rd0, 6u);  // serializa os globals vivos no buffer da página
+    r = env_txn(cl_off, 7u);
+    r = env_txn(burn0, 2u);
+    static_cast<void>(ems::hal::flash_jobs_drain(100000u));
+    r = env_txn(cl_on, 7u);
+    r = env_txn(burn0, 2u);
+    static_cast<void>(ems::hal::flash_jobs_drain(100000u));
+    CHECK_EQ(ems::engine::closed_loop_enable, 1u, "page0 burn 2 aplicado");
+    CHECK_FALSE(ems::app::ui_take_page0_reload(), "burn não pede reload");
+    r = env_txn(rb0, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x00u, "'U' page0 → OK");
+    CHECK_FALSE(ems::app::ui_take_page0_reload(), "reload só após o job concluir");
+    static_cast<void>(ems::hal::flash_jobs_drain(100000u));
+    CHECK_EQ(ems::engine::closed_loop_enable, 0u, "page0 de volta ao burn 1");
+    CHECK_TRUE(ems::app::ui_take_page0_reload(), "rollback do page0 → reload pedido");
+    CHECK_FALSE(ems::app::ui_take_page0_reload(), "pedido consumido");
+    ems::engine::closed_loop_enable = cl_keep;
+}
+
 void test_ts_axes_page(void) {
     section("página 11: eixos de tabela editáveis");
     ckp_test_reset(); g_ckp_cap = 0u;
@@ -259,10 +377,40 @@ void test_ts_axes_page(void) {
         wr[6u + 40u + i * 2u] = static_cast<uint8_t>(lv & 0xFFu);
         wr[7u + 40u + i * 2u] = static_cast<uint8_t>(lv >> 8u);
     }
+    // Tabelas re-amostradas pelo job — guardadas para repor no fim.
+    static uint8_t ve_saved[sizeof(ve_table)];
+    static int8_t  spark_saved[sizeof(spark_table)];
+    static int16_t lambda_saved[kTableCells];
+    std::memcpy(ve_saved, ve_table, sizeof(ve_saved));
+    std::memcpy(spark_saved, spark_table, sizeof(spark_saved));
+    std::memcpy(lambda_saved, lambda_target_table_x1000, sizeof(lambda_saved));
+    // (1200 RPM, 0.40 bar) é o nó [load 3][rpm 2] da grelha nova e cai entre
+    // nós da antiga — o valor re-amostrado é a bilinear da VE antiga.
+    const uint8_t ve_at_1200_040 = table3d_lookup_u8(ve_table, kRpmAxisX10,
+                                                     kLoadAxisBarX100, 12000u, 40u);
+
     r = env_txn(wr, sizeof(wr));
     CHECK_TRUE(r.frame_ok && r.code == 0x00u, "'w' eixos monotónicos → OK");
+    CHECK_EQ(kRpmAxisX10[0], 5000u, "eixos só mudam no commit do job");
+    r = env_txn(rd, 6u);
+    CHECK_EQ(static_cast<uint16_t>(r.data[0] | (r.data[1] << 8u)), 400u,
+             "'r' com re-eixo pendente devolve os eixos escritos");
+    uint16_t steps = 0u;
+    while (table_reaxis_pending() && steps < 1000u) {
+        ems::app::ui_process();
+        ++steps;
+    }
+    CHECK_TRUE(!table_reaxis_pending() &&
+               steps >= kReaxisSettleCalls && steps < kReaxisSettleCalls + 10u,
+               "re-eixo: settle + ~5 passos de fundo");
     CHECK_EQ(kRpmAxisX10[0], 4000u, "kRpmAxisX10[0]=4000 (400 RPM ×10)");
     CHECK_EQ(kLoadAxisBarX100[19], 200u, "kLoadAxisBarX100[19]=200");
+    CHECK_TRUE(std::abs(static_cast<int>(ve_table[3][2]) - ve_at_1200_040) <= 1,
+               "VE re-amostrada: nó novo (1200, 0.40) = bilinear da grelha antiga");
+    const uint8_t dq[1] = {'d'};
+    r = env_txn(dq, 1u);
+    CHECK_TRUE(r.len == 2u && (r.data[0] & 0x07u) == 0x07u && (r.data[1] & 0x01u) != 0u,
+               "commit marca dirty VE/spark/lambda/eixos");
 
     // write não-monotónico rejeitado, eixos preservados
     wr[6u + 4u] = wr[6u + 0u];  // rpm[2] == rpm[0] → viola monotonicidade
@@ -276,12 +424,27 @@ void test_ts_axes_page(void) {
     const uint16_t rpm2 = static_cast<uint16_t>(r.data[4] | (r.data[5] << 8u));
     CHECK_EQ(rpm2, 1200u, "'r' pós-rejeição devolve eixo válido (1200)");
 
-    // burn página 11 → NVM slot 9
+    // Grupo precisa dos 4 slots da fila: com um job à espera é recusado
+    // inteiro e as quatro páginas continuam dirty.
     const uint32_t prog_before = ems::hal::nvm_test_program_count();
     const uint8_t burn[2] = {'b', 0x0Bu};
+    static const uint8_t filler[16] = {};
+    CHECK_TRUE(ems::hal::flash_jobs_submit_burn(30u, filler, sizeof(filler), nullptr, nullptr),
+               "job alheio na fila");
+    r = env_txn(burn, 2u);
+    CHECK_TRUE(r.frame_ok && r.code != 0x00u, "'b' page11 sem 4 slots → erro");
+    r = env_txn(dq, 1u);
+    CHECK_TRUE((r.data[0] & 0x07u) == 0x07u && (r.data[1] & 0x01u) != 0u,
+               "grupo inteiro continua dirty");
+    static_cast<void>(ems::hal::flash_jobs_drain(100000u));
+    CHECK_EQ(ems::hal::nvm_test_program_count(), prog_before, "nenhum membro gravado");
+
+    // burn página 11 → NVM slot 9, com as tabelas re-amostradas (1, 2, 3)
     r = env_txn(burn, 2u);
     CHECK_TRUE(r.frame_ok && r.code == 0x00u, "'b' page11 → OK");
-    CHECK_EQ(ems::hal::nvm_test_program_count(), prog_before + 1u, "NVM slot 9 gravado");
+    static_cast<void>(ems::hal::flash_jobs_drain(100000u));
+    CHECK_EQ(ems::hal::nvm_test_program_count(), prog_before + 4u,
+             "NVM slot 9 gravado junto com VE/spark/lambda");
 
     // restaura defaults p/ não afetar outros testes
     const uint16_t rpm_def[20] = {500u, 750u, 1000u, 1250u, 1500u, 1750u, 2000u,
@@ -291,6 +454,90 @@ void test_ts_axes_page(void) {
                                    94u, 100u, 110u, 130u, 160u, 190u, 220u, 250u,
                                    273u, 300u};
     CHECK_TRUE(table_axes_set(rpm_def, load_def), "defaults restaurados");
+    std::memcpy(ve_table, ve_saved, sizeof(ve_saved));
+    std::memcpy(spark_table, spark_saved, sizeof(spark_saved));
+    std::memcpy(lambda_target_table_x1000, lambda_saved, sizeof(lambda_saved));
+    fuel_reset_ltft();
+}
+
+void test_ts_axes_rollback(void) {
+    section("página 11: rollback leva eixos + tabelas sem re-amostrar");
+    ckp_test_reset(); g_ckp_cap = 0u;
+    ems::hal::nvm_test_reset();
+    ems::app::ui_test_reset();
+    static uint8_t ve_saved[sizeof(ve_table)];
+    static int8_t  spark_saved[sizeof(spark_table)];
+    static int16_t lambda_saved[kTableCells];
+    std::memcpy(ve_saved, ve_table, sizeof(ve_saved));
+    std::memcpy(spark_saved, spark_table, sizeof(spark_saved));
+    std::memcpy(lambda_saved, lambda_target_table_x1000, sizeof(lambda_saved));
+    uint16_t rpm_def[20];
+    uint16_t load_def[20];
+    table_axes_get(rpm_def, load_def);
+
+    const uint8_t burn11[2] = {'b', 0x0Bu};
+    const uint8_t rb1[2]  = {'U', 0x01u};
+    const uint8_t rb11[2] = {'U', 0x0Bu};
+    EnvResp r = env_txn(burn11, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x00u && ems::hal::flash_jobs_drain(100000u),
+               "grupo 1 (eixos default) gravado");
+
+    uint8_t wr[6u + 80u] = {'w', 0x0Bu, 0x00u, 0x00u, 0x50u, 0x00u};
+    for (uint8_t i = 0u; i < 20u; ++i) {
+        const uint16_t rv = static_cast<uint16_t>(450u + i * 370u);
+        const uint16_t lv = static_cast<uint16_t>(15u + i * 14u);
+        wr[6u + i * 2u]       = static_cast<uint8_t>(rv & 0xFFu);
+        wr[7u + i * 2u]       = static_cast<uint8_t>(rv >> 8u);
+        wr[6u + 40u + i * 2u] = static_cast<uint8_t>(lv & 0xFFu);
+        wr[7u + 40u + i * 2u] = static_cast<uint8_t>(lv >> 8u);
+    }
+    r = env_txn(wr, sizeof(wr));
+    for (uint16_t i = 0u; table_reaxis_pending() && i < 1000u; ++i) { ems::app::ui_process(); }
+    CHECK_EQ(kRpmAxisX10[0], 4500u, "re-eixo publicado");
+    r = env_txn(rb1, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x84u, "'U' VE com o grupo por gravar → 0x84");
+    r = env_txn(burn11, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x00u && ems::hal::flash_jobs_drain(100000u),
+               "grupo 2 (eixos novos) gravado");
+    r = env_txn(rb1, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x84u,
+               "'U' VE sozinha para a grelha antiga → 0x84");
+
+    r = env_txn(rb11, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x00u && ems::hal::flash_jobs_drain(100000u),
+               "'U' página 11 → OK");
+    CHECK_EQ(kRpmAxisX10[0], 4500u, "eixos só mudam no commit do job");
+    r = env_txn(burn11, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x84u, "burn do grupo recusado durante o restauro");
+    for (uint16_t i = 0u; table_reaxis_pending() && i < 1000u; ++i) { ems::app::ui_process(); }
+    uint16_t rpm_now[20];
+    uint16_t load_now[20];
+    table_axes_get(rpm_now, load_now);
+    CHECK_TRUE(std::memcmp(rpm_now, rpm_def, sizeof(rpm_now)) == 0 &&
+               std::memcmp(load_now, load_def, sizeof(load_now)) == 0, "eixos do grupo 1");
+    CHECK_TRUE(std::memcmp(ve_table, ve_saved, sizeof(ve_saved)) == 0 &&
+               std::memcmp(spark_table, spark_saved, sizeof(spark_saved)) == 0 &&
+               std::memcmp(lambda_target_table_x1000, lambda_saved, sizeof(lambda_saved)) == 0,
+               "tabelas exactas do grupo 1 (sem ida e volta pela re-amostragem)");
+    const uint8_t dq[1] = {'d'};
+    r = env_txn(dq, 1u);
+    CHECK_TRUE(r.len == 2u && (r.data[0] & 0x07u) == 0u && (r.data[1] & 0x01u) == 0u,
+               "grupo limpo: RAM == flash");
+
+    // Burn isolado da VE sobre os mesmos eixos: o rollback dela é legítimo.
+    const uint8_t ve_g1 = ve_table[0][0];
+    const uint8_t w1[7] = {'w', 0x01u, 0x00u, 0x00u, 0x01u, 0x00u,
+                           static_cast<uint8_t>(ve_g1 + 1u)};
+    const uint8_t burn1[2] = {'b', 0x01u};
+    r = env_txn(w1, 7u);
+    r = env_txn(burn1, 2u);
+    static_cast<void>(ems::hal::flash_jobs_drain(100000u));
+    r = env_txn(rb1, 2u);
+    CHECK_TRUE(r.frame_ok && r.code == 0x00u && ems::hal::flash_jobs_drain(100000u),
+               "'U' VE sobre os mesmos eixos → OK");
+    CHECK_EQ(ve_table[0][0], ve_g1, "VE de volta ao grupo 1");
+
+    fuel_reset_ltft();
 }
 
 void test_ts_whole_page_800(void) {
@@ -319,6 +566,46 @@ void test_ts_whole_page_800(void) {
     CHECK_EQ(r.data[399], ems::engine::ve_table[19][19], "VE[19][19] confere");
 }
 
+void test_ui_sessions_per_port(void) {
+    section("sessões por transporte: UART e USB independentes");
+    ckp_test_reset(); g_ckp_cap = 0u;
+    ems::app::ui_test_reset();
+    using ems::app::UiPort;
+
+    // UART a meio de um envelope ('S'): só o header + metade do CRC chegou.
+    static uint8_t frame[64];
+    const uint8_t s_cmd[1] = {'S'};
+    const uint16_t fl = env_frame(frame, s_cmd, 1u);
+    ui_feed(frame, static_cast<uint16_t>(fl - 2u), UiPort::kUart);
+
+    // USB: página inteira de 800 B numa transacção, sem tocar no parser UART.
+    const uint8_t rd[6] = {'r', 0x04u, 0x00u, 0x00u, 0x20u, 0x03u};
+    EnvResp r = env_txn(rd, 6u, UiPort::kUsb);
+    CHECK_TRUE(r.frame_ok && r.crc_ok && r.code == 0x00u && r.len == 800u,
+               "USB 'r' 800B completo com UART a meio de um frame");
+    CHECK_EQ(ems::app::ui_tx_available(UiPort::kUart), 0u, "resposta USB não vai para a UART");
+
+    // UART termina o seu frame: o parser dela continuou onde estava.
+    ui_feed(frame + fl - 2u, 2u, UiPort::kUart);
+    uint8_t buf[64] = {};
+    const uint16_t n = ui_drain(buf, sizeof(buf), UiPort::kUart);
+    const uint16_t psize = static_cast<uint16_t>((buf[0] << 8u) | buf[1]);
+    CHECK_TRUE(n == psize + 6u && buf[2] == 0x00u &&
+               std::memcmp(buf + 3, "OpenEMS_fw", 10u) == 0,
+               "UART recebe a versão ('S') do seu próprio envelope");
+    CHECK_EQ(ems::app::ui_tx_available(UiPort::kUsb), 0u, "resposta UART não vai para o USB");
+
+    // Modo por sessão: comando legado cru na UART com o USB em envelope.
+    const uint8_t q = 'Q';
+    ui_feed(&q, 1u, UiPort::kUart);
+    const uint16_t nq = ui_drain(buf, sizeof(buf), UiPort::kUart);
+    CHECK_TRUE(nq == 12u && std::memcmp(buf, "OpenEMS_v1.3", 12u) == 0,
+               "UART legado 'Q' → assinatura crua");
+    const uint8_t f_cmd[1] = {'F'};
+    r = env_txn(f_cmd, 1u, UiPort::kUsb);
+    CHECK_TRUE(r.frame_ok && r.crc_ok && r.len == 3u, "USB continua em envelope ('F')");
+}
+
 void test_adaptives_reset_cmd_z(void) {
     section("protocolo: 'Z' learn session reset (STFT+accum+LTFT shadow)");
     ckp_test_reset(); g_ckp_cap = 0u;
@@ -401,6 +688,48 @@ void test_ltft_apply_cmd_y(void) {
     fuel_ltft_accum_reset();
 }
 
+void test_stored_dtc_cmds(void) {
+    section("protocolo: 'E' lê / 'e' apaga a memória de DTCs");
+    ckp_test_reset(); g_ckp_cap = 0u;
+    ems::hal::nvm_test_reset();
+    ems::app::ui_test_reset();
+    DiagnosticManager::init();
+    DiagnosticManager::set_live_value(FreezeVar::RPM_X10, 31000u);
+    DiagnosticManager::report_fault(DiagnosticCode::OVERTEMP_WARNING, FaultSeverity::WARNING);
+    DiagnosticManager::report_fault(DiagnosticCode::FUEL_PRESS_LOW, FaultSeverity::WARNING);
+
+    static uint8_t buf[400];
+    const uint8_t e = 'E';
+    ui_feed(&e, 1u);
+    uint16_t n = ui_drain(buf, sizeof(buf));
+    constexpr uint16_t kDtcResp = 1u + DiagnosticManager::kMaxStoredDtcs * sizeof(StoredDtc);
+    CHECK_EQ(n, kDtcResp, "'E' → 1 + 10×36 B");
+    CHECK_EQ(buf[0], 2u, "2 DTCs guardados");
+    StoredDtc e0{};
+    memcpy(&e0, buf + 1, sizeof(e0));
+    CHECK_EQ(e0.code, static_cast<uint16_t>(DiagnosticCode::OVERTEMP_WARNING), "entrada 0 = código");
+    CHECK_EQ(e0.occurrences, 1u, "entrada 0 = 1 activação");
+    CHECK_EQ(e0.freeze_frame[0], 31000u, "freeze frame no wire");
+    bool tail_zero = true;
+    for (uint16_t i = 1u + 2u * sizeof(StoredDtc); i < kDtcResp; ++i) {
+        tail_zero = tail_zero && (buf[i] == 0u);
+    }
+    CHECK_TRUE(tail_zero, "entradas livres a zeros");
+
+    const uint8_t clr = 'e';
+    ui_feed(&clr, 1u);
+    n = ui_drain(buf, sizeof(buf));
+    CHECK_TRUE(n == 1u && buf[0] == 0x00u, "'e' → ACK");
+    CHECK_EQ(DiagnosticManager::get_stored_dtc_count(), 0u, "memória vazia");
+    CHECK_TRUE(DiagnosticManager::is_fault_active(DiagnosticCode::OVERTEMP_WARNING),
+               "falha activa não é limpa");
+    ui_feed(&e, 1u);
+    n = ui_drain(buf, sizeof(buf));
+    CHECK_TRUE(n == kDtcResp && buf[0] == 0u, "'E' após 'e' → count 0");
+    DiagnosticManager::init();
+    ems::hal::nvm_test_reset();
+}
+
 // Regressão: hit LEARN na célula dominante do trace VE (não no canto floor).
 // Em 2000 rpm / 110 kPa exactos, floor = (1750,100) e nearest = (2000,110).
 void test_ltft_hit_matches_ve_dominant_cell(void) {
@@ -534,6 +863,7 @@ void test_ts_envelope_canid_forms(void) {
     const uint8_t burn[3] = {'b', 0x00u, 0x01u};
     r = env_txn(burn, 3u);
     CHECK_TRUE(r.frame_ok && r.code == 0x00u, "'b' canId+page → OK");
+    static_cast<void>(ems::hal::flash_jobs_drain(100000u));
     CHECK_EQ(ems::hal::nvm_test_program_count(), prog_before + 1u,
              "burn (forma canId) gravou 1 página");
 
@@ -651,3 +981,122 @@ void test_ts_envelope_signature_via_r(void) {
     CHECK_TRUE(r.frame_ok && r.code == 0x00u && r.len == 12u,
                "'r' page 0x0F sem canId → também OK");
 }
+
+void test_can_fd_telemetry_cycle_frame(void) {
+    section("CAN FD: DLC FD ↔ bytes");
+    CHECK_EQ(ems::hal::can_fd_len_to_dlc(8u), 8u, "8 B → DLC 8");
+    CHECK_EQ(ems::hal::can_fd_len_to_dlc(9u), 9u, "9 B → DLC 9 (12 B)");
+    CHECK_EQ(ems::hal::can_fd_len_to_dlc(64u), 15u, "64 B → DLC 15");
+    CHECK_EQ(ems::hal::can_fd_dlc_to_len(14u), 48u, "DLC 14 → 48 B");
+
+    section("CAN FD: telemetria 0x410 por ciclo de 720°");
+    ems::hal::can_test_reset();
+    ems::app::can_fd_telemetry_test_reset();
+    ecu_sched_test_reset();
+    misfire_init();
+    knock_init();
+    map_window_reset();
+
+    CkpSnapshot s{};
+    s.state = SyncState::FULL_SYNC;
+    s.rpm_x10 = 30000u;
+
+    // Modo clássico (default): nenhum frame FD, FDCAN fica sem FD.
+    ems::engine::can_fd_telemetry_enable = 0u;
+    ems::app::can_fd_telemetry_init();
+    s.tooth_index = 50u; s.phase_A = false;
+    ems::app::can_fd_telemetry_process(s);
+    s.tooth_index = 1u;  s.phase_A = true;
+    ems::app::can_fd_telemetry_process(s);
+    CHECK_EQ(ems::hal::can_test_fd_tx_count(), 0u, "enable=0: sem TX FD");
+    CHECK_TRUE(!ems::hal::can0_fd_enabled(), "enable=0: FDCAN clássico");
+
+    // Janela de misfire completa no cil 0 (TDC tooth 0, phase_A) e pico de knock no cil 1.
+    CkpSnapshot mf = s;
+    mf.tooth_index = 0u; mf.phase_A = true;
+    mf.tooth_period_ns = 2000000u; mf.predicted_tooth_period_ns = 1000000u;
+    for (uint8_t t = 0u; t < kMisfireWindowTeeth; ++t) { misfire_on_tooth(mf); }
+    knock_window_open(1u);
+    knock_test_set_adc_raw(1234u);
+    knock_test_set_adc_raw(3000u);
+    knock_window_cycle_end();
+    knock_process();
+
+    ems::engine::can_fd_telemetry_enable = 1u;
+    s.tooth_index = 50u; s.phase_A = false;
+    ems::app::can_fd_telemetry_process(s);     // liga FD; 1ª amostra só arma o wrap
+    CHECK_TRUE(ems::hal::can0_fd_enabled(), "enable=1: FD ligado no process");
+    s.tooth_index = 1u; s.phase_A = false;     // wrap para phase B: meio ciclo
+    ems::app::can_fd_telemetry_process(s);
+    CHECK_EQ(ems::hal::can_test_fd_tx_count(), 0u, "wrap para phase_B: sem frame");
+    s.tooth_index = 40u;
+    ems::app::can_fd_telemetry_process(s);
+    s.tooth_index = 2u; s.phase_A = true;      // fecho do ciclo 720°
+    ems::app::can_fd_telemetry_process(s);
+    CHECK_EQ(ems::hal::can_test_fd_tx_count(), 1u, "1 frame por ciclo");
+
+    CanFdFrame f{};
+    CHECK_TRUE(ems::hal::can_test_pop_tx_fd(f), "frame FD capturado");
+    CHECK_EQ(f.id, 0x410u, "id 0x410");
+    CHECK_EQ(f.len, 64u, "payload 64 B");
+    CHECK_TRUE(f.brs, "bit-rate switch");
+    CHECK_EQ(f.data[0] | (f.data[1] << 8), 0u, "seq 0 no 1º frame");
+    CHECK_EQ(f.data[2] | (f.data[3] << 8), 3000u, "rpm");
+    CHECK_EQ(f.data[4] & 0x01u, 0x01u, "flag phase_A");
+    CHECK_EQ(f.data[5], 4u, "4 cilindros");
+    CHECK_EQ(f.data[6] | (f.data[7] << 8), 20000u, "misfire cil0 power = 10×2 ms");
+    CHECK_EQ(f.data[8] | (f.data[9] << 8), 10000u, "misfire cil0 pred = 10×1 ms");
+    CHECK_EQ(f.data[24] | (f.data[25] << 8), 3000u, "knock pico cil1");
+    CHECK_EQ(ems::app::can_fd_telemetry_seq(), 1u, "seq avança após TX");
+
+    section("CAN FD: histórico de knock 0x411 a cada 8 ciclos");
+    for (uint8_t cyc = 1u; cyc < ems::app::kCanFdKnockHistEvery; ++cyc) {
+        s.tooth_index = 40u; s.phase_A = true;
+        ems::app::can_fd_telemetry_process(s);
+        s.tooth_index = 2u;
+        ems::app::can_fd_telemetry_process(s);
+        CHECK_TRUE(ems::hal::can_test_pop_tx_fd(f) && f.id == 0x410u,
+                   "ciclos 2..8: só 0x410 no slot do wrap");
+    }
+    CHECK_EQ(ems::app::can_fd_telemetry_seq(), 8u, "8 frames de ciclo");
+    s.tooth_index = 3u;                        // slot seguinte, sem wrap
+    ems::app::can_fd_telemetry_process(s);
+    CHECK_TRUE(ems::hal::can_test_pop_tx_fd(f), "0x411 no slot seguinte ao 8.º ciclo");
+    CHECK_EQ(f.id, 0x411u, "id 0x411");
+    CHECK_EQ(f.len, 64u, "payload 64 B");
+    CHECK_EQ(f.data[0] | (f.data[1] << 8), 7u, "seq do último 0x410");
+    CHECK_EQ(f.data[3], ems::app::kCanFdKnockHistEntries, "entradas por bloco");
+    const uint8_t* blk1 = f.data + 4u + 1u * (1u + ems::app::kCanFdKnockHistEntries);
+    CHECK_EQ(blk1[0], 1u, "cil. 1: 1 janela fechada");
+    CHECK_EQ(blk1[ems::app::kCanFdKnockHistEntries], 8u,
+             "cil. 1: entrada mais recente = 1 amostra / limiar 4 (nível 8)");
+    s.tooth_index = 4u;
+    ems::app::can_fd_telemetry_process(s);
+    CHECK_FALSE(ems::hal::can_test_pop_tx_fd(f), "0x411 uma vez por intervalo");
+
+    // Desligar em runtime volta ao modo clássico.
+    ems::engine::can_fd_telemetry_enable = 0u;
+    ems::app::can_fd_telemetry_process(s);
+    CHECK_TRUE(!ems::hal::can0_fd_enabled(), "enable=0 em runtime: FD desligado");
+
+    // FDCAN recusa o modo (INIT/FDOE sem confirmação): fica clássico e não
+    // volta a passar por INIT a cada slot.
+    ems::hal::can_test_fail_fd_mode(true);
+    ems::engine::can_fd_telemetry_enable = 1u;
+    const uint32_t calls0 = ems::hal::can_test_fd_mode_calls();
+    for (int i = 0; i < 5; ++i) { ems::app::can_fd_telemetry_process(s); }
+    CHECK_TRUE(!ems::hal::can0_fd_enabled(), "modo recusado: continua clássico");
+    CHECK_EQ(ems::hal::can_test_fd_mode_calls() - calls0, 1u, "uma tentativa, sem repetir");
+    CHECK_EQ(ems::hal::can_test_fd_tx_count(), 9u, "sem TX FD com o modo recusado");
+    ems::hal::can_test_fail_fd_mode(false);
+    ems::engine::can_fd_telemetry_enable = 0u;
+    ems::app::can_fd_telemetry_process(s);
+    ems::engine::can_fd_telemetry_enable = 1u;
+    ems::app::can_fd_telemetry_process(s);
+    CHECK_TRUE(ems::hal::can0_fd_enabled(), "nova calibração: nova tentativa aceite");
+    ems::engine::can_fd_telemetry_enable = 0u;
+    ems::app::can_fd_telemetry_process(s);
+    ems::hal::can_test_reset();
+    misfire_reset();
+    knock_init();
+}
@@ -31,6 +31,7 @@
 #include "engine/xtau_autocalib.h"
 #include "engine/output_test.h"
 #include "engine/engine_config.h"
+#include "engine/cyl_pulse.h"
 #include "hal/timer.h"
 #include "hal/flash.h"
 #include "app/ui_protocol.h"
@@ -537,6 +538,158 @@ void test_ecu_sched_eoi_targeting(void) {
     CHECK_EQ(f_on, 85u, "presync 355°: SOI frac=85");
 }
 
+// ── Vector por cilindro (seqlock duplo) ─────────────────────────────────────
+// Mesmo cenário de build_seq_table_with_pw (6° por 10000 ticks, offset 0),
+// mas via commit_calibration_cyl com o vector dado.
+static void build_seq_table_with_vector(const EcuSchedCylVector *vec) {
+    ecu_sched_test_reset();
+    ecu_sched_test_set_tim2_cnt(1000u);
+    ecu_sched_commit_calibration_cyl(15u, 140625u, 200000u, 60u, vec);
+    g_ckp_cap = 0u;
+    ckp_reach_full_sync();
+    ckp_test_set_cmp_confirms(2u);
+    ckp_feed_n_then_gap(55u);
+}
+
+void test_ecu_sched_cyl_vector(void) {
+    uint8_t t = 0u, f = 0u, ph = 0u;
+    EcuSchedCylVector vec{};
+    EcuSchedCylVector rd{};
+    for (uint8_t c = 0u; c < ECU_CYL_COUNT; ++c) {
+        vec.inj_pw_ticks[c] = 200000u;  // 120°
+        vec.advance_deg[c] = 15u;
+    }
+
+    section("ecu_sched cyl vector: publicação seqlock / buffer duplo");
+    ecu_sched_test_reset();
+    CHECK_EQ(ecu_sched_test_read_cyl_vector(&rd), 0u, "sem commit: builder usa escalares");
+    const uint32_t seq0 = ecu_sched_test_get_cyl_vector_seq();
+    ecu_sched_commit_calibration_cyl(15u, 140625u, 200000u, 60u, &vec);
+    CHECK_EQ(ecu_sched_test_get_cyl_vector_seq(), seq0 + 2u,
+             "commit = um só write (vector + escalares no mesmo bloco)");
+    CHECK_EQ(ecu_sched_test_read_cyl_vector(&rd), 1u, "vector publicado legível");
+    CHECK_EQ(rd.inj_pw_ticks[1], 200000u, "leitura = vector comitado");
+    // Escritor interrompido a meio do próximo commit (seq ímpar): o leitor
+    // continua a ver o vector publicado, sem esperar nem ler meio buffer.
+    ecu_sched_test_cyl_vector_begin_write();
+    CHECK_EQ(ecu_sched_test_read_cyl_vector(&rd), 1u, "escrita pendente não bloqueia o leitor");
+    CHECK_EQ(rd.advance_deg[0], 15u, "escrita pendente: lê o buffer publicado");
+    vec.advance_deg[0] = 90u;  // > 60 → clamp
+    const uint32_t clamps0 = ecu_sched_test_get_calibration_clamp_count();
+    ecu_sched_commit_calibration_cyl(15u, 140625u, 200000u, 60u, &vec);
+    CHECK_EQ(ecu_sched_test_get_cyl_vector_seq(), seq0 + 4u, "commit seguinte publica +2");
+    CHECK_EQ(ecu_sched_test_read_cyl_vector(&rd), 1u, "novo vector legível");
+    CHECK_EQ(rd.advance_deg[0], 60u, "avanço por cilindro clampado a 60°");
+    CHECK_EQ(ecu_sched_test_get_calibration_clamp_count(), clamps0 + 1u,
+             "clamp do vector conta em calibration_clamp_count");
+    ecu_sched_commit_calibration(15u, 140625u, 200000u, 60u);
+    CHECK_EQ(ecu_sched_test_read_cyl_vector(&rd), 0u,
+             "commit escalar desactiva o vector");
+
+    section("ecu_sched cyl vector: PW/avanço individuais na tabela sequencial");
+    vec.advance_deg[0] = 30u;        // spark cyl0 = 690° → tooth 55, frac 0
+    vec.inj_pw_ticks[0] = 300000u;   // 180° → SOI = 660−180 = 480° → tooth 20
+    build_seq_table_with_vector(&vec);
+    CHECK_EQ(ecu_sched_is_sequential(), 1u, "tabela sequencial construída");
+    CHECK_EQ(find_angle_event(ECU_CH_IGN1, ECU_ACT_SPARK, &t, &f, &ph), 1u, "IGN1 SPARK presente");
+    CHECK_EQ(t, 55u, "avanço do vector (30°): SPARK cyl0 em tooth 55");
+    CHECK_EQ(find_angle_event(ECU_CH_INJ1, ECU_ACT_INJ_ON, &t, &f, &ph), 1u, "INJ1 ON presente");
+    CHECK_EQ(t, 20u, "PW do vector (180°): SOI cyl0 em tooth 20");
+    CHECK_EQ(find_angle_event(ECU_CH_INJ1, ECU_ACT_INJ_OFF, &t, &f, &ph), 1u, "INJ1 OFF presente");
+    CHECK_EQ(t, 50u, "EOI inalterado (tooth 50)");
+    // Cilindro com o PW base: SOI = tdc + 660 − 120 (mesmo dente relativo ao
+    // seu EOI que em build_seq_table_with_pw(200000)).
+    uint8_t t_base = 0u;
+    CHECK_EQ(find_angle_event(ECU_CH_INJ2, ECU_ACT_INJ_ON, &t_base, &f, &ph), 1u, "INJ2 ON presente");
+    build_seq_table_with_pw(200000u);
+    uint8_t t_ref = 0u;
+    find_angle_event(ECU_CH_INJ2, ECU_ACT_INJ_ON, &t_ref, &f, &ph);
+    CHECK_EQ(t_base, t_ref, "cyl1 com PW base = tabela escalar");
+
+    section("ecu_sched cyl vector: trims estáticos não se somam ao vector");
+    ems::engine::cyl_fuel_trim_pct[0] = 50;
+    vec.inj_pw_ticks[0] = 200000u;
+    vec.advance_deg[0] = 15u;
+    build_seq_table_with_vector(&vec);
+    find_angle_event(ECU_CH_INJ1, ECU_ACT_INJ_ON, &t, &f, &ph);
+    CHECK_EQ(t, 30u, "vector activo: trim estático ignorado (SOI 540°)");
+    build_seq_table_with_pw(200000u);  // repõe trims a 0 — aplica-os depois
+    ems::engine::cyl_fuel_trim_pct[0] = 50;
+    ckp_feed_n_then_gap(55u);
+    ckp_feed_n_then_gap(55u);
+    find_angle_event(ECU_CH_INJ1, ECU_ACT_INJ_ON, &t, &f, &ph);
+    CHECK_EQ(t, 20u, "sem vector: trim estático +50% (SOI 480°)");
+    ems::engine::cyl_fuel_trim_pct[0] = 0;
+}
+
+void test_cyl_pulse_build(void) {
+    section("cyl_pulse: trim por cilindro, dead-time individual, knock por cilindro");
+    for (uint8_t c = 0u; c < 4u; ++c) {
+        ems::engine::cyl_fuel_trim_pct[c] = 0;
+        ems::engine::cyl_ign_trim_deg[c] = 0;
+        ems::engine::knock_retard_x10[c] = 0u;
+    }
+    ems::engine::cyl_fuel_trim_pct[1] = 10;
+    ems::engine::cyl_ign_trim_deg[3] = -2;
+    ems::engine::knock_retard_x10[2] = 50u;   // 5°
+    EcuSchedCylVector v{};
+    const int16_t adv = ems::engine::cyl_pulse_build({5000u, 800u, 20, 100u, true}, &v);
+    CHECK_EQ(v.inj_pw_ticks[0], inj_pw_us_to_scheduler_ticks(5800u), "cyl0: fluxo + dead-time");
+    CHECK_EQ(v.inj_pw_ticks[1], inj_pw_us_to_scheduler_ticks(6300u),
+             "cyl1 +10%: só o fluxo escala (5500 + 800)");
+    CHECK_EQ(v.advance_deg[0], 20u, "cyl0: avanço base");
+    CHECK_EQ(v.advance_deg[2], 15u, "cyl2: retardo de knock próprio (−5°)");
+    CHECK_EQ(v.advance_deg[3], 18u, "cyl3: trim de ignição −2°");
+    CHECK_EQ(adv, 15, "escalar (presync) = avanço − maior retardo");
+
+    // MAP previsto ao IVC por cilindro (ref = MAP do lookup VE/λ do slot).
+    const uint16_t map_ivc[4] = {100u, 100u, 120u, 80u};
+    ems::engine::cyl_pulse_build({5000u, 800u, 20, 100u, true, map_ivc, 100u}, &v);
+    CHECK_EQ(v.inj_pw_ticks[0], inj_pw_us_to_scheduler_ticks(5800u),
+             "MAP_IVC = ref → fluxo inalterado");
+    CHECK_EQ(v.inj_pw_ticks[2], inj_pw_us_to_scheduler_ticks(6800u),
+             "IVC a 1.20 bar → fluxo ×1.2 (6000 + 800)");
+    CHECK_EQ(v.inj_pw_ticks[3], inj_pw_us_to_scheduler_ticks(4800u),
+             "IVC a 0.80 bar → fluxo ×0.8 (4000 + 800)");
+    CHECK_EQ(v.inj_pw_ticks[1], inj_pw_us_to_scheduler_ticks(6300u),
+             "razão de MAP compõe com o trim do cilindro");
+
+    const int16_t adv_crank = ems::engine::cyl_pulse_build({5000u, 800u, 10, 100u, false}, &v);
+    CHECK_EQ(v.advance_deg[2], 10u, "knock_enable=false: sem retardo (cranking)");
+    CHECK_EQ(adv_crank, 10, "cranking: escalar = avanço pedido");
+
+    ems::engine::cyl_pulse_build({0u, 800u, 20, 100u, true}, &v);
+    bool all_zero = true;
+    for (uint8_t c = 0u; c < 4u; ++c) { all_zero = all_zero && (v.inj_pw_ticks[c] == 0u); }
+    CHECK_TRUE(all_zero, "fluxo 0 (corte): PW 0 em todos, sem dead-time");
+    CHECK_EQ(v.advance_deg[2], 15u, "spark-only (limitador): retardo do cil. 2 mantém-se");
+    CHECK_EQ(v.advance_deg[0], 20u, "spark-only: cil. 0 sem retardo");
+
+    section("cyl_pulse: knock de um cilindro só move a faísca desse cilindro");
+    uint8_t t = 0u, f = 0u, ph = 0u;
+    ems::engine::cyl_ign_trim_deg[3] = 0;
+    ems::engine::knock_retard_x10[2] = 0u;
+    ems::engine::cyl_pulse_build({5000u, 800u, 30, 100u, true}, &v);
+    build_seq_table_with_vector(&v);
+    find_angle_event(ECU_CH_IGN1, ECU_ACT_SPARK, &t, &f, &ph);
+    const uint32_t ign1_ref = t * 256u + f;
+    find_angle_event(ECU_CH_IGN3, ECU_ACT_SPARK, &t, &f, &ph);
+    const uint32_t ign3_ref = t * 256u + f;
+    ems::engine::knock_retard_x10[2] = 50u;   // 5° só no cil. 2 (IGN3)
+    ems::engine::cyl_pulse_build({5000u, 800u, 30, 100u, true}, &v);
+    build_seq_table_with_vector(&v);
+    find_angle_event(ECU_CH_IGN1, ECU_ACT_SPARK, &t, &f, &ph);
+    CHECK_EQ(t * 256u + f, ign1_ref, "IGN1: faísca inalterada");
+    find_angle_event(ECU_CH_IGN3, ECU_ACT_SPARK, &t, &f, &ph);
+    // 5° a 6°/dente = 213/256 de dente mais tarde.
+    CHECK_TRUE(t * 256u + f >= ign3_ref + 210u && t * 256u + f <= ign3_ref + 216u,
+               "IGN3: faísca 5° mais tarde");
+
+    ems::engine::cyl_fuel_trim_pct[1] = 0;
+    ems::engine::cyl_ign_trim_deg[3] = 0;
+    ems::engine::knock_retard_x10[2] = 0u;
+}
+
 void test_eoi_blend(void) {
     section("fuel_calc: EOI blend de 2 pontos por RPM");
     // main = g_eng_cfg.default_eoi_lead_deg (355 por default de compilação)
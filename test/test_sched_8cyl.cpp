@@ -0,0 +1,185 @@
+/**
+ * @file test/test_sched_8cyl.cpp
+ * 8-cylinder scheduler coverage — standalone host binary (make host-test-8cyl).
+ *
+ * EMS_CYLINDERS sizes the channel map, the angle table, the TIM5 queue and
+ * the firing-order presets at compile time, so the main RGT6 host regression
+ * (4 cil.) never exercises the N>4 paths. This binary is built
+ * -DEMS_BOARD_VGT6 -DEMS_CYLINDERS=8 and drives the real CKP decoder + TIM5
+ * dispatcher tooth-by-tooth at 8000 RPM with multi-spark forced on, checking
+ * that no event is dispatched late, dropped from the angle table or lost to
+ * queue overflow — in presync (wasted) and in sequential.
+ */
+#include "test/harness.h"
+#include "test/fixtures.h"
+
+#include <cstdint>
+#include <cstdio>
+
+#include "drv/ckp.h"
+#include "engine/ecu_sched.h"
+#include "engine/engine_config.h"
+#include "hal/out_pins.h"
+
+extern volatile uint32_t g_pin_high_count[];
+
+using namespace ems::drv;
+using namespace ems::engine;
+
+namespace {
+
+// 8000 RPM na 60-2: 7.5 ms/rev = 468750 ticks TIM5 (62.5 MHz) / 60 posições.
+constexpr uint32_t kTooth8000 = 7812u;
+
+// Avança o "tempo" até à próxima borda CKP despachando, por ordem, todos os
+// eventos TIM5 que vencem antes dela (como o CC3 ISR faria no alvo), e só
+// depois dispara o dente. TIM5_CNT = timestamp exacto do evento: qualquer
+// late_event_count resulta de eventos genuinamente a <16 ticks um do outro.
+void sim_tooth(uint32_t delta) {
+    const uint32_t next = g_ckp_cap + delta;
+    uint32_t ts = 0u;
+    while (ecu_sched_test_get_evt_count() > 0u &&
+           ecu_sched_test_get_evt(0u, &ts, nullptr, nullptr) != 0u &&
+           (int32_t)(ts - next) <= 0) {
+        ecu_sched_test_set_tim5_cnt(ts);
+        ecu_sched_evt_dispatch();
+    }
+    ecu_sched_test_set_tim5_cnt(next);
+    ckp_fire(delta);
+}
+
+void sim_revs(uint32_t revs, uint32_t p) {
+    for (uint32_t r = 0u; r < revs; ++r) {
+        for (uint32_t i = 0u; i < 57u; ++i) { sim_tooth(p); }
+        sim_tooth(p * 3u);
+    }
+}
+
+// Idem com borda CMP real a cada 720° (2 revs): mantém cmp_confirms vivo
+// além de kMaxRevsWithoutCmp, ao contrário do bypass ckp_test_set_cmp_confirms.
+void sim_revs_with_cam(uint32_t revs, uint32_t p) {
+    for (uint32_t r = 0u; r < revs; ++r) {
+        if ((r & 1u) == 0u) { cam_fire(g_ckp_cap); }
+        sim_revs(1u, p);
+    }
+}
+
+void sched_setup_8000rpm(void) {
+    ecu_sched_test_reset();
+    ckp_test_reset();
+    g_ckp_cap = 0u;
+    ecu_sched_test_set_tim5_cnt(0u);
+    ecu_sched_set_advance_deg(30u);
+    ecu_sched_set_dwell_ticks(140625u);   // 2.25 ms
+    ecu_sched_set_inj_pw_ticks(250000u);  // 4 ms
+    ecu_sched_set_eoi_lead_deg(60u);
+    // Multi-spark acima do gate de RPM do main loop: pior caso de densidade
+    // (tabela e fila) — o scheduler não aplica o gate, só o main loop.
+    ecu_sched_set_mspark(3u, 1000u, 18u);
+}
+
+void count_ign_events(uint8_t *dwell, uint8_t *spark, uint8_t *inj_on, uint8_t *inj_off) {
+    *dwell = 0u; *spark = 0u; *inj_on = 0u; *inj_off = 0u;
+    for (uint8_t i = 0u; i < ecu_sched_test_angle_table_size(); ++i) {
+        uint8_t tooth = 0, frac = 0, ch = 0, action = 0, phase = 0;
+        if (ecu_sched_test_get_angle_event(i, &tooth, &frac, &ch, &action, &phase) == 0u) {
+            continue;
+        }
+        if (action == ECU_ACT_DWELL_START) { ++*dwell; }
+        else if (action == ECU_ACT_SPARK) { ++*spark; }
+        else if (action == ECU_ACT_INJ_ON) { ++*inj_on; }
+        else if (action == ECU_ACT_INJ_OFF) { ++*inj_off; }
+    }
+}
+
+void test_8cyl_config(void) {
+    section("8 cil.: presets compile-time (canais, tabela, TDC)");
+    CHECK_EQ(ECU_CYL_COUNT, 8u, "ECU_CYL_COUNT = 8");
+    CHECK_EQ(ECU_CHANNEL_COUNT, 16u, "16 canais (8 INJ + 8 IGN)");
+    CHECK_EQ(ECU_ANGLE_TABLE_SIZE, 88u, "angle table = 10×8 + 8");
+    CHECK_EQ(ECU_CYL_MASK_ALL, 0xFFu, "máscara de inibição cobre 8 cil.");
+    CHECK_EQ(cfg::kFiringOrder[1], 7u, "firing order 1-8-7-2-6-5-4-3");
+    bool tdc_ok = true;
+    for (uint8_t pos = 0u; pos < 8u; ++pos) {
+        tdc_ok = tdc_ok && (cfg::kFiringTdc.deg[pos] == pos * 90u);
+    }
+    CHECK_TRUE(tdc_ok, "even-fire: TDC a cada 90°");
+    CHECK_EQ(cfg::cyl_tdc_deg(7u), 90u, "cil. 8 é o 2.º a disparar (90°)");
+
+    using namespace ems::hal;
+    out_pins_test_reset_stubs();
+    out_pin_write(ECU_CH_INJ5, 1u);
+    CHECK_TRUE((out_pins_test_bsrr_snapshot(kOutPortD) & (1u << 8u)) != 0u,
+               "INJ5 high → GPIOD set PD8");
+    out_pin_write(ECU_CH_IGN8, 0u);
+    CHECK_TRUE((out_pins_test_bsrr_snapshot(kOutPortD) & (1u << (15u + 16u))) != 0u,
+               "IGN8 low → GPIOD reset PD15");
+}
+
+void test_8cyl_presync_8000rpm(void) {
+    section("8 cil.: presync wasted @8000 RPM + multi-spark, sem eventos tardios");
+    sched_setup_8000rpm();
+    sim_revs(2u, kTooth8000);  // sync
+    const uint32_t late0 = ecu_sched_test_get_late_event_count();
+    sim_revs(8u, kTooth8000);
+    CHECK_EQ(ecu_sched_is_sequential(), 0u, "sem CMP → wasted");
+    CHECK_TRUE(ecu_sched_test_angle_table_size() <= ECU_ANGLE_TABLE_SIZE,
+               "tabela presync cabe em ECU_ANGLE_TABLE_SIZE");
+    EcuSchedDiagSnapshot d{};
+    ecu_sched_get_diag_snapshot(&d);
+    CHECK_EQ(ecu_sched_test_get_late_event_count() - late0, 0u, "0 eventos tardios");
+    CHECK_EQ(ecu_sched_test_get_cycle_schedule_drop_count(), 0u, "0 drops na tabela angular");
+    CHECK_EQ(d.evt_overflow, 0u, "0 overflow na fila TIM5");
+    bool all_ign = true;
+    for (uint8_t c = 0u; c < 8u; ++c) {
+        const uint8_t ign = (c < 4u) ? (uint8_t)(ECU_CH_IGN1 + c) : (uint8_t)(ECU_CH_IGN5 + c - 4u);
+        all_ign = all_ign && (g_pin_high_count[ign] > 0u);
+    }
+    CHECK_TRUE(all_ign, "as 8 bobinas carregaram (pin HIGH) em wasted");
+}
+
+void test_8cyl_sequential_8000rpm(void) {
+    section("8 cil.: sequencial @8000 RPM + multi-spark, sem eventos tardios");
+    sched_setup_8000rpm();
+    sim_revs(2u, kTooth8000);
+    sim_revs_with_cam(8u, kTooth8000);  // 3 bordas CMP coerentes → sequencial
+    CHECK_EQ(ecu_sched_is_sequential(), 1u, "CMP confirmado → sequencial");
+
+    const uint32_t late0 = ecu_sched_test_get_late_event_count();
+    sim_revs_with_cam(8u, kTooth8000);
+    CHECK_EQ(ecu_sched_is_sequential(), 1u, "continua sequencial");
+
+    uint8_t n_dwell = 0u, n_spark = 0u, n_inj_on = 0u, n_inj_off = 0u;
+    count_ign_events(&n_dwell, &n_spark, &n_inj_on, &n_inj_off);
+    CHECK_EQ(n_inj_on, 8u, "8 INJ_ON por ciclo");
+    CHECK_EQ(n_inj_off, 8u, "8 INJ_OFF por ciclo");
+    CHECK_TRUE(n_dwell > 8u && n_dwell <= 32u, "multi-spark activo: dwell em (8,32]");
+    CHECK_EQ(n_dwell, n_spark, "pares dwell/spark balanceados");
+    CHECK_TRUE(ecu_sched_test_angle_table_size() <= ECU_ANGLE_TABLE_SIZE,
+               "tabela sequencial cabe em ECU_ANGLE_TABLE_SIZE");
+
+    EcuSchedDiagSnapshot d{};
+    ecu_sched_get_diag_snapshot(&d);
+    CHECK_EQ(ecu_sched_test_get_late_event_count() - late0, 0u, "0 eventos tardios");
+    CHECK_EQ(ecu_sched_test_get_cycle_schedule_drop_count(), 0u, "0 drops na tabela angular");
+    CHECK_EQ(d.evt_overflow, 0u, "0 overflow na fila TIM5");
+    CHECK_TRUE(d.evt_dispatched > 0u, "fila TIM5 despachou eventos");
+    bool all_out = true;
+    for (uint8_t ch = 0u; ch < ECU_CHANNEL_COUNT; ++ch) {
+        all_out = all_out && (g_pin_high_count[ch] > 0u);
+    }
+    CHECK_TRUE(all_out, "os 16 canais (INJ1–8, IGN1–8) comutaram");
+}
+
+}  // namespace
+
+int main(void) {
+    printf("OpenEMS 8-cyl scheduler Tests\n");
+    printf("============================================================\n");
+    test_8cyl_config();
+    test_8cyl_presync_8000rpm();
+    test_8cyl_sequential_8000rpm();
+    printf("\n============================================================\n");
+    printf("8-cyl scheduler: %d passed, %d failed\n", g_pass, g_fail);
+    return g_fail ? 1 : 0;
+}
@@ -14,6 +14,7 @@
 #include "engine/calibration.h"
 #include "app/can_rx_map.h"
 #include "hal/adc.h"
+#include "hal/adc_cic.h"
 #include "hal/system.h"
 #include "drv/ckp.h"
 #include "drv/sensors.h"
@@ -23,6 +24,7 @@
 #include "engine/knock.h"
 #include "engine/table3d.h"
 #include "engine/ecu_sched.h"
+#include "engine/cyl_pulse.h"
 #include "engine/quick_crank.h"
 #include "engine/map_window.h"
 #include "engine/transient_fuel.h"
@@ -130,6 +132,112 @@ void test_sensors_on_tooth(void) {
     CHECK_TRUE(true, "sensors_on_tooth completes without crash");
 }
 
+void test_adc_oversample_decimation(void) {
+    section("adc: oversampling 14 bits + CIC por canal");
+    // CIC R=8: 1.º despejo descartado, depois uma saída exacta a cada 8.
+    CicDecimator cic(3u);
+    uint16_t y = 0u;
+    uint8_t outs = 0u;
+    for (uint8_t i = 0u; i < 24u; ++i) {
+        if (cic.push(8000u, y)) { ++outs; }
+    }
+    CHECK_EQ(outs, 2u, "R=8: 24 entradas → 2 saídas (1.º bloco descartado)");
+    CHECK_EQ(y, 32000u, "DC ×4 → ×16 sem erro de ganho");
+    CicDecimator bypass(0u);
+    CHECK_TRUE(bypass.push(1234u, y), "log2=0: saída a cada amostra");
+    CHECK_EQ(y, 4936u, "bypass só muda a escala (×4 → ×16)");
+
+    // ADC2: ruído de Nyquist (±2 LSB alternado) cancelado pelo zero do sinc².
+    sensor_setup(); sensors_init();
+    uint16_t seq[5] = {8000u, 8000u, 8000u, 8000u, 8000u};
+    for (uint8_t n = 0u; n < 128u; ++n) {
+        const uint16_t v = (n & 1u) ? 8008u : 7992u;
+        seq[static_cast<uint8_t>(AdcSecondaryChannel::FUEL_PRESS)] = v;
+        seq[static_cast<uint8_t>(AdcSecondaryChannel::CLT)] = v;
+        adc_test_dma_sequence_secondary(seq);
+    }
+    CHECK_EQ(adc_secondary_read_x16(AdcSecondaryChannel::FUEL_PRESS), 32000u,
+             "FUEL (R=8): ruído alternado rejeitado");
+    CHECK_EQ(adc_secondary_read_x16(AdcSecondaryChannel::CLT), 32000u,
+             "CLT (R=32): ruído alternado rejeitado");
+    CHECK_EQ(adc_secondary_read(AdcSecondaryChannel::CLT), 2000u,
+             "leitura de 12 bits = x16 >> 4");
+    for (int i = 0; i < 2; ++i) { sensors_tick_50ms(); }
+    sensors_test_tick_100ms();
+    CHECK_EQ(sensors_get().fuel_press_bar_x1000, 1221u,
+             "fuel_press da leitura decimada (32000 × 2500 / 65520)");
+
+    // MAP: os bits do oversampler chegam ao bar_x1000. 2001.5 LSB → 1466;
+    // truncado a 12 bits (2001) daria 1465.
+    sensor_setup(); sensors_init();
+    adc_test_set_x16_primary(AdcPrimaryChannel::MAP, 32024u);
+    ems::drv::CkpSnapshot snap{};
+    snap.tooth_period_ns = 160000u;
+    snap.rpm_x10 = 8000u;
+    for (uint16_t t = 0u; t < 58u * 10u; ++t) { sensors_on_tooth(snap); }
+    CHECK_EQ(sensors_get().map_bar_x1000, 1466u, "MAP com resolução acima de 12 bits");
+    sensor_setup(); sensors_init();
+}
+
+void test_map_angle_sync(void) {
+    section("sensors: MAP síncrona ao ângulo (SQ1 por trigger de dente)");
+    sensor_setup(); sensors_init();
+    ckp_test_reset();
+    const uint8_t teeth = ckp_wheel().real_teeth;
+    ems::drv::CkpSnapshot s{};
+    s.tooth_period_ns = 160000u;
+    s.rpm_x10 = 62500u;
+    s.state = SyncState::FULL_SYNC;
+    s.cmp_confirms = 2u;
+
+    // Um ciclo de 720°: MAP do dente k = 1000 + 10·k LSB no instante do
+    // trigger; logo a seguir o MAP salta para 4000 LSB (pulsação) — a amostra
+    // já foi tomada e não pode ser contaminada.
+    for (uint16_t k = 0u; k <= 2u * teeth; ++k) {
+        s.phase_A = (k < teeth) || (k == 2u * teeth);
+        s.tooth_index = static_cast<uint16_t>(k % teeth);
+        adc_test_set_x16_primary(AdcPrimaryChannel::MAP,
+                                 static_cast<uint16_t>((1000u + 10u * (k % (2u * teeth))) << 4u));
+        sensors_on_tooth(s);
+        adc_test_set_raw_primary(AdcPrimaryChannel::MAP, 4000u);
+    }
+    const uint16_t deg_t1 = static_cast<uint16_t>(ckp_wheel().tooth_deg_x10[1] / 10u);
+    CHECK_EQ(sensors_map_at_deg_bar_x1000(0u), 732u, "dente 0 (fase A): 1000 LSB → 732");
+    CHECK_EQ(sensors_map_at_deg_bar_x1000(deg_t1), 739u,
+             "dente 1: 1010 LSB, não o salto posterior ao trigger");
+    CHECK_EQ(sensors_map_at_deg_bar_x1000(static_cast<uint16_t>(deg_t1 + 2u)), 739u,
+             "ângulo dentro do passo → último dente ≤ ângulo");
+    CHECK_EQ(sensors_map_at_deg_bar_x1000(360u),
+             static_cast<uint16_t>(((1000u + 10u * teeth) * 3000u) / 4095u),
+             "dente 0 da fase B indexado a 360°");
+    CHECK_EQ(sensors_map_at_deg_bar_x1000(720u), 0u, "fora do ciclo → 0");
+
+    // Carga (canais rápidos) usa a última amostra síncrona, não o CIC corrente.
+    for (uint8_t i = 0u; i < 60u; ++i) {
+        adc_test_set_raw_primary(AdcPrimaryChannel::MAP, 2000u);
+        sensors_on_tooth(s);
+        adc_test_set_raw_primary(AdcPrimaryChannel::MAP, 4000u);
+    }
+    CHECK_EQ(sensors_get().map_bar_x1000, 1465u, "MAP de carga = amostra no ângulo do trigger");
+
+    // Sem fase de came: amostra usada na carga, mas não indexada a 720°.
+    sensor_setup(); sensors_init();
+    s.cmp_confirms = 0u;
+    for (uint16_t k = 0u; k < 4u; ++k) {
+        s.tooth_index = k;
+        sensors_on_tooth(s);
+    }
+    CHECK_EQ(sensors_map_at_deg_bar_x1000(0u), 0u, "sem came: buffer angular vazio");
+
+    // Período 0 (antes de HALF_SYNC): nenhum trigger armado, nada a recolher.
+    sensor_setup(); sensors_init();
+    uint16_t x16 = 0u;
+    s.tooth_period_ns = 0u;
+    sensors_on_tooth(s);
+    CHECK_FALSE(adc_map_sync_take(x16), "sem período de dente não há amostra síncrona");
+    sensor_setup(); sensors_init();
+}
+
 void test_map_window_angular(void) {
     section("map_window: janela angular por cilindro + balance");
     using ems::engine::map_window_on_tooth;
@@ -192,6 +300,30 @@ void test_map_window_angular(void) {
     CHECK_EQ(map_window_slot_bar_x1000(0u), 500u,
              "janela parcial abortada não contamina a média");
 
+    section("map_window: balance aplicado ao PW por cilindro (cyl_pulse)");
+    // MAP médio 0,5 bar (50 bar×100); slot k = posição de disparo k.
+    const uint8_t cyl_hi = ems::engine::cfg::kFiringOrder[1];  // slot 1 (+)
+    const uint8_t cyl_lo = ems::engine::cfg::kFiringOrder[2];  // slot 2 (−)
+    const uint8_t cyl_0  = ems::engine::cfg::kFiringOrder[0];
+    EcuSchedCylVector v{};
+    ems::engine::map_balance_gain_pct = 0u;
+    ems::engine::cyl_pulse_build({5000u, 0u, 10, 50u, false}, &v);
+    CHECK_EQ(v.inj_pw_ticks[cyl_hi], v.inj_pw_ticks[cyl_0], "gain=0: sem correcção");
+    ems::engine::map_balance_gain_pct = 100u;
+    ems::engine::cyl_pulse_build({5000u, 0u, 10, 50u, false}, &v);
+    // Desvio ≈ +13‰ bar sobre 0,5 bar → ≈ +2,6% no cilindro do slot 1.
+    CHECK_TRUE(ems::engine::cyl_pulse_balance_x1000(cyl_hi) >= 20 &&
+               ems::engine::cyl_pulse_balance_x1000(cyl_hi) <= 40,
+               "slot 1: +2..4% de fluxo (desvio relativo ao MAP)");
+    CHECK_TRUE(ems::engine::cyl_pulse_balance_x1000(cyl_lo) <= -20,
+               "slot 2: fluxo reduzido");
+    CHECK_TRUE(v.inj_pw_ticks[cyl_hi] > v.inj_pw_ticks[cyl_0] &&
+               v.inj_pw_ticks[cyl_lo] < v.inj_pw_ticks[cyl_0],
+               "PW segue o ar medido na janela do cilindro");
+    ems::engine::cyl_pulse_build({5000u, 0u, 10, 2u, false}, &v);
+    CHECK_EQ(ems::engine::cyl_pulse_balance_x1000(cyl_hi), 100, "balance limitado a +10%");
+    ems::engine::map_balance_gain_pct = 0u;
+
     ems::engine::map_window_enable = 0u;  // isolamento entre testes
     map_window_reset();
 }
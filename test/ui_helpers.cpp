@@ -5,16 +5,13 @@
 using namespace ems::app;
 using namespace ems::hal;
 
-void ui_feed(const uint8_t* data, uint16_t n) {
-    for (uint16_t i = 0u; i < n; ++i) { ems::app::ui_rx_byte(data[i]); }
+void ui_feed(const uint8_t* data, uint16_t n, UiPort port) {
+    for (uint16_t i = 0u; i < n; ++i) { ems::app::ui_rx_byte(port, data[i]); }
     ems::app::ui_process();
 }
 
-uint16_t ui_drain(uint8_t* out, uint16_t max) {
-    uint16_t n = 0u;
-    uint8_t b = 0u;
-    while (n < max && ems::app::ui_tx_pop(b)) { out[n++] = b; }
-    return n;
+uint16_t ui_drain(uint8_t* out, uint16_t max, UiPort port) {
+    return ems::app::ui_tx_pop_bytes(port, out, max);
 }
 
 
@@ -30,15 +27,15 @@ uint16_t env_frame(uint8_t* out, const uint8_t* payload, uint16_t n) {
     return static_cast<uint16_t>(n + 6u);
 }
 
-EnvResp env_txn(const uint8_t* payload, uint16_t n) {
+EnvResp env_txn(const uint8_t* payload, uint16_t n, UiPort port) {
     EnvResp r = {};
     static uint8_t frame[1024] = {};
     const uint16_t fl = env_frame(frame, payload, n);
-    ui_feed(frame, fl);
+    ui_feed(frame, fl, port);
 
     static uint8_t buf[1024] = {};
     memset(buf, 0, sizeof(buf));
-    const uint16_t rn = ui_drain(buf, sizeof(buf));
+    const uint16_t rn = ui_drain(buf, sizeof(buf), port);
     if (rn < 7u) { return r; }
     const uint16_t psize = static_cast<uint16_t>((buf[0] << 8u) | buf[1]);
     if (static_cast<uint16_t>(psize + 6u) != rn) { return r; }
@@ -1,8 +1,13 @@
 #pragma once
 #include <cstdint>
 
-void ui_feed(const uint8_t* data, uint16_t n);
-uint16_t ui_drain(uint8_t* out, uint16_t max);
+#include "app/ui_protocol.h"
+
+// port: sessão de protocolo (UART por omissão, como o tráfego legado).
+void ui_feed(const uint8_t* data, uint16_t n,
+             ems::app::UiPort port = ems::app::UiPort::kUart);
+uint16_t ui_drain(uint8_t* out, uint16_t max,
+                  ems::app::UiPort port = ems::app::UiPort::kUart);
 uint16_t env_frame(uint8_t* out, const uint8_t* payload, uint16_t n);
 
 struct EnvResp {
@@ -13,4 +18,5 @@ struct EnvResp {
     uint8_t data[1024];
 };
 
-EnvResp env_txn(const uint8_t* payload, uint16_t n);
+EnvResp env_txn(const uint8_t* payload, uint16_t n,
+                ems::app::UiPort port = ems::app::UiPort::kUart);
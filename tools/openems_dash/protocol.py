@@ -188,6 +188,42 @@ def autodetect_port() -> str:
     return ports[0]
 
 
+# DiagnosticCode (src/engine/diagnostic_manager.h) → nome.
+DTC_NAMES = {
+    0x0100: "MAP_SENSOR_RANGE", 0x0101: "MAP_SENSOR_PLAUSIBILITY",
+    0x0102: "MAF_SENSOR_RANGE", 0x0103: "MAF_SENSOR_PLAUSIBILITY",
+    0x0104: "TPS_SENSOR_RANGE", 0x0105: "TPS_SENSOR_PLAUSIBILITY",
+    0x0106: "CLT_SENSOR_RANGE", 0x0107: "CLT_SENSOR_PLAUSIBILITY",
+    0x0108: "IAT_SENSOR_RANGE", 0x0109: "IAT_SENSOR_PLAUSIBILITY",
+    0x010A: "O2_SENSOR_RANGE", 0x010B: "O2_SENSOR_HEATER",
+    0x0120: "MAP_TPS_CORRELATION", 0x0121: "MAP_BARO_CORRELATION",
+    0x0122: "FUEL_PRESS_LOW", 0x0123: "FUEL_PRESS_HIGH",
+    0x0124: "OIL_PRESS_LOW", 0x0125: "OIL_PRESS_HIGH",
+    0x0126: "ETB_TPS_FAULT",
+    **{0x0300 + i: f"MISFIRE_CYLINDER_{i + 1}" for i in range(8)},
+    0x0310: "KNOCK_DETECTED", 0x0311: "KNOCK_SENSOR_FAULT",
+    0x0170: "FUEL_TRIM_LEAN", 0x0171: "FUEL_TRIM_RICH",
+    0x0172: "LTFT_LIMIT_REACHED", 0x0173: "STFT_LIMIT_REACHED",
+    0x0001: "CKP_SIGNAL_FAULT", 0x0002: "CMP_SIGNAL_FAULT",
+    0x0010: "TIMING_OVER_ADVANCED", 0x0011: "TIMING_OVER_RETARDED",
+    0x0500: "VBATT_LOW", 0x0501: "VBATT_HIGH",
+    0x0510: "ADC_TIMEOUT", 0x0511: "ADC_RECOVERY_FAILED",
+    0x0520: "FLASH_WRITE_FAULT",
+    0x0200: "OVERTEMP_CRITICAL", 0x0201: "OVERTEMP_WARNING",
+    0x0210: "OVERSPEED", 0x0220: "LOW_OIL_PRESSURE",
+    0xF000: "RECOVERY_ADC_INITIATED", 0xF001: "RECOVERY_ADC_SUCCESS",
+    0xF002: "RECOVERY_ADC_FAILED",
+}
+
+# FreezeVar (diagnostic_manager.h) → nome da palavra do freeze frame.
+FREEZE_VARS = {
+    1: "rpm_x10", 2: "map_bar_x100", 3: "tps_pct_x10", 4: "app_pct_x10",
+    5: "clt_degc_x10", 6: "iat_degc_x10", 7: "vbatt_mv",
+    8: "fuel_press_bar_x1000", 9: "oil_press_bar_x1000", 10: "sync_state",
+    11: "sensor_fault_bits",
+}
+
+
 class OpenEMSLink:
     """Acesso serial thread-safe (uma transação por vez)."""
 
@@ -308,8 +344,11 @@ class OpenEMSLink:
         "map_w0", "map_w1", "map_w2", "map_w3",
         "map_window_cycles",  # [50] ciclos 720° completos
         "cut_reasons",  # [51] hi16=spark lo16=fuel — desempacotado abaixo
+        # [52-55] estágios do kernel de PW (µs): base, λ+trim, fluxo, comandado
+        "pw_base_us", "pw_trimmed_us", "pw_flow_us", "pw_inj_us",
+        "pw_kernel_cycles_max",  # [56] pior caso DWT das 2 passagens (ciclos)
     ]
-    DEBUG_SIZE = 52 * 4  # must match FW diag[52]
+    DEBUG_SIZE = 57 * 4  # must match FW diag[57]
 
     # Bits de src/engine/cut_reason.h (ordem = bit 0..N)
     FUEL_CUT_BITS = ["rev_limit", "limp_rpm", "map_fault", "oil_press",
@@ -325,11 +364,11 @@ class OpenEMSLink:
     def read_debug(self) -> dict:
         assert len(self.DEBUG_FIELDS) * 4 == self.DEBUG_SIZE
         buf = self._txn(b"D", self.DEBUG_SIZE)
-        # 31 u32 + 2 i32 + 19 u32
+        # 31 u32 + 2 i32 + 24 u32
         vals = (
             struct.unpack("<31I", buf[:124])
             + struct.unpack("<2i", buf[124:132])
-            + struct.unpack("<19I", buf[132:208])
+            + struct.unpack("<24I", buf[132:228])
         )
         d = dict(zip(self.DEBUG_FIELDS, vals))
         for n in range(4):
@@ -344,6 +383,37 @@ class OpenEMSLink:
         d["spark_cut_list"] = self._decode_bits(cr >> 16, self.SPARK_CUT_BITS)
         return d
 
+    # ── memória de DTCs ('E' lê: 1 + 10 × 36 B; 'e' apaga → ACK) ─────────
+    # Entrada = StoredDtc de diagnostic_manager.h: code u16, occurrences
+    # u16, first_seen_s u32, last_seen_s u32 (tempo de operação da ECU),
+    # freeze_vars 8 × u8, freeze_frame 8 × u16.
+    DTC_MAX = 10
+    DTC_ENTRY = struct.Struct("<HHII8B8H")
+
+    def read_stored_dtcs(self) -> list[dict]:
+        buf = self._txn(b"E", 1 + self.DTC_MAX * self.DTC_ENTRY.size)
+        out = []
+        for i in range(min(buf[0], self.DTC_MAX)):
+            f = self.DTC_ENTRY.unpack_from(buf, 1 + i * self.DTC_ENTRY.size)
+            code = f[0]
+            freeze = {FREEZE_VARS.get(v, f"var{v}"): f[12 + k]
+                      for k, v in enumerate(f[4:12]) if v != 0}
+            out.append({"code": code,
+                        "pcode": f"P{code:04X}",
+                        "name": DTC_NAMES.get(code, "?"),
+                        "occurrences": f[1],
+                        "first_seen_s": f[2],
+                        "last_seen_s": f[3],
+                        "freeze": freeze})
+        return out
+
+    def clear_stored_dtcs(self) -> None:
+        # Só a memória persistente; falhas activas continuam até o
+        # subsistema as limpar.
+        ack = self._txn(b"e", 1)
+        if ack != b"\x00":
+            raise IOError(f"clear DTCs: ACK {ack.hex()}")
+
     # ── osciloscópio CKP/CMP ('K': 294 bytes) ────────────────────────────
     def read_scope(self) -> dict:
         """Rings de timestamps TIM5 (62.5 MHz) das bordas cruas CKP/CMP +
@@ -407,15 +477,24 @@ class OpenEMSLink:
         self._test_cmd(0x41, 0, pwm & 0xFFFF)
 
     def burn_page(self, page: int) -> None:
-        # burn_page_to_flash (ui_protocol.cpp) apaga o setor (8KB) e programa
-        # antes de responder — bloqueante no firmware. O timeout por-defeito
-        # (0.3s, dimensionado para o poll de telemetria a 30Hz) estoura em
-        # erase+program real; 2s dá margem folgada sem travar a UI para sempre
-        # se a placa realmente não responder.
+        # burn_page_to_flash (ui_protocol.cpp) só enfileira o burn da cópia
+        # inactiva (A/B) na fila de flash e responde de imediato; o erase +
+        # program correm em background. NACK = RPM acima do limite antes da
+        # primeira operação de flash pós-reset, fila cheia ou burn anterior da
+        # mesma página ainda em curso (tentar de novo).
+        # Timeout de 2s mantido para firmware antigo, que gravava antes do ACK.
         ack = self._txn(b"b" + bytes([page]), 1, timeout=2.0)
         if ack != b"\x00":
             raise IOError(f"burn page {page}: ACK {ack.hex()}")
 
+    def rollback_page(self, page: int) -> None:
+        # 'U' page: revoga a cópia activa em flash e volta ao burn anterior
+        # (um nível). O firmware recarrega a página em RAM quando o job de
+        # flash conclui — reler a página ('r') depois de ~100 ms.
+        ack = self._txn(b"U" + bytes([page]), 1, timeout=0.5)
+        if ack != b"\x00":
+            raise IOError(f"rollback page {page}: ACK {ack.hex()}")
+
 
 # ── codecs de página ────────────────────────────────────────────────────────
 
@@ -648,6 +727,7 @@ PAGE0_FIELDS = [
     ("ckp_skip_pulses_after_gap", 71, 1, "B", 1.0),
     # bytes 246-251: MAP janela angular por cilindro (FOME #610)
     ("map_window_enable",   246, 1, "B", 1.0),  # 0=off 1=medir
+    ("map_balance_gain_pct", 247, 1, "B", 1.0), # % desvio → PW/cil (0=off, ≤100)
     ("map_window_open_deg", 248, 1, "H", 1.0),  # ° ciclo 720 (slot0; +180°/slot)
     ("map_window_len_deg",  250, 1, "H", 1.0),  # ° duração (10-180)
     # bytes 252-257: duty INJ + gates DFCO + knock morto
@@ -656,6 +736,34 @@ PAGE0_FIELDS = [
     ("decel_cut_map_max_bar_x100",  254, 1, "H", 1.0),   # kPa (0=off)
     ("decel_cut_gear_inhibit_ms10", 256, 1, "B", 10.0),  # ms pós-troca (0=off)
     ("knock_dead_min_p2p",          257, 1, "B", 1.0),   # counts ADC (0=off)
+    # byte 258: telemetria CAN FD por ciclo (0x410 + histórico knock 0x411, 64 B + BRS)
+    ("can_fd_telemetry_enable",     258, 1, "B", 1.0),   # 0=off 1=FD
+    # bytes 259-261: knock DSP em banda (Goertzel)
+    ("knock_intensity_thr_x10",     259, 1, "B", 0.1),   # × fundo (0=3.0)
+    ("knock_band_hz",               260, 1, "H", 1.0),   # Hz (0=DSP off)
+    # bytes 262-269: trim cil 5-8 (ignorado em builds ≤ 4 cil)
+    ("cyl_fuel_trim_pct_4",         262, 1, "b", 1.0),   # % (build 5-8 cil)
+    ("cyl_fuel_trim_pct_5",         263, 1, "b", 1.0),
+    ("cyl_fuel_trim_pct_6",         264, 1, "b", 1.0),
+    ("cyl_fuel_trim_pct_7",         265, 1, "b", 1.0),
+    ("cyl_ign_trim_deg_4",          266, 1, "b", 1.0),   # °
+    ("cyl_ign_trim_deg_5",          267, 1, "b", 1.0),
+    ("cyl_ign_trim_deg_6",          268, 1, "b", 1.0),
+    ("cyl_ign_trim_deg_7",          269, 1, "b", 1.0),
+    # bytes 270-272: predição de MAP ao IVC (fuel em transiente)
+    ("map_pred_gain_pct",           270, 1, "B", 1.0),   # % (0=off, ≤100)
+    ("map_pred_ivc_btdc_deg",       271, 1, "H", 1.0),   # ° BTDC combustão (0=140)
+    # bytes 273-274: malha de posição ETB na ISR do TIM7
+    ("etb_loop_rate_hz",            273, 1, "H", 1.0),   # Hz 1000-2000 (0=PID no main loop)
+    # bytes 275-276: mapa aprendido de retardo de knock
+    ("knock_learn_step_x10",        275, 1, "B", 0.1),   # ° por knock (0=off)
+    ("knock_learn_max_x10",         276, 1, "B", 0.1),   # ° tecto (0=6.0)
+    # bytes 277-310: misfire por cinemática da cambota
+    ("misfire_accel_enable",        277, 1, "B", 1.0),   # 0=legado (soma×1.12), 1=aceleração
+    ("misfire_rough_ratio_pct",     278, 1, "B", 1.0),   # % do limiar (0=60)
+    ("misfire_thr_rad_s2",          279, 16, "H", 1.0),  # rad/s² [carga][rpm] 4×4 (0=default)
+    ("tooth_geom_enable",           311, 1, "B", 1.0),   # 0=roda nominal, 1=aprende erro por dente
+    ("diag_freeze_vars",            312, 8, "B", 1.0),   # FreezeVar por palavra (tudo 0=default)
 ]
 
 FIELD_PAGES = {0: PAGE0_FIELDS, 5: PAGE5_FIELDS, 6: PAGE6_FIELDS, 7: PAGE7_FIELDS}
@@ -316,24 +316,26 @@ def api_write_cells(page: int, body: dict):
     return {"ok": True, "written": len(writes)}
 
 
-# kFlashWriteSafeRpmX10 (engine/constants.h) — erase/program de flash pode
-# congelar o fetch por ~120µs (errata ES0565); firmware recusa o burn (ACK
-# de erro, sem detalhe) acima deste RPM. Checamos aqui antes de tentar para
-# dar uma mensagem clara em vez de relayar só o ACK genérico.
+# kFlashWriteSafeRpmX10 (engine/constants.h) — a primeira operação de flash
+# após o reset pode congelar o fetch por ~120µs (errata ES0565); o firmware
+# recusa o burn (ACK de erro, sem detalhe) acima deste RPM só até esse primeiro
+# job concluir. O dash não sabe se já concluiu: tenta sempre e, se o firmware
+# recusar com o motor acima do limite, explica o provável motivo.
 FLASH_WRITE_SAFE_RPM = 300
 
 @app.post("/api/pages/{page}/burn")
 def api_burn(page: int):
-    latest = worker.latest
-    if latest and latest.get("rpm", 0) > FLASH_WRITE_SAFE_RPM:
-        return JSONResponse(
-            {"error": f"burn bloqueado: motor a {latest['rpm']} RPM "
-                      f"(limite {FLASH_WRITE_SAFE_RPM} RPM — erase/program de "
-                      f"flash pode travar o scheduler; pare o motor e repita)"},
-            status_code=409)
     try:
         worker.submit(lambda l: l.burn_page(page))
     except Exception as e:  # noqa: BLE001 — devolvido à UI em vez de 500 opaco
+        latest = worker.latest
+        if latest and latest.get("rpm", 0) > FLASH_WRITE_SAFE_RPM:
+            return JSONResponse(
+                {"error": f"burn recusado: motor a {latest['rpm']} RPM "
+                          f"(limite {FLASH_WRITE_SAFE_RPM} RPM até a primeira "
+                          f"escrita de flash após o reset; pare o motor e "
+                          f"repita)"},
+                status_code=409)
         return JSONResponse({"error": f"burn página {page} falhou: {e}"},
                             status_code=502)
     return {"ok": True}
@@ -465,6 +467,26 @@ def api_debug_counters():
         return JSONResponse({"error": f"debug counters: {e}"}, status_code=502)
 
 
+@app.get("/api/dtc")
+def api_dtc():
+    """Memória persistente de DTCs (comando 'E'): código, ocorrências,
+    1ª/última activação (s de operação) e freeze frame da última."""
+    try:
+        return {"dtcs": worker.submit(lambda l: l.read_stored_dtcs())}
+    except Exception as e:  # noqa: BLE001
+        return JSONResponse({"error": f"dtc read: {e}"}, status_code=502)
+
+
+@app.post("/api/dtc/clear")
+def api_dtc_clear():
+    """Apaga a memória de DTCs (comando 'e'); falhas activas ficam."""
+    try:
+        worker.submit(lambda l: l.clear_stored_dtcs())
+    except Exception as e:  # noqa: BLE001
+        return JSONResponse({"error": f"dtc clear: {e}"}, status_code=502)
+    return {"ok": True}
+
+
 @app.get("/api/can_rx_map")
 def api_can_rx_map_get():
     # Prefer live page0 from ECU when link is up; fall back to server cache.
@@ -259,6 +259,7 @@ $$("#sb-nav .tab").forEach(b => b.onclick = () => {
   if (b.dataset.tab === "boost"     && !$("#boostRoot").dataset.loaded)    loadBoostMap();
   if (b.dataset.tab === "ltft-accum" && !$("#ltftAccumRoot").dataset.loaded) loadLtftAccum();
   if (b.dataset.tab === "output-test" && !$("#outputTestRoot").dataset.loaded) loadOutputTest();
+  if (b.dataset.tab === "dtc"       && !$("#dtcRoot").dataset.loaded)      loadDtc();
   if (b.dataset.tab === "telemetry")
     charts.forEach(c => c.u.setSize({ width: c.u.root.parentElement.clientWidth - 8, height: 300 }));
 });
@@ -1417,6 +1418,54 @@ async function loadLtftAccum() {
   await read();
 }
 
+/* ── DTC memory ('E' read / 'e' clear) ────────────────────────────────── */
+async function loadDtc() {
+  const root = $("#dtcRoot");
+  root.dataset.loaded = "1";
+  root.innerHTML = `
+    <div class="grid-toolbar">
+      <strong>DTC</strong>
+      <span class="muted" title="Memória persistente da ECU: ocorrências, 1ª/última activação (s de operação) e freeze frame da última">stored</span>
+      <button data-act="read">READ</button>
+      <button class="danger" data-act="clear">CLEAR</button>
+    </div>
+    <div id="dtcTable"></div>`;
+
+  async function read() {
+    try {
+      const r = await api("/api/dtc");
+      const rows = r.dtcs || [];
+      if (!rows.length) {
+        $("#dtcTable").innerHTML = `<p class="muted">sem DTCs guardados</p>`;
+        return;
+      }
+      let html = `<table class="tune"><tr><th>Code</th><th>Name</th><th>#</th>` +
+        `<th>First (s)</th><th>Last (s)</th><th>Freeze frame</th></tr>`;
+      for (const d of rows) {
+        const ff = Object.entries(d.freeze).map(([k, v]) => `${k}=${v}`).join(" · ");
+        html += `<tr><td>${d.pcode}</td><td>${d.name}</td><td>${d.occurrences}</td>` +
+          `<td>${d.first_seen_s}</td><td>${d.last_seen_s}</td><td>${ff || "—"}</td></tr>`;
+      }
+      $("#dtcTable").innerHTML = html + "</table>";
+    } catch (e) {
+      toast(String(e.message || e), true);
+      $("#dtcTable").innerHTML = `<p class="muted">sem dados</p>`;
+    }
+  }
+
+  root.querySelector("[data-act=read]").onclick = read;
+  root.querySelector("[data-act=clear]").onclick = async () => {
+    if (!confirm("CLEAR: apaga a memória de DTCs da ECU. Continuar?")) return;
+    try {
+      await api("/api/dtc/clear", { method: "POST" });
+      toast("DTCs apagados");
+      await read();
+    } catch (e) { toast(e.message, true); }
+  };
+
+  await read();
+}
+
 /* ── CAN RX Map editor ────────────────────────────────────────────────── */
 const CAN_RX_FIELDS = [
   { key: "id",          label: "Frame ID (hex)",   hex: true  },